@@ -0,0 +1,273 @@
+#include "BatchExporter.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <future>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include "ion/base/logging.h"
+#include "ion/base/settingmanager.h"
+#include "ion/base/stringutils.h"
+#include "ion/gfx/framebufferobject.h"
+#include "ion/gfx/renderer.h"
+#include "ion/image/renderutils.h"
+#include "ion/port/fileutils.h"
+#include "ion/port/memory.h"
+#include "ion/portgfx/visual.h"
+#include "Camera.hpp"
+#include "FileManager.hpp"
+#include "HudItem.hpp"
+#include "Scene.hpp"
+
+using namespace ion::gfx;
+using namespace ion::math;
+using namespace std;
+
+namespace Snapshot{
+
+CameraPreset::CameraPreset():
+   Ra(Angled::FromDegrees(0.0)),
+   Dec(Angled::FromDegrees(0.0)),
+   Radius(4.0) {}
+
+BatchExportOptions::BatchExportOptions():
+   OutputDirectory("."),
+   Size(1280, 720) {}
+
+bool BatchExportOptions::IsRequested(const vector<string>& arguments)
+{
+   return std::find(arguments.begin(), arguments.end(), "--export") != arguments.end();
+}
+
+BatchExportOptions BatchExportOptions::Parse(const vector<string>& arguments)
+{
+   BatchExportOptions options;
+
+   for (size_t i = 0; i < arguments.size(); i++)
+   {
+      const string& arg = arguments[i];
+
+      if (arg.compare(0, 2, "--") != 0)
+      {
+         options.Files.push_back(arg);
+         continue;
+      }
+
+      if (i + 1 >= arguments.size())
+         throw invalid_argument("Missing value for " + arg);
+
+      const string& value = arguments[++i];
+
+      if (arg == "--export")
+      {
+         options.OutputDirectory = value;
+      }
+      else if (arg == "--size")
+      {
+         vector<string> split = ion::base::SplitString(value, "x");
+
+         if (split.size() != 2 || atoi(split[0].c_str()) <= 0 || atoi(split[1].c_str()) <= 0)
+            throw invalid_argument("Expected <width>x<height> for --size, got: " + value);
+
+         options.Size = Vector2ui(atoi(split[0].c_str()), atoi(split[1].c_str()));
+      }
+      else if (arg == "--view")
+      {
+         vector<string> split = ion::base::SplitString(value, ",");
+
+         if (split.size() != 3)
+            throw invalid_argument("Expected <ra>,<dec>,<radius> for --view, got: " + value);
+
+         CameraPreset preset;
+         preset.Ra = Angled::FromDegrees(atof(split[0].c_str()));
+         preset.Dec = Angled::FromDegrees(atof(split[1].c_str()));
+         preset.Radius = atof(split[2].c_str());
+
+         options.Presets.push_back(preset);
+      }
+      else if (arg == "--set")
+      {
+         size_t equals = value.find('=');
+
+         if (equals == string::npos)
+            throw invalid_argument("Expected <setting>=<value> for --set, got: " + value);
+
+         options.Settings.push_back(make_pair(value.substr(0, equals), value.substr(equals + 1)));
+      }
+      else
+      {
+         throw invalid_argument("Unknown option: " + arg);
+      }
+   }
+
+   if (options.Files.empty())
+      throw invalid_argument("No input files given");
+
+   return options;
+}
+
+BatchExporter::BatchExporter(const BatchExportOptions& options):
+   m_Options(options),
+   m_Visual(ion::portgfx::Visual::CreateVisual()),
+   m_EncodeGroup(ion::base::TaskScheduler::GetDefault(), "EncodePng"),
+   m_WrittenCount(0)
+{
+   if (!m_Visual || !m_Visual->IsValid() || !ion::portgfx::Visual::MakeCurrent(m_Visual.get()))
+      throw runtime_error("Unable to create an offscreen OpenGL context");
+
+   m_Scene.reset(new Scene(m_Keyboard));
+
+   //The exporter decides when epochs are calculated
+   m_Scene->GetFileManager()->SetAutoLoad(false);
+
+   m_Scene->GetCamera()->SetViewportBounds(m_Options.Size);
+
+   //Render into a framebuffer of the requested size, since the context may not have a surface
+   m_Framebuffer = FramebufferObjectPtr(new FramebufferObject(m_Options.Size[0], m_Options.Size[1]));
+   m_Framebuffer->SetColorAttachment(0U, FramebufferObject::Attachment(Image::kRgba8888));
+   m_Framebuffer->SetDepthAttachment(FramebufferObject::Attachment(Image::kRenderbufferDepth16));
+
+   m_Scene->GetRenderer()->BindFramebuffer(m_Framebuffer);
+}
+
+BatchExporter::~BatchExporter()
+{
+   //Finish writing before the scene goes away
+   m_EncodeGroup.Wait();
+
+   if (m_Scene)
+      m_Scene->GetRenderer()->BindFramebuffer(FramebufferObjectPtr());
+
+   m_Scene.reset();
+}
+
+size_t BatchExporter::Run()
+{
+   for (auto iter = m_Options.Settings.cbegin(); iter != m_Options.Settings.cend(); ++iter)
+   {
+      auto* setting = ion::base::SettingManager::GetSetting(iter->first);
+
+      if (setting == nullptr || !setting->FromString(iter->second))
+         throw invalid_argument("Unable to set " + iter->first + " to " + iter->second);
+   }
+
+   //Dispatch the setting changes to the scene and the file manager
+   m_Scene->Update(0.0, 0.0);
+
+   auto fileManager = m_Scene->GetFileManager();
+
+   //Progress is only logged, so it does not hide the HUD text in the images
+   ProgressHudItem progressItem("");
+
+   {
+      auto progress = progressItem.GetProgressHandler();
+      fileManager->LoadFiles(m_Options.Files, progress);
+   }
+
+   const size_t epochCount = fileManager->GetEpochCount();
+
+   LOG(INFO) << "Exporting " << epochCount << " epochs to " << m_Options.OutputDirectory;
+
+   auto calcEpoch = [&](size_t epochIndex) -> const SnapshotData*
+   {
+      auto progress = progressItem.GetProgressHandler();
+      return &fileManager->CalcEpoch(epochIndex, progress);
+   };
+
+   //Calculate the next epoch while the current one is rendered
+   future<const SnapshotData*> next;
+
+   if (epochCount > 0)
+      next = async(launch::async, calcEpoch, 0);
+
+   for (size_t i = 0; i < epochCount; i++)
+   {
+      const SnapshotData* snapshot = nullptr;
+
+      try
+      {
+         snapshot = next.get();
+      } catch (std::exception& ex)
+      {
+         LOG(ERROR) << "Skipping epoch " << i << ": " << ex.what();
+      }
+
+      if (i + 1 < epochCount)
+         next = async(launch::async, calcEpoch, i + 1);
+
+      if (snapshot == nullptr)
+      {
+         fileManager->ReleaseEpoch(i);
+         continue;
+      }
+
+      fileManager->RunPostProcessSteps(*snapshot);
+
+      if (m_Options.Presets.empty())
+      {
+         RenderView(nullptr, GetFilename(i, 0));
+      }
+      else
+      {
+         for (size_t j = 0; j < m_Options.Presets.size(); j++)
+            RenderView(&m_Options.Presets[j], GetFilename(i, j));
+      }
+
+      //The scene has its own copy of the output data, so only the epochs in flight stay loaded
+      fileManager->ReleaseEpoch(i);
+   }
+
+   //Deliver the frames still in flight and wait for them to be written
+   m_Scene->GetRenderer()->ProcessAsyncImageReads(true);
+   m_EncodeGroup.Wait();
+
+   LOG(INFO) << "Peak memory: " << ion::port::GetProcessPeakResidentMemorySize() / (1024 * 1024) << " MB";
+
+   return m_WrittenCount;
+}
+
+void BatchExporter::RenderView(const CameraPreset* preset, const string& filename)
+{
+   if (preset != nullptr)
+   {
+      m_Scene->GetCamera()->SetRA(preset->Ra);
+      m_Scene->GetCamera()->SetDEC(preset->Dec);
+      m_Scene->GetCamera()->SetRadius(Vector1d(preset->Radius));
+   }
+
+   m_Scene->Update(0.0, 0.0);
+   m_Scene->Render();
+
+   auto writeFile = [this, filename](const vector<uint8>& data)
+   {
+      FILE* file = data.empty() ? nullptr : ion::port::OpenFile(filename, "wb");
+
+      if (file == nullptr || fwrite(data.data(), 1, data.size(), file) != data.size())
+         LOG(ERROR) << "Error writing image: " << filename;
+      else
+         ++m_WrittenCount;
+
+      if (file != nullptr)
+         fclose(file);
+   };
+
+   m_Scene->GetRenderer()->ReadImageAsync(Range2i::BuildWithSize(Point2i::Zero(), Vector2i(m_Options.Size)),
+                                          Image::kRgba8888,
+                                          ion::base::AllocatorPtr(),
+                                          ion::image::BuildExternalImageReadCallback(ion::image::kPng, true, writeFile, &m_EncodeGroup));
+}
+
+string BatchExporter::GetFilename(size_t epochIndex, size_t viewIndex) const
+{
+   ostringstream filename;
+
+   filename << m_Options.OutputDirectory << "/epoch_" << setfill('0') << setw(5) << epochIndex;
+
+   if (m_Options.Presets.size() > 1)
+      filename << "_view_" << setw(2) << viewIndex;
+
+   filename << ".png";
+
+   return filename.str();
+}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "IonFwd.h"
+#include "ion/base/taskscheduler.h"
+#include "ion/math/angle.h"
+#include "ion/math/vector.h"
+#include "KeyboardHandler.hpp"
+
+namespace ion {namespace portgfx{
+class Visual;
+}}
+
+namespace Snapshot{
+class Scene;
+
+//A viewpoint to render every epoch from. The camera orbits the origin of the VNB frame
+struct CameraPreset
+{
+   CameraPreset();
+
+   ion::math::Angled Ra;
+   ion::math::Angled Dec;
+   double Radius;
+};
+
+//The command line options for rendering without a window:
+//
+//   Snapshot --export <directory> [--size <width>x<height>] [--view <ra>,<dec>,<radius>]...
+//            [--set <setting>=<value>]... <files>...
+//
+//Every epoch of the files is rendered once per view (or once from the default view if none are
+//given) and written to <directory>/epoch_<index>[_view_<index>].png. --set changes any registered
+//setting, e.g. --set Config/AllToAll/Use=true or --set Config/HardBodyRadius=0.02
+struct BatchExportOptions
+{
+   BatchExportOptions();
+
+   //Returns whether the arguments request a batch export
+   static bool IsRequested(const std::vector<std::string> & arguments);
+
+   //Parses the arguments. Throws std::invalid_argument if they are malformed
+   static BatchExportOptions Parse(const std::vector<std::string> & arguments);
+
+   std::vector<std::string> Files;
+   std::string OutputDirectory;
+   ion::math::Vector2ui Size;
+   std::vector<CameraPreset> Presets;
+   std::vector<std::pair<std::string, std::string>> Settings;
+};
+
+//Renders epochs into an offscreen framebuffer and writes them as PNG files, without a window.
+//While an epoch is rendered, the next one is calculated on another thread, and the rendered frames
+//are read back asynchronously and encoded on the default TaskScheduler, so that the
+//calculation, the GPU and the encoding all run at the same time
+class BatchExporter
+{
+public:
+   //Creates the offscreen GL context and the scene. Throws std::runtime_error if no context can be
+   //created, e.g. if neither EGL nor an X server is available
+   explicit BatchExporter(const BatchExportOptions & options);
+   ~BatchExporter();
+
+   //Renders and writes all epochs. Returns the number of images written
+   size_t Run();
+
+private:
+   //Renders the current scene from the preset, or from the current camera if it is null, and
+   //starts writing it to the file
+   void RenderView(const CameraPreset * preset, const std::string & filename);
+
+   std::string GetFilename(size_t epochIndex, size_t viewIndex) const;
+
+   BatchExportOptions m_Options;
+
+   std::unique_ptr<ion::portgfx::Visual> m_Visual;
+
+   KeyboardHandler m_Keyboard;
+   std::unique_ptr<Scene> m_Scene;
+   ion::gfx::FramebufferObjectPtr m_Framebuffer;
+
+   ion::base::TaskScheduler::TaskGroup m_EncodeGroup;
+   std::atomic<size_t> m_WrittenCount;
+};
+}
@@ -6,6 +6,7 @@
 #include "ion/gfx/uniformblock.h"
 #include "ion/gfx/shaderinputregistry.h"
 #include "ion/gfx/statetable.h"
+#include "ion/gfx/uniformhandle.h"
 #include "Macros.h"
 #include "ion/math/angleutils.h"
 
@@ -14,6 +15,11 @@ using namespace ion::math;
 
 static const float MaxVerticalAngle = 85.0f; //must be less than 90 to avoid gimbal lock
 
+//Handles for the uniforms that are updated every frame
+static const UniformHandle ViewportSizeUniform(UNIFORM_GLOBAL_VIEWPORTSIZE);
+static const UniformHandle ProjectionMatrixUniform(UNIFORM_GLOBAL_PROJECTIONMATRIX);
+static const UniformHandle ModelviewMatrixUniform(UNIFORM_GLOBAL_MODELVIEWMATRIX);
+
 Camera::Camera(StateTablePtr rootStateTable) :
    m_WindowBounds(Range2ui::BuildWithSize(Point2ui::Zero(), Vector2ui::Fill(100))),
    m_Scale(Vector3d::Fill(1.0)),
@@ -49,9 +55,9 @@ Camera::~Camera() {}
 
 void Camera::UpdateUniforms()
 {
-   m_ViewportUniforms->SetUniformByName<Vector2i>(UNIFORM_GLOBAL_VIEWPORTSIZE, Vector2i(GetViewportSize()));
-   m_3dUniforms->SetUniformByName<Matrix4f>(UNIFORM_GLOBAL_PROJECTIONMATRIX, Matrix4f(ProjectionMatrix()));
-   m_3dUniforms->SetUniformByName<Matrix4f>(UNIFORM_GLOBAL_MODELVIEWMATRIX, Matrix4f(ViewMatrix()));
+   m_ViewportUniforms->SetUniformByHandle<Vector2i>(ViewportSizeUniform, Vector2i(GetViewportSize()));
+   m_3dUniforms->SetUniformByHandle<Matrix4f>(ProjectionMatrixUniform, Matrix4f(ProjectionMatrix()));
+   m_3dUniforms->SetUniformByHandle<Matrix4f>(ModelviewMatrixUniform, Matrix4f(ViewMatrix()));
 }
 
 const UniformBlockPtr& Camera::GetViewportUniforms() const
@@ -0,0 +1,16 @@
+#include "ConfigSettings.hpp"
+#include "Macros.h"
+
+namespace Snapshot{
+
+ConfigSettings::ConfigSettings():
+   HardBodyRadius(SETTINGS_CONFIG_HBR, ConfigDefaults::HardBodyRadius, "Sets the hard body radius between states in kilometers"),
+   AllToAll_BinCount(SETTINGS_CONFIG_ALLTOALL_BIN_COUNT, ConfigDefaults::AllToAll_BinCount, "Specifies the max number of bins to use in the X/Y/Z direction combined when calculating All-to-ALL"),
+   AllToAll_InitialBinMultiplier(SETTINGS_CONFIG_ALLTOALL_INITIAL_BIN_MULT, ConfigDefaults::AllToAll_InitialBinMultiplier, "If the All-to-All data falls outside the current bin boundary, the process must be restarted with a larger boundary. The initial value for the size of the boundary is determined by One-to-One boundary times this multiplier"),
+   AllToAll_MaxBinTries(SETTINGS_CONFIG_ALLTOALL_MAX_BIN_TRIES, ConfigDefaults::AllToAll_MaxBinTries, "If the All-to-All data falls outside the current bin boundary, the boundary size will be doubled and the process is restarted. This specifies the maximum number of times to restart the process before terminating"),
+   AllToAll_Sampling_Use(SETTINGS_CONFIG_ALLTOALL_SAMPLING_USE, ConfigDefaults::AllToAll_Sampling_Use, "Estimates the All-to-All Pc from randomly sampled pairs instead of binning every pair. Sampling stops once the confidence interval of Pc is narrow enough"),
+   AllToAll_Sampling_RelativeError(SETTINGS_CONFIG_ALLTOALL_SAMPLING_RELATIVE_ERROR, ConfigDefaults::AllToAll_Sampling_RelativeError, "When sampling All-to-All, sampling stops once half the width of the confidence interval of Pc is below this fraction of Pc"),
+   AllToAll_Sampling_Confidence(SETTINGS_CONFIG_ALLTOALL_SAMPLING_CONFIDENCE, ConfigDefaults::AllToAll_Sampling_Confidence, "The confidence level of the Pc interval when sampling All-to-All, between 0.5 and 1"),
+   AllToAll_Sampling_BatchSize(SETTINGS_CONFIG_ALLTOALL_SAMPLING_BATCH_SIZE, ConfigDefaults::AllToAll_Sampling_BatchSize, "The number of pairs sampled between checks of the Pc interval when sampling All-to-All"),
+   AllToAll_Sampling_MaxPairs(SETTINGS_CONFIG_ALLTOALL_SAMPLING_MAX_PAIRS, ConfigDefaults::AllToAll_Sampling_MaxPairs, "The maximum number of pairs to sample when sampling All-to-All, in case the interval never gets narrow enough, e.g. because there are no hits") {}
+}
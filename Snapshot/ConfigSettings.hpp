@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include "ion/base/setting.h"
+
+namespace Snapshot{
+
+//The defaults of the Config/ settings. Code that reads the settings through a SettingHandle uses them
+//until the settings are created, so they are only defined here
+namespace ConfigDefaults{
+   const float HardBodyRadius = .120f;
+   const uint32_t AllToAll_BinCount = 1000000;
+   const float AllToAll_InitialBinMultiplier = 1.0f;
+   const uint32_t AllToAll_MaxBinTries = 5;
+   const bool AllToAll_Sampling_Use = false;
+   const float AllToAll_Sampling_RelativeError = 0.1f;
+   const float AllToAll_Sampling_Confidence = 0.95f;
+   const uint32_t AllToAll_Sampling_BatchSize = 1000000;
+   const uint32_t AllToAll_Sampling_MaxPairs = 20000000;
+}
+
+//The Config/ settings used by the calculations. Both the window and the screener create them, so
+//they are declared in one place to keep their defaults and descriptions the same
+struct ConfigSettings
+{
+   ConfigSettings();
+
+   ion::base::Setting<float> HardBodyRadius;
+   ion::base::Setting<uint32_t> AllToAll_BinCount;
+   ion::base::Setting<float> AllToAll_InitialBinMultiplier;
+   ion::base::Setting<uint32_t> AllToAll_MaxBinTries;
+   ion::base::Setting<bool> AllToAll_Sampling_Use;
+   ion::base::Setting<float> AllToAll_Sampling_RelativeError;
+   ion::base::Setting<float> AllToAll_Sampling_Confidence;
+   ion::base::Setting<uint32_t> AllToAll_Sampling_BatchSize;
+   ion::base::Setting<uint32_t> AllToAll_Sampling_MaxPairs;
+};
+}
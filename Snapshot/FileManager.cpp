@@ -1,13 +1,16 @@
 #include "FileManager.hpp"
+#include "ConfigSettings.hpp"
 #include <ion/base/stringutils.h>
 #include <ion/base/vectordatacontainer.h>
+#include <ion/math/batchutils.h>
 #include <ion/math/matrixutils.h>
 #include <ion/math/vectorutils.h>
 #include <future>
-#include "Hud.hpp"
+#include <random>
+#include "HudItem.hpp"
 #include "ion/base/serialize.h"
 #include "FinalAction.hpp"
-#include "ion/base/settingmanager.h"
+#include "ion/base/settinghandle.h"
 #include "Macros.h"
 
 using namespace ion::math;
@@ -15,6 +18,52 @@ using namespace std;
 
 namespace Snapshot{
 
+//A SettingHandle paired with the default of its setting, which it returns until the setting is created
+template <typename T>
+class ConfigHandle
+{
+public:
+   ConfigHandle(const string& name, const T& defaultValue) : m_Handle(name), m_Default(defaultValue) {}
+   T GetValue() const { return m_Handle.GetValue(m_Default); }
+private:
+   ion::base::SettingHandle<T> m_Handle;
+   const T m_Default;
+};
+
+//Resolved once and read lock-free from the worker threads
+static ConfigHandle<uint32_t> AllToAllBinCount(SETTINGS_CONFIG_ALLTOALL_BIN_COUNT, ConfigDefaults::AllToAll_BinCount);
+static ConfigHandle<float> AllToAllInitialBinMultiplier(SETTINGS_CONFIG_ALLTOALL_INITIAL_BIN_MULT, ConfigDefaults::AllToAll_InitialBinMultiplier);
+static ConfigHandle<uint32_t> AllToAllMaxBinTries(SETTINGS_CONFIG_ALLTOALL_MAX_BIN_TRIES, ConfigDefaults::AllToAll_MaxBinTries);
+static ConfigHandle<bool> AllToAllSamplingUse(SETTINGS_CONFIG_ALLTOALL_SAMPLING_USE, ConfigDefaults::AllToAll_Sampling_Use);
+static ConfigHandle<float> AllToAllSamplingRelativeError(SETTINGS_CONFIG_ALLTOALL_SAMPLING_RELATIVE_ERROR, ConfigDefaults::AllToAll_Sampling_RelativeError);
+static ConfigHandle<float> AllToAllSamplingConfidence(SETTINGS_CONFIG_ALLTOALL_SAMPLING_CONFIDENCE, ConfigDefaults::AllToAll_Sampling_Confidence);
+static ConfigHandle<uint32_t> AllToAllSamplingBatchSize(SETTINGS_CONFIG_ALLTOALL_SAMPLING_BATCH_SIZE, ConfigDefaults::AllToAll_Sampling_BatchSize);
+static ConfigHandle<uint32_t> AllToAllSamplingMaxPairs(SETTINGS_CONFIG_ALLTOALL_SAMPLING_MAX_PAIRS, ConfigDefaults::AllToAll_Sampling_MaxPairs);
+
+//Returns z such that a standard normal variable is above z with the probability p, for 0 < p <= 0.5.
+//Uses the rational approximation 26.2.23 of Abramowitz and Stegun, which is accurate to 4.5e-4
+static double CalcNormalQuantile(double p)
+{
+   double t = sqrt(-2.0 * log(p));
+
+   return t - (2.515517 + 0.802853 * t + 0.010328 * t * t) / (1.0 + 1.432788 * t + 0.189269 * t * t + 0.001308 * t * t * t);
+}
+
+//Calculates the Wilson score interval of a binomial proportion, which unlike the normal
+//approximation stays within [0, 1] and is usable for proportions close to 0
+static void CalcWilsonInterval(uint64_t hitCount, uint64_t count, double z, double& lower, double& upper)
+{
+   double n = static_cast<double>(count);
+   double p = hitCount / n;
+   double z2 = z * z;
+
+   double center = (p + z2 / (2.0 * n)) / (1.0 + z2 / n);
+   double halfWidth = z * sqrt(p * (1.0 - p) / n + z2 / (4.0 * n * n)) / (1.0 + z2 / n);
+
+   lower = std::max(0.0, center - halfWidth);
+   upper = std::min(1.0, center + halfWidth);
+}
+
 Range3d CalcStatesRange(const std::vector<State>& states)
 {
    Range3d bounds(Point3d::Fill(std::numeric_limits<double>::max()), Point3d::Fill(std::numeric_limits<double>::min()));
@@ -29,11 +78,35 @@ Range3d CalcStatesRange(const std::vector<State>& states)
 
 std::vector<ion::math::Matrix3d> CalcStatesVnb(const std::vector<State>& states)
 {
+   const size_t count = states.size();
+
+   std::vector<Vector3d> r(count);
+   std::vector<Vector3d> v(count);
+   std::vector<Vector3d> n(count);
+   std::vector<Vector3d> b(count);
+
+   for (size_t i = 0; i < count; i++)
+   {
+      r[i] = states[i].Pos - Point3d::Zero();
+      v[i] = states[i].Vel;
+   }
+
+   //Same as SnapshotData::CalcVNB but for all states at once using the batched math kernels
+   NormalizeVectors(r.data(), count, r.data());
+   NormalizeVectors(v.data(), count, v.data());
+   CrossVectors(r.data(), v.data(), count, n.data());
+   NormalizeVectors(n.data(), count, n.data());
+   CrossVectors(v.data(), n.data(), count, b.data());
+   NormalizeVectors(b.data(), count, b.data());
+
    std::vector<ion::math::Matrix3d> vnbs;
+   vnbs.reserve(count);
 
-   for (size_t i = 0; i < states.size(); i++)
+   for (size_t i = 0; i < count; i++)
    {
-      vnbs.push_back(SnapshotData::CalcVNB(states[i]));
+      vnbs.push_back(Matrix3d(v[i][0], v[i][1], v[i][2],
+                              n[i][0], n[i][1], n[i][2],
+                              b[i][0], b[i][1], b[i][2]));
    }
 
    return vnbs;
@@ -53,13 +126,16 @@ std::vector<ion::math::Point3d> CalcStatesPos(const std::vector<State>& states)
 
 SnapshotDataStats::SnapshotDataStats():
    Count(0),
-   Pc(0) {}
+   Pc(0),
+   PcLower(0),
+   PcUpper(0) {}
 
 SnapshotData::SnapshotData(double epoch, const std::vector<State>& stateA, const std::vector<State>& stateB):
    m_Epoch(epoch),
    m_StateAVnb(CalcStatesVnb(stateA)),
    m_StateAPos(CalcStatesPos(stateA)),
    m_StateBPos(CalcStatesPos(stateB)),
+   m_AllToAllSampled(false),
    m_Stats() {}
 
 SnapshotData::~SnapshotData() {}
@@ -79,16 +155,31 @@ const std::vector<StateVertex>& SnapshotData::GetOutputData() const
    return m_OutputData;
 }
 
+SnapshotUnitOfWork::StatsTotals::StatsTotals():
+   MinPoint(Point3f::Fill(std::numeric_limits<float>::max())),
+   MaxPoint(Point3f::Fill(-std::numeric_limits<float>::max())),
+   MinMiss2(std::numeric_limits<float>::max()),
+   MaxMiss2(0.0f),
+   WeightedSum(Vector3d::Zero()),
+   HitCount(0),
+   Count(0) {}
+
 SnapshotUnitOfWork::SnapshotUnitOfWork(SnapshotData& snapshotData, bool allToAll, float hbr, ProgressHandler& progressHandler, std::atomic<uint32_t>& cancellationToken):
    m_SnapshotData(snapshotData),
    m_AllToAll(allToAll),
+   m_Sampled(AllToAllSamplingUse.GetValue()),
    m_HBR(hbr),
    m_ProgressHandler(progressHandler),
    m_CancellationToken(cancellationToken) {}
 
 void SnapshotUnitOfWork::CalcDiffs() const
 {
-   if (m_AllToAll)
+   if (m_AllToAll && m_Sampled)
+   {
+      //The hits depend on the HBR, so the pairs are always sampled again
+      m_SnapshotData.m_Stats = SampleAllToAllData();
+   }
+   else if (m_AllToAll)
    {
       m_SnapshotData.m_Stats = CalcStats(GetAllToAllData());
    }
@@ -142,16 +233,26 @@ const std::vector<DiffPoint>& SnapshotUnitOfWork::GetOneToOneData() const
 
 const std::vector<DiffPoint>& SnapshotUnitOfWork::GetAllToAllData() const
 {
-   if (m_SnapshotData.m_AllToAllDiffs.size() == 0)
+   //Sampled and binned diffs are cached separately
+   bool cached = m_SnapshotData.m_AllToAllDiffs.size() > 0 && m_SnapshotData.m_AllToAllSampled == m_Sampled;
+
+   if (!cached && m_Sampled)
+   {
+      m_SnapshotData.m_Stats = SampleAllToAllData();
+   }
+   else if (!cached)
    {
+      m_SnapshotData.m_AllToAllDiffs.clear();
+      m_SnapshotData.m_AllToAllSampled = false;
+
       //Get the diff data. This is cached if possible
       auto oneToOneData = GetOneToOneData();
 
       auto oneToOneStats = CalcStats(oneToOneData);
 
-      auto binCount = static_cast<ion::base::Setting<uint32_t>*>(ion::base::SettingManager::GetSetting(SETTINGS_CONFIG_ALLTOALL_BIN_COUNT))->GetValue();
-      auto multiplier = static_cast<ion::base::Setting<float>*>(ion::base::SettingManager::GetSetting(SETTINGS_CONFIG_ALLTOALL_INITIAL_BIN_MULT))->GetValue();
-      auto maxTries = static_cast<ion::base::Setting<uint32_t>*>(ion::base::SettingManager::GetSetting(SETTINGS_CONFIG_ALLTOALL_MAX_BIN_TRIES))->GetValue();
+      auto binCount = AllToAllBinCount.GetValue();
+      auto multiplier = AllToAllInitialBinMultiplier.GetValue();
+      auto maxTries = AllToAllMaxBinTries.GetValue();
 
       for (size_t i = 1; i <= maxTries; i++)
       {
@@ -303,6 +404,101 @@ void SnapshotUnitOfWork::TryBinAllToAllData(const ion::math::Range3f& bounds, fl
    }
 }
 
+SnapshotDataStats SnapshotUnitOfWork::SampleAllToAllData() const
+{
+   const size_t aCount = m_SnapshotData.m_StateAVnb.size();
+   const size_t bCount = m_SnapshotData.m_StateBPos.size();
+   const uint64_t pairCount = static_cast<uint64_t>(aCount) * bCount;
+
+   const double relativeError = AllToAllSamplingRelativeError.GetValue();
+   const double z = CalcNormalQuantile(0.5 * (1.0 - std::min(std::max(static_cast<double>(AllToAllSamplingConfidence.GetValue()), 0.5), 0.999999)));
+   const uint64_t batchSize = std::max<uint32_t>(AllToAllSamplingBatchSize.GetValue(), 1);
+   const uint64_t maxPairs = std::min<uint64_t>(std::max<uint32_t>(AllToAllSamplingMaxPairs.GetValue(), 1), pairCount);
+   const size_t keepCount = AllToAllBinCount.GetValue();
+
+   //Pairs are drawn in chunks of this size, each from its own generator
+   const size_t chunkSize = 4096;
+
+   m_SnapshotData.m_AllToAllDiffs.clear();
+   m_SnapshotData.m_AllToAllSampled = true;
+
+   StatsTotals totals;
+   double lower = 0.0;
+   double upper = 1.0;
+
+   m_ProgressHandler.SetProgressFunc([&totals, &lower, &upper]()
+                                     {
+                                        return "Sampling All-to-All\n" + ion::base::ValueToString(totals.Count) + " pairs\nPc: [" + ion::base::ValueToString(lower) + ", " + ion::base::ValueToString(upper) + "]";
+                                     });
+
+   std::vector<DiffPoint> batch;
+
+   for (uint64_t batchIndex = 0; totals.Count < maxPairs; batchIndex++)
+   {
+      const uint64_t batchStart = totals.Count;
+      const size_t count = static_cast<size_t>(std::min(batchSize, maxPairs - batchStart));
+      const int chunkCount = static_cast<int>((count + chunkSize - 1) / chunkSize);
+
+      batch.resize(count);
+
+#pragma omp parallel for
+      for (int chunk = 0; chunk < chunkCount; chunk++)
+      {
+         //Seeded by position, so that the same pairs are drawn on any number of threads
+         std::seed_seq seed = {static_cast<uint32_t>(batchIndex), static_cast<uint32_t>(chunk)};
+         std::mt19937 random(seed);
+         std::uniform_int_distribution<size_t> bDistribution(0, bCount - 1);
+
+         const size_t end = std::min(count, (chunk + 1) * chunkSize);
+
+         for (size_t i = chunk * chunkSize; i < end; i++)
+         {
+            //Stratified on A: every state of A is used equally often, paired with a random state of B
+            size_t aIdx = static_cast<size_t>((batchStart + i) % aCount);
+            size_t bIdx = bDistribution(random);
+
+            Point3d diff = Point3d::ToPoint(m_SnapshotData.m_StateAVnb[aIdx] * (m_SnapshotData.m_StateBPos[bIdx] - m_SnapshotData.m_StateAPos[aIdx]));
+
+            batch[i] = DiffPoint(Point3f(diff), 1);
+         }
+      }
+
+      if (m_CancellationToken > 0)
+         throw cancelled_exception("Cancelled in sampled All-to-All");
+
+      AddToTotals(batch, totals);
+
+      //Keep the first pairs to display
+      if (m_SnapshotData.m_AllToAllDiffs.size() < keepCount)
+      {
+         size_t keep = std::min(count, keepCount - m_SnapshotData.m_AllToAllDiffs.size());
+
+         m_SnapshotData.m_AllToAllDiffs.insert(m_SnapshotData.m_AllToAllDiffs.end(), batch.begin(), batch.begin() + keep);
+      }
+
+      CalcWilsonInterval(totals.HitCount, totals.Count, z, lower, upper);
+
+      //Stop once the half width of the interval is small enough compared to the estimate. Without
+      //any hits there is no estimate to compare against, so sampling continues up to the maximum
+      double pc = totals.HitCount / static_cast<double>(totals.Count);
+
+      if (totals.HitCount > 0 && 0.5 * (upper - lower) <= relativeError * pc)
+         break;
+   }
+
+   m_ProgressHandler.SetProgressFunc(nullptr);
+
+   SnapshotDataStats stats = FinishStats(totals);
+
+   if (totals.Count > 0)
+   {
+      stats.PcLower = lower;
+      stats.PcUpper = upper;
+   }
+
+   return stats;
+}
+
 std::vector<StateVertex> SnapshotUnitOfWork::GenerateVertices(const std::vector<DiffPoint>& diffData) const
 {
    std::vector<StateVertex> vertices;
@@ -317,12 +513,24 @@ std::vector<StateVertex> SnapshotUnitOfWork::GenerateVertices(const std::vector<
                                         return "Generating Vertex Data\n" + ion::base::ValueToString(round(i / static_cast<double>(diffCount) * 100.0)) + "% Complete";
                                      });
 
-   for (i = 0; i < diffData.size(); i++)
+   std::vector<Vector3f> positions(diffCount);
+   std::vector<float> lengthsSquared(diffCount);
+
+   for (size_t j = 0; j < diffCount; j++)
+   {
+      positions[j] = diffData[j].Pos - Point3f::Zero();
+   }
+
+   LengthsSquared(positions.data(), diffCount, lengthsSquared.data());
+
+   vertices.reserve(diffCount);
+
+   for (i = 0; i < diffCount; i++)
    {
       StateVertex vertex;
-      vertex.Pos = Vector3f::ToVector(Point3f(diffData[i].Pos));
+      vertex.Pos = positions[i];
 
-      if (LengthSquared(vertex.Pos) < hbr2)
+      if (lengthsSquared[i] < hbr2)
          vertex.Color = Vector4ui8(255, 0, 0, 255);
       else
          vertex.Color = Vector4ui8(0, 0, 255, 100);
@@ -337,52 +545,70 @@ std::vector<StateVertex> SnapshotUnitOfWork::GenerateVertices(const std::vector<
 
 SnapshotDataStats SnapshotUnitOfWork::CalcStats(const std::vector<DiffPoint>& diffs) const
 {
-   SnapshotDataStats stats;
+   StatsTotals totals;
 
-   Point3f minPoint = Point3f::Fill(std::numeric_limits<float>::max());
-   Point3f maxPoint = Point3f::Fill(-std::numeric_limits<float>::max());
+   AddToTotals(diffs, totals);
 
-   float minMiss = std::numeric_limits<float>::max();
-   float maxMiss = 0.0f;
+   return FinishStats(totals);
+}
 
+void SnapshotUnitOfWork::AddToTotals(const std::vector<DiffPoint>& diffs, StatsTotals& totals) const
+{
    float hbr2 = m_HBR * m_HBR;
 
-   long long hitCount = 0;
-
    for (size_t i = 0; i < diffs.size(); i++)
    {
       const Point3f& diff = diffs[i].Pos;
 
       for (int j = 0; j < 3; j++)
       {
-         if (diff[j] < minPoint[j])
-            minPoint[j] = diff[j];
-         if (diff[j] > maxPoint[j])
-            maxPoint[j] = diff[j];
+         if (diff[j] < totals.MinPoint[j])
+            totals.MinPoint[j] = diff[j];
+         if (diff[j] > totals.MaxPoint[j])
+            totals.MaxPoint[j] = diff[j];
       }
 
       float miss2 = diff[0] * diff[0] + diff[1] * diff[1] + diff[2] * diff[2];
 
-      if (miss2 < minMiss)
+      if (miss2 < totals.MinMiss2)
       {
-         minMiss = miss2;
-         stats.MinMiss = diff;
+         totals.MinMiss2 = miss2;
+         totals.MinMiss = diff;
       }
 
-      if (miss2 > maxMiss)
+      if (miss2 > totals.MaxMiss2)
       {
-         maxMiss = miss2;
-         stats.MaxMiss = diff;
+         totals.MaxMiss2 = miss2;
+         totals.MaxMiss = diff;
       }
 
       if (miss2 <= hbr2)
-         hitCount += diffs[i].Count;
+         totals.HitCount += diffs[i].Count;
+
+      totals.WeightedSum += Vector3d(diff - Point3f::Zero()) * static_cast<double>(diffs[i].Count);
+
+      totals.Count += diffs[i].Count;
+   }
+}
+
+SnapshotDataStats SnapshotUnitOfWork::FinishStats(const StatsTotals& totals)
+{
+   SnapshotDataStats stats;
 
-      stats.Count += diffs[i].Count;
+   stats.Count = static_cast<size_t>(totals.Count);
+   stats.MinMiss = totals.MinMiss;
+   stats.MaxMiss = totals.MaxMiss;
+   stats.Bounds = Range3f(totals.MinPoint, totals.MaxPoint);
+
+   //Without any pairs there is no estimate, so Pc stays 0 instead of NaN
+   if (stats.Count > 0)
+   {
+      stats.CenterOfMass = Vector3f(totals.WeightedSum / static_cast<double>(stats.Count));
+      stats.Pc = static_cast<double>(totals.HitCount) / static_cast<double>(stats.Count);
    }
 
-   stats.Bounds = Range3f(Point3f(minPoint), Point3f(maxPoint));
-   stats.Pc = static_cast<double>(hitCount) / static_cast<double>(stats.Count);
+   stats.PcLower = stats.Pc;
+   stats.PcUpper = stats.Pc;
 
    return stats;
 }
@@ -401,6 +627,8 @@ Matrix3d SnapshotData::CalcVNB(const State& origin)
 }
 
 FileManager::FileManager():
+   m_CancellationCount(0),
+   m_AutoLoad(true),
    m_CurrentEpochIndex(0),
    m_AllToAll(false),
    m_HBR(.120f) {}
@@ -433,13 +661,27 @@ void FileManager::AddPostProcessStep(const std::string& name, const PostProcess&
    m_PostProcessSteps[name] = PostProcessInfo(name, func, true);
 }
 
-void FileManager::SetHud(const std::shared_ptr<Hud>& hud)
+void FileManager::SetProgressHudItem(const std::shared_ptr<ProgressHudItem>& progressItem)
 {
-   m_Hud = hud;
+   m_ProgressItem = progressItem;
+}
+
+void FileManager::SetAutoLoad(bool autoLoad)
+{
+   m_AutoLoad = autoLoad;
 }
 
 void FileManager::SetFiles(const std::vector<std::string>& files)
 {
+   if (!m_AutoLoad)
+   {
+      ion::base::GenericLockGuard<ion::port::Mutex> lock(&m_InputChangedMutex);
+
+      m_Files = files;
+      m_InputChanged = true;
+      return;
+   }
+
    //Start new thread to load the changes. Must Detach!!!
    std::thread([=]()
                {
@@ -457,6 +699,14 @@ void FileManager::SetFiles(const std::vector<std::string>& files)
 
 void FileManager::SetEpochIndex(size_t epochIndex)
 {
+   if (!m_AutoLoad)
+   {
+      ion::base::GenericLockGuard<ion::port::Mutex> lock(&m_CalcChangedMutex);
+
+      m_CurrentEpochIndex = epochIndex;
+      return;
+   }
+
    //Start new thread to load the changes. Must Detach!!!
    std::thread([=]()
                {
@@ -472,6 +722,14 @@ void FileManager::SetEpochIndex(size_t epochIndex)
 
 void FileManager::SetAllToAll(bool allToAll)
 {
+   if (!m_AutoLoad)
+   {
+      ion::base::GenericLockGuard<ion::port::Mutex> lock(&m_CalcChangedMutex);
+
+      m_AllToAll = allToAll;
+      return;
+   }
+
    //Start new thread to load the changes. Must Detach!!!
    std::thread([=]()
                {
@@ -490,6 +748,14 @@ void FileManager::SetAllToAll(bool allToAll)
 
 void FileManager::SetHbr(float hbr)
 {
+   if (!m_AutoLoad)
+   {
+      ion::base::GenericLockGuard<ion::port::Mutex> lock(&m_OutputChangedMutex);
+
+      m_HBR = hbr;
+      return;
+   }
+
    //Start new thread to load the changes. Must Detach!!!
    std::thread([=]()
                {
@@ -506,79 +772,267 @@ void FileManager::SetHbr(float hbr)
                }).detach();
 }
 
+
 vector<double> FileManager::GetEpochs() const
 {
    vector<double> epochs;
 
-   for (size_t i = 0; i < m_StateData.size(); i++)
+   for (size_t i = 0; i < m_Epochs.size(); i++)
    {
-      epochs.push_back(m_StateData[i].GetEpoch());
+      epochs.push_back(m_Epochs[i].Epoch);
    }
 
    return epochs;
 }
 
-vector<State> FileManager::ParseToStates(const string& filename)
+void FileManager::LoadFiles(const vector<string>& files, ProgressHandler& progress)
+{
+   ion::base::GenericLockGuard<ion::port::Mutex> lock(&m_InputChangedMutex);
+
+   m_Files = files;
+   m_Epochs = IndexFiles(files, progress, m_CancellationCount);
+   m_StateData.clear();
+   m_StateData.resize(m_Epochs.size());
+   m_InputChanged = false;
+}
+
+size_t FileManager::GetEpochCount() const
+{
+   return m_Epochs.size();
+}
+
+const EpochInfo& FileManager::GetEpochInfo(size_t epochIndex) const
+{
+   return m_Epochs.at(epochIndex);
+}
+
+void FileManager::LoadEpoch(size_t epochIndex, ProgressHandler& progress)
+{
+   if (!m_StateData.at(epochIndex))
+      m_StateData[epochIndex] = ReadEpoch(m_Files, m_Epochs[epochIndex], progress, m_CancellationCount);
+}
+
+const SnapshotData& FileManager::CalcEpoch(size_t epochIndex, ProgressHandler& progress)
 {
-   vector<State> states;
+   bool allToAll;
+   float hbr;
 
-   ifstream fs(filename, ifstream::in);
+   {
+      ion::base::GenericLockGuard<ion::port::Mutex> calcLock(&m_CalcChangedMutex);
+      allToAll = m_AllToAll;
+   }
 
-   if (!fs.is_open())
    {
-      LOG(ERROR) << "Error opening file: " << filename;
+      ion::base::GenericLockGuard<ion::port::Mutex> outputLock(&m_OutputChangedMutex);
+      hbr = m_HBR;
    }
 
-   string line;
-   while (getline(fs, line))
+   LoadEpoch(epochIndex, progress);
+
+   SnapshotUnitOfWork work(*m_StateData[epochIndex], allToAll, hbr, progress, m_CancellationCount);
+
+   work.CalcDiffs();
+   work.CalcOutputs();
+
+   return work.GetSnapshotData();
+}
+
+SnapshotDataStats FileManager::CalcEpochStats(size_t epochIndex, bool allToAll, ProgressHandler& progress)
+{
+   float hbr;
+
    {
-      //Do with temp
-      vector<string> split = ion::base::SplitString(line, " ,");
+      ion::base::GenericLockGuard<ion::port::Mutex> outputLock(&m_OutputChangedMutex);
+      hbr = m_HBR;
+   }
 
-      if (split.size() == 8)
-      {
-         State state;
-         state.ScIdx = atoi(split[0].c_str());
-         state.Epoch = atof(split[1].c_str());
-         state.Pos = Point3d(atof(split[2].c_str()), atof(split[3].c_str()), atof(split[4].c_str()));
-         state.Vel = Vector3d(atof(split[5].c_str()), atof(split[6].c_str()), atof(split[7].c_str()));
+   LoadEpoch(epochIndex, progress);
 
-         states.push_back(state);
-      }
+   SnapshotUnitOfWork work(*m_StateData[epochIndex], allToAll, hbr, progress, m_CancellationCount);
+
+   work.CalcDiffs();
+
+   return work.GetSnapshotData().GetStats();
+}
+
+void FileManager::ReleaseEpoch(size_t epochIndex)
+{
+   m_StateData.at(epochIndex).reset();
+}
+
+void FileManager::RunPostProcessSteps(const SnapshotData& snapshot)
+{
+   for (auto iter = m_PostProcessSteps.cbegin(); iter != m_PostProcessSteps.cend(); ++iter)
+   {
+      if (iter->second.Enabled)
+         iter->second.Func(snapshot);
    }
+}
+
+bool FileManager::ParseState(const string& line, State& state)
+{
+   //Do with temp
+   vector<string> split = ion::base::SplitString(line, " ,\r");
+
+   if (split.size() != 8)
+      return false;
+
+   state.ScIdx = atoi(split[0].c_str());
+   state.Epoch = atof(split[1].c_str());
+   state.Pos = Point3d(atof(split[2].c_str()), atof(split[3].c_str()), atof(split[4].c_str()));
+   state.Vel = Vector3d(atof(split[5].c_str()), atof(split[6].c_str()), atof(split[7].c_str()));
 
-   return states;
+   return true;
 }
 
-vector<SnapshotData> FileManager::SeparateStateData(const vector<State>& stateLines)
+vector<EpochInfo> FileManager::IndexFiles(const vector<string>& files, ProgressHandler& progress, std::atomic<uint32_t>& cancellationToken)
 {
-   map<double, map<uint16_t, vector<State>>> epochToStateId;
+   //The ranges and the number of states per spacecraft for each epoch
+   map<double, pair<vector<FileRange>, map<uint16_t, size_t>>> epochToRanges;
 
-   for (size_t i = 0; i < stateLines.size(); i++)
+   size_t fileCount = files.size();
+
+   for (size_t i = 0; i < fileCount; i++)
    {
-      if (epochToStateId.find(stateLines[i].Epoch) == epochToStateId.end())
-         epochToStateId[stateLines[i].Epoch] = map<uint16_t, vector<State>>();
+      progress.SetProgressFunc([=]()
+                               {
+                                  return "Indexing file " + ion::base::ValueToString(i + 1) + " of " + ion::base::ValueToString(fileCount);
+                               });
+
+      //Binary, so that the offsets can be used to seek on every platform
+      ifstream fs(files[i], ifstream::in | ifstream::binary);
+
+      if (!fs.is_open())
+      {
+         LOG(ERROR) << "Error opening file: " << files[i];
+      }
+
+      string line;
+      State state;
+      streamoff offset = 0;
+
+      //The ranges of the epoch of the previous line, which is extended while the epoch stays the same
+      vector<FileRange>* currentRanges = nullptr;
+      double currentEpoch = 0.0;
+
+      while (getline(fs, line))
+      {
+         streamoff next = offset + static_cast<streamoff>(line.size()) + 1;
+
+         if (ParseState(line, state))
+         {
+            auto& entry = epochToRanges[state.Epoch];
+
+            if (currentRanges != nullptr && currentEpoch == state.Epoch)
+            {
+               currentRanges->back().End = next;
+            }
+            else
+            {
+               entry.first.push_back(FileRange(i, offset, next));
+
+               currentRanges = &entry.first;
+               currentEpoch = state.Epoch;
+            }
+
+            ++entry.second[state.ScIdx];
+         }
+
+         offset = next;
+      }
 
-      auto& epochMap = epochToStateId[stateLines[i].Epoch];
+      if (cancellationToken > 0)
+         throw cancelled_exception("Cancelled indexing files");
+   }
+
+   progress.SetProgressFunc(nullptr);
 
-      if (epochMap.find(stateLines[i].ScIdx) == epochMap.end())
-         epochMap[stateLines[i].ScIdx] = vector<State>();
+   vector<EpochInfo> epochs;
+
+   for (auto iter = epochToRanges.begin(); iter != epochToRanges.end(); ++iter)
+   {
+      const auto& stateCounts = iter->second.second;
 
-      auto& stateMap = epochMap[stateLines[i].ScIdx];
+      //Only epochs with exactly two spacecraft can be compared
+      if (stateCounts.size() != 2)
+         continue;
 
-      stateMap.push_back(stateLines[i]);
-      stateMap.back().SampleIdx = static_cast<int>(stateMap.size()) - 1;
+      EpochInfo info;
+      info.Epoch = iter->first;
+      info.StateACount = stateCounts.begin()->second;
+      info.StateBCount = (++stateCounts.begin())->second;
+      info.Ranges = iter->second.first;
+
+      epochs.push_back(info);
    }
 
-   vector<SnapshotData> stateData;
+   return epochs;
+}
+
+unique_ptr<SnapshotData> FileManager::ReadEpoch(const vector<string>& files, const EpochInfo& info, ProgressHandler& progress, std::atomic<uint32_t>& cancellationToken)
+{
+   map<uint16_t, vector<State>> stateMap;
+
+   size_t rangeCount = info.Ranges.size();
+   size_t i = 0;
 
-   for (auto iter = epochToStateId.begin(); iter != epochToStateId.end(); ++iter)
+   progress.SetProgressFunc([&i, rangeCount]()
+                            {
+                               return "Reading epoch\n" + ion::base::ValueToString(round(i / static_cast<double>(rangeCount) * 100.0)) + "% Complete";
+                            });
+
+   ifstream fs;
+   size_t openFile = 0;
+
+   for (i = 0; i < rangeCount; i++)
    {
-      if (iter->second.size() == 2)
-         stateData.push_back(SnapshotData(iter->first, iter->second.begin()->second, (++iter->second.begin())->second));
+      const FileRange& range = info.Ranges[i];
+
+      //Ranges are in file order, so each file is only opened once
+      if (!fs.is_open() || openFile != range.FileIndex)
+      {
+         fs.close();
+         fs.clear();
+         fs.open(files[range.FileIndex], ifstream::in | ifstream::binary);
+         openFile = range.FileIndex;
+
+         if (!fs.is_open())
+            throw std::runtime_error("Error opening file: " + files[range.FileIndex]);
+      }
+
+      fs.clear();
+      fs.seekg(range.Begin);
+
+      string line;
+      State state;
+      streamoff offset = range.Begin;
+
+      while (offset < range.End && getline(fs, line))
+      {
+         offset += static_cast<streamoff>(line.size()) + 1;
+
+         if (!ParseState(line, state) || state.Epoch != info.Epoch)
+            continue;
+
+         auto& states = stateMap[state.ScIdx];
+
+         if (states.empty())
+            states.reserve(std::max(info.StateACount, info.StateBCount));
+
+         states.push_back(state);
+         states.back().SampleIdx = static_cast<int>(states.size()) - 1;
+      }
+
+      if (cancellationToken > 0)
+         throw cancelled_exception("Cancelled reading epoch");
    }
 
-   return stateData;
+   progress.SetProgressFunc(nullptr);
+
+   if (stateMap.size() != 2)
+      throw std::runtime_error("The states of epoch " + ion::base::ValueToString(info.Epoch) + " changed since the files were indexed");
+
+   return unique_ptr<SnapshotData>(new SnapshotData(info.Epoch, stateMap.begin()->second, (++stateMap.begin())->second));
 }
 
 void FileManager::Load()
@@ -602,7 +1056,9 @@ void FileManager::Load()
    if (m_CancellationCount > 0)
       return;
 
-   auto progressHandler = m_Hud->GetProgressHudItem()->GetProgressHandler();
+   auto progressHandler = m_ProgressItem->GetProgressHandler();
+
+   size_t index = 0;
 
    {
       //If files need to be loaded, do that here
@@ -612,55 +1068,42 @@ void FileManager::Load()
       {
          if (m_InputChanged)
          {
-            vector<State> combinedParsed;
-
-            size_t fileCount = m_Files.size();
-
-            for (size_t i = 0; i < fileCount; i++)
-            {
-               progressHandler.SetProgressFunc([=]()
-                                               {
-                                                  return "Reading file " + ion::base::ValueToString(i + 1) + " of " + ion::base::ValueToString(fileCount);
-                                               });
-
-               vector<State> parsed = ParseToStates(m_Files[i]);
+            m_Epochs = IndexFiles(m_Files, progressHandler, m_CancellationCount);
+            m_StateData.clear();
+            m_StateData.resize(m_Epochs.size());
+         }
 
-               if (parsed.size() > 0)
-               {
-                  combinedParsed.insert(combinedParsed.end(), parsed.begin(), parsed.end());
-               }
+         m_InputChanged = false;
 
-               if (m_CancellationCount > 0)
-                  throw cancelled_exception("Cancelled reading files");
-            }
+         if (m_Epochs.empty())
+            return;
 
-            progressHandler.SetProgressFunc(nullptr);
+         //Load the current data for the current index
+         index = std::min(m_CurrentEpochIndex, m_Epochs.size() - 1);
 
-            m_StateData = SeparateStateData(combinedParsed);
+         //Only the displayed epoch is kept in memory
+         for (size_t i = 0; i < m_StateData.size(); i++)
+         {
+            if (i != index)
+               ReleaseEpoch(i);
          }
 
-         m_InputChanged = false;
+         LoadEpoch(index, progressHandler);
       } catch (cancelled_exception& c)
       {
          LOG(INFO) << c.what();
+         return;
+      } catch (std::exception& ex)
+      {
+         LOG(ERROR) << ex.what();
+         return;
       }
    }
 
    if (m_CancellationCount > 0)
       return;
 
-   vector<SnapshotUnitOfWork> workUnits;
-
-   //For each state data, create a unit of work
-   for (size_t i = 0; i < m_StateData.size(); i++)
-   {
-      workUnits.push_back(SnapshotUnitOfWork(m_StateData[i], m_AllToAll, m_HBR, progressHandler, m_CancellationCount));
-   }
-
-   //Load the current data for the current index
-   size_t index = std::min(std::max(m_CurrentEpochIndex, static_cast<size_t>(0)), m_StateData.size() - 1);
-
-   auto& work = workUnits[index];
+   SnapshotUnitOfWork work(*m_StateData[index], m_AllToAll, m_HBR, progressHandler, m_CancellationCount);
 
    {
       //If files need to be loaded, do that here
@@ -702,11 +1145,7 @@ void FileManager::Load()
       ion::base::GenericLockGuard<ion::port::Mutex> cancelGuard(&m_CancelMutex);
 
       //Execute all post processing steps
-      for (auto iter = m_PostProcessSteps.cbegin(); iter != m_PostProcessSteps.cend(); ++iter)
-      {
-         if (iter->second.Enabled)
-            iter->second.Func(work.GetSnapshotData());
-      }
+      RunPostProcessSteps(work.GetSnapshotData());
 
       //Release cancellation count lock
    }
@@ -4,14 +4,15 @@
 #include "ion/math/vector.h"
 #include <fstream>
 #include <map>
+#include <memory>
 #include "ion/math/matrix.h"
 #include "ion/base/notifier.h"
 #include "ion/math/range.h"
 
-class Hud;
 class Camera;
 
 class ProgressHandler;
+class ProgressHudItem;
 
 namespace Snapshot{
 class State
@@ -53,6 +54,36 @@ public:
    uint32_t Count;
 };
 
+//A run of consecutive lines of the same epoch in an input file
+struct FileRange
+{
+   FileRange(size_t fileIndex, std::streamoff begin, std::streamoff end) :
+      FileIndex(fileIndex),
+      Begin(begin),
+      End(end)
+   {}
+
+   size_t FileIndex;
+   std::streamoff Begin;
+   std::streamoff End;
+};
+
+//Where the states of an epoch are in the input files, so that a single epoch can be read without
+//reading the others
+struct EpochInfo
+{
+   EpochInfo() :
+      Epoch(0.0),
+      StateACount(0),
+      StateBCount(0)
+   {}
+
+   double Epoch;
+   size_t StateACount;
+   size_t StateBCount;
+   std::vector<FileRange> Ranges;
+};
+
 struct SnapshotDataStats
 {
    SnapshotDataStats();
@@ -63,6 +94,10 @@ struct SnapshotDataStats
    ion::math::Point3f MinMiss;
    ion::math::Point3f MaxMiss;
    double Pc;
+
+   //The confidence interval of Pc. Both are equal to Pc unless it was estimated from sampled pairs
+   double PcLower;
+   double PcUpper;
 };
 
 class SnapshotData
@@ -104,6 +139,9 @@ private:
    mutable std::vector<DiffPoint> m_OneToOneDiffs;
    mutable std::vector<DiffPoint> m_AllToAllDiffs;
 
+   //Whether the All-to-All diffs are sampled pairs instead of binned pairs
+   mutable bool m_AllToAllSampled;
+
    //Output Data
    std::vector<StateVertex> m_OutputData;
    SnapshotDataStats m_Stats;
@@ -133,13 +171,36 @@ public:
    const std::vector<DiffPoint> & GetAllToAllData() const;
    
 private:
+   //Running totals of the stats, so that diffs can be added in batches
+   struct StatsTotals
+   {
+      StatsTotals();
+
+      ion::math::Point3f MinPoint;
+      ion::math::Point3f MaxPoint;
+      float MinMiss2;
+      float MaxMiss2;
+      ion::math::Point3f MinMiss;
+      ion::math::Point3f MaxMiss;
+      ion::math::Vector3d WeightedSum;
+      uint64_t HitCount;
+      uint64_t Count;
+   };
+
    void TryBinAllToAllData(const ion::math::Range3f & bounds, float multiplier, uint32_t binCount) const;
 
+   //Estimates the All-to-All stats from random pairs, in batches until the confidence interval of Pc
+   //is narrow enough. Keeps up to the All-to-All bin count of the pairs as the diff data
+   SnapshotDataStats SampleAllToAllData() const;
+
    std::vector<StateVertex> GenerateVertices(const std::vector<DiffPoint> & diffData) const;
    SnapshotDataStats CalcStats(const std::vector<DiffPoint> & diffs) const;
+   void AddToTotals(const std::vector<DiffPoint> & diffs, StatsTotals & totals) const;
+   static SnapshotDataStats FinishStats(const StatsTotals & totals);
 
    SnapshotData & m_SnapshotData;
    bool m_AllToAll;
+   bool m_Sampled;
    float m_HBR;
    ProgressHandler & m_ProgressHandler;
    std::atomic<uint32_t> & m_CancellationToken;
@@ -175,7 +236,12 @@ public:
 
    void AddPostProcessStep(const std::string & name, const PostProcess& func);
 
-   void SetHud(const std::shared_ptr<Hud> & hud);
+   //Sets the HUD item that shows the progress of the background Load()
+   void SetProgressHudItem(const std::shared_ptr<ProgressHudItem> & progressItem);
+
+   //When auto loading is disabled, the setters below only store their values and do not start a
+   //background Load(). Callers then drive the processing with LoadFiles() and CalcEpoch()
+   void SetAutoLoad(bool autoLoad);
 
    void SetFiles(const std::vector<std::string>& files);
    void SetEpochIndex(size_t epochIndex);
@@ -184,12 +250,38 @@ public:
 
    std::vector<double> GetEpochs() const;
 
+   //Indexes the epochs of the files on the calling thread. The states are not kept in memory, each
+   //epoch is read from the files again when it is needed
+   void LoadFiles(const std::vector<std::string>& files, ProgressHandler & progress);
+
+   size_t GetEpochCount() const;
+   const EpochInfo & GetEpochInfo(size_t epochIndex) const;
+
+   //Reads the states of an epoch on the calling thread, unless they are already loaded
+   void LoadEpoch(size_t epochIndex, ProgressHandler & progress);
+
+   //Calculates the stats and output data of an epoch on the calling thread, using the current
+   //All-to-All and HBR values. The epoch is loaded if necessary. Different epochs can be
+   //calculated concurrently
+   const SnapshotData & CalcEpoch(size_t epochIndex, ProgressHandler & progress);
+
+   //Calculates only the stats of an epoch on the calling thread, using the current HBR. The diffs
+   //stay cached until ReleaseEpoch(), so the One-to-One diffs are reused by a following All-to-All
+   SnapshotDataStats CalcEpochStats(size_t epochIndex, bool allToAll, ProgressHandler & progress);
+
+   //Frees the states and diff data of an epoch. It is read again the next time it is needed
+   void ReleaseEpoch(size_t epochIndex);
+
+   //Executes all enabled post processing steps for the snapshot
+   void RunPostProcessSteps(const SnapshotData & snapshot);
+
 protected:
    
 
 private:
-   static std::vector<State> ParseToStates(const std::string & filename);
-   static std::vector<SnapshotData> SeparateStateData(const std::vector<State> & stateLines);
+   static bool ParseState(const std::string & line, State & state);
+   static std::vector<EpochInfo> IndexFiles(const std::vector<std::string> & files, ProgressHandler & progress, std::atomic<uint32_t> & cancellationToken);
+   static std::unique_ptr<SnapshotData> ReadEpoch(const std::vector<std::string> & files, const EpochInfo & info, ProgressHandler & progress, std::atomic<uint32_t> & cancellationToken);
 
    //static std::vector<SnapshotData> LoadInput(const std::vector<std::string> & files, ProgressHandler & progress);
    //static void CalcDiffs(SnapshotData & data, bool allToAll, float hbr, ProgressHandler & progress);
@@ -197,13 +289,14 @@ private:
 
    void Load();
   
-   std::shared_ptr<Hud> m_Hud;
+   std::shared_ptr<ProgressHudItem> m_ProgressItem;
 
    //Sychronization objects
    ion::port::Mutex m_CancelMutex;
    std::atomic<uint32_t> m_CancellationCount;
    ion::port::Semaphore m_LoadSemaphore;
    ion::port::Mutex m_LoadMutex;
+   bool m_AutoLoad;
 
    //Inputs
    ion::port::Mutex m_InputChangedMutex;
@@ -219,7 +312,9 @@ private:
    ion::port::Mutex m_OutputChangedMutex;
    float m_HBR;
 
-   std::vector<SnapshotData> m_StateData;
+   //The index of every epoch, and the states of the epochs that are loaded or null
+   std::vector<EpochInfo> m_Epochs;
+   std::vector<std::unique_ptr<SnapshotData>> m_StateData;
 
    std::map<std::string, PostProcessInfo> m_PostProcessSteps;
 };
@@ -13,6 +13,7 @@
 #include "ion/gfx/bufferobject.h"
 #include "ion/gfx/shaderinputregistry.h"
 #include "ion/gfx/statetable.h"
+#include "ion/gfx/uniformhandle.h"
 #include "ion/gfxutils/shadermanager.h"
 #include "ion/math/matrix.h"
 #include "ion/math/range.h"
@@ -22,6 +23,7 @@
 #include "ion/text/font.h"
 #include "ion/text/fontimage.h"
 #include "ion/text/layout.h"
+#include "ion/text/layoutcache.h"
 #include "Macros.h"
 #include "ion/text/freetypefontutils.h"
 #include "ion/base/stringutils.h"
@@ -33,6 +35,9 @@ ION_REGISTER_ASSETS(SnapshotAssets);
 
 using namespace ion::text;
 using namespace ion::math;
+
+static const ion::gfx::UniformHandle ViewportSizeUniform(UNIFORM_GLOBAL_VIEWPORTSIZE);
+
 //-----------------------------------------------------------------------------
 //
 // Helper functions.
@@ -55,90 +60,74 @@ static ion::gfx::NodePtr BuildHudRootNode(int width, int height)
 
 FontPtr Hud::InitFont(const string& font_name, size_t size_in_pixels, size_t sdf_padding) const
 {
-   return demoutils::InitFont(m_FontManager, font_name, size_in_pixels, sdf_padding);
+   FontPtr font = demoutils::InitFont(m_FontManager, font_name, size_in_pixels, sdf_padding);
+   //The exact EDT is much faster than the default sweeps for glyphs this large
+   if (font.Get())
+      font->SetSdfAlgorithm(kExactEdtSdf);
+   return font;
 }
 
-const FontImagePtr Hud::InitFontImage(const string& key, const FontPtr& font) const
+//Returns the number of glyphs in all of the ImageData of a DynamicFontImage
+static size_t CountGlyphs(const FontImagePtr& font_image)
+{
+   size_t count = 0;
+   if (font_image.Get() && font_image->GetType() == FontImage::kDynamic)
+   {
+      DynamicFontImage* dfi = static_cast<DynamicFontImage*>(font_image.Get());
+      for (size_t i = 0; i < dfi->GetImageDataCount(); ++i)
+         count += dfi->GetImageData(i).glyph_set.size();
+   }
+   return count;
+}
+
+const FontImagePtr Hud::InitFontImage(const string& key, const FontPtr& font)
 {
    FontImagePtr font_image = m_FontManager->GetCachedFontImage(key);
+   if (font_image.Get())
+      return font_image;
+
+   font_image = m_FontManager->LoadFontImage(key, font);
    if (!font_image.Get())
    {
       DynamicFontImagePtr dfi(new DynamicFontImage(font, 256U));
       if (!dfi->GetImageData(0).texture.Get())
       {
          LOG(ERROR) << "Unable to create HUD FontImage";
+         return font_image;
       }
-      else
-      {
-         m_FontManager->CacheFontImage(key, dfi);
-         font_image = dfi;
-      }
+      m_FontManager->CacheFontImage(key, dfi);
+      font_image = dfi;
    }
-   return font_image;
-}
-
-size_t Hud::AddText(const FontImagePtr& font_image, const LayoutOptions& region, const string& text)
-{
-   size_t id = ion::base::kInvalidIndex;
-   if (font_image.Get()) { }
-   return id;
-}
-
-HudItem::HudItem(const string& startString):
-m_Text(startString){}
-
-void HudItem::SetText(const string& text) 
-{
-   m_Text = text;
-}
-
-string HudItem::GetText() const
-{
-   return m_Text;
-}
 
-ProgressHandler::~ProgressHandler() {
-//As we close, set the handle back to null
-   m_Parent->m_GetProgressFunc = nullptr;
+   //Keep the image data after it is rendered, so that glyphs added later can be saved
+   if (font_image->GetType() == FontImage::kDynamic)
+      static_cast<DynamicFontImage*>(font_image.Get())->EnableImageRetention(true);
+   m_SavedGlyphCounts[key] = CountGlyphs(font_image);
+   return font_image;
 }
 
-void ProgressHandler::SetProgressFunc(const std::function<string()>& getProgress)
+void Hud::SaveFontImageIfChanged(const string& key, const FontImagePtr& font_image)
 {
-   if (getProgress == nullptr)
-      m_Parent->m_GetProgressFunc = DefaultHandler;
-   else
-      m_Parent->m_GetProgressFunc = getProgress;
+   const size_t count = CountGlyphs(font_image);
+   size_t& saved_count = m_SavedGlyphCounts[key];
+   if (count != saved_count && m_FontManager->SaveFontImage(key, font_image))
+      saved_count = count;
 }
 
-ProgressHandler::ProgressHandler(ProgressHudItem* parent) :
-   m_Parent(parent)
+void Hud::BuildText(TextSpec& spec)
 {
-   //Begin by setting the parent processing handle to the default
-   m_Parent->m_GetProgressFunc = DefaultHandler;
+   const SharedLayoutPtr layout = m_LayoutCache->GetLayout(spec.builder->GetFont(), spec.text, spec.region);
+   if (layout && spec.builder->Build(*layout, ion::gfx::BufferObject::kStreamDraw))
+      SaveFontImageIfChanged(spec.font_image_key, spec.builder->GetFontImage());
 }
 
-string ProgressHandler::DefaultHandler() {
-   return "Loading";
-}
-
-ProgressHudItem::~ProgressHudItem() {}
-
-ProgressHandler ProgressHudItem::GetProgressHandler() {
-   return ProgressHandler(this);
-}
-
-bool ProgressHudItem::IsProcessingActive() const 
+size_t Hud::AddText(const FontImagePtr& font_image, const LayoutOptions& region, const string& text)
 {
-   return m_GetProgressFunc != nullptr;
+   size_t id = ion::base::kInvalidIndex;
+   if (font_image.Get()) { }
+   return id;
 }
 
-string ProgressHudItem::GetText() const 
-{
-   if (!IsProcessingActive() || m_GetProgressFunc == nullptr)
-      return "";
-
-   return m_GetProgressFunc();
-}
 //-----------------------------------------------------------------------------
 //
 // Hud class functions.
@@ -148,7 +137,8 @@ Hud::Hud(const FontManagerPtr& font_manager, const ion::gfxutils::ShaderManagerP
    m_Root(BuildHudRootNode(1, 1)),
    m_FontManager(font_manager),
    m_ShaderManager(shader_manager),
-   m_ViewportUniforms(viewportUniforms)
+   m_ViewportUniforms(viewportUniforms),
+   m_LayoutCache(new LayoutCache(64U))
 {
    SnapshotAssets::RegisterAssetsOnce();
 
@@ -165,6 +155,7 @@ Hud::Hud(const FontManagerPtr& font_manager, const ion::gfxutils::ShaderManagerP
       string text = "Loading";
 
       BasicBuilderPtr builder(new BasicBuilder(font_image, m_ShaderManager, ion::base::AllocatorPtr()));
+      builder->SetSkipUnchangedLayouts(true);
 
       const Layout layout = font_image->GetFont()->BuildLayout(text, region);
 
@@ -173,11 +164,14 @@ Hud::Hud(const FontManagerPtr& font_manager, const ion::gfxutils::ShaderManagerP
          //Must set the color after building
          builder->SetTextColor(Vector4f(0.0f, 0.0f, 0.0f, 1.0f));
 
+         SaveFontImageIfChanged("HUD Progress", font_image);
+
          TextSpec text_spec;
          text_spec.region = region;
          text_spec.text = text;
          text_spec.builder = builder;
          text_spec.node = builder->GetNode();
+         text_spec.font_image_key = "HUD Progress";
 
          m_ProgressItem = std::pair<ProgressHudItemPtr, TextSpec>(std::make_shared<ProgressHudItem>(""), text_spec);
 
@@ -205,6 +199,7 @@ size_t Hud::AddHudItem(const HudItemPtr& item)
       string text = item->GetText();
 
       BasicBuilderPtr builder(new BasicBuilder(font_image, m_ShaderManager, ion::base::AllocatorPtr()));
+      builder->SetSkipUnchangedLayouts(true);
 
       const Layout layout = font_image->GetFont()->BuildLayout(text, region);
 
@@ -213,11 +208,14 @@ size_t Hud::AddHudItem(const HudItemPtr& item)
          //Must set the color after building
          builder->SetTextColor(Vector4f(0.0f, 0.0f, 0.0f, 1.0f));
 
+         SaveFontImageIfChanged("HUD FPS", font_image);
+
          TextSpec text_spec;
          text_spec.region = region;
          text_spec.text = text;
          text_spec.builder = builder;
          text_spec.node = builder->GetNode();
+         text_spec.font_image_key = "HUD FPS";
 
          m_Items.push_back(std::pair<HudItemPtr, TextSpec>(item, text_spec));
 
@@ -233,7 +231,8 @@ size_t Hud::AddHudItem(const HudItemPtr& item)
 bool Hud::Update(double elapsedTimeInSec, double secSinceLastFrame)
 {
    //Get the width and height from the uniforms
-   const VectorBase2i& viewSize = m_ViewportUniforms->GetUniforms()[m_ViewportUniforms->GetUniformIndex(UNIFORM_GLOBAL_VIEWPORTSIZE)].GetValue<VectorBase2i>();
+   const VectorBase2i& viewSize = m_ViewportUniforms->GetUniforms()[m_ViewportUniforms->GetUniformIndex(ViewportSizeUniform)].GetValue<VectorBase2i>();
+   const Vector2i viewVec = Vector2i::ToVector(viewSize);
 
    //Set the enabled flag for all nodes
    bool processingActive = m_ProgressItem.first->IsProcessingActive();
@@ -248,13 +247,19 @@ bool Hud::Update(double elapsedTimeInSec, double secSinceLastFrame)
    if (m_ProgressItem.first->IsProcessingActive())
    {
       TextSpec& spec = m_ProgressItem.second;
-      LayoutOptions& region = spec.region;
 
-      int dotCount = (int)ceil(fmod(elapsedTimeInSec, 3.0));
+      const size_t dotCount = (size_t)ceil(fmod(elapsedTimeInSec, 3.0));
+      const string text = m_ProgressItem.first->GetText();
+
+      // The layout only depends on the text, the dots and the viewport.
+      if (text == spec.source_text && dotCount == spec.suffix_length && viewVec == spec.view_size)
+         return false;
 
-      spec.text = m_ProgressItem.first->GetText();
+      spec.source_text = text;
+      spec.suffix_length = dotCount;
+      spec.view_size = viewVec;
 
-      Lines lines = ion::base::SplitString(spec.text, "\n");
+      Lines lines = ion::base::SplitString(text, "\n");
 
       //Set the current point
       spec.region.target_point = Point2f(0.5f, 0.5f);
@@ -264,7 +269,7 @@ bool Hud::Update(double elapsedTimeInSec, double secSinceLastFrame)
       // Determine the size of the text.
       TextSize text_size = ComputeTextSize(*ftFont, spec.region, lines);
 
-      spec.text = m_ProgressItem.first->GetText() + std::string(dotCount, '.');
+      spec.text = text + std::string(dotCount, '.');
       lines = ion::base::SplitString(spec.text, "\n");
 
       TextSize text_size_with_dots = ComputeTextSize(*ftFont, spec.region, lines);
@@ -275,7 +280,7 @@ bool Hud::Update(double elapsedTimeInSec, double secSinceLastFrame)
 
       spec.region.target_point[0] += (spec.region.target_size[0] - sizeWithOutDots[0]) / 2.0f;
 
-      spec.builder->Build(spec.builder->GetFont()->BuildLayout(spec.text, spec.region), ion::gfx::BufferObject::kStreamDraw);
+      BuildText(spec);
 
       return false;
    }
@@ -290,24 +295,33 @@ bool Hud::Update(double elapsedTimeInSec, double secSinceLastFrame)
    for (size_t i = 0; i < numItems; ++i)
    {
       TextSpec& spec = m_Items[i].second;
-      LayoutOptions& region = spec.region;
 
-      spec.text = m_Items[i].first->GetText();
+      const string text = m_Items[i].first->GetText();
+      const Point2f origin(resetX, currPoint[1]);
+
+      // Unchanged items keep their layout, and so their position.
+      if (text != spec.source_text || viewVec != spec.view_size || origin != spec.origin)
+      {
+         spec.source_text = text;
+         spec.view_size = viewVec;
+         spec.origin = origin;
+         spec.text = text;
 
-      const Lines lines = ion::base::SplitString(spec.text, "\n");
+         const Lines lines = ion::base::SplitString(spec.text, "\n");
 
-      //Set the current point
-      spec.region.target_point = Point2f(resetX, currPoint[1]);
+         //Set the current point
+         spec.region.target_point = origin;
 
-      FreeTypeFont* ftFont = static_cast<FreeTypeFont *>(spec.builder->GetFont().Get());
+         FreeTypeFont* ftFont = static_cast<FreeTypeFont *>(spec.builder->GetFont().Get());
 
-      // Determine the size of the text.
-      TextSize text_size = ComputeTextSize(*ftFont, spec.region, lines);
+         // Determine the size of the text.
+         TextSize text_size = ComputeTextSize(*ftFont, spec.region, lines);
 
-      spec.region.target_size = Vector2f(text_size.rect_size_in_pixels[0] / viewSize[0], text_size.rect_size_in_pixels[1] / viewSize[1]);
-      spec.region.target_point[1] -= spec.region.target_size[1];
+         spec.region.target_size = Vector2f(text_size.rect_size_in_pixels[0] / viewSize[0], text_size.rect_size_in_pixels[1] / viewSize[1]);
+         spec.region.target_point[1] -= spec.region.target_size[1];
 
-      spec.builder->Build(spec.builder->GetFont()->BuildLayout(spec.text, spec.region), ion::gfx::BufferObject::kStreamDraw);
+         BuildText(spec);
+      }
 
       currPoint = spec.region.target_point;
    }
@@ -2,64 +2,11 @@
 
 #include "ion/base/referent.h"
 #include "IonFwd.h"
+#include <map>
 #include <memory>
+#include <string>
 #include "ion/text/layout.h"
-
-class ProgressHudItem;
-
-class HudItem
-{
-public:
-   virtual ~HudItem() {}
-   explicit HudItem(const std::string & startString);
-
-   void SetText(const std::string & text);
-   virtual std::string GetText() const;
-
-private:
-   std::string m_Text;
-};
-typedef std::shared_ptr<HudItem> HudItemPtr;
-
-class ProgressHandler
-{
-public:
-   ~ProgressHandler();
-
-   void SetProgressFunc(const std::function<std::string()> & getProgress);
-
-private:
-   friend class ProgressHudItem;
-
-   explicit ProgressHandler(ProgressHudItem * parent);
-
-   static std::string DefaultHandler();
-
-   ProgressHudItem * m_Parent;
-
-   std::function<std::string()> m_GetProgressFunc;
-};
-
-class ProgressHudItem : public HudItem
-{
-public:
-   explicit ProgressHudItem(const std::string& startString)
-      : HudItem(startString) {}
-
-   virtual ~ProgressHudItem() override;
-
-   ProgressHandler GetProgressHandler();
-
-   bool IsProcessingActive() const;
-
-   virtual std::string GetText() const override;
-
-private:
-   friend class ProgressHandler;
-
-   std::function<std::string()> m_GetProgressFunc;
-};
-typedef std::shared_ptr<ProgressHudItem> ProgressHudItemPtr;
+#include "HudItem.hpp"
 
 // This class implements a very simple HUD (heads-up display) for Ion demos.
 // Right now it provides just a simple frames-per-second display.
@@ -89,16 +36,37 @@ private:
       std::string text;
       ion::text::BasicBuilderPtr builder;
       ion::gfx::NodePtr node;
+
+      // The key of the FontImage used by the builder, under which its atlas
+      // is saved.
+      std::string font_image_key;
+
+      // The inputs of the last layout, used to skip relayout when the text,
+      // viewport and starting point are unchanged.
+      std::string source_text;
+      size_t suffix_length = 0;
+      ion::math::Vector2i view_size = ion::math::Vector2i::Zero();
+      ion::math::Point2f origin = ion::math::Point2f::Zero();
    };
 
+   // Lays out |spec| with the cached layout for its text and region and
+   // rebuilds its node, saving the atlas if new glyphs were added to it.
+   void BuildText(TextSpec& spec);
+
    // Initializes a font, returning a pointer to a Font. Logs a message and
    // returns a NULL pointer on error.
    ion::text::FontPtr InitFont(const std::string& font_name, size_t size_in_pixels, size_t sdf_padding) const;
 
-   // Initializes and returns a StaticFontImage that uses the given Font and
-   // GlyphSet. It caches it in the FontManager so that subsequent calls
-   // with the same key use the same instance.
-   const ion::text::FontImagePtr InitFontImage(const std::string& key, const ion::text::FontPtr& font) const;
+   // Initializes and returns a DynamicFontImage that uses the given Font. It
+   // caches it in the FontManager so that subsequent calls with the same key
+   // use the same instance, restoring the atlas saved by a previous run if
+   // there is one. The image data of the atlas is retained so that it can be
+   // saved again whenever glyphs are added to it.
+   const ion::text::FontImagePtr InitFontImage(const std::string& key, const ion::text::FontPtr& font);
+
+   // Saves the atlas of |font_image| under |key| if it holds more glyphs than
+   // when it was last saved or restored.
+   void SaveFontImageIfChanged(const std::string& key, const ion::text::FontImagePtr& font_image);
 
    // Adds a text string. The returned ID is used to identify the text in
    // subsequent calls to the TextHelper. Returns kInvalidIndex on error.
@@ -118,6 +86,13 @@ private:
    // Width and height of the HUD, which are used to manage fixed-size regions.
    ion::gfx::UniformBlockPtr m_ViewportUniforms;
 
+   // Caches the layouts of the HUD strings, which mostly repeat.
+   ion::text::LayoutCachePtr m_LayoutCache;
+
+   // The number of glyphs in each atlas when it was last saved or restored,
+   // by key.
+   std::map<std::string, size_t> m_SavedGlyphCounts;
+
    std::pair<ProgressHudItemPtr, TextSpec> m_ProgressItem;
 
    // Data for each text string added.
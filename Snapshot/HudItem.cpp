@@ -0,0 +1,59 @@
+#include "HudItem.hpp"
+
+using std::string;
+
+HudItem::HudItem(const string& startString):
+m_Text(startString){}
+
+void HudItem::SetText(const string& text) 
+{
+   m_Text = text;
+}
+
+string HudItem::GetText() const
+{
+   return m_Text;
+}
+
+ProgressHandler::~ProgressHandler() {
+//As we close, set the handle back to null
+   m_Parent->m_GetProgressFunc = nullptr;
+}
+
+void ProgressHandler::SetProgressFunc(const std::function<string()>& getProgress)
+{
+   if (getProgress == nullptr)
+      m_Parent->m_GetProgressFunc = DefaultHandler;
+   else
+      m_Parent->m_GetProgressFunc = getProgress;
+}
+
+ProgressHandler::ProgressHandler(ProgressHudItem* parent) :
+   m_Parent(parent)
+{
+   //Begin by setting the parent processing handle to the default
+   m_Parent->m_GetProgressFunc = DefaultHandler;
+}
+
+string ProgressHandler::DefaultHandler() {
+   return "Loading";
+}
+
+ProgressHudItem::~ProgressHudItem() {}
+
+ProgressHandler ProgressHudItem::GetProgressHandler() {
+   return ProgressHandler(this);
+}
+
+bool ProgressHudItem::IsProcessingActive() const 
+{
+   return m_GetProgressFunc != nullptr;
+}
+
+string ProgressHudItem::GetText() const 
+{
+   if (!IsProcessingActive() || m_GetProgressFunc == nullptr)
+      return "";
+
+   return m_GetProgressFunc();
+}
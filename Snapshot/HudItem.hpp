@@ -0,0 +1,61 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+class ProgressHudItem;
+
+class HudItem
+{
+public:
+   virtual ~HudItem() {}
+   explicit HudItem(const std::string & startString);
+
+   void SetText(const std::string & text);
+   virtual std::string GetText() const;
+
+private:
+   std::string m_Text;
+};
+typedef std::shared_ptr<HudItem> HudItemPtr;
+
+class ProgressHandler
+{
+public:
+   ~ProgressHandler();
+
+   void SetProgressFunc(const std::function<std::string()> & getProgress);
+
+private:
+   friend class ProgressHudItem;
+
+   explicit ProgressHandler(ProgressHudItem * parent);
+
+   static std::string DefaultHandler();
+
+   ProgressHudItem * m_Parent;
+
+   std::function<std::string()> m_GetProgressFunc;
+};
+
+class ProgressHudItem : public HudItem
+{
+public:
+   explicit ProgressHudItem(const std::string& startString)
+      : HudItem(startString) {}
+
+   virtual ~ProgressHudItem() override;
+
+   ProgressHandler GetProgressHandler();
+
+   bool IsProcessingActive() const;
+
+   virtual std::string GetText() const override;
+
+private:
+   friend class ProgressHandler;
+
+   std::function<std::string()> m_GetProgressFunc;
+};
+typedef std::shared_ptr<ProgressHudItem> ProgressHudItemPtr;
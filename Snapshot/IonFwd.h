@@ -20,6 +20,7 @@ class GraphicsManager;
 class Renderer;
 class Node;
 class BufferObject;
+class FramebufferObject;
 
 typedef base::ReferentPtr<GraphicsManager>::Type GraphicsManagerPtr;
 typedef base::ReferentPtr<Renderer>::Type RendererPtr;
@@ -27,6 +28,7 @@ typedef base::ReferentPtr<Node>::Type NodePtr;
 typedef base::ReferentPtr<UniformBlock>::Type UniformBlockPtr;
 typedef base::ReferentPtr<StateTable>::Type StateTablePtr;
 typedef base::ReferentPtr<BufferObject>::Type BufferObjectPtr;
+typedef base::ReferentPtr<FramebufferObject>::Type FramebufferObjectPtr;
 }
 
 namespace gfxutils{
@@ -42,11 +44,13 @@ class FontManager;
 class BasicBuilder;
 class Font;
 class FontImage;
+class LayoutCache;
 
 typedef base::ReferentPtr<FontManager>::Type FontManagerPtr;
 typedef base::ReferentPtr<BasicBuilder>::Type BasicBuilderPtr;
 typedef base::ReferentPtr<Font>::Type FontPtr;
 typedef base::ReferentPtr<FontImage>::Type FontImagePtr;
+typedef base::ReferentPtr<LayoutCache>::Type LayoutCachePtr;
 
 }
 
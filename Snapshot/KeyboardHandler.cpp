@@ -1,12 +1,13 @@
 #include "KeyboardHandler.hpp"
 #include "GLFW/glfw3.h"
-#include "ion/base/settingmanager.h"
 #include "Macros.h"
 #include "FileManager.hpp"
 #include "Camera.hpp"
 
 namespace Snapshot{
-KeyboardHandler::KeyboardHandler() {}
+KeyboardHandler::KeyboardHandler():
+   m_EpochIndex(SETTINGS_INPUT_EPOCH_INDEX)
+{}
 
 KeyboardHandler::~KeyboardHandler() {}
 
@@ -22,7 +23,7 @@ void KeyboardHandler::LeftArrow(int action)
       return;
 
    //Try to increment the epoch index if possible
-   auto setting = dynamic_cast<ion::base::Setting<uint32_t>*>(ion::base::SettingManager::GetSetting(SETTINGS_INPUT_EPOCH_INDEX));
+   auto setting = m_EpochIndex.GetSetting();
 
    if (setting != nullptr && setting->GetValue() > 0)
       setting->SetValue(setting->GetValue() - 1);
@@ -34,7 +35,7 @@ void KeyboardHandler::RightArrow(int action)
       return;
 
    //Try to increment the epoch index if possible
-   auto setting = dynamic_cast<ion::base::Setting<uint32_t>*>(ion::base::SettingManager::GetSetting(SETTINGS_INPUT_EPOCH_INDEX));
+   auto setting = m_EpochIndex.GetSetting();
 
    if (setting != nullptr && setting->GetValue() < m_FileManager->GetEpochs().size() - 1)
       setting->SetValue(setting->GetValue() + 1);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "IonFwd.h"
+#include "ion/base/settinghandle.h"
 
 class Camera;
 
@@ -23,5 +24,7 @@ public:
 private:
    std::shared_ptr<FileManager> m_FileManager;
    std::shared_ptr<Camera> m_Camera;
+
+   ion::base::SettingHandle<uint32_t> m_EpochIndex;
 };
 }
@@ -8,6 +8,11 @@
 #define SETTINGS_CONFIG_ALLTOALL_BIN_COUNT "Config/AllToAll/BinCount"
 #define SETTINGS_CONFIG_ALLTOALL_INITIAL_BIN_MULT "Config/AllToAll/InitialBinMultiplier"
 #define SETTINGS_CONFIG_ALLTOALL_MAX_BIN_TRIES "Config/AllToAll/MaxBinTries"
+#define SETTINGS_CONFIG_ALLTOALL_SAMPLING_USE "Config/AllToAll/Sampling/Use"
+#define SETTINGS_CONFIG_ALLTOALL_SAMPLING_RELATIVE_ERROR "Config/AllToAll/Sampling/RelativeError"
+#define SETTINGS_CONFIG_ALLTOALL_SAMPLING_CONFIDENCE "Config/AllToAll/Sampling/Confidence"
+#define SETTINGS_CONFIG_ALLTOALL_SAMPLING_BATCH_SIZE "Config/AllToAll/Sampling/BatchSize"
+#define SETTINGS_CONFIG_ALLTOALL_SAMPLING_MAX_PAIRS "Config/AllToAll/Sampling/MaxPairs"
 
 #define SETTINGS_SCENE_LOOKATCOM "Scene/LookAtCOM"
 #define SETTINGS_SCENE_SHOW_COM "Scene/ShowCOM"
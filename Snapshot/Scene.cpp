@@ -6,6 +6,7 @@
 #include "Macros.h"
 #include <ion/gfxutils/shapeutils.h>
 #include <ion/gfx/shaderinputregistry.h>
+#include <ion/gfx/uniformhandle.h>
 #include "Hud.hpp"
 #include <ion/text/fontmanager.h>
 #include <ion/gfxutils/buffertoattributebinder.h>
@@ -31,18 +32,19 @@ using namespace ion::text;
 
 namespace Snapshot{
 
+//Handles for the uniforms that are updated every frame or on setting changes
+static const UniformHandle CameraPositionUniform(UNIFORM_WORLD_CAMERAPOSITION);
+static const UniformHandle ModelviewMatrixUniform(UNIFORM_GLOBAL_MODELVIEWMATRIX);
+static const UniformHandle ModelMatrixUniform(UNIFORM_COMMON_MODELMATRIX);
+static const UniformHandle NormalMatrixUniform(UNIFORM_COMMON_NORMALMATRIX);
+
 Scene::Scene(KeyboardHandler& keyboard):
    SceneBase(),
    m_FileManager(std::make_shared<FileManager>()),
    m_InputFiles(SETTINGS_INPUT_FILES, vector<string>(), "Sets the relative files to load into the snapshot tool"),
 
    m_EpochIndex(SETTINGS_INPUT_EPOCH_INDEX, 0, "Sets index of the input files to display"),
-   m_HardBodyRadius(SETTINGS_CONFIG_HBR, .120f, "Sets the hard body radius between states in kilometers"),
    m_AllToAll_Use(SETTINGS_CONFIG_ALLTOALL_USE, false, "Determines whether to use One to One or All to All collisions"),
-   m_AllToAll_BinCount(SETTINGS_CONFIG_ALLTOALL_BIN_COUNT, 1000000, "Specifies the max number of bins to use in the X/Y/Z direction combined when calculating All-to-ALL"),
-   m_AllToAll_InitialBinMultiplier(SETTINGS_CONFIG_ALLTOALL_INITIAL_BIN_MULT, 1.0f, "If the All-to-All data falls outside the current bin boundary, the process must be restarted with a larger boundary. The initial value for the size of the boundary is determined by One-to-One boundary times this multiplier"),
-
-   m_AllToAll_MaxBinTries(SETTINGS_CONFIG_ALLTOALL_MAX_BIN_TRIES, 5, "If the All-to-All data falls outside the current bin boundary, the boundary size will be doubled and the process is restarted. This specifies the maximum number of times to restart the process before terminating"),
    m_LookAtCOM(SETTINGS_SCENE_LOOKATCOM, false, "Sets the focus point to the COM of the cluster"),
    m_ShowCOM(SETTINGS_SCENE_SHOW_COM, false, "Shows a secondary axes at the COM of the cluster. The size of the axes will be the size of the cluser bounding box"),
    m_AutoScale(SETTINGS_SCENE_AUTOSCALE, false, "Enables autoscaling the axes to evenly display data"),
@@ -58,7 +60,7 @@ Scene::Scene(KeyboardHandler& keyboard):
    m_InputFiles.RegisterListener("LoadInputFiles", [&](SettingBase* setting) { m_FileManager->SetFiles(static_cast<Setting<vector<string>>*>(setting)->GetValue()); });
    m_EpochIndex.RegisterListener("UpdateEpochIndex", [&](SettingBase* setting) { m_FileManager->SetEpochIndex(static_cast<Setting<uint32_t>*>(setting)->GetValue()); });
 
-   m_HardBodyRadius.RegisterListener("UpdateHBR", [&](SettingBase* setting) { m_FileManager->SetHbr(static_cast<Setting<float>*>(setting)->GetValue()); });
+   m_Config.HardBodyRadius.RegisterListener("UpdateHBR", [&](SettingBase* setting) { m_FileManager->SetHbr(static_cast<Setting<float>*>(setting)->GetValue()); });
    m_AllToAll_Use.RegisterListener("SetAllToAll", [&](SettingBase* setting) { m_FileManager->SetAllToAll(static_cast<Setting<bool>*>(setting)->GetValue()); });
 
    //m_LookAtCOM.RegisterListener("SetCenterOfMass", [&](SettingBase* setting) { ReloadPointData(); });
@@ -71,7 +73,7 @@ Scene::Scene(KeyboardHandler& keyboard):
    GetRoot()->AddChild(m_WorldRoot);
    GetRoot()->AddChild(m_HudRoot);
 
-   m_FileManager->SetHud(m_Hud);
+   m_FileManager->SetProgressHudItem(m_Hud->GetProgressHudItem());
 
    keyboard.Initialize(m_FileManager, GetCamera());
 }
@@ -90,7 +92,7 @@ bool Scene::Update(double elapsedTimeInSec, double secSinceLastFrame)
 
    auto pos = Vector3f((float)GetCamera()->PositionWorld()[0], (float)GetCamera()->PositionWorld()[1], (float)GetCamera()->PositionWorld()[2]);
 
-   m_WorldRoot->SetUniformByName(UNIFORM_WORLD_CAMERAPOSITION, pos);
+   m_WorldRoot->SetUniformByHandle(CameraPositionUniform, pos);
 
    return true;
 }
@@ -193,6 +195,10 @@ NodePtr Scene::BuildSimpleAxes(const ion::gfxutils::ShaderManagerPtr& shaderMana
 
    FontImagePtr font_image = GetFontManager()->GetCachedFontImage("Axes");
 
+   //Reuse the atlas built by a previous run if possible
+   if (!font_image.Get())
+      font_image = GetFontManager()->LoadFontImage("Axes", font);
+
    if (!font_image.Get())
    {
       GlyphSet glyph_set(AllocatorPtr(NULL));
@@ -208,6 +214,7 @@ NodePtr Scene::BuildSimpleAxes(const ion::gfxutils::ShaderManagerPtr& shaderMana
       else
       {
          GetFontManager()->CacheFontImage("Axes", sfi);
+         GetFontManager()->SaveFontImage("Axes", sfi);
          font_image = sfi;
       }
    }
@@ -355,7 +362,7 @@ NodePtr Scene::BuildWorldSceneGraph()
 
    hbr->SetShaderProgram(phongShader);
 
-   auto modelMat = ScaleMatrixH(Vector3f::Fill(2.0f * m_HardBodyRadius.GetValue()));
+   auto modelMat = ScaleMatrixH(Vector3f::Fill(2.0f * m_Config.HardBodyRadius.GetValue()));
 
    auto normalMat = Transpose(Inverse(NonhomogeneousSubmatrixH(modelMat)));
 
@@ -368,7 +375,7 @@ NodePtr Scene::BuildWorldSceneGraph()
    hbr->AddUniform(phongRegistry->Create<Uniform>(UNIFORM_WORLD_LIGHTSPECULAR, Vector3f(.1f, .1f, .1f)));
    hbr->AddUniform(worldRegistry->Create<Uniform>(UNIFORM_WORLD_LIGHTSPECULARINTENSITY, 16.0f));
 
-   m_HardBodyRadius.RegisterListener("UpdateHBRShape", [hbr](SettingBase* setting)
+   m_Config.HardBodyRadius.RegisterListener("UpdateHBRShape", [hbr](SettingBase* setting)
                                      {
                                         float newHBR = dynamic_cast<Setting<float>*>(setting)->GetValue();
 
@@ -376,9 +383,9 @@ NodePtr Scene::BuildWorldSceneGraph()
 
                                         auto normalMat = Transpose(Inverse(NonhomogeneousSubmatrixH(modelMat)));
 
-                                        hbr->SetUniformByName(UNIFORM_GLOBAL_MODELVIEWMATRIX, modelMat);
-                                        hbr->SetUniformByName(UNIFORM_COMMON_MODELMATRIX, modelMat);
-                                        hbr->SetUniformByName(UNIFORM_COMMON_NORMALMATRIX, normalMat);
+                                        hbr->SetUniformByHandle(ModelviewMatrixUniform, modelMat);
+                                        hbr->SetUniformByHandle(ModelMatrixUniform, modelMat);
+                                        hbr->SetUniformByHandle(NormalMatrixUniform, normalMat);
                                      });
 
    //ShaderInputRegistryPtr wireframeRegistry = ShaderInputRegistryPtr(new ShaderInputRegistry);
@@ -477,7 +484,12 @@ NodePtr Scene::BuildHudSceneGraph()
    auto pc = std::make_shared<HudItem>("Pc: 0.0");
    m_FileManager->AddPostProcessStep("Pc", [=](const SnapshotData& snapshot)
                                      {
-                                        pc->SetText("Pc: " + ion::base::ValueToString(snapshot.GetStats().Pc));
+                                        const SnapshotDataStats& stats = snapshot.GetStats();
+
+                                        if (stats.PcLower < stats.PcUpper)
+                                           pc->SetText("Pc: " + ion::base::ValueToString(stats.Pc) + " [" + ion::base::ValueToString(stats.PcLower) + ", " + ion::base::ValueToString(stats.PcUpper) + "]");
+                                        else
+                                           pc->SetText("Pc: " + ion::base::ValueToString(stats.Pc));
                                      });
    m_Hud->AddHudItem(pc);
 
@@ -491,7 +503,7 @@ NodePtr Scene::BuildHudSceneGraph()
 
    //HBR
    auto hbr = std::make_shared<HudItem>("HBR (km): 0.120");
-   m_HardBodyRadius.RegisterListener("HBR", [=](SettingBase* setting)
+   m_Config.HardBodyRadius.RegisterListener("HBR", [=](SettingBase* setting)
                                      {
                                         hbr->SetText("HBR (km): " + ion::base::ValueToString(static_cast<Setting<float>*>(setting)->GetValue()));
                                      });
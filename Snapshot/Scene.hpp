@@ -2,6 +2,7 @@
 
 #include "SceneBase.hpp"
 #include "ion/base/setting.h"
+#include "ConfigSettings.hpp"
 
 class Hud;
 
@@ -18,6 +19,8 @@ public:
 
    virtual bool Update(double elapsedTimeInSec, double secSinceLastFrame) override;
 
+   const std::shared_ptr<FileManager>& GetFileManager() const;
+
 protected:
    ion::gfx::NodePtr BuildSimpleAxes(const ion::gfxutils::ShaderManagerPtr& shaderManager);
 
@@ -44,11 +47,8 @@ private:
    ion::base::Setting<std::vector<std::string>> m_InputFiles;
    ion::base::Setting<uint32_t> m_EpochIndex;
 
-   ion::base::Setting<float> m_HardBodyRadius;
+   ConfigSettings m_Config;
    ion::base::Setting<bool> m_AllToAll_Use;
-   ion::base::Setting<uint32_t> m_AllToAll_BinCount;
-   ion::base::Setting<float> m_AllToAll_InitialBinMultiplier;
-   ion::base::Setting<uint32_t> m_AllToAll_MaxBinTries;
    
    ion::base::Setting<bool> m_LookAtCOM;
    ion::base::Setting<bool> m_ShowCOM;
@@ -57,4 +57,6 @@ private:
 
    ion::base::Setting<ion::math::Vector4ui> m_MissDistColor;
 };
+
+inline const std::shared_ptr<FileManager>& Scene::GetFileManager() const { return m_FileManager; }
 }
@@ -1,6 +1,7 @@
 #include "SceneBase.hpp"
 #include "ion/gfxutils/frame.h"
 #include "ion/gfx/graphicsmanager.h"
+#include "ion/gfx/programbinarycache.h"
 #include "ion/gfx/renderer.h"
 #include "ion/gfxutils/shadermanager.h"
 #include "Camera.hpp"
@@ -13,6 +14,8 @@
 #include "ion/remote/tracinghandler.h"
 #include "ion/remote/remoteserver.h"
 #include "ion/text/fontmanager.h"
+#include "ion/base/settingmanager.h"
+#include "ion/port/fileutils.h"
 
 using namespace ion::gfx;
 using namespace ion::gfxutils;
@@ -29,6 +32,14 @@ SceneBase::SceneBase():
 {
    GetGraphicsManager()->EnableErrorChecking(true);
 
+   //Keep built font atlases between runs so text setup does not have to
+   //rasterize and pack glyphs again
+   m_FontManager->SetFontImageCacheDirectory(ion::port::GetTemporaryDirectory());
+
+   //Keep linked shader program binaries between runs so the Flat, Phong, Point and text programs
+   //do not have to be compiled at startup
+   m_Renderer->SetProgramBinaryCache(ProgramBinaryCachePtr(new ProgramBinaryCache(ion::port::GetTemporaryDirectory())));
+
    //First create a root node
    m_Root = NodePtr(new Node());
    m_Root->SetLabel("Root");
@@ -56,12 +67,21 @@ SceneBase::SceneBase():
    m_Root->AddUniformBlock(m_Camera->GetViewportUniforms());
 
    InitRemoteHandlers(vector<NodePtr>(1, m_Root));
+
+   //Settings can be changed from the remote and worker threads. Queue their listeners so they only
+   //modify the scene from Update()
+   ion::base::SettingManager::SetNotificationsDeferred(true);
 }
 
-SceneBase::~SceneBase() {}
+SceneBase::~SceneBase()
+{
+   ion::base::SettingManager::SetNotificationsDeferred(false);
+}
 
 bool SceneBase::Update(double elapsedTimeInSec, double secSinceLastFrame)
 {
+   ion::base::SettingManager::DispatchDeferredNotifications();
+
    m_Camera->UpdateUniforms();
 
    return true;
@@ -18,6 +18,9 @@ public:
 
    const std::shared_ptr<Camera>& GetCamera() const;
 
+   // Returns the Renderer set up by the constructor.
+   const ion::gfx::RendererPtr& GetRenderer() const;
+
 protected:
    // Returns the Frame set up by the constructor.
    const ion::gfxutils::FramePtr& GetFrame() const;
@@ -25,9 +28,6 @@ protected:
    // Returns the GraphicsManager set up by the constructor.
    const ion::gfx::GraphicsManagerPtr& GetGraphicsManager() const;
 
-   // Returns the Renderer set up by the constructor.
-   const ion::gfx::RendererPtr& GetRenderer() const;
-
    // Returns the ShaderManager set up by the constructor.
    const ion::gfxutils::ShaderManagerPtr& GetShaderManager() const;
 
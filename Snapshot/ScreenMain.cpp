@@ -0,0 +1,54 @@
+// ScreenMain.cpp : Defines the entry point for the command line screening tool.
+//
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "ion/base/logging.h"
+#include "Screener.hpp"
+
+static void PrintUsage()
+{
+   std::cerr << "Usage: SnapshotScreen [--output <file>] [--format csv|json] [--memory <megabytes>]\n"
+                "                      [--set <setting>=<value>]... <files>...\n";
+}
+
+int main(int argc, char *argv[])
+{
+   //Load all of the arguments into a vector of strings
+   std::vector<std::string> arguments;
+
+   for (int i = 1; i < argc; i++)
+   {
+      arguments.push_back(argv[i]);
+   }
+
+   Snapshot::ScreeningOptions options;
+
+   try
+   {
+      options = Snapshot::ScreeningOptions::Parse(arguments);
+   }
+   catch (std::invalid_argument & ex)
+   {
+      std::cerr << ex.what() << "\n";
+      PrintUsage();
+      return EXIT_FAILURE;
+   }
+
+   try
+   {
+      Snapshot::Screener screener(options);
+
+      size_t screened = screener.Run();
+
+      return screened > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+   catch (std::exception & ex)
+   {
+      LOG(ERROR) << "Screening failed: \n" << ex.what();
+      return EXIT_FAILURE;
+   }
+}
@@ -0,0 +1,502 @@
+#include "Screener.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include "ion/base/logging.h"
+#include "ion/base/settingmanager.h"
+#include "ion/base/stringutils.h"
+#include "ion/base/taskscheduler.h"
+#include "ion/math/vectorutils.h"
+#include "ion/port/memory.h"
+#include "ion/port/timer.h"
+#include "HudItem.hpp"
+#include "Macros.h"
+
+using namespace ion::math;
+using namespace std;
+
+namespace Snapshot{
+
+static const char* const kStatsColumns[] = {"count", "pc", "pc_lower", "pc_upper", "min_miss",
+                                            "min_miss_v", "min_miss_n", "min_miss_b",
+                                            "bounds_min_v", "bounds_min_n", "bounds_min_b",
+                                            "bounds_max_v", "bounds_max_n", "bounds_max_b",
+                                            "com_v", "com_n", "com_b"};
+
+static double MissDistance(const SnapshotDataStats& stats)
+{
+   return Length(Vector3f::ToVector(stats.MinMiss));
+}
+
+static void WriteCsvStats(ostream& out, const SnapshotDataStats& stats)
+{
+   const Point3f& minMiss = stats.MinMiss;
+   const Point3f& boundsMin = stats.Bounds.GetMinPoint();
+   const Point3f& boundsMax = stats.Bounds.GetMaxPoint();
+   const Vector3f& com = stats.CenterOfMass;
+
+   out << stats.Count << ',' << stats.Pc << ',' << stats.PcLower << ',' << stats.PcUpper << ',' << MissDistance(stats);
+
+   for (int i = 0; i < 3; i++)
+      out << ',' << minMiss[i];
+   for (int i = 0; i < 3; i++)
+      out << ',' << boundsMin[i];
+   for (int i = 0; i < 3; i++)
+      out << ',' << boundsMax[i];
+   for (int i = 0; i < 3; i++)
+      out << ',' << com[i];
+}
+
+template <typename VectorType>
+static void WriteJsonArray(ostream& out, const VectorType& v)
+{
+   out << '[' << v[0] << ", " << v[1] << ", " << v[2] << ']';
+}
+
+//Writes the string as a quoted JSON string. Other control characters than the short escapes are
+//written as \u00XX, since JSON does not allow them unescaped
+static void WriteJsonString(ostream& out, const string& str)
+{
+   static const char* const kHexDigits = "0123456789abcdef";
+
+   out << '"';
+
+   for (size_t i = 0; i < str.size(); i++)
+   {
+      const unsigned char c = static_cast<unsigned char>(str[i]);
+
+      switch (c)
+      {
+      case '"':
+         out << "\\\"";
+         break;
+      case '\\':
+         out << "\\\\";
+         break;
+      case '\b':
+         out << "\\b";
+         break;
+      case '\f':
+         out << "\\f";
+         break;
+      case '\n':
+         out << "\\n";
+         break;
+      case '\r':
+         out << "\\r";
+         break;
+      case '\t':
+         out << "\\t";
+         break;
+      default:
+         if (c < 0x20)
+            out << "\\u00" << kHexDigits[c >> 4] << kHexDigits[c & 0xf];
+         else
+            out << str[i];
+         break;
+      }
+   }
+
+   out << '"';
+}
+
+static void WriteJsonStats(ostream& out, const SnapshotDataStats& stats)
+{
+   out << "{\"count\": " << stats.Count
+      << ", \"pc\": " << stats.Pc
+      << ", \"pc_lower\": " << stats.PcLower
+      << ", \"pc_upper\": " << stats.PcUpper
+      << ", \"min_miss\": " << MissDistance(stats)
+      << ", \"min_miss_vnb\": ";
+   WriteJsonArray(out, stats.MinMiss);
+   out << ", \"bounds_min\": ";
+   WriteJsonArray(out, stats.Bounds.GetMinPoint());
+   out << ", \"bounds_max\": ";
+   WriteJsonArray(out, stats.Bounds.GetMaxPoint());
+   out << ", \"center_of_mass\": ";
+   WriteJsonArray(out, stats.CenterOfMass);
+   out << '}';
+}
+
+ScreeningOptions::ScreeningOptions():
+   OutputFormat(kCsv),
+   MemoryBudget(1024 * 1024 * 1024) {}
+
+ScreeningOptions ScreeningOptions::Parse(const vector<string>& arguments)
+{
+   ScreeningOptions options;
+
+   for (size_t i = 0; i < arguments.size(); i++)
+   {
+      const string& arg = arguments[i];
+
+      if (arg.compare(0, 2, "--") != 0)
+      {
+         options.Files.push_back(arg);
+         continue;
+      }
+
+      if (i + 1 >= arguments.size())
+         throw invalid_argument("Missing value for " + arg);
+
+      const string& value = arguments[++i];
+
+      if (arg == "--output")
+      {
+         options.OutputFile = value;
+      }
+      else if (arg == "--format")
+      {
+         if (value == "csv")
+            options.OutputFormat = kCsv;
+         else if (value == "json")
+            options.OutputFormat = kJson;
+         else
+            throw invalid_argument("Expected csv or json for --format, got: " + value);
+      }
+      else if (arg == "--memory")
+      {
+         if (atoi(value.c_str()) <= 0)
+            throw invalid_argument("Expected a number of megabytes for --memory, got: " + value);
+
+         options.MemoryBudget = static_cast<size_t>(atoi(value.c_str())) * 1024 * 1024;
+      }
+      else if (arg == "--set")
+      {
+         size_t equals = value.find('=');
+
+         if (equals == string::npos)
+            throw invalid_argument("Expected <setting>=<value> for --set, got: " + value);
+
+         options.Settings.push_back(make_pair(value.substr(0, equals), value.substr(equals + 1)));
+      }
+      else
+      {
+         throw invalid_argument("Unknown option: " + arg);
+      }
+   }
+
+   if (options.Files.empty())
+      throw invalid_argument("No input files given");
+
+   return options;
+}
+
+EpochScreening::EpochScreening():
+   EpochIndex(0),
+   Epoch(0.0) {}
+
+Screener::StageTimes::StageTimes():
+   Index(0.0),
+   Read(0.0),
+   OneToOne(0.0),
+   AllToAll(0.0),
+   Write(0.0),
+   Total(0.0) {}
+
+Screener::Screener(const ScreeningOptions& options):
+   m_Options(options),
+   m_Output(&cout),
+   m_Group(nullptr),
+   m_EpochCount(0),
+   m_NextEpoch(0),
+   m_MemoryInFlight(0),
+   m_NextResult(0),
+   m_SuccessCount(0)
+{
+   if (!m_Options.OutputFile.empty())
+   {
+      m_File.reset(new ofstream(m_Options.OutputFile, ofstream::out | ofstream::trunc));
+
+      if (!m_File->is_open())
+         throw runtime_error("Unable to open output file: " + m_Options.OutputFile);
+
+      m_Output = m_File.get();
+   }
+
+   m_Output->precision(numeric_limits<double>::max_digits10);
+
+   //The screener decides when epochs are calculated
+   m_FileManager.SetAutoLoad(false);
+}
+
+Screener::~Screener() {}
+
+size_t Screener::Run()
+{
+   ion::port::Timer totalTimer;
+
+   for (auto iter = m_Options.Settings.cbegin(); iter != m_Options.Settings.cend(); ++iter)
+   {
+      auto* setting = ion::base::SettingManager::GetSetting(iter->first);
+
+      if (setting == nullptr || !setting->FromString(iter->second))
+         throw invalid_argument("Unable to set " + iter->first + " to " + iter->second);
+   }
+
+   m_FileManager.SetHbr(m_Config.HardBodyRadius.GetValue());
+
+   {
+      ProgressHudItem progressItem("");
+      auto progress = progressItem.GetProgressHandler();
+
+      ion::port::Timer indexTimer;
+      m_FileManager.LoadFiles(m_Options.Files, progress);
+      m_Times.Index = indexTimer.GetInS();
+   }
+
+   const size_t epochCount = m_FileManager.GetEpochCount();
+
+   LOG(INFO) << "Screening " << epochCount << " epochs with a memory budget of "
+      << m_Options.MemoryBudget / (1024 * 1024) << " MB";
+
+   WriteHeader();
+
+   ion::base::TaskScheduler::TaskGroup group(ion::base::TaskScheduler::GetDefault(), "ScreenEpoch");
+
+   m_Group = &group;
+   m_EpochCount = epochCount;
+
+   //Only the epochs that fit into the budget are started here. Each finished epoch starts the
+   //next ones, so this thread never blocks on memory and runs epochs in Wait() like the workers
+   StartEpochs();
+
+   group.Wait();
+   m_Group = nullptr;
+
+   WriteFooter();
+   m_Output->flush();
+
+   m_Times.Total = totalTimer.GetInS();
+
+   LogTimes();
+
+   return m_SuccessCount;
+}
+
+void Screener::ScreenEpoch(size_t epochIndex, size_t cost)
+{
+   EpochScreening result;
+   result.EpochIndex = epochIndex;
+   result.Epoch = m_FileManager.GetEpochInfo(epochIndex).Epoch;
+
+   double readTime = 0.0;
+   double oneToOneTime = 0.0;
+   double allToAllTime = 0.0;
+
+   //Each epoch gets its own item, since the progress functions are not shared between threads
+   ProgressHudItem progressItem("");
+
+   try
+   {
+      auto progress = progressItem.GetProgressHandler();
+
+      ion::port::Timer timer;
+      m_FileManager.LoadEpoch(epochIndex, progress);
+      readTime = timer.GetInS();
+
+      timer.Reset();
+      result.OneToOne = m_FileManager.CalcEpochStats(epochIndex, false, progress);
+      oneToOneTime = timer.GetInS();
+
+      //Reuses the One-to-One diffs cached by the previous call
+      timer.Reset();
+      result.AllToAll = m_FileManager.CalcEpochStats(epochIndex, true, progress);
+      allToAllTime = timer.GetInS();
+   } catch (std::exception& ex)
+   {
+      result.Error = ex.what();
+   }
+
+   m_FileManager.ReleaseEpoch(epochIndex);
+   ReleaseMemory(cost);
+   StartEpochs();
+
+   {
+      lock_guard<mutex> lock(m_ResultMutex);
+
+      m_Times.Read += readTime;
+      m_Times.OneToOne += oneToOneTime;
+      m_Times.AllToAll += allToAllTime;
+   }
+
+   AddResult(result);
+}
+
+size_t Screener::EstimateCost(size_t epochIndex) const
+{
+   const EpochInfo& info = m_FileManager.GetEpochInfo(epochIndex);
+
+   size_t aCount = info.StateACount;
+   size_t bCount = info.StateBCount;
+   size_t binCount = m_Config.AllToAll_BinCount.GetValue();
+
+   //Reading parses the states and keeps a VNB frame and a position per state of A, and a position
+   //per state of B
+   size_t read = (aCount + bCount) * sizeof(State) + aCount * (sizeof(Matrix3d) + sizeof(Point3d)) + bCount * sizeof(Point3d);
+
+   //One-to-One has a diff per state. All-to-All fills a grid of bins and keeps a diff per bin that
+   //was hit, of which there cannot be more than there are pairs. Sampling instead keeps a batch of
+   //pairs and up to the bin count of them to display
+   size_t oneToOne = aCount * sizeof(DiffPoint);
+   size_t allToAll = binCount * sizeof(uint32_t) + min(binCount, aCount * bCount) * sizeof(DiffPoint);
+
+   if (m_Config.AllToAll_Sampling_Use.GetValue())
+      allToAll = (min(binCount, aCount * bCount) + m_Config.AllToAll_Sampling_BatchSize.GetValue()) * sizeof(DiffPoint);
+
+   return read + oneToOne + allToAll;
+}
+
+void Screener::StartEpochs()
+{
+   vector<pair<size_t, size_t>> started;
+
+   {
+      lock_guard<mutex> lock(m_MemoryMutex);
+
+      while (m_NextEpoch < m_EpochCount)
+      {
+         size_t cost = EstimateCost(m_NextEpoch);
+
+         //An epoch that is larger than the whole budget still runs, but only on its own
+         if (m_MemoryInFlight != 0 && m_MemoryInFlight + cost > m_Options.MemoryBudget)
+            break;
+
+         m_MemoryInFlight += cost;
+         started.push_back(make_pair(m_NextEpoch++, cost));
+      }
+   }
+
+   for (auto iter = started.cbegin(); iter != started.cend(); ++iter)
+   {
+      size_t epochIndex = iter->first;
+      size_t cost = iter->second;
+
+      m_Group->Run([this, epochIndex, cost]()
+                   {
+                      ScreenEpoch(epochIndex, cost);
+                   });
+   }
+}
+
+void Screener::ReleaseMemory(size_t cost)
+{
+   lock_guard<mutex> lock(m_MemoryMutex);
+
+   m_MemoryInFlight -= cost;
+}
+
+void Screener::AddResult(const EpochScreening& result)
+{
+   lock_guard<mutex> lock(m_ResultMutex);
+
+   ion::port::Timer timer;
+
+   m_PendingResults[result.EpochIndex] = result;
+
+   //Write everything that no longer waits for an earlier epoch
+   auto iter = m_PendingResults.begin();
+
+   while (iter != m_PendingResults.end() && iter->first == m_NextResult)
+   {
+      WriteResult(iter->second);
+
+      iter = m_PendingResults.erase(iter);
+      ++m_NextResult;
+   }
+
+   m_Times.Write += timer.GetInS();
+}
+
+void Screener::WriteHeader()
+{
+   if (m_Options.OutputFormat == ScreeningOptions::kJson)
+   {
+      *m_Output << "[";
+      return;
+   }
+
+   *m_Output << "epoch_index,epoch";
+
+   const char* const prefixes[] = {"one_to_one_", "all_to_all_"};
+
+   for (size_t i = 0; i < 2; i++)
+   {
+      for (size_t j = 0; j < sizeof(kStatsColumns) / sizeof(kStatsColumns[0]); j++)
+         *m_Output << ',' << prefixes[i] << kStatsColumns[j];
+   }
+
+   *m_Output << ",error\n";
+}
+
+void Screener::WriteResult(const EpochScreening& result)
+{
+   ostream& out = *m_Output;
+
+   if (result.Error.empty())
+      ++m_SuccessCount;
+   else
+      LOG(ERROR) << "Error screening epoch " << result.EpochIndex << ": " << result.Error;
+
+   if (m_Options.OutputFormat == ScreeningOptions::kJson)
+   {
+      out << (result.EpochIndex == 0 ? "\n" : ",\n");
+      out << "  {\"epoch_index\": " << result.EpochIndex << ", \"epoch\": " << result.Epoch;
+
+      if (result.Error.empty())
+      {
+         out << ",\n   \"one_to_one\": ";
+         WriteJsonStats(out, result.OneToOne);
+         out << ",\n   \"all_to_all\": ";
+         WriteJsonStats(out, result.AllToAll);
+      }
+      else
+      {
+         out << ", \"error\": ";
+         WriteJsonString(out, result.Error);
+      }
+
+      out << '}';
+      return;
+   }
+
+   out << result.EpochIndex << ',' << result.Epoch;
+
+   if (result.Error.empty())
+   {
+      out << ',';
+      WriteCsvStats(out, result.OneToOne);
+      out << ',';
+      WriteCsvStats(out, result.AllToAll);
+      out << ",\n";
+   }
+   else
+   {
+      //Leave the stats empty and quote the error, which may contain commas
+      for (size_t i = 0; i < 2 * sizeof(kStatsColumns) / sizeof(kStatsColumns[0]); i++)
+         out << ',';
+
+      out << ",\"" << ion::base::ReplaceString(ion::base::EscapeNewlines(result.Error), "\"", "\"\"") << "\"\n";
+   }
+}
+
+void Screener::WriteFooter()
+{
+   if (m_Options.OutputFormat == ScreeningOptions::kJson)
+      *m_Output << "\n]\n";
+}
+
+void Screener::LogTimes() const
+{
+   LOG(INFO) << "Screened " << m_SuccessCount << " of " << m_NextResult << " epochs in " << m_Times.Total << " s"
+      << "\n   Index: " << m_Times.Index << " s"
+      << "\n   Read: " << m_Times.Read << " s"
+      << "\n   One-to-One: " << m_Times.OneToOne << " s"
+      << "\n   All-to-All: " << m_Times.AllToAll << " s"
+      << "\n   Write: " << m_Times.Write << " s"
+      << "\n   (Read, One-to-One and All-to-All are summed over " << ion::base::TaskScheduler::GetDefault()->GetThreadCount() + 1 << " threads)"
+      << "\nPeak memory: " << ion::port::GetProcessPeakResidentMemorySize() / (1024 * 1024) << " MB";
+}
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ion/base/setting.h"
+#include "ion/base/taskscheduler.h"
+#include "ConfigSettings.hpp"
+#include "FileManager.hpp"
+
+namespace Snapshot{
+
+//The command line options for screening without a window:
+//
+//   SnapshotScreen [--output <file>] [--format csv|json] [--memory <megabytes>]
+//                  [--set <setting>=<value>]... <files>...
+//
+//One-to-One and All-to-All stats of every epoch of the files are written to <file>, or to stdout
+//if no file is given. --memory bounds the memory used by the epochs that are calculated at the
+//same time. --set changes any of the Config/ settings, e.g. --set Config/HardBodyRadius=0.02
+struct ScreeningOptions
+{
+   enum Format
+   {
+      kCsv,
+      kJson
+   };
+
+   ScreeningOptions();
+
+   //Parses the arguments. Throws std::invalid_argument if they are malformed
+   static ScreeningOptions Parse(const std::vector<std::string> & arguments);
+
+   std::vector<std::string> Files;
+   std::string OutputFile;
+   Format OutputFormat;
+   size_t MemoryBudget;
+   std::vector<std::pair<std::string, std::string>> Settings;
+};
+
+//The result of screening a single epoch
+struct EpochScreening
+{
+   EpochScreening();
+
+   size_t EpochIndex;
+   double Epoch;
+   SnapshotDataStats OneToOne;
+   SnapshotDataStats AllToAll;
+   std::string Error;
+};
+
+//Calculates the stats of every epoch without a window. The files are only indexed up front, and
+//each epoch is read, calculated and released by a task on the default TaskScheduler. Epochs are
+//calculated in parallel as long as the estimated memory of the epochs in flight stays within the
+//budget, so files larger than the memory can be screened. Results are written in epoch order as
+//soon as they are available
+class Screener
+{
+public:
+   explicit Screener(const ScreeningOptions & options);
+   ~Screener();
+
+   //Screens all epochs. Returns the number of epochs that were screened without errors
+   size_t Run();
+
+private:
+   //The time spent in each stage. The calculation stages are summed over all threads
+   struct StageTimes
+   {
+      StageTimes();
+
+      double Index;
+      double Read;
+      double OneToOne;
+      double AllToAll;
+      double Write;
+      double Total;
+   };
+
+   void ScreenEpoch(size_t epochIndex, size_t cost);
+
+   //Returns the estimated memory in bytes needed to screen the epoch
+   size_t EstimateCost(size_t epochIndex) const;
+
+   //Reserves memory for and starts the next epochs in order, as long as they fit into the budget
+   void StartEpochs();
+   void ReleaseMemory(size_t cost);
+
+   //Queues the result and writes all results that are next in epoch order
+   void AddResult(const EpochScreening & result);
+
+   void WriteHeader();
+   void WriteResult(const EpochScreening & result);
+   void WriteFooter();
+
+   void LogTimes() const;
+
+   ScreeningOptions m_Options;
+
+   //The settings used by the calculations, so that they can be changed with --set
+   ConfigSettings m_Config;
+
+   FileManager m_FileManager;
+
+   std::unique_ptr<std::ofstream> m_File;
+   std::ostream * m_Output;
+
+   //The group of the epochs being screened, valid during Run()
+   ion::base::TaskScheduler::TaskGroup * m_Group;
+   size_t m_EpochCount;
+
+   //Memory budget and the next epoch to start
+   std::mutex m_MemoryMutex;
+   size_t m_NextEpoch;
+   size_t m_MemoryInFlight;
+
+   //Results waiting for earlier epochs to finish
+   std::mutex m_ResultMutex;
+   std::map<size_t, EpochScreening> m_PendingResults;
+   size_t m_NextResult;
+   size_t m_SuccessCount;
+
+   StageTimes m_Times;
+};
+}
@@ -47,13 +47,19 @@
         'demo_class_name': 'Snapshot'
       },
       'sources': [
+        'BatchExporter.cpp',
+        'BatchExporter.hpp',
         'Camera.cpp',
         'Camera.hpp',
+        'ConfigSettings.cpp',
+        'ConfigSettings.hpp',
         'FileManager.cpp',
         'FileManager.hpp',
         'FinalAction.hpp',
         'Hud.cpp',
         'Hud.hpp',
+        'HudItem.cpp',
+        'HudItem.hpp',
         'IonFwd.h',
         'KeyboardHandler.cpp',
         'KeyboardHandler.hpp',
@@ -97,6 +103,38 @@
       ],
     },
 
+    {
+      # Screens the epochs of the input files from the command line, without a
+      # window or a GL context.
+      'target_name': 'SnapshotScreen',
+      'type': 'executable',
+      'sources': [
+        'ConfigSettings.cpp',
+        'ConfigSettings.hpp',
+        'FileManager.cpp',
+        'FileManager.hpp',
+        'FinalAction.hpp',
+        'HudItem.cpp',
+        'HudItem.hpp',
+        'IonFwd.h',
+        'Macros.h',
+        'ScreenMain.cpp',
+        'Screener.cpp',
+        'Screener.hpp',
+      ],
+      'dependencies': [
+        '<(ion_dir)/base/base.gyp:ionbase',
+        '<(ion_dir)/math/math.gyp:ionmath',
+        '<(ion_dir)/port/port.gyp:ionport',
+      ],
+      'msvs_settings': {
+        'VCCLCompilerTool': {
+          'OpenMP': 'true',
+          'EnableEnhancedInstructionSet': '3', # AdvancedVectorExtensions
+        }
+      },
+    },  # target: SnapshotScreen
+
     {
       'target_name': 'SnapshotInstaller',
       'type': 'wix_installer',
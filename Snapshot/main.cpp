@@ -8,6 +8,7 @@
 #include <vector>
 #include "FinalAction.hpp"
 #include "ion/base/staticsafedeclare.h"
+#include "BatchExporter.hpp"
 
 using namespace Snapshot::Util;
 
@@ -27,6 +28,25 @@ static void window_refresh_callback(GLFWwindow* window);
 
 static Snapshot::Window * _Window = nullptr;
 
+static int RunBatchExport(const std::vector<std::string>& arguments)
+{
+   try
+   {
+      Snapshot::BatchExporter exporter(Snapshot::BatchExportOptions::Parse(arguments));
+
+      size_t written = exporter.Run();
+
+      LOG(INFO) << "Wrote " << written << " images";
+
+      return written > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+   catch (std::exception & ex)
+   {
+      LOG(ERROR) << "Batch export failed: \n" << ex.what();
+      return EXIT_FAILURE;
+   }
+}
+
 void SetCallbacks(Snapshot::Window * window)
 {
    GLFWwindow * windowPtr = window->GetGlfwPtr();
@@ -57,6 +77,10 @@ int main(int argc, char *argv[])
       arguments.push_back(argv[i]);
    }
 
+   //Render every epoch to files without opening a window
+   if (Snapshot::BatchExportOptions::IsRequested(arguments))
+      return RunBatchExport(arguments);
+
    if (!glfwInit())
       exit(EXIT_FAILURE);
 
@@ -143,15 +143,9 @@ static inline ion::text::FontPtr InitFont(
   ion::text::FontPtr font =
       font_manager->FindFont(font_name, size_in_pixels, sdf_padding);
   if (!font.Get()) {
-    // Read the font data.
-    const std::string& data =
-        ion::base::ZipAssetManager::GetFileData(font_name + ".ttf");
-    if (ion::base::IsInvalidReference(data) || data.empty()) {
-      LOG(ERROR) << "Unable to read data for font \"" << font_name << "\"";
-    } else {
-      font = font_manager->AddFont(
-          font_name, size_in_pixels, sdf_padding, &data[0], data.size());
-    }
+    // The font keeps the zipasset data alive while it references it.
+    font = font_manager->AddFontFromZipasset(font_name, font_name,
+                                             size_in_pixels, sdf_padding);
   }
   return font;
 }
@@ -54,6 +54,7 @@
         'invalid.cc',
         'invalid.h',
         'lockguards.h',
+        'lrucache.h',
         'logchecker.cc',
         'logchecker.h',
         'logging.cc',
@@ -72,6 +73,7 @@
         'setting.cc',
         'setting.h',
         'settingmanager.cc',
+        'settinghandle.h',
         'settingmanager.h',
         'shareable.h',
         'sharedptr.h',
@@ -82,6 +84,8 @@
         'staticsafedeclare.h',
         'stringutils.cc',
         'stringutils.h',
+        'taskscheduler.cc',
+        'taskscheduler.h',
         'threadspawner.cc',
         'threadspawner.h',
         'type_structs.h',
@@ -0,0 +1,135 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef ION_BASE_LRUCACHE_H_
+#define ION_BASE_LRUCACHE_H_
+
+#include <functional>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+
+#include "base/macros.h"
+#include "ion/base/logging.h"
+
+namespace ion {
+namespace base {
+
+// LruCache maps keys to values and evicts the least recently used entries once
+// the total cost of its entries exceeds a budget. Each entry has a cost, which
+// is 1 by default so that the budget is a number of entries, but may be, e.g.,
+// a size in bytes. Looking up an entry makes it the most recently used one.
+// LruCache is not thread-safe; callers that share one between threads must
+// serialize access to it.
+template <typename Key, typename Value, typename Hash = std::hash<Key> >
+class LruCache {
+ public:
+  explicit LruCache(size_t budget) : budget_(budget), size_(0U) {}
+
+  // Returns a pointer to the value for |key|, making it the most recently used
+  // entry, or NULL if there is no entry for |key|. The pointer is valid until
+  // the entry is removed.
+  Value* Find(const Key& key) {
+    typename EntryMap::iterator it = entry_map_.find(key);
+    if (it == entry_map_.end())
+      return NULL;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &it->second->value;
+  }
+
+  // Returns whether there is an entry for |key|, without changing the order
+  // of the entries.
+  bool Contains(const Key& key) const {
+    return entry_map_.find(key) != entry_map_.end();
+  }
+
+  // Adds |value| as the most recently used entry for |key|, replacing any
+  // existing entry, and evicts least recently used entries until the total
+  // cost is within the budget. An entry whose cost exceeds the budget is not
+  // added.
+  void Insert(const Key& key, const Value& value, size_t cost = 1U) {
+    typename EntryMap::iterator it = entry_map_.find(key);
+    if (it != entry_map_.end())
+      Remove(it->second);
+    if (cost > budget_)
+      return;
+    entries_.push_front(Entry(key, value, cost));
+    entry_map_[key] = entries_.begin();
+    size_ += cost;
+    Evict();
+  }
+
+  // Sets/returns the maximum total cost of the entries. Reducing the budget
+  // evicts entries immediately. A budget of zero disables caching.
+  void SetBudget(size_t budget) {
+    budget_ = budget;
+    Evict();
+  }
+  size_t GetBudget() const { return budget_; }
+
+  // Returns the total cost of the entries.
+  size_t GetSize() const { return size_; }
+  // Returns the number of entries.
+  size_t GetEntryCount() const { return entries_.size(); }
+
+  // Removes all entries.
+  void Clear() {
+    entry_map_.clear();
+    entries_.clear();
+    size_ = 0U;
+  }
+
+ private:
+  struct Entry {
+    Entry(const Key& key_in, const Value& value_in, size_t cost_in)
+        : key(key_in), value(value_in), cost(cost_in) {}
+    Key key;
+    Value value;
+    size_t cost;
+  };
+  typedef std::list<Entry> EntryList;
+  typedef std::unordered_map<Key, typename EntryList::iterator, Hash> EntryMap;
+
+  // Removes the entry |it| refers to.
+  void Remove(typename EntryList::iterator it) {
+    size_ -= it->cost;
+    entry_map_.erase(it->key);
+    entries_.erase(it);
+  }
+
+  // Evicts least recently used entries until the total cost is within the
+  // budget.
+  void Evict() {
+    while (size_ > budget_) {
+      DCHECK(!entries_.empty());
+      Remove(std::prev(entries_.end()));
+    }
+  }
+
+  // Entries in most recently used order.
+  EntryList entries_;
+  // Maps keys to their entries.
+  EntryMap entry_map_;
+  size_t budget_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(LruCache);
+};
+
+}  // namespace base
+}  // namespace ion
+
+#endif  // ION_BASE_LRUCACHE_H_
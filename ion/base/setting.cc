@@ -17,6 +17,7 @@ limitations under the License.
 
 #include "ion/base/setting.h"
 
+#include "ion/base/lockguards.h"
 #include "ion/base/settingmanager.h"
 
 namespace ion {
@@ -34,26 +35,70 @@ SettingBase::~SettingBase() {
 
 void SettingBase::RegisterListener(const std::string& key,
                                    const Listener& listener) {
-  listeners_[key] = ListenerInfo(listener, true);
+  LockGuard lock(&listeners_mutex_);
+  std::shared_ptr<ListenerMap> listeners = CopyListenersLocked();
+  (*listeners)[key] = ListenerInfo(listener, true);
+  std::atomic_store(&listeners_,
+                    std::shared_ptr<const ListenerMap>(listeners));
+}
+
+void SettingBase::RegisterImmediateListener(const std::string& key,
+                                            const Listener& listener) {
+  LockGuard lock(&listeners_mutex_);
+  std::shared_ptr<ListenerMap> listeners = CopyListenersLocked();
+  (*listeners)[key] = ListenerInfo(listener, true, true);
+  std::atomic_store(&listeners_,
+                    std::shared_ptr<const ListenerMap>(listeners));
 }
 
 void SettingBase::EnableListener(const std::string& key, bool enable) {
-  ListenerMap::iterator it = listeners_.find(key);
-  if (it != listeners_.end())
-    it->second.enabled = enable;
+  LockGuard lock(&listeners_mutex_);
+  if (!listeners_ || listeners_->find(key) == listeners_->end())
+    return;
+  std::shared_ptr<ListenerMap> listeners = CopyListenersLocked();
+  (*listeners)[key].enabled = enable;
+  std::atomic_store(&listeners_,
+                    std::shared_ptr<const ListenerMap>(listeners));
 }
 
 void SettingBase::UnregisterListener(const std::string& key) {
-  listeners_.erase(key);
+  LockGuard lock(&listeners_mutex_);
+  if (!listeners_ || listeners_->find(key) == listeners_->end())
+    return;
+  std::shared_ptr<ListenerMap> listeners = CopyListenersLocked();
+  listeners->erase(key);
+  std::atomic_store(&listeners_,
+                    listeners->empty()
+                        ? std::shared_ptr<const ListenerMap>()
+                        : std::shared_ptr<const ListenerMap>(listeners));
 }
 
 void SettingBase::NotifyListeners() {
-  for (ListenerMap::const_iterator it = listeners_.begin();
-       it != listeners_.end(); ++it) {
-    if (it->second.enabled)
+  CallListeners(true);
+  if (!SettingManager::DeferNotification(this))
+    CallListeners(false);
+}
+
+void SettingBase::CallListeners(bool immediate) {
+  // Call the current listeners without holding the lock; a listener may
+  // register or unregister listeners itself, which replaces the map rather
+  // than changing the one being iterated.
+  const std::shared_ptr<const ListenerMap> listeners =
+      std::atomic_load(&listeners_);
+  if (!listeners)
+    return;
+  for (ListenerMap::const_iterator it = listeners->begin();
+       it != listeners->end(); ++it) {
+    if (it->second.enabled && it->second.immediate == immediate)
       it->second.listener(this);
   }
 }
 
+std::shared_ptr<SettingBase::ListenerMap> SettingBase::CopyListenersLocked()
+    const {
+  return listeners_ ? std::make_shared<ListenerMap>(*listeners_)
+                    : std::make_shared<ListenerMap>();
+}
+
 }  // namespace base
 }  // namespace ion
@@ -20,6 +20,7 @@ limitations under the License.
 
 #include <functional>
 #include <map>
+#include <memory>
 #include <sstream>
 #include <string>
 
@@ -30,6 +31,7 @@ limitations under the License.
 #include "ion/base/stringutils.h"
 #include "ion/port/atomic.h"
 #include "ion/port/environment.h"
+#include "ion/port/mutex.h"
 
 namespace ion {
 namespace base {
@@ -45,11 +47,16 @@ class ION_API SettingBase {
   // A function that is called when the value changes.
   typedef std::function<void(SettingBase* setting)> Listener;
   struct ListenerInfo {
-    ListenerInfo() : enabled(false) {}
+    ListenerInfo() : enabled(false), immediate(false) {}
     ListenerInfo(const Listener& listener_in, bool enabled_in)
-        : listener(listener_in), enabled(enabled_in) {}
+        : listener(listener_in), enabled(enabled_in), immediate(false) {}
+    ListenerInfo(const Listener& listener_in, bool enabled_in,
+                 bool immediate_in)
+        : listener(listener_in), enabled(enabled_in), immediate(immediate_in) {}
     Listener listener;
     bool enabled;
+    // Immediate listeners are never deferred (see RegisterImmediateListener()).
+    bool immediate;
   };
 
   // Returns the name associated with this.
@@ -69,12 +76,21 @@ class ION_API SettingBase {
   // function is identified by the passed key. The same key must be used to
   // remove the listener.
   void RegisterListener(const std::string& key, const Listener& listener);
+  // Same as RegisterListener(), but the function is always called on the
+  // thread that changes the value, even if SettingManager defers
+  // notifications. Immediate listeners should therefore be cheap and
+  // thread-safe; they are intended for mirroring values (see SettingHandle).
+  void RegisterImmediateListener(const std::string& key,
+                                 const Listener& listener);
   // Enables or disables the listener identified by key, if one exists.
   void EnableListener(const std::string& key, bool enable);
   // Removes the listener identified by key, if one exists.
   void UnregisterListener(const std::string& key);
 
-  // Notify listeners that this setting has changed.
+  // Notify listeners that this setting has changed. Immediate listeners are
+  // called right away; the others are called right away unless the
+  // SettingManager defers notifications, in which case they are called by
+  // SettingManager::DispatchDeferredNotifications().
   void NotifyListeners();
 
   // Returns a string version of this setting. The same string may be passed to
@@ -94,10 +110,25 @@ class ION_API SettingBase {
  private:
   typedef std::map<std::string, ListenerInfo> ListenerMap;
 
+  // Calls all enabled listeners, either immediate or not.
+  void CallListeners(bool immediate);
+  // Returns a copy of the current listeners that can be modified and then
+  // published with std::atomic_store(). Assumes |listeners_mutex_| is held.
+  std::shared_ptr<ListenerMap> CopyListenersLocked() const;
+
   std::string name_;
   std::string doc_string_;
   std::string type_descriptor_;
-  ListenerMap listeners_;
+  // The registered listeners, or NULL if there are none. The map is never
+  // modified once it is published, but replaced by a modified copy, so that
+  // CallListeners() can call the listeners without copying them or holding a
+  // lock. It is replaced with std::atomic_store() while |listeners_mutex_| is
+  // held and read with std::atomic_load() elsewhere.
+  std::shared_ptr<const ListenerMap> listeners_;
+  // Serializes changes to |listeners_|, which may be made on one thread (for
+  // example by a SettingHandle that resolves) while the value changes on
+  // another.
+  port::Mutex listeners_mutex_;
 
   // Holds on to a reference to SettingData. We don't need to access it
   // directly through this pointer, just keep it alive.
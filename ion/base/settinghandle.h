@@ -0,0 +1,174 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef ION_BASE_SETTINGHANDLE_H_
+#define ION_BASE_SETTINGHANDLE_H_
+
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/integral_types.h"
+#include "base/macros.h"
+#include "ion/base/lockguards.h"
+#include "ion/base/setting.h"
+#include "ion/base/settingmanager.h"
+#include "ion/base/shareable.h"
+#include "ion/base/sharedptr.h"
+#include "ion/port/mutex.h"
+
+namespace ion {
+namespace base {
+
+// A SettingHandle provides fast, thread-safe read access to the value of the
+// Setting<T> with a given name. Instead of calling SettingManager::GetSetting()
+// and casting the result each time a value is needed, create a SettingHandle
+// once and call GetValue() whenever needed:
+//
+//   static SettingHandle<uint32> s_bin_count("MyApp/BinCount");
+//   ...
+//   const uint32 bin_count = s_bin_count.GetValue(1000U);
+//
+// The setting is looked up the first time it is needed, and again only if
+// settings have been registered or unregistered since (see
+// SettingManager::GetGeneration()), so the handle can be created before the
+// setting exists. The value is mirrored in a std::atomic<T> by an immediate
+// listener on the setting, which means that GetValue() does not lock and never
+// races with SetValue() on another thread. T must therefore be trivially
+// copyable, e.g., a number, bool, or small math type.
+template <typename T>
+class SettingHandle {
+ public:
+  explicit SettingHandle(const std::string& name)
+      : name_(name),
+        generation_(kUnresolved),
+        setting_(NULL),
+        state_(NULL) {
+    std::ostringstream key;
+    key << "SettingHandle" << this;
+    key_ = key.str();
+    // Create the SettingManager before the handle is fully constructed, so
+    // that it is destroyed after static handles, whose destructors use it.
+    SettingManager::GetGeneration();
+  }
+
+  ~SettingHandle() {
+    // Only remove the listener if the setting is still registered, since it may
+    // have been destroyed already. If the setting is alive but was replaced,
+    // the listener is harmless since it keeps its State alive.
+    if (setting_ && SettingManager::GetSetting(name_) == setting_)
+      setting_->UnregisterListener(key_);
+  }
+
+  // Returns the name of the setting.
+  const std::string& GetName() const { return name_; }
+
+  // Returns the setting, or NULL if there is no Setting<T> with the name. The
+  // returned pointer should be used to change the value, not to read it from
+  // threads other than the one that changes it.
+  Setting<T>* GetSetting() const {
+    Resolve();
+    return state_.load(std::memory_order_acquire)->setting;
+  }
+
+  // Returns whether a Setting<T> with the name exists.
+  bool IsValid() const { return GetSetting() != NULL; }
+
+  // Returns the current value of the setting, or |default_value| if there is
+  // no Setting<T> with the name.
+  T GetValue(const T& default_value = T()) const {
+    Resolve();
+    const State* state = state_.load(std::memory_order_acquire);
+    return state->setting ? state->value.load(std::memory_order_acquire)
+                          : default_value;
+  }
+
+ private:
+  // The value mirrored for a particular setting. It is shared with the
+  // setting's listener, so it stays alive as long as either needs it.
+  struct State : public Shareable {
+    explicit State(Setting<T>* setting_in)
+        : setting(setting_in),
+          value(setting_in ? setting_in->GetValue() : T()) {}
+    Setting<T>* const setting;
+    std::atomic<T> value;
+
+   private:
+    ~State() override {}
+  };
+  typedef SharedPtr<State> StatePtr;
+
+  static const uint64 kUnresolved = ~static_cast<uint64>(0);
+
+  // Looks up the setting again if settings have changed since the last call.
+  void Resolve() const {
+    if (generation_.load(std::memory_order_acquire) !=
+        SettingManager::GetGeneration())
+      ResolveLocked();
+  }
+
+  void ResolveLocked() const {
+    LockGuard guard(&mutex_);
+    // Read the generation before looking up the setting, so that a setting
+    // registered in between causes another lookup.
+    const uint64 generation = SettingManager::GetGeneration();
+    if (generation_.load(std::memory_order_relaxed) == generation)
+      return;
+    Setting<T>* setting =
+        dynamic_cast<Setting<T>*>(SettingManager::GetSetting(name_));
+    if (!state_.load(std::memory_order_relaxed) || setting != setting_) {
+      StatePtr state(new State(setting));
+      if (setting) {
+        setting->RegisterImmediateListener(key_, [state](SettingBase* base) {
+          state->value.store(static_cast<Setting<T>*>(base)->GetValue(),
+                             std::memory_order_release);
+        });
+      }
+      // Previous states are kept alive since other threads may still be
+      // reading them. This only happens when the setting is replaced, which is
+      // rare.
+      states_.push_back(state);
+      state_.store(state.Get(), std::memory_order_release);
+      setting_ = setting;
+    }
+    generation_.store(generation, std::memory_order_release);
+  }
+
+  const std::string name_;
+  // The key used to register the listener on the setting.
+  std::string key_;
+  // The SettingManager generation when the setting was last looked up.
+  mutable std::atomic<uint64> generation_;
+  // The setting that was last looked up, protected by |mutex_|.
+  mutable Setting<T>* setting_;
+  // The current state, and all states that were created.
+  mutable std::atomic<State*> state_;
+  mutable std::vector<StatePtr> states_;
+  // Protects lookups.
+  mutable port::Mutex mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(SettingHandle);
+};
+
+template <typename T>
+const uint64 SettingHandle<T>::kUnresolved;
+
+}  // namespace base
+}  // namespace ion
+
+#endif  // ION_BASE_SETTINGHANDLE_H_
@@ -17,6 +17,8 @@ limitations under the License.
 
 #include "ion/base/settingmanager.h"
 
+#include <algorithm>
+#include <atomic>
 #include <set>
 #include <vector>
 
@@ -39,6 +41,8 @@ static const char kListenerKey[] = "SettingManager";
 
 class SettingManager::SettingData : public Shareable {
  public:
+  SettingData() : generation_(0U), notifications_deferred_(false) {}
+
   // Listener function that notifies all listeners for a setting's groups that
   // the setting has changed.
   void SettingListener(SettingBase* setting);
@@ -56,6 +60,17 @@ class SettingManager::SettingData : public Shareable {
                                const std::string& key);
 
   const SettingMap& GetAllSettings() { return settings_; }
+  uint64 GetGeneration() const {
+    return generation_.load(std::memory_order_acquire);
+  }
+  void SetNotificationsDeferred(bool deferred) {
+    notifications_deferred_.store(deferred, std::memory_order_release);
+  }
+  bool AreNotificationsDeferred() const {
+    return notifications_deferred_.load(std::memory_order_acquire);
+  }
+  bool DeferNotification(SettingBase* setting);
+  size_t DispatchDeferredNotifications();
 
   // The body of UnregisterSetting that must be called while mutex_ is locked.
   // This is to allow unregistration of old settings when a duplicate one is
@@ -85,6 +100,20 @@ class SettingManager::SettingData : public Shareable {
   SettingMap settings_;
   GroupMap setting_groups_;
   SettingGroupMap groups_;
+
+  // Incremented whenever a setting is registered or unregistered.
+  std::atomic<uint64> generation_;
+
+  // Whether notifications are deferred, and the settings with pending
+  // notifications, in the order they changed. |pending_set_| is used to queue
+  // each setting only once. Settings being dispatched are moved to
+  // |dispatching_|, so that they can be removed if they are unregistered
+  // during dispatch. All three are protected by |notification_mutex_|.
+  std::atomic<bool> notifications_deferred_;
+  std::vector<SettingBase*> pending_;
+  std::set<SettingBase*> pending_set_;
+  std::vector<SettingBase*> dispatching_;
+  port::Mutex notification_mutex_;
 };
 
 //-----------------------------------------------------------------------------
@@ -111,6 +140,7 @@ void SettingManager::SettingData::SettingListener(SettingBase* setting) {
 }
 
 SettingBase* SettingManager::SettingData::GetSetting(const std::string& name) {
+  LockGuard lock(&mutex_);
   SettingMap::const_iterator it = settings_.find(name);
   return it == settings_.end() ? NULL : it->second;
 }
@@ -156,6 +186,7 @@ void SettingManager::SettingData::RegisterSetting(SettingBase* setting) {
 
     // Add a ref to this.
     setting->data_ref_ = this;
+    generation_.fetch_add(1U, std::memory_order_acq_rel);
   }  // unlock mutex
 }
 
@@ -180,8 +211,54 @@ void SettingManager::SettingData::UnregisterSettingLocked(
       groups_[group_names[i]].settings.erase(it->second);
 
     settings_.erase(it);
+    generation_.fetch_add(1U, std::memory_order_acq_rel);
   }
   setting->UnregisterListener(kListenerKey);
+
+  // Make sure no deferred notification refers to the setting.
+  LockGuard lock(&notification_mutex_);
+  if (pending_set_.erase(setting)) {
+    pending_.erase(std::find(pending_.begin(), pending_.end(), setting));
+  }
+  std::replace(dispatching_.begin(), dispatching_.end(), setting,
+               static_cast<SettingBase*>(NULL));
+}
+
+bool SettingManager::SettingData::DeferNotification(SettingBase* setting) {
+  if (!AreNotificationsDeferred())
+    return false;
+  LockGuard lock(&notification_mutex_);
+  if (pending_set_.insert(setting).second)
+    pending_.push_back(setting);
+  return true;
+}
+
+size_t SettingManager::SettingData::DispatchDeferredNotifications() {
+  {
+    LockGuard lock(&notification_mutex_);
+    DCHECK(dispatching_.empty());
+    dispatching_.swap(pending_);
+    pending_set_.clear();
+  }
+  // The lock is not held while calling listeners, since they may change
+  // settings (which queues them again) or create and destroy settings.
+  size_t count = 0;
+  for (size_t i = 0;; ++i) {
+    SettingBase* setting;
+    {
+      LockGuard lock(&notification_mutex_);
+      if (i >= dispatching_.size())
+        break;
+      setting = dispatching_[i];
+    }
+    if (setting) {
+      setting->CallListeners(false);
+      ++count;
+    }
+  }
+  LockGuard lock(&notification_mutex_);
+  dispatching_.clear();
+  return count;
 }
 
 void SettingManager::SettingData::RegisterGroupListener(
@@ -225,6 +302,10 @@ SettingBase* SettingManager::GetSetting(const std::string& name) {
   return GetInstance()->data_->GetSetting(name);
 }
 
+uint64 SettingManager::GetGeneration() {
+  return GetInstance()->data_->GetGeneration();
+}
+
 const SettingManager::SettingMap& SettingManager::GetAllSettings() {
   return GetInstance()->data_->GetAllSettings();
 }
@@ -259,6 +340,24 @@ void SettingManager::UnregisterGroupListener(const std::string& group,
   GetInstance()->data_->UnregisterGroupListener(group, key);
 }
 
+void SettingManager::SetNotificationsDeferred(bool deferred) {
+  GetInstance()->data_->SetNotificationsDeferred(deferred);
+}
+
+bool SettingManager::AreNotificationsDeferred() {
+  return GetInstance()->data_->AreNotificationsDeferred();
+}
+
+size_t SettingManager::DispatchDeferredNotifications() {
+  return GetInstance()->data_->DispatchDeferredNotifications();
+}
+
+bool SettingManager::DeferNotification(SettingBase* setting) {
+  // As in UnregisterSetting(), use the SettingData the setting refers to.
+  SettingData* data = static_cast<SettingData*>(setting->data_ref_.Get());
+  return data && data->DeferNotification(setting);
+}
+
 SettingManager* SettingManager::GetInstance() {
   ION_DECLARE_SAFE_STATIC_POINTER(SettingManager, manager);
   return manager;
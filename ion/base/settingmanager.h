@@ -21,6 +21,7 @@ limitations under the License.
 #include <map>
 #include <string>
 
+#include "base/integral_types.h"
 #include "base/macros.h"
 #include "ion/base/setting.h"
 #include "ion/base/sharedptr.h"
@@ -40,6 +41,12 @@ class ION_API SettingManager {
 
   // Returns the setting with the passed name.
   static SettingBase* GetSetting(const std::string& name);
+  // Returns a number that changes whenever a setting is registered or
+  // unregistered. Callers that cache the result of GetSetting(), such as
+  // SettingHandle, can compare it with a previous value to know when they need
+  // to look the setting up again. This is a single atomic load.
+  static uint64 GetGeneration();
+
   // Returns all settings keyed by their names.
   static const SettingMap& GetAllSettings();
 
@@ -67,6 +74,27 @@ class ION_API SettingManager {
   static void UnregisterGroupListener(const std::string& group,
                                       const std::string& key);
 
+  // Sets/returns whether setting listeners are deferred. By default, when a
+  // setting changes its listeners (and the listeners of its groups) are called
+  // synchronously on the thread that changed it. While notifications are
+  // deferred, the setting is instead queued, and its listeners are called the
+  // next time DispatchDeferredNotifications() is called. This lets worker
+  // threads change or read settings without running listeners that, for
+  // example, modify a scene graph. Immediate listeners (see
+  // SettingBase::RegisterImmediateListener()) are never deferred. Disabling
+  // deferral does not dispatch notifications that are already queued.
+  static void SetNotificationsDeferred(bool deferred);
+  static bool AreNotificationsDeferred();
+
+  // Calls the listeners of each setting that changed since the last call while
+  // notifications were deferred. Listeners for a setting that changed several
+  // times are called only once, in the order the settings first changed.
+  // Settings that change while dispatching are queued for the next call. This
+  // should be called regularly from a single thread, e.g., once per frame from
+  // the thread that owns the objects the listeners modify. Returns the number
+  // of settings whose listeners were called.
+  static size_t DispatchDeferredNotifications();
+
  private:
   class SettingData;
   SharedPtr<SettingData> data_;
@@ -77,6 +105,13 @@ class ION_API SettingManager {
   // Returns the singleton instance.
   static SettingManager* GetInstance();
 
+  // Queues a notification for the passed setting if notifications are
+  // deferred, and returns whether it did so.
+  static bool DeferNotification(SettingBase* setting);
+
+  // SettingBase needs to call DeferNotification().
+  friend class SettingBase;
+
   DISALLOW_COPY_AND_ASSIGN(SettingManager);
 };
 
@@ -0,0 +1,261 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/base/taskscheduler.h"
+
+#include "ion/base/lockguards.h"
+#include "ion/base/logging.h"
+#include "ion/base/staticsafedeclare.h"
+
+namespace ion {
+namespace base {
+
+namespace {
+
+// The maximum number of subranges per thread that ParallelFor() creates, which
+// allows threads that finish early to steal work from slower ones.
+static const size_t kChunksPerThread = 4U;
+
+}  // anonymous namespace
+
+//-----------------------------------------------------------------------------
+//
+// TaskScheduler::TaskGroup
+//
+//-----------------------------------------------------------------------------
+
+TaskScheduler::TaskGroup::TaskGroup(TaskScheduler* scheduler, const char* name)
+    : scheduler_(CHECK_NOTNULL(scheduler)),
+      name_(name),
+      pending_count_(0U),
+      canceled_(false) {}
+
+TaskScheduler::TaskGroup::~TaskGroup() {
+  Wait();
+}
+
+void TaskScheduler::TaskGroup::Run(const std::function<void()>& task,
+                                   Priority priority) {
+  DCHECK_LT(priority, kNumPriorities);
+  ++pending_count_;
+  Task scheduled;
+  scheduled.func = task;
+  scheduled.group = this;
+  scheduler_->Push(scheduled, priority);
+}
+
+void TaskScheduler::TaskGroup::Wait() {
+  Worker* self = scheduler_->GetCurrentWorker();
+  while (pending_count_) {
+    // Help with any pending task rather than blocking, which also makes
+    // progress when all workers are waiting for groups themselves.
+    Task task;
+    if (scheduler_->FindTask(self, &task))
+      scheduler_->Execute(task);
+    else
+      done_sema_.TimedWaitMs(1);
+  }
+  // Make sure that the thread that finished the last task no longer uses the
+  // group, which may be destroyed as soon as this returns.
+  { SpinLockGuard guard(&finish_mutex_); }
+  // Consume any signal that was not waited for.
+  while (done_sema_.TryWait()) {}
+  canceled_ = false;
+}
+
+void TaskScheduler::TaskGroup::FinishTask() {
+  SpinLockGuard guard(&finish_mutex_);
+  if (--pending_count_ == 0U)
+    done_sema_.Post();
+}
+
+//-----------------------------------------------------------------------------
+//
+// TaskScheduler
+//
+//-----------------------------------------------------------------------------
+
+TaskScheduler::TaskScheduler(size_t thread_count)
+    : worker_key_(port::CreateThreadLocalStorageKey()),
+      stopping_(false),
+      steal_index_(0U) {
+  workers_.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; ++i)
+    workers_.push_back(std::unique_ptr<Worker>(new Worker));
+  // The functions must not move once threads have been spawned with them.
+  thread_funcs_.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) {
+    Worker* worker = workers_[i].get();
+    thread_funcs_.push_back([this, worker]() {
+      ThreadEntryPoint(worker);
+      return true;
+    });
+  }
+  for (size_t i = 0; i < thread_count; ++i)
+    threads_.push_back(port::SpawnThreadStd(&thread_funcs_[i]));
+}
+
+TaskScheduler::~TaskScheduler() {
+  stopping_ = true;
+  for (size_t i = 0; i < threads_.size(); ++i)
+    work_sema_.Post();
+  for (size_t i = 0; i < threads_.size(); ++i) {
+    if (threads_[i] != port::kInvalidThreadId) {
+      const bool join_succeeded = port::JoinThread(threads_[i]);
+      DCHECK(join_succeeded);
+    }
+  }
+  port::DeleteThreadLocalStorageKey(worker_key_);
+}
+
+TaskScheduler* TaskScheduler::GetDefault() {
+  ION_DECLARE_SAFE_STATIC_POINTER_WITH_CONSTRUCTOR(
+      TaskScheduler, s_scheduler,
+      new TaskScheduler(std::max(static_cast<size_t>(2U),
+                                 port::GetHardwareThreadCount()) - 1U));
+  return s_scheduler;
+}
+
+bool TaskScheduler::IsWorkerThread() const {
+  return GetCurrentWorker() != NULL;
+}
+
+void TaskScheduler::ParallelFor(
+    size_t begin, size_t end, size_t grain_size,
+    const std::function<void(size_t begin, size_t end)>& func,
+    Priority priority, const char* name) {
+  const size_t chunk_count = GetChunkCount(begin, end, grain_size);
+  if (chunk_count <= 1U) {
+    if (begin < end)
+      func(begin, end);
+    return;
+  }
+  const size_t count = end - begin;
+  TaskGroup group(this, name);
+  // The calling thread processes the first subrange itself.
+  for (size_t i = 1U; i < chunk_count; ++i) {
+    const size_t chunk_begin = begin + count * i / chunk_count;
+    const size_t chunk_end = begin + count * (i + 1U) / chunk_count;
+    group.Run([&func, chunk_begin, chunk_end]() {
+      func(chunk_begin, chunk_end);
+    }, priority);
+  }
+  func(begin, begin + count / chunk_count);
+  group.Wait();
+}
+
+size_t TaskScheduler::GetChunkCount(size_t begin, size_t end,
+                                    size_t grain_size) const {
+  if (begin >= end)
+    return 0U;
+  const size_t count = end - begin;
+  const size_t max_chunks = (workers_.size() + 1U) * kChunksPerThread;
+  return std::max(static_cast<size_t>(1U),
+                  std::min(count / std::max(grain_size,
+                                            static_cast<size_t>(1U)),
+                           max_chunks));
+}
+
+void TaskScheduler::Push(const Task& task, Priority priority) {
+  if (Worker* self = GetCurrentWorker()) {
+    SpinLockGuard guard(&self->mutex);
+    self->tasks[priority].push_back(task);
+  } else {
+    LockGuard guard(&shared_mutex_);
+    shared_tasks_[priority].push_back(task);
+  }
+  work_sema_.Post();
+}
+
+bool TaskScheduler::FindTask(Worker* self, Task* task) {
+  const size_t worker_count = workers_.size();
+  for (int priority = 0; priority < kNumPriorities; ++priority) {
+    // Newest task of the calling thread first.
+    if (self) {
+      SpinLockGuard guard(&self->mutex);
+      std::deque<Task>& tasks = self->tasks[priority];
+      if (!tasks.empty()) {
+        *task = tasks.back();
+        tasks.pop_back();
+        return true;
+      }
+    }
+    {
+      LockGuard guard(&shared_mutex_);
+      std::deque<Task>& tasks = shared_tasks_[priority];
+      if (!tasks.empty()) {
+        *task = tasks.front();
+        tasks.pop_front();
+        return true;
+      }
+    }
+    // Steal the oldest task of another worker, starting at a different
+    // worker each time to spread out contention.
+    const size_t first = steal_index_++;
+    for (size_t i = 0; i < worker_count; ++i) {
+      Worker* victim = workers_[(first + i) % worker_count].get();
+      if (victim == self)
+        continue;
+      SpinLockGuard guard(&victim->mutex);
+      std::deque<Task>& tasks = victim->tasks[priority];
+      if (!tasks.empty()) {
+        *task = tasks.front();
+        tasks.pop_front();
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void TaskScheduler::Execute(const Task& task) {
+  TaskGroup* group = task.group;
+  if (!group->IsCanceled()) {
+    TaskObserver* observer = observer_.get();
+    if (observer)
+      observer->OnTaskBegin(group->GetName());
+    task.func();
+    if (observer)
+      observer->OnTaskEnd();
+  }
+  group->FinishTask();
+}
+
+TaskScheduler::Worker* TaskScheduler::GetCurrentWorker() const {
+  return static_cast<Worker*>(port::GetThreadLocalStorage(worker_key_));
+}
+
+void TaskScheduler::ThreadEntryPoint(Worker* worker) {
+  if (port::IsThreadNamingSupported())
+    port::SetThreadName("TaskScheduler");
+  port::SetThreadLocalStorage(worker_key_, worker);
+  while (true) {
+    // Each added task posts the semaphore once, so there is always at least
+    // one signal left while tasks are pending. A wakeup finds no task only if
+    // a waiting thread has already run it.
+    work_sema_.Wait();
+    if (stopping_)
+      break;
+    Task task;
+    if (FindTask(worker, &task))
+      Execute(task);
+  }
+  port::SetThreadLocalStorage(worker_key_, NULL);
+}
+
+}  // namespace base
+}  // namespace ion
@@ -0,0 +1,237 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef ION_BASE_TASKSCHEDULER_H_
+#define ION_BASE_TASKSCHEDULER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "base/macros.h"
+#include "ion/base/spinmutex.h"
+#include "ion/port/mutex.h"
+#include "ion/port/semaphore.h"
+#include "ion/port/threadutils.h"
+
+namespace ion {
+namespace base {
+
+// TaskScheduler runs small tasks on a fixed set of worker threads. Unlike a
+// WorkerPool, which calls a single Worker::DoWork() from every thread, tasks
+// are arbitrary functions that are grouped into TaskGroups so that callers can
+// wait for or cancel them.
+//
+// Each worker thread keeps its own deque of tasks for each priority. Tasks
+// that are run from a worker thread (e.g., subtasks of a task) are pushed onto
+// that thread's deque and popped in LIFO order, which keeps their data hot in
+// the cache; idle workers steal the oldest tasks from other threads' deques.
+// Tasks run from other threads go into a shared queue. Higher priority tasks
+// are always started before lower priority ones, but running tasks are never
+// preempted.
+//
+// Threads waiting for a TaskGroup run pending tasks until the group is done,
+// so tasks may themselves create and wait for groups, e.g., through nested
+// calls to ParallelFor(), without deadlocking or needing extra threads.
+//
+// GetDefault() returns a process-wide scheduler sized to the hardware, which
+// CPU-side pipelines should share rather than spawning their own threads.
+class ION_API TaskScheduler {
+ public:
+  enum Priority {
+    kHighPriority,
+    kNormalPriority,
+    kLowPriority,
+    kNumPriorities
+  };
+
+  // An observer is notified before and after each task runs, on the thread
+  // that runs it. It can be used to trace tasks; see
+  // profile::EnableTaskSchedulerTracing().
+  class TaskObserver {
+   public:
+    virtual ~TaskObserver() {}
+    // Called before a task of the TaskGroup named |name| runs.
+    virtual void OnTaskBegin(const char* name) = 0;
+    // Called after the task has run.
+    virtual void OnTaskEnd() = 0;
+  };
+
+  // A set of tasks that can be waited for or canceled together. The group
+  // must outlive its tasks, so the destructor waits for them.
+  class ION_API TaskGroup {
+   public:
+    // The name identifies the group's tasks to the TaskObserver, and must be a
+    // literal string or otherwise outlive the group.
+    explicit TaskGroup(TaskScheduler* scheduler,
+                       const char* name = "TaskGroup");
+    ~TaskGroup();
+
+    // Schedules |task| to run as part of this group.
+    void Run(const std::function<void()>& task,
+             Priority priority = kNormalPriority);
+
+    // Runs pending tasks until all tasks of this group have finished. Tasks
+    // may be added to the group again afterwards, and a canceled group is no
+    // longer canceled.
+    void Wait();
+
+    // Cancels the group: tasks that have not started yet are skipped, and
+    // running tasks can stop early by checking IsCanceled(). Wait() must
+    // still be called.
+    void Cancel() { canceled_ = true; }
+    bool IsCanceled() const { return canceled_; }
+
+    const char* GetName() const { return name_; }
+
+   private:
+    // Called when a task of the group has run or was skipped.
+    void FinishTask();
+
+    TaskScheduler* scheduler_;
+    const char* name_;
+    // The number of tasks that have not finished.
+    std::atomic<size_t> pending_count_;
+    std::atomic<bool> canceled_;
+    // Posted when the last pending task finishes.
+    port::Semaphore done_sema_;
+    // Held while a task finishes, so that Wait() can make sure that the group
+    // is no longer in use.
+    SpinMutex finish_mutex_;
+
+    friend class TaskScheduler;
+    DISALLOW_COPY_AND_ASSIGN(TaskGroup);
+  };
+
+  // Creates a scheduler with |thread_count| worker threads. Tasks of a
+  // scheduler with no threads only run while a thread waits for a TaskGroup.
+  explicit TaskScheduler(size_t thread_count);
+  // Waits for the worker threads to finish the tasks they are running.
+  // Pending tasks are not run.
+  ~TaskScheduler();
+
+  // Returns the process-wide scheduler, which has one fewer worker thread
+  // than there are hardware threads (but at least one), since the waiting
+  // thread also runs tasks.
+  static TaskScheduler* GetDefault();
+
+  // Returns the number of worker threads.
+  size_t GetThreadCount() const { return workers_.size(); }
+
+  // Returns whether the calling thread is one of this scheduler's workers.
+  bool IsWorkerThread() const;
+
+  // Sets the observer that is notified of every task. This should be done
+  // while no tasks are running.
+  void SetTaskObserver(const std::shared_ptr<TaskObserver>& observer) {
+    observer_ = observer;
+  }
+  const std::shared_ptr<TaskObserver>& GetTaskObserver() const {
+    return observer_;
+  }
+
+  // Calls |func| on consecutive subranges that cover [begin, end), in
+  // parallel, and returns when all calls have finished. Each subrange has at
+  // least |grain_size| elements (except when the whole range is smaller), and
+  // the range is split into at most a few subranges per thread. Ranges that
+  // are not larger than |grain_size| are processed on the calling thread.
+  void ParallelFor(size_t begin, size_t end, size_t grain_size,
+                   const std::function<void(size_t begin, size_t end)>& func,
+                   Priority priority = kNormalPriority,
+                   const char* name = "ParallelFor");
+
+  // Computes |map|(b, e) in parallel for subranges [b, e) of [begin, end), as
+  // ParallelFor() does, and combines the results with |reduce|, starting from
+  // |identity|. The results are combined in the order of their subranges, so
+  // |reduce| need only be associative for the result to be deterministic.
+  template <typename T, typename MapFunc, typename ReduceFunc>
+  T ParallelReduce(size_t begin, size_t end, size_t grain_size,
+                   const T& identity, const MapFunc& map,
+                   const ReduceFunc& reduce,
+                   Priority priority = kNormalPriority,
+                   const char* name = "ParallelReduce") {
+    const size_t chunk_count = GetChunkCount(begin, end, grain_size);
+    std::vector<T> results(chunk_count, identity);
+    const size_t count = end - begin;
+    ParallelFor(0U, chunk_count, 1U, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i)
+        results[i] = map(begin + count * i / chunk_count,
+                         begin + count * (i + 1U) / chunk_count);
+    }, priority, name);
+    T result = identity;
+    for (size_t i = 0; i < chunk_count; ++i)
+      result = reduce(result, results[i]);
+    return result;
+  }
+
+ private:
+  struct Task {
+    std::function<void()> func;
+    TaskGroup* group;
+  };
+
+  // The task deques of a worker thread.
+  struct Worker {
+    SpinMutex mutex;
+    std::deque<Task> tasks[kNumPriorities];
+  };
+
+  // Adds a task to the deque of the calling worker thread, or to the shared
+  // queue.
+  void Push(const Task& task, Priority priority);
+  // Removes the next task to run into |task|, looking at |self|'s deques
+  // (which may be NULL), the shared queue, and other workers' deques in that
+  // order for each priority. Returns false if no task is available.
+  bool FindTask(Worker* self, Task* task);
+  // Runs |task| unless its group is canceled.
+  void Execute(const Task& task);
+  // Returns the Worker of the calling thread, or NULL.
+  Worker* GetCurrentWorker() const;
+  // Runs on each worker thread.
+  void ThreadEntryPoint(Worker* worker);
+
+  // Returns the number of subranges that ParallelFor() splits a range into.
+  size_t GetChunkCount(size_t begin, size_t end, size_t grain_size) const;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<port::ThreadStdFunc> thread_funcs_;
+  std::vector<port::ThreadId> threads_;
+  // Maps worker threads to their Worker.
+  port::ThreadLocalStorageKey worker_key_;
+
+  // Tasks added from threads that are not workers.
+  port::Mutex shared_mutex_;
+  std::deque<Task> shared_tasks_[kNumPriorities];
+
+  // Posted once for each added task to wake a worker.
+  port::Semaphore work_sema_;
+  std::atomic<bool> stopping_;
+  // Used to pick which worker to steal from first.
+  std::atomic<size_t> steal_index_;
+
+  std::shared_ptr<TaskObserver> observer_;
+
+  DISALLOW_COPY_AND_ASSIGN(TaskScheduler);
+};
+
+}  // namespace base
+}  // namespace ion
+
+#endif  // ION_BASE_TASKSCHEDULER_H_
@@ -43,6 +43,7 @@
         'lockguards_test.cc',
         'logchecker_test.cc',
         'logging_test.cc',
+        'lrucache_test.cc',
         'memoryzipstream_test.cc',
         'notifier_test.cc',
         'nulllogentrywriter_test.cc',
@@ -51,12 +52,14 @@
         'scopedallocation_test.cc',
         'serialize_test.cc',
         'setting_test.cc',
+        'settinghandle_test.cc',
         'settingmanager_test.cc',
         'sharedptr_test.cc',
         'spinmutex_test.cc',
         'staticsafedeclare_test.cc',
         'stlallocator_test.cc',
         'stringutils_test.cc',
+        'taskscheduler_test.cc',
         'threadlocalobject_test.cc',
         'threadspawner_test.cc',
         'type_structs_test.cc',
@@ -73,6 +76,7 @@
         ['OS == "asmjs"', {
           'sources!': [
             'readwritelock_test.cc',
+            'taskscheduler_test.cc',
             'threadlocalobject_test.cc',
             'threadspawner_test.cc',
             'workerpool_test.cc',
@@ -82,6 +86,7 @@
       'dependencies' : [
         'base_tests_assets',
         '<(ion_dir)/base/base.gyp:ionbase_for_tests',
+        '<(ion_dir)/external/external.gyp:ionzlib',
         '<(ion_dir)/external/gtest.gyp:iongtest_safeallocs',
         '<(ion_dir)/port/port.gyp:ionport',
       ],
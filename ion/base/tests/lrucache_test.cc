@@ -0,0 +1,104 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#include "ion/base/lrucache.h"
+
+#include <string>
+
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace base {
+
+TEST(LruCache, FindAndInsert) {
+  LruCache<std::string, int> cache(3U);
+  EXPECT_EQ(3U, cache.GetBudget());
+  EXPECT_EQ(0U, cache.GetSize());
+  EXPECT_TRUE(cache.Find("a") == NULL);
+
+  cache.Insert("a", 1);
+  cache.Insert("b", 2);
+  cache.Insert("c", 3);
+  EXPECT_EQ(3U, cache.GetSize());
+  EXPECT_EQ(3U, cache.GetEntryCount());
+  ASSERT_TRUE(cache.Find("a") != NULL);
+  EXPECT_EQ(1, *cache.Find("a"));
+
+  // "b" is now the least recently used entry, so it is evicted.
+  cache.Insert("d", 4);
+  EXPECT_EQ(3U, cache.GetEntryCount());
+  EXPECT_FALSE(cache.Contains("b"));
+  EXPECT_TRUE(cache.Contains("a"));
+  EXPECT_TRUE(cache.Contains("c"));
+  EXPECT_TRUE(cache.Contains("d"));
+
+  // Contains() does not change the order, so "c" is evicted next.
+  EXPECT_TRUE(cache.Contains("c"));
+  cache.Insert("e", 5);
+  EXPECT_FALSE(cache.Contains("c"));
+
+  // Inserting an existing key replaces its value.
+  cache.Insert("a", 10);
+  EXPECT_EQ(3U, cache.GetEntryCount());
+  EXPECT_EQ(10, *cache.Find("a"));
+
+  // Values may be modified in place.
+  *cache.Find("a") = 11;
+  EXPECT_EQ(11, *cache.Find("a"));
+
+  cache.Clear();
+  EXPECT_EQ(0U, cache.GetSize());
+  EXPECT_EQ(0U, cache.GetEntryCount());
+  EXPECT_FALSE(cache.Contains("a"));
+}
+
+TEST(LruCache, Costs) {
+  LruCache<int, int> cache(10U);
+  cache.Insert(1, 1, 4U);
+  cache.Insert(2, 2, 4U);
+  EXPECT_EQ(8U, cache.GetSize());
+
+  // Both older entries must go to make room.
+  cache.Insert(3, 3, 9U);
+  EXPECT_EQ(9U, cache.GetSize());
+  EXPECT_EQ(1U, cache.GetEntryCount());
+
+  // Replacing an entry updates the size.
+  cache.Insert(3, 3, 2U);
+  EXPECT_EQ(2U, cache.GetSize());
+
+  // Entries that cost more than the budget are not added, and replace any
+  // existing entry.
+  cache.Insert(3, 4, 11U);
+  EXPECT_EQ(0U, cache.GetSize());
+  EXPECT_FALSE(cache.Contains(3));
+
+  // Reducing the budget evicts entries immediately.
+  cache.Insert(1, 1, 3U);
+  cache.Insert(2, 2, 3U);
+  cache.SetBudget(4U);
+  EXPECT_EQ(4U, cache.GetBudget());
+  EXPECT_EQ(3U, cache.GetSize());
+  EXPECT_TRUE(cache.Contains(2));
+
+  // A budget of zero disables caching.
+  cache.SetBudget(0U);
+  cache.Insert(1, 1, 1U);
+  EXPECT_EQ(0U, cache.GetEntryCount());
+}
+
+}  // namespace base
+}  // namespace ion
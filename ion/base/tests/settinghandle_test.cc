@@ -0,0 +1,187 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/base/settinghandle.h"
+
+#include <atomic>
+#include <string>
+
+#include "ion/base/threadspawner.h"
+#include "ion/port/barrier.h"
+
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace base {
+
+TEST(SettingHandle, GetValue) {
+  SettingHandle<int> handle("handle/int");
+  EXPECT_EQ("handle/int", handle.GetName());
+
+  // There is no setting yet.
+  EXPECT_FALSE(handle.IsValid());
+  EXPECT_TRUE(handle.GetSetting() == NULL);
+  EXPECT_EQ(0, handle.GetValue());
+  EXPECT_EQ(5, handle.GetValue(5));
+
+  {
+    Setting<int> setting("handle/int", 12, "");
+    EXPECT_TRUE(handle.IsValid());
+    EXPECT_EQ(&setting, handle.GetSetting());
+    EXPECT_EQ(12, handle.GetValue());
+    EXPECT_EQ(12, handle.GetValue(5));
+
+    setting = 13;
+    EXPECT_EQ(13, handle.GetValue());
+    handle.GetSetting()->SetValue(14);
+    EXPECT_EQ(14, setting.GetValue());
+    EXPECT_EQ(14, handle.GetValue());
+    EXPECT_TRUE(setting.FromString("15"));
+    EXPECT_EQ(15, handle.GetValue());
+  }
+
+  // The setting is gone.
+  EXPECT_FALSE(handle.IsValid());
+  EXPECT_EQ(5, handle.GetValue(5));
+
+  // A setting of a different type is not valid.
+  {
+    Setting<std::string> setting("handle/int", "string", "");
+    EXPECT_FALSE(handle.IsValid());
+    EXPECT_EQ(5, handle.GetValue(5));
+  }
+
+  // A new setting with the same name is found.
+  Setting<int> setting("handle/int", 20, "");
+  EXPECT_EQ(20, handle.GetValue());
+  setting = 21;
+  EXPECT_EQ(21, handle.GetValue());
+}
+
+// A handle with static storage duration, which is constructed before any
+// setting and destroyed at exit.
+static SettingHandle<int> s_static_handle("handle/static");
+
+TEST(SettingHandle, StaticHandle) {
+  Setting<int> setting("handle/static", 3, "");
+  EXPECT_EQ(3, s_static_handle.GetValue());
+  // The handle is destroyed after the setting, and must not crash at exit when
+  // it checks whether it still has to remove its listener.
+}
+
+TEST(SettingHandle, HandleDestroyedFirst) {
+  Setting<float> setting("handle/float", 1.f, "");
+  {
+    SettingHandle<float> handle("handle/float");
+    EXPECT_EQ(1.f, handle.GetValue());
+  }
+  // The handle's listener was removed.
+  setting = 2.f;
+  SettingHandle<float> handle("handle/float");
+  EXPECT_EQ(2.f, handle.GetValue());
+}
+
+TEST(SettingHandle, DeferredNotifications) {
+  Setting<int> setting("handle/deferred", 1, "");
+  SettingHandle<int> handle("handle/deferred");
+  int calls = 0;
+  setting.RegisterListener("listener",
+                           [&calls](SettingBase* setting) { ++calls; });
+
+  // The handle sees new values even if listeners are deferred.
+  SettingManager::SetNotificationsDeferred(true);
+  setting = 2;
+  EXPECT_EQ(2, handle.GetValue());
+  EXPECT_EQ(0, calls);
+  EXPECT_EQ(1U, SettingManager::DispatchDeferredNotifications());
+  EXPECT_EQ(1, calls);
+  SettingManager::SetNotificationsDeferred(false);
+}
+
+namespace {
+
+struct ThreadData {
+  ThreadData()
+      : handle("handle/threaded"), barrier(2), done(false), monotonic(true) {}
+  SettingHandle<int> handle;
+  port::Barrier barrier;
+  std::atomic<bool> done;
+  bool monotonic;
+};
+
+static bool ReadValues(ThreadData* data) {
+  data->barrier.Wait();
+  int last = 0;
+  while (!data->done) {
+    // Values are only ever increased, so a smaller one means a stale read.
+    const int value = data->handle.GetValue();
+    data->monotonic = data->monotonic && value >= last;
+    last = value;
+  }
+  return true;
+}
+
+struct ResolveData {
+  ResolveData() : barrier(2), done(false), in_range(true) {}
+  port::Barrier barrier;
+  std::atomic<bool> done;
+  bool in_range;
+};
+
+static bool ResolveHandles(ResolveData* data) {
+  data->barrier.Wait();
+  for (int i = 0; i < 1000; ++i) {
+    // Each handle registers a listener on the setting when it resolves, and
+    // removes it when it is destroyed, while the value keeps changing.
+    SettingHandle<int> handle("handle/resolved");
+    const int value = handle.GetValue(-1);
+    data->in_range = data->in_range && value >= 0;
+  }
+  data->done = true;
+  return true;
+}
+
+}  // anonymous namespace
+
+TEST(SettingHandle, ReadFromOtherThread) {
+  Setting<int> setting("handle/threaded", 0, "");
+  ThreadData data;
+  data.handle.GetValue();
+  ThreadSpawner spawner("reader", std::bind(ReadValues, &data));
+  data.barrier.Wait();
+  for (int i = 1; i <= 1000; ++i)
+    setting = i;
+  data.done = true;
+  spawner.Join();
+  EXPECT_TRUE(data.monotonic);
+  EXPECT_EQ(1000, data.handle.GetValue());
+}
+
+TEST(SettingHandle, ResolveWhileSetting) {
+  Setting<int> setting("handle/resolved", 0, "");
+  ResolveData data;
+  ThreadSpawner spawner("resolver", std::bind(ResolveHandles, &data));
+  data.barrier.Wait();
+  int value = 0;
+  while (!data.done)
+    setting.SetValue(++value);
+  spawner.Join();
+  EXPECT_TRUE(data.in_range);
+}
+
+}  // namespace base
+}  // namespace ion
@@ -18,6 +18,8 @@ limitations under the License.
 #include "ion/base/settingmanager.h"
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "ion/base/logchecker.h"
 #include "ion/base/logging.h"
@@ -226,5 +228,99 @@ TEST(SettingManager, RegisterSameBeforeUnregisterSettingsAndGroupListeners) {
   EXPECT_TRUE(listener2.WasCalled());
 }
 
+TEST(SettingManager, Generation) {
+  const uint64 generation = SettingManager::GetGeneration();
+  {
+    Setting<int> setting("generation/int", 1, "");
+    EXPECT_NE(generation, SettingManager::GetGeneration());
+    const uint64 registered = SettingManager::GetGeneration();
+
+    // Changing a value does not change the generation.
+    setting = 2;
+    EXPECT_EQ(registered, SettingManager::GetGeneration());
+  }
+  EXPECT_NE(generation, SettingManager::GetGeneration());
+}
+
+TEST(SettingManager, DeferredNotifications) {
+  EXPECT_FALSE(SettingManager::AreNotificationsDeferred());
+  EXPECT_EQ(0U, SettingManager::DispatchDeferredNotifications());
+
+  Setting<int> setting1("deferred/int1", 1, "");
+  Setting<int> setting2("deferred/int2", 2, "");
+  std::vector<std::string> calls;
+  int immediate_calls = 0;
+  setting1.RegisterListener("listener", [&calls](SettingBase* setting) {
+    calls.push_back(setting->GetName());
+  });
+  setting2.RegisterListener("listener", [&calls](SettingBase* setting) {
+    calls.push_back(setting->GetName());
+  });
+  setting1.RegisterImmediateListener(
+      "immediate", [&immediate_calls](SettingBase* setting) {
+        ++immediate_calls;
+      });
+  Listener group_listener;
+  SettingManager::RegisterGroupListener(
+      "deferred", "group_listener",
+      std::bind(&Listener::Callback, &group_listener, std::placeholders::_1));
+
+  setting1 = 10;
+  EXPECT_EQ(1U, calls.size());
+  EXPECT_EQ(1, immediate_calls);
+  EXPECT_TRUE(group_listener.WasCalled());
+  calls.clear();
+
+  SettingManager::SetNotificationsDeferred(true);
+  EXPECT_TRUE(SettingManager::AreNotificationsDeferred());
+  setting2 = 20;
+  setting1 = 11;
+  setting2 = 21;
+  // Only immediate listeners are called.
+  EXPECT_TRUE(calls.empty());
+  EXPECT_EQ(2, immediate_calls);
+  EXPECT_FALSE(group_listener.WasCalled());
+
+  // Each setting is dispatched once, in the order it first changed.
+  EXPECT_EQ(2U, SettingManager::DispatchDeferredNotifications());
+  ASSERT_EQ(2U, calls.size());
+  EXPECT_EQ("deferred/int2", calls[0]);
+  EXPECT_EQ("deferred/int1", calls[1]);
+  EXPECT_TRUE(group_listener.WasCalled());
+  EXPECT_EQ(0U, SettingManager::DispatchDeferredNotifications());
+  calls.clear();
+
+  // A setting that is destroyed before dispatch is not dispatched.
+  {
+    Setting<int> temporary("deferred/temporary", 3, "");
+    temporary = 4;
+  }
+  setting1 = 12;
+  EXPECT_EQ(1U, SettingManager::DispatchDeferredNotifications());
+  ASSERT_EQ(1U, calls.size());
+  EXPECT_EQ("deferred/int1", calls[0]);
+  calls.clear();
+
+  // Changes made by listeners are dispatched by the next call.
+  setting1.RegisterListener("chain", [&setting2](SettingBase* setting) {
+    setting2 = 22;
+  });
+  setting1 = 13;
+  EXPECT_EQ(1U, SettingManager::DispatchDeferredNotifications());
+  EXPECT_EQ(1U, calls.size());
+  EXPECT_EQ(1U, SettingManager::DispatchDeferredNotifications());
+  ASSERT_EQ(2U, calls.size());
+  EXPECT_EQ("deferred/int2", calls[1]);
+  setting1.UnregisterListener("chain");
+  calls.clear();
+
+  SettingManager::SetNotificationsDeferred(false);
+  EXPECT_FALSE(SettingManager::AreNotificationsDeferred());
+  setting2 = 23;
+  EXPECT_EQ(1U, calls.size());
+  EXPECT_EQ(0U, SettingManager::DispatchDeferredNotifications());
+  SettingManager::UnregisterGroupListener("deferred", "group_listener");
+}
+
 }  // namespace base
 }  // namespace ion
@@ -0,0 +1,251 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/base/taskscheduler.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ion/port/mutex.h"
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace base {
+
+namespace {
+
+// Counts the tasks that an observer is notified of.
+class CountingObserver : public TaskScheduler::TaskObserver {
+ public:
+  CountingObserver() : begin_count_(0), end_count_(0) {}
+  void OnTaskBegin(const char* name) override {
+    EXPECT_EQ(std::string("Observed"), name);
+    ++begin_count_;
+  }
+  void OnTaskEnd() override { ++end_count_; }
+  int GetBeginCount() const { return begin_count_; }
+  int GetEndCount() const { return end_count_; }
+
+ private:
+  std::atomic<int> begin_count_;
+  std::atomic<int> end_count_;
+};
+
+}  // anonymous namespace
+
+TEST(TaskScheduler, RunAndWait) {
+  TaskScheduler scheduler(3U);
+  EXPECT_EQ(3U, scheduler.GetThreadCount());
+  EXPECT_FALSE(scheduler.IsWorkerThread());
+
+  std::atomic<int> count(0);
+  std::atomic<int> worker_count(0);
+  TaskScheduler::TaskGroup group(&scheduler);
+  for (int i = 0; i < 1000; ++i) {
+    group.Run([&]() {
+      ++count;
+      if (scheduler.IsWorkerThread())
+        ++worker_count;
+    });
+  }
+  group.Wait();
+  EXPECT_EQ(1000, count);
+  EXPECT_LE(worker_count, 1000);
+
+  // The group can be reused.
+  group.Run([&count]() { ++count; });
+  group.Wait();
+  EXPECT_EQ(1001, count);
+}
+
+TEST(TaskScheduler, NoThreads) {
+  // Tasks run on the waiting thread.
+  TaskScheduler scheduler(0U);
+  EXPECT_EQ(0U, scheduler.GetThreadCount());
+  int count = 0;
+  {
+    TaskScheduler::TaskGroup group(&scheduler);
+    group.Run([&count]() { ++count; });
+    group.Run([&count]() { ++count; });
+    EXPECT_EQ(0, count);
+    // The destructor waits.
+  }
+  EXPECT_EQ(2, count);
+}
+
+TEST(TaskScheduler, NestedGroups) {
+  TaskScheduler scheduler(2U);
+  std::atomic<int> count(0);
+  TaskScheduler::TaskGroup outer(&scheduler);
+  for (int i = 0; i < 8; ++i) {
+    outer.Run([&]() {
+      // Waiting for a group from a task runs other tasks rather than blocking
+      // the worker.
+      TaskScheduler::TaskGroup inner(&scheduler);
+      for (int j = 0; j < 8; ++j)
+        inner.Run([&count]() { ++count; });
+      inner.Wait();
+    });
+  }
+  outer.Wait();
+  EXPECT_EQ(64, count);
+}
+
+TEST(TaskScheduler, Cancel) {
+  TaskScheduler scheduler(0U);
+  int count = 0;
+  TaskScheduler::TaskGroup group(&scheduler);
+  for (int i = 0; i < 10; ++i) {
+    group.Run([&]() {
+      ++count;
+      // Cancel from within a task; the remaining tasks are skipped.
+      if (count == 3)
+        group.Cancel();
+    });
+  }
+  EXPECT_FALSE(group.IsCanceled());
+  group.Wait();
+  EXPECT_EQ(3, count);
+  // Waiting resets the group.
+  EXPECT_FALSE(group.IsCanceled());
+  group.Run([&count]() { ++count; });
+  group.Wait();
+  EXPECT_EQ(4, count);
+}
+
+TEST(TaskScheduler, Priorities) {
+  // Without threads the order in which tasks run is deterministic.
+  TaskScheduler scheduler(0U);
+  std::string order;
+  TaskScheduler::TaskGroup group(&scheduler);
+  group.Run([&order]() { order += 'l'; }, TaskScheduler::kLowPriority);
+  group.Run([&order]() { order += 'n'; });
+  group.Run([&order]() { order += 'h'; }, TaskScheduler::kHighPriority);
+  group.Run([&order]() { order += 'N'; }, TaskScheduler::kNormalPriority);
+  group.Run([&order]() { order += 'H'; }, TaskScheduler::kHighPriority);
+  group.Wait();
+  // Tasks added from outside the workers run in FIFO order within a priority.
+  EXPECT_EQ("hHnNl", order);
+}
+
+TEST(TaskScheduler, ParallelFor) {
+  TaskScheduler scheduler(3U);
+  std::vector<std::atomic<int>> visits(1000);
+  for (auto& visit : visits)
+    visit = 0;
+  std::atomic<int> calls(0);
+  scheduler.ParallelFor(10U, 1000U, 50U, [&](size_t begin, size_t end) {
+    EXPECT_LT(begin, end);
+    EXPECT_GE(end - begin, 50U);
+    ++calls;
+    for (size_t i = begin; i < end; ++i)
+      ++visits[i];
+  });
+  // The range is split into at most four subranges per thread, including the
+  // calling thread.
+  EXPECT_GT(calls, 1);
+  EXPECT_LE(calls, 16);
+  for (size_t i = 0; i < visits.size(); ++i)
+    EXPECT_EQ(i < 10U ? 0 : 1, visits[i]);
+
+  // Small and empty ranges are processed on the calling thread.
+  calls = 0;
+  scheduler.ParallelFor(0U, 10U, 50U, [&](size_t begin, size_t end) {
+    EXPECT_FALSE(scheduler.IsWorkerThread());
+    EXPECT_EQ(0U, begin);
+    EXPECT_EQ(10U, end);
+    ++calls;
+  });
+  EXPECT_EQ(1, calls);
+  scheduler.ParallelFor(5U, 5U, 1U, [&](size_t begin, size_t end) {
+    ++calls;
+  });
+  EXPECT_EQ(1, calls);
+
+  // Nested loops.
+  std::atomic<int> count(0);
+  scheduler.ParallelFor(0U, 10U, 1U, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      scheduler.ParallelFor(0U, 100U, 10U, [&](size_t b, size_t e) {
+        count += static_cast<int>(e - b);
+      });
+    }
+  });
+  EXPECT_EQ(1000, count);
+}
+
+TEST(TaskScheduler, ParallelReduce) {
+  TaskScheduler scheduler(3U);
+  const uint64 sum = scheduler.ParallelReduce(
+      1U, 10001U, 100U, static_cast<uint64>(0U),
+      [](size_t begin, size_t end) {
+        uint64 partial = 0U;
+        for (size_t i = begin; i < end; ++i)
+          partial += i;
+        return partial;
+      },
+      [](uint64 a, uint64 b) { return a + b; });
+  EXPECT_EQ(50005000U, sum);
+
+  // Results are combined in order.
+  const std::string digits = scheduler.ParallelReduce(
+      0U, 10U, 1U, std::string(),
+      [](size_t begin, size_t end) {
+        std::string s;
+        for (size_t i = begin; i < end; ++i)
+          s += static_cast<char>('0' + i);
+        return s;
+      },
+      [](const std::string& a, const std::string& b) { return a + b; });
+  EXPECT_EQ("0123456789", digits);
+
+  EXPECT_EQ(7, scheduler.ParallelReduce(
+                   3U, 3U, 1U, 7, [](size_t, size_t) { return 1; },
+                   [](int a, int b) { return a + b; }));
+}
+
+TEST(TaskScheduler, Observer) {
+  TaskScheduler scheduler(2U);
+  EXPECT_FALSE(scheduler.GetTaskObserver());
+  std::shared_ptr<CountingObserver> observer(new CountingObserver);
+  scheduler.SetTaskObserver(observer);
+  EXPECT_EQ(observer, scheduler.GetTaskObserver());
+  TaskScheduler::TaskGroup group(&scheduler, "Observed");
+  for (int i = 0; i < 20; ++i)
+    group.Run([]() {});
+  group.Wait();
+  EXPECT_EQ(20, observer->GetBeginCount());
+  EXPECT_EQ(20, observer->GetEndCount());
+  scheduler.SetTaskObserver(std::shared_ptr<TaskScheduler::TaskObserver>());
+}
+
+TEST(TaskScheduler, Default) {
+  TaskScheduler* scheduler = TaskScheduler::GetDefault();
+  ASSERT_TRUE(scheduler);
+  EXPECT_EQ(scheduler, TaskScheduler::GetDefault());
+  EXPECT_GE(scheduler->GetThreadCount(), 1U);
+  std::atomic<int> count(0);
+  scheduler->ParallelFor(0U, 100U, 1U, [&count](size_t begin, size_t end) {
+    count += static_cast<int>(end - begin);
+  });
+  EXPECT_EQ(100, count);
+}
+
+}  // namespace base
+}  // namespace ion
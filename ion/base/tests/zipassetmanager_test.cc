@@ -18,19 +18,27 @@ limitations under the License.
 #include "ion/base/zipassetmanager.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>  // NOLINT
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "ion/base/invalid.h"
 #include "ion/base/logchecker.h"
 #include "ion/base/logging.h"
 #include "ion/base/memoryzipstream.h"
+#include "ion/base/serialize.h"
 #include "ion/base/staticsafedeclare.h"
+#include "ion/base/threadspawner.h"
 #include "ion/base/zipassetmanagermacros.h"
 #include "ion/port/fileutils.h"
+#include "ion/port/semaphore.h"
 #include "ion/port/timer.h"
 
 #include "third_party/googletest/googletest/include/gtest/gtest.h"
+#include "third_party/zlib/src/zlib.h"
 
 ION_REGISTER_ASSETS(ZipAssetTest);
 
@@ -39,6 +47,21 @@ namespace base {
 
 namespace {
 
+// A zip containing the file "stored.txt" with the contents "Stored data",
+// stored without compression.
+static const unsigned char kStoredZip[] = {
+    0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x21, 0x00, 0xc6, 0xda, 0x4b, 0x1f, 0x0b, 0x00, 0x00, 0x00, 0x0b, 0x00,
+    0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x73, 0x74, 0x6f, 0x72, 0x65, 0x64,
+    0x2e, 0x74, 0x78, 0x74, 0x53, 0x74, 0x6f, 0x72, 0x65, 0x64, 0x20, 0x64,
+    0x61, 0x74, 0x61, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x00, 0xc6, 0xda, 0x4b, 0x1f, 0x0b,
+    0x00, 0x00, 0x00, 0x0b, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x00,
+    0x00, 0x73, 0x74, 0x6f, 0x72, 0x65, 0x64, 0x2e, 0x74, 0x78, 0x74, 0x50,
+    0x4b, 0x05, 0x06, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x38,
+    0x00, 0x00, 0x00, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00};
+
 // Returns the contents of a file on disk.
 static const std::string GetFileContents(const std::string& filename) {
   FILE* fp = port::OpenFile(filename, "rb");
@@ -50,6 +73,95 @@ static const std::string GetFileContents(const std::string& filename) {
   return buffer;
 }
 
+// Returns the decompressed contents of gzip data, or an empty string if the
+// data is not valid.
+static const std::string Gunzip(const std::string& data) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // Adding 16 to the window bits makes zlib expect a gzip header and trailer.
+  EXPECT_EQ(Z_OK, inflateInit2(&stream, 15 + 16));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.length());
+  char buffer[2048];
+  stream.next_out = reinterpret_cast<Bytef*>(buffer);
+  stream.avail_out = sizeof(buffer);
+  const int result = inflate(&stream, Z_FINISH);
+  const std::string out(buffer, stream.total_out);
+  inflateEnd(&stream);
+  return result == Z_STREAM_END ? out : std::string();
+}
+
+// Appends |value| to |out| in little-endian order using |size| bytes.
+static void AppendLittleEndian(uint32 value, size_t size, std::string* out) {
+  for (size_t i = 0; i < size; ++i)
+    out->push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+// Returns a zip that stores each (name, contents) pair in |files| without
+// compression. This does not rely on minizip, so it can be used in tests that
+// must not depend on how MemoryZipStream compresses files.
+static const std::string BuildStoredZip(
+    const std::vector<std::pair<std::string, std::string>>& files) {
+  std::string zip;
+  std::string central_directory;
+  for (const auto& file : files) {
+    const std::string& name = file.first;
+    const std::string& contents = file.second;
+    const uint32 crc = static_cast<uint32>(crc32(
+        0L, reinterpret_cast<const Bytef*>(contents.data()),
+        static_cast<uInt>(contents.size())));
+    const uint32 offset = static_cast<uint32>(zip.size());
+    const uint32 size = static_cast<uint32>(contents.size());
+    const uint32 name_size = static_cast<uint32>(name.size());
+    // Local file header: signature, version, flags, method, time, date, CRC,
+    // sizes, name length and extra field length.
+    AppendLittleEndian(0x04034b50U, 4U, &zip);
+    AppendLittleEndian(20U, 2U, &zip);
+    AppendLittleEndian(0U, 2U, &zip);
+    AppendLittleEndian(0U, 2U, &zip);
+    AppendLittleEndian(0U, 4U, &zip);
+    AppendLittleEndian(crc, 4U, &zip);
+    AppendLittleEndian(size, 4U, &zip);
+    AppendLittleEndian(size, 4U, &zip);
+    AppendLittleEndian(name_size, 2U, &zip);
+    AppendLittleEndian(0U, 2U, &zip);
+    zip += name;
+    zip += contents;
+    // Central directory header: as above, preceded by the version made by and
+    // followed by the comment length, disk, attributes and header offset.
+    AppendLittleEndian(0x02014b50U, 4U, &central_directory);
+    AppendLittleEndian(20U, 2U, &central_directory);
+    AppendLittleEndian(20U, 2U, &central_directory);
+    AppendLittleEndian(0U, 2U, &central_directory);
+    AppendLittleEndian(0U, 2U, &central_directory);
+    AppendLittleEndian(0U, 4U, &central_directory);
+    AppendLittleEndian(crc, 4U, &central_directory);
+    AppendLittleEndian(size, 4U, &central_directory);
+    AppendLittleEndian(size, 4U, &central_directory);
+    AppendLittleEndian(name_size, 2U, &central_directory);
+    AppendLittleEndian(0U, 2U, &central_directory);
+    AppendLittleEndian(0U, 2U, &central_directory);
+    AppendLittleEndian(0U, 2U, &central_directory);
+    AppendLittleEndian(0U, 2U, &central_directory);
+    AppendLittleEndian(0U, 4U, &central_directory);
+    AppendLittleEndian(offset, 4U, &central_directory);
+    central_directory += name;
+  }
+  const uint32 directory_offset = static_cast<uint32>(zip.size());
+  const uint32 count = static_cast<uint32>(files.size());
+  zip += central_directory;
+  // End of central directory record.
+  AppendLittleEndian(0x06054b50U, 4U, &zip);
+  AppendLittleEndian(0U, 2U, &zip);
+  AppendLittleEndian(0U, 2U, &zip);
+  AppendLittleEndian(count, 2U, &zip);
+  AppendLittleEndian(count, 2U, &zip);
+  AppendLittleEndian(static_cast<uint32>(central_directory.size()), 4U, &zip);
+  AppendLittleEndian(directory_offset, 4U, &zip);
+  AppendLittleEndian(0U, 2U, &zip);
+  return zip;
+}
+
 }  // anonymous namespace
 
 TEST(ZipAssetManager, InvalidData) {
@@ -304,6 +416,269 @@ TEST(ZipAssetManager, DuplicateRegister) {
 }
 #endif
 
+TEST(ZipAssetManager, GetGzippedFileDataPtr) {
+  const std::string data =
+      "Some file data that is long enough to be compressed, since it repeats: "
+      "Some file data that is long enough to be compressed, since it repeats.";
+  MemoryZipStream zipstream;
+  zipstream.AddFile("gzip.txt", data);
+  zipstream.AddFile("gzip2.txt", data);
+  EXPECT_TRUE(ZipAssetManager::RegisterAssetData(zipstream.GetData().data(),
+                                                 zipstream.GetData().size()));
+
+  EXPECT_FALSE(ZipAssetManager::GetGzippedFileDataPtr("does_not_exist"));
+
+  // The gzipped data is built from the zip without decompressing the file.
+  std::shared_ptr<const std::string> gzipped =
+      ZipAssetManager::GetGzippedFileDataPtr("gzip.txt");
+  ASSERT_TRUE(gzipped);
+  EXPECT_FALSE(ZipAssetManager::IsFileCached("gzip.txt"));
+  EXPECT_LT(gzipped->length(), data.length());
+  EXPECT_EQ(data, Gunzip(*gzipped));
+  // The data is cached.
+  EXPECT_EQ(gzipped, ZipAssetManager::GetGzippedFileDataPtr("gzip.txt"));
+
+  // Changing the data of a file invalidates its gzipped data.
+  EXPECT_TRUE(ZipAssetManager::SetFileData("gzip.txt", "new data"));
+  EXPECT_FALSE(ZipAssetManager::GetGzippedFileDataPtr("gzip.txt"));
+  gzipped = ZipAssetManager::GetGzippedFileDataPtr("gzip2.txt");
+  ASSERT_TRUE(gzipped);
+  EXPECT_EQ(data, Gunzip(*gzipped));
+  ZipAssetManager::Reset();
+}
+
+TEST(ZipAssetManager, GetStoredFileData) {
+  const char* data = NULL;
+  size_t size = 0U;
+  EXPECT_FALSE(ZipAssetManager::GetStoredFileData("stored.txt", &data, &size));
+
+  EXPECT_TRUE(ZipAssetManager::RegisterAssetData(kStoredZip,
+                                                 sizeof(kStoredZip)));
+  // The data is read in place from the registered bytes.
+  EXPECT_TRUE(ZipAssetManager::GetStoredFileData("stored.txt", &data, &size));
+  EXPECT_EQ("Stored data", std::string(data, size));
+  EXPECT_GE(data, reinterpret_cast<const char*>(kStoredZip));
+  EXPECT_LE(data + size,
+            reinterpret_cast<const char*>(kStoredZip) + sizeof(kStoredZip));
+  EXPECT_FALSE(ZipAssetManager::IsFileCached("stored.txt"));
+  EXPECT_EQ("Stored data", ZipAssetManager::GetFileData("stored.txt"));
+  // Stored files have no deflated data to wrap in gzip.
+  EXPECT_FALSE(ZipAssetManager::GetGzippedFileDataPtr("stored.txt"));
+
+  // Compressed files cannot be read in place.
+  MemoryZipStream zipstream;
+  zipstream.AddFile("deflated.txt", "Deflated data");
+  EXPECT_TRUE(ZipAssetManager::RegisterAssetData(zipstream.GetData().data(),
+                                                 zipstream.GetData().size()));
+  EXPECT_FALSE(
+      ZipAssetManager::GetStoredFileData("deflated.txt", &data, &size));
+  EXPECT_EQ("Deflated data", ZipAssetManager::GetFileData("deflated.txt"));
+
+  // Neither can files whose data has changed.
+  EXPECT_TRUE(ZipAssetManager::SetFileData("stored.txt", "new data"));
+  EXPECT_FALSE(ZipAssetManager::GetStoredFileData("stored.txt", &data, &size));
+  EXPECT_EQ("new data", ZipAssetManager::GetFileData("stored.txt"));
+  ZipAssetManager::Reset();
+}
+
+TEST(ZipAssetManager, CacheBudget) {
+  const std::string data_a(100, 'a');
+  const std::string data_b(100, 'b');
+  const std::string data_c(100, 'c');
+  MemoryZipStream zipstream;
+  zipstream.AddFile("a.txt", data_a);
+  zipstream.AddFile("b.txt", data_b);
+  zipstream.AddFile("c.txt", data_c);
+  EXPECT_TRUE(ZipAssetManager::RegisterAssetData(zipstream.GetData().data(),
+                                                 zipstream.GetData().size()));
+  EXPECT_EQ(0U, ZipAssetManager::GetCacheBudget());
+  EXPECT_EQ(0U, ZipAssetManager::GetCacheSize());
+
+  ZipAssetManager::SetCacheBudget(250U);
+  EXPECT_EQ(250U, ZipAssetManager::GetCacheBudget());
+  std::shared_ptr<const std::string> ptr_a =
+      ZipAssetManager::GetFileDataPtr("a.txt");
+  std::shared_ptr<const std::string> ptr_b =
+      ZipAssetManager::GetFileDataPtr("b.txt");
+  ASSERT_TRUE(ptr_a);
+  ASSERT_TRUE(ptr_b);
+  EXPECT_EQ(data_a, *ptr_a);
+  EXPECT_EQ(data_b, *ptr_b);
+  EXPECT_EQ(200U, ZipAssetManager::GetCacheSize());
+  EXPECT_TRUE(ZipAssetManager::IsFileCached("a.txt"));
+  EXPECT_TRUE(ZipAssetManager::IsFileCached("b.txt"));
+
+  // Extracting c drops a, the least recently used file.
+  std::shared_ptr<const std::string> ptr_c =
+      ZipAssetManager::GetFileDataPtr("c.txt");
+  ASSERT_TRUE(ptr_c);
+  EXPECT_EQ(data_c, *ptr_c);
+  EXPECT_EQ(200U, ZipAssetManager::GetCacheSize());
+  EXPECT_FALSE(ZipAssetManager::IsFileCached("a.txt"));
+  EXPECT_TRUE(ZipAssetManager::IsFileCached("b.txt"));
+  EXPECT_TRUE(ZipAssetManager::IsFileCached("c.txt"));
+
+  // Requesting b makes c the least recently used, so a replaces it. Pointers
+  // to dropped data remain valid.
+  EXPECT_EQ(data_b, *ZipAssetManager::GetFileDataPtr("b.txt"));
+  EXPECT_EQ(data_a, *ZipAssetManager::GetFileDataPtr("a.txt"));
+  EXPECT_EQ(200U, ZipAssetManager::GetCacheSize());
+  EXPECT_TRUE(ZipAssetManager::IsFileCached("a.txt"));
+  EXPECT_TRUE(ZipAssetManager::IsFileCached("b.txt"));
+  EXPECT_FALSE(ZipAssetManager::IsFileCached("c.txt"));
+  EXPECT_EQ(data_c, *ptr_c);
+
+  // Data returned by reference is pinned, since only the cache holds it, so
+  // less recently used data is dropped instead.
+  const std::string& ref_c = ZipAssetManager::GetFileData("c.txt");
+  EXPECT_EQ(200U, ZipAssetManager::GetCacheSize());
+  EXPECT_FALSE(ZipAssetManager::IsFileCached("b.txt"));
+  EXPECT_EQ(data_b, *ZipAssetManager::GetFileDataPtr("b.txt"));
+  EXPECT_EQ(200U, ZipAssetManager::GetCacheSize());
+  EXPECT_FALSE(ZipAssetManager::IsFileCached("a.txt"));
+  EXPECT_TRUE(ZipAssetManager::IsFileCached("c.txt"));
+  EXPECT_EQ(data_c, ref_c);
+
+  // Changed data does not count against the budget and is never dropped.
+  EXPECT_TRUE(ZipAssetManager::SetFileData("a.txt", "new data"));
+  EXPECT_EQ(200U, ZipAssetManager::GetCacheSize());
+  EXPECT_TRUE(ZipAssetManager::IsFileCached("a.txt"));
+
+  // Reading without caching removes data from the cache.
+  std::string out;
+  EXPECT_TRUE(ZipAssetManager::GetFileDataNoCache("b.txt", &out));
+  EXPECT_EQ(data_b, out);
+  EXPECT_EQ(100U, ZipAssetManager::GetCacheSize());
+
+  // Lowering the budget drops unpinned data immediately.
+  EXPECT_EQ(data_b, *ZipAssetManager::GetFileDataPtr("b.txt"));
+  EXPECT_EQ(200U, ZipAssetManager::GetCacheSize());
+  ZipAssetManager::SetCacheBudget(50U);
+  EXPECT_EQ(100U, ZipAssetManager::GetCacheSize());
+  EXPECT_FALSE(ZipAssetManager::IsFileCached("b.txt"));
+  EXPECT_TRUE(ZipAssetManager::IsFileCached("c.txt"));
+  EXPECT_EQ("new data", ZipAssetManager::GetFileData("a.txt"));
+
+  ZipAssetManager::SetCacheBudget(0U);
+  ZipAssetManager::Reset();
+  EXPECT_EQ(0U, ZipAssetManager::GetCacheSize());
+}
+
+TEST(ZipAssetManager, EmptyDeflatedFile) {
+  MemoryZipStream zipstream;
+  zipstream.AddFile("empty.txt", std::string());
+  EXPECT_TRUE(ZipAssetManager::RegisterAssetData(zipstream.GetData().data(),
+                                                 zipstream.GetData().size()));
+  // The file is deflated even though it is empty.
+  const char* data = NULL;
+  size_t size = 0U;
+  EXPECT_FALSE(ZipAssetManager::GetStoredFileData("empty.txt", &data, &size));
+  const std::string& contents = ZipAssetManager::GetFileData("empty.txt");
+  EXPECT_FALSE(IsInvalidReference(contents));
+  EXPECT_TRUE(contents.empty());
+  std::string out("not empty");
+  EXPECT_TRUE(ZipAssetManager::GetFileDataNoCache("empty.txt", &out));
+  EXPECT_TRUE(out.empty());
+  ZipAssetManager::Reset();
+}
+
+TEST(ZipAssetManager, ConcurrentReads) {
+  static const int kFileCount = 8;
+  static const int kThreadCount = 4;
+  MemoryZipStream zipstream;
+  std::vector<std::string> names;
+  std::vector<std::string> contents;
+  for (int i = 0; i < kFileCount; ++i) {
+    names.push_back("file" + ValueToString(i) + ".txt");
+    contents.push_back(std::string(1000 + i, static_cast<char>('a' + i)));
+    zipstream.AddFile(names.back(), contents.back());
+  }
+  EXPECT_TRUE(ZipAssetManager::RegisterAssetData(zipstream.GetData().data(),
+                                                 zipstream.GetData().size()));
+  // Use a budget that forces files to be dropped and extracted again while
+  // other threads read them.
+  ZipAssetManager::SetCacheBudget(3000U);
+
+  std::atomic<int> failures(0);
+  auto read_files = [&]() {
+    for (int pass = 0; pass < 50; ++pass) {
+      for (int i = 0; i < kFileCount; ++i) {
+        std::shared_ptr<const std::string> data =
+            ZipAssetManager::GetFileDataPtr(names[i]);
+        if (!data || *data != contents[i])
+          ++failures;
+      }
+    }
+    return true;
+  };
+  {
+    std::vector<std::unique_ptr<ThreadSpawner>> threads;
+    for (int i = 0; i < kThreadCount; ++i)
+      threads.push_back(std::unique_ptr<ThreadSpawner>(
+          new ThreadSpawner("Reader", read_files)));
+  }
+  EXPECT_EQ(0, failures);
+
+  ZipAssetManager::SetCacheBudget(0U);
+  ZipAssetManager::Reset();
+}
+
+TEST(ZipAssetManager, PinnedDataOverBudget) {
+  std::vector<std::pair<std::string, std::string>> files;
+  files.push_back(std::make_pair("a.txt", std::string(100, 'a')));
+  files.push_back(std::make_pair("b.txt", std::string(100, 'b')));
+  files.push_back(std::make_pair("c.txt", std::string(100, 'c')));
+  const std::string zip = BuildStoredZip(files);
+  EXPECT_TRUE(ZipAssetManager::RegisterAssetData(zip.data(), zip.size()));
+  ZipAssetManager::SetCacheBudget(50U);
+
+  // Pinned data stays cached even though it exceeds the budget.
+  EXPECT_EQ(files[0].second, ZipAssetManager::GetFileData("a.txt"));
+  EXPECT_EQ(files[1].second, ZipAssetManager::GetFileData("b.txt"));
+  EXPECT_EQ(200U, ZipAssetManager::GetCacheSize());
+  EXPECT_TRUE(ZipAssetManager::IsFileCached("a.txt"));
+  EXPECT_TRUE(ZipAssetManager::IsFileCached("b.txt"));
+
+  // Unpinned data is still dropped right away.
+  std::shared_ptr<const std::string> ptr_c =
+      ZipAssetManager::GetFileDataPtr("c.txt");
+  ASSERT_TRUE(ptr_c);
+  EXPECT_EQ(files[2].second, *ptr_c);
+  EXPECT_EQ(200U, ZipAssetManager::GetCacheSize());
+  EXPECT_FALSE(ZipAssetManager::IsFileCached("c.txt"));
+
+  // With only pinned data over the budget, reads do not lock the manager for
+  // writing. If they did, the reader below would block until this thread
+  // releases its read lock.
+  port::Semaphore done;
+  std::unique_ptr<ThreadSpawner> reader;
+  {
+    ZipAssetManager* manager = ZipAssetManager::GetManager();
+    ReadLock read_lock(&manager->lock_);
+    ReadGuard guard(&read_lock);
+    reader.reset(new ThreadSpawner("Reader", [&done]() {
+      ZipAssetManager::GetFileData("a.txt");
+      done.Post();
+      return true;
+    }));
+    EXPECT_TRUE(done.TimedWaitMs(10000));
+  }
+  reader.reset();
+
+  // Reading without caching unpins and drops the data.
+  std::string out;
+  EXPECT_TRUE(ZipAssetManager::GetFileDataNoCache("a.txt", &out));
+  EXPECT_EQ(files[0].second, out);
+  EXPECT_EQ(100U, ZipAssetManager::GetCacheSize());
+  EXPECT_EQ(files[0].second, *ZipAssetManager::GetFileDataPtr("a.txt"));
+  EXPECT_EQ(100U, ZipAssetManager::GetCacheSize());
+  EXPECT_FALSE(ZipAssetManager::IsFileCached("a.txt"));
+
+  ZipAssetManager::SetCacheBudget(0U);
+  ZipAssetManager::Reset();
+  EXPECT_EQ(0U, ZipAssetManager::GetCacheSize());
+}
+
 // NaCl has no file support.
 #if !defined(ION_PLATFORM_NACL)
 TEST(ZipAssetManager, SaveFileDataUpdateFileIfChanged) {
@@ -390,5 +765,38 @@ TEST(ZipAssetManager, SaveFileDataUpdateFileIfChanged) {
 }
 #endif
 
+// NaCl has no file support.
+#if !defined(ION_PLATFORM_NACL)
+TEST(ZipAssetManager, RegisterAssetFile) {
+  LogChecker checker;
+  EXPECT_FALSE(ZipAssetManager::RegisterAssetFile("not/a/real/file.zip"));
+  EXPECT_TRUE(checker.HasMessage("ERROR", "Unable to map"));
+
+  // Write a zip to disk and map it.
+  const std::string temp_filename = port::GetTemporaryFilename();
+  EXPECT_FALSE(temp_filename.empty());
+  MemoryZipStream zipstream;
+  zipstream.AddFile("mapped.txt", "Mapped data");
+  FILE* fp = port::OpenFile(temp_filename, "wb");
+  ASSERT_FALSE(fp == NULL);
+  fwrite(zipstream.GetData().data(), 1, zipstream.GetData().size(), fp);
+  fclose(fp);
+  EXPECT_TRUE(ZipAssetManager::RegisterAssetFile(temp_filename));
+  EXPECT_EQ("Mapped data", ZipAssetManager::GetFileData("mapped.txt"));
+  // Resetting the manager unmaps the file.
+  ZipAssetManager::Reset();
+  EXPECT_FALSE(ZipAssetManager::ContainsFile("mapped.txt"));
+
+  // Files that are not zips are not registered.
+  fp = port::OpenFile(temp_filename, "wb");
+  ASSERT_FALSE(fp == NULL);
+  fputs("Not a zip file", fp);
+  fclose(fp);
+  EXPECT_FALSE(ZipAssetManager::RegisterAssetFile(temp_filename));
+  EXPECT_FALSE(ZipAssetManager::ContainsFile("mapped.txt"));
+  EXPECT_TRUE(port::RemoveFile(temp_filename));
+}
+#endif
+
 }  // namespace base
 }  // namespace ion
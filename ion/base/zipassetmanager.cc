@@ -17,20 +17,19 @@ limitations under the License.
 
 #include "ion/base/zipassetmanager.h"
 
+#include <algorithm>
 #include <cstring>
+#include <utility>
 #include <vector>
 
 #include "ion/base/invalid.h"
 #include "ion/base/lockguards.h"
 #include "ion/base/logging.h"
-#include "ion/base/scopedallocation.h"
 #include "ion/base/staticsafedeclare.h"
 #include "ion/base/stringutils.h"
 #include "ion/port/fileutils.h"
 
-#include "third_party/unzip/unzip.h"
-// unzip.h must be included before ioapi.h for types to be defined correctly.
-#include "third_party/zlib/src/contrib/minizip/ioapi.h"
+#include "third_party/zlib/src/zlib.h"
 
 namespace ion {
 namespace base {
@@ -39,87 +38,259 @@ namespace {
 
 static const char kManifestFilename[] = "__asset_manifest__.txt";
 
+// The size of the gzip member header and trailer (RFC 1952) that wrap the
+// deflated data of a file.
+static const size_t kGzipHeaderSize = 10U;
+static const size_t kGzipTrailerSize = 8U;
+
+// Zip record signatures and sizes (see the PKWARE APPNOTE.TXT).
+static const uint32 kEndOfCentralDirSignature = 0x06054b50;
+static const uint32 kCentralDirHeaderSignature = 0x02014b50;
+static const uint32 kLocalHeaderSignature = 0x04034b50;
+static const size_t kEndOfCentralDirSize = 22U;
+static const size_t kCentralDirHeaderSize = 46U;
+static const size_t kLocalHeaderSize = 30U;
+// The maximum length of the zip file comment, which follows the end of central
+// directory record.
+static const size_t kMaxCommentSize = 0xffff;
+
+// Zip compression methods.
+static const uint16 kStored = 0;
+static const uint16 kDeflated = 8;
+
+// Stores |value| in little-endian byte order at |dest|.
+static void StoreLittleEndian32(uint32 value, char* dest) {
+  for (int i = 0; i < 4; ++i)
+    dest[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+// Returns the little-endian values at |src|.
+static uint16 LoadLittleEndian16(const char* src) {
+  const uint8* bytes = reinterpret_cast<const uint8*>(src);
+  return static_cast<uint16>(bytes[0] | (bytes[1] << 8));
+}
+static uint32 LoadLittleEndian32(const char* src) {
+  const uint8* bytes = reinterpret_cast<const uint8*>(src);
+  return static_cast<uint32>(bytes[0]) |
+      (static_cast<uint32>(bytes[1]) << 8) |
+      (static_cast<uint32>(bytes[2]) << 16) |
+      (static_cast<uint32>(bytes[3]) << 24);
+}
+
+// Returns the offset of the end of central directory record in the zip in
+// |data|, or |data_size| if there is none.
+static size_t FindEndOfCentralDir(const char* data, size_t data_size) {
+  if (data_size < kEndOfCentralDirSize)
+    return data_size;
+  // The record is at the end of the data unless the zip has a comment.
+  const size_t last = data_size - kEndOfCentralDirSize;
+  const size_t first = last > kMaxCommentSize ? last - kMaxCommentSize : 0U;
+  for (size_t offset = last + 1; offset-- > first;) {
+    if (LoadLittleEndian32(data + offset) == kEndOfCentralDirSignature &&
+        offset + kEndOfCentralDirSize +
+            LoadLittleEndian16(data + offset + 20) == data_size)
+      return offset;
+  }
+  return data_size;
+}
+
+// Extracts the data of the file described by |info| into |out|. Returns false
+// if the data is corrupt or uses an unsupported compression method.
+static bool ExtractFile(const char* zip_data, size_t compressed_size,
+                        size_t uncompressed_size, uint16 compression_method,
+                        std::string* out) {
+  if (compression_method == kStored) {
+    out->assign(zip_data, compressed_size);
+    return true;
+  } else if (compression_method != kDeflated) {
+    return false;
+  } else if (!uncompressed_size) {
+    // zlib rejects a NULL output buffer, so there is nothing to inflate into.
+    out->clear();
+    return true;
+  }
+  out->resize(uncompressed_size);
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // Negative window bits make zlib read the raw deflate data stored in zips.
+  if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+    return false;
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(zip_data));
+  stream.avail_in = static_cast<uInt>(compressed_size);
+  stream.next_out = reinterpret_cast<Bytef*>(&(*out)[0]);
+  stream.avail_out = static_cast<uInt>(uncompressed_size);
+  const int result = inflate(&stream, Z_FINISH);
+  const size_t total_out = stream.total_out;
+  inflateEnd(&stream);
+  return result == Z_STREAM_END && total_out == uncompressed_size;
+}
+
 }  // anonymous namespace
 
-ZipAssetManager::ZipAssetManager() {}
+ZipAssetManager::FileInfo::FileInfo()
+    : zip_data(NULL),
+      compressed_size(0U),
+      uncompressed_size(0U),
+      compression_method(kStored),
+      crc(0U),
+      last_use(0U),
+      pinned(false),
+      modified(false) {}
+
+ZipAssetManager::ZipAssetManager()
+    : cache_size_(0U),
+      pinned_size_(0U),
+      cache_budget_(0U),
+      use_counter_(0U) {}
 
 ZipAssetManager::~ZipAssetManager() {
   Reset();
 }
 
 bool ZipAssetManager::RegisterAssetData(const void* data, size_t data_size) {
-  // Open the zip data and add entries for its files to the cache.
-  zlib_filefunc_def def;
-  voidpf mem_zipfile =
-      mem_simple_create_file(&def, const_cast<void*>(data), data_size);
-  if (void* zipfile = unzAttach(mem_zipfile, &def)) {
-    // Associate each file with the zipfile it comes from.
-    FileInfo file_info;
-    file_info.zip_handle = zipfile;
-    ZipAssetManager* manager = GetManager();
-    LockGuard guard(&manager->mutex_);
-    manager->zipfiles_.insert(zipfile);
-
-    bool contains_manifest = false;
-    {
-      // Buffer for filenames.
-      static const int kBufSize = 1024;
-      base::ScopedAllocation<char> buf(base::kShortTerm, kBufSize);
-      unz_file_info info;
-      do {
-        if (unzGetCurrentFileInfo(
-                zipfile, &info, buf.Get(), kBufSize, 0, 0, 0, 0) == UNZ_OK) {
+  ZipAssetManager* manager = GetManager();
+  WriteLock write_lock(&manager->lock_);
+  WriteGuard guard(&write_lock);
+  return manager->RegisterZipDataLocked(static_cast<const char*>(data),
+                                        data_size);
+}
+
+bool ZipAssetManager::RegisterAssetFile(const std::string& path) {
+  std::unique_ptr<port::MemoryMappedFile> mapped_file(
+      new port::MemoryMappedFile(path));
+  if (!mapped_file->GetData()) {
+    LOG(ERROR) << "Unable to map zip asset file \"" << path << "\"";
+    return false;
+  }
+  ZipAssetManager* manager = GetManager();
+  WriteLock write_lock(&manager->lock_);
+  WriteGuard guard(&write_lock);
+  if (!manager->RegisterZipDataLocked(
+          static_cast<const char*>(mapped_file->GetData()),
+          mapped_file->GetLength()))
+    return false;
+  manager->mapped_files_.push_back(std::move(mapped_file));
+  return true;
+}
+
+bool ZipAssetManager::RegisterZipDataLocked(const char* data,
+                                            size_t data_size) {
+  const size_t end_offset = FindEndOfCentralDir(data, data_size);
+  if (end_offset == data_size)
+    return false;
+  const char* end = data + end_offset;
+  const size_t entry_count = LoadLittleEndian16(end + 10);
+  const size_t dir_size = LoadLittleEndian32(end + 12);
+  const size_t dir_offset = LoadLittleEndian32(end + 16);
+  if (dir_offset > end_offset || dir_size > end_offset - dir_offset)
+    return false;
+
+  // Read all entries before changing the cache, so that corrupt data does not
+  // register anything.
+  std::vector<std::pair<std::string, FileInfo*>> entries;
+  std::vector<std::unique_ptr<FileInfo>> infos;
+  const char* header = data + dir_offset;
+  const char* dir_end = header + dir_size;
+  for (size_t i = 0; i < entry_count; ++i) {
+    if (dir_end - header < static_cast<ptrdiff_t>(kCentralDirHeaderSize) ||
+        LoadLittleEndian32(header) != kCentralDirHeaderSignature)
+      return false;
+    const size_t name_length = LoadLittleEndian16(header + 28);
+    const size_t record_size = kCentralDirHeaderSize + name_length +
+        LoadLittleEndian16(header + 30) + LoadLittleEndian16(header + 32);
+    if (static_cast<size_t>(dir_end - header) < record_size)
+      return false;
+    std::unique_ptr<FileInfo> info(new FileInfo);
+    info->compression_method = LoadLittleEndian16(header + 10);
+    info->crc = LoadLittleEndian32(header + 16);
+    info->compressed_size = LoadLittleEndian32(header + 20);
+    info->uncompressed_size = LoadLittleEndian32(header + 24);
+    // The data follows the local header, whose variable-length fields may
+    // differ from those in the central directory.
+    const size_t local_offset = LoadLittleEndian32(header + 42);
+    if (local_offset > dir_offset ||
+        dir_offset - local_offset < kLocalHeaderSize)
+      return false;
+    const char* local = data + local_offset;
+    if (LoadLittleEndian32(local) != kLocalHeaderSignature)
+      return false;
+    const size_t data_offset = local_offset + kLocalHeaderSize +
+        LoadLittleEndian16(local + 26) + LoadLittleEndian16(local + 28);
+    if (data_offset > dir_offset ||
+        info->compressed_size > dir_offset - data_offset)
+      return false;
+    info->zip_data = data + data_offset;
+    entries.push_back(std::make_pair(
+        std::string(header + kCentralDirHeaderSize, name_length), info.get()));
+    infos.push_back(std::move(info));
+    header += record_size;
+  }
+
+  bool contains_manifest = false;
+  for (const auto& entry : entries) {
+    const std::string& name = entry.first;
+    const FileInfo& source = *entry.second;
+    FileCache::iterator it = file_cache_.find(name);
+    if (it != file_cache_.end()) {
 #if ION_DEBUG
-          if (manager->file_cache_.find(buf.Get()) !=
-              manager->file_cache_.end()) {
-            DLOG(WARNING)
-                << "Same file registered multiple times risks use after free "
-                << "if the result of GetFileData is still in use. "
-                << "Duplicate entry: " << buf.Get();
-          }
+      DLOG(WARNING)
+          << "Same file registered multiple times risks use after free "
+          << "if the result of GetFileData is still in use. "
+          << "Duplicate entry: " << name;
 #endif
-          manager->file_cache_[buf.Get()] = file_info;
-          manager->file_cache_[buf.Get()].data_ptr.reset(new std::string());
-          if (strcmp(kManifestFilename, buf.Get()) == 0)
-            contains_manifest = true;
-        }
-      } while (unzGoToNextFile(zipfile) == UNZ_OK);
+      DropCachedData(&it->second);
     }
+    FileInfo& info = file_cache_[name];
+    info.zip_data = source.zip_data;
+    info.compressed_size = source.compressed_size;
+    info.uncompressed_size = source.uncompressed_size;
+    info.compression_method = source.compression_method;
+    info.crc = source.crc;
+    info.timestamp = std::chrono::system_clock::time_point();
+    info.data_ptr.reset();
+    info.gzip_data_ptr.reset();
+    info.last_use = 0U;
+    info.pinned = false;
+    info.modified = false;
+    info.original_name.clear();
+    if (name == kManifestFilename)
+      contains_manifest = true;
+  }
 
-    // Save the manifest mappings from local filenames to zip names.
-    if (contains_manifest) {
-      // Must not release the lock before erasing the manifest or another
-      // registration may replace it while it is being read.
-      const std::vector<std::string> mappings =
-          base::SplitString(
-              manager->GetFileDataLocked(kManifestFilename, NULL), "\n");
-      const size_t count = mappings.size();
-      for (size_t i = 0; i < count; ++i) {
-        std::vector<std::string> mapping =
-            base::SplitString(mappings[i], "|");
-        DCHECK_EQ(2U, mapping.size());
-        while (base::StartsWith(mapping[0], "/"))
-          base::RemovePrefix("/", &mapping[0]);
-        FileCache::iterator it =
-            manager->file_cache_.find(port::GetCanonicalFilePath(mapping[0]));
-        DCHECK(it != manager->file_cache_.end());
-        it->second.original_name = mapping[1];
-        it->second.timestamp = std::chrono::system_clock::time_point();
-        port::GetFileModificationTime(mapping[1], &it->second.timestamp);
-      }
-      // We don't need to save the manifest file data.
-      manager->file_cache_.erase(kManifestFilename);
+  // Save the manifest mappings from local filenames to zip names.
+  if (contains_manifest) {
+    FileCache::iterator manifest_it = file_cache_.find(kManifestFilename);
+    const FileInfo& manifest = manifest_it->second;
+    std::string manifest_data;
+    ExtractFile(manifest.zip_data, manifest.compressed_size,
+                manifest.uncompressed_size, manifest.compression_method,
+                &manifest_data);
+    const std::vector<std::string> mappings =
+        base::SplitString(manifest_data, "\n");
+    const size_t count = mappings.size();
+    for (size_t i = 0; i < count; ++i) {
+      std::vector<std::string> mapping =
+          base::SplitString(mappings[i], "|");
+      DCHECK_EQ(2U, mapping.size());
+      while (base::StartsWith(mapping[0], "/"))
+        base::RemovePrefix("/", &mapping[0]);
+      FileCache::iterator it =
+          file_cache_.find(port::GetCanonicalFilePath(mapping[0]));
+      DCHECK(it != file_cache_.end());
+      it->second.original_name = mapping[1];
+      it->second.timestamp = std::chrono::system_clock::time_point();
+      port::GetFileModificationTime(mapping[1], &it->second.timestamp);
     }
-    return true;
-  } else {
-    free(mem_zipfile);
-    return false;
+    // We don't need to save the manifest file data.
+    file_cache_.erase(manifest_it);
   }
+  return true;
 }
 
 bool ZipAssetManager::ContainsFile(const std::string& filename) {
   ZipAssetManager* manager = GetManager();
-  LockGuard guard(&manager->mutex_);
+  ReadLock read_lock(&manager->lock_);
+  ReadGuard guard(&read_lock);
   return manager->ContainsFileLocked(filename);
 }
 
@@ -129,7 +300,8 @@ bool ZipAssetManager::ContainsFileLocked(const std::string& filename) {
 
 bool ZipAssetManager::IsFileCached(const std::string& filename) {
   ZipAssetManager* manager = GetManager();
-  LockGuard guard(&manager->mutex_);
+  ReadLock read_lock(&manager->lock_);
+  ReadGuard guard(&read_lock);
   FileCache::const_iterator it = manager->file_cache_.find(filename);
   return it != manager->file_cache_.end() &&
       manager->FileIsCached(it->second);
@@ -137,7 +309,8 @@ bool ZipAssetManager::IsFileCached(const std::string& filename) {
 
 std::vector<std::string> ZipAssetManager::GetRegisteredFileNames() {
   ZipAssetManager* manager = GetManager();
-  LockGuard guard(&manager->mutex_);
+  ReadLock read_lock(&manager->lock_);
+  ReadGuard guard(&read_lock);
   std::vector<std::string> filenames;
   for (const auto& file : manager->file_cache_)
     filenames.push_back(file.first);
@@ -147,113 +320,290 @@ std::vector<std::string> ZipAssetManager::GetRegisteredFileNames() {
 std::shared_ptr<const std::string> ZipAssetManager::GetFileDataPtr(
     const std::string& filename) {
   ZipAssetManager* manager = GetManager();
-  LockGuard guard(&manager->mutex_);
-  if (!IsInvalidReference(manager->GetFileDataLocked(filename, NULL))) {
+  std::shared_ptr<const std::string> data;
+  {
+    ReadLock read_lock(&manager->lock_);
+    ReadGuard guard(&read_lock);
     FileCache::iterator it = manager->file_cache_.find(filename);
-    return it->second.data_ptr;
+    if (it != manager->file_cache_.end())
+      data = manager->GetCachedDataLocked(&it->second);
   }
-  return std::shared_ptr<const std::string>();
+  // The caller holds its own reference, so the data may be dropped.
+  manager->EvictCachedDataIfOverBudget();
+  return data;
 }
 
 const std::string& ZipAssetManager::GetFileData(const std::string& filename) {
   ZipAssetManager* manager = GetManager();
-  LockGuard guard(&manager->mutex_);
-  return manager->GetFileDataLocked(filename, NULL);
+  const std::string* data;
+  {
+    ReadLock read_lock(&manager->lock_);
+    ReadGuard guard(&read_lock);
+    data = &manager->GetFileDataLocked(filename, NULL);
+  }
+  manager->EvictCachedDataIfOverBudget();
+  return *data;
 }
 
 bool ZipAssetManager::GetFileDataNoCache(const std::string& filename,
                                          std::string* out) {
   ZipAssetManager* manager = GetManager();
-  LockGuard guard(&manager->mutex_);
+  {
+    ReadLock read_lock(&manager->lock_);
+    ReadGuard guard(&read_lock);
+    FileCache::const_iterator it = manager->file_cache_.find(filename);
+    if (it == manager->file_cache_.end())
+      return false;
+    // Data that is not cached can be extracted while other readers continue.
+    const FileInfo& info = it->second;
+    if (!FileIsCached(info)) {
+      out->clear();
+      return ExtractFile(info.zip_data, info.compressed_size,
+                         info.uncompressed_size, info.compression_method, out);
+    }
+  }
+  // Other readers may be using cached data, so it is only dropped while the
+  // lock is held for writing.
+  WriteLock write_lock(&manager->lock_);
+  WriteGuard guard(&write_lock);
   return !IsInvalidReference(manager->GetFileDataLocked(filename, out));
 }
 
+std::shared_ptr<const std::string> ZipAssetManager::GetGzippedFileDataPtr(
+    const std::string& filename) {
+  ZipAssetManager* manager = GetManager();
+  ReadLock read_lock(&manager->lock_);
+  ReadGuard guard(&read_lock);
+  FileCache::iterator it = manager->file_cache_.find(filename);
+  if (it == manager->file_cache_.end() || it->second.modified)
+    return std::shared_ptr<const std::string>();
+  FileInfo& info = it->second;
+  std::shared_ptr<const std::string> gzip =
+      std::atomic_load(&info.gzip_data_ptr);
+  if (!gzip && info.compression_method == kDeflated) {
+    // A gzip member is the raw deflate stream stored in the zip, preceded by
+    // a fixed header (magic, deflate method, no flags, no modification time,
+    // unknown OS) and followed by the CRC-32 and size of the data.
+    static const char kGzipHeader[kGzipHeaderSize] = {
+        '\x1f', '\x8b', '\x08', 0, 0, 0, 0, 0, 0, '\xff'};
+    const size_t compressed_size = info.compressed_size;
+    std::shared_ptr<std::string> assembled(new std::string(
+        kGzipHeaderSize + compressed_size + kGzipTrailerSize, '\0'));
+    memcpy(&(*assembled)[0], kGzipHeader, kGzipHeaderSize);
+    memcpy(&(*assembled)[kGzipHeaderSize], info.zip_data, compressed_size);
+    char* trailer = &(*assembled)[kGzipHeaderSize + compressed_size];
+    StoreLittleEndian32(info.crc, trailer);
+    StoreLittleEndian32(static_cast<uint32>(info.uncompressed_size),
+                        trailer + 4);
+    // Another reader may have assembled the data concurrently, in which case
+    // |gzip| is set to its result.
+    if (std::atomic_compare_exchange_strong(
+            &info.gzip_data_ptr, &gzip,
+            std::shared_ptr<const std::string>(assembled)))
+      gzip = assembled;
+  }
+  return gzip;
+}
+
+bool ZipAssetManager::GetStoredFileData(const std::string& filename,
+                                        const char** data, size_t* size) {
+  ZipAssetManager* manager = GetManager();
+  ReadLock read_lock(&manager->lock_);
+  ReadGuard guard(&read_lock);
+  FileCache::const_iterator it = manager->file_cache_.find(filename);
+  if (it == manager->file_cache_.end() || it->second.modified ||
+      it->second.compression_method != kStored)
+    return false;
+  *data = it->second.zip_data;
+  *size = it->second.compressed_size;
+  return true;
+}
+
 const std::string& ZipAssetManager::GetFileDataLocked(
     const std::string& filename, std::string* out) {
-  if (!ContainsFileLocked(filename)) {
+  FileCache::iterator it = file_cache_.find(filename);
+  if (it == file_cache_.end()) {
     // Return an empty string if the file does not exist in the archive.
     return InvalidReference<const std::string>();
-  } else {
-    FileCache::iterator it = file_cache_.find(filename);
-    if (!FileIsCached(it->second)) {
-      // If |out| is NULL, then we write to FileInfo cache.
-      if (!out)
-        out = it->second.data_ptr.get();
-      else
-        out->clear();
-      // Try to extract the file from the zip.
-      unz_file_info info;
-      if (unzLocateFile(it->second.zip_handle, filename.c_str(), 0) == UNZ_OK &&
-          unzOpenCurrentFile(it->second.zip_handle) == UNZ_OK &&
-          unzGetCurrentFileInfo(
-              it->second.zip_handle, &info, 0, 0, 0, 0, 0, 0) ==
-              UNZ_OK) {
-        // Resize the string to accommodate the data.
-        out->resize(info.uncompressed_size);
-        // Decompress the file.
-        unzReadCurrentFile(it->second.zip_handle, &(*out)[0],
-                           static_cast<unsigned int>(info.uncompressed_size));
-      }
+  }
+  FileInfo& info = it->second;
+  if (out) {
+    // Changed data cannot be extracted again, so it is copied rather than
+    // stolen.
+    if (info.modified) {
+      *out = *std::atomic_load(&info.data_ptr);
       return *out;
-    } else if (out) {
-      // |out| steals cached data, clearing it.
-      out->clear();
-      out->swap(*it->second.data_ptr);
+    }
+    // |out| steals cached data, clearing it.
+    if (std::shared_ptr<std::string> cached = DropCachedData(&info)) {
+      // Copy the data if someone else still holds the pointer.
+      if (cached.use_count() == 1) {
+        out->swap(*cached);
+      } else {
+        *out = *cached;
+      }
       return *out;
-    } else {
-      return *it->second.data_ptr;
     }
+    out->clear();
+    if (!ExtractFile(info.zip_data, info.compressed_size,
+                     info.uncompressed_size, info.compression_method, out))
+      return InvalidReference<const std::string>();
+    return *out;
+  }
+
+  // The returned reference is only backed by the cache, so pin the data to
+  // keep eviction from dropping it. Cached data is only dropped while the lock
+  // is held for writing, so |data| stays cached until then.
+  const std::shared_ptr<std::string> data = GetCachedDataLocked(&info);
+  if (!data)
+    return InvalidReference<const std::string>();
+  if (!info.modified && !info.pinned.exchange(true))
+    pinned_size_ += data->size();
+  return *data;
+}
+
+std::shared_ptr<std::string> ZipAssetManager::GetCachedDataLocked(
+    FileInfo* info) {
+  info->last_use.store(++use_counter_, std::memory_order_relaxed);
+  std::shared_ptr<std::string> data = std::atomic_load(&info->data_ptr);
+  if (!data) {
+    std::shared_ptr<std::string> extracted(new std::string);
+    if (!ExtractFile(info->zip_data, info->compressed_size,
+                     info->uncompressed_size, info->compression_method,
+                     extracted.get()))
+      return std::shared_ptr<std::string>();
+    // Count the data before publishing it, so that the size never drops below
+    // zero if the data is dropped right away. Another reader may have
+    // extracted the file concurrently, in which case |data| is set to its
+    // result.
+    cache_size_ += extracted->size();
+    if (std::atomic_compare_exchange_strong(&info->data_ptr, &data,
+                                            extracted))
+      data = extracted;
+    else
+      cache_size_ -= extracted->size();
+  }
+  return data;
+}
+
+std::shared_ptr<std::string> ZipAssetManager::DropCachedData(FileInfo* info) {
+  std::shared_ptr<std::string> data =
+      std::atomic_exchange(&info->data_ptr, std::shared_ptr<std::string>());
+  if (data && !info->modified) {
+    cache_size_ -= data->size();
+    if (info->pinned.exchange(false))
+      pinned_size_ -= data->size();
+  }
+  return data;
+}
+
+void ZipAssetManager::EvictCachedDataIfOverBudget() {
+  // Pinned data cannot be dropped, so there is nothing to do if all of the
+  // data over the budget is pinned.
+  const size_t budget = cache_budget_;
+  const size_t size = cache_size_;
+  if (!budget || size <= budget || size <= pinned_size_)
+    return;
+  WriteLock write_lock(&lock_);
+  WriteGuard guard(&write_lock);
+  EvictCachedDataLocked();
+}
+
+void ZipAssetManager::EvictCachedDataLocked() {
+  std::vector<std::pair<uint64, FileInfo*>> candidates;
+  for (auto& file : file_cache_) {
+    FileInfo* info = &file.second;
+    if (!info->modified && !info->pinned && FileIsCached(*info))
+      candidates.push_back(std::make_pair(info->last_use.load(), info));
+  }
+  std::sort(candidates.begin(), candidates.end());
+  for (const auto& candidate : candidates) {
+    if (cache_size_ <= cache_budget_)
+      break;
+    DropCachedData(candidate.second);
   }
 }
 
 bool ZipAssetManager::SetFileData(const std::string& filename,
                                   const std::string& source) {
   ZipAssetManager* manager = GetManager();
-  LockGuard guard(&manager->mutex_);
+  WriteLock write_lock(&manager->lock_);
+  WriteGuard guard(&write_lock);
   if (!manager->ContainsFileLocked(filename)) {
     return false;
   } else {
     FileCache::iterator it = manager->file_cache_.find(filename);
-    *it->second.data_ptr = source;
-    it->second.timestamp = std::chrono::system_clock::now();
+    FileInfo& info = it->second;
+    // Changed data is no longer part of the cache, so it cannot be dropped.
+    std::shared_ptr<std::string> data = manager->DropCachedData(&info);
+    if (!data)
+      data.reset(new std::string);
+    *data = source;
+    info.data_ptr = data;
+    info.timestamp = std::chrono::system_clock::now();
+    info.gzip_data_ptr.reset();
+    info.modified = true;
     return true;
   }
 }
 
 bool ZipAssetManager::SaveFileData(const std::string& filename) {
   ZipAssetManager* manager = GetManager();
-  LockGuard guard(&manager->mutex_);
-  const std::string& data = manager->GetFileDataLocked(filename, NULL);
-  // Find the filename in the cache.
-  FileCache::const_iterator it = manager->file_cache_.find(filename);
-  if (it != manager->file_cache_.end() &&
-      !base::IsInvalidReference(data) && !it->second.original_name.empty()) {
-    // Attempt to overwrite the file.
-    if (FILE* fp = port::OpenFile(it->second.original_name, "wb")) {
+  std::shared_ptr<std::string> data;
+  std::string original_name;
+  {
+    ReadLock read_lock(&manager->lock_);
+    ReadGuard guard(&read_lock);
+    // Find the filename in the cache.
+    FileCache::iterator it = manager->file_cache_.find(filename);
+    if (it == manager->file_cache_.end() || it->second.original_name.empty())
+      return false;
+    data = manager->GetCachedDataLocked(&it->second);
+    original_name = it->second.original_name;
+  }
+  manager->EvictCachedDataIfOverBudget();
+  // Attempt to overwrite the file.
+  if (data) {
+    if (FILE* fp = port::OpenFile(original_name, "wb")) {
       const size_t count =
-          fwrite(data.c_str(), sizeof(data[0]), data.length(), fp);
+          fwrite(data->c_str(), sizeof((*data)[0]), data->length(), fp);
       fclose(fp);
-      return count == data.length();
+      return count == data->length();
     }
   }
   return false;
 }
 
+void ZipAssetManager::SetCacheBudget(size_t budget) {
+  ZipAssetManager* manager = GetManager();
+  manager->cache_budget_ = budget;
+  manager->EvictCachedDataIfOverBudget();
+}
+
+size_t ZipAssetManager::GetCacheBudget() {
+  return GetManager()->cache_budget_;
+}
+
+size_t ZipAssetManager::GetCacheSize() {
+  return GetManager()->cache_size_;
+}
+
 void ZipAssetManager::Reset() {
   ZipAssetManager* manager = GetManager();
-  LockGuard guard(&manager->mutex_);
-  for (std::set<void*>::iterator it = manager->zipfiles_.begin();
-       it != manager->zipfiles_.end(); it++)
-    unzClose(*it);
+  WriteLock write_lock(&manager->lock_);
+  WriteGuard guard(&write_lock);
   manager->file_cache_.clear();
-  manager->zipfiles_.clear();
+  manager->mapped_files_.clear();
+  manager->cache_size_ = 0U;
+  manager->pinned_size_ = 0U;
 }
 
 bool ZipAssetManager::UpdateFileIfChanged(
     const std::string& filename,
     std::chrono::system_clock::time_point* timestamp) {
   ZipAssetManager* manager = GetManager();
-  LockGuard guard(&manager->mutex_);
+  WriteLock write_lock(&manager->lock_);
+  WriteGuard guard(&write_lock);
   std::chrono::system_clock::time_point new_timestamp;
   FileCache::iterator it = manager->file_cache_.find(filename);
   if (it != manager->file_cache_.end() && !it->second.original_name.empty()) {
@@ -269,9 +619,16 @@ bool ZipAssetManager::UpdateFileIfChanged(
         rewind(fp);
 
         // Load the data.
-        it->second.data_ptr->resize(length);
-        fread(&((*it->second.data_ptr)[0]), sizeof(char), length, fp);
+        std::shared_ptr<std::string> data =
+            manager->DropCachedData(&it->second);
+        if (!data)
+          data.reset(new std::string);
+        data->resize(length);
+        fread(&((*data)[0]), sizeof(char), length, fp);
         fclose(fp);
+        it->second.data_ptr = data;
+        it->second.gzip_data_ptr.reset();
+        it->second.modified = true;
       }
       *timestamp = new_timestamp;
       return true;
@@ -289,7 +646,7 @@ ZipAssetManager* ZipAssetManager::GetManager() {
 }
 
 bool ZipAssetManager::FileIsCached(const FileInfo& info) {
-  return !info.data_ptr->empty();
+  return static_cast<bool>(std::atomic_load(&info.data_ptr));
 }
 
 }  // namespace base
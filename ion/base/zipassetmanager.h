@@ -18,27 +18,41 @@ limitations under the License.
 #ifndef ION_BASE_ZIPASSETMANAGER_H_
 #define ION_BASE_ZIPASSETMANAGER_H_
 
+#include <atomic>
 #include <chrono>  // NOLINT
 #include <map>
 #include <memory>
-#include <set>
 #include <string>
 #include <vector>
 
+#include "base/integral_types.h"
 #include "base/macros.h"
+#include "ion/base/readwritelock.h"
+#include "ion/external/gtest/gunit_prod.h"  // For FRIEND_TEST().
+#include "ion/port/memorymappedfile.h"
 #include "ion/port/mutex.h"
 
 namespace ion {
 namespace base {
 
 // ZipAssetManager manages all zipfile assets in Ion. Assets are registered
-// through RegisterAssetData(), which extracts all file names from the zip and
-// adds them to its registry. Use GetFileData() to return the data of a file.
-// Files are only extracted the first time they are requested through
-// GetFileData(); file contents are cached internally after extraction.
+// through RegisterAssetData() or RegisterAssetFile(), which read the central
+// directory of the zip and add its files to the registry. Use GetFileData() to
+// return the data of a file. Files are only extracted the first time they are
+// requested through GetFileData(); file contents are cached internally after
+// extraction. Files that are stored uncompressed in the zip can also be read
+// in place, without any copy, through GetStoredFileData().
+//
+// Extraction works directly on the registered bytes rather than through a
+// stateful unzip stream, so any number of threads can read files at the same
+// time: readers share a ReadWriteLock that only registration, the functions
+// that change file data and dropping cached data lock exclusively, and cached
+// data is published and looked up with atomic operations. By default extracted data stays cached
+// until Reset(); SetCacheBudget() bounds the memory it uses by evicting the
+// least recently used files.
 //
 // Note that zip assets must be explicitly registered through
-// RegisterAssetData().
+// RegisterAssetData() or RegisterAssetFile().
 class ION_API ZipAssetManager {
  public:
   // The destructor is public so that the StaticDeleter that destroys the
@@ -54,6 +68,10 @@ class ION_API ZipAssetManager {
   // invalidates any use of previous return values of GetFileData() for the
   // replaced file.
   static bool RegisterAssetData(const void* data, size_t data_size);
+  // Memory-maps the zip file at |path| and registers its data as
+  // RegisterAssetData() does. The file stays mapped until Reset(). Returns
+  // false if the file cannot be mapped or is not a valid zip file.
+  static bool RegisterAssetFile(const std::string& path);
 
   // Returns whether the manager contains the passed filename.
   static bool ContainsFile(const std::string& filename);
@@ -79,8 +97,27 @@ class ION_API ZipAssetManager {
   static const std::string& GetFileData(const std::string& filename);
   // As above but the decompressed bytes are not internally cached. Returns true
   // if |filename| is found or false otherwise. If file data is already cached
-  // for |filename| then this method will clear that cached data.
+  // for |filename| then this method will clear that cached data, unless the
+  // data was changed through SetFileData() or UpdateFileIfChanged(). Clearing
+  // the data invalidates any existing returned reference from GetFileData for
+  // that file.
   static bool GetFileDataNoCache(const std::string& filename, std::string* out);
+  // Returns the data of the passed filename compressed in gzip format. The
+  // gzip data is assembled from the deflated bytes stored in the zip, so the
+  // file is neither decompressed nor recompressed. The result is cached.
+  // Returns an empty pointer if the manager does not contain the file, the file
+  // is not stored with deflate compression, or its data has changed since it
+  // was registered (through SetFileData() or UpdateFileIfChanged()).
+  static std::shared_ptr<const std::string> GetGzippedFileDataPtr(
+      const std::string& filename);
+  // Sets |data| and |size| to the bytes of the passed filename inside the
+  // registered zip data, without copying or caching them, and returns true if
+  // the file is stored without compression and its data has not changed since
+  // it was registered. The bytes remain valid as long as the registered data
+  // does (until Reset() for files registered with RegisterAssetFile()).
+  // Returns false otherwise, in which case GetFileData() must be used.
+  static bool GetStoredFileData(const std::string& filename, const char** data,
+                                size_t* size);
 
   // If the source file of a zipped file is available on disk (based on the
   // file's manifest), this function updates the cached unzipped data from the
@@ -107,22 +144,58 @@ class ION_API ZipAssetManager {
   // or if the manager does not contain the file.
   static bool SaveFileData(const std::string& filename);
 
+  // Sets/returns the maximum number of bytes of extracted file data that the
+  // manager keeps cached. When extracting a file makes the cache exceed the
+  // budget, the least recently requested files are dropped from the cache and
+  // will be extracted again when they are next requested. Data whose contents
+  // were changed through SetFileData() or UpdateFileIfChanged() is never
+  // dropped. A budget of 0, the default, means that the cache is unbounded.
+  // Since the reference returned by GetFileData() is only backed by the cache,
+  // data returned by it is pinned and never dropped either. Pinned data still
+  // counts towards the cache size, but only data that was requested solely
+  // through GetFileDataPtr() can be dropped to meet the budget, so
+  // GetFileDataPtr() should be used when the budget matters. Once only pinned
+  // data remains, requests no longer try to shrink the cache.
+  static void SetCacheBudget(size_t budget);
+  static size_t GetCacheBudget();
+  // Returns the number of bytes of extracted file data currently cached.
+  static size_t GetCacheSize();
+
   // Resets the manager back to its initial, empty state. This is used
   // primarily for testing and should generally not be necessary elsewhere.
   static void Reset();
 
  private:
   // Helper struct to associate a file with the zip data it came from and the
-  // data it contains.
+  // data it contains. The data and gzip_data pointers are only accessed with
+  // the std::atomic_* shared_ptr functions, since readers fill them while
+  // holding only a read lock.
   struct FileInfo {
-    // A zip_handle is the opaque pointer returned by the zlib library that
-    // represents an open stream of zipped data.
-    void* zip_handle;
+    FileInfo();
+    // The (possibly compressed) bytes of the file in the registered zip data.
+    const char* zip_data;
+    size_t compressed_size;
+    size_t uncompressed_size;
+    // The zip compression method of the file (0 for stored, 8 for deflated).
+    uint16 compression_method;
+    // The CRC-32 of the uncompressed data.
+    uint32 crc;
     // The last time the file was modified.
     std::chrono::system_clock::time_point timestamp;
     // Empty pointer or pointer to the data of the extracted file if it has
     // been extracted.
     std::shared_ptr<std::string> data_ptr;
+    // Empty pointer or pointer to the gzipped data of the file if it has
+    // been requested.
+    std::shared_ptr<const std::string> gzip_data_ptr;
+    // When the file's data was last requested, used to drop the least
+    // recently used data when the cache exceeds its budget.
+    std::atomic<uint64> last_use;
+    // Whether the data was returned by reference from GetFileData(), in which
+    // case it must not be evicted to meet the cache budget.
+    std::atomic<bool> pinned;
+    // Whether the data no longer matches what is stored in the zip.
+    bool modified;
     // The original source file name on disk.
     std::string original_name;
   };
@@ -131,18 +204,45 @@ class ION_API ZipAssetManager {
   // The constructor is private since this is a singleton class.
   ZipAssetManager();
 
-  // Gets the file data or invalid reference if file doesn't exist.  Assumes
-  // the manager mutex is already held.  Decompressed bytes will
-  // be written to |out| if non-NULL, or to the internal cache (FileInfo.data)
-  // if NULL. Return value is a reference to the decompressed byte string or
-  // InvalidReference if the decompress failed.
+  // Allow tests to hold the manager lock.
+  FRIEND_TEST(ZipAssetManager, PinnedDataOverBudget);
+
+  // Parses the central directory of the zip in |data| and adds its files to
+  // the cache. Assumes the manager lock is held for writing.
+  bool RegisterZipDataLocked(const char* data, size_t data_size);
+
+  // Gets the file data or invalid reference if file doesn't exist.  Decompressed
+  // bytes will be written to |out| if non-NULL, in which case the manager lock
+  // must be held for writing, since cached data is moved to |out|. If |out| is
+  // NULL the data is written to the internal cache (FileInfo.data) and pinned
+  // there, and the manager lock must be held for reading or writing. Return
+  // value is a reference to the decompressed byte string or InvalidReference
+  // if the decompress failed.
   const std::string& GetFileDataLocked(const std::string& filename,
                                        std::string* out);
 
+  // Returns the cached data of |info|, extracting and caching it first if
+  // necessary, or an empty pointer if the data cannot be extracted. Assumes
+  // the manager lock is held (for reading or writing).
+  std::shared_ptr<std::string> GetCachedDataLocked(FileInfo* info);
+
   // Returns whether the manager contains the passed filename.  Assumes the
-  // manager mutex is already held.
+  // manager lock is already held.
   bool ContainsFileLocked(const std::string& filename);
 
+  // Atomically clears the cached data of |info|, removing its size from the
+  // cache size if the data was extracted from the zip, and unpins it. Returns
+  // the data that was cached, if any. Assumes the manager lock is held for
+  // writing.
+  std::shared_ptr<std::string> DropCachedData(FileInfo* info);
+
+  // Drops the least recently used extracted data that is not pinned until the
+  // cache fits in its budget. Assumes the manager lock is held for writing.
+  void EvictCachedDataLocked();
+  // Locks the manager for writing and evicts cached data if the cache exceeds
+  // its budget. The manager lock must not be held.
+  void EvictCachedDataIfOverBudget();
+
   // Returns a pointer to the manager instance.
   static ZipAssetManager* GetManager();
 
@@ -152,11 +252,21 @@ class ION_API ZipAssetManager {
 
   // Cache of files that have already been extracted.
   FileCache file_cache_;
-  // Set of zipfiles that have been registered with the manager.
-  std::set<void*> zipfiles_;
+  // Zip files mapped by RegisterAssetFile().
+  std::vector<std::unique_ptr<port::MemoryMappedFile>> mapped_files_;
+
+  // The number of bytes of extracted data in the cache, and its budget.
+  std::atomic<size_t> cache_size_;
+  // The number of bytes of extracted data in the cache that are pinned, which
+  // eviction cannot drop.
+  std::atomic<size_t> pinned_size_;
+  std::atomic<size_t> cache_budget_;
+  // Incremented whenever file data is requested to order FileInfo::last_use.
+  std::atomic<uint64> use_counter_;
 
-  // Mutex to guard access to asset data.
-  port::Mutex mutex_;
+  // Lock to guard the registry; only registration, changes to file data and
+  // dropping cached data lock it for writing.
+  ReadWriteLock lock_;
 
   DISALLOW_COPY_AND_ASSIGN(ZipAssetManager);
 };
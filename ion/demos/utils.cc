@@ -17,6 +17,8 @@ limitations under the License.
 
 #include "ion/demos/utils.h"
 
+#include <memory>
+
 #include "ion/base/logging.h"
 #include "ion/gfxutils/shadermanager.h"
 #include "ion/gfxutils/shadersourcecomposer.h"
@@ -31,12 +33,12 @@ ion::gfx::ImagePtr LoadImageAsset(
     const std::string& asset_name,
     const ion::base::AllocatorPtr& allocator,
     bool flip_vertically) {
-  const std::string& image_string =
-      ion::base::ZipAssetManager::GetFileData(asset_name);
-  DCHECK(!ion::base::IsInvalidReference(image_string));
+  const std::shared_ptr<const std::string> image_string =
+      ion::base::ZipAssetManager::GetFileDataPtr(asset_name);
+  DCHECK(image_string);
 
   ion::gfx::ImagePtr image = ion::image::ConvertFromExternalImageData(
-      image_string.data(), image_string.size(), flip_vertically, false,
+      image_string->data(), image_string->size(), flip_vertically, false,
       allocator);
   return image;
 }
@@ -56,10 +58,10 @@ ion::gfx::ShapePtr LoadShapeAsset(
     // Default to OBJ format.
     real_spec.format = ion::gfxutils::ExternalShapeSpec::kObj;
   }
-  const std::string& shape_string =
-      ion::base::ZipAssetManager::GetFileData(asset_name);
-  DCHECK(!ion::base::IsInvalidReference(shape_string));
-  std::istringstream str(shape_string);
+  const std::shared_ptr<const std::string> shape_string =
+      ion::base::ZipAssetManager::GetFileDataPtr(asset_name);
+  DCHECK(shape_string);
+  std::istringstream str(*shape_string);
   ion::gfx::ShapePtr shape = ion::gfxutils::LoadExternalShape(real_spec, str);
 
   if (radius != nullptr) {
@@ -142,6 +142,8 @@
         'node.cc',
         'node.h',
         'openglobjects.h',
+        'programbinarycache.cc',
+        'programbinarycache.h',
         'renderer.cc',
         'renderer.h',
         'resourcebase.h',
@@ -171,6 +173,7 @@
         'uniform.h',
         'uniformblock.cc',
         'uniformblock.h',
+        'uniformhandle.h',
         'uniformholder.cc',
         'uniformholder.h',
         'updatestatetable.cc',
@@ -513,6 +513,11 @@ void GraphicsManager::InitGlInfo() {
   EnableFunctionGroupIfAvailable(kMapBufferRange, GlVersions(30U, 30U, 0U),
                                  "map_buffer_range",
                                  "Vivante GC1000,VideoCore IV HW");
+  EnableFunctionGroupIfAvailable(kParallelShaderCompile,
+                                 GlVersions(0U, 0U, 0U),
+                                 "parallel_shader_compile", "");
+  EnableFunctionGroupIfAvailable(kProgramBinary, GlVersions(41U, 30U, 0U),
+                                 "get_program_binary", "");
   EnableFunctionGroupIfAvailable(kSamplerObjects, GlVersions(33U, 30U, 0U),
                                  "sampler_objects", "Mali ,Mali-");
   EnableFunctionGroupIfAvailable(kTexture3d, GlVersions(13U, 30U, 0U),
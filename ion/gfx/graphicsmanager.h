@@ -143,7 +143,11 @@ class ION_API GraphicsManager : public base::Referent {
     kMapBufferBase,
     kMapBufferRange,
     kCopyBufferSubData,
+    // See https://www.khronos.org/registry/OpenGL/extensions/KHR/
+    // KHR_parallel_shader_compile.txt.
+    kParallelShaderCompile,
     kPointSize,
+    kProgramBinary,
     kRaw,
     kSamplerObjects,
     kTexture3d,
@@ -0,0 +1,215 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/gfx/programbinarycache.h"
+
+#include <stdio.h>
+
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include "ion/base/lockguards.h"
+#include "ion/base/logging.h"
+#include "ion/port/fileutils.h"
+
+namespace ion {
+namespace gfx {
+
+namespace {
+
+// Cache files start with this header, followed by the attribute bindings and
+// the program binary.
+struct FileHeader {
+  char magic[8];
+  uint32 format;
+  uint32 bindings_size;
+  uint64 binary_size;
+};
+
+static const char kMagic[8] = { 'I', 'O', 'N', 'P', 'R', 'O', 'G', '1' };
+static const char kFileExtension[] = ".ionprog";
+
+// Adds |str| and its length to the 64-bit FNV-1a hash |hash|. Hashing the
+// length keeps adjacent strings from running into each other.
+static void AddToHash(const std::string& str, uint64* hash) {
+  const size_t length = str.length();
+  for (size_t i = 0; i < length; ++i)
+    *hash = (*hash ^ static_cast<uint8>(str[i])) * 1099511628211ULL;
+  *hash = (*hash ^ length) * 1099511628211ULL;
+}
+
+}  // anonymous namespace
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string& directory)
+    : directory_(directory),
+      hit_count_(0U),
+      miss_count_(0U),
+      reject_count_(0U) {}
+
+ProgramBinaryCache::~ProgramBinaryCache() {}
+
+const std::string ProgramBinaryCache::ComputeKey(
+    const std::string& vertex_source, const std::string& fragment_source,
+    const std::string& vendor, const std::string& renderer,
+    const std::string& version) {
+  // Hash the sources and the driver separately so that a long source cannot
+  // make two different drivers collide.
+  uint64 source_hash = 14695981039346656037ULL;
+  AddToHash(vertex_source, &source_hash);
+  AddToHash(fragment_source, &source_hash);
+  uint64 driver_hash = 14695981039346656037ULL;
+  AddToHash(vendor, &driver_hash);
+  AddToHash(renderer, &driver_hash);
+  AddToHash(version, &driver_hash);
+
+  std::ostringstream str;
+  str << std::hex << std::setfill('0') << std::setw(16) << source_hash
+      << std::setw(16) << driver_hash;
+  return str.str();
+}
+
+bool ProgramBinaryCache::Find(const std::string& key, Entry* entry) {
+  {
+    base::LockGuard guard(&mutex_);
+    std::map<std::string, Entry>::const_iterator it = entries_.find(key);
+    if (it != entries_.end()) {
+      *entry = it->second;
+      ++hit_count_;
+      return true;
+    }
+  }
+  Entry file_entry;
+  if (!directory_.empty() && ReadFile(key, &file_entry)) {
+    *entry = file_entry;
+    base::LockGuard guard(&mutex_);
+    entries_[key] = file_entry;
+    ++hit_count_;
+    return true;
+  }
+  ++miss_count_;
+  return false;
+}
+
+bool ProgramBinaryCache::Store(const std::string& key, const Entry& entry) {
+  {
+    base::LockGuard guard(&mutex_);
+    entries_[key] = entry;
+  }
+  if (directory_.empty())
+    return true;
+  if (!WriteFile(key, entry)) {
+    LOG(WARNING) << "Unable to write program binary cache file "
+                 << GetPath(key);
+    return false;
+  }
+  return true;
+}
+
+void ProgramBinaryCache::Remove(const std::string& key) {
+  ++reject_count_;
+  {
+    base::LockGuard guard(&mutex_);
+    entries_.erase(key);
+  }
+  if (!directory_.empty())
+    port::RemoveFile(GetPath(key));
+}
+
+void ProgramBinaryCache::Clear() {
+  {
+    base::LockGuard guard(&mutex_);
+    entries_.clear();
+  }
+  if (directory_.empty())
+    return;
+  const std::vector<std::string> files = port::ListDirectory(directory_);
+  const size_t extension_length = strlen(kFileExtension);
+  for (size_t i = 0; i < files.size(); ++i) {
+    const std::string& name = files[i];
+    if (name.length() > extension_length &&
+        name.compare(name.length() - extension_length, extension_length,
+                     kFileExtension) == 0)
+      port::RemoveFile(directory_ + "/" + name);
+  }
+}
+
+const std::string ProgramBinaryCache::GetPath(const std::string& key) const {
+  return directory_ + "/" + key + kFileExtension;
+}
+
+bool ProgramBinaryCache::ReadFile(const std::string& key, Entry* entry) const {
+  std::string data;
+  if (!port::ReadDataFromFile(GetPath(key), &data))
+    return false;
+  FileHeader header;
+  if (data.length() < sizeof(header))
+    return false;
+  memcpy(&header, data.data(), sizeof(header));
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) ||
+      data.length() - sizeof(header) !=
+          header.bindings_size + header.binary_size ||
+      !header.binary_size) {
+    LOG(WARNING) << "Ignoring invalid program binary cache file "
+                 << GetPath(key);
+    return false;
+  }
+  entry->format = static_cast<GLenum>(header.format);
+  entry->attribute_bindings = data.substr(sizeof(header),
+                                          header.bindings_size);
+  entry->binary = data.substr(sizeof(header) + header.bindings_size);
+  return true;
+}
+
+bool ProgramBinaryCache::WriteFile(const std::string& key,
+                                   const Entry& entry) const {
+  FileHeader header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.format = static_cast<uint32>(entry.format);
+  header.bindings_size = static_cast<uint32>(entry.attribute_bindings.size());
+  header.binary_size = entry.binary.size();
+
+  // Write to a temporary file and rename it so that another process never
+  // reads a partially written file.
+  const std::string path = GetPath(key);
+  const std::string temp_path = path + ".tmp";
+  FILE* file = port::OpenFile(temp_path, "wb");
+  if (!file)
+    return false;
+  const bool written =
+      fwrite(&header, sizeof(header), 1U, file) == 1U &&
+      fwrite(entry.attribute_bindings.data(), 1U, header.bindings_size,
+             file) == header.bindings_size &&
+      fwrite(entry.binary.data(), 1U, entry.binary.size(), file) ==
+          entry.binary.size();
+  const bool closed = fclose(file) == 0;
+  if (!written || !closed) {
+    port::RemoveFile(temp_path);
+    return false;
+  }
+  // On some platforms rename() fails if the destination exists.
+  port::RemoveFile(path);
+  if (rename(temp_path.c_str(), path.c_str()) != 0) {
+    port::RemoveFile(temp_path);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace gfx
+}  // namespace ion
@@ -0,0 +1,131 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef ION_GFX_PROGRAMBINARYCACHE_H_
+#define ION_GFX_PROGRAMBINARYCACHE_H_
+
+#include <atomic>
+#include <map>
+#include <string>
+
+#include "base/integral_types.h"
+#include "ion/base/referent.h"
+#include "ion/port/mutex.h"
+#include "ion/portgfx/glheaders.h"
+
+namespace ion {
+namespace gfx {
+
+// ProgramBinaryCache stores linked shader program binaries, as returned by
+// glGetProgramBinary(), so that a Renderer can recreate a program with
+// glProgramBinary() instead of compiling and linking its shaders. Entries are
+// keyed by a hash of the vertex and fragment shader sources and the driver's
+// vendor, renderer and version strings, since a binary is only valid for the
+// driver that produced it.
+//
+// Entries are kept in memory and, if the cache has a directory, in one file
+// per entry so that later runs of an application can use them. Files are
+// written when an entry is stored. A driver may still reject a binary that it
+// produced (e.g., after an update that did not change its version string); the
+// Renderer then falls back to compiling the program from source and replaces
+// the entry.
+//
+// See Renderer::SetProgramBinaryCache() to make a Renderer use a cache.
+class ION_API ProgramBinaryCache : public base::Referent {
+ public:
+  // A cached program.
+  struct Entry {
+    Entry() : format(GL_NONE) {}
+    // The binary format returned by glGetProgramBinary().
+    GLenum format;
+    // The program binary.
+    std::string binary;
+    // A description of the attribute locations that were bound when the
+    // program was linked. A binary is only usable if the same locations would
+    // be bound again, which also depends on the ShaderInputRegistry.
+    std::string attribute_bindings;
+  };
+
+  // Creates a cache that stores its files in |directory|, which must exist. If
+  // |directory| is empty, entries are only kept in memory.
+  explicit ProgramBinaryCache(const std::string& directory);
+
+  // Returns the directory the cache files are stored in.
+  const std::string& GetDirectory() const { return directory_; }
+
+  // Returns the key for a program linked from the passed sources by the driver
+  // identified by the GL_VENDOR, GL_RENDERER, and GL_VERSION strings.
+  static const std::string ComputeKey(const std::string& vertex_source,
+                                      const std::string& fragment_source,
+                                      const std::string& vendor,
+                                      const std::string& renderer,
+                                      const std::string& version);
+
+  // Looks up the entry for |key|, reading its file if it is not in memory.
+  // Returns false if there is no valid entry.
+  bool Find(const std::string& key, Entry* entry);
+
+  // Adds |entry| to the cache under |key|, replacing any existing entry.
+  // Returns false if the entry could not be written to disk; it is still
+  // available from memory in that case.
+  bool Store(const std::string& key, const Entry& entry);
+
+  // Removes the entry for |key|, e.g., because the driver rejected it.
+  void Remove(const std::string& key);
+
+  // Removes all entries, including any cache files in the directory.
+  void Clear();
+
+  // Returns the number of Find() calls that returned an entry or did not, and
+  // the number of Remove() calls. A Renderer removes entries that it found but
+  // could not use, so the number of programs that did not have to be compiled
+  // is the hit count minus the reject count.
+  size_t GetHitCount() const { return hit_count_; }
+  size_t GetMissCount() const { return miss_count_; }
+  size_t GetRejectCount() const { return reject_count_; }
+
+ protected:
+  // The destructor is protected because all base::Referent classes must have
+  // protected or private destructors.
+  ~ProgramBinaryCache() override;
+
+ private:
+  // Returns the path of the file for |key|.
+  const std::string GetPath(const std::string& key) const;
+
+  // Reads or writes the file for |key|. Return false on failure.
+  bool ReadFile(const std::string& key, Entry* entry) const;
+  bool WriteFile(const std::string& key, const Entry& entry) const;
+
+  const std::string directory_;
+
+  // Entries that have been read or stored.
+  std::map<std::string, Entry> entries_;
+  port::Mutex mutex_;
+
+  std::atomic<size_t> hit_count_;
+  std::atomic<size_t> miss_count_;
+  std::atomic<size_t> reject_count_;
+};
+
+// Convenience typedef for shared pointer to a ProgramBinaryCache.
+typedef base::ReferentPtr<ProgramBinaryCache>::Type ProgramBinaryCachePtr;
+
+}  // namespace gfx
+}  // namespace ion
+
+#endif  // ION_GFX_PROGRAMBINARYCACHE_H_
@@ -20,6 +20,8 @@ limitations under the License.
 #include <bitset>
 #include <limits>
 #include <memory>
+#include <sstream>
+#include <string>
 #include <vector>
 
 #include "base/integral_types.h"
@@ -32,9 +34,11 @@ limitations under the License.
 #include "ion/base/readwritelock.h"
 #include "ion/base/serialize.h"
 #include "ion/base/staticsafedeclare.h"
+#include "ion/base/stlalloc/allocdeque.h"
 #include "ion/base/stlalloc/allocset.h"
 #include "ion/base/stlalloc/allocunorderedset.h"
 #include "ion/base/stlalloc/allocvector.h"
+#include "ion/base/stringutils.h"
 #include "ion/gfx/attribute.h"
 #include "ion/gfx/attributearray.h"
 #include "ion/gfx/bufferobject.h"
@@ -238,14 +242,11 @@ static bool ValidateUniformType(const char* name,
   return types_equal;
 }
 
-// Compiles an OpenGL shader, returning the shader id. Logs a message and
-// returns 0 on error.
-static GLuint CompileShader(const std::string& id_string, GLenum shader_type,
-                            const std::string& source, std::string* info_log,
-                            GraphicsManager* gm) {
-  // Clear the info log. When this function returns it will either be empty,
-  // indicating success, or non-empty, signaling an error.
-  info_log->clear();
+// Creates an OpenGL shader and starts compiling it, returning the shader id.
+// Logs a message and returns 0 if the shader cannot be created.
+static GLuint StartCompilingShader(GLenum shader_type,
+                                   const std::string& source,
+                                   GraphicsManager* gm) {
   GLuint id = gm->CreateShader(shader_type);
 
   if (id) {
@@ -253,27 +254,53 @@ static GLuint CompileShader(const std::string& id_string, GLenum shader_type,
     const char* source_string = source.c_str();
     gm->ShaderSource(id, 1, &source_string, nullptr);
     gm->CompileShader(id);
-
-    // Test for problems.
-    GLint ok = GL_FALSE;
-    gm->GetShaderiv(id, GL_COMPILE_STATUS, &ok);
-    if (!ok) {
-      char log[2048];
-      log[0] = 0;
-      gm->GetShaderInfoLog(id, 2047, nullptr, log);
-      *info_log = log;
-      LOG(ERROR) << "***ION: Unable to compile "
-                 << GetShaderTypeString(shader_type) << " shader for '"
-                 << id_string << "': " << log;
-      gm->DeleteShader(id);
-      id = 0;
-    }
   } else {
     LOG(ERROR) << "***ION: Unable to create shader object";
   }
   return id;
 }
 
+// Waits for a shader started by StartCompilingShader() to compile, returning
+// whether it compiled successfully. Logs a message, sets the info log, and
+// deletes the shader on error.
+static bool FinishCompilingShader(const std::string& id_string,
+                                  GLenum shader_type, GLuint id,
+                                  std::string* info_log, GraphicsManager* gm) {
+  // Test for problems.
+  GLint ok = GL_FALSE;
+  gm->GetShaderiv(id, GL_COMPILE_STATUS, &ok);
+  if (!ok) {
+    char log[2048];
+    log[0] = 0;
+    gm->GetShaderInfoLog(id, 2047, nullptr, log);
+    *info_log = log;
+    LOG(ERROR) << "***ION: Unable to compile "
+               << GetShaderTypeString(shader_type) << " shader for '"
+               << id_string << "': " << log;
+    gm->DeleteShader(id);
+  }
+  return ok != GL_FALSE;
+}
+
+// Checks the status of a linked OpenGL shader program, returning whether it
+// linked successfully. Logs a message, sets the info log, and deletes the
+// program on error.
+static bool CheckLinkStatus(const std::string& id_string, GLuint program_id,
+                            std::string* info_log, GraphicsManager* gm) {
+  GLint ok = GL_FALSE;
+  gm->GetProgramiv(program_id, GL_LINK_STATUS, &ok);
+  if (!ok) {
+    char log[2048];
+    log[0] = 0;
+    gm->GetProgramInfoLog(program_id, 2047, nullptr, log);
+    *info_log = log;
+    LOG(ERROR) << "***ION: Unable to link shader program for '" << id_string
+               << "': " << log;
+    gm->DeleteProgram(program_id);
+  }
+  return ok != GL_FALSE;
+}
+
 // Links an OpenGL shader program, returning the program id. Logs a message and
 // returns 0 on error.
 static GLuint RelinkShaderProgram(const std::string& id_string,
@@ -287,18 +314,8 @@ static GLuint RelinkShaderProgram(const std::string& id_string,
   gm->LinkProgram(program_id);
 
   // Test for problems.
-  GLint ok = GL_FALSE;
-  gm->GetProgramiv(program_id, GL_LINK_STATUS, &ok);
-  if (!ok) {
-    char log[2048];
-    log[0] = 0;
-    gm->GetProgramInfoLog(program_id, 2047, nullptr, log);
-    *info_log = log;
-    LOG(ERROR) << "***ION: Unable to link shader program for '" << id_string
-               << "': " << log;
-    gm->DeleteProgram(program_id);
+  if (!CheckLinkStatus(id_string, program_id, info_log, gm))
     program_id = 0;
-  }
 
   return program_id;
 }
@@ -498,10 +515,15 @@ class Renderer::ResourceManager : public gfx::ResourceManager {
     // Returns the amount of memory used by this resource.
     size_t GetGpuMemoryUsed() const override { return gpu_memory_used_.load(); }
 
+    // Returns a number that identifies this for its whole lifetime. Unlike the
+    // OpenGL id it is never 0, and it is not reused after this is destroyed.
+    uint64 GetSerial() const { return serial_; }
+
    protected:
     explicit Resource(ResourceManager* rm, const ResourceHolder* holder,
                       ResourceKey key)
         : ResourceBase(holder, key),
+          serial_(AcquireSerial()),
           index_(0),
           resource_manager_(rm),
           gpu_memory_used_(0U) {}
@@ -570,6 +592,12 @@ class Renderer::ResourceManager : public gfx::ResourceManager {
     void SetIndex(size_t index) { index_ = index; }
     size_t GetIndex() const { return index_; }
 
+    // Returns a new serial number for a Resource.
+    static uint64 AcquireSerial() {
+      static std::atomic<uint64> s_next_serial(1U);
+      return s_next_serial.fetch_add(1U, std::memory_order_relaxed);
+    }
+
     // Updates the AllocationSizeTracker. Both allocation and de-allocation are
     // tracked.
     void UpdateAllocationSizeTracker(
@@ -579,6 +607,9 @@ class Renderer::ResourceManager : public gfx::ResourceManager {
       if (old_used) tracker->TrackDeallocationSize(old_used);
     }
 
+    // See GetSerial().
+    const uint64 serial_;
+
     // This is the index within the resources vector in the manager.
     size_t index_;
 
@@ -900,6 +931,12 @@ class Renderer::ResourceManager : public gfx::ResourceManager {
       for (Resource* resource : resources) {
         if (key_set.find(resource->GetKey()) != key_set.end()) {
           ResourceType* typed_resource = static_cast<ResourceType*>(resource);
+          // Skip resources that the requester is not interested in without
+          // binding them or querying OpenGL.
+          if (request.filter && resource->GetHolder() &&
+              !request.filter(resource->GetSerial(),
+                              resource->GetHolder()->GetChangeCount()))
+            continue;
           AppendResourceInfo(&infos, typed_resource, resource_binder);
         }
       }
@@ -917,7 +954,9 @@ class Renderer::ResourceManager : public gfx::ResourceManager {
     resource->Bind(rb);
     // Fill info that is stored in the Resource itself.
     info.id = resource->GetId();
+    info.serial = resource->GetSerial();
     info.label = resource->GetHolder()->GetLabel();
+    info.change_count = resource->GetHolder()->GetChangeCount();
     FillInfoFromResource(&info, resource, rb);
     // Get the rest of the information directly from OpenGL.
     FillInfoFromOpenGL(&info);
@@ -937,6 +976,14 @@ class Renderer::ResourceManager : public gfx::ResourceManager {
   // Process any outstanding requests for information about Resources.
   void ProcessResourceInfoRequests(ResourceBinder* resource_binder);
 
+  // Sets/returns the cache used for shader program binaries.
+  void SetProgramBinaryCache(const ProgramBinaryCachePtr& cache) {
+    program_binary_cache_ = cache;
+  }
+  const ProgramBinaryCachePtr& GetProgramBinaryCache() const {
+    return program_binary_cache_;
+  }
+
  private:
   // Wrapper struct for std::atomic<size_t> that is copy-constructable. This
   // allows the value to be used in an STL container.
@@ -1001,6 +1048,9 @@ class Renderer::ResourceManager : public gfx::ResourceManager {
   // For locking access to resources_to_release_. This is needed since multiple
   // threads may destroy resources at the same time as holders are destroyed.
   port::Mutex release_mutex_;
+
+  // The cache used to create shader programs from binaries, if any.
+  ProgramBinaryCachePtr program_binary_cache_;
 };
 
 //-----------------------------------------------------------------------------
@@ -1109,7 +1159,11 @@ class Renderer::ResourceBinder : public Allocatable {
         client_state_table_(new (GetAllocator()) StateTable(0, 0)),
         traversal_state_tables_(*this),
         current_traversal_index_(0U),
-        processing_info_requests_(false) {
+        processing_info_requests_(false),
+        deferred_compile_started_(false),
+        parallel_shader_compile_enabled_(false),
+        async_image_reads_(GetAllocator()),
+        async_image_buffers_(GetAllocator()) {
     memset(saved_ids_, 0, sizeof(saved_ids_));
     saved_state_table_ = new (GetAllocator()) StateTable();
 
@@ -1181,6 +1235,33 @@ class Renderer::ResourceBinder : public Allocatable {
     return active_shader_resource_;
   }
 
+  // Returns whether a ShaderProgram with deferred compilation may be compiled
+  // synchronously, which is only allowed once per frame. This is used when
+  // the platform cannot compile programs in the background.
+  bool StartDeferredCompile() {
+    if (deferred_compile_started_)
+      return false;
+    deferred_compile_started_ = true;
+    return true;
+  }
+
+  // Sets whether a ShaderProgram with deferred compilation was already
+  // compiled in this frame, and returns the previous value.
+  bool SetDeferredCompileStarted(bool started) {
+    std::swap(started, deferred_compile_started_);
+    return started;
+  }
+
+  // Asks the driver to use as many threads as it can for compiling programs
+  // with KHR_parallel_shader_compile. This is done once per binder, i.e., per
+  // GL context.
+  void EnableParallelShaderCompile() {
+    if (!parallel_shader_compile_enabled_) {
+      GetGraphicsManager()->MaxShaderCompilerThreads(0xffffffff);
+      parallel_shader_compile_enabled_ = true;
+    }
+  }
+
   // Returns the currently active framebuffer resource.
   FramebufferResource* GetActiveFramebuffer() const {
     return active_framebuffer_resource_;
@@ -1419,6 +1500,30 @@ class Renderer::ResourceBinder : public Allocatable {
   const ImagePtr ReadImage(const math::Range2i& range, Image::Format format,
                            const base::AllocatorPtr& allocator);
 
+  // Starts reading the specified area of the hardware framebuffer into a pixel
+  // buffer object and returns without waiting for the read to finish. The
+  // callback is invoked with the Image once the data has arrived, from a later
+  // call to ReadImageAsync() or ProcessAsyncImageReads(). At most |max_reads|
+  // reads are kept in flight; if that many are pending, this waits for the
+  // oldest one. If pixel buffer objects or sync objects are not supported, this
+  // reads the image synchronously and invokes the callback immediately.
+  void ReadImageAsync(const math::Range2i& range, Image::Format format,
+                      const base::AllocatorPtr& allocator,
+                      const Renderer::ReadImageCallback& callback,
+                      size_t max_reads);
+
+  // Completes all pending asynchronous reads whose data is available, in the
+  // order they were started. If |wait| is true, this blocks until all of them
+  // are complete.
+  void ProcessAsyncImageReads(bool wait);
+
+  // Deletes all pending asynchronous reads and their buffers without invoking
+  // their callbacks.
+  void ClearAsyncImageReads();
+
+  // Returns the number of pending asynchronous reads.
+  size_t GetAsyncImageReadCount() const { return async_image_reads_.size(); }
+
   // Sends a uniform value to OpenGL.
   void SendUniform(const Uniform& uniform, int location, GraphicsManager* gm);
 
@@ -1584,6 +1689,37 @@ class Renderer::ResourceBinder : public Allocatable {
   // Whether this is currently processing info requests.
   bool processing_info_requests_;
 
+  // Whether a deferred ShaderProgram has been compiled in the current frame.
+  bool deferred_compile_started_;
+  // Whether MaxShaderCompilerThreads() has been called.
+  bool parallel_shader_compile_enabled_;
+
+  // An asynchronous framebuffer read that is waiting for its pixel buffer.
+  struct AsyncImageRead {
+    GLuint buffer;
+    GLsizeiptr buffer_size;
+    GLsync fence;
+    Image::Format format;
+    uint32 width;
+    uint32 height;
+    base::AllocatorPtr allocator;
+    Renderer::ReadImageCallback callback;
+  };
+  // A pixel buffer that is not used by any pending read.
+  struct AsyncImageBuffer {
+    GLuint id;
+    GLsizeiptr size;
+  };
+
+  // Completes the oldest pending asynchronous read if its data is available,
+  // or unconditionally if |wait| is true. Returns whether the read completed.
+  bool CompleteAsyncImageRead(bool wait);
+
+  // Pending asynchronous reads, oldest first.
+  base::AllocDeque<AsyncImageRead> async_image_reads_;
+  // Pixel buffers that can be reused by new asynchronous reads.
+  base::AllocVector<AsyncImageBuffer> async_image_buffers_;
+
   friend class InfoRequestGuard;
 };
 
@@ -2870,7 +3006,11 @@ class Renderer::ShaderResource : public Resource<Shader::kNumChanges> {
   ShaderResource(ResourceBinder* rb, ResourceManager* rm, const Shader& shader,
                  ResourceKey key, GLuint id)
       : Renderer::Resource<Shader::kNumChanges>(rm, shader, key, id),
-        shader_type_(GL_INVALID_ENUM) {}
+        shader_type_(GL_INVALID_ENUM),
+        compiling_id_(0U),
+        update_started_(false),
+        compile_started_(false),
+        need_to_update_label_(false) {}
 
   ~ShaderResource() override {
     DCHECK(id_ == 0U || !portgfx::Visual::GetCurrent());
@@ -2878,6 +3018,15 @@ class Renderer::ShaderResource : public Resource<Shader::kNumChanges> {
 
   // Updates the resource and returns whether anything changed.
   virtual bool UpdateShader(ResourceBinder* rb);
+  // These split UpdateShader() in two for deferred compilation: the first
+  // starts compiling the shader if its source has changed, returning whether
+  // anything changed, and the second waits for the result and updates the id
+  // and info log. FinishUpdateShader() does nothing if no update is pending.
+  bool StartUpdateShader(ResourceBinder* rb);
+  void FinishUpdateShader(ResourceBinder* rb);
+  // Returns the id of the shader that is being compiled, if any, or the id of
+  // the last successfully compiled shader.
+  GLuint GetCompilingId() const { return compiling_id_ ? compiling_id_ : id_; }
   void Release(bool can_make_gl_calls) override;
   ResourceType GetType() const override { return kShader; }
 
@@ -2893,48 +3042,109 @@ class Renderer::ShaderResource : public Resource<Shader::kNumChanges> {
   void Update(ResourceBinder* rb) override {}
 
  private:
+  // Implement StartUpdateShader() and FinishUpdateShader() without labeling.
+  bool StartUpdate(ResourceBinder* rb);
+  void FinishUpdate();
+
   // The type of shader.
   GLenum shader_type_;
+  // The shader that is being compiled, if any.
+  GLuint compiling_id_;
+  // Whether StartUpdate() has been called without a matching FinishUpdate().
+  bool update_started_;
+  // Whether the pending update compiles the shader.
+  bool compile_started_;
+  // Whether the pending update needs to set the label of the shader.
+  bool need_to_update_label_;
 };
 
 bool Renderer::ShaderResource::UpdateShader(ResourceBinder* rb) {
+  if (AnyModifiedBitsSet() || update_started_) {
+    ScopedResourceLabel label(this, rb);
+    StartUpdate(rb);
+    FinishUpdate();
+    return true;
+  } else {
+    return false;
+  }
+}
+
+bool Renderer::ShaderResource::StartUpdateShader(ResourceBinder* rb) {
   if (AnyModifiedBitsSet()) {
     ScopedResourceLabel label(this, rb);
+    return StartUpdate(rb);
+  } else {
+    return false;
+  }
+}
+
+void Renderer::ShaderResource::FinishUpdateShader(ResourceBinder* rb) {
+  if (update_started_) {
+    ScopedResourceLabel label(this, rb);
+    FinishUpdate();
+  }
+}
+
+bool Renderer::ShaderResource::StartUpdate(ResourceBinder* rb) {
+  if (AnyModifiedBitsSet()) {
     // For coverage.
     Update(rb);
 
-    const Shader& shader = GetShader();
-    const std::string& id_string = shader.GetLabel();
-    GraphicsManager* gm = GetGraphicsManager();
-
-    std::string info_log = shader.GetInfoLog();
-    bool need_to_update_label = TestModifiedBit(ResourceHolder::kLabelChanged);
+    if (TestModifiedBit(ResourceHolder::kLabelChanged))
+      need_to_update_label_ = true;
     if (TestModifiedBit(Shader::kSourceChanged)) {
-      GLuint id = CompileShader(id_string, shader_type_, shader.GetSource(),
-                                &info_log, gm);
-      // Only update the id if the compilation was successful.
-      if (id) {
-        id_ = id;
-        need_to_update_label = true;
-      }
-    }
-
-    if (need_to_update_label)
-      SetObjectLabel(gm, GL_SHADER_OBJECT, id_, id_string);
-
-    // Send the info log to the holder.
-    shader.SetInfoLog(info_log);
+      GraphicsManager* gm = GetGraphicsManager();
+      // The new source replaces any that is still being compiled.
+      if (compiling_id_)
+        gm->DeleteShader(compiling_id_);
+      compiling_id_ =
+          StartCompilingShader(shader_type_, GetShader().GetSource(), gm);
+      compile_started_ = true;
+    }
+    update_started_ = true;
     ResetModifiedBits();
-
     return true;
   } else {
     return false;
   }
 }
 
+void Renderer::ShaderResource::FinishUpdate() {
+  const Shader& shader = GetShader();
+  const std::string& id_string = shader.GetLabel();
+  GraphicsManager* gm = GetGraphicsManager();
+
+  std::string info_log = shader.GetInfoLog();
+  if (compile_started_) {
+    // Clear the info log. It will either stay empty, indicating success, or
+    // be set to the compiler's messages.
+    info_log.clear();
+    // Only update the id if the compilation was successful.
+    if (compiling_id_ && FinishCompilingShader(id_string, shader_type_,
+                                               compiling_id_, &info_log, gm)) {
+      id_ = compiling_id_;
+      need_to_update_label_ = true;
+    }
+  }
+
+  if (need_to_update_label_)
+    SetObjectLabel(gm, GL_SHADER_OBJECT, id_, id_string);
+
+  // Send the info log to the holder.
+  shader.SetInfoLog(info_log);
+  compiling_id_ = 0U;
+  update_started_ = compile_started_ = need_to_update_label_ = false;
+}
+
 void Renderer::ShaderResource::Release(bool can_make_gl_calls) {
   BaseResourceType::Release(can_make_gl_calls);
   GraphicsManager* gm = GetGraphicsManager();
+  if (compiling_id_) {
+    if (can_make_gl_calls)
+      gm->DeleteShader(compiling_id_);
+    compiling_id_ = 0U;
+    update_started_ = compile_started_ = need_to_update_label_ = false;
+  }
   if (id_) {
     if (resource_owns_gl_id_ && can_make_gl_calls)
       gm->DeleteShader(id_);
@@ -3163,7 +3373,11 @@ class Renderer::ShaderProgramResource
         attribute_index_map_(shader_program.GetAllocator()),
         uniforms_(shader_program.GetAllocator()),
         vertex_resource_(nullptr),
-        fragment_resource_(nullptr) {}
+        fragment_resource_(nullptr),
+        loaded_from_binary_cache_(false),
+        deferred_stage_(kNotDeferred),
+        deferred_id_(0U),
+        deferred_attribute_index_map_(shader_program.GetAllocator()) {}
 
   GLint GetAttributeIndex(
       const ShaderInputRegistry::AttributeSpec* spec) const {
@@ -3191,7 +3405,24 @@ class Renderer::ShaderProgramResource
   ShaderResource* GetVertexResource() const { return vertex_resource_; }
   ShaderResource* GetFragmentResource() const { return fragment_resource_; }
 
+  // Returns whether the program was created from a ProgramBinaryCache entry
+  // rather than by compiling its shaders.
+  bool IsLoadedFromBinaryCache() const { return loaded_from_binary_cache_; }
+
+  // Returns whether the program is being compiled with deferred compilation,
+  // or is waiting for its turn to be compiled. The previously linked program,
+  // if any, is used until it is done.
+  bool IsCompiling() const { return deferred_stage_ != kNotDeferred; }
+
  private:
+  // The stages of deferred compilation; see UpdateDeferred().
+  enum DeferredStage {
+    kNotDeferred,
+    kWaitingToCompile,
+    kLinking,
+    kRelinking,
+  };
+
   struct UniformCacheEntry {
     UniformCacheEntry()
         : location(-1),
@@ -3235,11 +3466,54 @@ class Renderer::ShaderProgramResource
                               const ShaderInputRegistryPtr& reg,
                               GraphicsManager* gm);
 
+  // Returns a description of the attribute indices set up by
+  // PopulateAttributeCache(), which does not depend on the order of the map.
+  const std::string GetAttributeBindings() const;
+
+  // Returns the ProgramBinaryCache key for the program, or an empty string if
+  // the program cannot be cached.
+  const std::string GetProgramBinaryKey(GraphicsManager* gm) const;
+
+  // Creates a program from the cached binary for |key|, setting up the
+  // attribute cache. Returns the program id, or 0 if there is no usable entry.
+  GLuint LoadProgramBinary(const ProgramBinaryCachePtr& cache,
+                           const std::string& key, const std::string& id_string,
+                           const ShaderInputRegistryPtr& reg,
+                           GraphicsManager* gm);
+
+  // Stores the binary of the linked program |id| in |cache| under |key|.
+  void StoreProgramBinary(const ProgramBinaryCachePtr& cache,
+                          const std::string& key, GLuint id,
+                          GraphicsManager* gm);
+
   // Gets the active uniforms for this shader from OpenGL and sets up their
   // uniform locations in the cache. If any uniforms are missing from the
   // registry warning messages are logged.
   void PopulateUniformCache();
 
+  // Returns whether the program or its shaders have changed since they were
+  // last compiled.
+  bool NeedsUpdate() const {
+    return AnyModifiedBitsSet() ||
+           (vertex_resource_ && vertex_resource_->AnyModifiedBitsSet()) ||
+           (fragment_resource_ && fragment_resource_->AnyModifiedBitsSet());
+  }
+
+  // Updates the program using KHR_parallel_shader_compile. Changes start the
+  // shaders compiling and the program linking, and each call then checks
+  // whether the driver is done without waiting for it. The program is linked
+  // twice, as in Update(), since the attribute locations can only be bound
+  // once the first link has found the active attributes.
+  void UpdateDeferred(ResourceBinder* rb);
+
+  // Advances a deferred compilation to its next stage if the driver has
+  // completed the current one.
+  void ContinueDeferredCompile(ResourceBinder* rb);
+
+  // Deletes the program that is being linked by a deferred compilation, if
+  // any.
+  void CancelDeferredCompile(bool can_make_gl_calls);
+
   // Gets the latest uniform values from the resource binder's cache.
   void UpdateUniformValues(ResourceBinder* rb);
 
@@ -3269,6 +3543,16 @@ class Renderer::ShaderProgramResource
   // Shader stage resources.
   ShaderResource* vertex_resource_;
   ShaderResource* fragment_resource_;
+
+  // Whether the program was created from a cached binary.
+  bool loaded_from_binary_cache_;
+
+  // The state of a deferred compilation: the stage it is at, the program
+  // being linked, its attribute indices, and its ProgramBinaryCache key.
+  DeferredStage deferred_stage_;
+  GLuint deferred_id_;
+  AttributeIndexMap deferred_attribute_index_map_;
+  std::string deferred_binary_key_;
 };
 
 void Renderer::ShaderProgramResource::PopulateAttributeCache(
@@ -3348,6 +3632,80 @@ void Renderer::ShaderProgramResource::PopulateAttributeCache(
   }
 }
 
+const std::string Renderer::ShaderProgramResource::GetAttributeBindings()
+    const {
+  std::vector<std::string> bindings;
+  bindings.reserve(attribute_index_map_.size());
+  for (const auto& entry : attribute_index_map_) {
+    std::ostringstream str;
+    str << entry.first->name << "=" << entry.second;
+    bindings.push_back(str.str());
+  }
+  std::sort(bindings.begin(), bindings.end());
+  return base::JoinStrings(bindings, ",");
+}
+
+const std::string Renderer::ShaderProgramResource::GetProgramBinaryKey(
+    GraphicsManager* gm) const {
+  const ShaderProgram& shader_program = GetShaderProgram();
+  const Shader* vertex_shader = shader_program.GetVertexShader().Get();
+  const Shader* fragment_shader = shader_program.GetFragmentShader().Get();
+  if (!vertex_shader || !fragment_shader)
+    return std::string();
+  const char* vendor = reinterpret_cast<const char*>(gm->GetString(GL_VENDOR));
+  return ProgramBinaryCache::ComputeKey(
+      vertex_shader->GetSource(), fragment_shader->GetSource(),
+      vendor ? vendor : "", gm->GetGlRenderer(), gm->GetGlVersionString());
+}
+
+GLuint Renderer::ShaderProgramResource::LoadProgramBinary(
+    const ProgramBinaryCachePtr& cache, const std::string& key,
+    const std::string& id_string, const ShaderInputRegistryPtr& reg,
+    GraphicsManager* gm) {
+  ProgramBinaryCache::Entry entry;
+  if (!cache->Find(key, &entry))
+    return 0;
+  GLuint id = gm->CreateProgram();
+  if (!id)
+    return 0;
+  gm->ProgramBinary(id, entry.format, entry.binary.data(),
+                    static_cast<GLsizei>(entry.binary.size()));
+  GLint ok = GL_FALSE;
+  gm->GetProgramiv(id, GL_LINK_STATUS, &ok);
+  if (ok) {
+    // The attribute locations are part of the binary, so it can only be used
+    // if linking from source would bind the same ones.
+    PopulateAttributeCache(id, id_string, reg, gm);
+    if (GetAttributeBindings() == entry.attribute_bindings)
+      return id;
+  }
+  // The entry is replaced when the program is linked from source.
+  LOG(INFO) << "***ION: Unable to use cached binary for shader program '"
+            << id_string << "', compiling it from source";
+  gm->DeleteProgram(id);
+  cache->Remove(key);
+  return 0;
+}
+
+void Renderer::ShaderProgramResource::StoreProgramBinary(
+    const ProgramBinaryCachePtr& cache, const std::string& key, GLuint id,
+    GraphicsManager* gm) {
+  // Some drivers do not support any binary formats, and return no data.
+  GLint length = 0;
+  gm->GetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+  ProgramBinaryCache::Entry entry;
+  entry.binary.resize(length);
+  GLsizei written = 0;
+  gm->GetProgramBinary(id, length, &written, &entry.format, &entry.binary[0]);
+  if (written <= 0)
+    return;
+  entry.binary.resize(written);
+  entry.attribute_bindings = GetAttributeBindings();
+  cache->Store(key, entry);
+}
+
 void Renderer::ShaderProgramResource::PopulateUniformCache() {
   const ShaderProgram& shader_program = GetShaderProgram();
   const ShaderInputRegistryPtr& reg = shader_program.GetRegistry();
@@ -3555,6 +3913,25 @@ void Renderer::ShaderProgramResource::UpdateUniformValues(ResourceBinder* rb) {
 }
 
 void Renderer::ShaderProgramResource::Update(ResourceBinder* rb) {
+  if (GetShaderProgram().IsDeferredCompilation()) {
+    if (GetGraphicsManager()->IsFunctionGroupAvailable(
+            GraphicsManager::kParallelShaderCompile)) {
+      UpdateDeferred(rb);
+      return;
+    }
+    // Without parallel compilation the program is compiled below, but only
+    // when the binder allows another deferred program to be compiled.
+    if (NeedsUpdate() && !rb->StartDeferredCompile()) {
+      deferred_stage_ = kWaitingToCompile;
+      return;
+    }
+  } else if (deferred_stage_ == kLinking || deferred_stage_ == kRelinking) {
+    // Deferred compilation was turned off, so start again from scratch.
+    CancelDeferredCompile(true);
+    SetModifiedBits();
+  }
+  deferred_stage_ = kNotDeferred;
+
   // If shaders have changed then we need to reset their cached resources.
   if (TestModifiedBit(ShaderProgram::kVertexShaderChanged))
     vertex_resource_ = nullptr;
@@ -3568,20 +3945,43 @@ void Renderer::ShaderProgramResource::Update(ResourceBinder* rb) {
   if (vertex_updated || fragment_updated || AnyModifiedBitsSet()) {
     ScopedResourceLabel label(this, rb);
     const ShaderProgram& shader_program = GetShaderProgram();
+    const std::string& id_string = shader_program.GetLabel();
+    GraphicsManager* gm = GetGraphicsManager();
+    const ShaderInputRegistryPtr& reg = shader_program.GetRegistry();
+    std::string info_log = shader_program.GetInfoLog();
 
-    if (!vertex_resource_) {
-      if (Shader* shader = shader_program.GetVertexShader().Get()) {
-        if ((vertex_resource_ = GetResource(shader, rb), rb)) {
-          vertex_resource_->SetShaderType(GL_VERTEX_SHADER);
-          vertex_resource_->UpdateShader(rb);
+    // A program created from a cached binary does not need its shaders to be
+    // compiled, so look for one before creating the shader resources.
+    const ProgramBinaryCachePtr& cache =
+        GetResourceManager()->GetProgramBinaryCache();
+    const std::string binary_key =
+        cache.Get() &&
+                gm->IsFunctionGroupAvailable(GraphicsManager::kProgramBinary)
+            ? GetProgramBinaryKey(gm)
+            : std::string();
+    GLuint id = 0;
+    if (!binary_key.empty()) {
+      id = LoadProgramBinary(cache, binary_key, id_string, reg, gm);
+      if (id != 0)
+        info_log.clear();
+    }
+    loaded_from_binary_cache_ = id != 0;
+
+    if (!loaded_from_binary_cache_) {
+      if (!vertex_resource_) {
+        if (Shader* shader = shader_program.GetVertexShader().Get()) {
+          if ((vertex_resource_ = GetResource(shader, rb), rb)) {
+            vertex_resource_->SetShaderType(GL_VERTEX_SHADER);
+            vertex_resource_->UpdateShader(rb);
+          }
         }
       }
-    }
-    if (!fragment_resource_) {
-      if (Shader* shader = shader_program.GetFragmentShader().Get()) {
-        if ((fragment_resource_ = GetResource(shader, rb))) {
-          fragment_resource_->SetShaderType(GL_FRAGMENT_SHADER);
-          fragment_resource_->UpdateShader(rb);
+      if (!fragment_resource_) {
+        if (Shader* shader = shader_program.GetFragmentShader().Get()) {
+          if ((fragment_resource_ = GetResource(shader, rb))) {
+            fragment_resource_->SetShaderType(GL_FRAGMENT_SHADER);
+            fragment_resource_->UpdateShader(rb);
+          }
         }
       }
     }
@@ -3592,17 +3992,11 @@ void Renderer::ShaderProgramResource::Update(ResourceBinder* rb) {
         fragment_resource_ ? fragment_resource_->GetId() : 0;
 
     // Create a program object and attach the two compiled shaders.
-    const std::string& id_string = shader_program.GetLabel();
-    GraphicsManager* gm = GetGraphicsManager();
-
-    std::string info_log = shader_program.GetInfoLog();
-    GLuint id = LinkShaderProgram(id_string, vertex_shader_id,
-                                  fragment_shader_id, &info_log, gm);
+    if (!loaded_from_binary_cache_)
+      id = LinkShaderProgram(id_string, vertex_shader_id, fragment_shader_id,
+                             &info_log, gm);
 
     if (id != 0) {
-      // Bind each attribute to its name in the shader, using its order in
-      // the registry.
-      const ShaderInputRegistryPtr& reg = shader_program.GetRegistry();
       // Check that all inputs are unique in the registry.
       if (!reg->CheckInputsAreUnique()) {
         LOG(WARNING) << "***ION: Registry '" << reg->GetId() << " contains"
@@ -3610,12 +4004,23 @@ void Renderer::ShaderProgramResource::Update(ResourceBinder* rb) {
                      << " results may be unexpected";
       }
 
-      // Set up the attribute cache.
-      PopulateAttributeCache(id, id_string, reg, gm);
-
-      // Relink the program for the bindings to take effect.
-      id = RelinkShaderProgram(id_string, id, vertex_shader_id,
-                               fragment_shader_id, &info_log, gm);
+      // A cached program already has its attribute cache set up.
+      if (!loaded_from_binary_cache_) {
+        // Bind each attribute to its name in the shader, using its order in
+        // the registry, and set up the attribute cache.
+        PopulateAttributeCache(id, id_string, reg, gm);
+
+        // Ask for the binary to be retrievable before the final link.
+        if (!binary_key.empty())
+          gm->ProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                                GL_TRUE);
+
+        // Relink the program for the bindings to take effect.
+        id = RelinkShaderProgram(id_string, id, vertex_shader_id,
+                                 fragment_shader_id, &info_log, gm);
+        if (id != 0 && !binary_key.empty())
+          StoreProgramBinary(cache, binary_key, id, gm);
+      }
       bool need_to_update_label =
           vertex_updated || fragment_updated ||
           TestModifiedBit(ResourceHolder::kLabelChanged);
@@ -3640,6 +4045,148 @@ void Renderer::ShaderProgramResource::Update(ResourceBinder* rb) {
   }
 }
 
+void Renderer::ShaderProgramResource::UpdateDeferred(ResourceBinder* rb) {
+  // If shaders have changed then we need to reset their cached resources.
+  if (TestModifiedBit(ShaderProgram::kVertexShaderChanged))
+    vertex_resource_ = nullptr;
+  if (TestModifiedBit(ShaderProgram::kFragmentShaderChanged))
+    fragment_resource_ = nullptr;
+  // Start compiling changed shaders.
+  const bool vertex_updated =
+      vertex_resource_ && vertex_resource_->StartUpdateShader(rb);
+  const bool fragment_updated =
+      fragment_resource_ && fragment_resource_->StartUpdateShader(rb);
+  if (vertex_updated || fragment_updated || AnyModifiedBitsSet()) {
+    ScopedResourceLabel label(this, rb);
+    const ShaderProgram& shader_program = GetShaderProgram();
+    const std::string& id_string = shader_program.GetLabel();
+    GraphicsManager* gm = GetGraphicsManager();
+    const ShaderInputRegistryPtr& reg = shader_program.GetRegistry();
+    rb->EnableParallelShaderCompile();
+
+    // A program that is still being linked is out of date.
+    CancelDeferredCompile(true);
+
+    // Loading a cached binary is fast, so it is done right away. The attribute
+    // indices of the current program are kept unless the binary is used.
+    const ProgramBinaryCachePtr& cache =
+        GetResourceManager()->GetProgramBinaryCache();
+    deferred_binary_key_ =
+        cache.Get() &&
+                gm->IsFunctionGroupAvailable(GraphicsManager::kProgramBinary)
+            ? GetProgramBinaryKey(gm)
+            : std::string();
+    loaded_from_binary_cache_ = false;
+    if (!deferred_binary_key_.empty()) {
+      deferred_attribute_index_map_.clear();
+      attribute_index_map_.swap(deferred_attribute_index_map_);
+      if (GLuint id = LoadProgramBinary(cache, deferred_binary_key_, id_string,
+                                        reg, gm)) {
+        loaded_from_binary_cache_ = true;
+        id_ = id;
+        PopulateUniformCache();
+        SetObjectLabel(gm, GL_PROGRAM_OBJECT, id_, id_string);
+        shader_program.SetInfoLog(std::string());
+        ResetModifiedBits();
+        return;
+      }
+      attribute_index_map_.swap(deferred_attribute_index_map_);
+    }
+
+    if (!vertex_resource_) {
+      if (Shader* shader = shader_program.GetVertexShader().Get()) {
+        if ((vertex_resource_ = GetResource(shader, rb))) {
+          vertex_resource_->SetShaderType(GL_VERTEX_SHADER);
+          vertex_resource_->StartUpdateShader(rb);
+        }
+      }
+    }
+    if (!fragment_resource_) {
+      if (Shader* shader = shader_program.GetFragmentShader().Get()) {
+        if ((fragment_resource_ = GetResource(shader, rb))) {
+          fragment_resource_->SetShaderType(GL_FRAGMENT_SHADER);
+          fragment_resource_->StartUpdateShader(rb);
+        }
+      }
+    }
+
+    // Linking waits for the shaders to compile, but does not block.
+    deferred_id_ = gm->CreateProgram();
+    if (deferred_id_) {
+      if (vertex_resource_)
+        gm->AttachShader(deferred_id_, vertex_resource_->GetCompilingId());
+      if (fragment_resource_)
+        gm->AttachShader(deferred_id_, fragment_resource_->GetCompilingId());
+      gm->LinkProgram(deferred_id_);
+      deferred_stage_ = kLinking;
+    } else {
+      LOG(ERROR) << "***ION: Unable to create shader program object";
+    }
+    ResetModifiedBits();
+  }
+  if (deferred_stage_ != kNotDeferred)
+    ContinueDeferredCompile(rb);
+}
+
+void Renderer::ShaderProgramResource::ContinueDeferredCompile(
+    ResourceBinder* rb) {
+  GraphicsManager* gm = GetGraphicsManager();
+  GLint completed = GL_FALSE;
+  gm->GetProgramiv(deferred_id_, GL_COMPLETION_STATUS_KHR, &completed);
+  if (!completed)
+    return;
+
+  ScopedResourceLabel label(this, rb);
+  const ShaderProgram& shader_program = GetShaderProgram();
+  const std::string& id_string = shader_program.GetLabel();
+  std::string info_log;
+  if (deferred_stage_ == kLinking) {
+    // The shaders have compiled if the program has linked, so their results
+    // are available without waiting.
+    if (vertex_resource_)
+      vertex_resource_->FinishUpdateShader(rb);
+    if (fragment_resource_)
+      fragment_resource_->FinishUpdateShader(rb);
+    if (CheckLinkStatus(id_string, deferred_id_, &info_log, gm)) {
+      // Bind the attributes without disturbing the indices of the current
+      // program, which is still in use, and link again.
+      deferred_attribute_index_map_.clear();
+      attribute_index_map_.swap(deferred_attribute_index_map_);
+      PopulateAttributeCache(deferred_id_, id_string,
+                             shader_program.GetRegistry(), gm);
+      attribute_index_map_.swap(deferred_attribute_index_map_);
+      if (!deferred_binary_key_.empty())
+        gm->ProgramParameteri(deferred_id_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                              GL_TRUE);
+      gm->LinkProgram(deferred_id_);
+      deferred_stage_ = kRelinking;
+      return;
+    }
+  } else if (CheckLinkStatus(id_string, deferred_id_, &info_log, gm)) {
+    // The new program is ready to replace the current one.
+    attribute_index_map_.swap(deferred_attribute_index_map_);
+    if (!deferred_binary_key_.empty()) {
+      StoreProgramBinary(GetResourceManager()->GetProgramBinaryCache(),
+                         deferred_binary_key_, deferred_id_, gm);
+    }
+    id_ = deferred_id_;
+    PopulateUniformCache();
+    SetObjectLabel(gm, GL_PROGRAM_OBJECT, id_, id_string);
+  }
+  // CheckLinkStatus() deletes a program that fails to link.
+  deferred_id_ = 0U;
+  deferred_stage_ = kNotDeferred;
+  shader_program.SetInfoLog(info_log);
+}
+
+void Renderer::ShaderProgramResource::CancelDeferredCompile(
+    bool can_make_gl_calls) {
+  if (deferred_id_ && can_make_gl_calls)
+    GetGraphicsManager()->DeleteProgram(deferred_id_);
+  deferred_id_ = 0U;
+  deferred_stage_ = kNotDeferred;
+}
+
 void Renderer::ShaderProgramResource::Bind(ResourceBinder* rb) {
   Update(rb);
   if (id_) {
@@ -3657,6 +4204,7 @@ void Renderer::ShaderProgramResource::Unbind(ResourceBinder* rb) {
 
 void Renderer::ShaderProgramResource::Release(bool can_make_gl_calls) {
   BaseResourceType::Release(can_make_gl_calls);
+  CancelDeferredCompile(can_make_gl_calls);
   if (id_) {
     // unbind all and remove vertex array keys from all binders
     base::ReadLock read_lock(GetResourceBinderLock());
@@ -4663,7 +5211,8 @@ void Renderer::VertexArrayEmulatorResource::Release(bool can_make_gl_calls) {
 
 Renderer::Renderer(const GraphicsManagerPtr& gm)
     : flags_(AllProcessFlags()),
-      resource_manager_(new (GetAllocator()) ResourceManager(gm)) {
+      resource_manager_(new (GetAllocator()) ResourceManager(gm)),
+      async_image_read_count_(3U) {
   DCHECK(gm.Get());
 
   // Create the default shader program and default global uniform settings.
@@ -4679,8 +5228,10 @@ Renderer::~Renderer() {
                  << ": No Visual ID (invalid GL Context?)";
   }
   resource_manager_->DestroyAllResources();
-  if (resource_binder)
+  if (resource_binder) {
+    resource_binder->ClearAsyncImageReads();
     resource_binder->SetCurrentFramebuffer(FramebufferObjectPtr());
+  }
 }
 
 const Renderer::Flags& Renderer::AllFlags() {
@@ -5282,6 +5833,9 @@ void Renderer::ResourceBinder::DrawScene(const NodePtr& node,
   GraphicsManager* gm = GetGraphicsManager().Get();
   DCHECK(gm);
 
+  // Allow another deferred program to be compiled in this frame.
+  deferred_compile_started_ = false;
+
   if ((flags & AllSaveFlags()).any()) {
     // Possibly save existing state.
     if (flags.test(kSaveActiveTexture))
@@ -5499,6 +6053,30 @@ const ImagePtr Renderer::ReadImage(const math::Range2i& range,
       resource_binder->ReadImage(range, format, allocator) : ImagePtr();
 }
 
+void Renderer::ReadImageAsync(const math::Range2i& range, Image::Format format,
+                              const base::AllocatorPtr& allocator,
+                              const ReadImageCallback& callback) {
+  ResourceBinder* resource_binder = GetOrCreateInternalResourceBinder(__LINE__);
+  if (resource_binder) {
+    resource_binder->ReadImageAsync(range, format, allocator, callback,
+                                    async_image_read_count_);
+  }
+}
+
+void Renderer::ProcessAsyncImageReads(bool wait) {
+  ResourceBinder* resource_binder = GetOrCreateInternalResourceBinder(__LINE__);
+  if (resource_binder)
+    resource_binder->ProcessAsyncImageReads(wait);
+}
+
+void Renderer::SetAsyncImageReadCount(size_t count) {
+  async_image_read_count_ = count;
+  // Reads beyond the new count would never be waited for by ReadImageAsync().
+  ResourceBinder* resource_binder = GetOrCreateInternalResourceBinder(__LINE__);
+  if (resource_binder && resource_binder->GetAsyncImageReadCount() > count)
+    resource_binder->ProcessAsyncImageReads(true);
+}
+
 #if ION_PRODUCTION
 void Renderer::PushDebugMarker(const std::string& label) {}
 void Renderer::PopDebugMarker() {}
@@ -5547,6 +6125,34 @@ template ION_API uint32
 Renderer::GetResourceGlId<ShaderProgram>(ShaderProgram*);              // NOLINT
 template ION_API uint32 Renderer::GetResourceGlId<Texture>(Texture*);  // NOLINT
 
+void Renderer::SetProgramBinaryCache(const ProgramBinaryCachePtr& cache) {
+  resource_manager_->SetProgramBinaryCache(cache);
+}
+
+const ProgramBinaryCachePtr& Renderer::GetProgramBinaryCache() const {
+  return resource_manager_->GetProgramBinaryCache();
+}
+
+bool Renderer::IsShaderProgramReady(ShaderProgram* program) {
+  bool ready = false;
+  if (program) {
+    ResourceBinder* resource_binder =
+        GetOrCreateInternalResourceBinder(__LINE__);
+    if (resource_binder) {
+      ShaderProgramResource* resource =
+          resource_manager_->GetResource(program, resource_binder);
+      // Without parallel compilation the program is compiled right away. A
+      // direct request has its own budget, so the frame's budget is left as
+      // it was.
+      const bool started = resource_binder->SetDeferredCompileStarted(false);
+      resource->Update(resource_binder);
+      resource_binder->SetDeferredCompileStarted(started);
+      ready = !resource->IsCompiling();
+    }
+  }
+  return ready;
+}
+
 void Renderer::SetTextureImageUnitRange(const Range1i& units) {
   ResourceBinder* resource_binder = GetOrCreateInternalResourceBinder(__LINE__);
   if (resource_binder)
@@ -5686,11 +6292,30 @@ void Renderer::ResourceBinder::DrawNode(const Node& node, GraphicsManager* gm) {
 
     // Bind the shader program to use. Note that it may already be bound in
     // OpenGL, but we still need to update the resource.
-    resource_manager_->GetResource(current_shader_program_, this)->Bind(this);
+    ShaderProgramResource* spr =
+        resource_manager_->GetResource(current_shader_program_, this);
+    spr->Bind(this);
+
+    // A program with deferred compilation may not have been linked yet, in
+    // which case its fallback program is used if it is ready. If neither can
+    // be used then the shapes are skipped.
+    if (!spr->GetId() && spr->IsCompiling()) {
+      spr = nullptr;
+      if (ShaderProgram* fallback =
+              current_shader_program_->GetFallbackProgram().Get()) {
+        ShaderProgramResource* fallback_spr =
+            resource_manager_->GetResource(fallback, this);
+        fallback_spr->Bind(this);
+        if (fallback_spr->GetId())
+          spr = fallback_spr;
+      }
+    }
 
     // Draw shapes.
-    for (size_t i = 0; i < num_shapes; ++i)
-      DrawShape(*shapes[i], gm);
+    if (spr) {
+      for (size_t i = 0; i < num_shapes; ++i)
+        DrawShape(*shapes[i], gm);
+    }
 
     // Update our copy of OpenGL's state.
     gl_state_table_->MergeNonClearValuesFrom(*client_state_table_,
@@ -6009,6 +6634,127 @@ const ImagePtr Renderer::ResourceBinder::ReadImage(
   return image;
 }
 
+void Renderer::ResourceBinder::ReadImageAsync(
+    const math::Range2i& range, Image::Format format,
+    const base::AllocatorPtr& allocator,
+    const Renderer::ReadImageCallback& callback, size_t max_reads) {
+  GraphicsManager* gm = GetGraphicsManager().Get();
+  if (!max_reads || !gm->IsFunctionGroupAvailable(GraphicsManager::kSync) ||
+      !gm->IsFunctionGroupAvailable(GraphicsManager::kMapBufferRange)) {
+    callback(ReadImage(range, format, allocator));
+    return;
+  }
+
+  // Deliver whatever has already arrived, then make room in the ring.
+  ProcessAsyncImageReads(false);
+  while (async_image_reads_.size() >= max_reads)
+    CompleteAsyncImageRead(true);
+
+  const int x = range.GetMinPoint()[0];
+  const int y = range.GetMinPoint()[1];
+  const int width = range.GetSize()[0];
+  const int height = range.GetSize()[1];
+  const GLsizeiptr data_size = static_cast<GLsizeiptr>(
+      Image::ComputeDataSize(format, width, height));
+
+  AsyncImageBuffer buffer = {0U, 0};
+  if (!async_image_buffers_.empty()) {
+    buffer = async_image_buffers_.back();
+    async_image_buffers_.pop_back();
+  } else {
+    gm->GenBuffers(1, &buffer.id);
+  }
+  gm->BindBuffer(GL_PIXEL_PACK_BUFFER, buffer.id);
+  if (buffer.size < data_size) {
+    gm->BufferData(GL_PIXEL_PACK_BUFFER, data_size, nullptr, GL_STREAM_READ);
+    buffer.size = data_size;
+  }
+
+  Image::PixelFormat pf =
+      GetCompatiblePixelFormat(Image::GetPixelFormat(format), gm);
+  gm->PixelStorei(GL_PACK_ALIGNMENT, 1);
+  gm->ReadPixels(x, y, width, height, pf.format, pf.type, nullptr);
+  AsyncImageRead read;
+  read.buffer = buffer.id;
+  read.buffer_size = buffer.size;
+  read.fence = gm->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  read.format = format;
+  read.width = width;
+  read.height = height;
+  read.allocator = allocator;
+  read.callback = callback;
+  async_image_reads_.push_back(read);
+  gm->BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void Renderer::ResourceBinder::ProcessAsyncImageReads(bool wait) {
+  while (!async_image_reads_.empty() && CompleteAsyncImageRead(wait)) {}
+}
+
+bool Renderer::ResourceBinder::CompleteAsyncImageRead(bool wait) {
+  DCHECK(!async_image_reads_.empty());
+  GraphicsManager* gm = GetGraphicsManager().Get();
+  AsyncImageRead& read = async_image_reads_.front();
+
+  // Flush on the first wait so that the fence is guaranteed to signal.
+  GLenum status;
+  if (wait) {
+    static const GLuint64 kTimeoutNs = 1000000000ULL;
+    do {
+      status = gm->ClientWaitSync(read.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                  kTimeoutNs);
+    } while (status == GL_TIMEOUT_EXPIRED);
+  } else {
+    status = gm->ClientWaitSync(read.fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+      return false;
+  }
+  gm->DeleteSync(read.fence);
+
+  ImagePtr image;
+  if (status == GL_WAIT_FAILED) {
+    LOG(ERROR) << "Waiting for an asynchronous image read failed.";
+  } else {
+    const size_t data_size =
+        Image::ComputeDataSize(read.format, read.width, read.height);
+    gm->BindBuffer(GL_PIXEL_PACK_BUFFER, read.buffer);
+    if (const uint8* mapped = static_cast<const uint8*>(gm->MapBufferRange(
+            GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(data_size),
+            GL_MAP_READ_BIT))) {
+      image = new(read.allocator) Image();
+      DataContainerPtr data = DataContainer::CreateOverAllocated<uint8>(
+          data_size, mapped, image->GetAllocator());
+      image->Set(read.format, read.width, read.height, data);
+      gm->UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+      LOG(ERROR) << "Unable to map the pixel buffer of an asynchronous image "
+                    "read.";
+    }
+    gm->BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  }
+
+  // Recycle the buffer and remove the read before invoking the callback, since
+  // the callback may start another read.
+  const AsyncImageBuffer buffer = {read.buffer, read.buffer_size};
+  async_image_buffers_.push_back(buffer);
+  const Renderer::ReadImageCallback callback = read.callback;
+  async_image_reads_.pop_front();
+  callback(image);
+  return true;
+}
+
+void Renderer::ResourceBinder::ClearAsyncImageReads() {
+  GraphicsManager* gm = GetGraphicsManager().Get();
+  for (const AsyncImageRead& read : async_image_reads_) {
+    gm->DeleteSync(read.fence);
+    gm->DeleteBuffers(1, &read.buffer);
+  }
+  async_image_reads_.clear();
+  for (const AsyncImageBuffer& buffer : async_image_buffers_)
+    gm->DeleteBuffers(1, &buffer.id);
+  async_image_buffers_.clear();
+}
+
 void Renderer::ResourceBinder::SendUniform(const Uniform& uniform, int location,
                                            GraphicsManager* gm) {
 #define SEND_VECTOR_UNIFORM(type, elem_type, num_elements, setter)             \
@@ -6256,6 +7002,7 @@ void Renderer::ResourceManager::FillInfoFromResource(
     info->vertex_shader = shader->GetId();
   if (ShaderResource* shader = resource->GetFragmentResource())
     info->fragment_shader = shader->GetId();
+  info->loaded_from_binary_cache = resource->IsLoadedFromBinaryCache();
 }
 
 template <>
@@ -19,6 +19,7 @@ limitations under the License.
 #define ION_GFX_RENDERER_H_
 
 #include <bitset>
+#include <functional>
 #include <memory>
 
 #include "base/integral_types.h"
@@ -29,6 +30,7 @@ limitations under the License.
 #include "ion/gfx/graphicsmanager.h"
 #include "ion/gfx/image.h"
 #include "ion/gfx/node.h"
+#include "ion/gfx/programbinarycache.h"
 #include "ion/gfx/resourcemanager.h"
 #include "ion/gfx/shaderprogram.h"
 #include "ion/gfx/statetable.h"
@@ -265,6 +267,27 @@ class ION_API Renderer : public base::Referent {
   // textures may be bound properly.
   void SetTextureImageUnitRange(const math::Range1i& units);
 
+  // Sets/returns the ProgramBinaryCache used to create shader programs. When a
+  // cache is set and the platform supports program binaries, a program whose
+  // sources and driver match a cache entry is created from the cached binary
+  // without compiling its shaders, and programs that are compiled are added to
+  // the cache. If a cached binary cannot be used the program is compiled as
+  // usual. The cache should be set before any programs are rendered; by
+  // default there is none.
+  void SetProgramBinaryCache(const ProgramBinaryCachePtr& cache);
+  const ProgramBinaryCachePtr& GetProgramBinaryCache() const;
+
+  // Returns whether the passed ShaderProgram has finished compiling and
+  // linking, successfully or not, which is always the case unless deferred
+  // compilation is enabled for it (see ShaderProgram::SetDeferredCompilation()).
+  // This creates the program's resource if necessary and advances any deferred
+  // compilation, so it can be called repeatedly to warm up programs before
+  // they are drawn. If the platform cannot compile programs in the background
+  // (without KHR_parallel_shader_compile), this compiles the program right
+  // away; unlike drawing, which compiles at most one deferred program per
+  // frame, it does not wait for the next frame.
+  bool IsShaderProgramReady(ShaderProgram* program);
+
   // In the below MapBuffer functions the passed BufferObject is assigned a
   // DataContainer (retrievable via BufferObject::GetMappedData()) with a
   // pointer that is mapped to memory allocated by the graphics driver if the
@@ -339,6 +362,36 @@ class ION_API Renderer : public base::Referent {
   const ImagePtr ReadImage(const math::Range2i& range, Image::Format format,
                            const base::AllocatorPtr& allocator);
 
+  // The function that receives the Image read by ReadImageAsync(). The image is
+  // NULL if the read failed.
+  typedef std::function<void(const ImagePtr& image)> ReadImageCallback;
+
+  // Starts reading an image of the hardware framebuffer like ReadImage(), but
+  // without waiting for rendering to finish. The pixels are read into a pixel
+  // buffer object and |callback| is invoked with the Image once a fence shows
+  // that they have arrived, from a later call to ReadImageAsync() or
+  // ProcessAsyncImageReads() on the same thread. Calling this once per frame
+  // therefore delivers each frame's image a frame or more later, without
+  // stalling the pipeline. At most GetAsyncImageReadCount() reads are in
+  // flight at a time; if there are already that many, this waits for the
+  // oldest one. If pixel buffer objects or sync objects are not supported,
+  // this calls ReadImage() and invokes |callback| right away.
+  void ReadImageAsync(const math::Range2i& range, Image::Format format,
+                      const base::AllocatorPtr& allocator,
+                      const ReadImageCallback& callback);
+
+  // Invokes the callbacks of any ReadImageAsync() reads that have completed.
+  // If |wait| is true, this first waits for all pending reads, e.g., at the
+  // end of a capture.
+  void ProcessAsyncImageReads(bool wait);
+
+  // Sets/returns the number of ReadImageAsync() reads that can be in flight,
+  // which is the size of the ring of pixel buffer objects. The default is 3. A
+  // count of 0 makes ReadImageAsync() read synchronously. If more reads than
+  // the new count are pending, this completes all of them first.
+  void SetAsyncImageReadCount(size_t count);
+  size_t GetAsyncImageReadCount() const { return async_image_read_count_; }
+
   // In non-production builds, pushes |marker| onto the Renderer's tracing
   // stream marker stack, outputting the marker and indenting all calls until
   // the next call to PopDebugMarker(). Does nothing in production builds.
@@ -422,6 +475,9 @@ class ION_API Renderer : public base::Referent {
 
   // The default shader program.
   ShaderProgramPtr default_shader_;
+
+  // The maximum number of ReadImageAsync() reads in flight.
+  size_t async_image_read_count_;
 };
 
 // Convenience typedef for shared pointer to a Renderer.
@@ -25,6 +25,7 @@ namespace gfx {
 ResourceHolder::ResourceHolder()
     : resources_(*this),
       resource_count_(0),
+      change_count_(0U),
       fields_(*this),
       label_(kLabelChanged, std::string(), this) {}
 
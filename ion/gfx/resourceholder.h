@@ -18,9 +18,11 @@ limitations under the License.
 #ifndef ION_GFX_RESOURCEHOLDER_H_
 #define ION_GFX_RESOURCEHOLDER_H_
 
+#include <atomic>
 #include <cstring>  // For NULL.
 #include <vector>
 
+#include "base/integral_types.h"
 #include "base/macros.h"
 #include "ion/base/invalid.h"
 #include "ion/base/lockguards.h"
@@ -85,6 +87,13 @@ class ION_API ResourceHolder : public base::Notifier {
     return total;
   }
 
+  // Returns the number of times a change has been made to this holder. This
+  // allows observers such as remote inspectors to cheaply tell whether the
+  // holder (and thus its resources) may have changed since they last looked.
+  uint64 GetChangeCount() const {
+    return change_count_.load(std::memory_order_relaxed);
+  }
+
   // Returns/sets the label of this.
   const std::string& GetLabel() const { return label_.Get(); }
   void SetLabel(const std::string& label) { label_.Set(label); }
@@ -324,6 +333,7 @@ class ION_API ResourceHolder : public base::Notifier {
 
   // Forwards OnChanged to all resources.
   void OnChanged(int bit) const {
+    change_count_.fetch_add(1U, std::memory_order_relaxed);
     // We use a read lock since Holders should not be modified from multiple
     // threads simultaneously.
     base::ReadLock read_lock(&lock_);
@@ -354,6 +364,9 @@ class ION_API ResourceHolder : public base::Notifier {
   // Track the number of resources. It is mutable so that we update counts in
   // const functions.
   mutable std::atomic<int> resource_count_;
+  // The number of changes made to this, see GetChangeCount(). It is mutable
+  // since OnChanged() is const.
+  mutable std::atomic<uint64> change_count_;
 
   // List of fields that the ResourceHolder contains.
   base::AllocVector<FieldBase*> fields_;
@@ -22,6 +22,7 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "base/integral_types.h"
 #include "ion/base/allocatable.h"
 #include "ion/base/lockguards.h"
 #include "ion/base/referent.h"
@@ -79,14 +80,19 @@ class ION_API ResourceManager : public base::Allocatable {
   // for resources beyond those defined by the ::*Info structs (defined in
   // gfx/openglobjects.h).
   struct ResourceInfo {
-    ResourceInfo() : id(0) {}
+    ResourceInfo() : id(0), serial(0U), change_count(0U) {}
     // OpenGL object id.
     GLuint id;
+    // A number that identifies the Resource for its whole lifetime. Unlike the
+    // OpenGL id, it is never 0 and is never reused by another Resource.
+    uint64 serial;
     // The label of the ResourceHolder that owns the Resource.
     std::string label;
+    // The change count of the ResourceHolder that owns the Resource at the
+    // time the info was filled in. See ResourceHolder::GetChangeCount().
+    uint64 change_count;
   };
 
-  typedef gfx::ProgramInfo<ResourceInfo> ProgramInfo;
   typedef gfx::RenderbufferInfo<ResourceInfo> RenderbufferInfo;
   typedef gfx::SamplerInfo<ResourceInfo> SamplerInfo;
   typedef gfx::ShaderInfo<ResourceInfo> ShaderInfo;
@@ -107,6 +113,12 @@ class ION_API ResourceManager : public base::Allocatable {
     RenderbufferInfo depth_renderbuffer;
     RenderbufferInfo stencil_renderbuffer;
   };
+  struct ProgramResourceInfo : ResourceInfo {
+    ProgramResourceInfo() : loaded_from_binary_cache(false) {}
+    // Whether the program was created from a ProgramBinaryCache entry instead
+    // of by compiling its shaders.
+    bool loaded_from_binary_cache;
+  };
   struct TextureResourceInfo : ResourceInfo {
     // The texture unit the texture is bound to.
     GLenum unit;
@@ -123,6 +135,7 @@ class ION_API ResourceManager : public base::Allocatable {
   typedef gfx::ArrayInfo<ArrayResourceInfo> ArrayInfo;
   typedef gfx::BufferInfo<BufferTargetInfo> BufferInfo;
   typedef gfx::FramebufferInfo<FramebufferResourceInfo> FramebufferInfo;
+  typedef gfx::ProgramInfo<ProgramResourceInfo> ProgramInfo;
   typedef gfx::TextureInfo<TextureResourceInfo> TextureInfo;
 
   // Struct for getting information about the local OpenGL platform.
@@ -185,6 +198,11 @@ class ION_API ResourceManager : public base::Allocatable {
     typedef std::function<void(const std::vector<T>& infos)> Type;
   };
 
+  // Filter passed to RequestChangedResourceInfos(). It is called with the
+  // serial number (see ResourceInfo) of each resource and the change count of
+  // its holder, and returns whether info about the resource is wanted.
+  typedef std::function<bool(uint64 serial, uint64 change_count)> InfoFilter;
+
   //---------------------------------------------------------------------------
   //
   // Functions.
@@ -223,6 +241,24 @@ class ION_API ResourceManager : public base::Allocatable {
             typename base::ReferentPtr<HolderType>::Type(), callback));
   }
 
+  // Requests information about all resources of the passed type for which the
+  // passed filter returns true. The filter is called on the Renderer's thread
+  // before any OpenGL queries are made, so resources that are filtered out
+  // cost almost nothing. This allows clients that already know about most
+  // resources to request only those whose holders have changed since they last
+  // asked. See the comment for RequestInfoForResource() for details about the
+  // callback.
+  template <typename HolderType, typename InfoType>
+  void RequestChangedResourceInfos(
+      const InfoFilter& filter,
+      const typename InfoCallback<InfoType>::Type& callback) {
+    base::LockGuard lock_guard(&this->request_mutex_);
+    ResourceRequest<HolderType, InfoType> request(
+        typename base::ReferentPtr<HolderType>::Type(), callback);
+    request.filter = filter;
+    GetResourceRequestVector<HolderType, InfoType>()->push_back(request);
+  }
+
   // Requests information about the local OpenGL platform. See the comment for
   // RequestInfoForResource() for details about the callback.
   void RequestPlatformInfo(const InfoCallback<PlatformInfo>::Type& callback);
@@ -257,6 +293,8 @@ class ION_API ResourceManager : public base::Allocatable {
         : holder(holder_in), callback(callback_in) {}
     typename base::ReferentPtr<HolderType>::Type holder;
     typename InfoCallback<InfoType>::Type callback;
+    // Optional filter for requests about all resources.
+    InfoFilter filter;
   };
 
   // A valid GraphicsManagerPtr must be passed to the constructor. The
@@ -195,9 +195,9 @@ bool ShaderInputRegistry::Include(const ShaderInputRegistryPtr& reg) {
 
   // Check that reg does not contain any inputs that this registry or any of
   // its existing inputs already contain.
-  const SpecMapType specs = GetAllSpecEntries();
-  for (SpecMapType::const_iterator it = specs.begin(); it != specs.end();
-       ++it) {
+  const SortedSpecMapType specs = GetAllSpecEntries();
+  for (SortedSpecMapType::const_iterator it = specs.begin();
+       it != specs.end(); ++it) {
     if (reg->Contains(it->first)) {
       LOG(ERROR) << "Can't include registry " << reg->GetId() << " in registry "
                  << GetId() << " because they or their includes both define the"
@@ -219,9 +219,10 @@ bool ShaderInputRegistry::CheckInputsAreUnique() const {
   SpecMapType specs = spec_map_;
   const size_t num_includes = includes_.size();
   for (size_t i = 0; i < num_includes; ++i) {
-    const SpecMapType& included_specs = includes_[i]->GetAllSpecEntries();
+    const SortedSpecMapType& included_specs =
+        includes_[i]->GetAllSpecEntries();
     // Check if anything from included_specs is in spec_map.
-    for (SpecMapType::const_iterator it = included_specs.begin();
+    for (SortedSpecMapType::const_iterator it = included_specs.begin();
          it != included_specs.end(); ++it) {
       if (specs.count(it->first)) {
         LOG(WARNING) << "Registry " << specs[it->first].registry_id
@@ -246,12 +247,13 @@ ShaderInputRegistry::GetMutableSpecs() {
   return uniform_specs_.GetMutable();
 }
 
-const ShaderInputRegistry::SpecMapType
+const ShaderInputRegistry::SortedSpecMapType
 ShaderInputRegistry::GetAllSpecEntries() const {
-  SpecMapType specs = spec_map_;
+  SortedSpecMapType specs(*this, spec_map_);
   const size_t num_includes = includes_.size();
   for (size_t i = 0; i < num_includes; ++i) {
-    const SpecMapType& included_specs = includes_[i]->GetAllSpecEntries();
+    const SortedSpecMapType& included_specs =
+        includes_[i]->GetAllSpecEntries();
     specs.insert(included_specs.begin(), included_specs.end());
   }
   return specs;
@@ -29,12 +29,14 @@ limitations under the License.
 #include "ion/base/referent.h"
 #include "ion/base/stlalloc/allocdeque.h"
 #include "ion/base/stlalloc/allocmap.h"
+#include "ion/base/stlalloc/allocunorderedmap.h"
 #include "ion/base/stlalloc/allocvector.h"
 #include "ion/base/stringutils.h"
 #include "ion/base/varianttyperesolver.h"
 #include "ion/gfx/attribute.h"
 #include "ion/gfx/resourceholder.h"
 #include "ion/gfx/uniform.h"
+#include "ion/gfx/uniformhandle.h"
 
 namespace ion {
 namespace gfx {
@@ -138,6 +140,7 @@ class ION_API ShaderInputRegistry : public ResourceHolder {
         : name(name_in),
           value_type(value_type_in),
           doc_string(doc_string_in),
+          name_hash(0),
           index(0),
           registry_id(0),
           registry(NULL),
@@ -147,6 +150,7 @@ class ION_API ShaderInputRegistry : public ResourceHolder {
     std::string name;                  // Name of the shader input argument.
     typename T::ValueType value_type;  // Type of the value of the shader input.
     std::string doc_string;            // String describing its use.
+    uint64 name_hash;                  // Hash of the name; see UniformHandle.
     size_t index;                      // Unique index within registry.
     size_t registry_id;                // Id of the owning registry.
     // The registry that created this spec. This is a raw pointer since when the
@@ -208,6 +212,7 @@ class ION_API ShaderInputRegistry : public ResourceHolder {
       base::AllocDeque<Spec<T> >& specs = *GetMutableSpecs<T>();
       const size_t index = specs.size();
       specs.push_back(spec);
+      specs.back().name_hash = UniformHandle::HashName(spec.name);
       specs.back().index = index;
       specs.back().registry_id = id_;
       specs.back().registry = this;
@@ -397,10 +402,13 @@ class ION_API ShaderInputRegistry : public ResourceHolder {
     size_t index;
     size_t registry_id;
   };
-  typedef base::AllocMap<const std::string, SpecMapEntry> SpecMapType;
+  // Specs are looked up by name through a hash index, while a sorted map is
+  // used where they are listed, so that messages come out in a stable order.
+  typedef base::AllocUnorderedMap<std::string, SpecMapEntry> SpecMapType;
+  typedef base::AllocMap<const std::string, SpecMapEntry> SortedSpecMapType;
 
   // Returns a map of all Specs added to the registry and its includes.
-  const SpecMapType GetAllSpecEntries() const;
+  const SortedSpecMapType GetAllSpecEntries() const;
 
   // Get an editable vector of specs of type T in this registry only.
   template <typename T>
@@ -27,7 +27,8 @@ ShaderProgram::ShaderProgram(const ShaderInputRegistryPtr& registry)
       fragment_shader_(kFragmentShaderChanged, ShaderPtr(), this),
       registry_(registry),
       concurrent_(false),
-      concurrent_set_(false) {
+      concurrent_set_(false),
+      deferred_compilation_(false) {
   DCHECK(registry_.Get());
 }
 
@@ -88,6 +88,31 @@ class ION_API ShaderProgram : public ShaderBase {
   void SetConcurrent(bool value);
   bool IsConcurrent() const { return concurrent_; }
 
+  // Sets/returns whether this shader program is compiled and linked without
+  // blocking rendering. When this is enabled, a Renderer only starts compiling
+  // the program when its resource is created or its shaders change, and keeps
+  // drawing with the previously linked program object (or the fallback program,
+  // see below) until the new one is ready. Shapes that have no usable program
+  // are skipped. Where the KHR_parallel_shader_compile extension is supported
+  // the driver compiles any number of deferred programs concurrently; otherwise
+  // the Renderer compiles at most one deferred program per frame. By default,
+  // this setting is disabled, and programs are compiled and linked when they
+  // are first needed.
+  void SetDeferredCompilation(bool value) { deferred_compilation_ = value; }
+  bool IsDeferredCompilation() const { return deferred_compilation_; }
+
+  // Sets/returns a ShaderProgram that is used in place of this one while it is
+  // being compiled with deferred compilation enabled and has never been linked
+  // successfully, e.g., a cheap program that only needs a few uniforms. The
+  // fallback program should use this program's registry or one that it
+  // includes. By default there is no fallback program.
+  void SetFallbackProgram(const ShaderProgramPtr& program) {
+    fallback_program_ = program;
+  }
+  const ShaderProgramPtr& GetFallbackProgram() const {
+    return fallback_program_;
+  }
+
   // Convenience function that builds and returns a new ShaderProgram instance
   // that uses the given ShaderInputRegistry and that points to new vertex and
   // fragment Shader instances whose sources are specified as strings. The
@@ -118,6 +143,10 @@ class ION_API ShaderProgram : public ShaderBase {
   bool concurrent_;
   // True if SetConcurrent was already called on this instance.
   bool concurrent_set_;
+  // True if the program should be compiled without blocking rendering.
+  bool deferred_compilation_;
+  // The program that is drawn with until this one is ready.
+  ShaderProgramPtr fallback_program_;
 };
 
 }  // namespace gfx
@@ -35,6 +35,7 @@
         'mockgraphicsmanager_test.cc',
         'mockresource_test.cc',
         'node_test.cc',
+        'programbinarycache_test.cc',
         'renderer_test.cc',
         'resourcemanager_test.cc',
         'sampler_test.cc',
@@ -75,5 +76,22 @@
         '<(ion_dir)/portgfx/portgfx.gyp:ionportgfx_for_tests',
       ],
     },
+    {
+      # Compares setting uniforms by name, handle, and index. This is not part
+      # of iongfx_test since it takes a while.
+      'target_name': 'iongfx_benchmark',
+      'includes': [ '../../dev/test_target.gypi' ],
+      'sources' : [
+        'uniformholder_benchmark.cc',
+      ],
+      'dependencies' : [
+        '<(ion_dir)/analytics/analytics.gyp:ionanalytics',
+        '<(ion_dir)/base/base.gyp:ionbase_for_tests',
+        '<(ion_dir)/external/gtest.gyp:iongtest_safeallocs',
+        '<(ion_dir)/gfx/gfx.gyp:iongfx_for_tests',
+        '<(ion_dir)/port/port.gyp:ionport',
+        '<(ion_dir)/portgfx/portgfx.gyp:ionportgfx_for_tests',
+      ],
+    },
   ],
 }
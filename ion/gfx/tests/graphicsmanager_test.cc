@@ -603,12 +603,31 @@ TEST_F(GraphicsManagerTest, IsFunctionAvailable) {
                  mgr_->IsExtensionSupported("map_buffer_range"));
   }
 
+  if (mgr_->IsFunctionGroupAvailable(
+          GraphicsManager::kParallelShaderCompile)) {
+    EXPECT_TRUE(mgr_->IsFunctionAvailable("MaxShaderCompilerThreads"));
+  } else {
+    EXPECT_FALSE(mgr_->IsFunctionAvailable("MaxShaderCompilerThreads") &&
+                 mgr_->IsExtensionSupported("parallel_shader_compile"));
+  }
+
   if (mgr_->IsFunctionGroupAvailable(GraphicsManager::kPointSize)) {
     EXPECT_TRUE(mgr_->IsFunctionAvailable("PointSize"));
   } else {
     EXPECT_FALSE(mgr_->IsFunctionAvailable("PointSize"));
   }
 
+  if (mgr_->IsFunctionGroupAvailable(GraphicsManager::kProgramBinary)) {
+    EXPECT_TRUE(mgr_->IsFunctionAvailable("GetProgramBinary"));
+    EXPECT_TRUE(mgr_->IsFunctionAvailable("ProgramBinary"));
+    EXPECT_TRUE(mgr_->IsFunctionAvailable("ProgramParameteri"));
+  } else {
+    EXPECT_FALSE(mgr_->IsFunctionAvailable("GetProgramBinary") &&
+                 mgr_->IsFunctionAvailable("ProgramBinary") &&
+                 mgr_->IsFunctionAvailable("ProgramParameteri") &&
+                 mgr_->IsExtensionSupported("get_program_binary"));
+  }
+
   if (mgr_->IsFunctionGroupAvailable(GraphicsManager::kSamplerObjects)) {
     EXPECT_TRUE(mgr_->IsFunctionAvailable("BindSampler"));
     EXPECT_TRUE(mgr_->IsFunctionAvailable("DeleteSamplers"));
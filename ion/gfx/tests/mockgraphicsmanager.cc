@@ -75,6 +75,10 @@ GLsizeiptr MockGraphicsManager::GetMaxBufferSize() const {
   return MockVisual::GetCurrent()->GetMaxBufferSize();
 }
 
+void MockGraphicsManager::SetCompletionStatusDelay(int query_count) {
+  MockVisual::GetCurrent()->SetCompletionStatusDelay(query_count);
+}
+
 void MockGraphicsManager::SetForceFunctionFailure(
     const std::string& func_name, bool always_fails) {
   MockVisual::GetCurrent()->SetForceFunctionFailure(func_name, always_fails);
@@ -55,6 +55,13 @@ class MockGraphicsManager : public GraphicsManager {
   void SetMaxBufferSize(GLsizeiptr size_in_bytes);
   GLsizeiptr GetMaxBufferSize() const;
 
+  // Sets the number of times that querying GL_COMPLETION_STATUS_KHR for a
+  // shader or program returns GL_FALSE after it is compiled or linked, which
+  // simulates a driver that compiles in the background. Querying
+  // GL_COMPILE_STATUS or GL_LINK_STATUS waits for completion, as in OpenGL. The
+  // default is 0, meaning compiling and linking complete immediately.
+  void SetCompletionStatusDelay(int query_count);
+
   // Forces a particular function to always fail. This is useful for testing the
   // handling of error cases. Any function set to fail will generate a
   // GL_INVALID_OPERATION and perform whatever action (e.g., do nothing or
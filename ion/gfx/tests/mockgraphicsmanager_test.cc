@@ -4503,6 +4503,80 @@ TEST(MockGraphicsManagerTest, ProgramAndShaderFunctions) {
   }
 }
 
+TEST(MockGraphicsManagerTest, ProgramBinaries) {
+  MockVisual visual(600, 500);
+  MockGraphicsManagerPtr gm(new MockGraphicsManager());
+  EXPECT_TRUE(gm->IsFunctionGroupAvailable(GraphicsManager::kProgramBinary));
+
+  GLuint pid = gm->CreateProgram();
+  GLuint vid = gm->CreateShader(GL_VERTEX_SHADER);
+  GLuint fid = gm->CreateShader(GL_FRAGMENT_SHADER);
+  const char* vertex_source = "attribute vec3 aVertex;\n";
+  const char* fragment_source = "uniform vec4 uColor;\n";
+  GM_CALL(ShaderSource(vid, 1, &vertex_source, NULL));
+  GM_CALL(ShaderSource(fid, 1, &fragment_source, NULL));
+  GM_CALL(CompileShader(vid));
+  GM_CALL(CompileShader(fid));
+  GM_CALL(AttachShader(pid, vid));
+  GM_CALL(AttachShader(pid, fid));
+
+  // ProgramParameteri.
+  GLint value = GL_TRUE;
+  GM_ERROR_CALL(ProgramParameteri(pid + 10U,
+                                  GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE),
+                GL_INVALID_VALUE);
+  GM_ERROR_CALL(ProgramParameteri(pid, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, 2),
+                GL_INVALID_VALUE);
+  GM_ERROR_CALL(ProgramParameteri(pid, GL_LINK_STATUS, GL_TRUE),
+                GL_INVALID_ENUM);
+  GM_CALL(GetProgramiv(pid, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, &value));
+  EXPECT_EQ(GL_FALSE, value);
+  GM_CALL(ProgramParameteri(pid, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+  GM_CALL(GetProgramiv(pid, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, &value));
+  EXPECT_EQ(GL_TRUE, value);
+
+  // GetProgramBinary.
+  char binary[256];
+  GLsizei length = 0;
+  GLenum format = GL_NONE;
+  GM_CALL(GetProgramiv(pid, GL_PROGRAM_BINARY_LENGTH, &value));
+  EXPECT_EQ(0, value);
+  // The program is not linked.
+  GM_ERROR_CALL(GetProgramBinary(pid, 256, &length, &format, binary),
+                GL_INVALID_OPERATION);
+  GM_CALL(LinkProgram(pid));
+  GM_CALL(GetProgramiv(pid, GL_PROGRAM_BINARY_LENGTH, &value));
+  EXPECT_LT(0, value);
+  GM_ERROR_CALL(GetProgramBinary(pid + 10U, 256, &length, &format, binary),
+                GL_INVALID_VALUE);
+  GM_ERROR_CALL(GetProgramBinary(pid, value - 1, &length, &format, binary),
+                GL_INVALID_OPERATION);
+  GM_CALL(GetProgramBinary(pid, 256, &length, &format, binary));
+  EXPECT_EQ(value, length);
+  EXPECT_NE(static_cast<GLenum>(GL_NONE), format);
+
+  // ProgramBinary.
+  GLuint pid2 = gm->CreateProgram();
+  GM_ERROR_CALL(ProgramBinary(pid2 + 10U, format, binary, length),
+                GL_INVALID_VALUE);
+  GM_ERROR_CALL(ProgramBinary(pid2, GL_RGBA, binary, length),
+                GL_INVALID_ENUM);
+  GM_CALL(ProgramBinary(pid2, format, binary, length));
+  GM_CALL(GetProgramiv(pid2, GL_LINK_STATUS, &value));
+  EXPECT_EQ(GL_TRUE, value);
+  EXPECT_EQ(0, gm->GetAttribLocation(pid2, "aVertex"));
+  EXPECT_LE(0, gm->GetUniformLocation(pid2, "uColor"));
+  GM_CALL(GetProgramiv(pid2, GL_ATTACHED_SHADERS, &value));
+  EXPECT_EQ(0, value);
+
+  // A binary that cannot be loaded leaves the program unlinked.
+  GM_CALL(ProgramBinary(pid2, format, "garbage", 7));
+  GM_CALL(GetProgramiv(pid2, GL_LINK_STATUS, &value));
+  EXPECT_EQ(GL_FALSE, value);
+  GM_CALL(GetProgramiv(pid2, GL_ACTIVE_ATTRIBUTES, &value));
+  EXPECT_EQ(0, value);
+}
+
 TEST(MockGraphicsManagerTest, Uniforms) {
   MockVisual visual(600, 500);
   MockGraphicsManagerPtr gm(new MockGraphicsManager());
@@ -135,6 +135,23 @@ TEST_F(MockResourceTest, MockResource) {
   EXPECT_FALSE(resource_->TestModifiedBitRange(0, 6));
 }
 
+TEST_F(MockResourceTest, ChangeCount) {
+  EXPECT_EQ(0U, holder_->GetChangeCount());
+
+  holder_->Change(0);
+  EXPECT_EQ(1U, holder_->GetChangeCount());
+  holder_->Change(3);
+  holder_->Change(3);
+  EXPECT_EQ(3U, holder_->GetChangeCount());
+
+  // Resetting the resource's bits does not affect the holder's count.
+  resource_->ResetModifiedBits();
+  EXPECT_EQ(3U, holder_->GetChangeCount());
+
+  holder_->SetLabel("label");
+  EXPECT_EQ(4U, holder_->GetChangeCount());
+}
+
 TEST_F(MockResourceTest, SetResource) {
   // SetUp() sets the initial resource.
   EXPECT_EQ(resource_.get(), holder_->GetResource(0U, 0));
@@ -75,6 +75,11 @@ static const char kExtensionsString[] =
     "GL_ARB_transform_feedback2 GL_ARB_transform_feedback3 "
     "GL_EXT_transform_feedback GL_OES_EGL_image GL_OES_EGL_image_external";
 
+// The only program binary format returned by GetProgramBinary(). Mock program
+// binaries hold the vertex and fragment shader sources separated by a null
+// character, and are relinked from them by ProgramBinary().
+static const GLenum kMockProgramBinaryFormat = 0x10f1;
+
 // Base struct for OpenGL object structs. See below comment.
 struct OpenGlObject {
   OpenGlObject() : deleted(false) {}
@@ -126,13 +131,28 @@ struct BufferObjectData : OpenGlObject {
 typedef BufferInfo<BufferObjectData> BufferObject;
 typedef FramebufferInfo<OpenGlObject> FramebufferObject;
 struct ProgramObjectData : OpenGlObject {
-  ProgramObjectData() : max_uniform_location(0) {}
+  ProgramObjectData()
+      : max_uniform_location(0),
+        binary_retrievable_hint(GL_FALSE),
+        pending_completion_queries(0) {}
   GLint max_uniform_location;
+  // The program binary of the last successful link; see GetProgramBinary().
+  std::string binary;
+  GLint binary_retrievable_hint;
+  // The number of GL_COMPLETION_STATUS_KHR queries that report the last link
+  // as still in progress.
+  int pending_completion_queries;
 };
 typedef ProgramInfo<ProgramObjectData> ProgramObject;
 typedef RenderbufferInfo<OpenGlObject> RenderbufferObject;
 typedef SamplerInfo<OpenGlObject> SamplerObject;
-typedef ShaderInfo<OpenGlObject> ShaderObject;
+struct ShaderObjectData : OpenGlObject {
+  ShaderObjectData() : pending_completion_queries(0) {}
+  // The number of GL_COMPLETION_STATUS_KHR queries that report the last
+  // compile as still in progress.
+  int pending_completion_queries;
+};
+typedef ShaderInfo<ShaderObjectData> ShaderObject;
 typedef SyncInfo<OpenGlObject> SyncObject;
 struct TransformFeedbackObjectData : OpenGlObject {
   TransformFeedbackObjectData()
@@ -893,6 +913,13 @@ class MockVisual::ShadowState {
   }
   GLsizeiptr GetMaxBufferSize() const { return max_buffer_size_; }
 
+  // Sets the number of times that querying GL_COMPLETION_STATUS_KHR for a
+  // shader or program reports it as still compiling or linking. This is used
+  // for testing code that polls for KHR_parallel_shader_compile completion.
+  void SetCompletionStatusDelay(int query_count) {
+    completion_status_delay_ = query_count;
+  }
+
   // Gets/sets the current OpenGL error code for testing.
   GLenum GetErrorCode() const { return error_code_; }
   void SetErrorCode(GLenum error_code) { error_code_ = error_code; }
@@ -964,6 +991,7 @@ class MockVisual::ShadowState {
           index_buffer(0U),
           read_buffer(0U),
           write_buffer(0U),
+          pixel_pack_buffer(0U),
           program(0U),
           renderbuffer(0U),
           transform_feedback(0U) {}
@@ -975,6 +1003,7 @@ class MockVisual::ShadowState {
     GLuint index_buffer;
     GLuint read_buffer;
     GLuint write_buffer;
+    GLuint pixel_pack_buffer;
     GLuint program;
     GLuint renderbuffer;
     GLuint transform_feedback;
@@ -1172,7 +1201,8 @@ class MockVisual::ShadowState {
     return CheckGlEnum(target == GL_ARRAY_BUFFER ||
                        target == GL_ELEMENT_ARRAY_BUFFER ||
                        target == GL_COPY_READ_BUFFER ||
-                       target == GL_COPY_WRITE_BUFFER);
+                       target == GL_COPY_WRITE_BUFFER ||
+                       target == GL_PIXEL_PACK_BUFFER);
   }
   bool CheckBufferZeroNotBound(GLenum target) {
     return CheckGlOperation(
@@ -1181,7 +1211,9 @@ class MockVisual::ShadowState {
          active_objects_.index_buffer != 0U) ||
         (target == GL_COPY_READ_BUFFER && active_objects_.read_buffer != 0U) ||
         (target == GL_COPY_WRITE_BUFFER &&
-         active_objects_.write_buffer != 0U));
+         active_objects_.write_buffer != 0U) ||
+        (target == GL_PIXEL_PACK_BUFFER &&
+         active_objects_.pixel_pack_buffer != 0U));
   }
   bool CheckColorChannelEnum(GLenum channel) {
     return CheckGlEnum(channel == GL_RED || channel == GL_GREEN ||
@@ -1385,6 +1417,7 @@ class MockVisual::ShadowState {
       case GL_ELEMENT_ARRAY_BUFFER: return active_objects_.index_buffer;
       case GL_COPY_READ_BUFFER: return active_objects_.read_buffer;
       case GL_COPY_WRITE_BUFFER: return active_objects_.write_buffer;
+      case GL_PIXEL_PACK_BUFFER: return active_objects_.pixel_pack_buffer;
     }
     LOG(FATAL) << "Unknown target";
     return 0;
@@ -1770,6 +1803,9 @@ class MockVisual::ShadowState {
         case GL_COPY_WRITE_BUFFER:
           active_objects_.write_buffer = buffer;
           break;
+        case GL_PIXEL_PACK_BUFFER:
+          active_objects_.pixel_pack_buffer = buffer;
+          break;
       }
       object_state_->buffers[buffer].bindings.push_back(GetCallCount());
     }
@@ -1880,15 +1916,15 @@ class MockVisual::ShadowState {
     // GL_INVALID_ENUM is generated if target is not one of the allowable
     // values.
     // GL_INVALID_ENUM is generated if usage is not GL_STREAM_DRAW,
-    // GL_STATIC_DRAW, or GL_DYNAMIC_DRAW.
+    // GL_STREAM_READ, GL_STATIC_DRAW, or GL_DYNAMIC_DRAW.
     // GL_INVALID_VALUE is generated if size is negative.
     // GL_INVALID_OPERATION is generated if the reserved buffer object name 0 is
     // bound to target.
     // GL_OUT_OF_MEMORY is generated if the GL is unable to create a data store
     // with the specified size.
     if (CheckBufferTarget(target) &&
-        CheckGlEnum(usage == GL_STREAM_DRAW || usage == GL_STATIC_DRAW ||
-                    usage == GL_DYNAMIC_DRAW) &&
+        CheckGlEnum(usage == GL_STREAM_DRAW || usage == GL_STREAM_READ ||
+                    usage == GL_STATIC_DRAW || usage == GL_DYNAMIC_DRAW) &&
         CheckGlValue(size >= 0) && CheckBufferZeroNotBound(target) &&
         CheckGlMemory(size) && CheckFunction("BufferData")) {
       const GLuint index = GetBufferIndex(target);
@@ -2058,6 +2094,7 @@ class MockVisual::ShadowState {
           so.compile_status = GL_FALSE;
           so.info_log = "Shader compilation is set to always fail.";
         }
+        so.pending_completion_queries = completion_status_delay_;
       }
     }
   }
@@ -2323,6 +2360,8 @@ class MockVisual::ShadowState {
             active_objects_.read_buffer = 0U;
           if (buffers[i] == active_objects_.write_buffer)
             active_objects_.write_buffer = 0U;
+          if (buffers[i] == active_objects_.pixel_pack_buffer)
+            active_objects_.pixel_pack_buffer = 0U;
         }
       }
     }
@@ -2967,6 +3006,27 @@ class MockVisual::ShadowState {
     if (CheckFunction("GetInteger64v"))
       Getv<GLint64>(pname, params);
   }
+  void GetProgramBinary(GLuint program, GLsizei buf_size, GLsizei* length,
+                        GLenum* binary_format, GLvoid* binary) {
+    // GL_INVALID_VALUE is generated if program is not a value generated by
+    // OpenGL.
+    // GL_INVALID_OPERATION is generated if buf_size is less than the size of
+    // GL_PROGRAM_BINARY_LENGTH for program, or if GL_LINK_STATUS for the
+    // program object is false.
+    if (CheckGlValue(object_state_->programs.count(program))) {
+      const ProgramObject& po = object_state_->programs[program];
+      if (CheckGlOperation(!po.deleted && po.link_status == GL_TRUE &&
+                           buf_size >= static_cast<GLsizei>(
+                               po.binary.length())) &&
+          CheckFunction("GetProgramBinary")) {
+        if (length)
+          *length = static_cast<GLsizei>(po.binary.length());
+        *binary_format = kMockProgramBinaryFormat;
+        if (!po.binary.empty())
+          memcpy(binary, po.binary.data(), po.binary.length());
+      }
+    }
+  }
   void GetProgramInfoLog(GLuint program, GLsizei buf_size, GLsizei* length,
                          GLchar* info_log) {
     // GL_INVALID_VALUE is generated if program is not a value generated by
@@ -2996,14 +3056,24 @@ class MockVisual::ShadowState {
     // OpenGL.
     if (CheckGlValue(object_state_->programs.count(program)) &&
         CheckFunction("GetProgramiv")) {
-      const ProgramObject& po = object_state_->programs[program];
+      ProgramObject& po = object_state_->programs[program];
       switch (pname) {
         case GL_DELETE_STATUS:
           *params = po.delete_status;
           break;
         case GL_LINK_STATUS:
+          // Querying the status waits for linking to complete.
+          po.pending_completion_queries = 0;
           *params = po.link_status;
           break;
+        case GL_COMPLETION_STATUS_KHR:
+          if (po.pending_completion_queries > 0) {
+            --po.pending_completion_queries;
+            *params = GL_FALSE;
+          } else {
+            *params = GL_TRUE;
+          }
+          break;
         case GL_VALIDATE_STATUS:
           *params = po.validate_status;
           break;
@@ -3047,6 +3117,12 @@ class MockVisual::ShadowState {
           *params = length;
           break;
         }
+        case GL_PROGRAM_BINARY_LENGTH:
+          *params = static_cast<GLint>(po.binary.length());
+          break;
+        case GL_PROGRAM_BINARY_RETRIEVABLE_HINT:
+          *params = po.binary_retrievable_hint;
+          break;
         default:
           // GL_INVALID_ENUM is generated if pname is not an accepted value.
           CheckGlEnum(false);
@@ -3200,7 +3276,7 @@ class MockVisual::ShadowState {
     // OpenGL.
     if (CheckGlValue(object_state_->shaders.count(shader)) &&
         CheckFunction("GetShaderiv")) {
-      const ShaderObject& so = object_state_->shaders[shader];
+      ShaderObject& so = object_state_->shaders[shader];
       switch (pname) {
         case GL_SHADER_TYPE:
           *params = so.type;
@@ -3209,8 +3285,18 @@ class MockVisual::ShadowState {
           *params = so.delete_status;
           break;
         case GL_COMPILE_STATUS:
+          // Querying the status waits for compilation to complete.
+          so.pending_completion_queries = 0;
           *params = so.compile_status;
           break;
+        case GL_COMPLETION_STATUS_KHR:
+          if (so.pending_completion_queries > 0) {
+            --so.pending_completion_queries;
+            *params = GL_FALSE;
+          } else {
+            *params = GL_TRUE;
+          }
+          break;
         case GL_INFO_LOG_LENGTH:
           *params = static_cast<GLint>(
               so.info_log.length() ? so.info_log.length() + 1 : 0);
@@ -3735,12 +3821,17 @@ class MockVisual::ShadowState {
                   &po, object_state_->shaders[po.fragment_shader].source);
               po.link_status = GL_TRUE;
               po.info_log.clear();
+              po.binary = object_state_->shaders[po.vertex_shader].source;
+              po.binary.push_back('\0');
+              po.binary.append(
+                  object_state_->shaders[po.fragment_shader].source);
             }
           } else {
             po.link_status = GL_FALSE;
             po.info_log = "Program linking is set to always fail.";
           }
         }
+        po.pending_completion_queries = completion_status_delay_;
       }
     }
   }
@@ -3762,6 +3853,53 @@ class MockVisual::ShadowState {
     polygon_offset_factor_ = factor;
     polygon_offset_units_ = units;
   }
+  void ProgramBinary(GLuint program, GLenum binary_format,
+                     const GLvoid* binary, GLsizei length) {
+    // GL_INVALID_VALUE is generated if program is not a value generated by
+    // OpenGL.
+    // GL_INVALID_ENUM is generated if binary_format is not a value returned in
+    // GL_PROGRAM_BINARY_FORMATS.
+    if (CheckGlValue(object_state_->programs.count(program) && length >= 0) &&
+        CheckGlEnum(binary_format == kMockProgramBinaryFormat)) {
+      ProgramObject& po = object_state_->programs[program];
+      // GL_INVALID_OPERATION is generated if program is not a program object.
+      if (CheckGlOperation(!po.deleted) && CheckFunction("ProgramBinary")) {
+        // A binary that cannot be loaded is not an error, but leaves the
+        // program unlinked.
+        const std::string data(static_cast<const char*>(binary),
+                               static_cast<size_t>(length));
+        const size_t separator = data.find('\0');
+        po.attributes.clear();
+        po.uniforms.clear();
+        po.varyings.clear();
+        po.max_uniform_location = 0U;
+        po.binary.clear();
+        if (separator == std::string::npos ||
+            data.find('\0', separator + 1U) != std::string::npos) {
+          po.link_status = GL_FALSE;
+          po.info_log = "Invalid program binary.";
+        } else {
+          AddShaderInputs(&po, data.substr(0, separator));
+          AddShaderInputs(&po, data.substr(separator + 1U));
+          po.link_status = GL_TRUE;
+          po.info_log.clear();
+          po.binary = data;
+        }
+      }
+    }
+  }
+  void ProgramParameteri(GLuint program, GLenum pname, GLint value) {
+    // GL_INVALID_VALUE is generated if program is not a value generated by
+    // OpenGL, or if value is not GL_FALSE or GL_TRUE.
+    // GL_INVALID_ENUM is generated if pname is not
+    // GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+    if (CheckGlValue(object_state_->programs.count(program) &&
+                     (value == GL_FALSE || value == GL_TRUE)) &&
+        CheckGlEnum(pname == GL_PROGRAM_BINARY_RETRIEVABLE_HINT) &&
+        CheckFunction("ProgramParameteri")) {
+      object_state_->programs[program].binary_retrievable_hint = value;
+    }
+  }
   void ReadPixels(GLint x, GLint y, GLsizei width, GLsizei height,
                   GLenum format, GLenum type, GLvoid* data) {
     // GL_INVALID_ENUM is generated if format or type is not an accepted value.
@@ -3813,10 +3951,25 @@ class MockVisual::ShadowState {
                            type != GL_UNSIGNED_INT_5_9_9_9_REV) ||
                           format == GL_RGBA)) &&
         // TODO(user): implement surface format checks described above.
-        CheckFramebuffer() && CheckFunction("ReadPixels")) {
+        CheckFramebuffer() && CheckPixelPackBufferRange(data) &&
+        CheckFunction("ReadPixels")) {
       // MockGraphicsManager neither reads nor writes pixels.
     }
   }
+  // When a pixel pack buffer is bound, the data pointer passed to ReadPixels()
+  // is an offset into the buffer.
+  // GL_INVALID_OPERATION is generated if a buffer object is bound to
+  // GL_PIXEL_PACK_BUFFER and it is currently mapped, or the offset is beyond
+  // the end of its data store.
+  bool CheckPixelPackBufferRange(const GLvoid* data) {
+    if (!active_objects_.pixel_pack_buffer)
+      return true;
+    const BufferObject& bo =
+        object_state_->buffers[active_objects_.pixel_pack_buffer];
+    return CheckGlOperation(bo.mapped_data == NULL &&
+                            reinterpret_cast<size_t>(data) <
+                                static_cast<size_t>(bo.size));
+  }
   void ReleaseShaderCompiler() {
     // GL_INVALID_OPERATION is generated if a shader compiler is not supported.
     CheckGlOperation(false);
@@ -5325,6 +5478,12 @@ class MockVisual::ShadowState {
     return data;
   }
 
+  // ParallelShaderCompile group.
+  void MaxShaderCompilerThreads(GLuint count) {
+    if (CheckFunction("MaxShaderCompilerThreads"))
+      max_shader_compiler_threads_ = count;
+  }
+
   // PointSize group.
   void PointSize(GLfloat size) {
     // GL_INVALID_VALUE is generated if size is less than or equal to 0.
@@ -6587,6 +6746,10 @@ class MockVisual::ShadowState {
   // Maximum buffer size for testing out-of-memory errors.
   GLsizeiptr max_buffer_size_;
 
+  // Number of pending GL_COMPLETION_STATUS_KHR queries after each compile or
+  // link.
+  int completion_status_delay_;
+
   // Enabled capability state.
   static const int kNumCapabilities = 14;
   std::bitset<kNumCapabilities> enabled_state_;
@@ -6628,6 +6791,9 @@ class MockVisual::ShadowState {
   // Point size.
   GLfloat point_size_;
 
+  // Number of shader compiler threads requested by MaxShaderCompilerThreads().
+  GLuint max_shader_compiler_threads_;
+
   // Polygon offset state.
   GLfloat polygon_offset_factor_;
   GLfloat polygon_offset_units_;
@@ -6703,7 +6869,8 @@ MockVisual::ShadowState::ShadowState(int window_width, int window_height)
     : window_width_(window_width),
       window_height_(window_height),
       object_state_(std::make_shared<ObjectState>()),
-      max_buffer_size_(0) {
+      max_buffer_size_(0),
+      completion_status_delay_(0) {
   // All capabilities except GL_DITHER are disabled by default.
   enabled_state_.reset();
   enabled_state_.set(GetCapabilityIndex(GL_DITHER));
@@ -6736,6 +6903,8 @@ MockVisual::ShadowState::ShadowState(int window_width, int window_height)
   line_width_ = 1.f;
   pack_alignment_ = unpack_alignment_ = 4;
   point_size_ = 1.f;
+  // The initial value is implementation-dependent; this means no limit.
+  max_shader_compiler_threads_ = 0xffffffff;
   polygon_offset_factor_ = polygon_offset_units_ = 0.0f;
   sample_coverage_value_ = 1.0f;
   sample_coverage_inverted_ = false;
@@ -6987,6 +7156,8 @@ void MockVisual::ShadowState::Getv(GLenum pname, T* params) {
       ION_SET(kMaxRenderbufferSize);
     case GL_MAX_SAMPLES:
       ION_SET(kMaxSamples);
+    case GL_MAX_SHADER_COMPILER_THREADS_KHR:
+      ION_SET(max_shader_compiler_threads_);
     case GL_MAX_SAMPLE_MASK_WORDS:
       ION_SET(kMaxSampleMaskWords);
     case GL_MAX_TEXTURE_IMAGE_UNITS:
@@ -7019,6 +7190,8 @@ void MockVisual::ShadowState::Getv(GLenum pname, T* params) {
       ION_SET(kNumShaderBinaryFormats);
     case GL_PACK_ALIGNMENT:
       ION_SET(pack_alignment_);
+    case GL_PIXEL_PACK_BUFFER_BINDING:
+      ION_SET(active_objects_.pixel_pack_buffer);
     case GL_POINT_SIZE:
       ION_SET(point_size_);
     case GL_POLYGON_OFFSET_FACTOR:
@@ -7257,6 +7430,11 @@ GLsizeiptr MockVisual::GetMaxBufferSize() const {
   return shadow_state_->GetMaxBufferSize();
 }
 
+void MockVisual::SetCompletionStatusDelay(int query_count) {
+  base::LockGuard lock(shadow_state_->GetMutex());
+  shadow_state_->SetCompletionStatusDelay(query_count);
+}
+
 GLenum MockVisual::GetErrorCode() const {
   base::LockGuard lock(shadow_state_->GetMutex());
   return shadow_state_->GetErrorCode();
@@ -86,6 +86,10 @@ class MockVisual : public portgfx::Visual {
   void SetMaxBufferSize(GLsizeiptr size_in_bytes);
   GLsizeiptr GetMaxBufferSize() const;
 
+  // Sets the number of times that GL_COMPLETION_STATUS_KHR reports a shader or
+  // program as still compiling or linking.
+  void SetCompletionStatusDelay(int query_count);
+
   // Gets/sets the current OpenGL error code for testing.
   GLenum GetErrorCode() const;
   void SetErrorCode(GLenum error_code);
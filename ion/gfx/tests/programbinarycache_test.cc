@@ -0,0 +1,147 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/gfx/programbinarycache.h"
+
+#include <stdio.h>
+
+#include <string>
+
+#include "ion/base/logchecker.h"
+#include "ion/port/fileutils.h"
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace gfx {
+
+namespace {
+
+static ProgramBinaryCache::Entry CreateEntry(const std::string& binary) {
+  ProgramBinaryCache::Entry entry;
+  entry.format = 0x1234;
+  entry.binary = binary;
+  entry.attribute_bindings = "aVertex=0,aNormal=1";
+  return entry;
+}
+
+static bool EntriesMatch(const ProgramBinaryCache::Entry& a,
+                         const ProgramBinaryCache::Entry& b) {
+  return a.format == b.format && a.binary == b.binary &&
+      a.attribute_bindings == b.attribute_bindings;
+}
+
+}  // anonymous namespace
+
+TEST(ProgramBinaryCacheTest, ComputeKey) {
+  const std::string key =
+      ProgramBinaryCache::ComputeKey("vs", "fs", "Vendor", "GPU", "3.0");
+  EXPECT_EQ(32U, key.length());
+  EXPECT_EQ(key,
+            ProgramBinaryCache::ComputeKey("vs", "fs", "Vendor", "GPU", "3.0"));
+  // Every part of the key matters.
+  EXPECT_NE(key,
+            ProgramBinaryCache::ComputeKey("vs2", "fs", "Vendor", "GPU", "3.0"));
+  EXPECT_NE(key,
+            ProgramBinaryCache::ComputeKey("vs", "fs2", "Vendor", "GPU", "3.0"));
+  EXPECT_NE(key,
+            ProgramBinaryCache::ComputeKey("vs", "fs", "Other", "GPU", "3.0"));
+  EXPECT_NE(key,
+            ProgramBinaryCache::ComputeKey("vs", "fs", "Vendor", "GPU2", "3.0"));
+  EXPECT_NE(key,
+            ProgramBinaryCache::ComputeKey("vs", "fs", "Vendor", "GPU", "3.1"));
+  // Moving text between the sources changes the key.
+  EXPECT_NE(key,
+            ProgramBinaryCache::ComputeKey("v", "sfs", "Vendor", "GPU", "3.0"));
+}
+
+TEST(ProgramBinaryCacheTest, MemoryOnly) {
+  ProgramBinaryCachePtr cache(new ProgramBinaryCache(""));
+  EXPECT_TRUE(cache->GetDirectory().empty());
+  const ProgramBinaryCache::Entry entry = CreateEntry("binary");
+  ProgramBinaryCache::Entry found;
+  EXPECT_FALSE(cache->Find("key", &found));
+  EXPECT_TRUE(cache->Store("key", entry));
+  EXPECT_TRUE(cache->Find("key", &found));
+  EXPECT_TRUE(EntriesMatch(entry, found));
+  EXPECT_EQ(1U, cache->GetHitCount());
+  EXPECT_EQ(1U, cache->GetMissCount());
+
+  cache->Remove("key");
+  EXPECT_FALSE(cache->Find("key", &found));
+  EXPECT_EQ(1U, cache->GetRejectCount());
+  EXPECT_EQ(2U, cache->GetMissCount());
+
+  cache->Store("key", entry);
+  cache->Clear();
+  EXPECT_FALSE(cache->Find("key", &found));
+}
+
+TEST(ProgramBinaryCacheTest, StoreAndFind) {
+  const std::string directory = port::GetTemporaryDirectory();
+  const std::string key =
+      ProgramBinaryCache::ComputeKey("vs", "fs", "StoreAndFind", "", "");
+  // Binaries may contain null characters.
+  const ProgramBinaryCache::Entry entry =
+      CreateEntry(std::string("bin\0ary", 7U));
+  ProgramBinaryCache::Entry found;
+
+  {
+    ProgramBinaryCachePtr cache(new ProgramBinaryCache(directory));
+    EXPECT_EQ(directory, cache->GetDirectory());
+    cache->Clear();
+    EXPECT_FALSE(cache->Find(key, &found));
+    EXPECT_TRUE(cache->Store(key, entry));
+    EXPECT_TRUE(cache->Find(key, &found));
+    EXPECT_TRUE(EntriesMatch(entry, found));
+  }
+
+  // A new cache, e.g., in the next run of an application, reads the file.
+  ProgramBinaryCachePtr cache(new ProgramBinaryCache(directory));
+  found = ProgramBinaryCache::Entry();
+  EXPECT_TRUE(cache->Find(key, &found));
+  EXPECT_TRUE(EntriesMatch(entry, found));
+  EXPECT_EQ(1U, cache->GetHitCount());
+  EXPECT_EQ(0U, cache->GetMissCount());
+
+  // Removing an entry removes its file.
+  cache->Remove(key);
+  EXPECT_FALSE(
+      ProgramBinaryCachePtr(new ProgramBinaryCache(directory))->Find(key,
+                                                                   &found));
+
+  // Invalid files are ignored.
+  {
+    base::LogChecker log_checker;
+    FILE* file = port::OpenFile(directory + "/" + key + ".ionprog", "wb");
+    ASSERT_TRUE(file != NULL);
+    fputs("garbage", file);
+    fclose(file);
+    EXPECT_FALSE(cache->Find(key, &found));
+    file = port::OpenFile(directory + "/" + key + ".ionprog", "wb");
+    fputs("this is not a program binary cache file, but it is long enough",
+          file);
+    fclose(file);
+    EXPECT_FALSE(cache->Find(key, &found));
+    EXPECT_TRUE(log_checker.HasMessage("WARNING", "invalid program binary"));
+  }
+
+  cache->Clear();
+  EXPECT_FALSE(cache->Find(key, &found));
+}
+
+}  // namespace gfx
+}  // namespace ion
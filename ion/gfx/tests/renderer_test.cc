@@ -35,6 +35,7 @@ limitations under the License.
 #include "ion/gfx/attribute.h"
 #include "ion/gfx/cubemaptexture.h"
 #include "ion/gfx/framebufferobject.h"
+#include "ion/gfx/programbinarycache.h"
 #include "ion/gfx/resourcemanager.h"
 #include "ion/gfx/sampler.h"
 #include "ion/gfx/shaderinputregistry.h"
@@ -4358,6 +4359,284 @@ TEST_F(RendererTest, ProgramAndShaderInfoLogs) {
             s_data.shader->GetInfoLog());
 }
 
+TEST_F(RendererTest, ProgramBinaryCache) {
+  NodePtr root = BuildGraph(kWidth, kHeight);
+  ProgramBinaryCachePtr cache(new ProgramBinaryCache(""));
+  const Shader& vertex_shader = *s_data.shader->GetVertexShader();
+  const Shader& fragment_shader = *s_data.shader->GetFragmentShader();
+  const std::string key = ProgramBinaryCache::ComputeKey(
+      vertex_shader.GetSource(), fragment_shader.GetSource(),
+      reinterpret_cast<const char*>(gm_->GetString(GL_VENDOR)),
+      gm_->GetGlRenderer(), gm_->GetGlVersionString());
+
+  {
+    // The first time the program is compiled and its binary stored.
+    RendererPtr renderer(new Renderer(gm_));
+    EXPECT_TRUE(renderer->GetProgramBinaryCache().Get() == nullptr);
+    renderer->SetProgramBinaryCache(cache);
+    EXPECT_EQ(cache.Get(), renderer->GetProgramBinaryCache().Get());
+    Reset();
+    renderer->DrawScene(root);
+    EXPECT_EQ(2U, trace_verifier_->GetCountOf("CompileShader"));
+    EXPECT_EQ(2U, trace_verifier_->GetCountOf("LinkProgram"));
+    EXPECT_EQ(0U, trace_verifier_->GetCountOf("ProgramBinary"));
+    EXPECT_EQ(1U, trace_verifier_->GetCountOf("GetProgramBinary"));
+    EXPECT_EQ(1U, trace_verifier_->GetCountOf("ProgramParameteri"));
+    EXPECT_EQ(0U, cache->GetHitCount());
+    EXPECT_EQ(1U, cache->GetMissCount());
+  }
+
+  // Another renderer creates the program from the binary without compiling,
+  // and with the same attribute bindings and uniforms.
+  std::vector<ResourceManager::ProgramInfo> infos;
+  {
+    RendererPtr renderer(new Renderer(gm_));
+    renderer->SetProgramBinaryCache(cache);
+    Reset();
+    CallbackHelper<ResourceManager::ProgramInfo> callback;
+    renderer->GetResourceManager()->RequestAllResourceInfos<
+        ShaderProgram, ResourceManager::ProgramInfo>(
+        std::bind(&CallbackHelper<ResourceManager::ProgramInfo>::Callback,
+                  &callback, std::placeholders::_1));
+    renderer->DrawScene(root);
+    EXPECT_EQ(0U, trace_verifier_->GetCountOf("CompileShader"));
+    EXPECT_EQ(0U, trace_verifier_->GetCountOf("LinkProgram"));
+    EXPECT_EQ(1U, trace_verifier_->GetCountOf("ProgramBinary"));
+    EXPECT_EQ(0U, trace_verifier_->GetCountOf("GetProgramBinary"));
+    EXPECT_EQ(1U, trace_verifier_->GetCountOf("DrawElements"));
+    EXPECT_EQ(1U, cache->GetHitCount());
+    ASSERT_EQ(1U, callback.infos.size());
+    EXPECT_TRUE(callback.infos[0].loaded_from_binary_cache);
+    EXPECT_EQ(0U, callback.infos[0].vertex_shader);
+    EXPECT_EQ(0U, callback.infos[0].fragment_shader);
+    infos = callback.infos;
+  }
+  {
+    RendererPtr renderer(new Renderer(gm_));
+    CallbackHelper<ResourceManager::ProgramInfo> callback;
+    renderer->GetResourceManager()->RequestAllResourceInfos<
+        ShaderProgram, ResourceManager::ProgramInfo>(
+        std::bind(&CallbackHelper<ResourceManager::ProgramInfo>::Callback,
+                  &callback, std::placeholders::_1));
+    renderer->DrawScene(root);
+    ASSERT_EQ(1U, callback.infos.size());
+    EXPECT_FALSE(callback.infos[0].loaded_from_binary_cache);
+    ASSERT_EQ(callback.infos[0].attributes.size(), infos[0].attributes.size());
+    for (size_t i = 0; i < infos[0].attributes.size(); ++i) {
+      EXPECT_EQ(callback.infos[0].attributes[i].name,
+                infos[0].attributes[i].name);
+      EXPECT_EQ(callback.infos[0].attributes[i].index,
+                infos[0].attributes[i].index);
+    }
+    EXPECT_EQ(callback.infos[0].uniforms.size(), infos[0].uniforms.size());
+  }
+
+  // A binary that would bind different attribute locations is not used, and
+  // is replaced by a new one.
+  ProgramBinaryCache::Entry entry;
+  ASSERT_TRUE(cache->Find(key, &entry));
+  const std::string bindings = entry.attribute_bindings;
+  entry.attribute_bindings = "aVertex=7";
+  cache->Store(key, entry);
+  {
+    base::LogChecker log_checker;
+    RendererPtr renderer(new Renderer(gm_));
+    renderer->SetProgramBinaryCache(cache);
+    Reset();
+    renderer->DrawScene(root);
+    EXPECT_EQ(1U, trace_verifier_->GetCountOf("ProgramBinary"));
+    EXPECT_EQ(2U, trace_verifier_->GetCountOf("CompileShader"));
+    EXPECT_EQ(2U, trace_verifier_->GetCountOf("LinkProgram"));
+    EXPECT_EQ(1U, trace_verifier_->GetCountOf("GetProgramBinary"));
+    EXPECT_EQ(1U, cache->GetRejectCount());
+    EXPECT_TRUE(log_checker.HasMessage("INFO", "Unable to use cached binary"));
+  }
+  ASSERT_TRUE(cache->Find(key, &entry));
+  EXPECT_EQ(bindings, entry.attribute_bindings);
+
+  // So is a binary that the driver rejects.
+  entry.binary = "not a binary";
+  cache->Store(key, entry);
+  {
+    base::LogChecker log_checker;
+    RendererPtr renderer(new Renderer(gm_));
+    renderer->SetProgramBinaryCache(cache);
+    Reset();
+    renderer->DrawScene(root);
+    EXPECT_EQ(2U, trace_verifier_->GetCountOf("LinkProgram"));
+    EXPECT_EQ(2U, cache->GetRejectCount());
+    EXPECT_TRUE(log_checker.HasMessage("INFO", "Unable to use cached binary"));
+    EXPECT_EQ("", s_data.shader->GetInfoLog());
+  }
+
+  // The cache is not used if the platform does not support program binaries.
+  gm_->EnableFunctionGroup(GraphicsManager::kProgramBinary, false);
+  {
+    RendererPtr renderer(new Renderer(gm_));
+    renderer->SetProgramBinaryCache(cache);
+    Reset();
+    renderer->DrawScene(root);
+    EXPECT_EQ(2U, trace_verifier_->GetCountOf("CompileShader"));
+    EXPECT_EQ(0U, trace_verifier_->GetCountOf("ProgramBinary"));
+    EXPECT_EQ(0U, trace_verifier_->GetCountOf("GetProgramBinary"));
+    EXPECT_EQ(0U, trace_verifier_->GetCountOf("ProgramParameteri"));
+  }
+  gm_->EnableFunctionGroup(GraphicsManager::kProgramBinary, true);
+}
+
+TEST_F(RendererTest, DeferredShaderCompilation) {
+  NodePtr root = BuildGraph(kWidth, kHeight);
+  ShaderProgram* program = s_data.shader.Get();
+  EXPECT_FALSE(program->IsDeferredCompilation());
+  program->SetDeferredCompilation(true);
+  EXPECT_TRUE(program->IsDeferredCompilation());
+  gm_->EnableFunctionGroup(GraphicsManager::kParallelShaderCompile, true);
+  // Each compile or link is reported as incomplete once.
+  gm_->SetCompletionStatusDelay(1);
+
+  RendererPtr renderer(new Renderer(gm_));
+  {
+    // The shaders start compiling and the program linking, but nothing is
+    // drawn since there is no program to draw with yet.
+    Reset();
+    renderer->DrawScene(root);
+    EXPECT_EQ(1U, trace_verifier_->GetCountOf("MaxShaderCompilerThreads"));
+    EXPECT_EQ(2U, trace_verifier_->GetCountOf("CompileShader"));
+    EXPECT_EQ(0U, trace_verifier_->GetCountOf("GetShaderiv"));
+    EXPECT_EQ(1U, trace_verifier_->GetCountOf("LinkProgram"));
+    EXPECT_EQ(0U, trace_verifier_->GetCountOf("GetProgramiv(*GL_LINK_STATUS"));
+    EXPECT_EQ(0U, trace_verifier_->GetCountOf("DrawElements"));
+
+    // The first link completes, so the attributes are bound and the program
+    // relinked.
+    Reset();
+    renderer->DrawScene(root);
+    EXPECT_EQ(0U, trace_verifier_->GetCountOf("MaxShaderCompilerThreads"));
+    EXPECT_EQ(2U, trace_verifier_->GetCountOf("GetShaderiv"));
+    EXPECT_EQ(3U, trace_verifier_->GetCountOf("BindAttribLocation"));
+    EXPECT_EQ(1U, trace_verifier_->GetCountOf("LinkProgram"));
+    EXPECT_EQ(0U, trace_verifier_->GetCountOf("DrawElements"));
+    EXPECT_FALSE(renderer->IsShaderProgramReady(program));
+
+    // The program is ready once the second link completes.
+    Reset();
+    EXPECT_TRUE(renderer->IsShaderProgramReady(program));
+    renderer->DrawScene(root);
+    EXPECT_EQ(0U, trace_verifier_->GetCountOf("LinkProgram"));
+    EXPECT_EQ(1U, trace_verifier_->GetCountOf("DrawElements"));
+    EXPECT_EQ("", program->GetInfoLog());
+    EXPECT_EQ("", program->GetVertexShader()->GetInfoLog());
+    EXPECT_EQ("", program->GetFragmentShader()->GetInfoLog());
+  }
+
+  {
+    // Editing a shader does not stall rendering; the old program is drawn with
+    // until the new one is ready.
+    const uint32 old_id = renderer->GetResourceGlId(program);
+    program->GetVertexShader()->SetSource(
+        program->GetVertexShader()->GetSource() + "\n");
+    for (int i = 0; i < 3; ++i) {
+      Reset();
+      renderer->DrawScene(root);
+      EXPECT_EQ(1U, trace_verifier_->GetCountOf("DrawElements"));
+      EXPECT_EQ(0U, trace_verifier_->GetCountOf("UseProgram"));
+    }
+    Reset();
+    renderer->DrawScene(root);
+    EXPECT_EQ(1U, trace_verifier_->GetCountOf("DrawElements"));
+    EXPECT_EQ(1U, trace_verifier_->GetCountOf("UseProgram"));
+    const uint32 new_id = renderer->GetResourceGlId(program);
+    EXPECT_NE(old_id, new_id);
+    EXPECT_TRUE(renderer->IsShaderProgramReady(program));
+  }
+
+  {
+    // A shader that fails to compile leaves the old program in use.
+    base::LogChecker log_checker;
+    const uint32 old_id = renderer->GetResourceGlId(program);
+    gm_->SetForceFunctionFailure("CompileShader", true);
+    program->GetFragmentShader()->SetSource(
+        program->GetFragmentShader()->GetSource() + "\n");
+    Reset();
+    renderer->DrawScene(root);
+    renderer->DrawScene(root);
+    EXPECT_EQ(2U, trace_verifier_->GetCountOf("DrawElements"));
+    EXPECT_EQ(static_cast<GLenum>(GL_INVALID_OPERATION), gm_->GetError());
+    EXPECT_TRUE(renderer->IsShaderProgramReady(program));
+    const std::vector<std::string> messages = log_checker.GetAllMessages();
+    ASSERT_EQ(2U, messages.size());
+    EXPECT_NE(std::string::npos, messages[0].find("Unable to compile"));
+    EXPECT_NE(std::string::npos, messages[1].find("Unable to link"));
+    EXPECT_FALSE(program->GetFragmentShader()->GetInfoLog().empty());
+    EXPECT_EQ(old_id, renderer->GetResourceGlId(program));
+    gm_->SetForceFunctionFailure("CompileShader", false);
+  }
+
+  {
+    // A program that has never been linked is replaced by its fallback.
+    RendererPtr renderer2(new Renderer(gm_));
+    program->SetFallbackProgram(renderer2->GetDefaultShaderProgram());
+    EXPECT_EQ(renderer2->GetDefaultShaderProgram().Get(),
+              program->GetFallbackProgram().Get());
+    Reset();
+    renderer2->DrawScene(root);
+    EXPECT_EQ(1U, trace_verifier_->GetCountOf("DrawElements"));
+    EXPECT_EQ(1U, trace_verifier_->GetCountOf("UseProgram"));
+    program->SetFallbackProgram(ShaderProgramPtr());
+  }
+
+  {
+    // Without parallel compilation, one deferred program is compiled per
+    // frame.
+    gm_->EnableFunctionGroup(GraphicsManager::kParallelShaderCompile, false);
+    ShaderProgramPtr program2 = ShaderProgram::BuildFromStrings(
+        "Deferred program", program->GetRegistry(),
+        program->GetVertexShader()->GetSource(),
+        program->GetFragmentShader()->GetSource(), base::AllocatorPtr());
+    program2->SetDeferredCompilation(true);
+    NodePtr node(new Node);
+    node->SetShaderProgram(program2);
+    node->AddShape(s_data.shape);
+    AddPlaneShaderUniformsToNode(node);
+    root->AddChild(node);
+
+    RendererPtr renderer2(new Renderer(gm_));
+    Reset();
+    renderer2->DrawScene(root);
+    EXPECT_EQ(0U, trace_verifier_->GetCountOf("MaxShaderCompilerThreads"));
+    EXPECT_EQ(2U, trace_verifier_->GetCountOf("CompileShader"));
+    EXPECT_EQ(2U, trace_verifier_->GetCountOf("LinkProgram"));
+    EXPECT_EQ(1U, trace_verifier_->GetCountOf("DrawElements"));
+    // A direct request does not count against the frame, so it compiles the
+    // program right away.
+    Reset();
+    EXPECT_TRUE(renderer2->IsShaderProgramReady(program2.Get()));
+    EXPECT_EQ(2U, trace_verifier_->GetCountOf("CompileShader"));
+    EXPECT_EQ(2U, trace_verifier_->GetCountOf("LinkProgram"));
+    Reset();
+    renderer2->DrawScene(root);
+    EXPECT_EQ(0U, trace_verifier_->GetCountOf("CompileShader"));
+    EXPECT_EQ(2U, trace_verifier_->GetCountOf("DrawElements"));
+
+    // IsShaderProgramReady() does not wait for the next frame, so programs
+    // can be warmed up before anything is drawn.
+    RendererPtr renderer3(new Renderer(gm_));
+    ShaderProgramPtr warm_programs[2];
+    Reset();
+    for (int i = 0; i < 2; ++i) {
+      warm_programs[i] = ShaderProgram::BuildFromStrings(
+          "Warm-up program", program->GetRegistry(),
+          program->GetVertexShader()->GetSource(),
+          program->GetFragmentShader()->GetSource(), base::AllocatorPtr());
+      warm_programs[i]->SetDeferredCompilation(true);
+      EXPECT_TRUE(renderer3->IsShaderProgramReady(warm_programs[i].Get()));
+    }
+    EXPECT_EQ(4U, trace_verifier_->GetCountOf("CompileShader"));
+    EXPECT_EQ(4U, trace_verifier_->GetCountOf("LinkProgram"));
+  }
+  gm_->SetCompletionStatusDelay(0);
+}
+
 TEST_F(RendererTest, FunctionFailures) {
   // Misc tests for error handling when some functions fail.
   base::LogChecker log_checker;
@@ -8019,6 +8298,79 @@ TEST_F(RendererTest, ReadImage) {
   EXPECT_EQ(80U, image->GetHeight());
 }
 
+TEST_F(RendererTest, ReadImageAsync) {
+  RendererPtr renderer(new Renderer(gm_));
+  base::AllocatorPtr al;
+  std::vector<ImagePtr> images;
+  const Renderer::ReadImageCallback callback =
+      [&images](const ImagePtr& image) { images.push_back(image); };
+  const Range2i range =
+      Range2i::BuildWithSize(Point2i(20, 10), Vector2i(50U, 80U));
+  EXPECT_EQ(3U, renderer->GetAsyncImageReadCount());
+
+  // The first read is only started.
+  Reset();
+  renderer->ReadImageAsync(range, Image::kRgba8888, al, callback);
+  EXPECT_TRUE(images.empty());
+  EXPECT_EQ(1U, trace_verifier_->GetCountOf("GenBuffers"));
+  EXPECT_EQ(1U, trace_verifier_->GetCountOf("BufferData"));
+  EXPECT_EQ(1U, trace_verifier_->GetCountOf("ReadPixels"));
+  EXPECT_EQ(1U, trace_verifier_->GetCountOf("FenceSync"));
+  EXPECT_EQ(0U, trace_verifier_->GetCountOf("MapBufferRange"));
+  EXPECT_EQ(GLenum{GL_NO_ERROR}, gm_->GetError());
+
+  // The next read delivers the first one and reuses its buffer.
+  Reset();
+  renderer->ReadImageAsync(range, Image::kRgb888, al, callback);
+  ASSERT_EQ(1U, images.size());
+  EXPECT_EQ(0U, trace_verifier_->GetCountOf("GenBuffers"));
+  EXPECT_EQ(0U, trace_verifier_->GetCountOf("BufferData"));
+  EXPECT_EQ(1U, trace_verifier_->GetCountOf("MapBufferRange"));
+  EXPECT_EQ(1U, trace_verifier_->GetCountOf("UnmapBuffer"));
+  EXPECT_EQ(1U, trace_verifier_->GetCountOf("DeleteSync"));
+  ASSERT_TRUE(images[0].Get() != nullptr);
+  EXPECT_TRUE(images[0]->GetData()->GetData() != nullptr);
+  EXPECT_EQ(Image::kRgba8888, images[0]->GetFormat());
+  EXPECT_EQ(50U, images[0]->GetWidth());
+  EXPECT_EQ(80U, images[0]->GetHeight());
+  EXPECT_EQ(GLenum{GL_NO_ERROR}, gm_->GetError());
+
+  // Waiting delivers the rest.
+  renderer->ProcessAsyncImageReads(true);
+  ASSERT_EQ(2U, images.size());
+  ASSERT_TRUE(images[1].Get() != nullptr);
+  EXPECT_EQ(Image::kRgb888, images[1]->GetFormat());
+  EXPECT_EQ(50U, images[1]->GetWidth());
+  EXPECT_EQ(80U, images[1]->GetHeight());
+  renderer->ProcessAsyncImageReads(true);
+  EXPECT_EQ(2U, images.size());
+
+  // A count of zero reads synchronously.
+  renderer->SetAsyncImageReadCount(0U);
+  Reset();
+  renderer->ReadImageAsync(range, Image::kRgba8888, al, callback);
+  EXPECT_EQ(3U, images.size());
+  EXPECT_EQ(0U, trace_verifier_->GetCountOf("FenceSync"));
+  renderer->SetAsyncImageReadCount(2U);
+
+  // So does a missing sync object extension.
+  gm_->EnableFunctionGroup(GraphicsManager::kSync, false);
+  Reset();
+  renderer->ReadImageAsync(range, Image::kRgba8888, al, callback);
+  EXPECT_EQ(4U, images.size());
+  EXPECT_EQ(0U, trace_verifier_->GetCountOf("FenceSync"));
+  EXPECT_EQ(0U, trace_verifier_->GetCountOf("MapBufferRange"));
+  gm_->EnableFunctionGroup(GraphicsManager::kSync, true);
+
+  // Pending reads are dropped when the Renderer is destroyed.
+  renderer->ReadImageAsync(range, Image::kRgba8888, al, callback);
+  Reset();
+  renderer = nullptr;
+  EXPECT_EQ(4U, images.size());
+  EXPECT_EQ(1U, trace_verifier_->GetCountOf("DeleteSync"));
+  EXPECT_EQ(GLenum{GL_NO_ERROR}, gm_->GetError());
+}
+
 TEST_F(RendererTest, MappedBuffer) {
   base::LogChecker log_checker;
   RendererPtr renderer(new Renderer(gm_));
@@ -172,11 +172,13 @@ TEST(ShaderInputRegistryTest, AddToRegistry) {
   EXPECT_EQ("doc0", uniform_specs[0].doc_string);
   EXPECT_TRUE(!uniform_specs[0].combine_function);
   EXPECT_EQ(0U, uniform_specs[0].index);
+  EXPECT_EQ(UniformHandle::HashName("myInt"), uniform_specs[0].name_hash);
   EXPECT_EQ("myFloat", uniform_specs[1].name);
   EXPECT_EQ(kFloatUniform, uniform_specs[1].value_type);
   EXPECT_EQ("doc1", uniform_specs[1].doc_string);
   EXPECT_TRUE(!uniform_specs[1].combine_function);
   EXPECT_EQ(1U, uniform_specs[1].index);
+  EXPECT_EQ(UniformHandle("myFloat").GetHash(), uniform_specs[1].name_hash);
   EXPECT_EQ("myVec2f", uniform_specs[2].name);
   EXPECT_EQ(kFloatVector2Uniform, uniform_specs[2].value_type);
   EXPECT_EQ("doc2", uniform_specs[2].doc_string);
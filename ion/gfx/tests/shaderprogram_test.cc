@@ -173,5 +173,21 @@ TEST_F(ShaderProgramTest, SetInfoLog) {
   EXPECT_EQ("Link OK", program_->GetInfoLog());
 }
 
+TEST_F(ShaderProgramTest, SetDeferredCompilation) {
+  EXPECT_FALSE(program_->IsDeferredCompilation());
+  EXPECT_FALSE(program_->GetFallbackProgram().Get());
+
+  program_->SetDeferredCompilation(true);
+  EXPECT_TRUE(program_->IsDeferredCompilation());
+  ShaderProgramPtr fallback(new ShaderProgram(registry_));
+  program_->SetFallbackProgram(fallback);
+  EXPECT_EQ(fallback.Get(), program_->GetFallbackProgram().Get());
+  // Neither setting changes the program itself.
+  EXPECT_FALSE(resource_->AnyModifiedBitsSet());
+
+  program_->SetDeferredCompilation(false);
+  EXPECT_FALSE(program_->IsDeferredCompilation());
+}
+
 }  // namespace gfx
 }  // namespace ion
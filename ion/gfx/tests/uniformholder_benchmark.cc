@@ -0,0 +1,124 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+// Benchmarks setting uniform values in a UniformHolder by name, by
+// UniformHandle, and by index. This is built as a separate target so that it
+// does not slow down the regular tests; the results are printed to stdout in
+// millions of updates per second.
+
+#include <functional>
+#include <iostream>  // NOLINT
+#include <string>
+
+#include "ion/analytics/benchmark.h"
+#include "ion/analytics/benchmarkutils.h"
+#include "ion/base/allocatable.h"
+#include "ion/base/serialize.h"
+#include "ion/gfx/shaderinputregistry.h"
+#include "ion/gfx/uniformholder.h"
+#include "ion/math/vector.h"
+#include "ion/port/timer.h"
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace gfx {
+
+namespace {
+
+using analytics::Benchmark;
+
+static const int kUpdateCount = 1 << 18;
+static const int kIterations = 10;
+
+// Accessible class derived from UniformHolder.
+class MyUniformHolder : public base::Allocatable, public UniformHolder {
+ public:
+  MyUniformHolder() : UniformHolder(GetAllocator()) {}
+  ~MyUniformHolder() override {}
+};
+
+// Runs |func| kIterations times and adds the number of uniform updates per
+// second to |benchmark|.
+static void Measure(const std::string& name, const std::string& group,
+                    const std::function<void()>& func,
+                    Benchmark* benchmark) {
+  Benchmark::VariableAccumulator accumulator(Benchmark::Descriptor(
+      name, group, "Throughput of " + name, "Mupdates/s"));
+  // Warm up caches.
+  func();
+  for (int i = 0; i < kIterations; ++i) {
+    port::Timer timer;
+    func();
+    const double seconds = timer.GetInS();
+    if (seconds > 0.0)
+      accumulator.AddSample(static_cast<double>(kUpdateCount) / seconds * 1e-6);
+  }
+  benchmark->AddAccumulatedVariable(accumulator.Get());
+}
+
+// Measures updates of the last of |uniform_count| uniforms in a holder, which
+// is the worst case for lookups.
+static void MeasureHolder(size_t uniform_count, Benchmark* benchmark) {
+  ShaderInputRegistryPtr reg(new ShaderInputRegistry);
+  MyUniformHolder holder;
+  for (size_t i = 0; i < uniform_count; ++i) {
+    holder.AddUniform(reg->Create<Uniform>(
+        "uUniform" + base::ValueToString(i), math::Vector3f::Zero()));
+  }
+  // The name of the last uniform, as a persistent string for the handle.
+  const std::string name = "uUniform" + base::ValueToString(uniform_count - 1);
+  const UniformHandle handle(name.c_str());
+  const size_t index = holder.GetUniformIndex(handle);
+  EXPECT_EQ(uniform_count - 1U, index);
+
+  const std::string group =
+      "Set uniform of " + base::ValueToString(uniform_count);
+  math::Vector3f value = math::Vector3f::Zero();
+  Measure(group + " by name", group, [&]() {
+    for (int i = 0; i < kUpdateCount; ++i) {
+      value[0] = static_cast<float>(i);
+      holder.SetUniformByName(name, value);
+    }
+  }, benchmark);
+  Measure(group + " by handle", group, [&]() {
+    for (int i = 0; i < kUpdateCount; ++i) {
+      value[0] = static_cast<float>(i);
+      holder.SetUniformByHandle(handle, value);
+    }
+  }, benchmark);
+  Measure(group + " by index", group, [&]() {
+    for (int i = 0; i < kUpdateCount; ++i) {
+      value[0] = static_cast<float>(i);
+      holder.SetUniformValue(index, value);
+    }
+  }, benchmark);
+}
+
+}  // anonymous namespace
+
+TEST(UniformHolderBenchmark, UpdatesPerSecond) {
+  Benchmark benchmark;
+  MeasureHolder(1U, &benchmark);
+  MeasureHolder(8U, &benchmark);
+  MeasureHolder(32U, &benchmark);
+  analytics::OutputBenchmarkPretty("Uniform updates", false, benchmark,
+                                   std::cout);
+  EXPECT_FALSE(benchmark.GetAccumulatedVariables().empty());
+}
+
+}  // namespace gfx
+}  // namespace ion
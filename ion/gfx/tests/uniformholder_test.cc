@@ -216,5 +216,68 @@ TEST(UniformHolderTest, AddReplaceSetClearUniforms) {
   EXPECT_EQ(1U, holder.GetUniforms().size());
 }
 
+TEST(UniformHolderTest, UniformHandles) {
+  // Handle hashes are computed at compile time and match run-time hashes.
+  static const UniformHandle kFloat("myFloat");
+  static_assert(UniformHandle::HashName("myFloat") !=
+                UniformHandle::HashName("myVec2f"),
+                "Different names should have different hashes");
+  EXPECT_EQ(UniformHandle::HashName(std::string("myFloat")),
+            kFloat.GetHash());
+  EXPECT_EQ(UniformHandle::HashName(std::string()),
+            UniformHandle::HashName(""));
+  EXPECT_STREQ("myFloat", kFloat.GetName());
+
+  MyUniformHolder holder;
+  ShaderInputRegistryPtr reg(new ShaderInputRegistry());
+  reg->Add(ShaderInputRegistry::UniformSpec("myFloat", kFloatUniform, ""));
+  reg->Add(ShaderInputRegistry::UniformSpec("myVec2f",
+                                            kFloatVector2Uniform,
+                                            ""));
+  const UniformHandle kVec2f("myVec2f");
+  const UniformHandle kVec3fs("myVec3fs");
+  const UniformHandle kMissing("does not exist");
+  math::Vector3f vec3fs[2] = { math::Vector3f(1.f, 0.f, 0.f),
+                               math::Vector3f(1.f, 1.f, 0.f) };
+  EXPECT_EQ(0U, holder.AddUniform(reg->Create<Uniform>("myFloat", 1.f)));
+  EXPECT_EQ(1U, holder.AddUniform(
+      reg->Create<Uniform>("myVec2f", math::Vector2f(0.f, 1.f))));
+  EXPECT_EQ(2U, holder.AddUniform(reg->CreateArrayUniform(
+      "myVec3fs", vec3fs, 2U, base::AllocatorPtr())));
+
+  EXPECT_EQ(0U, holder.GetUniformIndex(kFloat));
+  EXPECT_EQ(1U, holder.GetUniformIndex(kVec2f));
+  EXPECT_EQ(2U, holder.GetUniformIndex(kVec3fs));
+  EXPECT_EQ(base::kInvalidIndex, holder.GetUniformIndex(kMissing));
+
+  // Set values through handles.
+  const math::Vector2f vec(1.1f, 2.2f);
+  EXPECT_TRUE(holder.SetUniformByHandle(kFloat, 2.5f));
+  EXPECT_EQ(2.5f, holder.GetUniforms()[0].GetValue<float>());
+  EXPECT_TRUE(holder.SetUniformByHandle(kVec2f, vec));
+  EXPECT_TRUE(math::VectorBase2f::AreValuesEqual(
+      vec, holder.GetUniforms()[1].GetValue<math::VectorBase2f>()));
+  EXPECT_FALSE(holder.SetUniformByHandle(kFloat, vec));  // Wrong type.
+  EXPECT_FALSE(holder.SetUniformByHandle(kMissing, 1.5f));
+  const math::Vector3f vec3f(0.1f, 0.2f, 0.4f);
+  EXPECT_TRUE(holder.SetUniformByHandleAt(kVec3fs, 1, vec3f));
+  EXPECT_TRUE(math::VectorBase3f::AreValuesEqual(
+      vec3f, holder.GetUniforms()[2].GetValueAt<math::VectorBase3f>(1)));
+  EXPECT_FALSE(holder.SetUniformByHandleAt(kVec3fs, 1, vec));  // Wrong type.
+  EXPECT_FALSE(holder.SetUniformByHandleAt(kMissing, 0, vec3f));
+
+  // Handles follow uniforms that are removed or replaced.
+  EXPECT_TRUE(holder.RemoveUniformByName("myFloat"));
+  EXPECT_EQ(base::kInvalidIndex, holder.GetUniformIndex(kFloat));
+  EXPECT_EQ(0U, holder.GetUniformIndex(kVec2f));
+  EXPECT_EQ(1U, holder.GetUniformIndex(kVec3fs));
+  EXPECT_TRUE(holder.ReplaceUniform(0U, reg->Create<Uniform>("myFloat", 3.f)));
+  EXPECT_EQ(0U, holder.GetUniformIndex(kFloat));
+  EXPECT_EQ(base::kInvalidIndex, holder.GetUniformIndex(kVec2f));
+  holder.ClearUniforms();
+  EXPECT_EQ(base::kInvalidIndex, holder.GetUniformIndex(kFloat));
+  EXPECT_EQ(base::kInvalidIndex, holder.GetUniformIndex(kVec3fs));
+}
+
 }  // namespace gfx
 }  // namespace ion
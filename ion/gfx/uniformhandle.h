@@ -0,0 +1,82 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef ION_GFX_UNIFORMHANDLE_H_
+#define ION_GFX_UNIFORMHANDLE_H_
+
+#include <string>
+
+#include "base/integral_types.h"
+
+namespace ion {
+namespace gfx {
+
+// A UniformHandle identifies a uniform by name without any string comparisons
+// or allocations when it is used. It holds a 64-bit FNV-1a hash of the name,
+// which is computed at compile time when the handle is initialized with a
+// string literal, e.g.:
+//
+//   static const UniformHandle kCameraPosition("uCameraPosition");
+//   ...
+//   node->SetUniformByHandle(kCameraPosition, position);
+//
+// The hash is the same as the one stored in a ShaderInputRegistry::Spec, so
+// UniformHolder only has to compare integers to find a uniform. The handle
+// stores a pointer to the name, which must outlive it; string literals always
+// do.
+class UniformHandle {
+ public:
+  constexpr explicit UniformHandle(const char* name)
+      : name_(name), hash_(HashName(name)) {}
+
+  // Returns the name and its hash.
+  const char* GetName() const { return name_; }
+  uint64 GetHash() const { return hash_; }
+
+  // Returns the hash of a uniform name. The first version can be evaluated at
+  // compile time, and both return the same value for the same name.
+  static constexpr uint64 HashName(const char* name) {
+    return HashNameFrom(name, kFnvOffsetBasis);
+  }
+  static uint64 HashName(const std::string& name) {
+    uint64 hash = kFnvOffsetBasis;
+    const size_t length = name.length();
+    for (size_t i = 0; i < length; ++i)
+      hash = (hash ^ static_cast<uint8>(name[i])) * kFnvPrime;
+    return hash;
+  }
+
+ private:
+  static const uint64 kFnvOffsetBasis = 14695981039346656037ULL;
+  static const uint64 kFnvPrime = 1099511628211ULL;
+
+  // Hashes the remainder of |name| into |hash|. C++11 constexpr functions can
+  // only consist of a single return statement, hence the recursion.
+  static constexpr uint64 HashNameFrom(const char* name, uint64 hash) {
+    return *name ? HashNameFrom(name + 1,
+                                (hash ^ static_cast<uint8>(*name)) * kFnvPrime)
+                 : hash;
+  }
+
+  const char* name_;
+  uint64 hash_;
+};
+
+}  // namespace gfx
+}  // namespace ion
+
+#endif  // ION_GFX_UNIFORMHANDLE_H_
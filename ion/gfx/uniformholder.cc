@@ -23,21 +23,42 @@ namespace ion {
 namespace gfx {
 
 UniformHolder::UniformHolder(const base::AllocatorPtr& alloc)
-    : is_enabled_(true), uniforms_(alloc) {}
+    : is_enabled_(true), uniforms_(alloc), uniform_hashes_(alloc) {}
 
 UniformHolder::~UniformHolder() {}
 
 size_t UniformHolder::GetUniformIndex(const std::string& name) const {
+  const uint64 hash = UniformHandle::HashName(name);
   const size_t uniform_count = uniforms_.size();
   for (size_t i = 0; i < uniform_count; ++i) {
-    const Uniform& u = uniforms_[i];
-    DCHECK(u.IsValid());
-    if (name ==
-        u.GetRegistry().GetSpecs<Uniform>()[u.GetIndexInRegistry()].name)
+    // Compare the names of matching hashes in case of a collision.
+    if (uniform_hashes_[i] == hash) {
+      const Uniform& u = uniforms_[i];
+      if (name ==
+          u.GetRegistry().GetSpecs<Uniform>()[u.GetIndexInRegistry()].name)
+        return i;
+    }
+  }
+  return base::kInvalidIndex;
+}
+
+size_t UniformHolder::GetUniformIndex(const UniformHandle& handle) const {
+  const uint64 hash = handle.GetHash();
+  const size_t uniform_count = uniform_hashes_.size();
+  for (size_t i = 0; i < uniform_count; ++i) {
+    if (uniform_hashes_[i] == hash) {
+      DCHECK_EQ(ShaderInputRegistry::GetSpec(uniforms_[i])->name,
+                handle.GetName());
       return i;
+    }
   }
   return base::kInvalidIndex;
 }
 
+uint64 UniformHolder::GetNameHash(const Uniform& uniform) {
+  DCHECK(uniform.IsValid());
+  return ShaderInputRegistry::GetSpec(uniform)->name_hash;
+}
+
 }  // namespace gfx
 }  // namespace ion
@@ -24,6 +24,7 @@ limitations under the License.
 #include "ion/base/invalid.h"
 #include "ion/base/stlalloc/allocvector.h"
 #include "ion/gfx/uniform.h"
+#include "ion/gfx/uniformhandle.h"
 
 namespace ion {
 namespace gfx {
@@ -32,6 +33,10 @@ namespace gfx {
 // adding a Uniform adds a _copy_ of the instance; to modify a uniform value use
 // ReplaceUniform() or SetUniformValue[At]().
 //
+// Uniforms can also be referred to by UniformHandle, which is much faster than
+// looking them up by name since only name hashes are compared. This is the
+// preferred way to set uniforms by name every frame.
+//
 // The ShaderInputRegistry of any Uniform added to a UniformHolder should have a
 // longer lifetime than the holder. If not, then if the Uniforms are used after
 // their creating registry has been destroyed (recall that Uniforms hold only a
@@ -46,6 +51,7 @@ class ION_API UniformHolder {
   size_t AddUniform(const Uniform& uniform) {
     if (uniform.IsValid()) {
       uniforms_.push_back(uniform);
+      uniform_hashes_.push_back(GetNameHash(uniform));
       return uniforms_.size() - 1U;
     } else {
       return base::kInvalidIndex;
@@ -57,6 +63,7 @@ class ION_API UniformHolder {
   bool ReplaceUniform(size_t index, const Uniform& uniform) {
     if (uniform.IsValid() && index < uniforms_.size()) {
       uniforms_[index] = uniform;
+      uniform_hashes_[index] = GetNameHash(uniform);
       return true;
     } else {
       return false;
@@ -71,11 +78,15 @@ class ION_API UniformHolder {
     if (index == base::kInvalidIndex)
       return false;
     uniforms_.erase(uniforms_.begin() + index);
+    uniform_hashes_.erase(uniform_hashes_.begin() + index);
     return true;
   }
 
   // Clears the vector of uniforms in this.
-  void ClearUniforms() { uniforms_.clear(); }
+  void ClearUniforms() {
+    uniforms_.clear();
+    uniform_hashes_.clear();
+  }
 
   // Gets the vector of uniforms.
   const base::AllocVector<Uniform>& GetUniforms() const { return uniforms_; }
@@ -103,10 +114,15 @@ class ION_API UniformHolder {
   // Returns the index of the uniform this with the given name, if it exists.
   // The Uniform must have been added with AddUniform() or ReplaceUniform(). If
   // no uniform with the name exists in this then returns
-  // ion::base::kInvalidIndex. Note that this is a relatively slow operation
-  // and should be used sparingly.
+  // ion::base::kInvalidIndex. Note that this has to hash the name; use the
+  // UniformHandle version below where the name is known in advance.
   size_t GetUniformIndex(const std::string& name) const;
 
+  // Returns the index of the uniform referred to by a UniformHandle, or
+  // ion::base::kInvalidIndex if there is no such uniform in this. This only
+  // compares name hashes, so it is fast enough to call every frame.
+  size_t GetUniformIndex(const UniformHandle& handle) const;
+
   // Convenience function to set the value of a uniform specified by name. This
   // returns false if there is no uniform with that name or the value type does
   // not match.
@@ -131,6 +147,23 @@ class ION_API UniformHolder {
         uniforms_[index].SetValueAt(array_index, value);
   }
 
+  // Convenience functions to set the value of a uniform, or an element of an
+  // array uniform, referred to by a UniformHandle. These return false under
+  // the same conditions as the name-based versions above.
+  template <typename T> bool SetUniformByHandle(const UniformHandle& handle,
+                                                const T& value) {
+    const size_t index = GetUniformIndex(handle);
+    return index == base::kInvalidIndex ? false :
+        SetUniformValue<T>(index, value);
+  }
+  template <typename T> bool SetUniformByHandleAt(const UniformHandle& handle,
+                                                  size_t array_index,
+                                                  const T& value) {
+    const size_t index = GetUniformIndex(handle);
+    return index == base::kInvalidIndex ? false :
+        uniforms_[index].SetValueAt(array_index, value);
+  }
+
   // Enables or disables the UniformHolder. Disabled holders are skipped over
   // during rendering; their values are not sent to OpenGL. UniformHolders are
   // enabled by default.
@@ -147,8 +180,14 @@ class ION_API UniformHolder {
   virtual ~UniformHolder();
 
  private:
+  // Returns the hash of the name of a valid Uniform.
+  static uint64 GetNameHash(const Uniform& uniform);
+
   bool is_enabled_;
   base::AllocVector<Uniform> uniforms_;
+  // The name hashes of |uniforms_|, which are kept separately so that lookups
+  // only touch a small contiguous array.
+  base::AllocVector<uint64> uniform_hashes_;
 };
 
 }  // namespace gfx
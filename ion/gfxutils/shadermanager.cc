@@ -59,12 +59,15 @@ class ShaderManager::ShaderManagerData : public base::Allocatable {
   typedef base::AllocMap<std::string, ProgramInfo> ProgramMap;
 
   explicit ShaderManagerData(const base::Allocatable& owner)
-      : programs_(owner) {}
+      : programs_(owner), deferred_compilation_(false) {}
   ~ShaderManagerData() override {}
 
   // Adds a ProgramInfo to the map of infos.
   void AddProgramInfo(const std::string& name, const ProgramInfo& info) {
     LockGuard guard(&mutex_);
+    const ShaderProgramPtr program = info.program.Acquire();
+    if (program.Get())
+      program->SetDeferredCompilation(deferred_compilation_);
     programs_[name] = info;
   }
 
@@ -124,6 +127,23 @@ class ShaderManager::ShaderManagerData : public base::Allocatable {
     }
   }
 
+  void SetDeferredCompilation(bool enabled) {
+    LockGuard guard(&mutex_);
+    deferred_compilation_ = enabled;
+    for (ProgramMap::iterator it = programs_.begin(); it != programs_.end();) {
+      const ShaderProgramPtr& program = GetProgramFromInfo(&it);
+      if (program.Get()) {
+        program->SetDeferredCompilation(enabled);
+        ++it;
+      }
+    }
+  }
+
+  bool IsDeferredCompilation() {
+    LockGuard guard(&mutex_);
+    return deferred_compilation_;
+  }
+
   void RecreateShaderProgramsThatDependOn(const std::string& dependency) {
     LockGuard guard(&mutex_);
     for (ProgramMap::iterator it = programs_.begin(); it != programs_.end();) {
@@ -172,7 +192,10 @@ class ShaderManager::ShaderManagerData : public base::Allocatable {
   // All shader programs registered with the manager.
   ProgramMap programs_;
 
-  // For locking access to programs_.
+  // Whether programs use deferred compilation.
+  bool deferred_compilation_;
+
+  // For locking access to programs_ and deferred_compilation_.
   port::Mutex mutex_;
 };
 
@@ -231,5 +254,13 @@ void ShaderManager::RecreateShaderProgramsThatDependOn(
   data_->RecreateShaderProgramsThatDependOn(dependency);
 }
 
+void ShaderManager::SetDeferredCompilation(bool enabled) {
+  data_->SetDeferredCompilation(enabled);
+}
+
+bool ShaderManager::IsDeferredCompilation() const {
+  return data_->IsDeferredCompilation();
+}
+
 }  // namespace gfxutils
 }  // namespace ion
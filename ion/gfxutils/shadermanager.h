@@ -70,6 +70,14 @@ class ION_API ShaderManager : public base::Referent {
   // ShaderSourceComposer will recognize.
   void RecreateShaderProgramsThatDependOn(const std::string& dependency);
 
+  // Sets/returns whether the programs of the manager use deferred compilation
+  // (see ShaderProgram::SetDeferredCompilation()), which avoids stalling
+  // rendering when programs are first drawn or when they are recreated after
+  // their sources have been edited. Setting this applies to all existing
+  // programs as well as ones created afterwards. By default, this is disabled.
+  void SetDeferredCompilation(bool enabled);
+  bool IsDeferredCompilation() const;
+
  private:
   // Internal class that holds the ShaderManager's implementation.
   class ShaderManagerData;
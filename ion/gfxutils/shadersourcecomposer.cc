@@ -17,6 +17,7 @@ limitations under the License.
 
 #include "ion/gfxutils/shadersourcecomposer.h"
 
+#include <memory>
 #include <set>
 #include <sstream>
 #include <stack>
@@ -24,7 +25,6 @@ limitations under the License.
 #include <vector>
 
 #include "ion/base/allocatable.h"
-#include "ion/base/invalid.h"
 #include "ion/base/stlalloc/allocmap.h"
 #include "ion/base/stlalloc/allocset.h"
 #include "ion/base/stringutils.h"
@@ -42,8 +42,9 @@ static bool SetAndSaveZipAssetData(const std::string& filename,
 }
 
 static const std::string GetZipAssetFileData(const std::string& filename) {
-  const std::string& data = base::ZipAssetManager::GetFileData(filename);
-  return base::IsInvalidReference(data) ? std::string() : data;
+  const std::shared_ptr<const std::string> data =
+      base::ZipAssetManager::GetFileDataPtr(filename);
+  return data ? *data : std::string();
 }
 
 }  // anonymous namespace
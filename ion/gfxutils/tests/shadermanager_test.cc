@@ -199,5 +199,26 @@ TEST_F(ShaderManagerTest, RecreateShaderProgramThatDependOn) {
   EXPECT_EQ("fragment2", program_->GetFragmentShader()->GetSource());
 }
 
+TEST_F(ShaderManagerTest, SetDeferredCompilation) {
+  EXPECT_FALSE(manager_->IsDeferredCompilation());
+  EXPECT_FALSE(program_->IsDeferredCompilation());
+
+  // Existing programs are updated.
+  manager_->SetDeferredCompilation(true);
+  EXPECT_TRUE(manager_->IsDeferredCompilation());
+  EXPECT_TRUE(program_->IsDeferredCompilation());
+
+  // New programs use the setting.
+  ComposerPtr vertex_composer(new Composer("vertex2", "vertex2"));
+  ComposerPtr fragment_composer(new Composer("fragment2", "fragment2"));
+  ShaderProgramPtr program = manager_->CreateShaderProgram(
+      "program2", registry_, vertex_composer, fragment_composer);
+  EXPECT_TRUE(program->IsDeferredCompilation());
+
+  manager_->SetDeferredCompilation(false);
+  EXPECT_FALSE(program_->IsDeferredCompilation());
+  EXPECT_FALSE(program->IsDeferredCompilation());
+}
+
 }  // namespace gfxutils
 }  // namespace ion
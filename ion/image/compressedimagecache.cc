@@ -0,0 +1,304 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/image/compressedimagecache.h"
+
+#include <stdio.h>
+
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "ion/base/datacontainer.h"
+#include "ion/base/lockguards.h"
+#include "ion/base/logging.h"
+#include "ion/port/fileutils.h"
+#include "ion/port/memorymappedfile.h"
+
+namespace ion {
+namespace image {
+
+using gfx::Image;
+using gfx::ImagePtr;
+
+namespace {
+
+// Cache files start with this header, followed by the image data.
+struct FileHeader {
+  char magic[8];
+  uint32 format;
+  uint32 width;
+  uint32 height;
+  uint32 reserved;
+  uint64 data_size;
+};
+
+static const char kMagic[8] = { 'I', 'O', 'N', 'I', 'M', 'G', 'C', '1' };
+static const char kFileExtension[] = ".ionimg";
+
+// Incrementally computes a 64-bit FNV-1a hash. Whole 64-bit words are
+// hashed at a time since the inputs are usually large.
+class Hasher {
+ public:
+  Hasher() : hash_(14695981039346656037ULL) {}
+
+  void Add(const void* data, size_t size) {
+    const uint8* bytes = static_cast<const uint8*>(data);
+    uint64 word;
+    while (size >= sizeof(word)) {
+      memcpy(&word, bytes, sizeof(word));
+      AddWord(word);
+      bytes += sizeof(word);
+      size -= sizeof(word);
+    }
+    word = 0;
+    if (size) {
+      memcpy(&word, bytes, size);
+      AddWord(word ^ size);
+    }
+  }
+
+  void Add(uint32 value) { AddWord(value); }
+
+  uint64 Get() const { return hash_; }
+
+ private:
+  void AddWord(uint64 word) {
+    hash_ = (hash_ ^ word) * 1099511628211ULL;
+  }
+
+  uint64 hash_;
+};
+
+// Returns whether |name| is a key, as returned by ComputeKey(), followed by
+// the cache file extension.
+static bool IsCacheFileName(const std::string& name) {
+  static const size_t kKeyLength = 16U;
+  if (name.length() != kKeyLength + strlen(kFileExtension) ||
+      name.compare(kKeyLength, std::string::npos, kFileExtension) != 0)
+    return false;
+  for (size_t i = 0; i < kKeyLength; ++i) {
+    if (!isxdigit(static_cast<unsigned char>(name[i])))
+      return false;
+  }
+  return true;
+}
+
+// Returns whether the file at |path| starts with the cache file magic.
+static bool IsCacheFile(const std::string& path) {
+  FILE* file = port::OpenFile(path, "rb");
+  if (!file)
+    return false;
+  char magic[sizeof(kMagic)];
+  const bool is_cache_file = fread(magic, sizeof(magic), 1U, file) == 1U &&
+      memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+  fclose(file);
+  return is_cache_file;
+}
+
+}  // anonymous namespace
+
+CompressedImageCache::CompressedImageCache(const std::string& directory)
+    : directory_(directory),
+      flush_waiter_count_(0U),
+      hit_count_(0U),
+      miss_count_(0U),
+      pool_(this) {
+  pool_.ResizeThreadPool(1U);
+  pool_.Resume();
+}
+
+CompressedImageCache::~CompressedImageCache() {
+  Flush();
+  pool_.Suspend();
+  pool_.ResizeThreadPool(0U);
+}
+
+const std::string CompressedImageCache::ComputeKey(
+    const Image& source, Image::Format target_format,
+    const std::string& settings) {
+  Hasher hasher;
+  hasher.Add(static_cast<uint32>(source.GetFormat()));
+  hasher.Add(source.GetWidth());
+  hasher.Add(source.GetHeight());
+  hasher.Add(source.GetDepth());
+  hasher.Add(static_cast<uint32>(target_format));
+  hasher.Add(settings.data(), settings.size());
+  if (source.GetData().Get() && source.GetData()->GetData())
+    hasher.Add(source.GetData()->GetData(), source.GetDataSize());
+
+  std::ostringstream str;
+  str << std::hex << std::setw(16) << std::setfill('0') << hasher.Get();
+  return str.str();
+}
+
+const ImagePtr CompressedImageCache::Find(const std::string& key,
+                                          bool is_wipeable,
+                                          const base::AllocatorPtr& allocator) {
+  {
+    base::LockGuard guard(&mutex_);
+    std::map<std::string, ImagePtr>::const_iterator it = pending_.find(key);
+    if (it != pending_.end()) {
+      ++hit_count_;
+      return it->second;
+    }
+  }
+
+  std::shared_ptr<port::MemoryMappedFile> file(
+      new port::MemoryMappedFile(GetPath(key)));
+  const uint8* data = static_cast<const uint8*>(file->GetData());
+  FileHeader header;
+  if (!data || file->GetLength() < sizeof(header)) {
+    ++miss_count_;
+    return ImagePtr();
+  }
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) ||
+      header.format >= Image::kNumFormats ||
+      file->GetLength() - sizeof(header) != header.data_size ||
+      header.data_size != Image::ComputeDataSize(
+          static_cast<Image::Format>(header.format), header.width,
+          header.height)) {
+    LOG(WARNING) << "Ignoring invalid image cache file " << GetPath(key);
+    ++miss_count_;
+    return ImagePtr();
+  }
+
+  // The data container keeps the file mapped until its data is deleted.
+  ImagePtr image(new(allocator) Image);
+  image->Set(static_cast<Image::Format>(header.format), header.width,
+             header.height,
+             base::DataContainer::Create<uint8>(
+                 const_cast<uint8*>(data + sizeof(header)),
+                 [file](void*) mutable { file.reset(); }, is_wipeable,
+                 image->GetAllocator()));
+  ++hit_count_;
+  return image;
+}
+
+void CompressedImageCache::Store(const std::string& key,
+                                 const ImagePtr& image) {
+  if (!image.Get() || !image->GetData().Get() ||
+      !image->GetData()->GetData())
+    return;
+  {
+    base::LockGuard guard(&mutex_);
+    if (pending_.count(key))
+      return;
+    pending_[key] = image;
+    write_queue_.push_back(key);
+  }
+  pool_.GetWorkSemaphore()->Post();
+}
+
+void CompressedImageCache::Flush() {
+  while (true) {
+    {
+      base::LockGuard guard(&mutex_);
+      if (pending_.empty())
+        return;
+      ++flush_waiter_count_;
+    }
+    // More images may have been stored by the time this wakes up, so check
+    // again.
+    flushed_sema_.Wait();
+  }
+}
+
+void CompressedImageCache::Clear() {
+  Flush();
+  const std::vector<std::string> files = port::ListDirectory(directory_);
+  for (size_t i = 0; i < files.size(); ++i) {
+    const std::string& name = files[i];
+    if (IsCacheFileName(name) && IsCacheFile(directory_ + "/" + name))
+      port::RemoveFile(directory_ + "/" + name);
+  }
+}
+
+void CompressedImageCache::DoWork() {
+  std::string key;
+  ImagePtr image;
+  {
+    base::LockGuard guard(&mutex_);
+    if (write_queue_.empty())
+      return;
+    key = write_queue_.front();
+    write_queue_.pop_front();
+    image = pending_[key];
+  }
+  if (!WriteFile(key, *image))
+    LOG(WARNING) << "Unable to write image cache file " << GetPath(key);
+  // The entry is only removed once the file is complete, so that a Find() on
+  // another thread either sees the pending image or the whole file.
+  base::LockGuard guard(&mutex_);
+  pending_.erase(key);
+  if (pending_.empty()) {
+    for (; flush_waiter_count_; --flush_waiter_count_)
+      flushed_sema_.Post();
+  }
+}
+
+const std::string& CompressedImageCache::GetName() const {
+  static const std::string kName("CompressedImageCache");
+  return kName;
+}
+
+const std::string CompressedImageCache::GetPath(const std::string& key) const {
+  return directory_ + "/" + key + kFileExtension;
+}
+
+bool CompressedImageCache::WriteFile(const std::string& key,
+                                     const Image& image) const {
+  FileHeader header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.format = static_cast<uint32>(image.GetFormat());
+  header.width = image.GetWidth();
+  header.height = image.GetHeight();
+  header.reserved = 0U;
+  header.data_size = image.GetDataSize();
+
+  // Write to a temporary file and rename it so that a concurrent reader, such
+  // as another process, never maps a partially written file.
+  const std::string path = GetPath(key);
+  const std::string temp_path = path + ".tmp";
+  FILE* file = port::OpenFile(temp_path, "wb");
+  if (!file)
+    return false;
+  const bool written =
+      fwrite(&header, sizeof(header), 1U, file) == 1U &&
+      fwrite(image.GetData()->GetData(), 1U, image.GetDataSize(), file) ==
+          image.GetDataSize();
+  const bool closed = fclose(file) == 0;
+  if (!written || !closed) {
+    port::RemoveFile(temp_path);
+    return false;
+  }
+  // On some platforms rename() fails if the destination exists.
+  port::RemoveFile(path);
+  if (rename(temp_path.c_str(), path.c_str()) != 0) {
+    port::RemoveFile(temp_path);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace image
+}  // namespace ion
@@ -0,0 +1,130 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef ION_IMAGE_COMPRESSEDIMAGECACHE_H_
+#define ION_IMAGE_COMPRESSEDIMAGECACHE_H_
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <string>
+
+#include "base/integral_types.h"
+#include "ion/base/referent.h"
+#include "ion/base/workerpool.h"
+#include "ion/gfx/image.h"
+#include "ion/port/mutex.h"
+#include "ion/port/semaphore.h"
+
+namespace ion {
+namespace image {
+
+// CompressedImageCache stores the results of expensive image conversions, such
+// as DXT or ETC compression, in files in a directory so that they can be
+// reused by later runs of an application. Entries are keyed by a hash of the
+// source image contents, the target format, and a string describing any other
+// settings that affect the result (e.g., compressor quality or mipmap level).
+//
+// Cached images are read with a memory-mapped file, so looking up an entry
+// does not copy its data; if the returned Image's DataContainer is wipeable,
+// the mapping is released when the data is wiped after uploading to OpenGL.
+// New entries are written to disk on a background thread. Until an entry has
+// been written, lookups return the image that was stored.
+//
+// See SetCompressedImageCache() in conversionutils.h to make ConvertImage()
+// use a cache.
+class ION_API CompressedImageCache : public base::Referent,
+                                     private base::WorkerPool::Worker {
+ public:
+  // Creates a cache that stores its files in |directory|, which must exist.
+  explicit CompressedImageCache(const std::string& directory);
+
+  // Returns the directory the cache files are stored in.
+  const std::string& GetDirectory() const { return directory_; }
+
+  // Returns the key for the conversion of |source| to |target_format| with
+  // the passed |settings|. This hashes the image data, so the key should be
+  // computed once and passed to both Find() and Store().
+  static const std::string ComputeKey(const gfx::Image& source,
+                                      gfx::Image::Format target_format,
+                                      const std::string& settings);
+
+  // Returns the cached image for |key|, or a NULL ImagePtr if there is none.
+  // The |is_wipeable| flag is passed to the DataContainer of a newly read
+  // image, and |allocator| is used to allocate the Image and DataContainer.
+  const gfx::ImagePtr Find(const std::string& key, bool is_wipeable,
+                           const base::AllocatorPtr& allocator);
+
+  // Adds |image| to the cache under |key|. The file is written on a
+  // background thread; the image data must not change until it has been
+  // written, see Flush().
+  void Store(const std::string& key, const gfx::ImagePtr& image);
+
+  // Blocks until all stored images have been written to disk.
+  void Flush();
+
+  // Removes all cache files from the directory. Only files that were written
+  // by a CompressedImageCache, i.e., that have a key as their name and start
+  // with the cache file header, are removed; any other files are left alone.
+  void Clear();
+
+  // Returns the number of Find() calls that returned an image or did not.
+  size_t GetHitCount() const { return hit_count_; }
+  size_t GetMissCount() const { return miss_count_; }
+
+ protected:
+  // The destructor is protected because all base::Referent classes must have
+  // protected or private destructors. It waits for pending writes.
+  ~CompressedImageCache() override;
+
+ private:
+  // WorkerPool::Worker implementation, which writes pending entries.
+  void DoWork() override;
+  const std::string& GetName() const override;
+
+  // Returns the path of the file for |key|.
+  const std::string GetPath(const std::string& key) const;
+
+  // Writes |image| to the file for |key|. Returns false on failure.
+  bool WriteFile(const std::string& key, const gfx::Image& image) const;
+
+  const std::string directory_;
+
+  // Entries waiting to be written, in order, and by key for lookups.
+  std::deque<std::string> write_queue_;
+  std::map<std::string, gfx::ImagePtr> pending_;
+  // The number of threads blocked in Flush(), which are woken through
+  // |flushed_sema_| once |pending_| becomes empty.
+  size_t flush_waiter_count_;
+  port::Semaphore flushed_sema_;
+  port::Mutex mutex_;
+
+  std::atomic<size_t> hit_count_;
+  std::atomic<size_t> miss_count_;
+
+  // Writes entries in the background. This is declared last so that its
+  // thread is stopped before any other members are destroyed.
+  base::WorkerPool pool_;
+};
+
+// Convenience typedef for shared pointer to a CompressedImageCache.
+typedef base::ReferentPtr<CompressedImageCache>::Type CompressedImageCachePtr;
+
+}  // namespace image
+}  // namespace ion
+
+#endif  // ION_IMAGE_COMPRESSEDIMAGECACHE_H_
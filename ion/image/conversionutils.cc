@@ -22,7 +22,10 @@ limitations under the License.
 #include "base/port.h"
 #include "ion/base/allocationmanager.h"
 #include "ion/base/datacontainer.h"
-#include "ion/math/range.h"
+#include "ion/base/lockguards.h"
+#include "ion/base/staticsafedeclare.h"
+#include "ion/image/imagekernels.h"
+#include "ion/port/mutex.h"
 #include "third_party/image_compression/image_compression/public/compressed_image.h"
 #include "third_party/image_compression/image_compression/public/dxtc_compressor.h"
 #include "third_party/image_compression/image_compression/public/etc_compressor.h"
@@ -51,8 +54,6 @@ namespace image {
 
 using gfx::Image;
 using gfx::ImagePtr;
-using math::Point2f;
-using math::Range2f;
 
 namespace {
 
@@ -158,11 +159,24 @@ static const ImagePtr DecompressWithCompressor(
   return result_image;
 }
 
-// Compresses an image to the target_format.
-static const ImagePtr CompressImage(const Image& image,
-                                    Image::Format target_format,
-                                    bool is_wipeable,
-                                    const base::AllocatorPtr& allocator) {
+// Returns the mutex protecting the CompressedImageCache used by
+// ConvertImage().
+static port::Mutex* GetCompressedImageCacheMutex() {
+  ION_DECLARE_SAFE_STATIC_POINTER(port::Mutex, mutex);
+  return mutex;
+}
+
+// Returns the CompressedImageCache used by ConvertImage(). The caller must
+// hold the lock on GetCompressedImageCacheMutex().
+static CompressedImageCachePtr* GetCompressedImageCachePtr() {
+  ION_DECLARE_SAFE_STATIC_POINTER(CompressedImageCachePtr, cache);
+  return cache;
+}
+
+// Compresses an image to the target_format without using the cache.
+static const ImagePtr CompressImageUncached(
+    const Image& image, Image::Format target_format, bool is_wipeable,
+    const base::AllocatorPtr& allocator) {
   if (target_format == Image::kEtc1) {
     image_codec_compression::EtcCompressor compressor;
     compressor.SetCompressionStrategy(
@@ -181,6 +195,38 @@ static const ImagePtr CompressImage(const Image& image,
   }
 }
 
+// Compresses an image to the target_format, using the CompressedImageCache if
+// one is set. The cache key includes the compressor settings used above.
+static const ImagePtr CompressImage(const Image& image,
+                                    Image::Format target_format,
+                                    bool is_wipeable,
+                                    const base::AllocatorPtr& allocator) {
+  const CompressedImageCachePtr cache = GetCompressedImageCache();
+  if (!cache.Get())
+    return CompressImageUncached(image, target_format, is_wipeable, allocator);
+
+  const std::string key = CompressedImageCache::ComputeKey(
+      image, target_format, target_format == Image::kEtc1 ? "heuristic" : "");
+  ImagePtr result = cache->Find(key, is_wipeable, allocator);
+  if (!result.Get()) {
+    // The cache writes the result in the background, so it must not be wiped
+    // before then; the caller gets a separate copy.
+    ImagePtr cached = CompressImageUncached(image, target_format, false,
+                                            allocator);
+    if (cached.Get()) {
+      cache->Store(key, cached);
+      result.Reset(new(allocator) Image);
+      result->Set(cached->GetFormat(), cached->GetWidth(),
+                  cached->GetHeight(),
+                  base::DataContainer::CreateAndCopy<uint8>(
+                      cached->GetData()->GetData<uint8>(),
+                      cached->GetDataSize(), is_wipeable,
+                      result->GetAllocator()));
+    }
+  }
+  return result;
+}
+
 // Decompresses an image to the appropriate format.
 static const ImagePtr DecompressImage(const Image& image, bool is_wipeable,
                                       const base::AllocatorPtr& allocator) {
@@ -399,31 +445,6 @@ static const ImagePtr DataToImageIonRaw(const void* data,
 //
 //-----------------------------------------------------------------------------
 
-static uint8 MultiplyUint8ByFloat(const uint8 int_value,
-                                  const float float_value) {
-  return static_cast<uint8>(static_cast<float>(int_value) * float_value);
-}
-
-static const ImagePtr AllocImage(
-    Image::Format format, uint32 width, uint32 height, bool is_wipeable,
-    const base::AllocatorPtr& allocator) {
-  ImagePtr result(new(allocator) Image);
-  // This may be different from the allocator passed in if what was passed in
-  // was a null pointer.
-  const base::AllocatorPtr& use_allocator = result->GetAllocator();
-  const size_t size = Image::ComputeDataSize(format, width, height);
-  uint8* new_buffer = reinterpret_cast<uint8*>(
-      use_allocator->AllocateMemory(size));
-  result->Set(format, width, height,
-      base::DataContainer::Create<uint8>(
-          new_buffer,
-          std::bind(base::DataContainer::AllocatorDeleter, use_allocator,
-              std::placeholders::_1),
-          is_wipeable,
-          use_allocator));
-  return result;
-}
-
 // Create a single channel image from the red channel of an RGB(A) image.
 static const ImagePtr ExtractRedChannel(const Image& image,
                                         bool is_wipeable,
@@ -702,115 +723,55 @@ static const ImagePtr Downsample2xSimple8bpc(
       image.GetFormat(), new_width, new_height, is_wipeable, allocator);
   const uint8* src_data = image.GetData()->GetData<uint8>();
   uint8* dst_data = result->GetData()->GetMutableData<uint8>();
-  const size_t src_stride = image.GetWidth() * num_channels;
-  const size_t dst_stride = new_width * num_channels;
-  for (size_t src_row = 0, src_rows = image.GetHeight();
-       src_row < src_rows; src_row += 2) {
-    const size_t dst_row = src_row >> 1;
-    // Clamp src row to stay within image bounds.
-    const size_t next_row = (src_row == src_rows - 1) ? 0 : src_stride;
-    for (size_t src_col = 0, src_cols = image.GetWidth();
-         src_col < src_cols; src_col += 2) {
-      const uint8* src_pixel =
-          src_data + src_row * src_stride + src_col * num_channels;
-      const size_t dst_col = src_col >> 1;
-      uint8* dst_pixel =
-          dst_data + dst_row * dst_stride + dst_col * num_channels;
-      // Clamp src column to stay within image bounds.
-      const size_t next_col = (src_col == src_cols - 1) ? 0 : num_channels;
-      for (size_t chan = 0; chan < num_channels; ++chan) {
-        dst_pixel[chan] =
-            static_cast<uint8>((src_pixel[chan] +
-                src_pixel[chan + next_col] +
-                src_pixel[chan + next_row] +
-                src_pixel[chan + next_col + next_row] + 1) >> 2);
-      }
-    }
-  }
+  const uint32 src_width = image.GetWidth();
+  const uint32 src_height = image.GetHeight();
+  ParallelForRows(new_height, new_width,
+                  [=](size_t begin, size_t end) {
+    Downsample2x8bpcRows(src_data, src_width, src_height, num_channels,
+                         dst_data, static_cast<uint32>(begin),
+                         static_cast<uint32>(end));
+  });
   return result;
 }
 
-// Bilinearly interpolate an 8-bit-per-channel |image|.
-// Bilinear resizing is most useful for upsizing images as it only uses a
-// weighted average of the 4 closest pixel values, and has reasonable quality.
-static const gfx::ImagePtr ResizeBilinear8bpc(
+// Resamples an 8-bit-per-channel |image| to |out_width| x |out_height| using
+// the passed separable filters.
+static const gfx::ImagePtr Resample8bpc(
     const gfx::Image& image, uint32 out_width, uint32 out_height,
+    const ResampleFilter& x_filter, const ResampleFilter& y_filter,
     bool is_wipeable, const base::AllocatorPtr& allocator) {
   ImagePtr result = AllocImage(
       image.GetFormat(), out_width, out_height, is_wipeable, allocator);
-  const float xscale =
-      static_cast<float>(image.GetWidth()) / static_cast<float>(out_width);
-  const float yscale =
-      static_cast<float>(image.GetHeight()) / static_cast<float>(out_height);
   const uint8* src_data = image.GetData()->GetData<uint8>();
   uint8* dst_data = result->GetData()->GetMutableData<uint8>();
-  int num_channels = Image::GetNumComponentsForFormat(image.GetFormat());
-  const size_t src_stride = image.GetWidth() * num_channels;
-  const size_t dst_stride = out_width * num_channels;
-  const size_t max_src_x = static_cast<size_t>(image.GetWidth() - 1);
-  const size_t max_src_y = static_cast<size_t>(image.GetHeight() - 1);
-  // Note that pixel values should be treated as located at the center of each
-  // pixel. I.e., pixel (i,j)'s value is centered at (i+0.5,j+0.5) for the
-  // purposes of computing how close a sample location is to the source pixel.
-  for (uint32 dst_y = 0; dst_y < out_height; ++dst_y) {
-    for (uint32 dst_x = 0; dst_x < out_width; ++dst_x) {
-      uint8* dst_pixel = dst_data + dst_y * dst_stride + dst_x * num_channels;
-      float src_x = (static_cast<float>(dst_x) + 0.5f) * xscale;
-      float src_y = (static_cast<float>(dst_y) + 0.5f) * yscale;
-      // Compute fractional distances to the nearest pixel centers, which are
-      // also the interpolation weights.
-      float s1 = src_x + 0.5f - std::floor(src_x + 0.5f);
-      float s0 = 1.0f - s1;
-      float t1 = src_y + 0.5f - std::floor(src_y + 0.5f);
-      float t0 = 1.0f - t1;
-      // Clamp the source pixels inside the boundary.
-      size_t src_x0 =
-          static_cast<size_t>(std::max(0.f, std::floor(src_x - 0.5f)));
-      size_t src_y0 =
-          static_cast<size_t>(std::max(0.f, std::floor(src_y - 0.5f)));
-      size_t src_x1 = std::min(
-          max_src_x,
-          static_cast<size_t>(std::floor(src_x + 0.5f)));
-      size_t src_y1 = std::min(
-          max_src_y,
-          static_cast<size_t>(std::floor(src_y + 0.5f)));
-      const uint8* src_00 =
-          src_data + src_x0 * num_channels + src_y0 * src_stride;
-      const uint8* src_10 =
-          src_data + src_x1 * num_channels + src_y0 * src_stride;
-      const uint8* src_01 =
-          src_data + src_x0 * num_channels + src_y1 * src_stride;
-      const uint8* src_11 =
-          src_data + src_x1 * num_channels + src_y1 * src_stride;
-      for (int chan = 0; chan < num_channels; ++chan) {
-        dst_pixel[chan] = static_cast<uint8>(std::floor(
-            s0 * t0 * static_cast<float>(src_00[chan]) +
-            s1 * t0 * static_cast<float>(src_10[chan]) +
-            s0 * t1 * static_cast<float>(src_01[chan]) +
-            s1 * t1 * static_cast<float>(src_11[chan]) + 0.5f));
-      }
-    }
-  }
+  const uint32 src_width = image.GetWidth();
+  const uint32 num_channels =
+      Image::GetNumComponentsForFormat(image.GetFormat());
+  const size_t work_per_row =
+      static_cast<size_t>(out_width) * std::max(1U, y_filter.max_taps);
+  ParallelForRows(out_height, work_per_row,
+                  [&, src_data, dst_data](size_t begin, size_t end) {
+    Resample8bpcRows(src_data, src_width, num_channels, x_filter, y_filter,
+                     dst_data, static_cast<uint32>(begin),
+                     static_cast<uint32>(end));
+  });
   return result;
 }
 
-// Returns the rect resulting from the intersection of |src_rectf| and a
-// 1x1 rect with min point at (src_x, src_y).
-static Range2f GetPixelRectIntersection(
-    float src_x, float src_y, const Range2f& src_rectf) {
-  Point2f min_pt = src_rectf.GetMinPoint();
-  Point2f max_pt = src_rectf.GetMaxPoint();
-  min_pt[0] = std::max(src_x, min_pt[0]);
-  min_pt[1] = std::max(src_y, min_pt[1]);
-  max_pt[0] = std::min(src_x + 1.f, max_pt[0]);
-  max_pt[1] = std::min(src_y + 1.f, max_pt[1]);
-  return Range2f(min_pt, max_pt);
-}
-
-// Returns the area of the rectangle |rect|.
-static float GetRectArea(const Range2f& rect) {
-  math::Vector2f size = rect.GetSize();
-  return size[0] * size[1];
+// Bilinearly interpolate an 8-bit-per-channel |image|.
+// Bilinear resizing is most useful for upsizing images as it only uses a
+// weighted average of the 4 closest pixel values, and has reasonable quality.
+static const gfx::ImagePtr ResizeBilinear8bpc(
+    const gfx::Image& image, uint32 out_width, uint32 out_height,
+    bool is_wipeable, const base::AllocatorPtr& allocator) {
+  // Note that pixel values should be treated as located at the center of each
+  // pixel. I.e., pixel (i,j)'s value is centered at (i+0.5,j+0.5) for the
+  // purposes of computing how close a sample location is to the source pixel.
+  ResampleFilter x_filter, y_filter;
+  BuildBilinearFilter(image.GetWidth(), out_width, &x_filter);
+  BuildBilinearFilter(image.GetHeight(), out_height, &y_filter);
+  return Resample8bpc(image, out_width, out_height, x_filter, y_filter,
+                      is_wipeable, allocator);
 }
 
 // Use a box filter to resize an 8-bit-per-channel |image|.
@@ -820,70 +781,15 @@ static float GetRectArea(const Range2f& rect) {
 static const gfx::ImagePtr ResizeBoxFilter8bpc(
     const gfx::Image& image, uint32 out_width, uint32 out_height,
     bool is_wipeable, const base::AllocatorPtr& allocator) {
-  const int kMaxChannels = 4;
-  ImagePtr result;
-  const int num_channels = Image::GetNumComponentsForFormat(image.GetFormat());
-  DCHECK_LE(num_channels, kMaxChannels)
+  DCHECK_LE(Image::GetNumComponentsForFormat(image.GetFormat()), 4)
       << "Unsupported number of channels for resize.";
-  result = AllocImage(
-      image.GetFormat(), out_width, out_height, is_wipeable, allocator);
-  Point2f rect_scale(
-      static_cast<float>(image.GetWidth()) / static_cast<float>(out_width),
-      static_cast<float>(image.GetHeight()) / static_cast<float>(out_height));
-  const uint8* src_data = image.GetData()->GetData<uint8>();
-  uint8* dst_data = result->GetData()->GetMutableData<uint8>();
-  const size_t src_stride = image.GetWidth() * num_channels;
-  const size_t dst_stride = out_width * num_channels;
-  float src_area = GetRectArea(Range2f(Point2f::Zero(), rect_scale));
-  for (uint32 dst_y = 0; dst_y < out_height; ++dst_y) {
-    for (uint32 dst_x = 0; dst_x < out_width; ++dst_x) {
-      // Compute the dst pixel's rectangle in the src image.
-      float dst_xf = static_cast<float>(dst_x);
-      float dst_yf = static_cast<float>(dst_y);
-      Range2f src_rectf = Range2f(
-          Point2f(dst_xf, dst_yf) * rect_scale,
-          Point2f(dst_xf + 1.f, dst_yf + 1.f) * rect_scale);
-      // Pixel coords of all the pixels in the src that touch |src_rect|.
-      Point2f src_min(
-          std::floor(src_rectf.GetMinPoint()[0]),
-          std::floor(src_rectf.GetMinPoint()[1]));
-      Point2f src_max(
-          std::ceil(src_rectf.GetMaxPoint()[0]),
-          std::ceil(src_rectf.GetMaxPoint()[1]));
-
-#if ION_DEBUG
-      float check_area_total = 0.f;
-#endif
-      float dst_value[kMaxChannels] = { 0.f };
-      for (float src_y = src_min[1]; src_y < src_max[1]; ++src_y) {
-        for (float src_x = src_min[0]; src_x < src_max[0]; ++src_x) {
-          // Intersect src pixel's region with full src_rect.
-          Range2f src_dest_intersect =
-              GetPixelRectIntersection(src_x, src_y, src_rectf);
-          float part_area = GetRectArea(src_dest_intersect);
-#if ION_DEBUG
-          check_area_total += part_area;
-#endif
-          size_t src_xi = static_cast<size_t>(src_x);
-          size_t src_yi = static_cast<size_t>(src_y);
-          const uint8* src_pixel =
-              src_data + src_yi * src_stride + src_xi * num_channels;
-          for (int chan = 0; chan < num_channels; ++chan) {
-            dst_value[chan] += part_area * static_cast<float>(src_pixel[chan]);
-          }
-        }
-      }
-#if ION_DEBUG
-      DCHECK_LT(std::abs(check_area_total - src_area), 1e-3);
-#endif
-      uint8* dst_pixel = dst_data + dst_y * dst_stride + dst_x * num_channels;
-      for (int chan = 0; chan < num_channels; ++chan) {
-        dst_pixel[chan] =
-            static_cast<uint8>(std::floor(dst_value[chan] / src_area + 0.5f));
-      }
-    }
-  }
-  return result;
+  // The box filter is separable, so the area weights are the products of the
+  // per-axis coverage weights.
+  ResampleFilter x_filter, y_filter;
+  BuildBoxFilter(image.GetWidth(), out_width, &x_filter);
+  BuildBoxFilter(image.GetHeight(), out_height, &y_filter);
+  return Resample8bpc(image, out_width, out_height, x_filter, y_filter,
+                      is_wipeable, allocator);
 }
 
 }  // anonymous namespace
@@ -894,6 +800,26 @@ static const gfx::ImagePtr ResizeBoxFilter8bpc(
 //
 //-----------------------------------------------------------------------------
 
+const ImagePtr ION_API AllocImage(
+    Image::Format format, uint32 width, uint32 height, bool is_wipeable,
+    const base::AllocatorPtr& allocator) {
+  ImagePtr result(new(allocator) Image);
+  // This may be different from the allocator passed in if what was passed in
+  // was a null pointer.
+  const base::AllocatorPtr& use_allocator = result->GetAllocator();
+  const size_t size = Image::ComputeDataSize(format, width, height);
+  uint8* new_buffer = reinterpret_cast<uint8*>(
+      use_allocator->AllocateMemory(size));
+  result->Set(format, width, height,
+      base::DataContainer::Create<uint8>(
+          new_buffer,
+          std::bind(base::DataContainer::AllocatorDeleter, use_allocator,
+              std::placeholders::_1),
+          is_wipeable,
+          use_allocator));
+  return result;
+}
+
 const ImagePtr ION_API ConvertImage(
     const ImagePtr& image, Image::Format target_format, bool is_wipeable,
     const base::AllocatorPtr& allocator,
@@ -924,6 +850,16 @@ const ImagePtr ION_API ConvertImage(
   return ImageToImage(*image, target_format, is_wipeable, al, temp_al);
 }
 
+void ION_API SetCompressedImageCache(const CompressedImageCachePtr& cache) {
+  base::LockGuard guard(GetCompressedImageCacheMutex());
+  *GetCompressedImageCachePtr() = cache;
+}
+
+const CompressedImageCachePtr ION_API GetCompressedImageCache() {
+  base::LockGuard guard(GetCompressedImageCacheMutex());
+  return *GetCompressedImageCachePtr();
+}
+
 const ImagePtr ION_API ConvertFromExternalImageData(
     const void* data, size_t data_size, bool flip_vertically, bool is_wipeable,
     const base::AllocatorPtr& allocator) {
@@ -1025,22 +961,28 @@ ION_API void FlipImage(const gfx::ImagePtr& image) {
 
   // Stack allocate a buffer to enable swapping larger chunks with memcpy.
   // This method worked pretty well for both large and small images in a
-  // small test program comparing different flipping algorithms.
-  const size_t kBufferSize = 512U;
-  uint8 tmp_buf[kBufferSize];
-  for (size_t j = 0, target_j = height - 1; j < height / 2; ++j, --target_j) {
-    size_t copied_bytes = 0;
-    while (copied_bytes < row_size_bytes) {
-      const size_t copy_size =
-          std::min(row_size_bytes - copied_bytes, kBufferSize);
-      uint8* src_row = image_bytes + j * row_size_bytes + copied_bytes;
-      uint8* tgt_row = image_bytes + target_j * row_size_bytes + copied_bytes;
-      memcpy(tmp_buf, tgt_row, copy_size);
-      memcpy(tgt_row, src_row, copy_size);
-      memcpy(src_row, tmp_buf, copy_size);
-      copied_bytes += kBufferSize;
+  // small test program comparing different flipping algorithms. Pairs of rows
+  // are independent, so large images are flipped in parallel.
+  ParallelForRows(height / 2, row_size_bytes,
+                  [=](size_t begin, size_t end) {
+    const size_t kBufferSize = 512U;
+    uint8 tmp_buf[kBufferSize];
+    for (size_t j = begin; j < end; ++j) {
+      const size_t target_j = height - 1 - j;
+      size_t copied_bytes = 0;
+      while (copied_bytes < row_size_bytes) {
+        const size_t copy_size =
+            std::min(row_size_bytes - copied_bytes, kBufferSize);
+        uint8* src_row = image_bytes + j * row_size_bytes + copied_bytes;
+        uint8* tgt_row =
+            image_bytes + target_j * row_size_bytes + copied_bytes;
+        memcpy(tmp_buf, tgt_row, copy_size);
+        memcpy(tgt_row, src_row, copy_size);
+        memcpy(src_row, tmp_buf, copy_size);
+        copied_bytes += copy_size;
+      }
     }
-  }
+  });
 }
 
 ION_API void FlipImageHorizontally(const gfx::ImagePtr& image) {
@@ -1082,17 +1024,7 @@ ION_API void StraightAlphaFromPremultipliedAlpha(const gfx::ImagePtr& image) {
 
   switch (image->GetFormat()) {
     case gfx::Image::kRgba8888:
-      for (size_t i = 0; i < byte_count; i += 4) {
-        const uint8 alpha_byte = image_bytes[i + 3];
-        if (alpha_byte == 0)
-          continue;
-        const float inverse_alpha = 255.f / static_cast<float>(alpha_byte);
-        image_bytes[i] = MultiplyUint8ByFloat(image_bytes[i], inverse_alpha);
-        image_bytes[i + 1] =
-            MultiplyUint8ByFloat(image_bytes[i + 1], inverse_alpha);
-        image_bytes[i + 2] =
-            MultiplyUint8ByFloat(image_bytes[i + 2], inverse_alpha);
-      }
+      UnpremultiplyRgba8888(image_bytes, byte_count / 4);
       break;
     default:
       DLOG(WARNING) << "Converting premultiplied alpha to straight alpha from"
@@ -32,6 +32,7 @@ limitations under the License.
 #include "base/integral_types.h"
 #include "ion/base/allocator.h"
 #include "ion/gfx/image.h"
+#include "ion/image/compressedimagecache.h"
 
 namespace ion {
 namespace image {
@@ -74,6 +75,14 @@ ION_API const gfx::ImagePtr ConvertImage(
     const base::AllocatorPtr& allocator,
     const base::AllocatorPtr& temporary_allocator);
 
+// Sets/returns the cache used by ConvertImage() for conversions to compressed
+// formats (kDxt1, kDxt5, kEtc1 and kPvrtc1Rgba2). When a cache is set, the
+// result of compressing an image with identical contents is read from the
+// cache instead of being recomputed, and new results are added to it. The
+// cache is NULL by default, which disables caching.
+ION_API void SetCompressedImageCache(const CompressedImageCachePtr& cache);
+ION_API const CompressedImageCachePtr GetCompressedImageCache();
+
 // Converts external image |data| to an ImagePtr with data in canonical format.
 // |data_size| is the number of bytes in |data|. Input format is inferred
 // from |data|.
@@ -133,6 +142,15 @@ ION_API const std::vector<uint8> ConvertToExternalImageData(
     const gfx::ImagePtr& image, ExternalImageFormat external_format,
     bool flip_vertically);
 
+// Returns a new Image with the given format and dimensions whose data is
+// allocated but not initialized. The |is_wipeable| flag is passed to the
+// DataContainer for the new Image. |allocator| is used for allocating the
+// image and its data, unless it is NULL, then the default C++ allocator will
+// be used.
+ION_API const gfx::ImagePtr AllocImage(
+    gfx::Image::Format format, uint32 width, uint32 height, bool is_wipeable,
+    const base::AllocatorPtr& allocator);
+
 // Returns an image half the width and height of |image|. Currently only kDxt1,
 // kDxt5, kEtc1, and 8-bit-per-channel images are supported; other input formats
 // will return a NULL pointer. The |is_wipeable| flag is passed to the
@@ -29,8 +29,14 @@
       'target_name' : 'ionimage',
       'type': 'static_library',
       'sources' : [
+        'compressedimagecache.cc',
+        'compressedimagecache.h',
         'conversionutils.cc',
         'conversionutils.h',
+        'imagekernels.cc',
+        'imagekernels.h',
+        'mipmaputils.cc',
+        'mipmaputils.h',
         'ninepatch.cc',
         'ninepatch.h',
         'renderutils.cc',
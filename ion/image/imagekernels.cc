@@ -0,0 +1,674 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/image/imagekernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#include "ion/base/logging.h"
+#include "ion/base/taskscheduler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define ION_IMAGE_SSE2 1
+#  include <emmintrin.h>
+// AVX2 versions are compiled with a target attribute and selected at run time,
+// which requires GCC or Clang.
+#  if defined(__GNUC__) || defined(__clang__)
+#    define ION_IMAGE_AVX2 1
+#    define ION_TARGET_AVX2 __attribute__((target("avx2")))
+#    include <immintrin.h>
+#  endif
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#  define ION_IMAGE_NEON 1
+#  include <arm_neon.h>
+#endif
+
+#if defined(ION_IMAGE_SSE2) || defined(ION_IMAGE_NEON)
+#  define ION_IMAGE_SIMD 1
+#endif
+
+namespace ion {
+namespace image {
+
+namespace {
+
+// The minimum amount of work (e.g., pixels) that makes it worth running a task
+// on another thread.
+static const size_t kMinWorkPerThread = 64U * 1024U;
+
+static SimdLevel DetectSimdLevel() {
+#if defined(ION_IMAGE_AVX2)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return kSimdAvx2;
+#endif
+#if defined(ION_IMAGE_SSE2)
+  return kSimdSse2;
+#elif defined(ION_IMAGE_NEON)
+  return kSimdNeon;
+#else
+  return kSimdScalar;
+#endif
+}
+
+static std::atomic<int>& GetSimdLevelStorage() {
+  static std::atomic<int> level(DetectSimdLevel());
+  return level;
+}
+
+static bool IsSimdLevelSupported(SimdLevel level) {
+  const SimdLevel supported = GetSupportedSimdLevel();
+  switch (level) {
+    case kSimdScalar:
+      return true;
+    case kSimdSse2:
+      return supported == kSimdSse2 || supported == kSimdAvx2;
+    case kSimdAvx2:
+    case kSimdNeon:
+      return supported == level;
+  }
+  return false;
+}
+
+// Rounds a filtered value to the nearest uint8, clamping to [0, 255] as the
+// saturating packs of the SIMD paths do. Filters with negative weights, such as
+// the Kaiser filter, can produce values outside that range.
+static inline uint8 RoundToUint8(float value) {
+  return static_cast<uint8>(
+      std::max(0.f, std::min(255.f, std::floor(value + 0.5f))));
+}
+
+//-----------------------------------------------------------------------------
+//
+// Downsampling.
+//
+//-----------------------------------------------------------------------------
+
+// Writes |count| destination pixels starting at destination column |dst_col|,
+// clamping the source columns to |src_width|.
+static void Downsample2xPixelsScalar(const uint8* row0, const uint8* row1,
+                                     uint32 src_width, uint32 num_channels,
+                                     uint32 dst_col, uint32 count, uint8* dst) {
+  for (uint32 i = dst_col; i < dst_col + count; ++i) {
+    const uint32 src_col = i * 2U;
+    const uint32 next_col =
+        src_col + 1U < src_width ? num_channels : 0U;
+    const uint8* p0 = row0 + src_col * num_channels;
+    const uint8* p1 = row1 + src_col * num_channels;
+    uint8* out = dst + i * num_channels;
+    for (uint32 chan = 0; chan < num_channels; ++chan) {
+      out[chan] = static_cast<uint8>(
+          (p0[chan] + p0[chan + next_col] + p1[chan] + p1[chan + next_col] +
+           1) >> 2);
+    }
+  }
+}
+
+// Each SIMD version below writes destination RGBA pixels starting at |begin|,
+// in as many whole groups as fit in |count|, and returns the index of the
+// first pixel that it did not write.
+#if defined(ION_IMAGE_SSE2)
+static uint32 Downsample2xRgbaSse2(const uint8* row0, const uint8* row1,
+                                   uint32 begin, uint32 count, uint8* dst) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi16(1);
+  uint32 i = begin;
+  // Two destination pixels from four source pixels in each row.
+  for (; i + 2U <= count; i += 2U) {
+    const __m128i a = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(row0 + i * 8U));
+    const __m128i b = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(row1 + i * 8U));
+    const __m128i sum_lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                                         _mm_unpacklo_epi8(b, zero));
+    const __m128i sum_hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                                         _mm_unpackhi_epi8(b, zero));
+    // Add horizontally adjacent pixels.
+    const __m128i pair0 = _mm_add_epi16(sum_lo, _mm_srli_si128(sum_lo, 8));
+    const __m128i pair1 = _mm_add_epi16(sum_hi, _mm_srli_si128(sum_hi, 8));
+    const __m128i sum = _mm_srli_epi16(
+        _mm_add_epi16(_mm_unpacklo_epi64(pair0, pair1), one), 2);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i * 4U),
+                     _mm_packus_epi16(sum, sum));
+  }
+  return i;
+}
+#endif
+
+#if defined(ION_IMAGE_AVX2)
+ION_TARGET_AVX2
+static uint32 Downsample2xRgbaAvx2(const uint8* row0, const uint8* row1,
+                                   uint32 begin, uint32 count, uint8* dst) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi16(1);
+  uint32 i = begin;
+  // Four destination pixels from eight source pixels in each row. AVX2 unpacks
+  // and shifts operate within 128-bit lanes, so each lane works like the SSE2
+  // version and the two results are joined at the end.
+  for (; i + 4U <= count; i += 4U) {
+    const __m256i a = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(row0 + i * 8U));
+    const __m256i b = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(row1 + i * 8U));
+    const __m256i sum_lo = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero),
+                                            _mm256_unpacklo_epi8(b, zero));
+    const __m256i sum_hi = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero),
+                                            _mm256_unpackhi_epi8(b, zero));
+    const __m256i pair0 =
+        _mm256_add_epi16(sum_lo, _mm256_srli_si256(sum_lo, 8));
+    const __m256i pair1 =
+        _mm256_add_epi16(sum_hi, _mm256_srli_si256(sum_hi, 8));
+    const __m256i sum = _mm256_srli_epi16(
+        _mm256_add_epi16(_mm256_unpacklo_epi64(pair0, pair1), one), 2);
+    const __m256i packed = _mm256_permute4x64_epi64(
+        _mm256_packus_epi16(sum, sum), 0x08);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4U),
+                     _mm256_castsi256_si128(packed));
+  }
+  return i;
+}
+#endif
+
+#if defined(ION_IMAGE_NEON)
+static uint32 Downsample2xRgbaNeon(const uint8* row0, const uint8* row1,
+                                   uint32 begin, uint32 count, uint8* dst) {
+  const uint16x8_t one = vdupq_n_u16(1);
+  uint32 i = begin;
+  // Eight destination pixels from sixteen deinterleaved source pixels.
+  for (; i + 8U <= count; i += 8U) {
+    const uint8x16x4_t a = vld4q_u8(row0 + i * 8U);
+    const uint8x16x4_t b = vld4q_u8(row1 + i * 8U);
+    uint8x8x4_t out;
+    for (int chan = 0; chan < 4; ++chan) {
+      const uint16x8_t sum =
+          vaddq_u16(vpaddlq_u8(a.val[chan]), vpaddlq_u8(b.val[chan]));
+      out.val[chan] = vmovn_u16(vshrq_n_u16(vaddq_u16(sum, one), 2));
+    }
+    vst4_u8(dst + i * 4U, out);
+  }
+  return i;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+//
+// Resampling.
+//
+//-----------------------------------------------------------------------------
+
+// Adds a tap to |filter|, merging it with the previous tap if the index is the
+// same (which happens when coordinates are clamped).
+static void AddTap(uint32 index, float weight, ResampleFilter* filter) {
+  if (filter->indices.size() > filter->offsets.back() &&
+      filter->indices.back() == index) {
+    filter->weights.back() += weight;
+  } else {
+    filter->indices.push_back(index);
+    filter->weights.push_back(weight);
+  }
+}
+
+// Returns the zeroth order modified Bessel function of the first kind, which
+// defines the Kaiser window.
+static float BesselI0(float x) {
+  float sum = 1.f;
+  float term = 1.f;
+  const float half_x_squared = 0.25f * x * x;
+  for (int k = 1; k < 50 && term > sum * 1e-7f; ++k) {
+    term *= half_x_squared / static_cast<float>(k * k);
+    sum += term;
+  }
+  return sum;
+}
+
+// Returns the normalized sinc function, sin(pi x) / (pi x).
+static float Sinc(float x) {
+  if (std::abs(x) < 1e-6f)
+    return 1.f;
+  const float pi_x = static_cast<float>(M_PI) * x;
+  return std::sin(pi_x) / pi_x;
+}
+
+// Finishes the taps of the current destination coordinate.
+static void EndTaps(ResampleFilter* filter) {
+  const uint32 begin = filter->offsets.back();
+  const uint32 end = static_cast<uint32>(filter->indices.size());
+  filter->max_taps = std::max(filter->max_taps, end - begin);
+  filter->offsets.push_back(end);
+}
+
+// Filters a source row horizontally into |out|, which has
+// x_filter.offsets.size() - 1 pixels.
+static void FilterRowScalar(const uint8* src, uint32 num_channels,
+                            const ResampleFilter& x_filter, float* out) {
+  const size_t dst_width = x_filter.offsets.size() - 1U;
+  for (size_t x = 0; x < dst_width; ++x) {
+    float* out_pixel = out + x * num_channels;
+    for (uint32 chan = 0; chan < num_channels; ++chan)
+      out_pixel[chan] = 0.f;
+    for (uint32 tap = x_filter.offsets[x]; tap < x_filter.offsets[x + 1U];
+         ++tap) {
+      const uint8* pixel = src + x_filter.indices[tap] * num_channels;
+      const float weight = x_filter.weights[tap];
+      for (uint32 chan = 0; chan < num_channels; ++chan)
+        out_pixel[chan] += weight * static_cast<float>(pixel[chan]);
+    }
+  }
+}
+
+// Combines |row_count| filtered rows with |weights| into values [begin, count)
+// of |dst|. The SIMD versions below stop at the last whole group of values and
+// return the index of the first value they did not write.
+static void CombineRowsScalar(const float* const* rows, const float* weights,
+                              uint32 row_count, size_t begin, size_t count,
+                              uint8* dst) {
+  for (size_t i = begin; i < count; ++i) {
+    float value = 0.f;
+    for (uint32 r = 0; r < row_count; ++r)
+      value += weights[r] * rows[r][i];
+    dst[i] = RoundToUint8(value);
+  }
+}
+
+#if defined(ION_IMAGE_SSE2)
+static void FilterRowRgbaSse2(const uint8* src, const ResampleFilter& x_filter,
+                              float* out) {
+  const __m128i zero = _mm_setzero_si128();
+  const size_t dst_width = x_filter.offsets.size() - 1U;
+  for (size_t x = 0; x < dst_width; ++x) {
+    __m128 sum = _mm_setzero_ps();
+    for (uint32 tap = x_filter.offsets[x]; tap < x_filter.offsets[x + 1U];
+         ++tap) {
+      int32 bits;
+      memcpy(&bits, src + x_filter.indices[tap] * 4U, 4U);
+      const __m128i pixel = _mm_unpacklo_epi16(
+          _mm_unpacklo_epi8(_mm_cvtsi32_si128(bits), zero), zero);
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(x_filter.weights[tap]),
+                                       _mm_cvtepi32_ps(pixel)));
+    }
+    _mm_storeu_ps(out + x * 4U, sum);
+  }
+}
+
+static size_t CombineRowsSse2(const float* const* rows, const float* weights,
+                              uint32 row_count, size_t begin, size_t count,
+                              uint8* dst) {
+  const __m128 half = _mm_set1_ps(0.5f);
+  size_t i = begin;
+  for (; i + 16U <= count; i += 16U) {
+    __m128i values[4];
+    for (size_t j = 0; j < 4U; ++j) {
+      __m128 sum = _mm_setzero_ps();
+      for (uint32 r = 0; r < row_count; ++r) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[r]),
+                                         _mm_loadu_ps(rows[r] + i + j * 4U)));
+      }
+      // The sum is not negative, so truncation is the same as floor().
+      values[j] = _mm_cvttps_epi32(_mm_add_ps(sum, half));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_packus_epi16(_mm_packs_epi32(values[0], values[1]),
+                                      _mm_packs_epi32(values[2], values[3])));
+  }
+  return i;
+}
+
+// Returns the number of pixels converted, which is a multiple of 4.
+static size_t UnpremultiplyRgbaSse2(uint8* pixels, size_t pixel_count) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 one = _mm_set1_ps(1.f);
+  const __m128 max_value = _mm_set1_ps(255.f);
+  // Selects the color channels of a pixel.
+  const __m128 color_mask =
+      _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+  size_t i = 0;
+  for (; i + 4U <= pixel_count; i += 4U) {
+    uint8* data = pixels + i * 4U;
+    const __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    const __m128i words[2] = { _mm_unpacklo_epi8(bytes, zero),
+                               _mm_unpackhi_epi8(bytes, zero) };
+    __m128i results[4];
+    for (int j = 0; j < 4; ++j) {
+      const __m128 pixel = _mm_cvtepi32_ps(
+          (j & 1) ? _mm_unpackhi_epi16(words[j >> 1], zero)
+                  : _mm_unpacklo_epi16(words[j >> 1], zero));
+      const __m128 alpha = _mm_shuffle_ps(pixel, pixel, 0xff);
+      // Use a factor of 1 for zero alpha and for the alpha channel itself.
+      const __m128 zero_alpha = _mm_cmpeq_ps(alpha, _mm_setzero_ps());
+      __m128 factor = _mm_div_ps(max_value, alpha);
+      factor = _mm_or_ps(_mm_and_ps(zero_alpha, one),
+                         _mm_andnot_ps(zero_alpha, factor));
+      factor = _mm_or_ps(_mm_and_ps(color_mask, factor),
+                         _mm_andnot_ps(color_mask, one));
+      results[j] = _mm_cvttps_epi32(_mm_mul_ps(pixel, factor));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data),
+                     _mm_packus_epi16(_mm_packs_epi32(results[0], results[1]),
+                                      _mm_packs_epi32(results[2], results[3])));
+  }
+  return i;
+}
+#endif
+
+#if defined(ION_IMAGE_AVX2)
+ION_TARGET_AVX2
+static size_t CombineRowsAvx2(const float* const* rows, const float* weights,
+                              uint32 row_count, size_t begin, size_t count,
+                              uint8* dst) {
+  const __m256 half = _mm256_set1_ps(0.5f);
+  size_t i = begin;
+  for (; i + 32U <= count; i += 32U) {
+    __m256i values[4];
+    for (size_t j = 0; j < 4U; ++j) {
+      __m256 sum = _mm256_setzero_ps();
+      for (uint32 r = 0; r < row_count; ++r) {
+        sum = _mm256_add_ps(
+            sum, _mm256_mul_ps(_mm256_set1_ps(weights[r]),
+                               _mm256_loadu_ps(rows[r] + i + j * 8U)));
+      }
+      values[j] = _mm256_cvttps_epi32(_mm256_add_ps(sum, half));
+    }
+    // The packs interleave the 128-bit lanes, which the permutation undoes.
+    const __m256i packed = _mm256_packus_epi16(
+        _mm256_packs_epi32(values[0], values[1]),
+        _mm256_packs_epi32(values[2], values[3]));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(dst + i),
+        _mm256_permutevar8x32_epi32(packed,
+                                    _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)));
+  }
+  return i;
+}
+#endif
+
+}  // anonymous namespace
+
+//-----------------------------------------------------------------------------
+//
+// Public functions.
+//
+//-----------------------------------------------------------------------------
+
+SimdLevel GetSupportedSimdLevel() {
+  static const SimdLevel level = DetectSimdLevel();
+  return level;
+}
+
+void SetSimdLevel(SimdLevel level) {
+  GetSimdLevelStorage().store(
+      IsSimdLevelSupported(level) ? level : kSimdScalar);
+}
+
+SimdLevel GetSimdLevel() {
+  return static_cast<SimdLevel>(GetSimdLevelStorage().load());
+}
+
+const char* GetSimdLevelName(SimdLevel level) {
+  switch (level) {
+    case kSimdScalar:
+      return "Scalar";
+    case kSimdSse2:
+      return "SSE2";
+    case kSimdAvx2:
+      return "AVX2";
+    case kSimdNeon:
+      return "NEON";
+  }
+  return "Unknown";
+}
+
+void ParallelForRows(
+    size_t row_count, size_t work_per_row,
+    const std::function<void(size_t begin, size_t end)>& func) {
+  // Each task processes at least enough rows to be worth scheduling.
+  const size_t min_rows_per_task = std::max(
+      static_cast<size_t>(1U),
+      (kMinWorkPerThread + work_per_row - 1U) /
+          std::max(work_per_row, static_cast<size_t>(1U)));
+  if (row_count <= min_rows_per_task) {
+    func(0U, row_count);
+    return;
+  }
+  base::TaskScheduler::GetDefault()->ParallelFor(
+      0U, row_count, min_rows_per_task, func,
+      base::TaskScheduler::kNormalPriority, "ParallelForRows");
+}
+
+void Downsample2x8bpcRows(const uint8* src, uint32 src_width,
+                          uint32 src_height, uint32 num_channels, uint8* dst,
+                          uint32 dst_row_begin, uint32 dst_row_end) {
+  const uint32 dst_width = (src_width + 1U) >> 1;
+  const size_t src_stride = src_width * num_channels;
+  const size_t dst_stride = dst_width * num_channels;
+#if defined(ION_IMAGE_SIMD)
+  // Only whole pairs of source pixels can be handled by the SIMD versions.
+  const uint32 simd_count = num_channels == 4U ? src_width >> 1 : 0U;
+  const SimdLevel level = GetSimdLevel();
+#endif
+  for (uint32 dst_row = dst_row_begin; dst_row < dst_row_end; ++dst_row) {
+    const uint32 src_row = dst_row * 2U;
+    const uint8* row0 = src + src_row * src_stride;
+    // Clamp the second row to stay within the image.
+    const uint8* row1 = src_row + 1U < src_height ? row0 + src_stride : row0;
+    uint8* out = dst + dst_row * dst_stride;
+    uint32 done = 0;
+#if defined(ION_IMAGE_AVX2)
+    if (level == kSimdAvx2)
+      done = Downsample2xRgbaAvx2(row0, row1, done, simd_count, out);
+#endif
+#if defined(ION_IMAGE_SSE2)
+    if (level == kSimdSse2 || level == kSimdAvx2)
+      done = Downsample2xRgbaSse2(row0, row1, done, simd_count, out);
+#endif
+#if defined(ION_IMAGE_NEON)
+    if (level == kSimdNeon)
+      done = Downsample2xRgbaNeon(row0, row1, done, simd_count, out);
+#endif
+    Downsample2xPixelsScalar(row0, row1, src_width, num_channels, done,
+                             dst_width - done, out);
+  }
+}
+
+void BuildBilinearFilter(uint32 src_size, uint32 dst_size,
+                         ResampleFilter* filter) {
+  DCHECK_GT(src_size, 0U);
+  DCHECK_GT(dst_size, 0U);
+  *filter = ResampleFilter();
+  filter->offsets.push_back(0U);
+  const float scale =
+      static_cast<float>(src_size) / static_cast<float>(dst_size);
+  const uint32 max_src = src_size - 1U;
+  for (uint32 dst = 0; dst < dst_size; ++dst) {
+    const float src = (static_cast<float>(dst) + 0.5f) * scale;
+    // The fractional distance to the nearest pixel centers are also the
+    // interpolation weights.
+    const float w1 = src + 0.5f - std::floor(src + 0.5f);
+    const float w0 = 1.f - w1;
+    const uint32 src0 =
+        static_cast<uint32>(std::max(0.f, std::floor(src - 0.5f)));
+    const uint32 src1 =
+        std::min(max_src, static_cast<uint32>(std::floor(src + 0.5f)));
+    AddTap(src0, w0, filter);
+    AddTap(src1, w1, filter);
+    EndTaps(filter);
+  }
+}
+
+void BuildBoxFilter(uint32 src_size, uint32 dst_size, ResampleFilter* filter) {
+  DCHECK_GT(src_size, 0U);
+  DCHECK_GT(dst_size, 0U);
+  *filter = ResampleFilter();
+  filter->offsets.push_back(0U);
+  const float scale =
+      static_cast<float>(src_size) / static_cast<float>(dst_size);
+  for (uint32 dst = 0; dst < dst_size; ++dst) {
+    // The range covered by the destination pixel in the source.
+    const float begin = static_cast<float>(dst) * scale;
+    const float end = static_cast<float>(dst + 1U) * scale;
+    const uint32 first = static_cast<uint32>(std::floor(begin));
+    const uint32 last = std::min(src_size, static_cast<uint32>(std::ceil(end)));
+    for (uint32 src = first; src < last; ++src) {
+      const float src_begin = static_cast<float>(src);
+      const float coverage = std::min(src_begin + 1.f, end) -
+          std::max(src_begin, begin);
+      if (coverage > 0.f)
+        AddTap(src, coverage / scale, filter);
+    }
+    EndTaps(filter);
+  }
+}
+
+void BuildKaiserFilter(uint32 src_size, uint32 dst_size, float width,
+                       float alpha, ResampleFilter* filter) {
+  DCHECK_GT(src_size, 0U);
+  DCHECK_GT(dst_size, 0U);
+  DCHECK_GT(width, 0.f);
+  *filter = ResampleFilter();
+  filter->offsets.push_back(0U);
+  const float scale =
+      static_cast<float>(src_size) / static_cast<float>(dst_size);
+  // The filter is stretched to the destination pixel size when downsampling.
+  const float filter_scale = std::max(1.f, scale);
+  const float half_width = 0.5f * width;
+  const float radius = half_width * filter_scale;
+  const float inverse_window = 1.f / BesselI0(alpha);
+  const int max_src = static_cast<int>(src_size) - 1;
+  std::vector<float> weights;
+  for (uint32 dst = 0; dst < dst_size; ++dst) {
+    const float center = (static_cast<float>(dst) + 0.5f) * scale;
+    const int first = static_cast<int>(std::floor(center - radius));
+    const int last = static_cast<int>(std::ceil(center + radius));
+    weights.clear();
+    float sum = 0.f;
+    for (int src = first; src <= last; ++src) {
+      const float t = (static_cast<float>(src) + 0.5f - center) / filter_scale;
+      const float x = t / half_width;
+      float weight = 0.f;
+      if (x > -1.f && x < 1.f) {
+        weight = Sinc(t) * BesselI0(alpha * std::sqrt(1.f - x * x)) *
+            inverse_window;
+      }
+      weights.push_back(weight);
+      sum += weight;
+    }
+    // Normalize the weights and merge taps outside the image into the edge
+    // pixels.
+    const float inverse_sum = sum != 0.f ? 1.f / sum : 0.f;
+    for (int src = first; src <= last; ++src) {
+      const float weight = weights[src - first] * inverse_sum;
+      if (weight != 0.f) {
+        AddTap(static_cast<uint32>(std::min(max_src, std::max(0, src))),
+               weight, filter);
+      }
+    }
+    EndTaps(filter);
+  }
+}
+
+void Resample8bpcRows(const uint8* src, uint32 src_width, uint32 num_channels,
+                      const ResampleFilter& x_filter,
+                      const ResampleFilter& y_filter, uint8* dst,
+                      uint32 dst_row_begin, uint32 dst_row_end) {
+  const size_t src_stride = src_width * num_channels;
+  const size_t dst_stride = (x_filter.offsets.size() - 1U) * num_channels;
+#if defined(ION_IMAGE_SIMD)
+  const SimdLevel level = GetSimdLevel();
+#endif
+
+  // Horizontally filtered source rows are cached, since consecutive
+  // destination rows mostly use the same source rows. The cache holds enough
+  // rows for any destination row.
+  const uint32 cache_size = std::max(1U, y_filter.max_taps);
+  std::vector<float> cache_data(cache_size * dst_stride);
+  std::vector<int64> cache_rows(cache_size, -1);
+  std::vector<const float*> rows(cache_size);
+
+  for (uint32 dst_row = dst_row_begin; dst_row < dst_row_end; ++dst_row) {
+    const uint32 tap_begin = y_filter.offsets[dst_row];
+    const uint32 tap_count = y_filter.offsets[dst_row + 1U] - tap_begin;
+    for (uint32 tap = 0; tap < tap_count; ++tap) {
+      const uint32 src_row = y_filter.indices[tap_begin + tap];
+      // Source rows increase with the destination row, so the cached row with
+      // the lowest index is the one to replace.
+      size_t slot = 0;
+      for (size_t i = 0; i < cache_size; ++i) {
+        if (cache_rows[i] == src_row) {
+          slot = i;
+          break;
+        }
+        if (cache_rows[i] < cache_rows[slot])
+          slot = i;
+      }
+      float* row = &cache_data[slot * dst_stride];
+      if (cache_rows[slot] != src_row) {
+        const uint8* src_data = src + src_row * src_stride;
+#if defined(ION_IMAGE_SSE2)
+        if (num_channels == 4U && level != kSimdScalar)
+          FilterRowRgbaSse2(src_data, x_filter, row);
+        else
+#endif
+          FilterRowScalar(src_data, num_channels, x_filter, row);
+        cache_rows[slot] = src_row;
+      }
+      rows[tap] = row;
+    }
+
+    const float* weights = &y_filter.weights[tap_begin];
+    uint8* out = dst + dst_row * dst_stride;
+    size_t done = 0;
+#if defined(ION_IMAGE_AVX2)
+    if (level == kSimdAvx2)
+      done = CombineRowsAvx2(&rows[0], weights, tap_count, done, dst_stride,
+                             out);
+#endif
+#if defined(ION_IMAGE_SSE2)
+    if (level == kSimdSse2 || level == kSimdAvx2)
+      done = CombineRowsSse2(&rows[0], weights, tap_count, done, dst_stride,
+                             out);
+#endif
+    CombineRowsScalar(&rows[0], weights, tap_count, done, dst_stride, out);
+  }
+}
+
+void UnpremultiplyRgba8888(uint8* pixels, size_t pixel_count) {
+  size_t done = 0;
+#if defined(ION_IMAGE_SSE2)
+  if (GetSimdLevel() != kSimdScalar)
+    done = UnpremultiplyRgbaSse2(pixels, pixel_count);
+#endif
+  for (size_t i = done; i < pixel_count; ++i) {
+    uint8* pixel = pixels + i * 4U;
+    const uint8 alpha = pixel[3];
+    if (alpha == 0)
+      continue;
+    const float factor = 255.f / static_cast<float>(alpha);
+    for (int chan = 0; chan < 3; ++chan) {
+      pixel[chan] = static_cast<uint8>(
+          std::min(255.f, static_cast<float>(pixel[chan]) * factor));
+    }
+  }
+}
+
+}  // namespace image
+}  // namespace ion
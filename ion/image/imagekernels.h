@@ -0,0 +1,124 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef ION_IMAGE_IMAGEKERNELS_H_
+#define ION_IMAGE_IMAGEKERNELS_H_
+
+// This file contains the low-level kernels that resample and convert images
+// with 8 bits per channel, which are used by the functions in
+// conversionutils.h. Each kernel operates on raw, tightly-packed pixel rows so
+// that it can be run on a range of rows at a time. Every kernel has a portable
+// scalar implementation, and SSE2, AVX2 or NEON versions are used when the CPU
+// supports them. All versions produce identical results.
+
+#include <functional>
+#include <vector>
+
+#include "base/integral_types.h"
+
+namespace ion {
+namespace image {
+
+// The instruction sets that the kernels can use.
+enum SimdLevel {
+  kSimdScalar,
+  kSimdSse2,
+  kSimdAvx2,
+  kSimdNeon,
+};
+
+// Returns the best SimdLevel supported by the CPU, which is detected at run
+// time on x86 platforms.
+ION_API SimdLevel GetSupportedSimdLevel();
+
+// Sets/returns the SimdLevel used by the kernels, which is the supported level
+// by default. Setting a level that the CPU does not support selects
+// kSimdScalar. This is mostly useful for testing and benchmarking.
+ION_API void SetSimdLevel(SimdLevel level);
+ION_API SimdLevel GetSimdLevel();
+
+// Returns a string name for a SimdLevel, e.g., "SSE2".
+ION_API const char* GetSimdLevelName(SimdLevel level);
+
+// Calls |func| with disjoint [begin, end) ranges that cover [0, row_count).
+// If the total work (|row_count| * |work_per_row|, e.g., in pixels) is large
+// enough, the ranges are processed in parallel by the calling thread and the
+// threads of base::TaskScheduler::GetDefault(); otherwise |func| is called once
+// on the calling thread. |func| must be safe to call concurrently for disjoint
+// ranges.
+ION_API void ParallelForRows(
+    size_t row_count, size_t work_per_row,
+    const std::function<void(size_t begin, size_t end)>& func);
+
+// Writes rows [dst_row_begin, dst_row_end) of the 2x box-filtered downsample of
+// |src|, which has |num_channels| 8-bit channels per pixel. The destination
+// image has dimensions ((src_width + 1) / 2, (src_height + 1) / 2); the last
+// source row and column are repeated for odd dimensions.
+ION_API void Downsample2x8bpcRows(const uint8* src, uint32 src_width,
+                                  uint32 src_height, uint32 num_channels,
+                                  uint8* dst, uint32 dst_row_begin,
+                                  uint32 dst_row_end);
+
+// A one-dimensional resampling filter, which lists the weighted source
+// coordinates (taps) that contribute to each destination coordinate. The taps
+// of destination coordinate i are in [offsets[i], offsets[i + 1]).
+struct ResampleFilter {
+  ResampleFilter() : max_taps(0U) {}
+  std::vector<uint32> offsets;
+  std::vector<uint32> indices;
+  std::vector<float> weights;
+  // The largest number of taps of any destination coordinate.
+  uint32 max_taps;
+};
+
+// Builds a linear interpolation filter, where pixel values are centered at
+// (i + 0.5). This is most useful for upsampling.
+ION_API void BuildBilinearFilter(uint32 src_size, uint32 dst_size,
+                                 ResampleFilter* filter);
+
+// Builds a box filter that averages the source pixels covered by each
+// destination pixel, weighted by coverage. This is most useful for
+// downsampling.
+ION_API void BuildBoxFilter(uint32 src_size, uint32 dst_size,
+                            ResampleFilter* filter);
+
+// Builds a Kaiser-windowed sinc filter, which is sharper than a box filter
+// and aliases less. |width| is the support of the filter in destination pixels
+// when downsampling, and |alpha| controls the window shape; larger values
+// reduce ringing at the cost of sharpness. Note that weights can be negative,
+// so filtered values may need to be clamped.
+ION_API void BuildKaiserFilter(uint32 src_size, uint32 dst_size, float width,
+                               float alpha, ResampleFilter* filter);
+
+// Writes rows [dst_row_begin, dst_row_end) of |dst|, which is |src| resampled
+// with the passed separable filters. Each source row is filtered horizontally
+// once into a float row, and the rows are then combined vertically.
+ION_API void Resample8bpcRows(const uint8* src, uint32 src_width,
+                              uint32 num_channels,
+                              const ResampleFilter& x_filter,
+                              const ResampleFilter& y_filter, uint8* dst,
+                              uint32 dst_row_begin, uint32 dst_row_end);
+
+// Converts |pixel_count| RGBA8888 pixels from premultiplied to straight alpha
+// in place. Pixels with zero alpha are left unchanged, and color values are
+// clamped to 255.
+ION_API void UnpremultiplyRgba8888(uint8* pixels, size_t pixel_count);
+
+}  // namespace image
+}  // namespace ion
+
+#endif  // ION_IMAGE_IMAGEKERNELS_H_
@@ -0,0 +1,291 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/image/mipmaputils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "ion/base/allocationmanager.h"
+#include "ion/base/datacontainer.h"
+#include "ion/base/logging.h"
+#include "ion/image/conversionutils.h"
+#include "ion/image/imagekernels.h"
+
+namespace ion {
+namespace image {
+
+using gfx::Image;
+using gfx::ImagePtr;
+
+namespace {
+
+// A level of the chain being built, stored at float precision. Color values
+// are in linear space if sRGB decoding is enabled, and all values are in
+// [0, 255] (up to filter overshoot).
+struct FloatLevel {
+  uint32 width;
+  uint32 height;
+  std::vector<float> values;
+};
+
+// Converts between 8-bit sRGB values and linear values in [0, 255]. Encoding
+// rounds to the nearest sRGB code, which is found by searching the linear
+// values halfway between adjacent codes.
+class SrgbConverter {
+ public:
+  SrgbConverter() {
+    for (int i = 0; i < 256; ++i)
+      to_linear_[i] = ToLinear(static_cast<float>(i) / 255.f);
+    for (int i = 0; i < 255; ++i)
+      thresholds_[i] = ToLinear((static_cast<float>(i) + 0.5f) / 255.f);
+  }
+
+  float Decode(uint8 value) const { return to_linear_[value]; }
+
+  uint8 Encode(float value) const {
+    return static_cast<uint8>(
+        std::upper_bound(thresholds_, thresholds_ + 255, value) -
+        thresholds_);
+  }
+
+ private:
+  // Returns the linear value in [0, 255] of sRGB value |s| in [0, 1].
+  static float ToLinear(float s) {
+    const float linear = s <= 0.04045f ?
+        s / 12.92f : std::pow((s + 0.055f) / 1.055f, 2.4f);
+    return linear * 255.f;
+  }
+
+  float to_linear_[256];
+  float thresholds_[255];
+};
+
+static const SrgbConverter& GetSrgbConverter() {
+  static const SrgbConverter converter;
+  return converter;
+}
+
+// Returns whether channel |chan| of an image with |num_channels| channels is
+// sRGB-encoded when |srgb| is set. Alpha, the last channel of two and four
+// channel images, is always linear.
+static bool IsSrgbChannel(bool srgb, uint32 num_channels, uint32 chan) {
+  return srgb && !((num_channels == 2U || num_channels == 4U) &&
+                   chan == num_channels - 1U);
+}
+
+// Builds the filter that resamples |src_size| pixels to |dst_size|.
+static void BuildFilter(const MipmapOptions& options, uint32 src_size,
+                        uint32 dst_size, ResampleFilter* filter) {
+  if (options.filter == MipmapOptions::kKaiserFilter) {
+    BuildKaiserFilter(src_size, dst_size, options.kaiser_width,
+                      options.kaiser_alpha, filter);
+  } else {
+    BuildBoxFilter(src_size, dst_size, filter);
+  }
+}
+
+// Resamples |src| into |dst|, whose dimensions must be set, with the passed
+// separable filters. The horizontal pass writes into |temp|.
+static void ResampleFloatLevel(const FloatLevel& src, uint32 num_channels,
+                               const ResampleFilter& x_filter,
+                               const ResampleFilter& y_filter,
+                               std::vector<float>* temp, FloatLevel* dst) {
+  const size_t src_stride = src.width * num_channels;
+  const size_t dst_stride = dst->width * num_channels;
+  temp->resize(src.height * dst_stride);
+  dst->values.resize(dst->height * dst_stride);
+  const float* src_values = &src.values[0];
+  float* temp_values = &(*temp)[0];
+  float* dst_values = &dst->values[0];
+
+  ParallelForRows(src.height, dst->width * x_filter.max_taps,
+                  [&, src_values, temp_values](size_t begin, size_t end) {
+    for (size_t y = begin; y < end; ++y) {
+      const float* src_row = src_values + y * src_stride;
+      float* out = temp_values + y * dst_stride;
+      for (uint32 x = 0; x < dst->width; ++x) {
+        float* out_pixel = out + x * num_channels;
+        std::fill(out_pixel, out_pixel + num_channels, 0.f);
+        for (uint32 tap = x_filter.offsets[x]; tap < x_filter.offsets[x + 1U];
+             ++tap) {
+          const float* src_pixel =
+              src_row + x_filter.indices[tap] * num_channels;
+          const float weight = x_filter.weights[tap];
+          for (uint32 chan = 0; chan < num_channels; ++chan)
+            out_pixel[chan] += weight * src_pixel[chan];
+        }
+      }
+    }
+  });
+
+  ParallelForRows(dst->height, dst->width * y_filter.max_taps,
+                  [&, temp_values, dst_values](size_t begin, size_t end) {
+    for (size_t y = begin; y < end; ++y) {
+      float* out = dst_values + y * dst_stride;
+      std::fill(out, out + dst_stride, 0.f);
+      for (uint32 tap = y_filter.offsets[y]; tap < y_filter.offsets[y + 1U];
+           ++tap) {
+        const float* temp_row =
+            temp_values + y_filter.indices[tap] * dst_stride;
+        const float weight = y_filter.weights[tap];
+        for (size_t i = 0; i < dst_stride; ++i)
+          out[i] += weight * temp_row[i];
+      }
+    }
+  });
+}
+
+// Converts |level| to an 8-bit image, encoding sRGB channels if requested.
+static const ImagePtr FloatLevelToImage(
+    const FloatLevel& level, Image::Format format, uint32 num_channels,
+    bool srgb, bool is_wipeable, const base::AllocatorPtr& allocator) {
+  ImagePtr image =
+      AllocImage(format, level.width, level.height, is_wipeable, allocator);
+  uint8* pixels = image->GetData()->GetMutableData<uint8>();
+  const float* values = &level.values[0];
+  const size_t row_size = level.width * num_channels;
+  const SrgbConverter& converter = GetSrgbConverter();
+  ParallelForRows(level.height, level.width,
+                  [=, &converter](size_t begin, size_t end) {
+    for (size_t i = begin * row_size; i < end * row_size; ++i) {
+      const float value = std::min(255.f, std::max(0.f, values[i]));
+      if (IsSrgbChannel(srgb, num_channels,
+                        static_cast<uint32>(i % num_channels)))
+        pixels[i] = converter.Encode(value);
+      else
+        pixels[i] = static_cast<uint8>(value + 0.5f);
+    }
+  });
+  return image;
+}
+
+}  // anonymous namespace
+
+const std::vector<ImagePtr> BuildMipmapChain(
+    const ImagePtr& image, const MipmapOptions& options, bool is_wipeable,
+    const base::AllocatorPtr& allocator) {
+  std::vector<ImagePtr> chain;
+  if (!image.Get() || !image->GetData().Get() ||
+      !image->GetData()->GetData() || image->GetWidth() == 0U ||
+      image->GetHeight() == 0U)
+    return chain;
+  const Image::Format format = image->GetFormat();
+  if (!Image::Is8BitPerChannelFormat(format) ||
+      image->GetDimensions() != Image::k2d) {
+    LOG(WARNING) << "Building mipmaps for image format "
+                 << Image::GetFormatString(format) << " not supported.";
+    return chain;
+  }
+
+  const base::AllocatorPtr& al =
+      base::AllocationManager::GetNonNullAllocator(allocator);
+  const uint32 num_channels =
+      static_cast<uint32>(Image::GetNumComponentsForFormat(format));
+  const bool srgb = options.srgb || format == Image::kSrgb8 ||
+      format == Image::kSrgba8;
+  const bool use_float =
+      srgb || options.filter != MipmapOptions::kBoxFilter;
+
+  uint32 level_count = 1U;
+  while (level_count < gfx::kMipmapSlotCount &&
+         ((image->GetWidth() >> level_count) ||
+          (image->GetHeight() >> level_count)))
+    ++level_count;
+  if (options.max_level_count)
+    level_count = std::min(level_count, options.max_level_count);
+
+  chain.reserve(level_count);
+  chain.push_back(image);
+
+  ResampleFilter x_filter, y_filter;
+  if (!use_float) {
+    // Box filtering in gamma space needs no extra precision, so each level is
+    // filtered directly from the 8-bit level above it.
+    for (uint32 level = 1U; level < level_count; ++level) {
+      const Image& src = *chain.back();
+      const uint32 width = std::max(1U, image->GetWidth() >> level);
+      const uint32 height = std::max(1U, image->GetHeight() >> level);
+      BuildFilter(options, src.GetWidth(), width, &x_filter);
+      BuildFilter(options, src.GetHeight(), height, &y_filter);
+      ImagePtr dst = AllocImage(format, width, height, is_wipeable, al);
+      const uint8* src_data = src.GetData()->GetData<uint8>();
+      uint8* dst_data = dst->GetData()->GetMutableData<uint8>();
+      const uint32 src_width = src.GetWidth();
+      ParallelForRows(height, width * y_filter.max_taps,
+                      [&, src_data, dst_data](size_t begin, size_t end) {
+        Resample8bpcRows(src_data, src_width, num_channels, x_filter,
+                         y_filter, dst_data, static_cast<uint32>(begin),
+                         static_cast<uint32>(end));
+      });
+      chain.push_back(dst);
+    }
+    return chain;
+  }
+
+  // Decode the base level once.
+  FloatLevel src;
+  src.width = image->GetWidth();
+  src.height = image->GetHeight();
+  src.values.resize(src.width * src.height * num_channels);
+  {
+    const uint8* pixels = image->GetData()->GetData<uint8>();
+    float* values = &src.values[0];
+    const size_t row_size = src.width * num_channels;
+    const SrgbConverter& converter = GetSrgbConverter();
+    ParallelForRows(src.height, src.width,
+                    [=, &converter](size_t begin, size_t end) {
+      for (size_t i = begin * row_size; i < end * row_size; ++i) {
+        values[i] = IsSrgbChannel(srgb, num_channels,
+                                  static_cast<uint32>(i % num_channels)) ?
+            converter.Decode(pixels[i]) : static_cast<float>(pixels[i]);
+      }
+    });
+  }
+
+  FloatLevel dst;
+  std::vector<float> temp;
+  for (uint32 level = 1U; level < level_count; ++level) {
+    dst.width = std::max(1U, image->GetWidth() >> level);
+    dst.height = std::max(1U, image->GetHeight() >> level);
+    BuildFilter(options, src.width, dst.width, &x_filter);
+    BuildFilter(options, src.height, dst.height, &y_filter);
+    ResampleFloatLevel(src, num_channels, x_filter, y_filter, &temp, &dst);
+    chain.push_back(FloatLevelToImage(dst, format, num_channels, srgb,
+                                      is_wipeable, al));
+    std::swap(src, dst);
+  }
+  return chain;
+}
+
+bool SetMipmapChain(const std::vector<ImagePtr>& chain,
+                    const gfx::TexturePtr& texture) {
+  if (!texture.Get() || chain.empty())
+    return false;
+  const size_t count = std::min(chain.size(), gfx::kMipmapSlotCount);
+  for (size_t level = 0; level < count; ++level)
+    texture->SetImage(level, chain[level]);
+  for (size_t level = count; level < gfx::kMipmapSlotCount; ++level) {
+    if (texture->HasImage(level))
+      texture->SetImage(level, ImagePtr());
+  }
+  return true;
+}
+
+}  // namespace image
+}  // namespace ion
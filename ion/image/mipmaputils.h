@@ -0,0 +1,92 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef ION_IMAGE_MIPMAPUTILS_H_
+#define ION_IMAGE_MIPMAPUTILS_H_
+
+#include <vector>
+
+#include "base/integral_types.h"
+#include "ion/base/allocator.h"
+#include "ion/gfx/image.h"
+#include "ion/gfx/texture.h"
+
+namespace ion {
+namespace image {
+
+// Options for BuildMipmapChain().
+struct MipmapOptions {
+  enum Filter {
+    // Averages the pixels covered by each destination pixel. This is the
+    // fastest filter and matches what most drivers generate.
+    kBoxFilter,
+    // A Kaiser-windowed sinc, which keeps more detail in the smaller levels
+    // while aliasing less than a box filter.
+    kKaiserFilter,
+  };
+
+  MipmapOptions()
+      : filter(kBoxFilter),
+        srgb(false),
+        max_level_count(0U),
+        kaiser_width(3.f),
+        kaiser_alpha(4.f) {}
+
+  // The filter used to compute each level from the one above it.
+  Filter filter;
+  // Whether the color channels hold sRGB-encoded values, in which case they
+  // are filtered in linear space and re-encoded. Alpha channels are always
+  // linear. kSrgb8 and kSrgba8 images are always treated as sRGB.
+  bool srgb;
+  // The maximum number of levels to produce, including the base level. Zero
+  // means the full chain down to 1x1.
+  uint32 max_level_count;
+  // The support, in destination pixels, and the shape parameter of the Kaiser
+  // filter. See BuildKaiserFilter() in imagekernels.h.
+  float kaiser_width;
+  float kaiser_alpha;
+};
+
+// Builds the mipmap chain of an 8-bit-per-channel |image|, where element 0 is
+// |image| itself and level i has dimensions max(1, width >> i) by
+// max(1, height >> i), which is what OpenGL expects. Each level is computed
+// from the previous one; when sRGB decoding or the Kaiser filter is used the
+// intermediate levels are kept at float precision, so the base image is only
+// decoded once and rounding errors do not accumulate. Rows of each level are
+// filtered in parallel for large images (see ParallelForRows()).
+//
+// This does not touch any OpenGL state, so it can be called from any thread,
+// e.g., while loading assets, and the resulting levels can then be passed to
+// SetMipmapChain(). Returns an empty vector if |image| is NULL or has no data,
+// and also logs a warning if it is not an uncompressed 8-bit-per-channel 2D
+// image.
+ION_API const std::vector<gfx::ImagePtr> BuildMipmapChain(
+    const gfx::ImagePtr& image, const MipmapOptions& options,
+    bool is_wipeable, const base::AllocatorPtr& allocator);
+
+// Sets the images of |chain| as mipmap levels 0 through chain.size() - 1 of
+// |texture|, clearing any further levels that were previously set. Since the
+// levels are supplied, the Sampler of |texture| does not need automatic
+// mipmap generation enabled, which avoids glGenerateMipmap() when the texture
+// is uploaded. Returns false if |texture| is NULL or |chain| is empty.
+ION_API bool SetMipmapChain(const std::vector<gfx::ImagePtr>& chain,
+                            const gfx::TexturePtr& texture);
+
+}  // namespace image
+}  // namespace ion
+
+#endif  // ION_IMAGE_MIPMAPUTILS_H_
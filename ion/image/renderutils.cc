@@ -267,5 +267,22 @@ const gfx::ImagePtr RenderCubeMapTextureFaceImage(
       math::Vector2i(width, height), renderer, allocator);
 }
 
+const gfx::Renderer::ReadImageCallback BuildExternalImageReadCallback(
+    ExternalImageFormat external_format, bool flip_vertically,
+    const std::function<void(const std::vector<uint8>& data)>& callback,
+    base::TaskScheduler::TaskGroup* group) {
+  DCHECK(group);
+  return [external_format, flip_vertically, callback,
+          group](const gfx::ImagePtr& image) {
+    // The Image holds its own copy of the pixels, so the task can safely
+    // outlive the read that produced it.
+    group->Run([external_format, flip_vertically, callback, image]() {
+      callback(image.Get() ? ConvertToExternalImageData(image, external_format,
+                                                        flip_vertically)
+                           : std::vector<uint8>());
+    });
+  };
+}
+
 }  // namespace image
 }  // namespace ion
@@ -18,12 +18,17 @@ limitations under the License.
 #ifndef ION_IMAGE_RENDERUTILS_H_
 #define ION_IMAGE_RENDERUTILS_H_
 
+#include <functional>
+#include <vector>
+
 #include "base/integral_types.h"
 #include "ion/base/allocator.h"
+#include "ion/base/taskscheduler.h"
 #include "ion/gfx/cubemaptexture.h"
 #include "ion/gfx/image.h"
 #include "ion/gfx/renderer.h"
 #include "ion/gfx/texture.h"
+#include "ion/image/conversionutils.h"
 
 namespace ion {
 namespace image {
@@ -44,6 +49,19 @@ ION_API const gfx::ImagePtr RenderCubeMapTextureFaceImage(
     uint32 width, uint32 height,
     const gfx::RendererPtr& renderer, const base::AllocatorPtr& allocator);
 
+// Returns a callback for gfx::Renderer::ReadImageAsync() that converts each
+// image it receives to |external_format| in a task of |group|, so that the
+// encoding (e.g., PNG compression) does not stall the rendering thread. If
+// |flip_vertically| is true, the image is inverted in the Y dimension, which
+// turns OpenGL's bottom-up rows into the top-down order of most image files.
+// |callback| is invoked from the task with the converted data, which is empty
+// if the read or the conversion failed. The group must be waited for before
+// anything that |callback| uses is destroyed.
+ION_API const gfx::Renderer::ReadImageCallback BuildExternalImageReadCallback(
+    ExternalImageFormat external_format, bool flip_vertically,
+    const std::function<void(const std::vector<uint8>& data)>& callback,
+    base::TaskScheduler::TaskGroup* group);
+
 }  // namespace image
 }  // namespace ion
 
@@ -0,0 +1,212 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/image/compressedimagecache.h"
+
+#include <stdio.h>
+#if defined(ION_PLATFORM_WINDOWS)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <string>
+#include <vector>
+
+#include "ion/base/datacontainer.h"
+#include "ion/base/logchecker.h"
+#include "ion/base/threadspawner.h"
+#include "ion/port/fileutils.h"
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace image {
+
+namespace {
+
+using gfx::Image;
+using gfx::ImagePtr;
+
+static const ImagePtr CreateImage(Image::Format format, uint32 width,
+                                  uint32 height, uint8 first_value) {
+  std::vector<uint8> data(Image::ComputeDataSize(format, width, height));
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = static_cast<uint8>(first_value + i);
+  ImagePtr image(new Image);
+  image->Set(format, width, height,
+             base::DataContainer::CreateAndCopy<uint8>(&data[0], data.size(),
+                                                       false,
+                                                       image->GetAllocator()));
+  return image;
+}
+
+static bool ImagesMatch(const Image& a, const Image& b) {
+  return a.GetFormat() == b.GetFormat() && a.GetWidth() == b.GetWidth() &&
+      a.GetHeight() == b.GetHeight() && a.GetDataSize() == b.GetDataSize() &&
+      memcmp(a.GetData()->GetData(), b.GetData()->GetData(),
+             a.GetDataSize()) == 0;
+}
+
+// Returns the path of a new, empty directory, so that tests do not see each
+// other's cache files or files left in the temporary directory.
+static const std::string CreateTestDirectory() {
+  const std::string path = port::GetTemporaryFilename();
+  port::RemoveFile(path);
+#if defined(ION_PLATFORM_WINDOWS)
+  const int result = _mkdir(path.c_str());
+#else
+  const int result = mkdir(path.c_str(), 0700);
+#endif
+  return result == 0 ? path : std::string();
+}
+
+// Removes a directory created by CreateTestDirectory(), which must be empty.
+static bool RemoveTestDirectory(const std::string& path) {
+#if defined(ION_PLATFORM_WINDOWS)
+  return _rmdir(path.c_str()) == 0;
+#else
+  return rmdir(path.c_str()) == 0;
+#endif
+}
+
+}  // anonymous namespace
+
+TEST(CompressedImageCache, ComputeKey) {
+  ImagePtr image = CreateImage(Image::kRgba8888, 8, 8, 0);
+  const std::string key =
+      CompressedImageCache::ComputeKey(*image, Image::kDxt5, "");
+  EXPECT_EQ(16U, key.length());
+  EXPECT_EQ(key, CompressedImageCache::ComputeKey(
+      *CreateImage(Image::kRgba8888, 8, 8, 0), Image::kDxt5, ""));
+  // Every part of the key matters.
+  EXPECT_NE(key, CompressedImageCache::ComputeKey(*image, Image::kEtc1, ""));
+  EXPECT_NE(key, CompressedImageCache::ComputeKey(*image, Image::kDxt5, "a"));
+  EXPECT_NE(key, CompressedImageCache::ComputeKey(
+      *CreateImage(Image::kRgba8888, 8, 8, 1), Image::kDxt5, ""));
+  EXPECT_NE(key, CompressedImageCache::ComputeKey(
+      *CreateImage(Image::kRgba8888, 4, 16, 0), Image::kDxt5, ""));
+  EXPECT_NE(key, CompressedImageCache::ComputeKey(
+      *CreateImage(Image::kRgb888, 8, 8, 0), Image::kDxt5, ""));
+}
+
+TEST(CompressedImageCache, StoreAndFind) {
+  const std::string directory = CreateTestDirectory();
+  ASSERT_FALSE(directory.empty());
+  ImagePtr source = CreateImage(Image::kRgba8888, 8, 8, 3);
+  const std::string key =
+      CompressedImageCache::ComputeKey(*source, Image::kDxt5, "StoreAndFind");
+  // Stand-in for a compressed image.
+  ImagePtr compressed = CreateImage(Image::kDxt5, 8, 8, 7);
+
+  {
+    CompressedImageCachePtr cache(new CompressedImageCache(directory));
+    EXPECT_EQ(directory, cache->GetDirectory());
+    EXPECT_TRUE(cache->Find(key, false, base::AllocatorPtr()).Get() == NULL);
+    EXPECT_EQ(0U, cache->GetHitCount());
+    EXPECT_EQ(1U, cache->GetMissCount());
+
+    cache->Store(key, compressed);
+    ImagePtr found = cache->Find(key, false, base::AllocatorPtr());
+    ASSERT_TRUE(found.Get() != NULL);
+    EXPECT_TRUE(ImagesMatch(*compressed, *found));
+    cache->Flush();
+    found = cache->Find(key, false, base::AllocatorPtr());
+    ASSERT_TRUE(found.Get() != NULL);
+    EXPECT_TRUE(ImagesMatch(*compressed, *found));
+    EXPECT_EQ(2U, cache->GetHitCount());
+  }
+
+  // A new cache, e.g., in the next run of an application, reads the file.
+  CompressedImageCachePtr cache(new CompressedImageCache(directory));
+  ImagePtr found = cache->Find(key, true, base::AllocatorPtr());
+  ASSERT_TRUE(found.Get() != NULL);
+  EXPECT_TRUE(ImagesMatch(*compressed, *found));
+  EXPECT_TRUE(found->GetData()->IsWipeable());
+  // Wiping the data releases the mapping.
+  found->GetData()->WipeData();
+  EXPECT_TRUE(found->GetData()->GetData() == NULL);
+
+  // Invalid files are ignored.
+  {
+    base::LogChecker log_checker;
+    FILE* file = port::OpenFile(directory + "/" + key + ".ionimg", "wb");
+    ASSERT_TRUE(file != NULL);
+    fputs("garbage", file);
+    fclose(file);
+    EXPECT_TRUE(cache->Find(key, false, base::AllocatorPtr()).Get() == NULL);
+    file = port::OpenFile(directory + "/" + key + ".ionimg", "wb");
+    fputs("this is not an image cache file, but it is long enough", file);
+    fclose(file);
+    EXPECT_TRUE(cache->Find(key, false, base::AllocatorPtr()).Get() == NULL);
+    EXPECT_TRUE(log_checker.HasMessage("WARNING", "invalid image cache"));
+  }
+
+  // Clear() removes the files written by a cache, but not other files, even if
+  // they have the same extension.
+  const std::string other_key =
+      CompressedImageCache::ComputeKey(*source, Image::kDxt5, "Clear");
+  cache->Store(other_key, compressed);
+  FILE* file = port::OpenFile(directory + "/other.ionimg", "wb");
+  ASSERT_TRUE(file != NULL);
+  fputs("not an image cache file", file);
+  fclose(file);
+  cache->Clear();
+  EXPECT_TRUE(
+      cache->Find(other_key, false, base::AllocatorPtr()).Get() == NULL);
+  EXPECT_TRUE(port::RemoveFile(directory + "/other.ionimg"));
+  EXPECT_TRUE(port::RemoveFile(directory + "/" + key + ".ionimg"));
+  EXPECT_TRUE(RemoveTestDirectory(directory));
+}
+
+TEST(CompressedImageCache, FlushFromMultipleThreads) {
+  const std::string directory = CreateTestDirectory();
+  ASSERT_FALSE(directory.empty());
+  CompressedImageCachePtr cache(new CompressedImageCache(directory));
+  std::vector<std::string> keys;
+  for (uint8 i = 0; i < 20U; ++i) {
+    ImagePtr image = CreateImage(Image::kDxt5, 64, 64, i);
+    keys.push_back(CompressedImageCache::ComputeKey(*image, Image::kDxt5,
+                                                    "FlushFromMultipleThreads"));
+    cache->Store(keys.back(), image);
+  }
+
+  // Every flushing thread is woken once the writes are done.
+  {
+    port::ThreadStdFunc func = [&cache]() {
+      cache->Flush();
+      return true;
+    };
+    base::ThreadSpawner thread1("Flush 1", func);
+    base::ThreadSpawner thread2("Flush 2", func);
+    cache->Flush();
+  }
+  // All of the files have been written, so another cache can read them.
+  CompressedImageCachePtr other_cache(new CompressedImageCache(directory));
+  for (size_t i = 0; i < keys.size(); ++i) {
+    EXPECT_TRUE(
+        other_cache->Find(keys[i], false, base::AllocatorPtr()).Get() != NULL);
+  }
+
+  // Flushing with nothing pending returns right away.
+  cache->Flush();
+  cache->Clear();
+  EXPECT_TRUE(RemoveTestDirectory(directory));
+}
+
+}  // namespace image
+}  // namespace ion
@@ -27,6 +27,7 @@ limitations under the License.
 #include "base/integral_types.h"
 #include "ion/base/datacontainer.h"
 #include "ion/base/logchecker.h"
+#include "ion/image/imagekernels.h"
 #include "ion/image/tests/image_bytes.h"
 #include "third_party/googletest/googletest/include/gtest/gtest.h"
 
@@ -1225,6 +1226,30 @@ TEST(ConversionUtils, ResizeImageTo1x1) {
   }
 }
 
+TEST(ConversionUtils, ResizeImageRounding) {
+  // The separable filters round each filtered value half up, at every
+  // SimdLevel.
+  base::AllocatorPtr al;  // NULL pointer means use default allocator.
+  const uint8 data[] = {
+    0, 1, 1, 2,
+    1, 0, 1, 2
+  };
+  vector<uint8> pattern(data, data + ARRAYSIZE(data));
+  ImagePtr image = CreateImageWithPattern(Image::kLuminance, 4, 2, pattern);
+  // The averages are 0.5 and 1.5.
+  const uint8 expected[] = { 1, 2 };
+  const SimdLevel supported = GetSupportedSimdLevel();
+  static const SimdLevel kLevels[] = { kSimdScalar, supported };
+  for (size_t i = 0; i < ARRAYSIZE(kLevels); ++i) {
+    SetSimdLevel(kLevels[i]);
+    ImagePtr downsampled = ResizeImage(image, 2, 1, false, al);
+    ASSERT_TRUE(downsampled.Get() != NULL);
+    EXPECT_TRUE(ImageMatchesBytes(*downsampled, expected,
+                                  ARRAYSIZE(expected)));
+  }
+  SetSimdLevel(supported);
+}
+
 TEST(ConversionUtils, ResizeImageDouble) {
   base::AllocatorPtr al;  // NULL pointer means use default allocator.
   bool is_wipeable = true;
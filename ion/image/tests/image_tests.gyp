@@ -23,7 +23,10 @@
       'target_name': 'ionimage_test',
       'includes': [ '../../dev/test_target.gypi' ],
       'sources' : [
+        'compressedimagecache_test.cc',
         'conversionutils_test.cc',
+        'imagekernels_test.cc',
+        'mipmaputils_test.cc',
         'ninepatch_test.cc',
         'renderutils_test.cc',
       ],
@@ -39,6 +42,23 @@
       ],
     },
 
+    {
+      # Reports the throughput of the image kernels at each supported SIMD
+      # level. This is not part of ionimage_test since it takes a while.
+      'target_name': 'ionimage_benchmark',
+      'includes': [ '../../dev/test_target.gypi' ],
+      'sources' : [
+        'imagekernels_benchmark.cc',
+      ],
+      'dependencies' : [
+        '<(ion_dir)/analytics/analytics.gyp:ionanalytics',
+        '<(ion_dir)/image/image.gyp:ionimage_for_tests',
+        '<(ion_dir)/base/base.gyp:ionbase_for_tests',
+        '<(ion_dir)/external/gtest.gyp:iongtest_safeallocs',
+        '<(ion_dir)/port/port.gyp:ionport',
+      ],
+    },
+
     {
       'target_name': 'image_tests_assets',
       'type': 'static_library',
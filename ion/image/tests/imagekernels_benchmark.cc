@@ -0,0 +1,156 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+// Benchmarks the image kernels at every supported SimdLevel. This is built as
+// a separate target so that it does not slow down the regular tests; the
+// results are printed to stdout in megapixels per second.
+
+#include <functional>
+#include <iostream>  // NOLINT
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ion/analytics/benchmark.h"
+#include "ion/analytics/benchmarkutils.h"
+#include "ion/image/imagekernels.h"
+#include "ion/port/timer.h"
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace image {
+
+namespace {
+
+using analytics::Benchmark;
+
+static const uint32 kWidth = 2048U;
+static const uint32 kHeight = 2048U;
+static const int kIterations = 10;
+
+static const char* const kFormatNames[] = {
+  "", "Luminance", "LuminanceAlpha", "Rgb888", "Rgba8888"
+};
+
+// Runs |func| kIterations times and adds the number of source megapixels
+// processed per second to |benchmark|.
+static void Measure(const std::string& kernel, uint32 num_channels,
+                    SimdLevel level, const std::function<void()>& func,
+                    Benchmark* benchmark) {
+  std::ostringstream id;
+  id << kernel << " " << kFormatNames[num_channels] << " "
+     << GetSimdLevelName(level);
+  Benchmark::VariableAccumulator accumulator(Benchmark::Descriptor(
+      id.str(), kernel, "Throughput of " + id.str(), "MPix/s"));
+  // Warm up caches and any lazily created state.
+  func();
+  for (int i = 0; i < kIterations; ++i) {
+    port::Timer timer;
+    func();
+    const double seconds = timer.GetInS();
+    if (seconds > 0.0) {
+      accumulator.AddSample(
+          static_cast<double>(kWidth) * static_cast<double>(kHeight) /
+          (seconds * 1.0e6));
+    }
+  }
+  benchmark->AddAccumulatedVariable(accumulator.Get());
+}
+
+}  // anonymous namespace
+
+TEST(ImageKernelsBenchmark, Throughput) {
+  std::vector<SimdLevel> levels;
+  for (int level = kSimdScalar; level <= kSimdNeon; ++level) {
+    SetSimdLevel(static_cast<SimdLevel>(level));
+    if (GetSimdLevel() == level)
+      levels.push_back(static_cast<SimdLevel>(level));
+  }
+
+  Benchmark benchmark;
+  std::vector<uint8> src(kWidth * kHeight * 4U);
+  for (size_t i = 0; i < src.size(); ++i)
+    src[i] = static_cast<uint8>(i * 7U + (i >> 9));
+  std::vector<uint8> dst(src.size() * 4U);
+
+  ResampleFilter half_x, half_y, box_x, box_y, up_x, up_y;
+  BuildBilinearFilter(kWidth, kWidth / 2U, &half_x);
+  BuildBilinearFilter(kHeight, kHeight / 2U, &half_y);
+  BuildBoxFilter(kWidth, kWidth / 3U, &box_x);
+  BuildBoxFilter(kHeight, kHeight / 3U, &box_y);
+  BuildBilinearFilter(kWidth, kWidth * 2U, &up_x);
+  BuildBilinearFilter(kHeight, kHeight * 2U, &up_y);
+
+  for (size_t l = 0; l < levels.size(); ++l) {
+    const SimdLevel level = levels[l];
+    SetSimdLevel(level);
+    for (uint32 num_channels = 1U; num_channels <= 4U; ++num_channels) {
+      const uint8* src_data = &src[0];
+      uint8* dst_data = &dst[0];
+      Measure("Downsample2x", num_channels, level, [=]() {
+        ParallelForRows(kHeight / 2U, kWidth / 2U,
+                        [=](size_t begin, size_t end) {
+          Downsample2x8bpcRows(src_data, kWidth, kHeight, num_channels,
+                               dst_data, static_cast<uint32>(begin),
+                               static_cast<uint32>(end));
+        });
+      }, &benchmark);
+
+      struct {
+        const char* name;
+        const ResampleFilter* x_filter;
+        const ResampleFilter* y_filter;
+      } resizes[] = {
+        { "ResizeBilinearDown", &half_x, &half_y },
+        { "ResizeBox", &box_x, &box_y },
+        { "ResizeBilinearUp", &up_x, &up_y },
+      };
+      for (size_t r = 0; r < sizeof(resizes) / sizeof(resizes[0]); ++r) {
+        const ResampleFilter& x_filter = *resizes[r].x_filter;
+        const ResampleFilter& y_filter = *resizes[r].y_filter;
+        const size_t out_height = y_filter.offsets.size() - 1U;
+        const size_t out_width = x_filter.offsets.size() - 1U;
+        Measure(resizes[r].name, num_channels, level, [&, src_data,
+                                                       dst_data]() {
+          ParallelForRows(out_height, out_width * y_filter.max_taps,
+                          [&, src_data, dst_data](size_t begin, size_t end) {
+            Resample8bpcRows(src_data, kWidth, num_channels, x_filter,
+                             y_filter, dst_data, static_cast<uint32>(begin),
+                             static_cast<uint32>(end));
+          });
+        }, &benchmark);
+      }
+    }
+
+    std::vector<uint8> pixels(src);
+    uint8* pixel_data = &pixels[0];
+    Measure("Unpremultiply", 4U, level, [=]() {
+      ParallelForRows(kHeight, kWidth, [=](size_t begin, size_t end) {
+        UnpremultiplyRgba8888(pixel_data + begin * kWidth * 4U,
+                              (end - begin) * kWidth);
+      });
+    }, &benchmark);
+  }
+  SetSimdLevel(GetSupportedSimdLevel());
+
+  analytics::OutputBenchmarkPretty("Image kernels", false, benchmark,
+                                   std::cout);
+  EXPECT_FALSE(benchmark.GetAccumulatedVariables().empty());
+}
+
+}  // namespace image
+}  // namespace ion
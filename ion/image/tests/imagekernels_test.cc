@@ -0,0 +1,304 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/image/imagekernels.h"
+
+#include <atomic>
+#include <vector>
+
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace image {
+
+namespace {
+
+// Returns pixel data with pseudo-random values.
+static const std::vector<uint8> CreatePixels(uint32 width, uint32 height,
+                                             uint32 num_channels) {
+  std::vector<uint8> pixels(width * height * num_channels);
+  uint32 value = 12345U;
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    value = value * 1103515245U + 12345U;
+    pixels[i] = static_cast<uint8>(value >> 16);
+  }
+  return pixels;
+}
+
+// Returns all the SimdLevels that are supported, including kSimdScalar.
+static const std::vector<SimdLevel> GetSupportedLevels() {
+  std::vector<SimdLevel> levels;
+  static const SimdLevel kLevels[] = {
+    kSimdScalar, kSimdSse2, kSimdAvx2, kSimdNeon
+  };
+  for (size_t i = 0; i < sizeof(kLevels) / sizeof(kLevels[0]); ++i) {
+    SetSimdLevel(kLevels[i]);
+    if (GetSimdLevel() == kLevels[i])
+      levels.push_back(kLevels[i]);
+  }
+  SetSimdLevel(GetSupportedSimdLevel());
+  return levels;
+}
+
+static const std::vector<uint8> Downsample(const std::vector<uint8>& src,
+                                           uint32 width, uint32 height,
+                                           uint32 num_channels) {
+  const uint32 dst_height = (height + 1U) / 2U;
+  std::vector<uint8> dst(((width + 1U) / 2U) * dst_height * num_channels);
+  Downsample2x8bpcRows(&src[0], width, height, num_channels, &dst[0], 0U,
+                       dst_height);
+  return dst;
+}
+
+static const std::vector<uint8> Resample(const std::vector<uint8>& src,
+                                         uint32 width, uint32 height,
+                                         uint32 num_channels, uint32 dst_width,
+                                         uint32 dst_height, bool box) {
+  ResampleFilter x_filter, y_filter;
+  if (box) {
+    BuildBoxFilter(width, dst_width, &x_filter);
+    BuildBoxFilter(height, dst_height, &y_filter);
+  } else {
+    BuildBilinearFilter(width, dst_width, &x_filter);
+    BuildBilinearFilter(height, dst_height, &y_filter);
+  }
+  std::vector<uint8> dst(dst_width * dst_height * num_channels);
+  Resample8bpcRows(&src[0], width, num_channels, x_filter, y_filter, &dst[0],
+                   0U, dst_height);
+  return dst;
+}
+
+}  // anonymous namespace
+
+TEST(ImageKernels, SimdLevel) {
+  const SimdLevel supported = GetSupportedSimdLevel();
+  EXPECT_EQ(supported, GetSimdLevel());
+  EXPECT_STREQ("Scalar", GetSimdLevelName(kSimdScalar));
+  EXPECT_STREQ("SSE2", GetSimdLevelName(kSimdSse2));
+  EXPECT_STREQ("AVX2", GetSimdLevelName(kSimdAvx2));
+  EXPECT_STREQ("NEON", GetSimdLevelName(kSimdNeon));
+
+  SetSimdLevel(kSimdScalar);
+  EXPECT_EQ(kSimdScalar, GetSimdLevel());
+  SetSimdLevel(supported);
+  EXPECT_EQ(supported, GetSimdLevel());
+  // SSE2 and NEON are never supported together.
+  SetSimdLevel(kSimdNeon);
+  SimdLevel neon = GetSimdLevel();
+  SetSimdLevel(kSimdSse2);
+  EXPECT_TRUE(neon == kSimdScalar || GetSimdLevel() == kSimdScalar);
+  SetSimdLevel(supported);
+}
+
+TEST(ImageKernels, ParallelForRows) {
+  // Small amounts of work run on the calling thread in one call.
+  int calls = 0;
+  ParallelForRows(10U, 10U, [&calls](size_t begin, size_t end) {
+    EXPECT_EQ(0U, begin);
+    EXPECT_EQ(10U, end);
+    ++calls;
+  });
+  EXPECT_EQ(1, calls);
+
+  // Every row is processed exactly once.
+  static const size_t kRows = 1000U;
+  std::vector<std::atomic<int>> counts(kRows);
+  for (size_t i = 0; i < kRows; ++i)
+    counts[i] = 0;
+  ParallelForRows(kRows, 4096U, [&counts](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      ++counts[i];
+  });
+  for (size_t i = 0; i < kRows; ++i)
+    EXPECT_EQ(1, counts[i]) << "row " << i;
+
+  // No rows.
+  calls = 0;
+  ParallelForRows(0U, 4096U, [&calls](size_t begin, size_t end) {
+    EXPECT_EQ(begin, end);
+    ++calls;
+  });
+  EXPECT_EQ(1, calls);
+}
+
+TEST(ImageKernels, Downsample2x) {
+  // 3x3 RGBA image, where the last row and column are repeated.
+  const uint8 src[] = {
+    0, 4, 8, 12,   4, 8, 12, 16,    100, 100, 100, 100,
+    8, 12, 16, 20, 12, 16, 20, 24,  200, 200, 200, 200,
+    1, 1, 1, 1,    3, 3, 3, 3,      255, 255, 255, 255,
+  };
+  const std::vector<uint8> pixels(src, src + sizeof(src));
+  const std::vector<SimdLevel> levels = GetSupportedLevels();
+  for (size_t i = 0; i < levels.size(); ++i) {
+    SCOPED_TRACE(GetSimdLevelName(levels[i]));
+    SetSimdLevel(levels[i]);
+    const std::vector<uint8> dst = Downsample(pixels, 3U, 3U, 4U);
+    const uint8 expected[] = {
+      6, 10, 14, 18,   150, 150, 150, 150,
+      2, 2, 2, 2,      255, 255, 255, 255,
+    };
+    EXPECT_EQ(std::vector<uint8>(expected, expected + sizeof(expected)), dst);
+  }
+  SetSimdLevel(GetSupportedSimdLevel());
+}
+
+TEST(ImageKernels, SimdMatchesScalar) {
+  // Sizes that exercise both whole SIMD groups and scalar remainders.
+  static const uint32 kSizes[][4] = {
+    // Source width and height, destination width and height.
+    { 67U, 33U, 20U, 13U },
+    { 64U, 64U, 32U, 32U },
+    { 33U, 17U, 70U, 40U },
+    { 1U, 9U, 5U, 3U },
+  };
+  const std::vector<SimdLevel> levels = GetSupportedLevels();
+  for (uint32 num_channels = 1U; num_channels <= 4U; ++num_channels) {
+    for (size_t s = 0; s < sizeof(kSizes) / sizeof(kSizes[0]); ++s) {
+      const uint32 width = kSizes[s][0];
+      const uint32 height = kSizes[s][1];
+      const std::vector<uint8> src =
+          CreatePixels(width, height, num_channels);
+
+      SetSimdLevel(kSimdScalar);
+      const std::vector<uint8> downsampled =
+          Downsample(src, width, height, num_channels);
+      const std::vector<uint8> boxed = Resample(
+          src, width, height, num_channels, kSizes[s][2], kSizes[s][3], true);
+      const std::vector<uint8> bilinear = Resample(
+          src, width, height, num_channels, kSizes[s][2], kSizes[s][3], false);
+      std::vector<uint8> unpremultiplied;
+      if (num_channels == 4U) {
+        unpremultiplied = src;
+        UnpremultiplyRgba8888(&unpremultiplied[0], width * height);
+      }
+
+      for (size_t i = 0; i < levels.size(); ++i) {
+        SCOPED_TRACE(::testing::Message()
+                     << GetSimdLevelName(levels[i]) << " size " << s
+                     << " channels " << num_channels);
+        SetSimdLevel(levels[i]);
+        EXPECT_EQ(downsampled, Downsample(src, width, height, num_channels));
+        EXPECT_EQ(boxed, Resample(src, width, height, num_channels,
+                                  kSizes[s][2], kSizes[s][3], true));
+        EXPECT_EQ(bilinear, Resample(src, width, height, num_channels,
+                                     kSizes[s][2], kSizes[s][3], false));
+        if (num_channels == 4U) {
+          std::vector<uint8> pixels = src;
+          UnpremultiplyRgba8888(&pixels[0], width * height);
+          EXPECT_EQ(unpremultiplied, pixels);
+        }
+      }
+    }
+  }
+  SetSimdLevel(GetSupportedSimdLevel());
+}
+
+TEST(ImageKernels, Filters) {
+  ResampleFilter filter;
+
+  // Every destination pixel of a box filter covers the same source area.
+  BuildBoxFilter(10U, 3U, &filter);
+  ASSERT_EQ(4U, filter.offsets.size());
+  EXPECT_EQ(4U, filter.max_taps);
+  for (size_t i = 0; i + 1U < filter.offsets.size(); ++i) {
+    float sum = 0.f;
+    for (uint32 tap = filter.offsets[i]; tap < filter.offsets[i + 1U]; ++tap)
+      sum += filter.weights[tap];
+    EXPECT_NEAR(1.f, sum, 1e-5f);
+  }
+  EXPECT_EQ(0U, filter.indices[0]);
+  EXPECT_EQ(9U, filter.indices.back());
+
+  // Bilinear taps are clamped to the image and merged at the edges.
+  BuildBilinearFilter(2U, 4U, &filter);
+  ASSERT_EQ(5U, filter.offsets.size());
+  EXPECT_EQ(2U, filter.max_taps);
+  EXPECT_EQ(1U, filter.offsets[1] - filter.offsets[0]);
+  EXPECT_EQ(0U, filter.indices[0]);
+  EXPECT_FLOAT_EQ(1.f, filter.weights[0]);
+  EXPECT_EQ(2U, filter.offsets[2] - filter.offsets[1]);
+  EXPECT_FLOAT_EQ(0.75f, filter.weights[filter.offsets[1]]);
+  EXPECT_FLOAT_EQ(0.25f, filter.weights[filter.offsets[1] + 1U]);
+
+  // Kaiser weights are normalized and symmetric away from the edges, and
+  // cover |width| destination pixels.
+  BuildKaiserFilter(32U, 16U, 3.f, 4.f, &filter);
+  ASSERT_EQ(17U, filter.offsets.size());
+  for (size_t i = 0; i + 1U < filter.offsets.size(); ++i) {
+    float sum = 0.f;
+    for (uint32 tap = filter.offsets[i]; tap < filter.offsets[i + 1U]; ++tap)
+      sum += filter.weights[tap];
+    EXPECT_NEAR(1.f, sum, 1e-5f);
+  }
+  const uint32 begin = filter.offsets[8];
+  const uint32 count = filter.offsets[9] - begin;
+  EXPECT_EQ(6U, count);
+  EXPECT_EQ(14U, filter.indices[begin]);
+  for (uint32 tap = 0; tap < count / 2U; ++tap) {
+    EXPECT_NEAR(filter.weights[begin + tap],
+                filter.weights[begin + count - 1U - tap], 1e-6f);
+  }
+  // The outer lobes are negative.
+  EXPECT_LT(filter.weights[begin], 0.f);
+}
+
+TEST(ImageKernels, KaiserClamps) {
+  // A single bright pixel at source x = 33 falls under a negative outer lobe of
+  // destination pixel 15, and a single dark pixel in a bright row makes the
+  // same pixel overshoot 255. Both must clamp at every SimdLevel.
+  static const uint32 kWidth = 64U;
+  static const uint32 kChannels = 4U;
+  ResampleFilter x_filter, y_filter;
+  BuildKaiserFilter(kWidth, kWidth / 2U, 3.f, 4.f, &x_filter);
+  BuildBilinearFilter(1U, 1U, &y_filter);
+  const std::vector<SimdLevel> levels = GetSupportedLevels();
+  for (int bright = 0; bright < 2; ++bright) {
+    const uint8 background = bright ? 255U : 0U;
+    std::vector<uint8> src(kWidth * kChannels, background);
+    for (uint32 chan = 0; chan < kChannels; ++chan)
+      src[33U * kChannels + chan] = static_cast<uint8>(255U - background);
+    for (size_t i = 0; i < levels.size(); ++i) {
+      SCOPED_TRACE(::testing::Message()
+                   << GetSimdLevelName(levels[i]) << " bright " << bright);
+      SetSimdLevel(levels[i]);
+      std::vector<uint8> dst(kWidth / 2U * kChannels);
+      Resample8bpcRows(&src[0], kWidth, kChannels, x_filter, y_filter,
+                       &dst[0], 0U, 1U);
+      for (uint32 chan = 0; chan < kChannels; ++chan)
+        EXPECT_EQ(background, dst[15U * kChannels + chan]);
+    }
+  }
+  SetSimdLevel(GetSupportedSimdLevel());
+}
+
+TEST(ImageKernels, Unpremultiply) {
+  uint8 pixels[] = {
+    0, 0, 0, 0,         10, 20, 30, 0,    64, 32, 0, 128,
+    255, 255, 255, 255, 100, 50, 25, 50,
+  };
+  UnpremultiplyRgba8888(pixels, 5U);
+  const uint8 expected[] = {
+    0, 0, 0, 0,         10, 20, 30, 0,    127, 63, 0, 128,
+    255, 255, 255, 255, 255, 255, 127, 50,
+  };
+  for (size_t i = 0; i < sizeof(expected); ++i)
+    EXPECT_EQ(expected[i], pixels[i]) << "byte " << i;
+}
+
+}  // namespace image
+}  // namespace ion
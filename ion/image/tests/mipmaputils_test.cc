@@ -0,0 +1,192 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/image/mipmaputils.h"
+
+#include <vector>
+
+#include "ion/base/datacontainer.h"
+#include "ion/base/logchecker.h"
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace image {
+
+namespace {
+
+using gfx::Image;
+using gfx::ImagePtr;
+
+// Creates an image with the passed format and size where every pixel has
+// the passed channel values.
+static const ImagePtr CreateSolidImage(Image::Format format, uint32 width,
+                                       uint32 height, const uint8* pixel) {
+  const size_t num_channels = Image::GetNumComponentsForFormat(format);
+  std::vector<uint8> data(Image::ComputeDataSize(format, width, height));
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = pixel[i % num_channels];
+  ImagePtr image(new Image);
+  image->Set(format, width, height,
+             base::DataContainer::CreateAndCopy<uint8>(&data[0], data.size(),
+                                                       false,
+                                                       image->GetAllocator()));
+  return image;
+}
+
+// Creates a |width| x |height| luminance checkerboard of 0 and 255 pixels.
+static const ImagePtr CreateCheckerboard(Image::Format format, uint32 width,
+                                         uint32 height) {
+  const size_t num_channels = Image::GetNumComponentsForFormat(format);
+  std::vector<uint8> data(Image::ComputeDataSize(format, width, height));
+  for (uint32 y = 0; y < height; ++y) {
+    for (uint32 x = 0; x < width; ++x) {
+      for (size_t chan = 0; chan < num_channels; ++chan)
+        data[(y * width + x) * num_channels + chan] = (x + y) & 1 ? 255 : 0;
+    }
+  }
+  ImagePtr image(new Image);
+  image->Set(format, width, height,
+             base::DataContainer::CreateAndCopy<uint8>(&data[0], data.size(),
+                                                       false,
+                                                       image->GetAllocator()));
+  return image;
+}
+
+static uint8 GetByte(const ImagePtr& image, size_t index) {
+  return image->GetData()->GetData<uint8>()[index];
+}
+
+}  // anonymous namespace
+
+TEST(MipmapUtils, LevelDimensions) {
+  const uint8 kPixel[] = { 10, 20, 30, 40 };
+  ImagePtr image = CreateSolidImage(Image::kRgba8888, 16, 4, kPixel);
+  std::vector<ImagePtr> chain =
+      BuildMipmapChain(image, MipmapOptions(), false, base::AllocatorPtr());
+  ASSERT_EQ(5U, chain.size());
+  EXPECT_EQ(image.Get(), chain[0].Get());
+  static const uint32 kWidths[] = { 16U, 8U, 4U, 2U, 1U };
+  static const uint32 kHeights[] = { 4U, 2U, 1U, 1U, 1U };
+  for (size_t i = 0; i < chain.size(); ++i) {
+    SCOPED_TRACE(i);
+    EXPECT_EQ(Image::kRgba8888, chain[i]->GetFormat());
+    EXPECT_EQ(kWidths[i], chain[i]->GetWidth());
+    EXPECT_EQ(kHeights[i], chain[i]->GetHeight());
+    // A solid image stays solid.
+    for (size_t byte = 0; byte < chain[i]->GetDataSize(); ++byte)
+      EXPECT_EQ(kPixel[byte % 4U], GetByte(chain[i], byte));
+  }
+
+  // Limit the number of levels.
+  MipmapOptions options;
+  options.max_level_count = 2U;
+  chain = BuildMipmapChain(image, options, false, base::AllocatorPtr());
+  EXPECT_EQ(2U, chain.size());
+
+  // Non-power-of-two images round down like OpenGL does.
+  image = CreateSolidImage(Image::kRgb888, 7, 3, kPixel);
+  chain = BuildMipmapChain(image, MipmapOptions(), false, base::AllocatorPtr());
+  ASSERT_EQ(3U, chain.size());
+  EXPECT_EQ(3U, chain[1]->GetWidth());
+  EXPECT_EQ(1U, chain[1]->GetHeight());
+  EXPECT_EQ(1U, chain[2]->GetWidth());
+  EXPECT_EQ(1U, chain[2]->GetHeight());
+  for (size_t byte = 0; byte < chain[2]->GetDataSize(); ++byte)
+    EXPECT_EQ(kPixel[byte % 3U], GetByte(chain[2], byte));
+}
+
+TEST(MipmapUtils, Filters) {
+  for (int filter = MipmapOptions::kBoxFilter;
+       filter <= MipmapOptions::kKaiserFilter; ++filter) {
+    SCOPED_TRACE(filter);
+    MipmapOptions options;
+    options.filter = static_cast<MipmapOptions::Filter>(filter);
+    // The Kaiser filter does not completely remove the highest frequency.
+    const int tolerance = filter == MipmapOptions::kBoxFilter ? 1 : 8;
+    // A checkerboard averages to mid-gray in linear space.
+    ImagePtr image = CreateCheckerboard(Image::kLuminance, 16, 16);
+    std::vector<ImagePtr> chain =
+        BuildMipmapChain(image, options, false, base::AllocatorPtr());
+    ASSERT_EQ(5U, chain.size());
+    for (size_t level = 1; level < chain.size(); ++level) {
+      for (size_t byte = 0; byte < chain[level]->GetDataSize(); ++byte)
+        EXPECT_NEAR(128, GetByte(chain[level], byte), tolerance);
+    }
+
+    // In sRGB space, mid-gray is 188.
+    options.srgb = true;
+    chain = BuildMipmapChain(image, options, false, base::AllocatorPtr());
+    ASSERT_EQ(5U, chain.size());
+    for (size_t level = 1; level < chain.size(); ++level) {
+      for (size_t byte = 0; byte < chain[level]->GetDataSize(); ++byte)
+        EXPECT_NEAR(188, GetByte(chain[level], byte), tolerance);
+    }
+  }
+
+  // sRGB formats are always filtered in linear space, except for alpha.
+  ImagePtr image = CreateCheckerboard(Image::kSrgba8, 4, 4);
+  std::vector<ImagePtr> chain =
+      BuildMipmapChain(image, MipmapOptions(), false, base::AllocatorPtr());
+  ASSERT_EQ(3U, chain.size());
+  EXPECT_EQ(188, GetByte(chain[2], 0));
+  EXPECT_EQ(188, GetByte(chain[2], 2));
+  EXPECT_EQ(128, GetByte(chain[2], 3));
+
+  // The box filter matches the 2x2 average for power-of-two images.
+  const uint8 kData[] = { 0, 10, 20, 31 };
+  image.Reset(new Image);
+  image->Set(Image::kLuminance, 2, 2,
+             base::DataContainer::CreateAndCopy<uint8>(kData, 4U, false,
+                                                       image->GetAllocator()));
+  chain = BuildMipmapChain(image, MipmapOptions(), false, base::AllocatorPtr());
+  ASSERT_EQ(2U, chain.size());
+  EXPECT_EQ(15, GetByte(chain[1], 0));
+}
+
+TEST(MipmapUtils, Unsupported) {
+  base::LogChecker log_checker;
+  EXPECT_TRUE(BuildMipmapChain(ImagePtr(), MipmapOptions(), false,
+                               base::AllocatorPtr()).empty());
+  EXPECT_FALSE(log_checker.HasAnyMessages());
+
+  const uint8 kPixel[] = { 0, 0, 0, 0 };
+  ImagePtr image = CreateSolidImage(Image::kRgba4444, 4, 4, kPixel);
+  EXPECT_TRUE(BuildMipmapChain(image, MipmapOptions(), false,
+                               base::AllocatorPtr()).empty());
+  EXPECT_TRUE(log_checker.HasMessage("WARNING", "not supported"));
+}
+
+TEST(MipmapUtils, SetMipmapChain) {
+  const uint8 kPixel[] = { 1, 2, 3, 4 };
+  ImagePtr image = CreateSolidImage(Image::kRgba8888, 8, 8, kPixel);
+  std::vector<ImagePtr> chain =
+      BuildMipmapChain(image, MipmapOptions(), false, base::AllocatorPtr());
+  ASSERT_EQ(4U, chain.size());
+
+  gfx::TexturePtr texture(new gfx::Texture);
+  EXPECT_FALSE(SetMipmapChain(chain, gfx::TexturePtr()));
+  EXPECT_FALSE(SetMipmapChain(std::vector<ImagePtr>(), texture));
+  texture->SetImage(5U, chain[3]);
+  EXPECT_TRUE(SetMipmapChain(chain, texture));
+  EXPECT_EQ(4U, texture->GetImageCount());
+  for (size_t level = 0; level < chain.size(); ++level)
+    EXPECT_EQ(chain[level].Get(), texture->GetImage(level).Get());
+  EXPECT_FALSE(texture->HasImage(5U));
+}
+
+}  // namespace image
+}  // namespace ion
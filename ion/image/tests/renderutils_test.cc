@@ -18,9 +18,11 @@ limitations under the License.
 #include "ion/image/renderutils.h"
 
 #include <memory>
+#include <vector>
 
 #include "base/integral_types.h"
 #include "ion/base/datacontainer.h"
+#include "ion/base/taskscheduler.h"
 #include "ion/gfx/image.h"
 #include "ion/gfx/renderer.h"
 #include "ion/gfx/sampler.h"
@@ -268,5 +270,42 @@ TEST_F(RenderUtilsTest, RenderCubeMapTextureFaceImageValid) {
 
 #endif  // !ION_PRODUCTION
 
+TEST_F(RenderUtilsTest, BuildExternalImageReadCallback) {
+  base::TaskScheduler scheduler(1U);
+  base::TaskScheduler::TaskGroup group(&scheduler);
+  std::vector<uint8> png;
+  size_t count = 0;
+  const gfx::Renderer::ReadImageCallback callback =
+      BuildExternalImageReadCallback(
+          kPng, true,
+          [&png, &count](const std::vector<uint8>& data) {
+            png = data;
+            ++count;
+          },
+          &group);
+
+  renderer_->ReadImageAsync(
+      math::Range2i::BuildWithSize(math::Point2i(0, 0),
+                                   math::Vector2i(16, 8)),
+      gfx::Image::kRgb888,
+      base::AllocationManager::GetDefaultAllocatorForLifetime(
+          base::kShortTerm),
+      callback);
+  renderer_->ProcessAsyncImageReads(true);
+  group.Wait();
+  EXPECT_EQ(1U, count);
+  ASSERT_LT(4U, png.size());
+  EXPECT_EQ(0x89, png[0]);
+  EXPECT_EQ('P', png[1]);
+  EXPECT_EQ('N', png[2]);
+  EXPECT_EQ('G', png[3]);
+
+  // A failed read produces no data.
+  callback(gfx::ImagePtr());
+  group.Wait();
+  EXPECT_EQ(2U, count);
+  EXPECT_TRUE(png.empty());
+}
+
 }  // namespace image
 }  // namespace ion
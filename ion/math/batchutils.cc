@@ -0,0 +1,529 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/math/batchutils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "ion/base/logging.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define ION_MATH_BATCH_SSE2 1
+#  include <emmintrin.h>
+// AVX versions are compiled with a target attribute and selected at run time,
+// which requires GCC or Clang. Other compilers only use AVX when the whole
+// build targets it.
+#  if defined(__GNUC__) || defined(__clang__)
+#    define ION_TARGET_AVX __attribute__((target("avx")))
+#  elif defined(__AVX__)
+#    define ION_TARGET_AVX
+#  endif
+#  if defined(ION_TARGET_AVX)
+#    define ION_MATH_BATCH_AVX 1
+#    include <immintrin.h>
+#  endif
+#endif
+
+namespace ion {
+namespace math {
+
+namespace {
+
+static BatchInstructionSet DetectBatchInstructionSet() {
+#if defined(ION_MATH_BATCH_AVX)
+#  if defined(__GNUC__) || defined(__clang__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx"))
+    return kBatchAvx;
+#  else
+  return kBatchAvx;
+#  endif
+#endif
+#if defined(ION_MATH_BATCH_SSE2)
+  return kBatchSse2;
+#else
+  return kBatchScalar;
+#endif
+}
+
+static std::atomic<int>& GetBatchInstructionSetStorage() {
+  static std::atomic<int> instruction_set(DetectBatchInstructionSet());
+  return instruction_set;
+}
+
+static bool IsBatchInstructionSetSupported(BatchInstructionSet set) {
+  const BatchInstructionSet supported = GetSupportedBatchInstructionSet();
+  switch (set) {
+    case kBatchScalar:
+      return true;
+    case kBatchSse2:
+      return supported == kBatchSse2 || supported == kBatchAvx;
+    case kBatchAvx:
+      return supported == kBatchAvx;
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+// Internal operation sets. Each kernel in batchkernels.inc is written once in
+// terms of an Ops struct that wraps loads, stores and arithmetic on kWidth
+// values at a time. ScalarOps handles one value at a time and is used for the
+// elements left over after the packed loop as well as when no SIMD
+// instruction set is available.
+//-----------------------------------------------------------------------------
+
+template <typename T>
+struct ScalarOps {
+  typedef T Type;
+  static const size_t kWidth = 1U;
+  static Type Load(const T* p) { return *p; }
+  static void Store(T* p, Type v) { *p = v; }
+  static Type Set(T v) { return v; }
+  static Type Add(Type a, Type b) { return a + b; }
+  static Type Sub(Type a, Type b) { return a - b; }
+  static Type Mul(Type a, Type b) { return a * b; }
+  static Type Sqrt(Type a) { return std::sqrt(a); }
+  // Returns a / b where b is positive, and 0 elsewhere.
+  static Type DivIfPositive(Type a, Type b) {
+    return b > static_cast<T>(0) ? a / b : static_cast<T>(0);
+  }
+};
+
+#if defined(ION_MATH_BATCH_SSE2)
+
+template <typename T> struct Sse2Ops;
+
+template <>
+struct Sse2Ops<float> {
+  typedef __m128 Type;
+  static const size_t kWidth = 4U;
+  static Type Load(const float* p) { return _mm_loadu_ps(p); }
+  static void Store(float* p, Type v) { _mm_storeu_ps(p, v); }
+  static Type Set(float v) { return _mm_set1_ps(v); }
+  static Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+  static Type Sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+  static Type Mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+  static Type Sqrt(Type a) { return _mm_sqrt_ps(a); }
+  static Type DivIfPositive(Type a, Type b) {
+    const Type positive = _mm_cmpgt_ps(b, _mm_setzero_ps());
+    return _mm_and_ps(_mm_div_ps(a, b), positive);
+  }
+};
+
+template <>
+struct Sse2Ops<double> {
+  typedef __m128d Type;
+  static const size_t kWidth = 2U;
+  static Type Load(const double* p) { return _mm_loadu_pd(p); }
+  static void Store(double* p, Type v) { _mm_storeu_pd(p, v); }
+  static Type Set(double v) { return _mm_set1_pd(v); }
+  static Type Add(Type a, Type b) { return _mm_add_pd(a, b); }
+  static Type Sub(Type a, Type b) { return _mm_sub_pd(a, b); }
+  static Type Mul(Type a, Type b) { return _mm_mul_pd(a, b); }
+  static Type Sqrt(Type a) { return _mm_sqrt_pd(a); }
+  static Type DivIfPositive(Type a, Type b) {
+    const Type positive = _mm_cmpgt_pd(b, _mm_setzero_pd());
+    return _mm_and_pd(_mm_div_pd(a, b), positive);
+  }
+};
+
+#endif
+
+#if defined(ION_MATH_BATCH_AVX)
+
+template <typename T> struct AvxOps;
+
+template <>
+struct AvxOps<float> {
+  typedef __m256 Type;
+  static const size_t kWidth = 8U;
+  ION_TARGET_AVX static Type Load(const float* p) {
+    return _mm256_loadu_ps(p);
+  }
+  ION_TARGET_AVX static void Store(float* p, Type v) {
+    _mm256_storeu_ps(p, v);
+  }
+  ION_TARGET_AVX static Type Set(float v) { return _mm256_set1_ps(v); }
+  ION_TARGET_AVX static Type Add(Type a, Type b) {
+    return _mm256_add_ps(a, b);
+  }
+  ION_TARGET_AVX static Type Sub(Type a, Type b) {
+    return _mm256_sub_ps(a, b);
+  }
+  ION_TARGET_AVX static Type Mul(Type a, Type b) {
+    return _mm256_mul_ps(a, b);
+  }
+  ION_TARGET_AVX static Type Sqrt(Type a) { return _mm256_sqrt_ps(a); }
+  ION_TARGET_AVX static Type DivIfPositive(Type a, Type b) {
+    const Type positive = _mm256_cmp_ps(b, _mm256_setzero_ps(), _CMP_GT_OQ);
+    return _mm256_and_ps(_mm256_div_ps(a, b), positive);
+  }
+};
+
+template <>
+struct AvxOps<double> {
+  typedef __m256d Type;
+  static const size_t kWidth = 4U;
+  ION_TARGET_AVX static Type Load(const double* p) {
+    return _mm256_loadu_pd(p);
+  }
+  ION_TARGET_AVX static void Store(double* p, Type v) {
+    _mm256_storeu_pd(p, v);
+  }
+  ION_TARGET_AVX static Type Set(double v) { return _mm256_set1_pd(v); }
+  ION_TARGET_AVX static Type Add(Type a, Type b) {
+    return _mm256_add_pd(a, b);
+  }
+  ION_TARGET_AVX static Type Sub(Type a, Type b) {
+    return _mm256_sub_pd(a, b);
+  }
+  ION_TARGET_AVX static Type Mul(Type a, Type b) {
+    return _mm256_mul_pd(a, b);
+  }
+  ION_TARGET_AVX static Type Sqrt(Type a) { return _mm256_sqrt_pd(a); }
+  ION_TARGET_AVX static Type DivIfPositive(Type a, Type b) {
+    const Type positive = _mm256_cmp_pd(b, _mm256_setzero_pd(), _CMP_GT_OQ);
+    return _mm256_and_pd(_mm256_div_pd(a, b), positive);
+  }
+};
+
+#endif
+
+//-----------------------------------------------------------------------------
+// SoA kernels. The kernels are compiled without target attributes for
+// ScalarOps and Sse2Ops, and again in the avx namespace with AVX enabled for
+// AvxOps, so that the AVX operations can be inlined into them.
+//-----------------------------------------------------------------------------
+
+#define ION_BATCH_TARGET
+#include "ion/math/batchkernels.inc"
+#undef ION_BATCH_TARGET
+
+#if defined(ION_MATH_BATCH_AVX)
+namespace avx {
+#define ION_BATCH_TARGET ION_TARGET_AVX
+#include "ion/math/batchkernels.inc"
+#undef ION_BATCH_TARGET
+}  // namespace avx
+#endif
+
+// Each of these runs a kernel with the packed operations of the selected
+// BatchInstructionSet from the first element, and returns the index of the
+// first element it did not process. The caller processes the rest with
+// ScalarOps.
+template <typename T, int Dimension>
+static size_t TransformPacked(const Matrix<Dimension, T>& m, bool is_point,
+                              const T* x, const T* y, const T* z,
+                              size_t count, T* result_x, T* result_y,
+                              T* result_z) {
+#if defined(ION_MATH_BATCH_SSE2)
+  const BatchInstructionSet instruction_set = GetBatchInstructionSet();
+#  if defined(ION_MATH_BATCH_AVX)
+  if (instruction_set == kBatchAvx)
+    return avx::TransformKernel<AvxOps<T> >(m, is_point, x, y, z, 0U, count,
+                                            result_x, result_y, result_z);
+#  endif
+  if (instruction_set == kBatchSse2)
+    return TransformKernel<Sse2Ops<T> >(m, is_point, x, y, z, 0U, count,
+                                        result_x, result_y, result_z);
+#endif
+  return 0U;
+}
+
+template <typename T>
+static size_t NormalizePacked(const T* x, const T* y, const T* z,
+                              size_t count, T* result_x, T* result_y,
+                              T* result_z) {
+#if defined(ION_MATH_BATCH_SSE2)
+  const BatchInstructionSet instruction_set = GetBatchInstructionSet();
+#  if defined(ION_MATH_BATCH_AVX)
+  if (instruction_set == kBatchAvx)
+    return avx::NormalizeKernel<AvxOps<T> >(x, y, z, 0U, count, result_x,
+                                            result_y, result_z);
+#  endif
+  if (instruction_set == kBatchSse2)
+    return NormalizeKernel<Sse2Ops<T> >(x, y, z, 0U, count, result_x,
+                                        result_y, result_z);
+#endif
+  return 0U;
+}
+
+template <typename T>
+static size_t CrossPacked(const T* x0, const T* y0, const T* z0, const T* x1,
+                          const T* y1, const T* z1, size_t count, T* result_x,
+                          T* result_y, T* result_z) {
+#if defined(ION_MATH_BATCH_SSE2)
+  const BatchInstructionSet instruction_set = GetBatchInstructionSet();
+#  if defined(ION_MATH_BATCH_AVX)
+  if (instruction_set == kBatchAvx)
+    return avx::CrossKernel<AvxOps<T> >(x0, y0, z0, x1, y1, z1, 0U, count,
+                                        result_x, result_y, result_z);
+#  endif
+  if (instruction_set == kBatchSse2)
+    return CrossKernel<Sse2Ops<T> >(x0, y0, z0, x1, y1, z1, 0U, count,
+                                    result_x, result_y, result_z);
+#endif
+  return 0U;
+}
+
+template <typename T>
+static size_t LengthSquaredPacked(const T* x, const T* y, const T* z,
+                                  size_t count, T* results) {
+#if defined(ION_MATH_BATCH_SSE2)
+  const BatchInstructionSet instruction_set = GetBatchInstructionSet();
+#  if defined(ION_MATH_BATCH_AVX)
+  if (instruction_set == kBatchAvx)
+    return avx::LengthSquaredKernel<AvxOps<T> >(x, y, z, 0U, count, results);
+#  endif
+  if (instruction_set == kBatchSse2)
+    return LengthSquaredKernel<Sse2Ops<T> >(x, y, z, 0U, count, results);
+#endif
+  return 0U;
+}
+
+//-----------------------------------------------------------------------------
+// AoS helpers. AoS arrays are converted to SoA in chunks that fit on the
+// stack, processed with the SoA kernels, and converted back.
+//-----------------------------------------------------------------------------
+
+static const size_t kChunkSize = 128U;
+
+// Copies the coordinates of |count| Vectors or Points starting at |in| into
+// separate arrays. Vectors and Points store their coordinates contiguously, so
+// this reads them as a flat array, which compilers can vectorize.
+template <typename VectorType, typename T>
+static void Deinterleave(const VectorType* in, size_t count, T* x, T* y,
+                         T* z) {
+  static_assert(sizeof(VectorType) == 3 * sizeof(T),
+                "Vector coordinates are not contiguous");
+  const T* coords = in->Data();
+  for (size_t i = 0; i < count; ++i) {
+    x[i] = coords[3 * i];
+    y[i] = coords[3 * i + 1];
+    z[i] = coords[3 * i + 2];
+  }
+}
+
+// Copies |count| coordinates from separate arrays into Vectors or Points.
+template <typename VectorType, typename T>
+static void Interleave(const T* x, const T* y, const T* z, size_t count,
+                       VectorType* out) {
+  static_assert(sizeof(VectorType) == 3 * sizeof(T),
+                "Vector coordinates are not contiguous");
+  T* coords = out->Data();
+  for (size_t i = 0; i < count; ++i) {
+    coords[3 * i] = x[i];
+    coords[3 * i + 1] = y[i];
+    coords[3 * i + 2] = z[i];
+  }
+}
+
+// Transforms AoS Points or Vectors.
+template <typename VectorType, typename T, int Dimension>
+static void TransformAos(const Matrix<Dimension, T>& m, bool is_point,
+                         const VectorType* in, size_t count,
+                         VectorType* out) {
+  DCHECK(count == 0 || (in && out));
+  T x[kChunkSize], y[kChunkSize], z[kChunkSize];
+  for (size_t begin = 0; begin < count; begin += kChunkSize) {
+    const size_t n = std::min(kChunkSize, count - begin);
+    Deinterleave(in + begin, n, x, y, z);
+    const size_t i = TransformPacked(m, is_point, x, y, z, n, x, y, z);
+    TransformKernel<ScalarOps<T> >(m, is_point, x, y, z, i, n, x, y, z);
+    Interleave(x, y, z, n, out + begin);
+  }
+}
+
+}  // anonymous namespace
+
+//-----------------------------------------------------------------------------
+// Public functions.
+//-----------------------------------------------------------------------------
+
+template <typename T>
+void TransformPoints(const Matrix<4, T>& m, const Point<3, T>* points,
+                     size_t count, Point<3, T>* results) {
+  TransformAos(m, true, points, count, results);
+}
+
+template <typename T>
+void TransformPointsSoa(const Matrix<4, T>& m, const T* x, const T* y,
+                        const T* z, size_t count, T* result_x, T* result_y,
+                        T* result_z) {
+  const size_t i =
+      TransformPacked(m, true, x, y, z, count, result_x, result_y, result_z);
+  TransformKernel<ScalarOps<T> >(m, true, x, y, z, i, count, result_x,
+                                 result_y, result_z);
+}
+
+template <typename T>
+void TransformVectors(const Matrix<3, T>& m, const Vector<3, T>* vectors,
+                      size_t count, Vector<3, T>* results) {
+  TransformAos(m, false, vectors, count, results);
+}
+
+template <typename T>
+void TransformVectorsSoa(const Matrix<3, T>& m, const T* x, const T* y,
+                         const T* z, size_t count, T* result_x, T* result_y,
+                         T* result_z) {
+  const size_t i =
+      TransformPacked(m, false, x, y, z, count, result_x, result_y, result_z);
+  TransformKernel<ScalarOps<T> >(m, false, x, y, z, i, count, result_x,
+                                 result_y, result_z);
+}
+
+template <typename T>
+void NormalizeVectors(const Vector<3, T>* vectors, size_t count,
+                      Vector<3, T>* results) {
+  DCHECK(count == 0 || (vectors && results));
+  T x[kChunkSize], y[kChunkSize], z[kChunkSize];
+  for (size_t begin = 0; begin < count; begin += kChunkSize) {
+    const size_t n = std::min(kChunkSize, count - begin);
+    Deinterleave(vectors + begin, n, x, y, z);
+    NormalizeVectorsSoa(x, y, z, n, x, y, z);
+    Interleave(x, y, z, n, results + begin);
+  }
+}
+
+template <typename T>
+void NormalizeVectorsSoa(const T* x, const T* y, const T* z, size_t count,
+                         T* result_x, T* result_y, T* result_z) {
+  const size_t i =
+      NormalizePacked(x, y, z, count, result_x, result_y, result_z);
+  NormalizeKernel<ScalarOps<T> >(x, y, z, i, count, result_x, result_y,
+                                 result_z);
+}
+
+template <typename T>
+void CrossVectors(const Vector<3, T>* v0, const Vector<3, T>* v1,
+                  size_t count, Vector<3, T>* results) {
+  DCHECK(count == 0 || (v0 && v1 && results));
+  // A cross product is too cheap to pay for converting to SoA and back, so
+  // this is a plain loop over the coordinates.
+  for (size_t i = 0; i < count; ++i) {
+    const T* a = v0[i].Data();
+    const T* b = v1[i].Data();
+    const T x = a[1] * b[2] - a[2] * b[1];
+    const T y = a[2] * b[0] - a[0] * b[2];
+    const T z = a[0] * b[1] - a[1] * b[0];
+    results[i].Set(x, y, z);
+  }
+}
+
+template <typename T>
+void CrossVectorsSoa(const T* x0, const T* y0, const T* z0, const T* x1,
+                     const T* y1, const T* z1, size_t count, T* result_x,
+                     T* result_y, T* result_z) {
+  const size_t i = CrossPacked(x0, y0, z0, x1, y1, z1, count, result_x,
+                               result_y, result_z);
+  CrossKernel<ScalarOps<T> >(x0, y0, z0, x1, y1, z1, i, count, result_x,
+                             result_y, result_z);
+}
+
+template <typename T>
+void LengthsSquared(const Vector<3, T>* vectors, size_t count, T* results) {
+  DCHECK(count == 0 || (vectors && results));
+  // As with CrossVectors(), converting to SoA costs more than it saves.
+  for (size_t i = 0; i < count; ++i) {
+    const T* v = vectors[i].Data();
+    results[i] = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+  }
+}
+
+template <typename T>
+void LengthsSquaredSoa(const T* x, const T* y, const T* z, size_t count,
+                       T* results) {
+  const size_t i = LengthSquaredPacked(x, y, z, count, results);
+  LengthSquaredKernel<ScalarOps<T> >(x, y, z, i, count, results);
+}
+
+BatchInstructionSet GetSupportedBatchInstructionSet() {
+  static const BatchInstructionSet instruction_set =
+      DetectBatchInstructionSet();
+  return instruction_set;
+}
+
+void SetBatchInstructionSet(BatchInstructionSet instruction_set) {
+  GetBatchInstructionSetStorage().store(
+      IsBatchInstructionSetSupported(instruction_set) ? instruction_set
+                                                      : kBatchScalar);
+}
+
+BatchInstructionSet GetBatchInstructionSet() {
+  return static_cast<BatchInstructionSet>(
+      GetBatchInstructionSetStorage().load());
+}
+
+const char* GetBatchInstructionSetName(BatchInstructionSet instruction_set) {
+  switch (instruction_set) {
+    case kBatchScalar:
+      return "Scalar";
+    case kBatchSse2:
+      return "SSE2";
+    case kBatchAvx:
+      return "AVX";
+  }
+  return "Unknown";
+}
+
+//
+// Explicitly instantiate all of these for all supported types.
+//
+
+#define ION_INSTANTIATE_BATCH_FUNCS(type)                                    \
+template void ION_API TransformPoints(const Matrix<4, type>& m,              \
+                                      const Point<3, type>* points,          \
+                                      size_t count, Point<3, type>* results); \
+template void ION_API TransformPointsSoa(                                     \
+    const Matrix<4, type>& m, const type* x, const type* y, const type* z,   \
+    size_t count, type* result_x, type* result_y, type* result_z);           \
+template void ION_API TransformVectors(const Matrix<3, type>& m,             \
+                                       const Vector<3, type>* vectors,       \
+                                       size_t count,                         \
+                                       Vector<3, type>* results);            \
+template void ION_API TransformVectorsSoa(                                   \
+    const Matrix<3, type>& m, const type* x, const type* y, const type* z,   \
+    size_t count, type* result_x, type* result_y, type* result_z);           \
+template void ION_API NormalizeVectors(const Vector<3, type>* vectors,       \
+                                       size_t count,                         \
+                                       Vector<3, type>* results);            \
+template void ION_API NormalizeVectorsSoa(                                   \
+    const type* x, const type* y, const type* z, size_t count,               \
+    type* result_x, type* result_y, type* result_z);                         \
+template void ION_API CrossVectors(const Vector<3, type>* v0,                \
+                                   const Vector<3, type>* v1, size_t count,  \
+                                   Vector<3, type>* results);                \
+template void ION_API CrossVectorsSoa(                                       \
+    const type* x0, const type* y0, const type* z0, const type* x1,          \
+    const type* y1, const type* z1, size_t count, type* result_x,            \
+    type* result_y, type* result_z);                                         \
+template void ION_API LengthsSquared(const Vector<3, type>* vectors,         \
+                                     size_t count, type* results);           \
+template void ION_API LengthsSquaredSoa(const type* x, const type* y,        \
+                                        const type* z, size_t count,         \
+                                        type* results)
+
+ION_INSTANTIATE_BATCH_FUNCS(float);
+ION_INSTANTIATE_BATCH_FUNCS(double);
+
+#undef ION_INSTANTIATE_BATCH_FUNCS
+
+}  // namespace math
+}  // namespace ion
@@ -0,0 +1,143 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef ION_MATH_BATCHUTILS_H_
+#define ION_MATH_BATCHUTILS_H_
+
+//
+// This file contains free functions that apply the operations in
+// vectorutils.h and transformutils.h to arrays of Vectors and Points at once.
+// They produce the same results as calling the single-element versions in a
+// loop (up to floating-point rounding), but process several elements per
+// instruction with SSE2 or AVX when the CPU supports them.
+//
+// Each function comes in two variants. The array-of-structures (AoS) variant
+// takes arrays of Points or Vectors. The structure-of-arrays (SoA) variant
+// takes a separate array for each coordinate, which avoids shuffling
+// coordinates in and out of SIMD registers and is the fastest choice for data
+// that is already stored that way. The AoS variants of the cheapest operations
+// (CrossVectors() and LengthsSquared()) are plain loops, since converting to
+// SoA would cost more than it saves. In both variants the results may be
+// written over the inputs, but must not otherwise overlap them.
+//
+// The functions are defined for float and double.
+//
+
+#include <cstddef>
+
+#include "ion/math/matrix.h"
+#include "ion/math/vector.h"
+
+namespace ion {
+namespace math {
+
+//-----------------------------------------------------------------------------
+// Transforms.
+//-----------------------------------------------------------------------------
+
+// Multiplies each of the |count| Points by the Matrix as operator*() in
+// transformutils.h does, i.e., including translation but without a projective
+// divide, and stores them in |results|.
+template <typename T> ION_API
+void TransformPoints(const Matrix<4, T>& m, const Point<3, T>* points,
+                     size_t count, Point<3, T>* results);
+
+// SoA variant of TransformPoints().
+template <typename T> ION_API
+void TransformPointsSoa(const Matrix<4, T>& m, const T* x, const T* y,
+                        const T* z, size_t count, T* result_x, T* result_y,
+                        T* result_z);
+
+// Multiplies each of the |count| Vectors by the Matrix as operator*() in
+// matrixutils.h does and stores them in |results|.
+template <typename T> ION_API
+void TransformVectors(const Matrix<3, T>& m, const Vector<3, T>* vectors,
+                      size_t count, Vector<3, T>* results);
+
+// SoA variant of TransformVectors().
+template <typename T> ION_API
+void TransformVectorsSoa(const Matrix<3, T>& m, const T* x, const T* y,
+                         const T* z, size_t count, T* result_x, T* result_y,
+                         T* result_z);
+
+//-----------------------------------------------------------------------------
+// Vector operations.
+//-----------------------------------------------------------------------------
+
+// Stores a unit-length version of each of the |count| Vectors in |results|.
+// As with Normalized(), Vectors with no length produce Zero() Vectors.
+template <typename T> ION_API
+void NormalizeVectors(const Vector<3, T>* vectors, size_t count,
+                      Vector<3, T>* results);
+
+// SoA variant of NormalizeVectors().
+template <typename T> ION_API
+void NormalizeVectorsSoa(const T* x, const T* y, const T* z, size_t count,
+                         T* result_x, T* result_y, T* result_z);
+
+// Stores the cross product of each pair of the |count| Vectors in |v0| and
+// |v1| in |results|.
+template <typename T> ION_API
+void CrossVectors(const Vector<3, T>* v0, const Vector<3, T>* v1,
+                  size_t count, Vector<3, T>* results);
+
+// SoA variant of CrossVectors().
+template <typename T> ION_API
+void CrossVectorsSoa(const T* x0, const T* y0, const T* z0, const T* x1,
+                     const T* y1, const T* z1, size_t count, T* result_x,
+                     T* result_y, T* result_z);
+
+// Stores the squared length of each of the |count| Vectors in |results|.
+template <typename T> ION_API
+void LengthsSquared(const Vector<3, T>* vectors, size_t count, T* results);
+
+// SoA variant of LengthsSquared().
+template <typename T> ION_API
+void LengthsSquaredSoa(const T* x, const T* y, const T* z, size_t count,
+                       T* results);
+
+//-----------------------------------------------------------------------------
+// Instruction sets.
+//-----------------------------------------------------------------------------
+
+// The instruction sets that the functions in this file can use.
+enum BatchInstructionSet {
+  kBatchScalar,
+  kBatchSse2,
+  kBatchAvx,
+};
+
+// Returns the best BatchInstructionSet supported by the CPU. AVX support is
+// detected at run time when compiling with GCC or Clang, so it does not require
+// the whole build to target AVX.
+ION_API BatchInstructionSet GetSupportedBatchInstructionSet();
+
+// Sets/returns the BatchInstructionSet used by the functions in this file,
+// which is the supported one by default. Setting one that the CPU does not
+// support selects kBatchScalar. This is mostly useful for testing and
+// benchmarking.
+ION_API void SetBatchInstructionSet(BatchInstructionSet instruction_set);
+ION_API BatchInstructionSet GetBatchInstructionSet();
+
+// Returns a string name for a BatchInstructionSet, e.g., "AVX".
+ION_API const char* GetBatchInstructionSetName(
+    BatchInstructionSet instruction_set);
+
+}  // namespace math
+}  // namespace ion
+
+#endif  // ION_MATH_BATCHUTILS_H_
@@ -31,6 +31,9 @@
       'sources' : [
         'angle.h',
         'angleutils.h',
+        'batchkernels.inc',
+        'batchutils.cc',
+        'batchutils.h',
         'fieldofview.h',
         'matrix.h',
         'matrixutils.cc',
@@ -0,0 +1,160 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+// Benchmarks the batched functions in batchutils.h against loops over the
+// single-element templates in vectorutils.h and transformutils.h, for float
+// and double in both AoS and SoA layouts. This is built as a separate target
+// so that it does not slow down the regular tests; the results are printed to
+// stdout in millions of elements per second.
+
+#include <functional>
+#include <iostream>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "ion/analytics/benchmark.h"
+#include "ion/analytics/benchmarkutils.h"
+#include "ion/math/batchutils.h"
+#include "ion/math/transformutils.h"
+#include "ion/math/vectorutils.h"
+#include "ion/port/timer.h"
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace math {
+
+namespace {
+
+using analytics::Benchmark;
+
+static const size_t kCount = 1U << 16;
+static const int kIterations = 20;
+
+// Runs |func| kIterations times and adds the number of elements processed per
+// second to |benchmark|.
+static void Measure(const std::string& name, const std::string& group,
+                    const std::function<void()>& func,
+                    Benchmark* benchmark) {
+  Benchmark::VariableAccumulator accumulator(Benchmark::Descriptor(
+      name, group, "Throughput of " + name, "Melements/s"));
+  // Warm up caches.
+  func();
+  for (int i = 0; i < kIterations; ++i) {
+    port::Timer timer;
+    func();
+    const double seconds = timer.GetInS();
+    if (seconds > 0.0)
+      accumulator.AddSample(static_cast<double>(kCount) / seconds * 1e-6);
+  }
+  benchmark->AddAccumulatedVariable(accumulator.Get());
+}
+
+template <typename T>
+static void MeasureType(const std::string& type_name, Benchmark* benchmark) {
+  typedef Vector<3, T> Vector3;
+  typedef Point<3, T> Point3;
+  const Matrix<4, T> m =
+      TranslationMatrix(Vector3(1, -2, 3)) *
+      RotationMatrixAxisAngleH(Vector3(1, 2, 3),
+                               Angle<T>::FromDegrees(static_cast<T>(40)));
+
+  std::vector<Point3> points(kCount);
+  std::vector<Vector3> vectors(kCount), other_vectors(kCount);
+  std::vector<T> x(kCount), y(kCount), z(kCount);
+  for (size_t i = 0; i < kCount; ++i) {
+    const T t = static_cast<T>(i);
+    vectors[i].Set(t, t * static_cast<T>(0.5), static_cast<T>(1) - t);
+    other_vectors[i].Set(static_cast<T>(1) - t, t, t * static_cast<T>(2));
+    points[i] = Point3::Zero() + vectors[i];
+    x[i] = vectors[i][0];
+    y[i] = vectors[i][1];
+    z[i] = vectors[i][2];
+  }
+  std::vector<Point3> point_results(kCount);
+  std::vector<Vector3> vector_results(kCount);
+  std::vector<T> rx(kCount), ry(kCount), rz(kCount), scalar_results(kCount);
+
+  const std::string transform = "TransformPoints" + type_name;
+  Measure(transform + " Scalar", transform, [&]() {
+    for (size_t i = 0; i < kCount; ++i)
+      point_results[i] = m * points[i];
+  }, benchmark);
+  Measure(transform + " AoS", transform, [&]() {
+    TransformPoints(m, points.data(), kCount, point_results.data());
+  }, benchmark);
+  Measure(transform + " SoA", transform, [&]() {
+    TransformPointsSoa(m, x.data(), y.data(), z.data(), kCount, rx.data(),
+                       ry.data(), rz.data());
+  }, benchmark);
+
+  const std::string normalize = "NormalizeVectors" + type_name;
+  Measure(normalize + " Scalar", normalize, [&]() {
+    for (size_t i = 0; i < kCount; ++i)
+      vector_results[i] = Normalized(vectors[i]);
+  }, benchmark);
+  Measure(normalize + " AoS", normalize, [&]() {
+    NormalizeVectors(vectors.data(), kCount, vector_results.data());
+  }, benchmark);
+  Measure(normalize + " SoA", normalize, [&]() {
+    NormalizeVectorsSoa(x.data(), y.data(), z.data(), kCount, rx.data(),
+                        ry.data(), rz.data());
+  }, benchmark);
+
+  const std::string cross = "CrossVectors" + type_name;
+  Measure(cross + " Scalar", cross, [&]() {
+    for (size_t i = 0; i < kCount; ++i)
+      vector_results[i] = Cross(vectors[i], other_vectors[i]);
+  }, benchmark);
+  Measure(cross + " AoS", cross, [&]() {
+    CrossVectors(vectors.data(), other_vectors.data(), kCount,
+                 vector_results.data());
+  }, benchmark);
+  Measure(cross + " SoA", cross, [&]() {
+    CrossVectorsSoa(x.data(), y.data(), z.data(), z.data(), x.data(),
+                    y.data(), kCount, rx.data(), ry.data(), rz.data());
+  }, benchmark);
+
+  const std::string length = "LengthsSquared" + type_name;
+  Measure(length + " Scalar", length, [&]() {
+    for (size_t i = 0; i < kCount; ++i)
+      scalar_results[i] = LengthSquared(vectors[i]);
+  }, benchmark);
+  Measure(length + " AoS", length, [&]() {
+    LengthsSquared(vectors.data(), kCount, scalar_results.data());
+  }, benchmark);
+  Measure(length + " SoA", length, [&]() {
+    LengthsSquaredSoa(x.data(), y.data(), z.data(), kCount,
+                      scalar_results.data());
+  }, benchmark);
+}
+
+}  // anonymous namespace
+
+TEST(BatchUtilsBenchmark, ElementsPerSecond) {
+  Benchmark benchmark;
+  MeasureType<float>("f", &benchmark);
+  MeasureType<double>("d", &benchmark);
+  analytics::OutputBenchmarkPretty(
+      std::string("Batched math (") +
+          GetBatchInstructionSetName(GetBatchInstructionSet()) + ")",
+      false,
+      benchmark, std::cout);
+  EXPECT_FALSE(benchmark.GetAccumulatedVariables().empty());
+}
+
+}  // namespace math
+}  // namespace ion
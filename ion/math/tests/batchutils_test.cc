@@ -0,0 +1,257 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/math/batchutils.h"
+
+#include <limits>
+#include <vector>
+
+#include "ion/math/matrixutils.h"
+#include "ion/math/transformutils.h"
+#include "ion/math/vectorutils.h"
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace math {
+
+namespace {
+
+// The element counts to test, which cover empty arrays, partial SIMD steps and
+// more than one internal chunk.
+static const size_t kCounts[] = { 0U, 1U, 3U, 7U, 16U, 130U, 301U };
+
+// Returns a tolerance that allows for rounding differences in values up to
+// about 100.
+template <typename T>
+static T GetTolerance() {
+  return std::numeric_limits<T>::epsilon() * static_cast<T>(1000);
+}
+
+// Returns |count| Vectors with repeatable pseudo-random coordinates in
+// [-100, 100]. Every seventh Vector is zero.
+template <typename T>
+static const std::vector<Vector<3, T> > BuildVectors(size_t count,
+                                                     uint32 seed) {
+  std::vector<Vector<3, T> > vectors(count);
+  for (size_t i = 0; i < count; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      seed = seed * 1103515245U + 12345U;
+      vectors[i][j] = i % 7U == 6U ? static_cast<T>(0) :
+          static_cast<T>((seed >> 8) % 20001U) / static_cast<T>(100) -
+          static_cast<T>(100);
+    }
+  }
+  return vectors;
+}
+
+// Splits Vectors into one array per coordinate.
+template <typename T>
+static void Split(const std::vector<Vector<3, T> >& vectors,
+                  std::vector<T>* x, std::vector<T>* y, std::vector<T>* z) {
+  x->resize(vectors.size());
+  y->resize(vectors.size());
+  z->resize(vectors.size());
+  for (size_t i = 0; i < vectors.size(); ++i) {
+    (*x)[i] = vectors[i][0];
+    (*y)[i] = vectors[i][1];
+    (*z)[i] = vectors[i][2];
+  }
+}
+
+template <typename T>
+static void TestTransforms() {
+  typedef Vector<3, T> Vector3;
+  typedef Point<3, T> Point3;
+  const T tolerance = GetTolerance<T>();
+  const Matrix<4, T> m4 =
+      TranslationMatrix(Vector3(1, -2, 3)) *
+      RotationMatrixAxisAngleH(Vector3(1, 2, 3),
+                               Angle<T>::FromDegrees(static_cast<T>(40))) *
+      ScaleMatrixH(Vector3(2, 3, 4));
+  const Matrix<3, T> m3 = NonhomogeneousSubmatrixH(m4);
+  for (size_t c = 0; c < sizeof(kCounts) / sizeof(kCounts[0]); ++c) {
+    const size_t count = kCounts[c];
+    SCOPED_TRACE(count);
+    const std::vector<Vector3> vectors = BuildVectors<T>(count, 1U);
+    std::vector<Point3> points(count);
+    for (size_t i = 0; i < count; ++i)
+      points[i] = Point3::Zero() + vectors[i];
+    std::vector<T> x, y, z;
+    Split(vectors, &x, &y, &z);
+
+    // AoS, in place for points.
+    std::vector<Point3> transformed_points(points);
+    std::vector<Vector3> transformed_vectors(count);
+    TransformPoints(m4, transformed_points.data(), count,
+                    transformed_points.data());
+    TransformVectors(m3, vectors.data(), count, transformed_vectors.data());
+
+    // SoA.
+    std::vector<T> px(count), py(count), pz(count);
+    std::vector<T> vx(count), vy(count), vz(count);
+    TransformPointsSoa(m4, x.data(), y.data(), z.data(), count, px.data(),
+                       py.data(), pz.data());
+    TransformVectorsSoa(m3, x.data(), y.data(), z.data(), count, vx.data(),
+                        vy.data(), vz.data());
+
+    for (size_t i = 0; i < count; ++i) {
+      const Point3 expected_point = m4 * points[i];
+      EXPECT_TRUE(PointsAlmostEqual(expected_point, transformed_points[i],
+                                    tolerance)) << i;
+      EXPECT_TRUE(PointsAlmostEqual(expected_point,
+                                    Point3(px[i], py[i], pz[i]), tolerance))
+          << i;
+      const Vector3 expected_vector = m3 * vectors[i];
+      EXPECT_TRUE(VectorsAlmostEqual(expected_vector, transformed_vectors[i],
+                                     tolerance)) << i;
+      EXPECT_TRUE(VectorsAlmostEqual(expected_vector,
+                                     Vector3(vx[i], vy[i], vz[i]), tolerance))
+          << i;
+    }
+  }
+}
+
+template <typename T>
+static void TestVectorOperations() {
+  typedef Vector<3, T> Vector3;
+  const T tolerance = GetTolerance<T>();
+  for (size_t c = 0; c < sizeof(kCounts) / sizeof(kCounts[0]); ++c) {
+    const size_t count = kCounts[c];
+    SCOPED_TRACE(count);
+    const std::vector<Vector3> v0 = BuildVectors<T>(count, 1U);
+    const std::vector<Vector3> v1 = BuildVectors<T>(count, 2U);
+    std::vector<T> x0, y0, z0, x1, y1, z1;
+    Split(v0, &x0, &y0, &z0);
+    Split(v1, &x1, &y1, &z1);
+
+    std::vector<Vector3> normalized(count), crossed(count);
+    std::vector<T> lengths_squared(count);
+    NormalizeVectors(v0.data(), count, normalized.data());
+    CrossVectors(v0.data(), v1.data(), count, crossed.data());
+    LengthsSquared(v0.data(), count, lengths_squared.data());
+
+    std::vector<T> nx(count), ny(count), nz(count);
+    std::vector<T> cx(count), cy(count), cz(count);
+    std::vector<T> soa_lengths_squared(count);
+    NormalizeVectorsSoa(x0.data(), y0.data(), z0.data(), count, nx.data(),
+                        ny.data(), nz.data());
+    CrossVectorsSoa(x0.data(), y0.data(), z0.data(), x1.data(), y1.data(),
+                    z1.data(), count, cx.data(), cy.data(), cz.data());
+    LengthsSquaredSoa(x0.data(), y0.data(), z0.data(), count,
+                      soa_lengths_squared.data());
+
+    for (size_t i = 0; i < count; ++i) {
+      const Vector3 expected_normalized = Normalized(v0[i]);
+      EXPECT_TRUE(VectorsAlmostEqual(expected_normalized, normalized[i],
+                                     tolerance)) << i;
+      EXPECT_TRUE(VectorsAlmostEqual(expected_normalized,
+                                     Vector3(nx[i], ny[i], nz[i]), tolerance))
+          << i;
+      const Vector3 expected_cross = Cross(v0[i], v1[i]);
+      EXPECT_TRUE(VectorsAlmostEqual(expected_cross, crossed[i], tolerance))
+          << i;
+      EXPECT_TRUE(VectorsAlmostEqual(expected_cross,
+                                     Vector3(cx[i], cy[i], cz[i]), tolerance))
+          << i;
+      EXPECT_NEAR(LengthSquared(v0[i]), lengths_squared[i], tolerance) << i;
+      EXPECT_NEAR(LengthSquared(v0[i]), soa_lengths_squared[i], tolerance)
+          << i;
+    }
+
+    // Zero vectors stay zero when normalized, as with Normalized().
+    if (count >= 7U) {
+      EXPECT_EQ(Vector3::Zero(), normalized[6]);
+      EXPECT_EQ(Vector3::Zero(), Vector3(nx[6], ny[6], nz[6]));
+    }
+
+    // Results may be written over the inputs.
+    std::vector<Vector3> in_place(v0);
+    CrossVectors(in_place.data(), v1.data(), count, in_place.data());
+    EXPECT_TRUE(in_place == crossed);
+    in_place = v0;
+    NormalizeVectors(in_place.data(), count, in_place.data());
+    EXPECT_TRUE(in_place == normalized);
+  }
+}
+
+// Returns all the BatchInstructionSets that are supported, including
+// kBatchScalar.
+static const std::vector<BatchInstructionSet> GetSupportedInstructionSets() {
+  std::vector<BatchInstructionSet> instruction_sets;
+  static const BatchInstructionSet kInstructionSets[] = {
+    kBatchScalar, kBatchSse2, kBatchAvx
+  };
+  for (size_t i = 0; i < sizeof(kInstructionSets) / sizeof(kInstructionSets[0]);
+       ++i) {
+    SetBatchInstructionSet(kInstructionSets[i]);
+    if (GetBatchInstructionSet() == kInstructionSets[i])
+      instruction_sets.push_back(kInstructionSets[i]);
+  }
+  SetBatchInstructionSet(GetSupportedBatchInstructionSet());
+  return instruction_sets;
+}
+
+// Runs |test| with each supported BatchInstructionSet.
+static void TestAllInstructionSets(void (*test)()) {
+  const std::vector<BatchInstructionSet> instruction_sets =
+      GetSupportedInstructionSets();
+  for (size_t i = 0; i < instruction_sets.size(); ++i) {
+    SCOPED_TRACE(GetBatchInstructionSetName(instruction_sets[i]));
+    SetBatchInstructionSet(instruction_sets[i]);
+    test();
+  }
+  SetBatchInstructionSet(GetSupportedBatchInstructionSet());
+}
+
+}  // anonymous namespace
+
+TEST(BatchUtils, InstructionSet) {
+  const BatchInstructionSet supported = GetSupportedBatchInstructionSet();
+  EXPECT_EQ(supported, GetBatchInstructionSet());
+  EXPECT_STREQ("Scalar", GetBatchInstructionSetName(kBatchScalar));
+  EXPECT_STREQ("SSE2", GetBatchInstructionSetName(kBatchSse2));
+  EXPECT_STREQ("AVX", GetBatchInstructionSetName(kBatchAvx));
+
+  SetBatchInstructionSet(kBatchScalar);
+  EXPECT_EQ(kBatchScalar, GetBatchInstructionSet());
+  // AVX support implies SSE2 support.
+  SetBatchInstructionSet(kBatchAvx);
+  const BatchInstructionSet avx = GetBatchInstructionSet();
+  SetBatchInstructionSet(kBatchSse2);
+  EXPECT_TRUE(avx == kBatchScalar || GetBatchInstructionSet() == kBatchSse2);
+  SetBatchInstructionSet(supported);
+  EXPECT_EQ(supported, GetBatchInstructionSet());
+}
+
+TEST(BatchUtils, TransformsFloat) {
+  TestAllInstructionSets(TestTransforms<float>);
+}
+
+TEST(BatchUtils, TransformsDouble) {
+  TestAllInstructionSets(TestTransforms<double>);
+}
+
+TEST(BatchUtils, VectorOperationsFloat) {
+  TestAllInstructionSets(TestVectorOperations<float>);
+}
+
+TEST(BatchUtils, VectorOperationsDouble) {
+  TestAllInstructionSets(TestVectorOperations<double>);
+}
+
+}  // namespace math
+}  // namespace ion
@@ -25,6 +25,7 @@
       'sources' : [
         'angle_test.cc',
         'angleutils_test.cc',
+        'batchutils_test.cc',
         'fieldofview_test.cc',
         'matrix_test.cc',
         'matrixutils_test.cc',
@@ -41,5 +42,21 @@
         '<(ion_dir)/math/math.gyp:ionmath_for_tests',
       ],
     },
+    {
+      # Compares the batched functions in batchutils.h with the single-element
+      # templates. This is not part of ionmath_test since it takes a while.
+      'target_name': 'ionmath_benchmark',
+      'includes': [ '../../dev/test_target.gypi' ],
+      'sources' : [
+        'batchutils_benchmark.cc',
+      ],
+      'dependencies' : [
+        '<(ion_dir)/analytics/analytics.gyp:ionanalytics',
+        '<(ion_dir)/base/base.gyp:ionbase_for_tests',
+        '<(ion_dir)/external/gtest.gyp:iongtest_safeallocs',
+        '<(ion_dir)/math/math.gyp:ionmath_for_tests',
+        '<(ion_dir)/port/port.gyp:ionport',
+      ],
+    },
   ],
 }
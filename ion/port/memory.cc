@@ -26,6 +26,7 @@ limitations under the License.
 #if defined(ION_PLATFORM_MAC) || defined(ION_PLATFORM_IOS)
 #include <mach/mach.h>
 #include <sys/errno.h>
+#include <sys/resource.h>
 #include <sys/sysctl.h>
 #include <sys/types.h>
 #endif
@@ -95,6 +96,25 @@ uint64 GetProcessResidentMemorySize() {
 #endif
 }
 
+uint64 GetProcessPeakResidentMemorySize() {
+#if defined(ION_PLATFORM_LINUX) || defined(ION_PLATFORM_ANDROID) || \
+    defined(ION_PLATFORM_GENERIC_ARM)
+  return GetProcFSValue("/proc/self/status", "VmHWM");
+#elif defined(ION_PLATFORM_MAC) || defined(ION_PLATFORM_IOS)
+  // Unlike on Linux, ru_maxrss is in bytes here.
+  struct rusage usage;
+  const int error_code = getrusage(RUSAGE_SELF, &usage);
+  assert(error_code == 0);
+  return static_cast<uint64>(usage.ru_maxrss);
+#elif defined(ION_PLATFORM_WINDOWS)
+  PROCESS_MEMORY_COUNTERS pmc;
+  GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+  return pmc.PeakWorkingSetSize;
+#else
+  return 0U;
+#endif
+}
+
 uint64 GetSystemMemorySize() {
 #if defined(ION_PLATFORM_LINUX) || defined(ION_PLATFORM_ANDROID) || \
     defined(ION_PLATFORM_GENERIC_ARM)
@@ -26,6 +26,9 @@ namespace port {
 // Return size of the current process in bytes.
 ION_API uint64 GetProcessResidentMemorySize();
 
+// Return the largest size the current process has had in bytes.
+ION_API uint64 GetProcessPeakResidentMemorySize();
+
 // Return the hardware RAM size in bytes.
 ION_API uint64 GetSystemMemorySize();
 
@@ -65,6 +65,25 @@ StackTrace::StackTrace() {
 #endif
 }
 
+StackTrace::StackTrace(const std::vector<void*>& addresses)
+    : addresses_(addresses) {}
+
+int StackTrace::CaptureAddresses(void** addresses, int max_depth) {
+#if !ION_PRODUCTION && defined(ION_STACKTRACE_POSIX)
+  return backtrace(addresses, max_depth);
+
+#elif !ION_PRODUCTION && defined(ION_PLATFORM_WINDOWS)
+  return CaptureStackBackTrace(
+      0, static_cast<DWORD>(max_depth), addresses, NULL);
+
+#else
+
+  // Intentionally capture nothing.
+  return 0;
+
+#endif
+}
+
 void StackTrace::ObtainSymbols() const {
 #if !ION_PRODUCTION
 #if defined(ION_STACKTRACE_POSIX)
@@ -33,7 +33,18 @@ namespace port {
 class ION_API StackTrace {
  public:
   StackTrace();
+  // Constructs a StackTrace from addresses that were captured earlier, e.g.
+  // with CaptureAddresses(), so that they can be symbolized.
+  explicit StackTrace(const std::vector<void*>& addresses);
   ~StackTrace() {}
+
+  // Writes at most |max_depth| return addresses of the current thread's stack
+  // into |addresses| and returns the number of addresses written. This does
+  // not allocate memory, so it may be called from a signal handler provided
+  // that a StackTrace has already been constructed once on the platform
+  // (which loads the unwinder). Returns 0 on unsupported platforms.
+  static int CaptureAddresses(void** addresses, int max_depth);
+
   // Returns the stack as a vector of addresses.
   const std::vector<void*>& GetAddresses() const { return addresses_; }
   // Returns the stack as a vector of symbol names.
@@ -61,3 +61,26 @@ TEST(Memory, ProcessMemory) {
   EXPECT_EQ(0U, process_memory);
 #endif
 }
+
+TEST(Memory, PeakProcessMemory) {
+#if defined(ION_PLATFORM_LINUX) || defined(ION_PLATFORM_ANDROID) || \
+  defined(ION_PLATFORM_MAC) || defined(ION_PLATFORM_IOS) || \
+  defined(ION_PLATFORM_GENERIC_ARM) || \
+  (defined(ION_PLATFORM_WINDOWS) && !defined(ION_GOOGLE_INTERNAL))
+  static const uint64 kAllocationSize = 10000000;
+  uint8* const allocated_memory = static_cast<uint8*>(malloc(kAllocationSize));
+  memset(allocated_memory, 255, kAllocationSize);
+  uint64 total = 0U;
+  for (uint64 i = 0; i < kAllocationSize; ++i)
+    total += allocated_memory[i];
+  EXPECT_EQ(255U * kAllocationSize, total);
+  const uint64 process_memory = ion::port::GetProcessResidentMemorySize();
+  free(allocated_memory);
+  // The peak includes the allocation even after it has been freed.
+  const uint64 peak_memory = ion::port::GetProcessPeakResidentMemorySize();
+  EXPECT_GT(peak_memory, kAllocationSize);
+  EXPECT_GE(peak_memory, process_memory);
+#else
+  EXPECT_EQ(0U, ion::port::GetProcessPeakResidentMemorySize());
+#endif
+}
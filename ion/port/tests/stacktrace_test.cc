@@ -124,6 +124,27 @@ TEST(StackTrace, Recursion) {
   Recursive(stack.size(), 0);
 }
 
+TEST(StackTrace, CaptureAddresses) {
+  void* addresses[64];
+  const int depth = ion::port::StackTrace::CaptureAddresses(addresses, 64);
+  const std::vector<void*> captured(addresses, addresses + depth);
+  ion::port::StackTrace stack_trace(captured);
+  EXPECT_EQ(captured, stack_trace.GetAddresses());
+
+#if defined(ION_TEST_STACKTRACE)
+
+  EXPECT_GT(depth, 1);
+  EXPECT_TRUE(stack_trace.GetSymbolString().find(
+      std::string("CaptureAddresses")) != std::string::npos);
+
+  // The depth is limited by the passed maximum.
+  EXPECT_EQ(1, ion::port::StackTrace::CaptureAddresses(addresses, 1));
+#else
+  // StackTrace not implemented.
+  EXPECT_EQ(0, depth);
+#endif
+}
+
 #undef ION_TEST_STACKTRACE
 
 #endif  // ION_DEBUG
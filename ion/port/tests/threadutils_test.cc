@@ -174,6 +174,10 @@ TEST(ThreadUtils, LocalStorage) {
 }
 #endif  // !ION_PLATFORM_ASMJS
 
+TEST(ThreadUtils, HardwareThreadCount) {
+  EXPECT_LE(1U, GetHardwareThreadCount());
+}
+
 TEST(ThreadUtils, JoinWithInvalid) {
   EXPECT_TRUE(IsMainThread());
 
@@ -19,6 +19,7 @@ limitations under the License.
 
 #include <cstring>  // NOLINT
 #include <iostream>  // NOLINT
+#include <thread>  // NOLINT
 
 #if defined(ION_PLATFORM_WINDOWS)
 #  define API_DECL WINAPI
@@ -202,6 +203,12 @@ ThreadId SpawnThreadStd(const ThreadStdFunc* func) {
   return id;
 }
 
+size_t GetHardwareThreadCount() {
+  // hardware_concurrency() returns 0 if the count is not computable.
+  const size_t count = std::thread::hardware_concurrency();
+  return count ? count : 1U;
+}
+
 bool IsThreadNamingSupported() {
   return THREAD_NAMING_SUPPORTED;
 }
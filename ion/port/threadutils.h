@@ -91,6 +91,10 @@ ION_API bool JoinThread(ThreadId id);
 // waiting to execute.
 ION_API void YieldThread();
 
+// Returns the number of threads the hardware can run concurrently, which is at
+// least 1.
+ION_API size_t GetHardwareThreadCount();
+
 //-----------------------------------------------------------------------------
 //
 // Thread naming functions.
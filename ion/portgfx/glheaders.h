@@ -170,6 +170,9 @@ typedef void (GL_APIENTRY *GLDEBUGPROC)(GLenum source, GLenum type, GLuint id,
 #ifndef GL_COMPARE_REF_TO_TEXTURE
 #  define GL_COMPARE_REF_TO_TEXTURE 0x884E
 #endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#  define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 #ifndef GL_COMPRESSED_R11_EAC
 #  define GL_COMPRESSED_R11_EAC 0x9270
 #endif
@@ -521,6 +524,9 @@ typedef void (GL_APIENTRY *GLDEBUGPROC)(GLenum source, GLenum type, GLuint id,
 #ifndef GL_MAX_SERVER_WAIT_TIMEOUT
 #  define GL_MAX_SERVER_WAIT_TIMEOUT 0x9111
 #endif
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#  define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
 #ifndef GL_MAX_TEXTURE_BUFFER_SIZE
 #  define GL_MAX_TEXTURE_BUFFER_SIZE 0x8C2B
 #endif
@@ -947,6 +953,9 @@ typedef void (GL_APIENTRY *GLDEBUGPROC)(GLenum source, GLenum type, GLuint id,
 #ifndef GL_STENCIL_INDEX8
 #  define GL_STENCIL_INDEX8 0x8D48
 #endif
+#ifndef GL_STREAM_READ
+#  define GL_STREAM_READ 0x88E1
+#endif
 #ifndef GL_SYNC_CONDITION
 #  define GL_SYNC_CONDITION 0x9113
 #endif
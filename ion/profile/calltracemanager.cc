@@ -24,6 +24,7 @@ limitations under the License.
 #include "ion/base/serialize.h"
 #include "ion/base/stringutils.h"
 #include "ion/port/threadutils.h"
+#include "ion/profile/samplingprofiler.h"
 #include "ion/profile/timelinenode.h"
 #include "ion/profile/timelinethread.h"
 #include "ion/profile/tracerecorder.h"
@@ -241,7 +242,9 @@ CallTraceManager::CallTraceManager()
       recorder_list_(GetAllocator()),
       buffer_size_(0),
       scope_event_map_(GetAllocator()),
-      reverse_scope_event_map_(GetAllocator()) {
+      reverse_scope_event_map_(GetAllocator()),
+      sampling_profiler_(NULL),
+      streaming_metrics_(this) {
 }
 
 CallTraceManager::CallTraceManager(size_t buffer_size)
@@ -250,7 +253,9 @@ CallTraceManager::CallTraceManager(size_t buffer_size)
       recorder_list_(GetAllocator()),
       buffer_size_(buffer_size),
       scope_event_map_(GetAllocator()),
-      reverse_scope_event_map_(GetAllocator()) {
+      reverse_scope_event_map_(GetAllocator()),
+      sampling_profiler_(NULL),
+      streaming_metrics_(this) {
 }
 
 CallTraceManager::~CallTraceManager() {
@@ -279,6 +284,11 @@ TraceRecorder* CallTraceManager::GetTraceRecorder() {
   }
 }
 
+TraceRecorder* CallTraceManager::FindTraceRecorder() const {
+  void* ptr = port::GetThreadLocalStorage(trace_recorder_.GetKey());
+  return ptr ? *static_cast<TraceRecorder**>(ptr) : NULL;
+}
+
 TraceRecorder* CallTraceManager::GetNamedTraceRecorder(
     NamedTraceRecorderType name) {
   DCHECK(name < kNumNamedTraceRecorders);
@@ -639,6 +649,8 @@ Timeline CallTraceManager::BuildTimeline() const {
     recorder->AddTraceToTimelineNode(thread.get());
     root->AddChild(std::move(thread));
   }
+  if (sampling_profiler_)
+    sampling_profiler_->AddSamplesToTimeline(root.get());
 
   return Timeline(std::move(root));
 }
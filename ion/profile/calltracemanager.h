@@ -30,12 +30,14 @@ limitations under the License.
 #include "ion/base/threadlocalobject.h"
 #include "ion/port/mutex.h"
 #include "ion/port/timer.h"
+#include "ion/profile/streamingmetrics.h"
 #include "ion/profile/timeline.h"
 #include "ion/profile/timelinemetric.h"
 
 namespace ion {
 namespace profile {
 
+class SamplingProfiler;
 class TraceRecorder;
 
 // Manages call trace recording for visualization in Web Tracing Framework
@@ -114,6 +116,11 @@ class CallTraceManager : public base::Allocatable {
   // Gets the TraceRecorder instance specific to the current thread.
   TraceRecorder* GetTraceRecorder();
 
+  // Returns the TraceRecorder instance specific to the current thread if one
+  // has already been created, or NULL otherwise. Unlike GetTraceRecorder(),
+  // this never allocates, so it is safe to call from a signal handler.
+  TraceRecorder* FindTraceRecorder() const;
+
   // Gets the TraceRecorder instance specific to the current thread of the
   // given name. These are used for non-CPU-thread tracing such as for GPU
   // events.
@@ -164,9 +171,20 @@ class CallTraceManager : public base::Allocatable {
   // extension ".wtf-trace".
   void WriteFile(const std::string& filename) const;
 
-  // Convert the current WTF trace into a timeline.
+  // Convert the current WTF trace into a timeline. If a SamplingProfiler is
+  // attached, its samples are merged into the timeline as TimelineSample
+  // nodes.
   Timeline BuildTimeline() const;
 
+  // Sets/returns the SamplingProfiler whose samples are merged into built
+  // timelines. SamplingProfiler attaches itself on construction.
+  void SetSamplingProfiler(const SamplingProfiler* profiler) {
+    sampling_profiler_ = profiler;
+  }
+  const SamplingProfiler* GetSamplingProfiler() const {
+    return sampling_profiler_;
+  }
+
   // Registers a timeline metric.
   void RegisterTimelineMetric(std::unique_ptr<TimelineMetric> metric) {
     timeline_metrics_.push_back(std::move(metric));
@@ -176,6 +194,13 @@ class CallTraceManager : public base::Allocatable {
   // object containing the collected statistics.
   analytics::Benchmark RunTimelineMetrics() const;
 
+  // Returns the StreamingMetrics that maintain live latency histograms of the
+  // scopes and frames recorded by this manager's TraceRecorders.
+  StreamingMetrics* GetStreamingMetrics() { return &streaming_metrics_; }
+  const StreamingMetrics* GetStreamingMetrics() const {
+    return &streaming_metrics_;
+  }
+
  private:
   // Array of TraceRecorder pointers that will be stored per thread.
   struct NamedTraceRecorderArray {
@@ -217,9 +242,15 @@ class CallTraceManager : public base::Allocatable {
   // Reverse map of custom scope events (uint32 ids to literal strings).
   ReverseScopeEventMap reverse_scope_event_map_;
 
+  // The SamplingProfiler attached to this manager, if any.
+  const SamplingProfiler* sampling_profiler_;
+
   // The timeline metrics that have been registerd. These metrics will be run
   // when RunTimelineMetrics gets called.
   std::vector<std::unique_ptr<TimelineMetric>> timeline_metrics_;
+
+  // Latency histograms updated as traces are recorded.
+  StreamingMetrics streaming_metrics_;
 };
 
 // Class to automatically record scope start and end events using the given
@@ -0,0 +1,171 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/profile/latencyhistogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "ion/base/logging.h"
+#include "ion/math/utils.h"
+
+namespace ion {
+namespace profile {
+
+namespace {
+
+// Adds |amount| to |value|. Only the single writer of a histogram modifies it,
+// so a plain load and store is enough and avoids a locked instruction.
+template <typename T>
+static void AddRelaxed(std::atomic<T>* value, T amount) {
+  value->store(value->load(std::memory_order_relaxed) + amount,
+               std::memory_order_relaxed);
+}
+
+}  // anonymous namespace
+
+const int LatencyHistogram::kSubBucketBits;
+const int LatencyHistogram::kSubBucketCount;
+const int LatencyHistogram::kBucketCount;
+
+LatencyHistogram::LatencyHistogram() {
+  Clear();
+}
+
+void LatencyHistogram::Record(uint32 value) {
+  AddRelaxed(&counts_[GetBucketIndex(value)], 1U);
+  if (value < min_.load(std::memory_order_relaxed))
+    min_.store(value, std::memory_order_relaxed);
+  if (value > max_.load(std::memory_order_relaxed))
+    max_.store(value, std::memory_order_relaxed);
+  const double dvalue = static_cast<double>(value);
+  AddRelaxed(&sum_, dvalue);
+  AddRelaxed(&sum_of_squares_, dvalue * dvalue);
+  // The count is updated last so that a reader never sees more values than
+  // have been added to the buckets.
+  AddRelaxed(&count_, static_cast<uint64>(1));
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  const uint64 other_count = other.GetCount();
+  if (other_count == 0U)
+    return;
+  for (int i = 0; i < kBucketCount; ++i) {
+    const uint32 count = other.counts_[i].load(std::memory_order_relaxed);
+    if (count)
+      AddRelaxed(&counts_[i], count);
+  }
+  min_.store(std::min(min_.load(std::memory_order_relaxed),
+                      other.min_.load(std::memory_order_relaxed)),
+             std::memory_order_relaxed);
+  max_.store(std::max(max_.load(std::memory_order_relaxed),
+                      other.max_.load(std::memory_order_relaxed)),
+             std::memory_order_relaxed);
+  AddRelaxed(&sum_, other.sum_.load(std::memory_order_relaxed));
+  AddRelaxed(&sum_of_squares_,
+             other.sum_of_squares_.load(std::memory_order_relaxed));
+  AddRelaxed(&count_, other_count);
+}
+
+void LatencyHistogram::Clear() {
+  count_.store(0U, std::memory_order_relaxed);
+  for (int i = 0; i < kBucketCount; ++i)
+    counts_[i].store(0U, std::memory_order_relaxed);
+  min_.store(std::numeric_limits<uint32>::max(), std::memory_order_relaxed);
+  max_.store(0U, std::memory_order_relaxed);
+  sum_.store(0.0, std::memory_order_relaxed);
+  sum_of_squares_.store(0.0, std::memory_order_relaxed);
+}
+
+uint32 LatencyHistogram::GetMinimum() const {
+  return GetCount() ? min_.load(std::memory_order_relaxed) : 0U;
+}
+
+double LatencyHistogram::GetMean() const {
+  const uint64 count = GetCount();
+  return count ? sum_.load(std::memory_order_relaxed) /
+                     static_cast<double>(count)
+               : 0.0;
+}
+
+double LatencyHistogram::GetStandardDeviation() const {
+  const uint64 count = GetCount();
+  if (count == 0U)
+    return 0.0;
+  const double mean = GetMean();
+  const double variance =
+      sum_of_squares_.load(std::memory_order_relaxed) /
+          static_cast<double>(count) - mean * mean;
+  // Rounding may make the variance of nearly constant values negative.
+  return variance > 0.0 ? std::sqrt(variance) : 0.0;
+}
+
+uint32 LatencyHistogram::GetPercentile(double percentile) const {
+  DCHECK_GE(percentile, 0.0);
+  DCHECK_LE(percentile, 100.0);
+  const uint64 count = GetCount();
+  if (count == 0U)
+    return 0U;
+
+  // Find the bucket holding the value with the requested rank.
+  const uint64 rank = std::max(
+      static_cast<uint64>(1),
+      static_cast<uint64>(
+          std::ceil(percentile * 0.01 * static_cast<double>(count))));
+  uint64 seen = 0U;
+  uint32 value = GetMaximum();
+  for (int i = 0; i < kBucketCount; ++i) {
+    seen += counts_[i].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      value = GetBucketUpperBound(i);
+      break;
+    }
+  }
+  return std::max(GetMinimum(), std::min(GetMaximum(), value));
+}
+
+int LatencyHistogram::GetBucketIndex(uint32 value) {
+  if (value < static_cast<uint32>(kSubBucketCount))
+    return static_cast<int>(value);
+  // The kSubBucketBits bits below the most significant bit select the linear
+  // sub-bucket within the power of two range.
+  const int shift = static_cast<int>(math::Log2(value)) - kSubBucketBits;
+  return (shift + 1) * kSubBucketCount +
+         static_cast<int>(value >> shift) - kSubBucketCount;
+}
+
+uint32 LatencyHistogram::GetBucketLowerBound(int index) {
+  DCHECK_GE(index, 0);
+  DCHECK_LT(index, kBucketCount);
+  if (index < kSubBucketCount)
+    return static_cast<uint32>(index);
+  const int shift = index / kSubBucketCount - 1;
+  return static_cast<uint32>(kSubBucketCount + index % kSubBucketCount)
+         << shift;
+}
+
+uint32 LatencyHistogram::GetBucketUpperBound(int index) {
+  if (index < kSubBucketCount)
+    return GetBucketLowerBound(index);
+  const int shift = index / kSubBucketCount - 1;
+  return static_cast<uint32>(static_cast<uint64>(GetBucketLowerBound(index)) +
+                             (static_cast<uint64>(1) << shift) - 1U);
+}
+
+}  // namespace profile
+}  // namespace ion
@@ -0,0 +1,100 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef ION_PROFILE_LATENCYHISTOGRAM_H_
+#define ION_PROFILE_LATENCYHISTOGRAM_H_
+
+#include "base/integral_types.h"
+#include "base/macros.h"
+#include "ion/port/atomic.h"
+
+namespace ion {
+namespace profile {
+
+// LatencyHistogram counts uint32 values (typically durations in microseconds)
+// in logarithmically sized buckets, in the style of HdrHistogram: each power of
+// two range is split into kSubBucketCount linear sub-buckets, so percentiles
+// are reported with a relative error of at most 1 / kSubBucketCount while the
+// memory use stays fixed no matter how many values are recorded.
+//
+// A histogram may be written by a single thread at a time (Record() and
+// Merge() into it) while any number of other threads read it. All counters are
+// atomics updated without read-modify-write operations, so recording never
+// locks. A concurrent reader may see a value that has been counted in some
+// statistics but not yet in others.
+class ION_API LatencyHistogram {
+ public:
+  // The number of bits of precision within each power of two range.
+  static const int kSubBucketBits = 5;
+  static const int kSubBucketCount = 1 << kSubBucketBits;
+  // Values below kSubBucketCount are counted exactly, and each of the
+  // remaining 32 - kSubBucketBits powers of two gets kSubBucketCount buckets.
+  static const int kBucketCount = (32 - kSubBucketBits + 1) * kSubBucketCount;
+
+  LatencyHistogram();
+
+  // Adds a value to the histogram.
+  void Record(uint32 value);
+
+  // Adds all values recorded in |other| to this histogram.
+  void Merge(const LatencyHistogram& other);
+
+  // Removes all recorded values.
+  void Clear();
+
+  // Returns the number of recorded values.
+  uint64 GetCount() const { return count_.load(std::memory_order_relaxed); }
+
+  // Returns the smallest and largest recorded value, or 0 if the histogram is
+  // empty.
+  uint32 GetMinimum() const;
+  uint32 GetMaximum() const { return max_.load(std::memory_order_relaxed); }
+
+  // Returns the mean and standard deviation of the recorded values, or 0 if
+  // the histogram is empty.
+  double GetMean() const;
+  double GetStandardDeviation() const;
+
+  // Returns the value below which |percentile| percent of the recorded values
+  // fall, where |percentile| is in [0, 100]. The result is the largest value
+  // that falls in the same bucket as the exact percentile, clamped to the
+  // recorded range. Returns 0 if the histogram is empty.
+  uint32 GetPercentile(double percentile) const;
+
+  // Returns the index of the bucket that |value| is counted in.
+  static int GetBucketIndex(uint32 value);
+
+  // Returns the smallest and largest value counted in bucket |index|.
+  static uint32 GetBucketLowerBound(int index);
+  static uint32 GetBucketUpperBound(int index);
+
+ private:
+  std::atomic<uint32> counts_[kBucketCount];
+  std::atomic<uint64> count_;
+  std::atomic<uint32> min_;
+  std::atomic<uint32> max_;
+  // These are doubles so that they cannot overflow.
+  std::atomic<double> sum_;
+  std::atomic<double> sum_of_squares_;
+
+  DISALLOW_COPY_AND_ASSIGN(LatencyHistogram);
+};
+
+}  // namespace profile
+}  // namespace ion
+
+#endif  // ION_PROFILE_LATENCYHISTOGRAM_H_
@@ -35,8 +35,14 @@
       'sources' : [
         'calltracemanager.cc',
         'calltracemanager.h',
+        'latencyhistogram.cc',
+        'latencyhistogram.h',
         'profiling.cc',
         'profiling.h',
+        'samplingprofiler.cc',
+        'samplingprofiler.h',
+        'streamingmetrics.cc',
+        'streamingmetrics.h',
         'timeline.cc',
         'timeline.h',
         'timelineevent.cc',
@@ -46,6 +52,7 @@
         'timelinenode.cc',
         'timelinenode.h',
         'timelinerange.h',
+        'timelinesample.h',
         'timelinescope.h',
         'timelinesearch.h',
         'timelinethread.h',
@@ -22,10 +22,40 @@ limitations under the License.
 namespace ion {
 namespace profile {
 
+namespace {
+
+// Records TaskScheduler tasks as scopes of a CallTraceManager.
+class CallTraceTaskObserver : public base::TaskScheduler::TaskObserver {
+ public:
+  explicit CallTraceTaskObserver(CallTraceManager* manager)
+      : manager_(manager) {}
+
+  void OnTaskBegin(const char* name) override {
+    manager_->GetTraceRecorder()->EnterScope(
+        manager_->GetScopeEnterEvent(name));
+  }
+
+  void OnTaskEnd() override {
+    manager_->GetTraceRecorder()->LeaveScope();
+  }
+
+ private:
+  CallTraceManager* manager_;
+};
+
+}  // anonymous namespace
+
 CallTraceManager* GetCallTraceManager() {
   ION_DECLARE_SAFE_STATIC_POINTER(CallTraceManager, manager);
   return manager;
 }
 
+void EnableTaskSchedulerTracing(base::TaskScheduler* scheduler,
+                                CallTraceManager* manager) {
+  scheduler->SetTaskObserver(
+      std::make_shared<CallTraceTaskObserver>(
+          manager ? manager : GetCallTraceManager()));
+}
+
 }  // namespace profile
 }  // namespace ion
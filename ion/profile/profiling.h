@@ -22,6 +22,7 @@ limitations under the License.
 // profiling.
 
 #include "ion/base/staticsafedeclare.h"
+#include "ion/base/taskscheduler.h"
 #include "ion/profile/calltracemanager.h"
 #include "ion/profile/tracerecorder.h"
 
@@ -31,6 +32,13 @@ namespace profile {
 // Get the global, static instance of CallTraceManager.
 ION_API CallTraceManager* GetCallTraceManager();
 
+// Makes |scheduler| record each task it runs as a scope named after the task's
+// TaskGroup in the trace of the thread that runs it, using |manager|, or the
+// global CallTraceManager if |manager| is NULL. The group names must be literal
+// strings, as for ION_PROFILE_FUNCTION.
+ION_API void EnableTaskSchedulerTracing(base::TaskScheduler* scheduler,
+                                        CallTraceManager* manager = NULL);
+
 }  // namespace profile
 }  // namespace ion
 
@@ -0,0 +1,462 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/profile/samplingprofiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+
+#if defined(ION_PLATFORM_LINUX) || defined(ION_PLATFORM_MAC)
+#  define ION_SAMPLING_PROFILER_POSIX
+#  include <cxxabi.h>
+#  include <errno.h>
+#  include <signal.h>
+#  include <sys/time.h>
+#  include <cstdlib>
+#endif
+
+#include "ion/base/lockguards.h"
+#include "ion/base/logging.h"
+#include "ion/base/staticsafedeclare.h"
+#include "ion/base/stringutils.h"
+#include "ion/port/stacktrace.h"
+#include "ion/profile/calltracemanager.h"
+#include "ion/profile/profiling.h"
+#include "ion/profile/timelinesample.h"
+#include "ion/profile/timelinethread.h"
+#include "ion/profile/tracerecorder.h"
+#include "third_party/jsoncpp/include/json/json.h"
+
+namespace ion {
+namespace profile {
+
+namespace {
+
+// The name used for samples taken outside of any instrumented scope.
+static const char kUnscopedName[] = "[unscoped]";
+
+#if defined(ION_SAMPLING_PROFILER_POSIX)
+// The SIGPROF action that was installed before the profiler started.
+static struct sigaction s_previous_action;
+#endif
+
+// Returns the (demangled, if possible) function name in a symbol string
+// returned by port::StackTrace.
+static const std::string GetFunctionName(const std::string& symbol) {
+  std::string name = symbol;
+#if defined(ION_PLATFORM_LINUX)
+  // Linux symbols look like "binary(mangled_name+0x1f) [0x4005d4]".
+  const size_t open = symbol.find('(');
+  const size_t plus =
+      open == std::string::npos ? open : symbol.find('+', open);
+  if (plus != std::string::npos && plus > open + 1)
+    name = symbol.substr(open + 1, plus - open - 1);
+#elif defined(ION_PLATFORM_MAC)
+  // Mac symbols look like "3   binary   0x0000000100000f1d mangled_name + 29".
+  const std::vector<std::string> parts = base::SplitString(symbol, " ");
+  if (parts.size() >= 4U)
+    name = parts[3];
+#endif
+#if defined(ION_SAMPLING_PROFILER_POSIX)
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(name.c_str(), NULL, NULL, &status);
+  if (demangled) {
+    if (status == 0)
+      name = demangled;
+    free(demangled);
+  }
+#endif
+  // Semicolons separate frames in the folded stacks format.
+  std::replace(name.begin(), name.end(), ';', ':');
+  return name;
+}
+
+// Returns whether |name| is a frame of the profiler's own signal handling.
+static bool IsProfilerFrame(const std::string& name) {
+  return name.find("SamplingProfiler") != std::string::npos ||
+         name.find("CaptureAddresses") != std::string::npos;
+}
+
+// A node in a flame-graph tree.
+struct FlameNode {
+  FlameNode() : value(0) {}
+  size_t value;
+  std::map<std::string, std::unique_ptr<FlameNode>> children;
+};
+
+// Returns the child of |node| named |name|, creating it if necessary.
+static FlameNode* GetFlameChild(FlameNode* node, const std::string& name) {
+  std::unique_ptr<FlameNode>& child = node->children[name];
+  if (!child)
+    child.reset(new FlameNode);
+  return child.get();
+}
+
+// Converts a flame-graph tree to JSON.
+static const Json::Value FlameNodeToJson(const std::string& name,
+                                         const FlameNode& node) {
+  Json::Value json(Json::objectValue);
+  json["name"] = name;
+  json["value"] = static_cast<Json::UInt64>(node.value);
+  Json::Value children(Json::arrayValue);
+  for (const auto& child : node.children)
+    children.append(FlameNodeToJson(child.first, *child.second));
+  json["children"] = children;
+  return json;
+}
+
+// Returns the innermost non-sample node below |node| whose time range contains
+// |timestamp|, or |node| itself if there is none.
+static TimelineNode* FindInnermostNode(TimelineNode* node, uint32 timestamp) {
+  bool descended = true;
+  while (descended) {
+    descended = false;
+    for (const auto& child : node->GetChildren()) {
+      if (child->GetType() != TimelineNode::Type::kSample &&
+          child->GetBegin() <= timestamp && timestamp <= child->GetEnd()) {
+        node = child.get();
+        descended = true;
+        break;
+      }
+    }
+  }
+  return node;
+}
+
+}  // anonymous namespace
+
+struct SamplingProfiler::SymbolizedSample {
+  uint32 time_micros;
+  std::string scope_name;
+  port::ThreadId thread_id;
+  // Function names, innermost frame first.
+  std::vector<std::string> frames;
+};
+
+const int SamplingProfiler::kMaxStackDepth;
+const size_t SamplingProfiler::kDefaultCapacity;
+
+std::atomic<SamplingProfiler*> SamplingProfiler::s_running_profiler_(nullptr);
+std::atomic<int> SamplingProfiler::s_handlers_in_flight_(0);
+
+SamplingProfiler* SamplingProfiler::Get() {
+  ION_DECLARE_SAFE_STATIC_POINTER(SamplingProfiler, profiler);
+  return profiler;
+}
+
+SamplingProfiler::SamplingProfiler()
+    : SamplingProfiler(ion::profile::GetCallTraceManager()) {}
+
+SamplingProfiler::SamplingProfiler(CallTraceManager* manager)
+    : manager_(manager),
+      buffer_size_(0),
+      capacity_(kDefaultCapacity),
+      next_sample_(0),
+      dropped_samples_(0) {
+  DCHECK(manager_);
+  manager_->SetSamplingProfiler(this);
+}
+
+SamplingProfiler::~SamplingProfiler() {
+  Stop();
+  if (manager_->GetSamplingProfiler() == this)
+    manager_->SetSamplingProfiler(NULL);
+}
+
+bool SamplingProfiler::IsSupported() {
+#if defined(ION_SAMPLING_PROFILER_POSIX) && !ION_PRODUCTION
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool SamplingProfiler::Start(uint32 frequency_hz) {
+  if (!IsSupported()) {
+    LOG(WARNING) << "Sampling profiling is not supported on this platform.";
+    return false;
+  }
+  if (frequency_hz == 0U) {
+    LOG(ERROR) << "The sampling frequency must be positive.";
+    return false;
+  }
+
+  base::LockGuard guard(&mutex_);
+  if (s_running_profiler_.load() != nullptr) {
+    LOG(WARNING) << "A SamplingProfiler is already running.";
+    return false;
+  }
+
+  // Allocate fresh sample storage. Only the depth needs to be initialized,
+  // since it marks whether a sample is complete.
+  if (buffer_size_ != capacity_ || !samples_) {
+    samples_.reset(new Sample[capacity_]);
+    buffer_size_ = capacity_;
+  }
+  for (size_t i = 0; i < buffer_size_; ++i)
+    samples_[i].depth.store(0);
+  next_sample_ = 0;
+  dropped_samples_ = 0;
+
+  // Capturing a stack trace once loads the unwinder, so that capturing one
+  // from the signal handler does not allocate.
+  port::StackTrace warm_up;
+
+  SamplingProfiler* expected = nullptr;
+  if (!s_running_profiler_.compare_exchange_strong(expected, this)) {
+    LOG(WARNING) << "A SamplingProfiler is already running.";
+    return false;
+  }
+
+#if defined(ION_SAMPLING_PROFILER_POSIX)
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = HandleSignal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGPROF, &action, &s_previous_action) != 0) {
+    LOG(ERROR) << "Unable to install the SIGPROF handler.";
+    s_running_profiler_.store(nullptr);
+    return false;
+  }
+
+  const uint32 interval_us = std::max(1U, 1000000U / frequency_hz);
+  struct itimerval timer;
+  timer.it_interval.tv_sec = interval_us / 1000000U;
+  timer.it_interval.tv_usec = interval_us % 1000000U;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+    LOG(ERROR) << "Unable to start the profiling timer.";
+    sigaction(SIGPROF, &s_previous_action, NULL);
+    s_running_profiler_.store(nullptr);
+    return false;
+  }
+#endif
+  return true;
+}
+
+void SamplingProfiler::Stop() {
+  base::LockGuard guard(&mutex_);
+  if (s_running_profiler_.load() != this)
+    return;
+
+#if defined(ION_SAMPLING_PROFILER_POSIX)
+  struct itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, NULL);
+#endif
+
+  s_running_profiler_.store(nullptr);
+  // Wait for handlers that may still be writing into this profiler.
+  while (s_handlers_in_flight_.load() != 0)
+    port::YieldThread();
+
+#if defined(ION_SAMPLING_PROFILER_POSIX)
+  sigaction(SIGPROF, &s_previous_action, NULL);
+#endif
+}
+
+bool SamplingProfiler::IsRunning() const {
+  return s_running_profiler_.load() == this;
+}
+
+void SamplingProfiler::SetCapacity(size_t capacity) {
+  DCHECK_GT(capacity, 0U);
+  capacity_ = capacity;
+}
+
+size_t SamplingProfiler::GetSampleCount() const {
+  return std::min(next_sample_.load(), buffer_size_);
+}
+
+void SamplingProfiler::HandleSignal(int signal_number) {
+#if defined(ION_SAMPLING_PROFILER_POSIX)
+  // The interrupted code may depend on errno, so preserve it.
+  const int saved_errno = errno;
+#endif
+  ++s_handlers_in_flight_;
+  if (SamplingProfiler* profiler = s_running_profiler_.load())
+    profiler->RecordSample();
+  --s_handlers_in_flight_;
+#if defined(ION_SAMPLING_PROFILER_POSIX)
+  errno = saved_errno;
+#endif
+}
+
+void SamplingProfiler::RecordSample() {
+  // Everything here must be async-signal-safe: no locks and no allocation.
+  const size_t index = next_sample_.fetch_add(1);
+  if (index >= buffer_size_) {
+    ++dropped_samples_;
+    return;
+  }
+  Sample& sample = samples_[index];
+  sample.time_micros = manager_->GetTimeInUs();
+  sample.thread_id = port::GetCurrentThreadId();
+  const TraceRecorder* recorder = manager_->FindTraceRecorder();
+  sample.scope_event = recorder ? recorder->GetCurrentScopeEvent() : 0U;
+  sample.depth.store(
+      port::StackTrace::CaptureAddresses(sample.frames, kMaxStackDepth));
+}
+
+void SamplingProfiler::GetSymbolizedSamples(
+    std::vector<SymbolizedSample>* samples) const {
+  base::LockGuard guard(&mutex_);
+  const size_t count = GetSampleCount();
+
+  // Symbolize each distinct address only once.
+  std::unordered_map<void*, std::string> names;
+  std::vector<void*> addresses;
+  for (size_t i = 0; i < count; ++i) {
+    const Sample& sample = samples_[i];
+    const int depth = sample.depth.load();
+    for (int j = 0; j < depth; ++j) {
+      if (names.insert(std::make_pair(sample.frames[j], std::string())).second)
+        addresses.push_back(sample.frames[j]);
+    }
+  }
+  if (!addresses.empty()) {
+    const port::StackTrace trace(addresses);
+    const std::vector<std::string>& symbols = trace.GetSymbols();
+    for (size_t i = 0; i < addresses.size(); ++i) {
+      names[addresses[i]] =
+          i < symbols.size() ? GetFunctionName(symbols[i]) : "???";
+    }
+  }
+
+  samples->reserve(samples->size() + count);
+  for (size_t i = 0; i < count; ++i) {
+    const Sample& sample = samples_[i];
+    const int depth = sample.depth.load();
+    if (depth == 0)
+      continue;
+
+    SymbolizedSample symbolized;
+    symbolized.time_micros = sample.time_micros;
+    symbolized.thread_id = sample.thread_id;
+    symbolized.scope_name =
+        sample.scope_event >= CallTraceManager::kCustomScopeEvent
+            ? manager_->GetScopeEnterEventName(sample.scope_event)
+            : kUnscopedName;
+
+    // Skip the profiler's own frames and the signal trampoline below them.
+    int first_frame = 0;
+    while (first_frame < depth &&
+           IsProfilerFrame(names[sample.frames[first_frame]]))
+      ++first_frame;
+    if (first_frame > 0 && first_frame < depth)
+      ++first_frame;
+    for (int j = first_frame; j < depth; ++j)
+      symbolized.frames.push_back(names[sample.frames[j]]);
+    samples->push_back(symbolized);
+  }
+}
+
+std::string SamplingProfiler::GetFoldedStacks() const {
+  std::vector<SymbolizedSample> samples;
+  GetSymbolizedSamples(&samples);
+
+  std::map<std::string, size_t> stack_counts;
+  for (const SymbolizedSample& sample : samples) {
+    std::string stack = sample.scope_name;
+    std::replace(stack.begin(), stack.end(), ';', ':');
+    for (auto it = sample.frames.rbegin(); it != sample.frames.rend(); ++it)
+      stack += ";" + *it;
+    ++stack_counts[stack];
+  }
+
+  std::ostringstream out;
+  for (const auto& entry : stack_counts)
+    out << entry.first << " " << entry.second << "\n";
+  return out.str();
+}
+
+std::string SamplingProfiler::GetFlameGraphJson() const {
+  std::vector<SymbolizedSample> samples;
+  GetSymbolizedSamples(&samples);
+
+  FlameNode root;
+  for (const SymbolizedSample& sample : samples) {
+    ++root.value;
+    FlameNode* node = GetFlameChild(&root, sample.scope_name);
+    ++node->value;
+    for (auto it = sample.frames.rbegin(); it != sample.frames.rend(); ++it) {
+      node = GetFlameChild(node, *it);
+      ++node->value;
+    }
+  }
+
+  Json::FastWriter json_writer;
+  return json_writer.write(FlameNodeToJson("root", root));
+}
+
+void SamplingProfiler::AddSamplesToTimeline(TimelineNode* root) const {
+  DCHECK(root);
+  std::vector<SymbolizedSample> samples;
+  GetSymbolizedSamples(&samples);
+
+  // Collect the existing threads. The "GPU" and "VSync" threads are named
+  // TraceRecorders that share the thread id of the thread that created them,
+  // so they are skipped in favor of the thread's own recorder.
+  std::vector<std::pair<port::ThreadId, TimelineNode*>> threads;
+  for (const auto& child : root->GetChildren()) {
+    if (child->GetType() != TimelineNode::Type::kThread ||
+        child->GetName() == "GPU" || child->GetName() == "VSync")
+      continue;
+    const TimelineThread* thread =
+        static_cast<const TimelineThread*>(child.get());
+    threads.push_back(std::make_pair(thread->GetThreadId(), child.get()));
+  }
+
+  for (const SymbolizedSample& sample : samples) {
+    TimelineNode* thread = NULL;
+    for (const auto& entry : threads) {
+      if (entry.first == sample.thread_id) {
+        thread = entry.second;
+        break;
+      }
+    }
+    if (!thread) {
+      std::unique_ptr<TimelineNode> new_thread(
+          new TimelineThread("SampledThread", sample.thread_id));
+      thread = new_thread.get();
+      threads.push_back(std::make_pair(sample.thread_id, thread));
+      root->AddChild(std::move(new_thread));
+    }
+
+    Json::Value args(Json::objectValue);
+    args["scope"] = sample.scope_name;
+    Json::Value stack(Json::arrayValue);
+    for (const std::string& frame : sample.frames)
+      stack.append(frame);
+    args["stack"] = stack;
+
+    const std::string& name =
+        sample.frames.empty() ? sample.scope_name : sample.frames.front();
+    FindInnermostNode(thread, sample.time_micros)->InsertChild(
+        std::unique_ptr<TimelineNode>(
+            new TimelineSample(name, sample.time_micros, args)));
+  }
+}
+
+#undef ION_SAMPLING_PROFILER_POSIX
+
+}  // namespace profile
+}  // namespace ion
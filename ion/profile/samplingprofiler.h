@@ -0,0 +1,174 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef ION_PROFILE_SAMPLINGPROFILER_H_
+#define ION_PROFILE_SAMPLINGPROFILER_H_
+
+// This file contains a statistical CPU profiler that complements the
+// instrumented scopes recorded by CallTraceManager.
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/integral_types.h"
+#include "base/macros.h"
+#include "ion/port/mutex.h"
+#include "ion/port/threadutils.h"
+#include "ion/profile/timelinenode.h"
+
+namespace ion {
+namespace profile {
+
+class CallTraceManager;
+
+// SamplingProfiler periodically interrupts the process with SIGPROF (driven by
+// an ITIMER_PROF interval timer, so only CPU time is sampled) and records the
+// call stack of whichever thread was running. Each sample is attributed to the
+// innermost instrumented scope (see ScopedTracer and ION_PROFILE_FUNCTION)
+// that was open on that thread, which makes code that nobody annotated visible
+// underneath the scopes that called it.
+//
+// Samples are stored in a fixed-size buffer that is allocated when profiling
+// starts, so recording a sample never allocates memory. Once the buffer is
+// full, further samples are counted as dropped. Only one SamplingProfiler can
+// be running in a process at a time, since the signal is process-wide.
+//
+// The recorded samples can be exported as flame-graph data, either in the
+// "folded stacks" text format used by flamegraph.pl or as a JSON tree, and are
+// merged into the Timeline built by CallTraceManager::BuildTimeline() as
+// TimelineSample nodes.
+//
+// Sampling is supported on Linux and Mac; elsewhere Start() returns false.
+class ION_API SamplingProfiler {
+ public:
+  // The maximum number of stack frames recorded per sample.
+  static const int kMaxStackDepth = 32;
+  // The default number of samples the buffer can hold.
+  static const size_t kDefaultCapacity = 16 * 1024;
+
+  // Gets the SamplingProfiler singleton instance, which attributes samples
+  // using the global CallTraceManager.
+  static SamplingProfiler* Get();
+
+  SamplingProfiler();
+  // For internal use and testing purposes only. User code should only
+  // call the default constructor.
+  explicit SamplingProfiler(CallTraceManager* manager);
+
+  ~SamplingProfiler();
+
+  // Returns whether sampling is supported on this platform.
+  static bool IsSupported();
+
+  // Starts sampling |frequency_hz| times per second of CPU time, discarding
+  // any previously recorded samples. Returns false if sampling is not
+  // supported, another profiler is already running, or the timer could not be
+  // set.
+  bool Start(uint32 frequency_hz);
+
+  // Stops sampling. The recorded samples remain available.
+  void Stop();
+
+  // Returns whether this profiler is currently sampling.
+  bool IsRunning() const;
+
+  // Sets/returns the number of samples that the buffer can hold. A new
+  // capacity takes effect at the next Start().
+  void SetCapacity(size_t capacity);
+  size_t GetCapacity() const { return capacity_; }
+
+  // Returns the number of samples recorded since the last Start().
+  size_t GetSampleCount() const;
+
+  // Returns the number of samples that were dropped because the buffer was
+  // full.
+  size_t GetDroppedSampleCount() const { return dropped_samples_; }
+
+  // Returns the recorded samples in the "folded stacks" format, one line per
+  // distinct stack: "scope;outermost_frame;...;innermost_frame count". The
+  // first element is the attributed scope name, or "[unscoped]" if no
+  // instrumented scope was open.
+  std::string GetFoldedStacks() const;
+
+  // Returns the recorded samples as a JSON flame-graph tree where each node
+  // has "name", "value" (number of samples) and "children" members. The
+  // children of the root are the attributed scopes.
+  std::string GetFlameGraphJson() const;
+
+  // Adds a TimelineSample for each recorded sample to the TimelineThread
+  // children of |root| whose thread id matches the sampled thread. Each sample
+  // becomes a child of the innermost event that contains its timestamp.
+  // Samples of threads that have no TimelineThread under |root| are added
+  // under new threads named "SampledThread".
+  void AddSamplesToTimeline(TimelineNode* root) const;
+
+ private:
+  // A single recorded sample. |depth| is written last, so a sample with a
+  // depth of zero is incomplete or empty and is ignored.
+  struct Sample {
+    uint32 time_micros;
+    uint32 scope_event;
+    port::ThreadId thread_id;
+    void* frames[kMaxStackDepth];
+    std::atomic<int> depth;
+  };
+
+  // A sample whose frames have been converted to symbol names.
+  struct SymbolizedSample;
+
+  // Records a sample of the current thread. Called from the signal handler.
+  void RecordSample();
+
+  // Returns all complete samples with their stacks symbolized, innermost frame
+  // first, with the frames belonging to the profiler itself removed.
+  void GetSymbolizedSamples(std::vector<SymbolizedSample>* samples) const;
+
+  // The signal handler that is installed while a profiler is running.
+  static void HandleSignal(int signal_number);
+
+  // The CallTraceManager used for timestamps and scope attribution.
+  CallTraceManager* manager_;
+
+  // Sample storage, which holds |buffer_size_| samples. It is only allocated
+  // and freed while the profiler is not running.
+  std::unique_ptr<Sample[]> samples_;
+  size_t buffer_size_;
+  // The capacity used for the next Start().
+  size_t capacity_;
+  // The index of the next sample to record, which keeps increasing past
+  // |buffer_size_| once the buffer is full.
+  std::atomic<size_t> next_sample_;
+  std::atomic<size_t> dropped_samples_;
+
+  // Protects the sample storage from being reallocated while it is read.
+  mutable port::Mutex mutex_;
+
+  // The profiler that the signal handler records into, if any.
+  static std::atomic<SamplingProfiler*> s_running_profiler_;
+  // The number of signal handlers currently executing, used by Stop() to
+  // wait until no handler can still be writing a sample.
+  static std::atomic<int> s_handlers_in_flight_;
+
+  DISALLOW_COPY_AND_ASSIGN(SamplingProfiler);
+};
+
+}  // namespace profile
+}  // namespace ion
+
+#endif  // ION_PROFILE_SAMPLINGPROFILER_H_
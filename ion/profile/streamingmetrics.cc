@@ -0,0 +1,241 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/profile/streamingmetrics.h"
+
+#include <algorithm>
+#include <set>
+
+#include "ion/base/lockguards.h"
+#include "ion/profile/calltracemanager.h"
+#include "third_party/jsoncpp/include/json/json.h"
+
+namespace ion {
+namespace profile {
+
+using analytics::Benchmark;
+
+namespace {
+
+static const char kScopeGroup[] = "Scope durations";
+static const char kFrameName[] = "Frame";
+
+// Adds the statistics of |summary| to |benchmark| using |name| as id.
+static void AddSummaryToBenchmark(const std::string& name,
+                                  const std::string& description,
+                                  const StreamingMetrics::Summary& summary,
+                                  Benchmark* benchmark) {
+  static const double kMsPerUs = 0.001;
+  benchmark->AddAccumulatedVariable(Benchmark::AccumulatedVariable(
+      Benchmark::Descriptor(name, kScopeGroup, description, "ms"),
+      static_cast<size_t>(summary.count), summary.minimum * kMsPerUs,
+      summary.maximum * kMsPerUs, summary.mean * kMsPerUs,
+      summary.standard_deviation * kMsPerUs));
+  const struct {
+    const char* suffix;
+    uint32 value;
+  } percentiles[] = {
+      {" p50", summary.p50}, {" p95", summary.p95}, {" p99", summary.p99}};
+  for (const auto& percentile : percentiles) {
+    benchmark->AddConstant(Benchmark::Constant(
+        Benchmark::Descriptor(name + percentile.suffix, kScopeGroup,
+                              description + percentile.suffix, "ms"),
+        percentile.value * kMsPerUs));
+  }
+}
+
+// Returns |summary| as a JSON object.
+static Json::Value SummaryToJson(const StreamingMetrics::Summary& summary) {
+  Json::Value json(Json::objectValue);
+  json["count"] = static_cast<Json::UInt64>(summary.count);
+  json["min"] = summary.minimum;
+  json["max"] = summary.maximum;
+  json["mean"] = summary.mean;
+  json["stddev"] = summary.standard_deviation;
+  json["p50"] = summary.p50;
+  json["p95"] = summary.p95;
+  json["p99"] = summary.p99;
+  return json;
+}
+
+}  // anonymous namespace
+
+StreamingMetrics::ThreadHistograms::ThreadHistograms(
+    const CallTraceManager* manager, const StreamingMetrics* metrics)
+    : manager_(manager),
+      metrics_(metrics),
+      generation_(metrics->reset_generation_.load(std::memory_order_acquire)) {}
+
+StreamingMetrics::ThreadHistograms::~ThreadHistograms() {}
+
+void StreamingMetrics::ThreadHistograms::ApplyReset() {
+  const uint64 generation =
+      metrics_->reset_generation_.load(std::memory_order_acquire);
+  if (generation == generation_.load(std::memory_order_relaxed))
+    return;
+  base::LockGuard guard(&mutex_);
+  for (const auto& scope : scopes_) {
+    if (scope)
+      scope->histogram.Clear();
+  }
+  frames_.Clear();
+  generation_.store(generation, std::memory_order_release);
+}
+
+bool StreamingMetrics::ThreadHistograms::IsCurrent() const {
+  return generation_.load(std::memory_order_acquire) ==
+         metrics_->reset_generation_.load(std::memory_order_acquire);
+}
+
+void StreamingMetrics::ThreadHistograms::RecordScope(uint32 event_id,
+                                                     uint32 duration_us) {
+  if (event_id < CallTraceManager::kCustomScopeEvent)
+    return;
+  ApplyReset();
+  const size_t index = event_id - CallTraceManager::kCustomScopeEvent;
+  if (index >= scopes_.size() || !scopes_[index]) {
+    // This is the first time this thread leaves this scope.
+    base::LockGuard guard(&mutex_);
+    if (index >= scopes_.size())
+      scopes_.resize(index + 1U);
+    scopes_[index].reset(
+        new ScopeHistogram(manager_->GetScopeEnterEventName(event_id)));
+  }
+  scopes_[index]->histogram.Record(duration_us);
+}
+
+void StreamingMetrics::ThreadHistograms::RecordFrame(uint32 duration_us) {
+  ApplyReset();
+  frames_.Record(duration_us);
+}
+
+StreamingMetrics::StreamingMetrics(const CallTraceManager* manager)
+    : manager_(manager),
+      enabled_(false),
+      reset_generation_(0U) {}
+
+StreamingMetrics::~StreamingMetrics() {}
+
+StreamingMetrics::ThreadHistograms*
+StreamingMetrics::CreateThreadHistograms() {
+  ThreadHistograms* histograms = new ThreadHistograms(manager_, this);
+  base::LockGuard guard(&mutex_);
+  threads_.push_back(std::unique_ptr<ThreadHistograms>(histograms));
+  return histograms;
+}
+
+void StreamingMetrics::Reset() {
+  // The histograms are only written by their recording threads, so they clear
+  // them when they see the new generation.
+  reset_generation_.fetch_add(1U, std::memory_order_acq_rel);
+}
+
+std::vector<std::string> StreamingMetrics::GetScopeNames() const {
+  std::set<std::string> names;
+  base::LockGuard guard(&mutex_);
+  for (const auto& thread : threads_) {
+    base::LockGuard thread_guard(&thread->mutex_);
+    if (!thread->IsCurrent())
+      continue;
+    for (const auto& scope : thread->scopes_) {
+      if (scope && scope->histogram.GetCount())
+        names.insert(scope->name);
+    }
+  }
+  return std::vector<std::string>(names.begin(), names.end());
+}
+
+void StreamingMetrics::GetScopeHistogram(const std::string& name,
+                                         LatencyHistogram* histogram) const {
+  DCHECK(histogram);
+  base::LockGuard guard(&mutex_);
+  for (const auto& thread : threads_) {
+    base::LockGuard thread_guard(&thread->mutex_);
+    if (!thread->IsCurrent())
+      continue;
+    for (const auto& scope : thread->scopes_) {
+      if (scope && name == scope->name)
+        histogram->Merge(scope->histogram);
+    }
+  }
+}
+
+void StreamingMetrics::GetFrameHistogram(LatencyHistogram* histogram) const {
+  DCHECK(histogram);
+  base::LockGuard guard(&mutex_);
+  for (const auto& thread : threads_) {
+    base::LockGuard thread_guard(&thread->mutex_);
+    if (thread->IsCurrent())
+      histogram->Merge(thread->frames_);
+  }
+}
+
+StreamingMetrics::Summary StreamingMetrics::GetScopeSummary(
+    const std::string& name) const {
+  LatencyHistogram histogram;
+  GetScopeHistogram(name, &histogram);
+  return Summarize(histogram);
+}
+
+StreamingMetrics::Summary StreamingMetrics::GetFrameSummary() const {
+  LatencyHistogram histogram;
+  GetFrameHistogram(&histogram);
+  return Summarize(histogram);
+}
+
+Benchmark StreamingMetrics::GetBenchmark() const {
+  Benchmark benchmark;
+  const Summary frames = GetFrameSummary();
+  if (frames.count)
+    AddSummaryToBenchmark(kFrameName, "Frame duration", frames, &benchmark);
+  const std::vector<std::string> names = GetScopeNames();
+  for (const std::string& name : names) {
+    AddSummaryToBenchmark(name, "Duration of scope " + name,
+                          GetScopeSummary(name), &benchmark);
+  }
+  return benchmark;
+}
+
+std::string StreamingMetrics::GetJson() const {
+  Json::Value json(Json::objectValue);
+  json["enabled"] = IsEnabled();
+  json["frames"] = SummaryToJson(GetFrameSummary());
+  Json::Value scopes(Json::objectValue);
+  const std::vector<std::string> names = GetScopeNames();
+  for (const std::string& name : names)
+    scopes[name] = SummaryToJson(GetScopeSummary(name));
+  json["scopes"] = scopes;
+  Json::FastWriter json_writer;
+  return json_writer.write(json);
+}
+
+StreamingMetrics::Summary StreamingMetrics::Summarize(
+    const LatencyHistogram& histogram) {
+  Summary summary;
+  summary.count = histogram.GetCount();
+  summary.minimum = histogram.GetMinimum();
+  summary.maximum = histogram.GetMaximum();
+  summary.mean = histogram.GetMean();
+  summary.standard_deviation = histogram.GetStandardDeviation();
+  summary.p50 = histogram.GetPercentile(50.0);
+  summary.p95 = histogram.GetPercentile(95.0);
+  summary.p99 = histogram.GetPercentile(99.0);
+  return summary;
+}
+
+}  // namespace profile
+}  // namespace ion
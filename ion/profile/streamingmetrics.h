@@ -0,0 +1,173 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef ION_PROFILE_STREAMINGMETRICS_H_
+#define ION_PROFILE_STREAMINGMETRICS_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/integral_types.h"
+#include "base/macros.h"
+#include "ion/analytics/benchmark.h"
+#include "ion/port/atomic.h"
+#include "ion/port/mutex.h"
+#include "ion/profile/latencyhistogram.h"
+
+namespace ion {
+namespace profile {
+
+class CallTraceManager;
+
+// StreamingMetrics maintains latency histograms of scope and frame durations
+// as TraceRecorders record them, so that percentile statistics are available
+// at any time without building a Timeline (compare with TimelineMetric, which
+// runs offline over a complete Timeline).
+//
+// Each TraceRecorder owns a ThreadHistograms instance that only its own thread
+// writes to, so recording does not take any locks. Queries merge the
+// histograms of all threads; scopes are identified by name, so scopes with the
+// same name from different call sites are combined. Reset() does not touch the
+// histograms either; it starts a new generation, which each thread applies by
+// clearing its own histograms the next time it records.
+//
+// Recording is disabled by default, since every distinct scope costs a few
+// kilobytes of histogram storage per thread.
+class ION_API StreamingMetrics {
+ public:
+  // Summary statistics of a histogram. Durations are in microseconds.
+  struct Summary {
+    Summary()
+        : count(0U), minimum(0U), maximum(0U), mean(0.0),
+          standard_deviation(0.0), p50(0U), p95(0U), p99(0U) {}
+    uint64 count;
+    uint32 minimum;
+    uint32 maximum;
+    double mean;
+    double standard_deviation;
+    uint32 p50;
+    uint32 p95;
+    uint32 p99;
+  };
+
+  // The histograms of a single TraceRecorder. All Record functions must be
+  // called from the thread that the recorder traces.
+  class ION_API ThreadHistograms {
+   public:
+    ~ThreadHistograms();
+
+    // Records the duration of a scope with the given scope enter event id.
+    void RecordScope(uint32 event_id, uint32 duration_us);
+
+    // Records the duration of a frame.
+    void RecordFrame(uint32 duration_us);
+
+   private:
+    // A histogram and the name of the scope it measures.
+    struct ScopeHistogram {
+      explicit ScopeHistogram(const char* name_in) : name(name_in) {}
+      const char* name;
+      LatencyHistogram histogram;
+    };
+
+    ThreadHistograms(const CallTraceManager* manager,
+                     const StreamingMetrics* metrics);
+
+    // Clears the histograms if StreamingMetrics::Reset() was called since
+    // they were last cleared.
+    void ApplyReset();
+
+    // Returns whether the histograms hold durations of the current generation.
+    // Queries skip the histograms of threads that have not applied a reset.
+    bool IsCurrent() const;
+
+    // Used to look up scope names.
+    const CallTraceManager* manager_;
+    // The owner, whose reset generation is applied when recording.
+    const StreamingMetrics* metrics_;
+    // The reset generation of the histograms. Written by the recording thread
+    // while holding |mutex_|.
+    std::atomic<uint64> generation_;
+    // Histograms indexed by scope event id minus
+    // CallTraceManager::kCustomScopeEvent. Entries are created lazily by the
+    // recording thread while holding |mutex_|, which readers also hold.
+    std::vector<std::unique_ptr<ScopeHistogram>> scopes_;
+    LatencyHistogram frames_;
+    port::Mutex mutex_;
+
+    friend class StreamingMetrics;
+    DISALLOW_COPY_AND_ASSIGN(ThreadHistograms);
+  };
+
+  explicit StreamingMetrics(const CallTraceManager* manager);
+  ~StreamingMetrics();
+
+  // Sets/returns whether TraceRecorders record durations into the histograms.
+  void SetEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+  bool IsEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // Returns a new ThreadHistograms instance that is owned by this.
+  ThreadHistograms* CreateThreadHistograms();
+
+  // Removes all recorded durations. Threads may be recording concurrently;
+  // each one clears its own histograms before it next records.
+  void Reset();
+
+  // Returns the names of all scopes that have recorded durations, sorted
+  // alphabetically.
+  std::vector<std::string> GetScopeNames() const;
+
+  // Adds all durations recorded for the scope named |name| or for frames to
+  // |histogram|.
+  void GetScopeHistogram(const std::string& name,
+                         LatencyHistogram* histogram) const;
+  void GetFrameHistogram(LatencyHistogram* histogram) const;
+
+  // Returns the summary of the durations of the named scope or of frames.
+  Summary GetScopeSummary(const std::string& name) const;
+  Summary GetFrameSummary() const;
+
+  // Returns a Benchmark containing an AccumulatedVariable and p50, p95 and p99
+  // Constants (in milliseconds) for frames and each scope.
+  analytics::Benchmark GetBenchmark() const;
+
+  // Returns all summaries in JSON format, as an object with a "frames" member
+  // and a "scopes" member that maps scope names to summaries.
+  std::string GetJson() const;
+
+  // Returns the summary of |histogram|.
+  static Summary Summarize(const LatencyHistogram& histogram);
+
+ private:
+  const CallTraceManager* manager_;
+  std::atomic<bool> enabled_;
+  // Incremented by Reset().
+  std::atomic<uint64> reset_generation_;
+  // Protects |threads_|.
+  mutable port::Mutex mutex_;
+  std::vector<std::unique_ptr<ThreadHistograms>> threads_;
+
+  DISALLOW_COPY_AND_ASSIGN(StreamingMetrics);
+};
+
+}  // namespace profile
+}  // namespace ion
+
+#endif  // ION_PROFILE_STREAMINGMETRICS_H_
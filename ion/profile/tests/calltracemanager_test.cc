@@ -27,6 +27,7 @@ limitations under the License.
 #include "ion/analytics/benchmark.h"
 #include "ion/base/serialize.h"
 #include "ion/base/stringutils.h"
+#include "ion/base/taskscheduler.h"
 #include "ion/base/threadspawner.h"
 #include "ion/gfx/tests/mockgraphicsmanager.h"
 #include "ion/gfx/tests/mockvisual.h"
@@ -35,6 +36,7 @@ limitations under the License.
 #include "ion/port/fileutils.h"
 #include "ion/port/threadutils.h"
 #include "ion/port/timer.h"
+#include "ion/profile/profiling.h"
 #include "ion/profile/timeline.h"
 #include "ion/profile/timelineevent.h"
 #include "ion/profile/timelineframe.h"
@@ -744,6 +746,22 @@ TEST_F(CallTraceTest, BasicRecord) {
   EXPECT_EQ(4U, GetTraceRecorder()->GetNumTraces());
 }
 
+TEST_F(CallTraceTest, TaskSchedulerTracing) {
+  // A scheduler without threads runs tasks on the thread that waits for them.
+  base::TaskScheduler scheduler(0U);
+  EnableTaskSchedulerTracing(&scheduler, call_trace_manager_.get());
+  int runs = 0;
+  {
+    base::TaskScheduler::TaskGroup group(&scheduler, "Traced task");
+    group.Run([&runs]() { ++runs; });
+    group.Run([&runs]() { ++runs; });
+    group.Wait();
+  }
+  EXPECT_EQ(2, runs);
+  EXPECT_EQ(1U, GetNumScopeEvents());
+  EXPECT_EQ(4U, GetTraceRecorder()->GetNumTraces());
+}
+
 TEST_F(CallTraceTest, BasicGpuRecordEnabled) {
   EXPECT_TRUE(AllowGpuTracing());
   EnableGpuTracing();
@@ -0,0 +1,135 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/profile/latencyhistogram.h"
+
+#include <limits>
+
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace profile {
+
+TEST(LatencyHistogram, Buckets) {
+  // Small values have their own buckets.
+  for (uint32 i = 0; i < LatencyHistogram::kSubBucketCount; ++i) {
+    EXPECT_EQ(static_cast<int>(i), LatencyHistogram::GetBucketIndex(i));
+    EXPECT_EQ(i, LatencyHistogram::GetBucketLowerBound(static_cast<int>(i)));
+    EXPECT_EQ(i, LatencyHistogram::GetBucketUpperBound(static_cast<int>(i)));
+  }
+
+  // The buckets are contiguous and cover all uint32 values.
+  for (int i = 1; i < LatencyHistogram::kBucketCount; ++i) {
+    EXPECT_EQ(LatencyHistogram::GetBucketUpperBound(i - 1) + 1U,
+              LatencyHistogram::GetBucketLowerBound(i));
+    EXPECT_EQ(i, LatencyHistogram::GetBucketIndex(
+        LatencyHistogram::GetBucketLowerBound(i)));
+    EXPECT_EQ(i, LatencyHistogram::GetBucketIndex(
+        LatencyHistogram::GetBucketUpperBound(i)));
+  }
+  EXPECT_EQ(std::numeric_limits<uint32>::max(),
+            LatencyHistogram::GetBucketUpperBound(
+                LatencyHistogram::kBucketCount - 1));
+
+  // The relative width of a bucket is bounded.
+  EXPECT_EQ(64, LatencyHistogram::GetBucketIndex(64U));
+  EXPECT_EQ(64, LatencyHistogram::GetBucketIndex(65U));
+  EXPECT_EQ(65, LatencyHistogram::GetBucketIndex(66U));
+  EXPECT_EQ(992U, LatencyHistogram::GetBucketLowerBound(
+      LatencyHistogram::GetBucketIndex(1000U)));
+  EXPECT_EQ(1007U, LatencyHistogram::GetBucketUpperBound(
+      LatencyHistogram::GetBucketIndex(1000U)));
+}
+
+TEST(LatencyHistogram, Statistics) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0U, histogram.GetCount());
+  EXPECT_EQ(0U, histogram.GetMinimum());
+  EXPECT_EQ(0U, histogram.GetMaximum());
+  EXPECT_EQ(0.0, histogram.GetMean());
+  EXPECT_EQ(0.0, histogram.GetStandardDeviation());
+  EXPECT_EQ(0U, histogram.GetPercentile(50.0));
+
+  histogram.Record(7U);
+  EXPECT_EQ(1U, histogram.GetCount());
+  EXPECT_EQ(7U, histogram.GetMinimum());
+  EXPECT_EQ(7U, histogram.GetMaximum());
+  EXPECT_EQ(7.0, histogram.GetMean());
+  EXPECT_EQ(0.0, histogram.GetStandardDeviation());
+  EXPECT_EQ(7U, histogram.GetPercentile(0.0));
+  EXPECT_EQ(7U, histogram.GetPercentile(100.0));
+
+  histogram.Clear();
+  EXPECT_EQ(0U, histogram.GetCount());
+  EXPECT_EQ(0U, histogram.GetMinimum());
+
+  // Record 1 to 1000.
+  for (uint32 i = 1; i <= 1000U; ++i)
+    histogram.Record(i);
+  EXPECT_EQ(1000U, histogram.GetCount());
+  EXPECT_EQ(1U, histogram.GetMinimum());
+  EXPECT_EQ(1000U, histogram.GetMaximum());
+  EXPECT_DOUBLE_EQ(500.5, histogram.GetMean());
+  EXPECT_NEAR(288.675, histogram.GetStandardDeviation(), 0.001);
+
+  // Percentiles are accurate to within the bucket width.
+  const double kRelativeError = 1.0 / LatencyHistogram::kSubBucketCount;
+  EXPECT_NEAR(500.0, histogram.GetPercentile(50.0), 500.0 * kRelativeError);
+  EXPECT_NEAR(950.0, histogram.GetPercentile(95.0), 950.0 * kRelativeError);
+  EXPECT_NEAR(990.0, histogram.GetPercentile(99.0), 990.0 * kRelativeError);
+  EXPECT_LE(500U, histogram.GetPercentile(50.0));
+  EXPECT_EQ(1000U, histogram.GetPercentile(100.0));
+  EXPECT_EQ(1U, histogram.GetPercentile(0.0));
+}
+
+TEST(LatencyHistogram, LargeValues) {
+  LatencyHistogram histogram;
+  const uint32 kMax = std::numeric_limits<uint32>::max();
+  histogram.Record(kMax);
+  histogram.Record(kMax);
+  EXPECT_EQ(kMax, histogram.GetMaximum());
+  EXPECT_EQ(kMax, histogram.GetPercentile(50.0));
+  EXPECT_DOUBLE_EQ(static_cast<double>(kMax), histogram.GetMean());
+}
+
+TEST(LatencyHistogram, Merge) {
+  LatencyHistogram a;
+  LatencyHistogram b;
+  a.Record(10U);
+  a.Record(20U);
+  b.Record(5U);
+  b.Record(3000U);
+
+  LatencyHistogram merged;
+  merged.Merge(a);
+  merged.Merge(b);
+  EXPECT_EQ(4U, merged.GetCount());
+  EXPECT_EQ(5U, merged.GetMinimum());
+  EXPECT_EQ(3000U, merged.GetMaximum());
+  EXPECT_DOUBLE_EQ(758.75, merged.GetMean());
+  EXPECT_EQ(10U, merged.GetPercentile(50.0));
+  EXPECT_EQ(3000U, merged.GetPercentile(100.0));
+
+  // Merging an empty histogram changes nothing.
+  LatencyHistogram empty;
+  merged.Merge(empty);
+  EXPECT_EQ(4U, merged.GetCount());
+  EXPECT_EQ(5U, merged.GetMinimum());
+}
+
+}  // namespace profile
+}  // namespace ion
@@ -24,6 +24,9 @@
       'includes': [ '../../dev/test_target.gypi' ],
       'sources' : [
         'calltracemanager_test.cc',
+        'latencyhistogram_test.cc',
+        'samplingprofiler_test.cc',
+        'streamingmetrics_test.cc',
         'timelinesearch_test.cc',
         'timeline_test.cc',
       ],
@@ -0,0 +1,185 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/profile/samplingprofiler.h"
+
+#include <memory>
+#include <string>
+
+#include "ion/port/timer.h"
+#include "ion/profile/calltracemanager.h"
+#include "ion/profile/timeline.h"
+#include "ion/profile/timelineevent.h"
+#include "ion/profile/timelinenode.h"
+#include "ion/profile/timelinesample.h"
+#include "ion/profile/tracerecorder.h"
+
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace profile {
+
+namespace {
+
+// Keeps the CPU busy inside an instrumented scope named "BusyScope" until
+// |profiler| has recorded |min_samples| samples or a few seconds have passed.
+static void BusyLoop(CallTraceManager* manager, SamplingProfiler* profiler,
+                     size_t min_samples) {
+  ScopedTracer scope(manager->GetTraceRecorder(),
+                     manager->GetScopeEnterEvent("BusyScope"));
+  port::Timer timer;
+  volatile uint32 value = 0;
+  while (profiler->GetSampleCount() < min_samples && timer.GetInS() < 5.0) {
+    for (int i = 0; i < 100000; ++i)
+      value = value * 31U + i;
+  }
+}
+
+}  // anonymous namespace
+
+TEST(SamplingProfiler, StartStop) {
+  CallTraceManager manager;
+  SamplingProfiler profiler(&manager);
+  EXPECT_EQ(&profiler, manager.GetSamplingProfiler());
+  EXPECT_FALSE(profiler.IsRunning());
+  EXPECT_EQ(SamplingProfiler::kDefaultCapacity, profiler.GetCapacity());
+  EXPECT_EQ(0U, profiler.GetSampleCount());
+  EXPECT_EQ("", profiler.GetFoldedStacks());
+
+  // A frequency of zero is invalid.
+  EXPECT_FALSE(profiler.Start(0U));
+  EXPECT_FALSE(profiler.IsRunning());
+
+  if (!SamplingProfiler::IsSupported()) {
+    EXPECT_FALSE(profiler.Start(1000U));
+    return;
+  }
+
+  EXPECT_TRUE(profiler.Start(1000U));
+  EXPECT_TRUE(profiler.IsRunning());
+
+  // Only one profiler can run at a time.
+  {
+    CallTraceManager other_manager;
+    SamplingProfiler other(&other_manager);
+    EXPECT_FALSE(other.Start(1000U));
+    EXPECT_FALSE(other.IsRunning());
+  }
+  EXPECT_TRUE(profiler.IsRunning());
+
+  profiler.Stop();
+  EXPECT_FALSE(profiler.IsRunning());
+  // Stopping twice is harmless.
+  profiler.Stop();
+  EXPECT_FALSE(profiler.IsRunning());
+}
+
+TEST(SamplingProfiler, DetachesFromManager) {
+  CallTraceManager manager;
+  {
+    SamplingProfiler profiler(&manager);
+    EXPECT_EQ(&profiler, manager.GetSamplingProfiler());
+  }
+  EXPECT_TRUE(manager.GetSamplingProfiler() == NULL);
+}
+
+TEST(SamplingProfiler, RecordsScopedSamples) {
+  if (!SamplingProfiler::IsSupported())
+    return;
+
+  CallTraceManager manager;
+  SamplingProfiler profiler(&manager);
+  ASSERT_TRUE(profiler.Start(1000U));
+  BusyLoop(&manager, &profiler, 20U);
+  profiler.Stop();
+
+  const size_t count = profiler.GetSampleCount();
+  EXPECT_LT(0U, count);
+  EXPECT_EQ(0U, profiler.GetDroppedSampleCount());
+
+  // Samples taken in the busy loop are attributed to its scope.
+  const std::string folded = profiler.GetFoldedStacks();
+  EXPECT_EQ(0U, folded.find("BusyScope;")) << folded;
+  // The profiler's own frames are not part of the stacks.
+  EXPECT_EQ(std::string::npos, folded.find("RecordSample")) << folded;
+
+  const std::string json = profiler.GetFlameGraphJson();
+  EXPECT_NE(std::string::npos, json.find("\"name\":\"root\"")) << json;
+  EXPECT_NE(std::string::npos, json.find("\"name\":\"BusyScope\"")) << json;
+
+  // The samples are merged into the timeline inside the busy loop scope.
+  const Timeline timeline = manager.BuildTimeline();
+  size_t sample_count = 0;
+  for (const TimelineNode* node : timeline) {
+    if (node->GetType() == TimelineNode::Type::kSample) {
+      ++sample_count;
+      EXPECT_EQ(0U, node->GetDuration());
+      ASSERT_TRUE(node->GetParent() != NULL);
+      EXPECT_EQ("BusyScope", node->GetParent()->GetName());
+      const TimelineEvent* event = static_cast<const TimelineEvent*>(node);
+      EXPECT_EQ("BusyScope", event->GetArgs()["scope"].asString());
+    }
+  }
+  EXPECT_LT(0U, sample_count);
+  EXPECT_GE(count, sample_count);
+}
+
+TEST(SamplingProfiler, DropsSamplesWhenFull) {
+  if (!SamplingProfiler::IsSupported())
+    return;
+
+  CallTraceManager manager;
+  SamplingProfiler profiler(&manager);
+  profiler.SetCapacity(2U);
+  EXPECT_EQ(2U, profiler.GetCapacity());
+  ASSERT_TRUE(profiler.Start(1000U));
+  BusyLoop(&manager, &profiler, 2U);
+  // Keep sampling for a while after the buffer is full.
+  port::Timer timer;
+  volatile uint32 value = 0;
+  while (profiler.GetDroppedSampleCount() == 0U && timer.GetInS() < 5.0)
+    value = value + 1U;
+  profiler.Stop();
+
+  EXPECT_EQ(2U, profiler.GetSampleCount());
+  EXPECT_LT(0U, profiler.GetDroppedSampleCount());
+
+  // Restarting discards the previous samples.
+  ASSERT_TRUE(profiler.Start(1000U));
+  profiler.Stop();
+  EXPECT_GE(2U, profiler.GetSampleCount());
+  EXPECT_EQ(0U, profiler.GetDroppedSampleCount());
+}
+
+TEST(SamplingProfiler, InsertChildKeepsOrder) {
+  TimelineNode root("root", 0, 100);
+  root.InsertChild(std::unique_ptr<TimelineNode>(
+      new TimelineSample("b", 20, Json::Value(Json::objectValue))));
+  root.InsertChild(std::unique_ptr<TimelineNode>(
+      new TimelineSample("a", 10, Json::Value(Json::objectValue))));
+  root.InsertChild(std::unique_ptr<TimelineNode>(
+      new TimelineSample("c", 20, Json::Value(Json::objectValue))));
+  ASSERT_EQ(3U, root.GetChildren().size());
+  EXPECT_EQ("a", root.GetChildren()[0]->GetName());
+  EXPECT_EQ("b", root.GetChildren()[1]->GetName());
+  EXPECT_EQ("c", root.GetChildren()[2]->GetName());
+  EXPECT_EQ(&root, root.GetChildren()[0]->GetParent());
+  EXPECT_EQ(TimelineNode::Type::kSample, root.GetChildren()[0]->GetType());
+}
+
+}  // namespace profile
+}  // namespace ion
@@ -0,0 +1,218 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/profile/streamingmetrics.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "ion/base/threadspawner.h"
+#include "ion/profile/calltracemanager.h"
+#include "ion/profile/tracerecorder.h"
+
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+#include "third_party/jsoncpp/include/json/json.h"
+
+namespace ion {
+namespace profile {
+
+namespace {
+
+// Records |count| scopes named "Work" with durations 1, 2, ..., |count|
+// microseconds, nested inside an "Outer" scope.
+static bool RecordScopes(CallTraceManager* manager, uint32 count) {
+  TraceRecorder* recorder = manager->GetTraceRecorder();
+  const int outer_id = manager->GetScopeEnterEvent("Outer");
+  const int work_id = manager->GetScopeEnterEvent("Work");
+  uint32 time = 0U;
+  recorder->EnterScopeAtTime(time, outer_id);
+  for (uint32 i = 1U; i <= count; ++i) {
+    recorder->EnterScopeAtTime(time, work_id);
+    time += i;
+    recorder->LeaveScopeAtTime(time);
+  }
+  recorder->LeaveScopeAtTime(time);
+  return true;
+}
+
+}  // anonymous namespace
+
+TEST(StreamingMetrics, DisabledByDefault) {
+  CallTraceManager manager;
+  StreamingMetrics* metrics = manager.GetStreamingMetrics();
+  EXPECT_FALSE(metrics->IsEnabled());
+  RecordScopes(&manager, 10U);
+  EXPECT_TRUE(metrics->GetScopeNames().empty());
+  EXPECT_EQ(0U, metrics->GetScopeSummary("Work").count);
+  EXPECT_TRUE(metrics->GetBenchmark().GetAccumulatedVariables().empty());
+}
+
+TEST(StreamingMetrics, RecordScopes) {
+  CallTraceManager manager;
+  StreamingMetrics* metrics = manager.GetStreamingMetrics();
+  metrics->SetEnabled(true);
+  EXPECT_TRUE(metrics->IsEnabled());
+  RecordScopes(&manager, 100U);
+
+  const std::vector<std::string> names = metrics->GetScopeNames();
+  ASSERT_EQ(2U, names.size());
+  EXPECT_EQ("Outer", names[0]);
+  EXPECT_EQ("Work", names[1]);
+
+  const StreamingMetrics::Summary work = metrics->GetScopeSummary("Work");
+  EXPECT_EQ(100U, work.count);
+  EXPECT_EQ(1U, work.minimum);
+  EXPECT_EQ(100U, work.maximum);
+  EXPECT_DOUBLE_EQ(50.5, work.mean);
+  EXPECT_EQ(50U, work.p50);
+  EXPECT_EQ(95U, work.p95);
+  EXPECT_EQ(99U, work.p99);
+
+  const StreamingMetrics::Summary outer = metrics->GetScopeSummary("Outer");
+  EXPECT_EQ(1U, outer.count);
+  EXPECT_EQ(5050U, outer.maximum);
+
+  // Unknown scopes have empty summaries.
+  EXPECT_EQ(0U, metrics->GetScopeSummary("Unknown").count);
+
+  // Nothing is recorded while disabled.
+  metrics->SetEnabled(false);
+  RecordScopes(&manager, 100U);
+  EXPECT_EQ(100U, metrics->GetScopeSummary("Work").count);
+
+  metrics->Reset();
+  EXPECT_EQ(0U, metrics->GetScopeSummary("Work").count);
+  EXPECT_TRUE(metrics->GetScopeNames().empty());
+}
+
+TEST(StreamingMetrics, RecordFrames) {
+  CallTraceManager manager;
+  StreamingMetrics* metrics = manager.GetStreamingMetrics();
+  metrics->SetEnabled(true);
+  TraceRecorder* recorder = manager.GetTraceRecorder();
+  for (uint32 i = 0; i < 5U; ++i) {
+    recorder->EnterFrame(i);
+    // Nested frames are not counted separately.
+    recorder->EnterFrame(i);
+    recorder->LeaveFrame();
+    recorder->LeaveFrame();
+  }
+  const StreamingMetrics::Summary frames = metrics->GetFrameSummary();
+  EXPECT_EQ(5U, frames.count);
+  EXPECT_LE(frames.minimum, frames.p50);
+  EXPECT_LE(frames.p50, frames.p99);
+  EXPECT_LE(frames.p99, frames.maximum);
+}
+
+TEST(StreamingMetrics, MultipleThreads) {
+  CallTraceManager manager;
+  StreamingMetrics* metrics = manager.GetStreamingMetrics();
+  metrics->SetEnabled(true);
+  {
+    port::ThreadStdFunc func1 = std::bind(RecordScopes, &manager, 10U);
+    port::ThreadStdFunc func2 = std::bind(RecordScopes, &manager, 30U);
+    base::ThreadSpawner thread1("Thread 1", func1);
+    base::ThreadSpawner thread2("Thread 2", func2);
+  }
+  EXPECT_EQ(2U, manager.GetAllTraceRecorders().size());
+
+  // The histograms of both threads are merged.
+  const StreamingMetrics::Summary work = metrics->GetScopeSummary("Work");
+  EXPECT_EQ(40U, work.count);
+  EXPECT_EQ(1U, work.minimum);
+  EXPECT_EQ(30U, work.maximum);
+  EXPECT_EQ(2U, metrics->GetScopeSummary("Outer").count);
+}
+
+TEST(StreamingMetrics, ResetWhileRecording) {
+  CallTraceManager manager;
+  StreamingMetrics* metrics = manager.GetStreamingMetrics();
+  metrics->SetEnabled(true);
+  std::atomic<bool> done(false);
+  {
+    port::ThreadStdFunc func = [&manager, &done]() {
+      while (!done.load())
+        RecordScopes(&manager, 10U);
+      return true;
+    };
+    base::ThreadSpawner thread("Recorder", func);
+    // Resetting does not write to the histograms of the recording thread.
+    for (int i = 0; i < 100; ++i) {
+      metrics->Reset();
+      metrics->GetScopeSummary("Work");
+    }
+    done.store(true);
+  }
+
+  // The histograms of the stopped thread are not reported after a reset,
+  // although it has not cleared them.
+  metrics->Reset();
+  EXPECT_EQ(0U, metrics->GetScopeSummary("Work").count);
+  EXPECT_TRUE(metrics->GetScopeNames().empty());
+
+  // A thread clears its histograms before recording after a reset.
+  RecordScopes(&manager, 10U);
+  metrics->Reset();
+  RecordScopes(&manager, 5U);
+  EXPECT_EQ(5U, metrics->GetScopeSummary("Work").count);
+  EXPECT_EQ(5U, metrics->GetScopeSummary("Work").maximum);
+  EXPECT_EQ(1U, metrics->GetScopeSummary("Outer").count);
+}
+
+TEST(StreamingMetrics, Export) {
+  CallTraceManager manager;
+  StreamingMetrics* metrics = manager.GetStreamingMetrics();
+  metrics->SetEnabled(true);
+  RecordScopes(&manager, 100U);
+  TraceRecorder* recorder = manager.GetTraceRecorder();
+  recorder->EnterFrame(0U);
+  recorder->LeaveFrame();
+
+  const analytics::Benchmark benchmark = metrics->GetBenchmark();
+  const std::vector<analytics::Benchmark::AccumulatedVariable>& variables =
+      benchmark.GetAccumulatedVariables();
+  ASSERT_EQ(3U, variables.size());
+  EXPECT_EQ("Frame", variables[0].descriptor.id);
+  EXPECT_EQ(1U, variables[0].samples);
+  EXPECT_EQ("Outer", variables[1].descriptor.id);
+  EXPECT_EQ("Work", variables[2].descriptor.id);
+  EXPECT_EQ(100U, variables[2].samples);
+  EXPECT_DOUBLE_EQ(0.001, variables[2].minimum);
+  EXPECT_DOUBLE_EQ(0.1, variables[2].maximum);
+  EXPECT_EQ("ms", variables[2].descriptor.units);
+
+  const std::vector<analytics::Benchmark::Constant>& constants =
+      benchmark.GetConstants();
+  ASSERT_EQ(9U, constants.size());
+  EXPECT_EQ("Work p50", constants[6].descriptor.id);
+  EXPECT_DOUBLE_EQ(0.05, constants[6].value);
+  EXPECT_EQ("Work p95", constants[7].descriptor.id);
+  EXPECT_EQ("Work p99", constants[8].descriptor.id);
+
+  Json::Value json;
+  Json::Reader reader;
+  ASSERT_TRUE(reader.parse(metrics->GetJson(), json));
+  EXPECT_TRUE(json["enabled"].asBool());
+  EXPECT_EQ(1U, json["frames"]["count"].asUInt());
+  EXPECT_EQ(100U, json["scopes"]["Work"]["count"].asUInt());
+  EXPECT_EQ(50U, json["scopes"]["Work"]["p50"].asUInt());
+  EXPECT_EQ(100U, json["scopes"]["Work"]["max"].asUInt());
+}
+
+}  // namespace profile
+}  // namespace ion
@@ -18,6 +18,7 @@ limitations under the License.
 #ifndef ION_PROFILE_TIMELINENODE_H_
 #define ION_PROFILE_TIMELINENODE_H_
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -28,7 +29,9 @@ limitations under the License.
 class TimelineNode {
  public:
   typedef std::vector<std::unique_ptr<TimelineNode>> Children;
-  enum class Type : char { kNode, kEvent, kThread, kFrame, kScope, kRange };
+  enum class Type : char {
+    kNode, kEvent, kThread, kFrame, kScope, kRange, kSample
+  };
 
   explicit TimelineNode(const std::string& name);
   TimelineNode(const std::string& name, const uint32 begin,
@@ -37,6 +40,9 @@ class TimelineNode {
 
   // Add a node to the children. It becomes the last child.
   void AddChild(std::unique_ptr<TimelineNode> child);
+  // Add a node to the children after all children that begin no later than
+  // it, which keeps the children sorted by begin timestamp.
+  void InsertChild(std::unique_ptr<TimelineNode> child);
   // Update the duration of the event given a new end timestamp.
   void UpdateDuration(const uint32 end) { duration_ = end - begin_; }
 
@@ -73,4 +79,15 @@ inline void TimelineNode::AddChild(std::unique_ptr<TimelineNode> child) {
   children_.push_back(std::move(child));
 }
 
+inline void TimelineNode::InsertChild(std::unique_ptr<TimelineNode> child) {
+  child->parent_ = this;
+  const uint32 begin = child->GetBegin();
+  auto pos = std::upper_bound(
+      children_.begin(), children_.end(), begin,
+      [](uint32 value, const std::unique_ptr<TimelineNode>& node) {
+        return value < node->GetBegin();
+      });
+  children_.insert(pos, std::move(child));
+}
+
 #endif  // ION_PROFILE_TIMELINENODE_H_
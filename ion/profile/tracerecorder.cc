@@ -15,6 +15,7 @@ limitations under the License.
 
 */
 
+#include <atomic>
 #include <limits>
 #include <memory>
 #include <stack>
@@ -64,10 +65,14 @@ TraceRecorder::TraceRecorder(CallTraceManager* manager)
                     GetAllocator(),
                     s_reserve_buffer_),
       scope_level_(0),
+      open_scope_events_(),
+      open_scope_times_(),
+      histograms_(manager->GetStreamingMetrics()->CreateThreadHistograms()),
       thread_id_(ion::port::GetCurrentThreadId()),
       thread_name_("UnnamedThread"),
       frame_level_(0),
-      current_frame_number_(0) {
+      current_frame_number_(0),
+      current_frame_begin_(0) {
   trace_buffer_.AddItem(kEmptyScopeMarker);
 }
 
@@ -76,10 +81,14 @@ TraceRecorder::TraceRecorder(CallTraceManager* manager, size_t buffer_size)
       trace_buffer_(
           buffer_size / sizeof(uint32), GetAllocator(), s_reserve_buffer_),
       scope_level_(0),
+      open_scope_events_(),
+      open_scope_times_(),
+      histograms_(manager->GetStreamingMetrics()->CreateThreadHistograms()),
       thread_id_(ion::port::GetCurrentThreadId()),
       thread_name_("UnnamedThread"),
       frame_level_(0),
-      current_frame_number_(0) {
+      current_frame_number_(0),
+      current_frame_begin_(0) {
   trace_buffer_.AddItem(kEmptyScopeMarker);
 }
 
@@ -99,6 +108,12 @@ void TraceRecorder::LeaveScope() {
 void TraceRecorder::EnterScopeAtTime(uint32 timestamp, int event_id) {
   trace_buffer_.AddItem(event_id);
   trace_buffer_.AddItem(timestamp);
+  if (scope_level_ < kMaxTrackedScopeDepth) {
+    open_scope_events_[scope_level_] = static_cast<uint32>(event_id);
+    open_scope_times_[scope_level_] = timestamp;
+  }
+  // Make sure a signal handler never sees the new level before the id.
+  std::atomic_signal_fence(std::memory_order_seq_cst);
   ++scope_level_;
 }
 
@@ -126,6 +141,11 @@ void TraceRecorder::LeaveScopeAtTime(uint32 timestamp) {
   trace_buffer_.AddItem(timestamp);
   DCHECK_GT(scope_level_, 0);
   --scope_level_;
+  if (scope_level_ < kMaxTrackedScopeDepth &&
+      manager_->GetStreamingMetrics()->IsEnabled()) {
+    histograms_->RecordScope(open_scope_events_[scope_level_],
+                             timestamp - open_scope_times_[scope_level_]);
+  }
   if (scope_level_ == 0) {
     trace_buffer_.AddItem(kEmptyScopeMarker);
   }
@@ -135,8 +155,9 @@ void TraceRecorder::EnterFrame(uint32 frame_number) {
   if (frame_level_ == 0) {
     // Only record the frame for the outer-most EnterFrame() call.
     current_frame_number_ = frame_number;
+    current_frame_begin_ = manager_->GetTimeInUs();
     trace_buffer_.AddItem(CallTraceManager::kFrameStartEvent);
-    trace_buffer_.AddItem(manager_->GetTimeInUs());
+    trace_buffer_.AddItem(current_frame_begin_);
     trace_buffer_.AddItem(frame_number);
   }
   ++frame_level_;
@@ -151,9 +172,12 @@ void TraceRecorder::LeaveFrame() {
   --frame_level_;
   // Only record the frame for the outer-most LeaveFrame() call.
   if (frame_level_ == 0) {
+    const uint32 timestamp = manager_->GetTimeInUs();
     trace_buffer_.AddItem(CallTraceManager::kFrameEndEvent);
-    trace_buffer_.AddItem(manager_->GetTimeInUs());
+    trace_buffer_.AddItem(timestamp);
     trace_buffer_.AddItem(current_frame_number_);
+    if (manager_->GetStreamingMetrics()->IsEnabled())
+      histograms_->RecordFrame(timestamp - current_frame_begin_);
   }
 }
 
@@ -424,6 +448,14 @@ void TraceRecorder::AddTraceToTimelineNode(TimelineNode* root) const {
   }
 }
 
+uint32 TraceRecorder::GetCurrentScopeEvent() const {
+  const int level = scope_level_;
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  if (level <= 0 || level > kMaxTrackedScopeDepth)
+    return 0;
+  return open_scope_events_[level - 1];
+}
+
 uint32 TraceRecorder::GetCurrentFrameNumber() const {
   if (!IsInFrameScope()) {
     LOG_ONCE(WARNING) << "GetCurrentFrameNumber() should not be called outside "
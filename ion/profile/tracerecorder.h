@@ -27,6 +27,7 @@ limitations under the License.
 #include "ion/base/circularbuffer.h"
 #include "ion/base/stlalloc/allocvector.h"
 #include "ion/port/threadutils.h"
+#include "ion/profile/streamingmetrics.h"
 #include "ion/profile/timelineevent.h"
 #include "ion/profile/timelinenode.h"
 #include "third_party/jsoncpp/include/json/json.h"
@@ -150,7 +151,17 @@ class TraceRecorder : public ion::base::Allocatable {
   // Returns if the TraceRecorder is currently in a frame scope.
   bool IsInFrameScope() const { return frame_level_ > 0; }
 
+  // Returns the event id of the innermost open scope, or 0 if no scope is open
+  // or the innermost scope is nested too deeply to be tracked. This only reads
+  // plain fields, so it may be called from a signal handler that interrupted
+  // the thread this recorder is tracing.
+  uint32 GetCurrentScopeEvent() const;
+
  private:
+  // The number of nested scope event ids remembered for
+  // GetCurrentScopeEvent().
+  static const int kMaxTrackedScopeDepth = 64;
+
   // Default size in bytes of future buffer instantiations.
   static size_t s_default_buffer_size_;
   // If true, reserve the entire buffer at the time of instantiation. Defaults
@@ -192,6 +203,15 @@ class TraceRecorder : public ion::base::Allocatable {
   // Keep track of the scope level for inserting empty scope markers.
   int scope_level_;
 
+  // The event ids and start times of the currently open scopes, outermost
+  // first.
+  uint32 open_scope_events_[kMaxTrackedScopeDepth];
+  uint32 open_scope_times_[kMaxTrackedScopeDepth];
+
+  // Histograms that scope and frame durations are recorded into when the
+  // manager's StreamingMetrics are enabled. Owned by the StreamingMetrics.
+  StreamingMetrics::ThreadHistograms* histograms_;
+
   // The ID of the thread that this recorder is tracing.
   ion::port::ThreadId thread_id_;
 
@@ -202,6 +222,8 @@ class TraceRecorder : public ion::base::Allocatable {
   // the frame number.
   int frame_level_;
   uint32 current_frame_number_;
+  // The start time of the current frame.
+  uint32 current_frame_begin_;
 };
 
 }  // namespace profile
@@ -19,7 +19,8 @@ limitations under the License.
 
 #include "ion/remote/calltracehandler.h"
 
-#include "ion/base/invalid.h"
+#include <memory>
+
 #include "ion/base/serialize.h"
 #include "ion/base/stringutils.h"
 #include "ion/base/zipassetmanager.h"
@@ -48,18 +49,25 @@ const std::string CallTraceHandler::HandleRequest(
     ion::profile::CallTraceManager* tm = ion::profile::GetCallTraceManager();
     return tm->SnapshotCallTraces();
   } else {
-    const std::string& data =
-        base::ZipAssetManager::GetFileData("ion/calltrace/" + path);
-    if (!base::IsInvalidReference(data)) {
+    const std::shared_ptr<const std::string> data =
+        base::ZipAssetManager::GetFileDataPtr("ion/calltrace/" + path);
+    if (data) {
       // Ensure the content type is set if the editor HTML is requested.
       if (base::EndsWith(path, "html"))
         *content_type = "text/html";
-      return data;
+      return *data;
     }
   }
   return std::string();
 }
 
+std::shared_ptr<const std::string> CallTraceHandler::HandleGzippedRequest(
+    const std::string& path_in, const ion::remote::HttpServer::QueryMap& args,
+    std::string* content_type) {
+  const std::string path = path_in.empty() ? "index.html" : path_in;
+  return GetGzippedAsset("ion/calltrace/" + path, content_type);
+}
+
 }  // namespace remote
 }  // namespace ion
 
@@ -18,6 +18,7 @@ limitations under the License.
 #ifndef ION_REMOTE_CALLTRACEHANDLER_H_
 #define ION_REMOTE_CALLTRACEHANDLER_H_
 
+#include <memory>
 #include <string>
 
 #include "ion/remote/httpserver.h"
@@ -37,6 +38,9 @@ class ION_API CallTraceHandler : public HttpServer::RequestHandler {
   const std::string HandleRequest(const std::string& path_in,
                                   const ion::remote::HttpServer::QueryMap& args,
                                   std::string* content_type) override;
+  std::shared_ptr<const std::string> HandleGzippedRequest(
+      const std::string& path, const ion::remote::HttpServer::QueryMap& args,
+      std::string* content_type) override;
 };
 
 }  // namespace remote
@@ -73,6 +73,8 @@ static const HttpClient::Response SendRequest(const HttpClient::Url& url,
     std::ostringstream header_str;
     header_str << headers;
     header_str << "Host: " + url.hostname << "\r\n";
+    // The connection is closed once the response has been read.
+    header_str << "Connection: close\r\n";
     const std::string header_string = header_str.str();
 
     // Have mongoose connect to the server.
@@ -29,8 +29,10 @@ limitations under the License.
 #include "ion/base/logging.h"
 #include "ion/base/scopedallocation.h"
 #include "ion/base/stringutils.h"
+#include "ion/base/zipassetmanager.h"
 
 #include "third_party/mongoose/mongoose.h"
+#include "third_party/zlib/src/zlib.h"
 
 #endif  // !ION_PRODUCTION
 
@@ -212,6 +214,11 @@ void HttpServer::WebsocketHelper::SendData(
 
 namespace {
 
+// Bodies smaller than this are copied into the same buffer as the headers so
+// that the whole response goes out in a single write. Larger bodies are written
+// directly from the handler's data, after the headers, to avoid copying them.
+static const size_t kMaxCoalescedBodySize = 16 * 1024;
+
 // Pipe all mongoose log messages through Ion's logging. Mongoose only emits
 // messages when an error occurs.
 static int LogCallback(const mg_connection*, const char* message) {
@@ -455,25 +462,116 @@ static const std::string EmbedAllLocalTags(
   return html;
 }
 
-// Sends an HTTP status across the passed connection and closes it. The passed
-// status should have the form "<code> <message>", for example "404 Not Found"
-// or "501 Not Implemented". The passed text should be a brief yet more
-// descriptive message such as "The requested file was not found."
+// Returns the HandleGzippedRequest() data of the handler for the passed path,
+// or an empty pointer if there is no handler or it does not provide gzipped
+// data.
+static std::shared_ptr<const std::string> GetGzippedFileData(
+    const std::string& path, const char* query_string,
+    const HttpServer::HandlerMap& handlers, std::string* content_type) {
+  HttpServer::RequestHandlerPtr handler = FindHandlerForPath(path, handlers);
+  if (!handler.Get())
+    return std::shared_ptr<const std::string>();
+  return handler->HandleGzippedRequest(MakeRelativePath(handler, path),
+                                       BuildQueryMap(query_string),
+                                       content_type);
+}
+
+// Returns whether mongoose will keep the passed connection open for another
+// request once the current one has been handled. This mirrors the logic in
+// mongoose so that the Connection header sent to the client is accurate.
+static bool ShouldKeepAlive(mg_connection* connection,
+                            bool keep_alive_enabled) {
+  if (!keep_alive_enabled)
+    return false;
+  const mg_request_info* info = mg_get_request_info(connection);
+  // Mongoose closes connections whose request body has an unknown length.
+  const std::string method(info->request_method);
+  if (method == "POST" && !mg_get_header(connection, "Content-Length"))
+    return false;
+  if (const char* header = mg_get_header(connection, "Connection"))
+    return base::CompareCaseInsensitive(header, "keep-alive") == 0;
+  // HTTP/1.1 connections are persistent by default.
+  return info->http_version && strcmp(info->http_version, "1.1") == 0;
+}
+
+// Reads and discards the body of the current request, if any. Handlers only
+// use the query string, but the body must be consumed before the next request
+// on a kept-alive connection can be read.
+static void DiscardRequestBody(mg_connection* connection) {
+  if (!mg_get_header(connection, "Content-Length"))
+    return;
+  char buffer[4096];
+  while (mg_read(connection, buffer, sizeof(buffer)) > 0) {}
+}
+
+// Returns whether the client accepts gzip content encoding.
+static bool AcceptsGzip(mg_connection* connection) {
+  const char* header = mg_get_header(connection, "Accept-Encoding");
+  if (!header)
+    return false;
+  const std::vector<std::string> encodings = base::SplitString(header, ",");
+  for (size_t i = 0; i < encodings.size(); ++i) {
+    const std::string encoding = base::TrimStartAndEndWhitespace(encodings[i]);
+    // Skip gzip if the client explicitly refuses it with a zero quality.
+    if (encoding == "gzip" ||
+        (base::StartsWith(encoding, "gzip;") &&
+         encoding.find("q=0") == std::string::npos))
+      return true;
+  }
+  return false;
+}
+
+// Returns whether data of the passed content type is likely to be made
+// significantly smaller by gzip compression.
+static bool IsCompressibleContentType(const std::string& content_type) {
+  return base::StartsWith(content_type, "text/") ||
+      content_type.find("json") != std::string::npos ||
+      content_type.find("javascript") != std::string::npos ||
+      content_type.find("xml") != std::string::npos;
+}
+
+// Compresses data into gzip format, returning whether it succeeded.
+static bool GzipCompress(const std::string& data, std::string* compressed) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // Adding 16 to the window bits makes zlib write a gzip header and trailer.
+  // Favor speed, since responses are compressed on every request.
+  if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    return false;
+  compressed->resize(deflateBound(&stream, static_cast<uLong>(data.length())));
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.length());
+  stream.next_out = reinterpret_cast<Bytef*>(&(*compressed)[0]);
+  stream.avail_out = static_cast<uInt>(compressed->length());
+  const int result = deflate(&stream, Z_FINISH);
+  compressed->resize(stream.total_out);
+  deflateEnd(&stream);
+  return result == Z_STREAM_END;
+}
+
+// Sends an HTTP status across the passed connection. The passed status should
+// have the form "<code> <message>", for example "404 Not Found" or "501 Not
+// Implemented". The passed text should be a brief yet more descriptive message
+// such as "The requested file was not found."
 static void SendStatusCode(mg_connection* connection, const std::string& status,
-                           const std::string& text) {
+                           const std::string& text, bool keep_alive) {
   std::stringstream header_stream;
   header_stream << "HTTP/1.1 " << status << "\r\n"
                 << "Content-Length: " << text.length() << "\r\n"
-                << "Connection: close\r\n\r\n" << text;
+                << "Connection: " << (keep_alive ? "keep-alive" : "close")
+                << "\r\n\r\n" << text;
   const std::string headers = header_stream.str();
-  mg_printf(connection, "%s", headers.c_str());
+  mg_write(connection, headers.data(), headers.length());
 }
 
 // Extracts a range request from a Range header, given a content_length for a
 // requested file. If the header is valid, then sets range_start and range_end
 // to the first and last byte to be sent, and sets range to an appropriate
-// Content-Range header. If the range request header is malformed then range is
-// unmodified. Returns whether the request was valid and range was modified.
+// Content-Range header. If the range request header is malformed or does not
+// overlap the content then range is unmodified. Returns whether the request was
+// valid and range was modified.
 static bool ParseRangeRequest(const char* range_header,
                               int64 content_length,
                               int64* range_start,
@@ -493,10 +591,11 @@ static bool ParseRangeRequest(const char* range_header,
     std::istringstream header(header_string.substr(kEqualPos + 1U));
     int64 start = 0, end = 0;
     header >> start >> end;
-    valid_request = !header.fail() && end < 0;
+    valid_request = !header.fail() && end < 0 && start >= 0 &&
+        start <= std::min(-end, content_length - 1);
     if (valid_request) {
       *range_start = start;
-      *range_end = std::min(-end, content_length);
+      *range_end = std::min(-end, content_length - 1);
       std::stringstream range_stream;
       range_stream << "Content-Range: bytes " << *range_start << "-"
                    << *range_end << "/" << content_length << "\r\n";
@@ -506,39 +605,58 @@ static bool ParseRangeRequest(const char* range_header,
   return valid_request;
 }
 
-// Sends the passed file data across the passed connection.
+// Sends the passed file data across the passed connection. If content_encoding
+// is not empty then data is already encoded with it, and range requests are
+// ignored. If vary is set then a header is added to indicate that the response
+// depends on the Accept-Encoding of the request.
 static void SendFileData(mg_connection* connection,
                          const std::string& method,  // GET, HEAD, or POST.
                          const std::string& content_type,
-                         const std::string& data) {
+                         const std::string& content_encoding,
+                         const std::string& data, bool vary, bool keep_alive) {
   // We have data to return, so the status is ok.
   std::string status("200 OK");
   // If the client asked for a certain range then extract the range and
   // set the proper status and header.
+  const int64 content_length = static_cast<int64>(data.length());
   int64 range_start = 0;
-  int64 range_end = static_cast<int64>(data.length());
+  int64 range_end = content_length - 1;
   // If the client requested a byte range then we send a Partial Content status
   // code. If there is no range request then range will be empty, which is ok.
   std::string range;
-  if (const char* header = mg_get_header(connection, "Range"))
-    if (ParseRangeRequest(header, range_end, &range_start, &range_end, &range))
-      status = "206 Partial Content";
+  if (content_encoding.empty()) {
+    if (const char* header = mg_get_header(connection, "Range"))
+      if (ParseRangeRequest(header, content_length, &range_start, &range_end,
+                            &range))
+        status = "206 Partial Content";
+  }
+  const size_t size = static_cast<size_t>(range_end - range_start + 1);
 
   // Create the headers that describe the file data.
   std::stringstream header_stream;
   header_stream << "HTTP/1.1 " << status << "\r\n"
                 << "Content-Type: " << content_type << "\r\n"
-                << "Content-Length: " << data.length() << "\r\n"
-                << "Connection: close\r\n"
-                << "Accept-Ranges: bytes\r\n" << range << "\r\n";
+                << "Content-Length: " << size << "\r\n"
+                << "Connection: " << (keep_alive ? "keep-alive" : "close")
+                << "\r\n";
+  if (!content_encoding.empty())
+    header_stream << "Content-Encoding: " << content_encoding << "\r\n";
+  if (vary)
+    header_stream << "Vary: Accept-Encoding\r\n";
+  header_stream << "Accept-Ranges: bytes\r\n" << range << "\r\n";
+  std::string response = header_stream.str();
 
-  // Write headers to the connection.
-  const std::string headers = header_stream.str();
-  mg_printf(connection, "%s", headers.c_str());
   // Servicing a HEAD request requires only headers, not a body.
-  if (method != "HEAD") {
-    const size_t size = static_cast<size_t>(range_end - range_start + 1);
-    mg_write(connection, &data[static_cast<size_t>(range_start)], size);
+  const char* body = data.data() + range_start;
+  if (method == "HEAD") {
+    mg_write(connection, response.data(), response.length());
+  } else if (size <= kMaxCoalescedBodySize) {
+    // Send small responses with a single write.
+    response.append(body, size);
+    mg_write(connection, response.data(), response.length());
+  } else {
+    mg_write(connection, response.data(), response.length());
+    mg_write(connection, body, size);
   }
 }
 
@@ -561,19 +679,54 @@ static int BeginRequestCallback(mg_connection* connection) {
     // mg_start().
     HttpServer* server = reinterpret_cast<HttpServer*>(info->user_data);
     DCHECK(server);
+    const HttpServer::Options& options = server->GetOptions();
+    DiscardRequestBody(connection);
+    const bool keep_alive = ShouldKeepAlive(connection, options.keep_alive);
+    const HttpServer::HandlerMap handlers = server->GetHandlers();
+    // Compressed responses are only sent as a whole.
+    const bool accepts_gzip = AcceptsGzip(connection) &&
+        !mg_get_header(connection, "Range");
     // Get a default content type based on the requested path.
-    std::string content_type = mg_get_builtin_mime_type(info->uri);
+    const std::string default_content_type =
+        mg_get_builtin_mime_type(info->uri);
+    std::string content_type = default_content_type;
+
+    // Prefer data that the handler can provide already compressed.
+    if (accepts_gzip) {
+      const std::shared_ptr<const std::string> gzipped = GetGzippedFileData(
+          info->uri, info->query_string, handlers, &content_type);
+      if (gzipped.get() && !gzipped->empty() && content_type != "text/html") {
+        SendFileData(connection, method, content_type, "gzip", *gzipped, true,
+                     keep_alive);
+        return 1;
+      }
+      content_type = default_content_type;
+    }
+
     // Try to get data for the requested path.
     const std::string data =
         GetFileData(info->uri, info->query_string, server->GetHeaderHtml(),
-                    server->GetFooterHtml(), server->GetHandlers(),
-                    &content_type, server->EmbedLocalSourcedFiles());
+                    server->GetFooterHtml(), handlers, &content_type,
+                    server->EmbedLocalSourcedFiles());
 
     if (data.empty()) {
       SendStatusCode(connection, "404 Not Found",
-                     "Error 404: Not Found\nThe requested file was not found.");
+                     "Error 404: Not Found\nThe requested file was not found.",
+                     keep_alive);
     } else {
-      SendFileData(connection, method, content_type, data);
+      const bool compressible = options.min_gzip_size > 0U &&
+          IsCompressibleContentType(content_type);
+      std::string compressed;
+      if (accepts_gzip && compressible &&
+          data.length() >= options.min_gzip_size &&
+          GzipCompress(data, &compressed) &&
+          compressed.length() < data.length()) {
+        SendFileData(connection, method, content_type, "gzip", compressed, true,
+                     keep_alive);
+      } else {
+        SendFileData(connection, method, content_type, "", data, compressible,
+                     keep_alive);
+      }
     }
     return 1;
   } else {
@@ -656,9 +809,42 @@ HttpServer::RequestHandler::RequestHandler(const std::string& base_path)
 
 HttpServer::RequestHandler::~RequestHandler() {}
 
+std::shared_ptr<const std::string> HttpServer::RequestHandler::GetGzippedAsset(
+    const std::string& filename, std::string* content_type) {
+  std::shared_ptr<const std::string> data =
+      base::ZipAssetManager::GetGzippedFileDataPtr(filename);
+  if (data.get() && base::EndsWith(filename, "html"))
+    *content_type = "text/html";
+  return data;
+}
+
+HttpServer::Options::Options()
+    : num_threads(4),
+      keep_alive(true),
+      request_timeout_ms(5000),
+      min_gzip_size(1024U) {}
+
+static HttpServer::Options MakeOptions(int num_threads) {
+  HttpServer::Options options;
+  options.num_threads = num_threads;
+  return options;
+}
+
 HttpServer::HttpServer(int port, int num_threads)
     : context_(NULL),
+      options_(MakeOptions(num_threads)),
+      embed_local_sourced_files_(false) {
+  Start(port);
+}
+
+HttpServer::HttpServer(int port, const Options& options)
+    : context_(NULL),
+      options_(options),
       embed_local_sourced_files_(false) {
+  Start(port);
+}
+
+void HttpServer::Start(int port) {
   if (port) {
     std::stringstream int_to_string;
     int_to_string << port;
@@ -666,12 +852,18 @@ HttpServer::HttpServer(int port, int num_threads)
     // platforms, but assigning it to a string first does.
     const std::string port_cstr = int_to_string.str();
     int_to_string.str("");
-    int_to_string << num_threads;
+    int_to_string << options_.num_threads;
     const std::string num_threads_cstr = int_to_string.str();
+    int_to_string.str("");
+    int_to_string << options_.request_timeout_ms;
+    const std::string timeout_cstr = int_to_string.str();
 
     mg_callbacks callbacks;
     const char* options[] = { "listening_ports", port_cstr.c_str(),
                               "num_threads", num_threads_cstr.c_str(),
+                              "enable_keep_alive",
+                              options_.keep_alive ? "yes" : "no",
+                              "request_timeout_ms", timeout_cstr.c_str(),
                               NULL };
 
     memset(&callbacks, 0, sizeof(callbacks));
@@ -707,6 +899,11 @@ const std::string HttpServer::GetUriData(const std::string& uri) const {
                      &content_type, embed_local_sourced_files_);
 }
 
+HttpServer::QueryMap HttpServer::ParseQueryString(
+    const std::string& query_string) {
+  return BuildQueryMap(query_string.c_str());
+}
+
 bool HttpServer::IsRunning() const {
   return context_ != NULL;
 }
@@ -769,10 +966,21 @@ size_t HttpServer::WebsocketCount() {
 
 #else
 
+HttpServer::Options::Options()
+    : num_threads(0),
+      keep_alive(false),
+      request_timeout_ms(0),
+      min_gzip_size(0U) {}
+
 HttpServer::HttpServer(int port, int num_threads)
     : context_(NULL),
       embed_local_sourced_files_(false) {}
 
+HttpServer::HttpServer(int port, const Options& options)
+    : context_(NULL),
+      options_(options),
+      embed_local_sourced_files_(false) {}
+
 HttpServer::~HttpServer() {}
 
 #endif  // !ION_PRODUCTION
@@ -19,6 +19,7 @@ limitations under the License.
 #define ION_REMOTE_HTTPSERVER_H_
 
 #include <map>
+#include <memory>
 #include <string>
 
 #include "ion/base/referent.h"
@@ -82,6 +83,18 @@ class ION_API HttpServer {
                                             const QueryMap& args,
                                             std::string* content_type) = 0;
 
+    // Handlers that serve static files may override this to return the data
+    // of |path| already compressed in gzip format, which is then sent as-is
+    // to clients that accept gzip encoding. The content type may be set as in
+    // HandleRequest(). Returning an empty pointer (the default) makes the
+    // server call HandleRequest() instead. HTML pages are always obtained
+    // through HandleRequest(), since the server may need to modify them.
+    virtual std::shared_ptr<const std::string> HandleGzippedRequest(
+        const std::string& path, const QueryMap& args,
+        std::string* content_type) {
+      return std::shared_ptr<const std::string>();
+    }
+
     // By default, RequestHandlers don't support websocket connections.
     virtual const WebsocketPtr ConnectWebsocket(const std::string& path,
                                                 const QueryMap& args) {
@@ -109,19 +122,51 @@ class ION_API HttpServer {
     // The destructor is protected since this derived from base::Referent.
     ~RequestHandler() override;
 
+    // Returns the gzipped data of the ZipAssetManager file |filename|, for
+    // use by HandleGzippedRequest() overrides of handlers that serve zip
+    // assets. Sets |content_type| to "text/html" for HTML files.
+    static std::shared_ptr<const std::string> GetGzippedAsset(
+        const std::string& filename, std::string* content_type);
+
    private:
     const std::string base_path_;
   };
   typedef base::ReferentPtr<RequestHandler>::Type RequestHandlerPtr;
   typedef std::map<std::string, RequestHandlerPtr> HandlerMap;
 
+  // Options that control how the server handles connections.
+  struct ION_API Options {
+    Options();
+    // The number of worker threads that service connections. Requests are
+    // never handled on the thread that created the server. Since a worker
+    // serves one connection at a time, including idle keep-alive connections,
+    // this also limits the number of simultaneously connected clients.
+    int num_threads;
+    // Whether connections are kept open for further requests when the client
+    // supports it (HTTP/1.1 or "Connection: keep-alive").
+    bool keep_alive;
+    // How long a worker waits for the next request on an open connection
+    // before closing it, in milliseconds.
+    int request_timeout_ms;
+    // Responses with compressible content types that are at least this large
+    // are gzip-compressed for clients that accept gzip encoding. Zero disables
+    // compression.
+    size_t min_gzip_size;
+  };
+
   // Starts a HttpServer on the passed port with the passed number of handler
   // threads. Passing a negative port is an error, but passing port 0 will be
   // silently ignored (the server will not be reachable over a network interface
   // but there will be no reported startup errors).
   HttpServer(int port, int num_threads);
+  // Same as above, but using the passed options.
+  HttpServer(int port, const Options& options);
   virtual ~HttpServer();
 
+  // Returns a QueryMap with the arguments in the passed query string, which
+  // has the form "arg1=value1&arg2=value2". Values are URL-decoded.
+  static QueryMap ParseQueryString(const std::string& query_string);
+
   // Returns the data of the requested URI, or returns an empty string if it
   // does not exist.
   const std::string GetUriData(const std::string& uri) const;
@@ -146,6 +191,9 @@ class ION_API HttpServer {
     embed_local_sourced_files_ = embed;
   }
 
+  // Returns the options the server was started with.
+  const Options& GetOptions() const { return options_; }
+
   // Return the number of currently-connected websockets.
   size_t WebsocketCount();
 
@@ -170,7 +218,11 @@ class ION_API HttpServer {
   WebsocketMap websockets_;
   port::Mutex websocket_mutex_;
 
+  // Starts mongoose with |options_|.
+  void Start(int port);
+
   mg_context* context_;
+  const Options options_;
   // Registered request handlers. Guarded under a mutex so that RequestHandler
   // objects may be added/removed while requests are being serviced on other
   // threads.
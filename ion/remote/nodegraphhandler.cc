@@ -21,9 +21,11 @@ limitations under the License.
 
 
 #include <algorithm>
+#include <memory>
 #include <sstream>
+#include <utility>
 
-#include "ion/base/invalid.h"
+#include "ion/base/lockguards.h"
 #include "ion/base/serialize.h"
 #include "ion/base/stringutils.h"
 #include "ion/base/zipassetmanager.h"
@@ -36,7 +38,8 @@ namespace ion {
 namespace remote {
 
 NodeGraphHandler::NodeGraphHandler()
-    : HttpServer::RequestHandler("/ion/nodegraph") {
+    : HttpServer::RequestHandler("/ion/nodegraph"),
+      graph_version_(0U) {
   IonRemoteNodeGraphRoot::RegisterAssetsOnce();
 }
 
@@ -71,20 +74,32 @@ const std::string NodeGraphHandler::HandleRequest(
   if (path == "update") {
     gfxutils::Printer printer;
     SetUpPrinter(args, &printer);
-    return GetPrintString(&printer);
+    HttpServer::QueryMap::const_iterator it = args.find("since");
+    if (it == args.end())
+      return GetPrintString(&printer);
+    uint64 since = 0;
+    std::istringstream(it->second) >> since;
+    return GetUpdateString(since, &printer);
   } else {
-    const std::string& data =
-        base::ZipAssetManager::GetFileData("ion/nodegraph/" + path);
-    if (!base::IsInvalidReference(data)) {
+    const std::shared_ptr<const std::string> data =
+        base::ZipAssetManager::GetFileDataPtr("ion/nodegraph/" + path);
+    if (data) {
       // Ensure the content type is set if the editor HTML is requested.
       if (base::EndsWith(path, "html"))
         *content_type = "text/html";
-      return data;
+      return *data;
     }
   }
   return std::string();
 }
 
+std::shared_ptr<const std::string> NodeGraphHandler::HandleGzippedRequest(
+    const std::string& path_in, const HttpServer::QueryMap& args,
+    std::string* content_type) {
+  const std::string path = path_in.empty() ? "index.html" : path_in;
+  return GetGzippedAsset("ion/nodegraph/" + path, content_type);
+}
+
 void NodeGraphHandler::SetUpPrinter(const HttpServer::QueryMap& args,
                                     gfxutils::Printer* printer) {
   // Turn address printing off by default.
@@ -107,12 +122,54 @@ void NodeGraphHandler::SetUpPrinter(const HttpServer::QueryMap& args,
 }
 
 const std::string NodeGraphHandler::GetPrintString(gfxutils::Printer* printer) {
+  return GetHeaderString() + GetGraphString(printer);
+}
+
+const std::string NodeGraphHandler::GetUpdateString(
+    uint64 since, gfxutils::Printer* printer) {
+  // Graphs printed with different options are versioned separately. The key
+  // is built from the options the printer was set up with rather than from
+  // the query string, so unknown or reordered arguments do not add entries.
+  const uint32 key = (static_cast<uint32>(printer->GetFormat()) << 2) |
+                     (printer->IsAddressPrintingEnabled() ? 2U : 0U) |
+                     (printer->IsFullShapePrintingEnabled() ? 1U : 0U);
+
+  const std::string graph = GetGraphString(printer);
+  uint64 version;
+  {
+    base::LockGuard guard(&graph_mutex_);
+    std::pair<uint64, std::string>& cached = printed_graphs_[key];
+    if (cached.first == 0U || cached.second != graph) {
+      cached.first = ++graph_version_;
+      cached.second = graph;
+    }
+    version = cached.first;
+  }
+
   std::ostringstream s;
+  s << "<!--version:" << version << "-->\n";
+  if (version != since)
+    s << GetHeaderString() << graph;
+  return s.str();
+}
 
+size_t NodeGraphHandler::GetPrintedGraphCount() const {
+  base::LockGuard guard(&graph_mutex_);
+  return printed_graphs_.size();
+}
+
+const std::string NodeGraphHandler::GetHeaderString() const {
+  std::ostringstream s;
   s << "<span class=\"nodes_header\">Tracked Nodes";
   if (frame_.Get())
     s << " at frame " << frame_->GetCounter();
   s << "</span><br><br>\n";
+  return s.str();
+}
+
+const std::string NodeGraphHandler::GetGraphString(
+    gfxutils::Printer* printer) const {
+  std::ostringstream s;
 
   if (printer->GetFormat() == gfxutils::Printer::kText)
     s << "<pre>\n";
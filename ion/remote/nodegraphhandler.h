@@ -18,12 +18,17 @@ limitations under the License.
 #ifndef ION_REMOTE_NODEGRAPHHANDLER_H_
 #define ION_REMOTE_NODEGRAPHHANDLER_H_
 
+#include <map>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "base/integral_types.h"
 #include "ion/gfx/node.h"
 #include "ion/gfxutils/frame.h"
 #include "ion/gfxutils/printer.h"
+#include "ion/port/mutex.h"
 #include "ion/remote/httpserver.h"
 
 namespace ion {
@@ -34,6 +39,12 @@ namespace remote {
 //
 // /   or /index.html  - Display interface
 // /update             - Updates graphs for all currently-tracked nodes.
+// /update?since=#     - Same as /update, but the response starts with a
+//                       "<!--version:#-->" comment identifying the printed
+//                       graph. If the graph printed with the same options
+//                       still has the version passed in |since|, only the
+//                       comment is returned, so clients that poll do not
+//                       need to re-render an unchanged graph.
 class ION_API NodeGraphHandler : public HttpServer::RequestHandler {
  public:
   NodeGraphHandler();
@@ -58,9 +69,16 @@ class ION_API NodeGraphHandler : public HttpServer::RequestHandler {
   // Returns the number of nodes being tracked. (Useful for testing.)
   size_t GetTrackedNodeCount() const { return nodes_.size(); }
 
+  // Returns the number of printed graphs kept for versioned updates, which
+  // is at most one per combination of printing options. (Useful for testing.)
+  size_t GetPrintedGraphCount() const;
+
   const std::string HandleRequest(const std::string& path,
                                   const HttpServer::QueryMap& args,
                                   std::string* content_type) override;
+  std::shared_ptr<const std::string> HandleGzippedRequest(
+      const std::string& path, const HttpServer::QueryMap& args,
+      std::string* content_type) override;
 
  private:
   // Sets up a gfxutils::Printer from options in the QueryMap.
@@ -69,11 +87,25 @@ class ION_API NodeGraphHandler : public HttpServer::RequestHandler {
 
   // Uses a gfxutils::Printer to generate the response data string.
   const std::string GetPrintString(gfxutils::Printer* printer);
+  // Returns the versioned response for an update request with a "since"
+  // argument (see above).
+  const std::string GetUpdateString(uint64 since, gfxutils::Printer* printer);
+  // Returns the header containing the frame counter.
+  const std::string GetHeaderString() const;
+  // Returns the printed graphs of all tracked nodes.
+  const std::string GetGraphString(gfxutils::Printer* printer) const;
 
   // Nodes to print.
   std::vector<gfx::NodePtr> nodes_;
   // Optional Frame used to access frame counter.
   gfxutils::FramePtr frame_;
+  // The last printed graph and its version, keyed by the printing options
+  // (see GetUpdateString()), so there is one entry per combination of them.
+  std::map<uint32, std::pair<uint64, std::string> > printed_graphs_;
+  // The most recently assigned graph version.
+  uint64 graph_version_;
+  // Protects the printed graphs and version.
+  mutable port::Mutex graph_mutex_;
 };
 typedef base::ReferentPtr<NodeGraphHandler>::Type NodeGraphHandlerPtr;
 
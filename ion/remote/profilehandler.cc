@@ -0,0 +1,117 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#if !ION_PRODUCTION
+
+#include "ion/remote/profilehandler.h"
+
+#include <sstream>
+
+#include "ion/base/serialize.h"
+#include "ion/profile/calltracemanager.h"
+#include "ion/profile/profiling.h"
+#include "ion/profile/samplingprofiler.h"
+#include "ion/profile/streamingmetrics.h"
+
+namespace ion {
+namespace remote {
+
+namespace {
+
+// Returns the HTML page describing the state of |profiler| and |metrics|.
+static const std::string GetIndexPage(
+    const profile::SamplingProfiler& profiler,
+    const profile::StreamingMetrics& metrics) {
+  std::ostringstream str;
+  str << "<!DOCTYPE html>\n<html>\n<head>\n"
+      << "<title>Ion Remote Interface - Profile</title>\n</head>\n<body>\n"
+      << "<!--HEADER-->\n";
+  if (!profile::SamplingProfiler::IsSupported()) {
+    str << "<p>Sampling is not supported on this platform.</p>\n";
+  } else {
+    str << "<p>Status: " << (profiler.IsRunning() ? "running" : "stopped")
+        << "<br />\nSamples: " << profiler.GetSampleCount()
+        << "<br />\nDropped samples: " << profiler.GetDroppedSampleCount()
+        << "</p>\n<p>\n"
+        << "<a href=\"start\">Start</a> |\n"
+        << "<a href=\"stop\">Stop</a> |\n"
+        << "<a href=\"samples.folded\">Folded stacks</a> |\n"
+        << "<a href=\"flamegraph.json\">Flame graph JSON</a>\n</p>\n";
+  }
+  str << "<p>Streaming metrics: "
+      << (metrics.IsEnabled() ? "recording" : "stopped") << "<br />\n"
+      << "<a href=\"metrics/start\">Start</a> |\n"
+      << "<a href=\"metrics/stop\">Stop</a> |\n"
+      << "<a href=\"metrics/reset\">Reset</a> |\n"
+      << "<a href=\"metrics.json\">Metrics JSON</a>\n</p>\n";
+  str << "</body>\n</html>\n";
+  return str.str();
+}
+
+}  // anonymous namespace
+
+ProfileHandler::ProfileHandler()
+  : ion::remote::HttpServer::RequestHandler("/ion/profile") {}
+
+ProfileHandler::~ProfileHandler() {}
+
+const std::string ProfileHandler::HandleRequest(
+    const std::string& path_in, const ion::remote::HttpServer::QueryMap& args,
+    std::string* content_type) {
+  const std::string path = path_in.empty() ? "index.html" : path_in;
+  profile::SamplingProfiler* profiler = profile::SamplingProfiler::Get();
+  profile::StreamingMetrics* metrics =
+      profile::GetCallTraceManager()->GetStreamingMetrics();
+
+  if (path == "index.html") {
+    *content_type = "text/html";
+    return GetIndexPage(*profiler, *metrics);
+  } else if (path == "start") {
+    uint32 frequency = kDefaultFrequency;
+    HttpServer::QueryMap::const_iterator it = args.find("frequency");
+    if (it != args.end() &&
+        (!base::StringToValue(it->second, &frequency) || frequency == 0))
+      return "Invalid frequency";
+    return profiler->Start(frequency) ? "OK" : "Failed to start profiler";
+  } else if (path == "stop") {
+    profiler->Stop();
+    return "OK";
+  } else if (path == "samples.folded") {
+    *content_type = "text/plain";
+    return profiler->GetFoldedStacks();
+  } else if (path == "flamegraph.json") {
+    *content_type = "application/json";
+    return profiler->GetFlameGraphJson();
+  } else if (path == "metrics/start") {
+    metrics->SetEnabled(true);
+    return "OK";
+  } else if (path == "metrics/stop") {
+    metrics->SetEnabled(false);
+    return "OK";
+  } else if (path == "metrics/reset") {
+    metrics->Reset();
+    return "OK";
+  } else if (path == "metrics.json") {
+    *content_type = "application/json";
+    return metrics->GetJson();
+  }
+  return std::string();
+}
+
+}  // namespace remote
+}  // namespace ion
+
+#endif
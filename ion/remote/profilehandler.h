@@ -0,0 +1,60 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#ifndef ION_REMOTE_PROFILEHANDLER_H_
+#define ION_REMOTE_PROFILEHANDLER_H_
+
+#include <string>
+
+#include "ion/remote/httpserver.h"
+
+namespace ion {
+namespace remote {
+
+// ProfileHandler controls the global SamplingProfiler and serves the samples
+// it recorded as flame-graph data. It also serves the live latency statistics
+// of the StreamingMetrics of the global CallTraceManager.
+//
+// /index.html        - A page showing the profiler status with links to the
+//                      other paths.
+// /start             - Starts sampling. The optional "frequency" argument sets
+//                      the number of samples per second of CPU time.
+// /stop              - Stops sampling.
+// /samples.folded    - The samples in the folded stacks format understood by
+//                      flamegraph.pl.
+// /flamegraph.json   - The samples as a JSON flame-graph tree.
+// /metrics/start     - Starts recording scope and frame durations.
+// /metrics/stop      - Stops recording scope and frame durations.
+// /metrics/reset     - Clears the recorded durations.
+// /metrics.json      - Count, min, max, mean, standard deviation and
+//                      p50/p95/p99 of the recorded durations in microseconds.
+class ION_API ProfileHandler : public HttpServer::RequestHandler {
+ public:
+  // The sampling frequency used by /start if none is specified.
+  static const uint32 kDefaultFrequency = 1000;
+
+  ProfileHandler();
+  ~ProfileHandler() override;
+
+  const std::string HandleRequest(const std::string& path_in,
+                                  const ion::remote::HttpServer::QueryMap& args,
+                                  std::string* content_type) override;
+};
+
+}  // namespace remote
+}  // namespace ion
+
+#endif  // ION_REMOTE_PROFILEHANDLER_H_
@@ -85,6 +85,8 @@
         'httpserver.h',
         'nodegraphhandler.cc',
         'nodegraphhandler.h',
+        'profilehandler.cc',
+        'profilehandler.h',
         'remoteserver.cc',
         'remoteserver.h',
         'resourcehandler.cc',
@@ -17,9 +17,10 @@ limitations under the License.
 
 #include "ion/remote/remoteserver.h"
 
+#include <memory>
+
 #if !ION_PRODUCTION
 
-#include "ion/base/invalid.h"
 #include "ion/base/logging.h"
 #include "ion/base/once.h"
 #include "ion/base/stringutils.h"
@@ -27,6 +28,7 @@ limitations under the License.
 #include "ion/base/zipassetmanagermacros.h"
 #include "ion/remote/calltracehandler.h"
 #include "ion/remote/nodegraphhandler.h"
+#include "ion/remote/profilehandler.h"
 #include "ion/remote/resourcehandler.h"
 #include "ion/remote/settinghandler.h"
 #include "ion/remote/shaderhandler.h"
@@ -70,11 +72,20 @@ class IonRootHandler : public HttpServer::RequestHandler {
     if (path == "index.html") {
       return kRootPage;
     } else {
-      const std::string& data =
-          base::ZipAssetManager::GetFileData("ion/" + path);
-      return base::IsInvalidReference(data) ? std::string() : data;
+      const std::shared_ptr<const std::string> data =
+          base::ZipAssetManager::GetFileDataPtr("ion/" + path);
+      return data ? *data : std::string();
     }
   }
+
+  std::shared_ptr<const std::string> HandleGzippedRequest(
+      const std::string& path_in, const HttpServer::QueryMap& args,
+      std::string* content_type) override {
+    // The index page is generated rather than stored as an asset.
+    if (path_in.empty() || path_in == "index.html")
+      return std::shared_ptr<const std::string>();
+    return GetGzippedAsset("ion/" + path_in, content_type);
+  }
 };
 
 // Override / to redirect to /ion so that when clients connect to the root they
@@ -130,6 +141,9 @@ RemoteServer::RemoteServer(
   RegisterHandler(
       HttpServer::RequestHandlerPtr(
           new CallTraceHandler()));
+  RegisterHandler(
+      HttpServer::RequestHandlerPtr(
+          new ProfileHandler()));
   RegisterHandler(
       HttpServer::RequestHandlerPtr(
           new ResourceHandler(renderer)));
@@ -19,12 +19,15 @@ limitations under the License.
 
 #include "ion/remote/resourcehandler.h"
 
+#include <map>
+#include <memory>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
 
 #include "ion/base/allocator.h"
-#include "ion/base/invalid.h"
+#include "ion/base/lockguards.h"
 #include "ion/base/stringutils.h"
 #include "ion/base/zipassetmanager.h"
 #include "ion/base/zipassetmanagermacros.h"
@@ -936,8 +939,207 @@ static const std::string GetTextureData(const RendererPtr& renderer,
   return data;
 }
 
+//-----------------------------------------------------------------------------
+//
+// Versioned resource snapshots.
+//
+//-----------------------------------------------------------------------------
+
+// The last reported state of a single resource.
+struct SnapshotEntry {
+  SnapshotEntry() : id(0U), change_count(0U), version(0U) {}
+  // The OpenGL id of the resource, which may be 0 if it could not be created.
+  GLuint id;
+  // The change count of the resource's holder when it was last queried.
+  uint64 change_count;
+  // The snapshot version at which the JSON last changed, or at which the
+  // resource was found to be destroyed.
+  uint64 version;
+  // The JSON members describing the resource.
+  std::string json;
+};
+
+// The last reported state of all resources of a single type. Resources are
+// keyed by their serial numbers rather than by their OpenGL ids, since
+// resources that have not been created all have id 0, and ids are reused.
+struct SnapshotType {
+  std::map<uint64, SnapshotEntry> entries;
+  // Destroyed resources.
+  std::map<uint64, SnapshotEntry> removed;
+};
+
+// Brings the snapshot of the resources of a single type up to date, marking
+// new, changed and removed resources with the passed version. Only resources
+// that are not in the snapshot or whose holder has changed since they were
+// last queried are queried from OpenGL. Returns whether anything changed.
+template <typename ResourceType, typename InfoType>
+static bool UpdateSnapshotType(const RendererPtr& renderer,
+                               bool wait_for_completion, uint64 version,
+                               SnapshotType* snapshot) {
+  // The filter runs on the render thread, so give it its own copy of the known
+  // change counts. It records the serials of all resources that still exist.
+  std::map<uint64, uint64> known;
+  for (const auto& entry : snapshot->entries) {
+    // Resources that could not be created are queried again, since creating
+    // them later does not change their holders.
+    if (entry.second.id)
+      known[entry.first] = entry.second.change_count;
+  }
+  std::shared_ptr<std::vector<uint64>> live_serials(new std::vector<uint64>);
+  const ResourceManager::InfoFilter filter =
+      [known, live_serials](uint64 serial, uint64 change_count) {
+        live_serials->push_back(serial);
+        const std::map<uint64, uint64>::const_iterator it = known.find(serial);
+        return it == known.end() || it->second != change_count;
+      };
+
+  ResourceManager* manager = renderer->GetResourceManager();
+  typedef gfxutils::ResourceCallback<InfoType> Callback;
+  typename Callback::RefPtr callback(new Callback(wait_for_completion));
+  manager->RequestChangedResourceInfos<ResourceType, InfoType>(
+      filter, std::bind(&Callback::Callback, callback.Get(), _1));
+  // See BuildJsonStruct().
+  if (!wait_for_completion)
+    renderer->ProcessResourceInfoRequests();
+  std::vector<InfoType> infos;
+  callback->WaitForCompletion(&infos);
+
+  bool changed = false;
+  const Indent indent(6);
+  for (size_t i = 0; i < infos.size(); ++i) {
+    const InfoType& info = infos[i];
+    const std::string json = ConvertInfoToJson<InfoType>(indent, info);
+    SnapshotEntry& entry = snapshot->entries[info.serial];
+    // A holder change does not necessarily change anything that is reported.
+    if (entry.json != json) {
+      entry.json = json;
+      entry.version = version;
+      changed = true;
+    }
+    entry.id = info.id;
+    entry.change_count = info.change_count;
+    live_serials->push_back(info.serial);
+  }
+
+  // Any resource that was not seen by the filter has been destroyed.
+  const std::set<uint64> live(live_serials->begin(), live_serials->end());
+  for (std::map<uint64, SnapshotEntry>::iterator it =
+           snapshot->entries.begin(); it != snapshot->entries.end();) {
+    if (live.count(it->first)) {
+      ++it;
+    } else {
+      SnapshotEntry& removed = snapshot->removed[it->first];
+      removed.id = it->second.id;
+      removed.version = version;
+      snapshot->entries.erase(it++);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+// Updates the snapshot of the named resource type. Sets changed if anything
+// changed, and returns false if the name is not a valid resource type.
+static bool UpdateSnapshot(const RendererPtr& renderer, const std::string& name,
+                           bool wait_for_completion, uint64 version,
+                           SnapshotType* snapshot, bool* changed) {
+  if (name == "buffers") {
+    *changed |= UpdateSnapshotType<BufferObject, BufferInfo>(
+        renderer, wait_for_completion, version, snapshot);
+  } else if (name == "framebuffers") {
+    *changed |= UpdateSnapshotType<FramebufferObject, FramebufferInfo>(
+        renderer, wait_for_completion, version, snapshot);
+  } else if (name == "programs") {
+    *changed |= UpdateSnapshotType<ShaderProgram, ProgramInfo>(
+        renderer, wait_for_completion, version, snapshot);
+  } else if (name == "samplers") {
+    *changed |= UpdateSnapshotType<Sampler, SamplerInfo>(
+        renderer, wait_for_completion, version, snapshot);
+  } else if (name == "shaders") {
+    *changed |= UpdateSnapshotType<Shader, ShaderInfo>(
+        renderer, wait_for_completion, version, snapshot);
+  } else if (name == "textures") {
+    *changed |= UpdateSnapshotType<TextureBase, TextureInfo>(
+        renderer, wait_for_completion, version, snapshot);
+  } else if (name == "vertex_arrays") {
+    *changed |= UpdateSnapshotType<AttributeArray, ArrayInfo>(
+        renderer, wait_for_completion, version, snapshot);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Returns JSON members for the resources of the named type that changed or
+// were removed after the passed version.
+static const std::string ConvertSnapshotTypeToJson(const Indent& indent,
+                                                   const std::string& name,
+                                                   const SnapshotType& snapshot,
+                                                   uint64 since) {
+  std::ostringstream str;
+  const Indent indent2 = indent + 2;
+  str << indent << "\"" << name << "\": [\n";
+  bool first = true;
+  for (const auto& entry : snapshot.entries) {
+    if (entry.second.version > since) {
+      if (!first)
+        str << ",\n";
+      str << indent2 << "{\n" << entry.second.json << indent2 << "}";
+      first = false;
+    }
+  }
+  if (!first)
+    str << "\n";
+  str << indent << "],\n";
+
+  // Resources that did not exist at the passed version need not be reported.
+  str << indent << "\"removed_" << name << "\": [";
+  first = true;
+  if (since) {
+    for (const auto& removed : snapshot.removed) {
+      if (removed.second.version > since) {
+        str << (first ? "" : ", ") << removed.second.id;
+        first = false;
+      }
+    }
+  }
+  str << "]";
+  return str.str();
+}
+
+// Websocket that replies to each message, a query string, with the result of
+// ResourceHandler::GetResourceUpdates(). This lets clients poll for changes
+// without the overhead of a new HTTP request each time.
+class ResourceUpdatesWebsocket : public HttpServer::Websocket {
+ public:
+  explicit ResourceUpdatesWebsocket(ResourceHandler* handler)
+      : handler_(handler) {}
+
+  int ReceiveData(char* data, size_t data_len, bool is_binary) override {
+    const std::string updates = handler_->GetResourceUpdates(
+        HttpServer::ParseQueryString(std::string(data, data_len)));
+    SendData(updates.data(), updates.length(), false);
+    return 1;
+  }
+
+ private:
+  ~ResourceUpdatesWebsocket() override {}
+
+  base::ReferentPtr<ResourceHandler>::Type handler_;
+};
+
 }  // anonymous namespace
 
+class ResourceHandler::Snapshot {
+ public:
+  Snapshot() : version(0U) {}
+  // The current version, which is incremented by each update that changes
+  // anything.
+  uint64 version;
+  // The state of each resource type, by name.
+  std::map<std::string, SnapshotType> types;
+};
+
 //-----------------------------------------------------------------------------
 //
 // ResourceHandler functions.
@@ -946,12 +1148,61 @@ static const std::string GetTextureData(const RendererPtr& renderer,
 
 ResourceHandler::ResourceHandler(const gfx::RendererPtr& renderer)
     : HttpServer::RequestHandler("/ion/resources"),
-      renderer_(renderer) {
+      renderer_(renderer),
+      snapshot_(new Snapshot) {
   IonRemoteResourcesRoot::RegisterAssetsOnce();
 }
 
 ResourceHandler::~ResourceHandler() {}
 
+const std::string ResourceHandler::GetResourceUpdates(
+    const HttpServer::QueryMap& args) {
+  const bool wait_for_completion = args.find("nonblocking") == args.end();
+  uint64 since = 0U;
+  HttpServer::QueryMap::const_iterator it = args.find("since");
+  if (it != args.end())
+    std::istringstream(it->second) >> since;
+  std::vector<std::string> types;
+  it = args.find("types");
+  if (it != args.end())
+    types = base::SplitString(it->second, ",");
+
+  base::LockGuard guard(&snapshot_mutex_);
+  const uint64 version = snapshot_->version + 1U;
+  bool changed = false;
+  std::vector<std::string> valid_types;
+  for (size_t i = 0; i < types.size(); ++i) {
+    // A type that was not tracked before always creates a new version, so
+    // that a client never holds a version that predates the type's snapshot.
+    const bool is_new_type =
+        snapshot_->types.find(types[i]) == snapshot_->types.end();
+    // Ignore invalid labels.
+    if (UpdateSnapshot(renderer_, types[i], wait_for_completion, version,
+                       &snapshot_->types[types[i]], &changed)) {
+      valid_types.push_back(types[i]);
+      changed = changed || is_new_type;
+    } else {
+      snapshot_->types.erase(types[i]);
+    }
+  }
+  if (changed)
+    snapshot_->version = version;
+  // A client with a version from the future, e.g., one that has connected to a
+  // previous handler instance, gets everything.
+  if (since > snapshot_->version)
+    since = 0U;
+
+  std::ostringstream str;
+  const Indent indent(2);
+  str << "{\n" << indent << "\"version\": " << snapshot_->version;
+  for (size_t i = 0; i < valid_types.size(); ++i) {
+    str << ",\n" << ConvertSnapshotTypeToJson(
+        indent, valid_types[i], snapshot_->types[valid_types[i]], since);
+  }
+  str << "\n}\n";
+  return str.str();
+}
+
 const std::string ResourceHandler::HandleRequest(
     const std::string& path_in, const HttpServer::QueryMap& args,
     std::string* content_type) {
@@ -962,24 +1213,41 @@ const std::string ResourceHandler::HandleRequest(
   } else if (path == "resources_by_type") {
     *content_type = "application/json";
     return GetResourceList(renderer_, args);
+  } else if (path == "resource_updates") {
+    *content_type = "application/json";
+    return GetResourceUpdates(args);
   } else if (path == "texture_data") {
     *content_type = "image/png";
     return GetTextureData(
         renderer_, args, args.find("nonblocking") == args.end());
   } else {
-    const std::string& data = base::ZipAssetManager::GetFileData(
-        "ion/resources/" + path);
-    if (base::IsInvalidReference(data)) {
+    const std::shared_ptr<const std::string> data =
+        base::ZipAssetManager::GetFileDataPtr("ion/resources/" + path);
+    if (!data) {
       return std::string();
     } else {
       // Ensure the content type is set if the editor HTML is requested.
       if (base::EndsWith(path, "html"))
         *content_type = "text/html";
-      return data;
+      return *data;
     }
   }
 }
 
+std::shared_ptr<const std::string> ResourceHandler::HandleGzippedRequest(
+    const std::string& path_in, const HttpServer::QueryMap& args,
+    std::string* content_type) {
+  const std::string path = path_in.empty() ? "index.html" : path_in;
+  return GetGzippedAsset("ion/resources/" + path, content_type);
+}
+
+const HttpServer::WebsocketPtr ResourceHandler::ConnectWebsocket(
+    const std::string& path, const HttpServer::QueryMap& args) {
+  if (path == "updates")
+    return HttpServer::WebsocketPtr(new ResourceUpdatesWebsocket(this));
+  return HttpServer::WebsocketPtr();
+}
+
 }  // namespace remote
 }  // namespace ion
 
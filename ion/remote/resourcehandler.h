@@ -18,9 +18,11 @@ limitations under the License.
 #ifndef ION_REMOTE_RESOURCEHANDLER_H_
 #define ION_REMOTE_RESOURCEHANDLER_H_
 
+#include <memory>
 #include <string>
 
 #include "ion/gfx/renderer.h"
+#include "ion/port/mutex.h"
 #include "ion/remote/httpserver.h"
 
 namespace ion {
@@ -34,17 +36,51 @@ namespace remote {
 //                             resources of the queried types
 // /texture_data&id=#    - Gets a PNG image of the texture with the passed
 //                             OpenGL texture ID
+// /resource_updates?types=t1,t2...&since=#
+//                       - Gets a JSON struct containing only the resources of
+//                             the queried types that were created, changed or
+//                             destroyed since the passed version (see
+//                             GetResourceUpdates())
+// /updates              - Websocket that replies to each message, which must
+//                             have the form "types=t1,t2...&since=#", with
+//                             the same JSON as resource_updates
 class ION_API ResourceHandler : public HttpServer::RequestHandler {
  public:
   explicit ResourceHandler(const gfx::RendererPtr& renderer);
   ~ResourceHandler() override;
 
+  // Returns a JSON struct with the changes to the resources of the types listed
+  // in the "types" argument since the version in the "since" argument (0 if
+  // absent). The handler keeps a versioned snapshot of the last known state of
+  // each resource, and only asks the Renderer for information about resources
+  // whose ResourceHolder change count moved since the snapshot was taken, so
+  // the cost on the render thread is proportional to the number of changed
+  // resources. The struct has a "version" member with the current version,
+  // which should be passed as "since" in the next request, an array of
+  // resources for each type that has new or changed resources, and a
+  // "removed_<type>" array with the object ids of destroyed resources of each
+  // type. Platform information does not change, and is only returned in
+  // resources_by_type requests.
+  const std::string GetResourceUpdates(const HttpServer::QueryMap& args);
+
   const std::string HandleRequest(const std::string& path,
                                   const HttpServer::QueryMap& args,
                                   std::string* content_type) override;
+  std::shared_ptr<const std::string> HandleGzippedRequest(
+      const std::string& path, const HttpServer::QueryMap& args,
+      std::string* content_type) override;
+  const HttpServer::WebsocketPtr ConnectWebsocket(
+      const std::string& path, const HttpServer::QueryMap& args) override;
 
  private:
+  // Versioned state of the resources that have been reported by
+  // GetResourceUpdates().
+  class Snapshot;
+
   gfx::RendererPtr renderer_;
+  std::unique_ptr<Snapshot> snapshot_;
+  // Serializes snapshot updates from concurrent requests.
+  port::Mutex snapshot_mutex_;
 };
 
 }  // namespace remote
@@ -19,7 +19,8 @@ limitations under the License.
 
 #include "ion/remote/settinghandler.h"
 
-#include "ion/base/invalid.h"
+#include <memory>
+
 #include "ion/base/setting.h"
 #include "ion/base/settingmanager.h"
 #include "ion/base/stringutils.h"
@@ -100,19 +101,26 @@ const std::string SettingHandler::HandleRequest(
   } else  if (path == "set_setting_value") {
     return SetSettingValue(args);
   } else {
-    const std::string& data = base::ZipAssetManager::GetFileData(
-        "ion/settings/" + path);
-    if (base::IsInvalidReference(data)) {
+    const std::shared_ptr<const std::string> data =
+        base::ZipAssetManager::GetFileDataPtr("ion/settings/" + path);
+    if (!data) {
       return std::string();
     } else {
       // Ensure the content type is set if the editor HTML is requested.
       if (base::EndsWith(path, "html"))
         *content_type = "text/html";
-      return data;
+      return *data;
     }
   }
 }
 
+std::shared_ptr<const std::string> SettingHandler::HandleGzippedRequest(
+    const std::string& path_in, const HttpServer::QueryMap& args,
+    std::string* content_type) {
+  const std::string path = path_in.empty() ? "index.html" : path_in;
+  return GetGzippedAsset("ion/settings/" + path, content_type);
+}
+
 }  // namespace remote
 }  // namespace ion
 
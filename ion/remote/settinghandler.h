@@ -18,6 +18,7 @@ limitations under the License.
 #ifndef ION_REMOTE_SETTINGHANDLER_H_
 #define ION_REMOTE_SETTINGHANDLER_H_
 
+#include <memory>
 #include <string>
 
 #include "ion/remote/httpserver.h"
@@ -49,6 +50,9 @@ class ION_API SettingHandler : public HttpServer::RequestHandler {
   const std::string HandleRequest(const std::string& path,
                                   const HttpServer::QueryMap& args,
                                   std::string* content_type) override;
+  std::shared_ptr<const std::string> HandleGzippedRequest(
+      const std::string& path, const HttpServer::QueryMap& args,
+      std::string* content_type) override;
 };
 
 }  // namespace remote
@@ -19,10 +19,10 @@ limitations under the License.
 
 #include "ion/remote/shaderhandler.h"
 
+#include <memory>
 #include <sstream>
 
 #include "base/integral_types.h"
-#include "ion/base/invalid.h"
 #include "ion/base/stringutils.h"
 #include "ion/base/zipassetmanager.h"
 #include "ion/base/zipassetmanagermacros.h"
@@ -378,15 +378,15 @@ const std::string ShaderHandler::HandleRequest(const std::string& path_in,
   } else if (path == "update_changed_dependencies") {
     return UpdateAndServeChangedDependencies(sm_);
   } else if (base::StartsWith(path, "shader_editor")) {
-    const std::string& data = base::ZipAssetManager::GetFileData(
-        "ion/shaders/" + path);
-    if (base::IsInvalidReference(data)) {
+    const std::shared_ptr<const std::string> data =
+        base::ZipAssetManager::GetFileDataPtr("ion/shaders/" + path);
+    if (!data) {
       return std::string();
     } else {
       // Ensure the content type is set if the editor HTML is requested.
       if (base::EndsWith(path, "html"))
         *content_type = "text/html";
-      return data;
+      return *data;
     }
   } else {
     return GetShadersRootString(sm_, renderer_, path, args, content_type);
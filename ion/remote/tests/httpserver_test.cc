@@ -19,15 +19,22 @@ limitations under the License.
 
 #include "ion/remote/httpserver.h"
 
+#include <atomic>
 #include <sstream>
+#include <vector>
 
+#include "ion/analytics/benchmark.h"
+#include "ion/analytics/benchmarkutils.h"
 #include "ion/base/logchecker.h"
 #include "ion/base/stringutils.h"
 #include "ion/base/zipassetmanager.h"
 #include "ion/base/zipassetmanagermacros.h"
+#include "ion/port/threadutils.h"
+#include "ion/port/timer.h"
 #include "ion/remote/tests/httpservertest.h"
 
 #include "third_party/googletest/googletest/include/gtest/gtest.h"
+#include "third_party/zlib/src/zlib.h"
 
 // Resources for tests.
 ION_REGISTER_ASSETS(IonTestRemoteRoot);
@@ -172,6 +179,80 @@ class EmbedHandler : public HttpServer::RequestHandler {
   }
 };
 
+class LargeTextHandler : public HttpServer::RequestHandler {
+ public:
+  explicit LargeTextHandler(const std::string& base_path)
+      : RequestHandler(base_path) {}
+  ~LargeTextHandler() override {}
+  const std::string HandleRequest(const std::string& path,
+                                  const HttpServer::QueryMap& args,
+                                  std::string* content_type) override {
+    return GetText();
+  }
+  std::shared_ptr<const std::string> HandleGzippedRequest(
+      const std::string& path, const HttpServer::QueryMap& args,
+      std::string* content_type) override {
+    if (path == "pre.txt") {
+      // Return a marker rather than actual gzip data so that the test can
+      // tell which path was taken.
+      return std::shared_ptr<const std::string>(
+          new std::string("precompressed"));
+    }
+    return std::shared_ptr<const std::string>();
+  }
+  static const std::string GetText() {
+    std::string text;
+    for (int i = 0; i < 200; ++i)
+      text += "Some highly compressible text. ";
+    return text;
+  }
+};
+
+// Sends a GET request for the passed path with the passed extra headers
+// directly through mongoose, and returns the response.
+static const HttpClient::Response SendRawRequest(const std::string& localhost,
+                                                 const std::string& path,
+                                                 const std::string& headers) {
+  HttpClient::Response response;
+  const HttpClient::Url url(localhost + path);
+  char error[256];
+  if (mg_connection* connection = mg_download(
+          url.hostname.c_str(), url.port, 0, error, sizeof(error),
+          "GET %s HTTP/1.1\r\nHost: %s\r\n%s\r\n", path.c_str(),
+          url.hostname.c_str(), headers.c_str())) {
+    mg_request_info* info = mg_get_request_info(connection);
+    // Mongoose places the returned status code as a string in the uri.
+    if (info->uri)
+      response.status = base::StringToInt32(info->uri);
+    for (int i = 0; i < info->num_headers; ++i)
+      response.headers[info->http_headers[i].name] =
+          info->http_headers[i].value;
+    char buf[512];
+    int bytes_read;
+    while ((bytes_read = mg_read(connection, buf, sizeof(buf))) > 0)
+      response.data.insert(response.data.end(), buf, &buf[bytes_read]);
+    mg_close_connection(connection);
+  }
+  return response;
+}
+
+// Returns the decompressed contents of gzip data, or an empty string if the
+// data is not valid.
+static const std::string Gunzip(const std::string& data) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  EXPECT_EQ(Z_OK, inflateInit2(&stream, 15 + 16));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.length());
+  std::string out(64 * 1024, '\0');
+  stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+  stream.avail_out = static_cast<uInt>(out.length());
+  const int result = inflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  inflateEnd(&stream);
+  return result == Z_STREAM_END ? out : std::string();
+}
+
 }  // anonymous namespace
 
 TEST_F(HttpServerTest, FailedServer) {
@@ -411,6 +492,154 @@ TEST_F(HttpServerTest, EmbeddingLocalFiles) {
             response_.data);
 }
 
+#if !defined(ION_PLATFORM_ASMJS) && !defined(ION_PLATFORM_NACL)
+TEST_F(HttpServerTest, KeepAlive) {
+  server_->RegisterHandler(
+      RequestHandlerPtr(new TextHandler("/test/path/to/file.txt")));
+
+  // HTTP/1.1 connections are kept open unless the client asks otherwise.
+  response_ = SendRawRequest(localhost_, "/test/path/to/file.txt", "");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_EQ("keep-alive", response_.headers["Connection"]);
+  EXPECT_EQ("4", response_.headers["Content-Length"]);
+  EXPECT_EQ("text", response_.data);
+
+  response_ = SendRawRequest(localhost_, "/test/path/to/file.txt",
+                             "Connection: close\r\n");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_EQ("close", response_.headers["Connection"]);
+  EXPECT_EQ("text", response_.data);
+
+  // 404s respect the connection type as well.
+  response_ = SendRawRequest(localhost_, "/does/not/exist", "");
+  EXPECT_EQ(404, response_.status);
+  EXPECT_EQ("keep-alive", response_.headers["Connection"]);
+
+  // Keep-alive can be disabled.
+  HttpServer::Options options;
+  options.keep_alive = false;
+  const int port = testing::GetUnusedPort(500);
+  HttpServer server(port, options);
+  EXPECT_TRUE(server.IsRunning());
+  EXPECT_FALSE(server.GetOptions().keep_alive);
+  server.RegisterHandler(
+      RequestHandlerPtr(new TextHandler("/test/path/to/file.txt")));
+  response_ = SendRawRequest("localhost:" + base::ValueToString(port),
+                             "/test/path/to/file.txt", "");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_EQ("close", response_.headers["Connection"]);
+  EXPECT_EQ("text", response_.data);
+}
+
+TEST_F(HttpServerTest, GzipEncoding) {
+  server_->RegisterHandler(RequestHandlerPtr(new LargeTextHandler("/large")));
+  server_->RegisterHandler(
+      RequestHandlerPtr(new TextHandler("/test/path/to/file.txt")));
+  const std::string text = LargeTextHandler::GetText();
+
+  // Clients that do not accept gzip get the plain data.
+  response_ = SendRawRequest(localhost_, "/large/file.txt", "");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_EQ(0U, response_.headers.count("Content-Encoding"));
+  EXPECT_EQ("Accept-Encoding", response_.headers["Vary"]);
+  EXPECT_EQ(text, response_.data);
+
+  // Large compressible responses are compressed on the fly.
+  response_ = SendRawRequest(localhost_, "/large/file.txt",
+                             "Accept-Encoding: deflate, gzip\r\n");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_EQ("gzip", response_.headers["Content-Encoding"]);
+  EXPECT_EQ("text/plain", response_.headers["Content-Type"]);
+  EXPECT_LT(response_.data.length(), text.length());
+  EXPECT_EQ(base::ValueToString(response_.data.length()),
+            response_.headers["Content-Length"]);
+  EXPECT_EQ(text, Gunzip(response_.data));
+
+  // Data that the handler provides precompressed is sent as-is.
+  response_ = SendRawRequest(localhost_, "/large/pre.txt",
+                             "Accept-Encoding: gzip\r\n");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_EQ("gzip", response_.headers["Content-Encoding"]);
+  EXPECT_EQ("precompressed", response_.data);
+
+  // Gzip with a zero quality is refused.
+  response_ = SendRawRequest(localhost_, "/large/file.txt",
+                             "Accept-Encoding: gzip;q=0\r\n");
+  EXPECT_EQ(0U, response_.headers.count("Content-Encoding"));
+  EXPECT_EQ(text, response_.data);
+
+  // Range requests are never compressed.
+  response_ = SendRawRequest(localhost_, "/large/file.txt",
+                             "Accept-Encoding: gzip\r\nRange: bytes=5-14\r\n");
+  EXPECT_EQ(206, response_.status);
+  EXPECT_EQ(0U, response_.headers.count("Content-Encoding"));
+  EXPECT_EQ("10", response_.headers["Content-Length"]);
+  EXPECT_EQ(text.substr(5, 10), response_.data);
+
+  // Small responses are not worth compressing.
+  response_ = SendRawRequest(localhost_, "/test/path/to/file.txt",
+                             "Accept-Encoding: gzip\r\n");
+  EXPECT_EQ(0U, response_.headers.count("Content-Encoding"));
+  EXPECT_EQ("text", response_.data);
+}
+
+TEST_F(HttpServerTest, LoadBenchmark) {
+  // Measures request latency while several clients poll the server at once,
+  // which is how the remote dashboards use it.
+  static const int kNumClients = 8;
+  static const int kRequestsPerClient = 25;
+  server_->RegisterHandler(RequestHandlerPtr(new LargeTextHandler("/large")));
+  const std::string text = LargeTextHandler::GetText();
+
+  std::vector<double> latencies[kNumClients];
+  std::atomic<int> failures(0);
+  std::vector<port::ThreadId> threads;
+  std::vector<std::unique_ptr<port::ThreadStdFunc>> funcs;
+  port::Timer total_timer;
+  for (int i = 0; i < kNumClients; ++i) {
+    std::vector<double>* client_latencies = &latencies[i];
+    const std::string localhost = localhost_;
+    funcs.push_back(std::unique_ptr<port::ThreadStdFunc>(
+        new port::ThreadStdFunc([=, &failures]() {
+          for (int j = 0; j < kRequestsPerClient; ++j) {
+            port::Timer timer;
+            const HttpClient::Response response = SendRawRequest(
+                localhost, "/large/file.txt", "Accept-Encoding: gzip\r\n");
+            client_latencies->push_back(timer.GetInMs());
+            if (response.status != 200 || Gunzip(response.data) != text)
+              ++failures;
+          }
+          return true;
+        })));
+    threads.push_back(port::SpawnThreadStd(funcs.back().get()));
+  }
+  for (size_t i = 0; i < threads.size(); ++i)
+    port::JoinThread(threads[i]);
+  const double total_ms = total_timer.GetInMs();
+  EXPECT_EQ(0, failures);
+
+  analytics::Benchmark benchmark;
+  analytics::Benchmark::VariableAccumulator accumulator(
+      analytics::Benchmark::Descriptor("Request latency", "HttpServer load",
+                                       "Latency of gzipped GET requests",
+                                       "ms"));
+  for (int i = 0; i < kNumClients; ++i) {
+    EXPECT_EQ(static_cast<size_t>(kRequestsPerClient), latencies[i].size());
+    for (size_t j = 0; j < latencies[i].size(); ++j)
+      accumulator.AddSample(latencies[i][j]);
+  }
+  benchmark.AddAccumulatedVariable(accumulator.Get());
+  benchmark.AddConstant(analytics::Benchmark::Constant(
+      analytics::Benchmark::Descriptor("Throughput", "HttpServer load",
+                                       "Requests served per second",
+                                       "requests/s"),
+      kNumClients * kRequestsPerClient * 1000.0 / total_ms));
+  std::ostringstream out;
+  analytics::OutputBenchmarkPretty("HttpServer load", true, benchmark, out);
+  LOG(INFO) << out.str();
+}
+#endif
+
 }  // namespace remote
 }  // namespace ion
 
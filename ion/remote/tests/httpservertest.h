@@ -126,6 +126,12 @@ class HttpServerTestRequestHandler : public HttpServer::RequestHandler {
     return result;
   }
 
+  std::shared_ptr<const std::string> HandleGzippedRequest(
+      const std::string& path, const HttpServer::QueryMap& args,
+      std::string* content_type) override {
+    return inner_->HandleGzippedRequest(path, args, content_type);
+  }
+
   // By default, RequestHandlers don't support websocket connections.
   const HttpServer::WebsocketPtr ConnectWebsocket(
       const std::string& path, const HttpServer::QueryMap& args) override {
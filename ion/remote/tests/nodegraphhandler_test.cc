@@ -22,6 +22,7 @@ limitations under the License.
 #include <iomanip>
 
 #include "ion/base/invalid.h"
+#include "ion/base/stringutils.h"
 #include "ion/base/tests/multilinestringsequal.h"
 #include "ion/base/zipassetmanager.h"
 #include "ion/gfx/attributearray.h"
@@ -269,6 +270,64 @@ TEST_F(NodeGraphHandlerTest, ServeNodeGraph) {
       response_.data));
 }
 
+TEST_F(NodeGraphHandlerTest, VersionedUpdates) {
+  const std::string header(
+      "<span class=\"nodes_header\">Tracked Nodes</span><br><br>\n");
+  const std::string empty_graph("<pre>\n</pre>\n");
+
+  GetUri("/ion/nodegraph/update?since=0");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_EQ("<!--version:1-->\n" + header + empty_graph, response_.data);
+
+  // Nothing has changed, so only the version is returned.
+  GetUri("/ion/nodegraph/update?since=1");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_EQ("<!--version:1-->\n", response_.data);
+
+  // A changing frame counter does not change the version.
+  gfxutils::FramePtr frame(new gfxutils::Frame);
+  frame->Begin();
+  frame->End();
+  ngh_->SetFrame(frame);
+  GetUri("/ion/nodegraph/update?since=1");
+  EXPECT_EQ("<!--version:1-->\n", response_.data);
+  ngh_->SetFrame(gfxutils::FramePtr());
+
+  // Different options are versioned separately.
+  GetUri("/ion/nodegraph/update?format=HTML&since=1");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_EQ("<!--version:2-->\n" + header + "<div class=\"tree\">\n</div>\n",
+            response_.data);
+  GetUri("/ion/nodegraph/update?since=1");
+  EXPECT_EQ("<!--version:1-->\n", response_.data);
+  EXPECT_EQ(2U, ngh_->GetPrintedGraphCount());
+
+  // Arguments that do not change the printing options share a version.
+  GetUri("/ion/nodegraph/update?format=Text&since=1");
+  EXPECT_EQ("<!--version:1-->\n", response_.data);
+  GetUri("/ion/nodegraph/update?enable_address_printing=false&since=1");
+  EXPECT_EQ("<!--version:1-->\n", response_.data);
+  GetUri("/ion/nodegraph/update?nonce=12345&since=1");
+  EXPECT_EQ("<!--version:1-->\n", response_.data);
+  EXPECT_EQ(2U, ngh_->GetPrintedGraphCount());
+
+  // Tracking a Node changes the graph.
+  gfx::NodePtr node(new gfx::Node);
+  ngh_->AddNode(node);
+  GetUri("/ion/nodegraph/update?since=1");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_TRUE(base::StartsWith(response_.data, "<!--version:3-->\n" + header));
+  EXPECT_NE(std::string::npos, response_.data.find("ION Node"));
+  GetUri("/ion/nodegraph/update?since=3");
+  EXPECT_EQ("<!--version:3-->\n", response_.data);
+
+  // Changing the Node also changes the graph.
+  node->Enable(false);
+  GetUri("/ion/nodegraph/update?since=3");
+  EXPECT_TRUE(base::StartsWith(response_.data, "<!--version:4-->\n"));
+  EXPECT_NE(std::string::npos, response_.data.find("Enabled: false"));
+}
+
 }  // namespace remote
 }  // namespace ion
 
@@ -0,0 +1,127 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+#if !ION_PRODUCTION
+
+#include "ion/remote/profilehandler.h"
+
+#include "ion/profile/calltracemanager.h"
+#include "ion/profile/profiling.h"
+#include "ion/profile/samplingprofiler.h"
+#include "ion/profile/streamingmetrics.h"
+#include "ion/remote/tests/httpservertest.h"
+
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace remote {
+
+class ProfileHandlerTest : public RemoteServerTest {
+ protected:
+  void SetUp() override {
+    RemoteServerTest::SetUp();
+    server_->SetHeaderHtml("");
+    server_->SetFooterHtml("");
+    server_->RegisterHandler(
+        HttpServer::RequestHandlerPtr(new ProfileHandler()));
+  }
+  void TearDown() override {
+    profile::SamplingProfiler::Get()->Stop();
+    profile::GetCallTraceManager()->GetStreamingMetrics()->SetEnabled(false);
+    RemoteServerTest::TearDown();
+  }
+};
+
+TEST_F(ProfileHandlerTest, ServeProfile) {
+  GetUri("/ion/profile/does/not/exist");
+  Verify404(__LINE__);
+
+  GetUri("/ion/profile/");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_NE(std::string::npos, response_.data.find("<html>"));
+
+  GetUri("/ion/profile/index.html");
+  EXPECT_EQ(200, response_.status);
+
+  GetUri("/ion/profile/start?frequency=abc");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_EQ("Invalid frequency", response_.data);
+  EXPECT_FALSE(profile::SamplingProfiler::Get()->IsRunning());
+
+  if (profile::SamplingProfiler::IsSupported()) {
+    GetUri("/ion/profile/start?frequency=500");
+    EXPECT_EQ(200, response_.status);
+    EXPECT_EQ("OK", response_.data);
+    EXPECT_TRUE(profile::SamplingProfiler::Get()->IsRunning());
+
+    GetUri("/ion/profile/index.html");
+    EXPECT_NE(std::string::npos, response_.data.find("running"));
+  }
+
+  GetUri("/ion/profile/stop");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_EQ("OK", response_.data);
+  EXPECT_FALSE(profile::SamplingProfiler::Get()->IsRunning());
+
+  // There is nothing to serve if no samples were recorded.
+  const std::string folded =
+      profile::SamplingProfiler::Get()->GetFoldedStacks();
+  GetUri("/ion/profile/samples.folded");
+  if (folded.empty()) {
+    Verify404(__LINE__);
+  } else {
+    EXPECT_EQ(200, response_.status);
+    EXPECT_EQ(folded, response_.data);
+  }
+
+  GetUri("/ion/profile/flamegraph.json");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_NE(std::string::npos, response_.data.find("\"children\""));
+}
+
+TEST_F(ProfileHandlerTest, ServeMetrics) {
+  profile::StreamingMetrics* metrics =
+      profile::GetCallTraceManager()->GetStreamingMetrics();
+
+  GetUri("/ion/profile/metrics/start");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_EQ("OK", response_.data);
+  EXPECT_TRUE(metrics->IsEnabled());
+
+  {
+    ION_PROFILE_FUNCTION("ProfileHandlerTest::ServeMetrics");
+  }
+
+  GetUri("/ion/profile/metrics.json");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_NE(std::string::npos, response_.data.find("\"enabled\":true"));
+  EXPECT_NE(std::string::npos,
+            response_.data.find("ProfileHandlerTest::ServeMetrics"));
+
+  GetUri("/ion/profile/metrics/reset");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_EQ(0U,
+            metrics->GetScopeSummary("ProfileHandlerTest::ServeMetrics").count);
+
+  GetUri("/ion/profile/metrics/stop");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_FALSE(metrics->IsEnabled());
+}
+
+}  // namespace remote
+}  // namespace ion
+
+#endif
@@ -53,6 +53,7 @@
         'calltracehandler_test.cc',
         'httpserver_test.cc',
         'nodegraphhandler_test.cc',
+        'profilehandler_test.cc',
         'remoteserver_test.cc',
         'resourcehandler_test.cc',
         'settinghandler_test.cc',
@@ -64,6 +65,7 @@
         ':ionremote_test_assets',
         '<(ion_dir)/base/base.gyp:ionbase',
         '<(ion_dir)/external/external.gyp:ioneasywsclient',
+        '<(ion_dir)/external/external.gyp:ionzlib',
         '<(ion_dir)/external/gtest.gyp:iongtest_safeallocs',
         '<(ion_dir)/gfx/gfx.gyp:iongfx_for_tests',
         '<(ion_dir)/gfxutils/gfxutils.gyp:iongfxutils_for_tests',
@@ -99,6 +99,7 @@ TEST_F(RemoteServerTest, SucceedServer) {
   const HttpServer::HandlerMap handler_map = server->GetHandlers();
   EXPECT_NE(handler_map.end(), handler_map.find("/ion/nodegraph"));
   EXPECT_NE(handler_map.end(), handler_map.find("/ion/calltrace"));
+  EXPECT_NE(handler_map.end(), handler_map.find("/ion/profile"));
   EXPECT_NE(handler_map.end(), handler_map.find("/ion/resources"));
   EXPECT_NE(handler_map.end(), handler_map.find("/ion/settings"));
   EXPECT_NE(handler_map.end(), handler_map.find("/ion/shaders"));
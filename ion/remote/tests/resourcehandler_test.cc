@@ -1863,6 +1863,86 @@ TEST_F(ResourceHandlerTest, GetResources) {
   EXPECT_TRUE(base::testing::MultiLineStringsEqual(
       base::JoinStrings(strings, ""), response_.data));
 }
+
+TEST_F(ResourceHandlerTest, GetResourceUpdates) {
+  // There are no resources without a scene, but the first request always
+  // creates a new version.
+  GetUri("/ion/resources/resource_updates?types=buffers,shaders&nonblocking");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_TRUE(base::StartsWith(response_.data, "{\n  \"version\": 1,\n"));
+  EXPECT_NE(std::string::npos, response_.data.find("\"buffers\": [\n  ]"));
+  EXPECT_NE(std::string::npos, response_.data.find("\"shaders\": [\n  ]"));
+
+  TestScene scene;
+  NodePtr root = scene.GetScene();
+  DrawScene(root);
+
+  // All resources are new.
+  GetUri(
+      "/ion/resources/resource_updates?types=buffers,shaders,invalid&since=1&"
+      "nonblocking");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_TRUE(base::StartsWith(response_.data, "{\n  \"version\": 2,\n"));
+  EXPECT_NE(std::string::npos,
+            response_.data.find("\"label\": \"Indices #0\""));
+  EXPECT_NE(std::string::npos,
+            response_.data.find("\"label\": \"Vertex shader\""));
+  EXPECT_EQ(std::string::npos, response_.data.find("invalid"));
+
+  // Nothing changed.
+  GetUri("/ion/resources/resource_updates?types=buffers,shaders&since=2&"
+         "nonblocking");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_TRUE(base::StartsWith(response_.data, "{\n  \"version\": 2,\n"));
+  EXPECT_NE(std::string::npos, response_.data.find("\"buffers\": [\n  ]"));
+  EXPECT_NE(std::string::npos, response_.data.find("\"shaders\": [\n  ]"));
+
+  // Only the changed buffer is returned.
+  root->GetChildren()[0]->GetChildren()[0]->GetShapes()[0]
+      ->GetIndexBuffer()->SetLabel("Changed indices");
+  DrawScene(root);
+  GetUri("/ion/resources/resource_updates?types=buffers,shaders&since=2&"
+         "nonblocking");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_TRUE(base::StartsWith(response_.data, "{\n  \"version\": 3,\n"));
+  EXPECT_NE(std::string::npos,
+            response_.data.find("\"label\": \"Changed indices\""));
+  EXPECT_EQ(std::string::npos,
+            response_.data.find("\"label\": \"Vertex shader\""));
+  EXPECT_NE(std::string::npos, response_.data.find("\"shaders\": [\n  ]"));
+
+  // A version newer than the current one returns everything.
+  GetUri("/ion/resources/resource_updates?types=shaders&since=100&"
+         "nonblocking");
+  EXPECT_TRUE(base::StartsWith(response_.data, "{\n  \"version\": 3,\n"));
+  EXPECT_NE(std::string::npos,
+            response_.data.find("\"label\": \"Vertex shader\""));
+}
+
+TEST_F(ResourceHandlerTest, GetResourceUpdatesWithoutIds) {
+  // Shaders that could not be created all have id 0, but are still reported
+  // separately.
+  gm_->SetForceFunctionFailure("CreateShader", true);
+  TestScene scene;
+  NodePtr root = scene.GetScene();
+  DrawScene(root);
+  GetUri("/ion/resources/resource_updates?types=shaders&nonblocking");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_NE(std::string::npos,
+            response_.data.find("\"label\": \"Vertex shader\""));
+  EXPECT_NE(std::string::npos,
+            response_.data.find("\"label\": \"Fragment shader\""));
+
+  // They are queried again until they are created.
+  gm_->SetForceFunctionFailure("CreateShader", false);
+  GetUri("/ion/resources/resource_updates?types=shaders&since=1&nonblocking");
+  EXPECT_EQ(200, response_.status);
+  EXPECT_TRUE(base::StartsWith(response_.data, "{\n  \"version\": 2,\n"));
+  EXPECT_NE(std::string::npos,
+            response_.data.find("\"label\": \"Vertex shader\""));
+  EXPECT_NE(std::string::npos,
+            response_.data.find("\"label\": \"Fragment shader\""));
+}
 #endif  // ION_PRODUCTION
 
 TEST_F(ResourceHandlerTest, GetBufferData) {
@@ -19,9 +19,9 @@ limitations under the License.
 
 #include "ion/remote/tracinghandler.h"
 
+#include <memory>
 #include <vector>
 
-#include "ion/base/invalid.h"
 #include "ion/base/logging.h"
 #include "ion/base/serialize.h"
 #include "ion/base/stringutils.h"
@@ -340,18 +340,25 @@ const std::string TracingHandler::HandleRequest(
     html_string_.clear();
     return "clear";
   } else {
-    const std::string& data =
-        base::ZipAssetManager::GetFileData("ion/tracing/" + path);
-    if (!base::IsInvalidReference(data)) {
+    const std::shared_ptr<const std::string> data =
+        base::ZipAssetManager::GetFileDataPtr("ion/tracing/" + path);
+    if (data) {
       // Ensure the content type is set if the editor HTML is requested.
       if (base::EndsWith(path, "html"))
         *content_type = "text/html";
-      return data;
+      return *data;
     }
   }
   return std::string();
 }
 
+std::shared_ptr<const std::string> TracingHandler::HandleGzippedRequest(
+    const std::string& path_in, const HttpServer::QueryMap& args,
+    std::string* content_type) {
+  const std::string path = path_in.empty() ? "index.html" : path_in;
+  return GetGzippedAsset("ion/tracing/" + path, content_type);
+}
+
 void TracingHandler::TraceNextFrame(bool block_until_frame_rendered) {
   if (frame_.Get()) {
     // Set the state so that tracing occurs during the next frame.
@@ -19,6 +19,7 @@ limitations under the License.
 #define ION_REMOTE_TRACINGHANDLER_H_
 
 #include <functional>
+#include <memory>
 #include <sstream>
 #include <string>
 
@@ -53,6 +54,9 @@ class ION_API TracingHandler : public HttpServer::RequestHandler {
   const std::string HandleRequest(const std::string& path,
                                   const HttpServer::QueryMap& args,
                                   std::string* content_type) override;
+  std::shared_ptr<const std::string> HandleGzippedRequest(
+      const std::string& path, const HttpServer::QueryMap& args,
+      std::string* content_type) override;
 
  private:
   // This enum indicates what state the handler is in.
@@ -28,28 +28,85 @@ namespace text {
 
 using math::Vector2ui;
 
+namespace {
+
+// An axis-aligned rectangle of free space in a bin, used by the MaxRects and
+// Guillotine algorithms.
+struct FreeRect {
+  FreeRect() : x(0), y(0), width(0), height(0) {}
+  FreeRect(int32 x_in, int32 y_in, int32 width_in, int32 height_in)
+      : x(x_in), y(y_in), width(width_in), height(height_in) {}
+
+  int32 x;       // Left X position.
+  int32 y;       // Bottom Y position.
+  int32 width;
+  int32 height;
+};
+
+// Returns true if |inner| lies entirely within |outer|.
+static bool IsContainedIn(const FreeRect& inner, const FreeRect& outer) {
+  return inner.x >= outer.x && inner.y >= outer.y &&
+         inner.x + inner.width <= outer.x + outer.width &&
+         inner.y + inner.height <= outer.y + outer.height;
+}
+
+// Returns whether a rectangle is placed before another when repacking: taller
+// rectangles first, then wider ones, which keeps rows of glyphs even.
+static bool IsPackedBefore(const BinPacker::Rectangle& a,
+                           const BinPacker::Rectangle& b) {
+  if (a.size[1] != b.size[1])
+    return a.size[1] > b.size[1];
+  if (a.size[0] != b.size[0])
+    return a.size[0] > b.size[0];
+  return a.id < b.id;
+}
+
+}  // anonymous namespace
+
 //-----------------------------------------------------------------------------
 //
-// The BinPacker::Skyline is an internal helper class that implements
-// the Skyline Bottom-Left bin-packing algorithm.
+// The BinPacker::Packer is the abstract base class of the internal helper
+// classes that implement each Algorithm.
 //
 //-----------------------------------------------------------------------------
 
-class BinPacker::Skyline {
+class BinPacker::Packer {
  public:
   // For convenience.
   typedef BinPacker::Rectangle Rectangle;
 
-  explicit Skyline(const Vector2ui& bin_size);
-  explicit Skyline(const Skyline& from)  // Copy constructor.
-      : bin_size_(from.bin_size_),
-        levels_(from.levels_) {}
+  explicit Packer(const Vector2ui& bin_size) : bin_size_(bin_size) {}
+  virtual ~Packer() {}
 
   const Vector2ui& GetBinSize() const { return bin_size_; }
 
+  // Returns a copy of this, including the current placement.
+  virtual Packer* Clone() const = 0;
+
   // Inserts a single rectangle into the bin, setting its position. Returns
   // false if the rectangle does not fit.
-  bool Insert(Rectangle* rect);
+  virtual bool Insert(Rectangle* rect) = 0;
+
+ protected:
+  const Vector2ui bin_size_;
+};
+
+//-----------------------------------------------------------------------------
+//
+// The BinPacker::Skyline is an internal helper class that implements
+// the Skyline Bottom-Left bin-packing algorithm.
+//
+//-----------------------------------------------------------------------------
+
+class BinPacker::Skyline : public BinPacker::Packer {
+ public:
+  explicit Skyline(const Vector2ui& bin_size);
+  explicit Skyline(const Skyline& from)  // Copy constructor.
+      : Packer(from.bin_size_),
+        levels_(from.levels_) {}
+
+  Packer* Clone() const override { return new Skyline(*this); }
+  bool Insert(Rectangle* rect) override;
 
  private:
   // A Level represents one level (horizontal line segment) of the skyline.
@@ -82,12 +139,11 @@ class BinPacker::Skyline {
   // Merges all skyline levels that are at the same height.
   void MergeLevels();
 
-  const Vector2ui bin_size_;
   std::vector<Level> levels_;
 };
 
 BinPacker::Skyline::Skyline(const Vector2ui& bin_size)
-    : bin_size_(bin_size) {
+    : Packer(bin_size) {
   // Insert a Level covering the full width of the bin.
   levels_.push_back(Level(0, 0, bin_size[0]));
 }
@@ -188,42 +244,327 @@ void BinPacker::Skyline::MergeLevels() {
   }
 }
 
+//-----------------------------------------------------------------------------
+//
+// The BinPacker::MaxRects is an internal helper class that implements the
+// MaxRects bin-packing algorithm with the Best Short Side Fit rule. It tracks
+// all maximal free rectangles, which may overlap, so it wastes less space than
+// the Skyline at the cost of examining more candidates per insertion.
+//
+//-----------------------------------------------------------------------------
+
+class BinPacker::MaxRects : public BinPacker::Packer {
+ public:
+  explicit MaxRects(const Vector2ui& bin_size);
+  explicit MaxRects(const MaxRects& from)  // Copy constructor.
+      : Packer(from.bin_size_),
+        free_rects_(from.free_rects_) {}
+
+  Packer* Clone() const override { return new MaxRects(*this); }
+  bool Insert(Rectangle* rect) override;
+
+ private:
+  // Splits the free rectangle at |index| around |used| if they intersect,
+  // appending the leftover pieces. Returns true if they intersected, in which
+  // case the free rectangle must be removed.
+  bool SplitFreeRect(size_t index, const FreeRect& used);
+
+  // Removes free rectangles that are contained in other free rectangles.
+  void PruneFreeRects();
+
+  std::vector<FreeRect> free_rects_;
+};
+
+BinPacker::MaxRects::MaxRects(const Vector2ui& bin_size)
+    : Packer(bin_size) {
+  free_rects_.push_back(FreeRect(0, 0, bin_size[0], bin_size[1]));
+}
+
+bool BinPacker::MaxRects::Insert(Rectangle* rect) {
+  const int32 width = static_cast<int32>(rect->size[0]);
+  const int32 height = static_cast<int32>(rect->size[1]);
+
+  // Choose the free rectangle that leaves the smallest leftover along its
+  // shorter side, breaking ties with the longer side.
+  size_t best_index = base::kInvalidIndex;
+  int32 best_short_side = std::numeric_limits<int32>::max();
+  int32 best_long_side = std::numeric_limits<int32>::max();
+  const size_t num_free_rects = free_rects_.size();
+  for (size_t i = 0; i < num_free_rects; ++i) {
+    const FreeRect& free_rect = free_rects_[i];
+    if (free_rect.width < width || free_rect.height < height)
+      continue;
+    const int32 leftover_x = free_rect.width - width;
+    const int32 leftover_y = free_rect.height - height;
+    const int32 short_side = std::min(leftover_x, leftover_y);
+    const int32 long_side = std::max(leftover_x, leftover_y);
+    if (short_side < best_short_side ||
+        (short_side == best_short_side && long_side < best_long_side)) {
+      best_index = i;
+      best_short_side = short_side;
+      best_long_side = long_side;
+    }
+  }
+  if (best_index == base::kInvalidIndex)
+    return false;
+
+  const FreeRect used(free_rects_[best_index].x, free_rects_[best_index].y,
+                      width, height);
+  rect->bottom_left.Set(used.x, used.y);
+
+  // Split every free rectangle that the new one overlaps. The pieces are
+  // appended, so only the original rectangles need to be checked.
+  size_t num_to_check = num_free_rects;
+  for (size_t i = 0; i < num_to_check;) {
+    if (SplitFreeRect(i, used)) {
+      free_rects_.erase(free_rects_.begin() + i);
+      --num_to_check;
+    } else {
+      ++i;
+    }
+  }
+  PruneFreeRects();
+  return true;
+}
+
+bool BinPacker::MaxRects::SplitFreeRect(size_t index, const FreeRect& used) {
+  // Copy the rectangle since appending may reallocate the vector.
+  const FreeRect free_rect = free_rects_[index];
+  if (used.x >= free_rect.x + free_rect.width ||
+      used.x + used.width <= free_rect.x ||
+      used.y >= free_rect.y + free_rect.height ||
+      used.y + used.height <= free_rect.y)
+    return false;
+
+  // Add the maximal pieces of the free rectangle on each side of the used one.
+  if (used.x > free_rect.x) {
+    free_rects_.push_back(FreeRect(free_rect.x, free_rect.y,
+                                   used.x - free_rect.x, free_rect.height));
+  }
+  if (used.x + used.width < free_rect.x + free_rect.width) {
+    free_rects_.push_back(FreeRect(
+        used.x + used.width, free_rect.y,
+        free_rect.x + free_rect.width - (used.x + used.width),
+        free_rect.height));
+  }
+  if (used.y > free_rect.y) {
+    free_rects_.push_back(FreeRect(free_rect.x, free_rect.y, free_rect.width,
+                                   used.y - free_rect.y));
+  }
+  if (used.y + used.height < free_rect.y + free_rect.height) {
+    free_rects_.push_back(FreeRect(
+        free_rect.x, used.y + used.height, free_rect.width,
+        free_rect.y + free_rect.height - (used.y + used.height)));
+  }
+  return true;
+}
+
+void BinPacker::MaxRects::PruneFreeRects() {
+  for (size_t i = 0; i < free_rects_.size(); ++i) {
+    for (size_t j = i + 1; j < free_rects_.size();) {
+      if (IsContainedIn(free_rects_[i], free_rects_[j])) {
+        free_rects_.erase(free_rects_.begin() + i);
+        --i;
+        break;
+      }
+      if (IsContainedIn(free_rects_[j], free_rects_[i]))
+        free_rects_.erase(free_rects_.begin() + j);
+      else
+        ++j;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+//
+// The BinPacker::Guillotine is an internal helper class that implements the
+// Guillotine bin-packing algorithm with the Best Area Fit rule. Each placement
+// cuts the chosen free rectangle in two along the shorter leftover axis, so
+// the free rectangles never overlap and insertion stays cheap.
+//
+//-----------------------------------------------------------------------------
+
+class BinPacker::Guillotine : public BinPacker::Packer {
+ public:
+  explicit Guillotine(const Vector2ui& bin_size);
+  explicit Guillotine(const Guillotine& from)  // Copy constructor.
+      : Packer(from.bin_size_),
+        free_rects_(from.free_rects_) {}
+
+  Packer* Clone() const override { return new Guillotine(*this); }
+  bool Insert(Rectangle* rect) override;
+
+ private:
+  // Merges pairs of free rectangles that together form a rectangle.
+  void MergeFreeRects();
+
+  std::vector<FreeRect> free_rects_;
+};
+
+BinPacker::Guillotine::Guillotine(const Vector2ui& bin_size)
+    : Packer(bin_size) {
+  free_rects_.push_back(FreeRect(0, 0, bin_size[0], bin_size[1]));
+}
+
+bool BinPacker::Guillotine::Insert(Rectangle* rect) {
+  const int32 width = static_cast<int32>(rect->size[0]);
+  const int32 height = static_cast<int32>(rect->size[1]);
+
+  // Choose the smallest free rectangle that the rectangle fits in.
+  size_t best_index = base::kInvalidIndex;
+  int64 best_area = std::numeric_limits<int64>::max();
+  const size_t num_free_rects = free_rects_.size();
+  for (size_t i = 0; i < num_free_rects; ++i) {
+    const FreeRect& free_rect = free_rects_[i];
+    if (free_rect.width < width || free_rect.height < height)
+      continue;
+    const int64 area = static_cast<int64>(free_rect.width) * free_rect.height;
+    if (area < best_area) {
+      best_index = i;
+      best_area = area;
+    }
+  }
+  if (best_index == base::kInvalidIndex)
+    return false;
+
+  const FreeRect free_rect = free_rects_[best_index];
+  free_rects_.erase(free_rects_.begin() + best_index);
+  rect->bottom_left.Set(free_rect.x, free_rect.y);
+
+  // Cut the leftover space into a piece to the right of the rectangle and a
+  // piece above it. The cut runs along the shorter leftover axis so that the
+  // larger piece stays as big as possible.
+  const int32 leftover_x = free_rect.width - width;
+  const int32 leftover_y = free_rect.height - height;
+  FreeRect right(free_rect.x + width, free_rect.y, leftover_x, 0);
+  FreeRect top(free_rect.x, free_rect.y + height, 0, leftover_y);
+  if (leftover_x <= leftover_y) {
+    right.height = height;
+    top.width = free_rect.width;
+  } else {
+    right.height = free_rect.height;
+    top.width = width;
+  }
+  if (right.width > 0 && right.height > 0)
+    free_rects_.push_back(right);
+  if (top.width > 0 && top.height > 0)
+    free_rects_.push_back(top);
+  MergeFreeRects();
+  return true;
+}
+
+void BinPacker::Guillotine::MergeFreeRects() {
+  for (size_t i = 0; i < free_rects_.size(); ++i) {
+    for (size_t j = i + 1; j < free_rects_.size(); ++j) {
+      FreeRect& a = free_rects_[i];
+      const FreeRect& b = free_rects_[j];
+      bool merged = false;
+      if (a.x == b.x && a.width == b.width) {
+        if (a.y + a.height == b.y) {
+          a.height += b.height;
+          merged = true;
+        } else if (b.y + b.height == a.y) {
+          a.y = b.y;
+          a.height += b.height;
+          merged = true;
+        }
+      } else if (a.y == b.y && a.height == b.height) {
+        if (a.x + a.width == b.x) {
+          a.width += b.width;
+          merged = true;
+        } else if (b.x + b.width == a.x) {
+          a.x = b.x;
+          a.width += b.width;
+          merged = true;
+        }
+      }
+      if (merged) {
+        free_rects_.erase(free_rects_.begin() + j);
+        // The grown rectangle may now merge with ones already examined.
+        j = i;
+      }
+    }
+  }
+}
+
 //-----------------------------------------------------------------------------
 //
 // BinPacker functions.
 //
 //-----------------------------------------------------------------------------
 
-BinPacker::BinPacker() : num_rectangles_packed_(0) {}
+BinPacker::BinPacker()
+    : algorithm_(kSkylineBottomLeft),
+      num_rectangles_packed_(0),
+      packed_area_(0) {}
+
+BinPacker::BinPacker(Algorithm algorithm)
+    : algorithm_(algorithm),
+      num_rectangles_packed_(0),
+      packed_area_(0) {}
 
 BinPacker::BinPacker(const BinPacker& from) { *this = from; }
 
 BinPacker::~BinPacker() {}
 
 BinPacker& BinPacker::operator=(const BinPacker& from) {
+  algorithm_ = from.algorithm_;
   rectangles_ = from.rectangles_;
-  if (from.skyline_.get())
-    skyline_.reset(new Skyline(*from.skyline_));
+  packer_.reset(from.packer_.get() ? from.packer_->Clone() : NULL);
   num_rectangles_packed_ = from.num_rectangles_packed_;
+  packed_area_ = from.packed_area_;
   return *this;
 }
 
+BinPacker::Packer* BinPacker::CreatePacker(const Vector2ui& bin_size) const {
+  switch (algorithm_) {
+    case kMaxRectsBestShortSideFit:
+      return new MaxRects(bin_size);
+    case kGuillotineBestAreaFit:
+      return new Guillotine(bin_size);
+    case kSkylineBottomLeft:
+    default:
+      return new Skyline(bin_size);
+  }
+}
+
 bool BinPacker::Pack(const Vector2ui& bin_size) {
-  if (!skyline_.get() || skyline_->GetBinSize() != bin_size) {
-    skyline_.reset(new Skyline(bin_size));
+  if (!packer_.get() || packer_->GetBinSize() != bin_size) {
+    packer_.reset(CreatePacker(bin_size));
     num_rectangles_packed_ = 0;
+    packed_area_ = 0;
   }
 
-  // The Skyline operates on one rectangle at a time, so this is a simple loop
+  // The Packer operates on one rectangle at a time, so this is a simple loop
   // that sets the position of each new rectangle as it is inserted.
   for (size_t i = num_rectangles_packed_; i < rectangles_.size(); ++i) {
     // Stop if the rectangle can't be inserted.
-    if (!skyline_->Insert(&rectangles_[i]))
+    if (!packer_->Insert(&rectangles_[i]))
       break;
     ++num_rectangles_packed_;
+    packed_area_ += static_cast<uint64>(rectangles_[i].size[0]) *
+                    rectangles_[i].size[1];
   }
   return num_rectangles_packed_ == rectangles_.size();
 }
 
+bool BinPacker::Repack(const Vector2ui& bin_size) {
+  std::vector<Rectangle> rectangles(rectangles_);
+  std::sort(rectangles.begin(), rectangles.end(), IsPackedBefore);
+  std::unique_ptr<Packer> packer(CreatePacker(bin_size));
+  uint64 packed_area = 0;
+  for (size_t i = 0; i < rectangles.size(); ++i) {
+    if (!packer->Insert(&rectangles[i]))
+      return false;
+    packed_area += static_cast<uint64>(rectangles[i].size[0]) *
+                   rectangles[i].size[1];
+  }
+  rectangles_.swap(rectangles);
+  packer_.swap(packer);
+  num_rectangles_packed_ = rectangles_.size();
+  packed_area_ = packed_area;
+  return true;
+}
+
 }  // namespace text
 }  // namespace ion
@@ -21,20 +21,31 @@ limitations under the License.
 #include <memory>
 #include <vector>
 
+#include "base/integral_types.h"
 #include "ion/base/invalid.h"
 #include "ion/math/vector.h"
 
 namespace ion {
 namespace text {
 
-// This class implements generic 2D bin-packing using a modified version of the
-// Skyline Bottom-Left algorithm available at:
+// This class implements generic 2D bin-packing using modified versions of the
+// algorithms available at:
 //     http://clb.demon.fi/files/RectangleBinPack
 //
 // Modifications include:
 //  - Not allowing rotations of rectangles.
+//  - Not supporting the heuristics other than the one named by each Algorithm.
 class BinPacker {
  public:
+  // The packing algorithm to use. Skyline is the fastest, while MaxRects
+  // usually fits the most rectangles into a bin at some cost in speed.
+  enum Algorithm {
+    kSkylineBottomLeft,         // Skyline with the Bottom-Left rule.
+    kMaxRectsBestShortSideFit,  // MaxRects with the Best Short Side Fit rule.
+    kGuillotineBestAreaFit,     // Guillotine with the Best Area Fit rule,
+                                // splitting along the shorter leftover axis.
+  };
+
   // Structure representing a rectangle to pack into the bin.
   struct Rectangle {
     Rectangle() = delete;
@@ -48,7 +59,9 @@ class BinPacker {
     math::Point2ui bottom_left;  // Output position of rectangle.
   };
 
+  // The default constructor uses kSkylineBottomLeft.
   BinPacker();
+  explicit BinPacker(Algorithm algorithm);
   ~BinPacker();
 
   // Allow BinPacker to be copied.
@@ -66,6 +79,22 @@ class BinPacker {
   // rectangles added since the last call to Pack() will be processed.
   bool Pack(const math::Vector2ui& bin_size);
 
+  // Discards the current placement and packs all of the rectangles into a bin
+  // of the given size from scratch, tallest first (wider first among equally
+  // tall ones), which recovers space that incremental packing has fragmented.
+  // The order of the rectangles returned by GetRectangles() may change. Returns
+  // true if they all fit; otherwise the BinPacker is left as it was before the
+  // call.
+  bool Repack(const math::Vector2ui& bin_size);
+
+  // Returns the algorithm used for packing.
+  Algorithm GetAlgorithm() const { return algorithm_; }
+
+  // Returns the number of rectangles placed by the last call to Pack() or
+  // Repack(), and their total area in pixels.
+  size_t GetPackedCount() const { return num_rectangles_packed_; }
+  uint64 GetPackedArea() const { return packed_area_; }
+
   // Returns the vector of rectangles (including positions) resulting from the
   // last call to Pack(). If Pack() returned false, this vector will not be
   // useful.
@@ -74,13 +103,23 @@ class BinPacker {
   }
 
  private:
-  // Nested class used to do the hard work.
+  // Nested classes used to do the hard work. Packer is the abstract base of
+  // the others.
+  class Packer;
   class Skyline;
+  class MaxRects;
+  class Guillotine;
+
+  // Returns a new, empty Packer for the algorithm and the given bin size.
+  Packer* CreatePacker(const math::Vector2ui& bin_size) const;
 
+  Algorithm algorithm_;
   std::vector<Rectangle> rectangles_;
-  std::unique_ptr<Skyline> skyline_;
+  std::unique_ptr<Packer> packer_;
   // Number of rectangles already packed.
   size_t num_rectangles_packed_;
+  // Total area of the rectangles already packed.
+  uint64 packed_area_;
 };
 
 }  // namespace text
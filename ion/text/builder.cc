@@ -137,7 +137,11 @@ Builder::Builder(const FontImagePtr& font_image,
     : font_image_(font_image),
       shader_manager_(shader_manager),
       allocator_(base::AllocationManager::GetNonNullAllocator(allocator)),
-      image_data_(NULL) {}
+      image_data_(NULL),
+      skip_unchanged_layouts_(false),
+      last_usage_mode_(gfx::BufferObject::kStaticDraw),
+      last_image_data_(NULL),
+      last_image_data_generation_(0) {}
 
 Builder::~Builder() {}
 
@@ -175,15 +179,39 @@ bool Builder::Build(const Layout& layout,
   DCHECK(registry_.Get());
   UpdateUniforms(registry_, node_.Get());
 
-  // Create and add a Shape if necessary, and always update it.
-  if (node_->GetShapes().empty())
+  // Create and add a Shape if necessary, and update it unless it already
+  // represents the same Layout.
+  if (node_->GetShapes().empty()) {
     node_->AddShape(gfx::ShapePtr(new (allocator_) gfx::Shape()));
-  UpdateShape(layout, usage_mode, node_->GetShapes()[0].Get());
+    last_image_data_ = NULL;
+  }
+  const bool is_unchanged = skip_unchanged_layouts_ &&
+      last_image_data_ == image_data_ &&
+      last_image_data_generation_ == image_data_->generation &&
+      last_usage_mode_ == usage_mode && last_layout_ == layout;
+  if (!is_unchanged) {
+    UpdateShape(layout, usage_mode, node_->GetShapes()[0].Get());
+    if (skip_unchanged_layouts_) {
+      last_layout_ = layout;
+      last_usage_mode_ = usage_mode;
+      last_image_data_ = image_data_;
+      last_image_data_generation_ = image_data_->generation;
+    }
+  }
 
   image_data_ = NULL;
   return true;
 }
 
+void Builder::SetSkipUnchangedLayouts(bool skip) {
+  skip_unchanged_layouts_ = skip;
+  if (!skip) {
+    // Release the copy of the last Layout.
+    last_layout_ = Layout();
+    last_image_data_ = NULL;
+  }
+}
+
 const gfx::ShaderProgramPtr Builder::BuildShaderProgram() {
   // Get all the necessary items from the derived class.
   if (!registry_.Get())
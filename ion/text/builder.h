@@ -31,6 +31,7 @@ limitations under the License.
 #include "ion/math/vector.h"
 #include "ion/text/font.h"
 #include "ion/text/fontimage.h"
+#include "ion/text/layout.h"
 
 namespace ion {
 namespace gfx {
@@ -38,7 +39,6 @@ class Shape;
 }
 
 namespace text {
-class Layout;
 
 // Builder is an abstract base class for building graphics objects used to
 // render text.
@@ -51,6 +51,7 @@ class ION_API Builder : public base::Referent {
   // Build().
   void SetFontImage(const FontImagePtr& font_image) {
     font_image_ = font_image;
+    last_image_data_ = NULL;
   }
 
   // Returns the Font from the FontImage. This may be a NULL pointer.
@@ -72,6 +73,15 @@ class ION_API Builder : public base::Referent {
   // kOneMinusSrcAlpha, so colors must be premultiplied by their alpha values.
   bool Build(const Layout& layout, gfx::BufferObject::UsageMode usage_mode);
 
+  // Sets whether Build() skips regenerating the vertex and index buffers when
+  // it is passed a Layout identical to the one of the previous successful
+  // call, with the same usage mode and FontImage::ImageData. Uniforms are
+  // still updated. This makes rebuilding unchanged text every frame nearly
+  // free, at the cost of keeping a copy of the last Layout, so it is disabled
+  // by default.
+  void SetSkipUnchangedLayouts(bool skip);
+  bool IsSkippingUnchangedLayouts() const { return skip_unchanged_layouts_; }
+
   // Returns the Node set up by the last successful call to Build().
   const gfx::NodePtr& GetNode() const { return node_; }
 
@@ -183,6 +193,15 @@ class ION_API Builder : public base::Referent {
   // During a call to Build(), this caches the FontImage::ImageData that
   // specifies the image with the character glyphs. It is NULL all other times.
   const FontImage::ImageData* image_data_;
+  // Whether Build() skips updating the Shape for an unchanged Layout.
+  bool skip_unchanged_layouts_;
+  // When skipping unchanged Layouts, these store the Layout, UsageMode and
+  // ImageData (and its generation) of the last successful call to Build().
+  // |last_image_data_| is NULL if there is nothing to compare against.
+  Layout last_layout_;
+  gfx::BufferObject::UsageMode last_usage_mode_;
+  const FontImage::ImageData* last_image_data_;
+  uint64 last_image_data_generation_;
 };
 
 // Convenience typedef for shared pointer to a Builder.
@@ -19,10 +19,12 @@ limitations under the License.
 
 #include <cctype>
 #include <limits>
+#include <vector>
 
 #include "ion/base/invalid.h"
 #include "ion/base/lockguards.h"
 #include "ion/base/logging.h"
+#include "ion/image/imagekernels.h"
 #include "ion/math/rangeutils.h"
 #include "ion/math/vector.h"
 #include "ion/text/layout.h"
@@ -42,6 +44,7 @@ Font::Font(const std::string& name, size_t size_in_pixels, size_t sdf_padding)
     : size_in_pixels_(size_in_pixels),
       name_(name),
       sdf_padding_(sdf_padding),
+      sdf_algorithm_(kSweepSdf),
       glyph_grid_map_(*this) {}
 
 Font::~Font() {}
@@ -96,15 +99,44 @@ void Font::CacheSdfGrids(const GlyphSet& glyph_set) {
   // This has to be implemented as a FontImage member function because
   // Font::CacheSdfGrid() is protected and FontImage is a friend.
   const size_t sdf_padding = GetSdfPadding();
+  const SdfAlgorithm algorithm = sdf_algorithm_;
+
+  // Gather the glyphs whose grids do not yet store SDF values. Glyph grids are
+  // never removed from the map, so the pointers remain valid.
+  std::vector<GlyphIndex> glyph_indices;
+  std::vector<const GlyphGrid*> glyph_grids;
+  size_t total_pixels = 0;
   for (auto it = glyph_set.cbegin(); it != glyph_set.cend(); ++it) {
     GlyphGrid* glyph_grid = GetMutableGlyphGrid(*it);
     DCHECK(!base::IsInvalidReference(glyph_grid));
-    // Make sure the glyph's grid stores SDF values.
     if (!glyph_grid->is_sdf) {
-      CacheSdfGrid(*it, ComputeSdfGrid(glyph_grid->pixels, sdf_padding));
-      DCHECK(glyph_grid->is_sdf);
+      glyph_indices.push_back(*it);
+      glyph_grids.push_back(glyph_grid);
+      total_pixels +=
+          (glyph_grid->pixels.GetWidth() + 2 * sdf_padding) *
+          (glyph_grid->pixels.GetHeight() + 2 * sdf_padding);
     }
   }
+  if (glyph_indices.empty())
+    return;
+
+  // Compute the SDF grids in parallel, since each glyph is independent.
+  const size_t count = glyph_indices.size();
+  std::vector<base::Array2<double>> sdf_grids(count);
+  image::ParallelForRows(
+      count, total_pixels / count,
+      [&glyph_grids, &sdf_grids, sdf_padding, algorithm](size_t begin,
+                                                         size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      sdf_grids[i] =
+          ComputeSdfGrid(glyph_grids[i]->pixels, sdf_padding, algorithm);
+  });
+
+  // Make sure each glyph's grid stores SDF values.
+  for (size_t i = 0; i < count; ++i) {
+    CacheSdfGrid(glyph_indices[i], sdf_grids[i]);
+    DCHECK(glyph_grids[i]->is_sdf);
+  }
 }
 
 bool Font::CacheSdfGrid(GlyphIndex glyph_index,
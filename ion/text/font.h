@@ -27,6 +27,7 @@ limitations under the License.
 #include "ion/base/stlalloc/allocmap.h"
 #include "ion/math/vector.h"
 #include "ion/text/layout.h"
+#include "ion/text/sdfutils.h"
 
 namespace ion {
 namespace text {
@@ -83,6 +84,12 @@ class ION_API Font : public base::Referent {
   // pixels on all sides.
   size_t GetSdfPadding() const { return sdf_padding_; }
 
+  // Sets/returns the algorithm CacheSdfGrids() uses to compute SDF grids. The
+  // default is kSweepSdf. This only affects grids computed after the call, so
+  // it should be set before any FontImage is built from the font.
+  void SetSdfAlgorithm(SdfAlgorithm algorithm) { sdf_algorithm_ = algorithm; }
+  SdfAlgorithm GetSdfAlgorithm() const { return sdf_algorithm_; }
+
   // Returns the FontMetrics for the font.
   const FontMetrics& GetFontMetrics() const { return font_metrics_; }
 
@@ -119,8 +126,9 @@ class ION_API Font : public base::Referent {
 
   // Makes sure that the GlyphData for each glyph in glyph_set has an SDF grid
   // cached inside the font. This assumes that the requested glyphs are
-  // available in the font. There is no real need to call this outside of Ion's
-  // internal code.
+  // available in the font. Missing SDF grids are computed in parallel using
+  // the algorithm set with SetSdfAlgorithm(). There is no real need to call
+  // this outside of Ion's internal code.
   void CacheSdfGrids(const GlyphSet& glyph_set);
 
   // Causes this font to use the font |fallback| as a fallback if a requested
@@ -173,6 +181,8 @@ class ION_API Font : public base::Referent {
   const std::string name_;
   // Padding (in pixels) on each edge of each SDF glyph.
   const size_t sdf_padding_;
+  // Algorithm used to compute SDF grids.
+  SdfAlgorithm sdf_algorithm_;
   // Metrics for the entire font.
   FontMetrics font_metrics_;
   // Grid for each glyph in the font, keyed by glyph index. Mutable to
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include "ion/text/fontimage.h"
 
+#include <cmath>
 #include <iterator>
 #include <vector>
 
@@ -27,8 +28,10 @@ limitations under the License.
 #include "ion/base/logging.h"
 #include "ion/base/serialize.h"
 #include "ion/base/staticsafedeclare.h"
+#include "ion/base/stlalloc/allocunorderedmap.h"
 #include "ion/gfx/sampler.h"
 #include "ion/image/conversionutils.h"
+#include "ion/image/imagekernels.h"
 #include "ion/math/utils.h"
 #include "ion/math/vector.h"
 #include "ion/text/binpacker.h"
@@ -76,7 +79,8 @@ struct ImageDataWrapper  {
   explicit ImageDataWrapper(const base::AllocatorPtr& allocator)
       : image_data(allocator),
         packed_area(0),
-        used_area_fraction(0.f) {}
+        used_area_fraction(0.f),
+        restored(false) {}
 
   // The wrapped ImageData instance.
   FontImage::ImageData image_data;
@@ -89,6 +93,11 @@ struct ImageDataWrapper  {
 
   // Fraction of area used.
   float used_area_fraction;
+
+  // Whether the ImageData was restored (see AddRestoredImageData()). The
+  // BinPacker of a restored ImageData does not know where its glyphs are, so
+  // glyphs can only be added to it by re-packing all of them.
+  bool restored;
 };
 
 // This struct wraps the Texture and sub-image data it needs for deferred
@@ -381,6 +390,49 @@ static void UpdateImageData(
       ComputeTextureRectangleMap(*image, bin_packer);
 }
 
+// Replaces the image of |image_data| with a copy whose data is not wiped after
+// it is sent to OpenGL. Does nothing if the data is already gone or is not
+// wipeable.
+static void RetainImage(const FontImage::ImageData& image_data,
+                        const base::AllocatorPtr& allocator) {
+  if (!image_data.texture->HasImage(0U))
+    return;
+  const ImagePtr& image = image_data.texture->GetImage(0U);
+  const base::DataContainerPtr data = image->GetData();
+  if (!data.Get() || !data->GetData() || !data->IsWipeable())
+    return;
+  image->Set(image->GetFormat(), image->GetWidth(), image->GetHeight(),
+             base::DataContainer::CreateAndCopy<uint8>(
+                 data->GetData<uint8>(), image->GetDataSize(), false,
+                 allocator));
+}
+
+// Sets |image| as a sub-image of |texture| at |offset|. If the image of the
+// texture has retained its data (see RetainImage()), |image| is copied into it
+// instead, which keeps the data complete.
+static void SetSubImage(const TexturePtr& texture,
+                        const math::Point3ui& offset, const ImagePtr& image) {
+  const ImagePtr& texture_image = texture->GetImage(0U);
+  const base::DataContainerPtr& data = texture_image->GetData();
+  if (!data.Get() || data->IsWipeable() || !data->GetData()) {
+    texture->SetSubImage(0U, offset, image);
+    return;
+  }
+  const uint32 width = texture_image->GetWidth();
+  const uint32 sub_width = image->GetWidth();
+  const uint8* sub_pixels = image->GetData()->GetData<uint8>();
+  uint8* pixels = data->GetMutableData<uint8>();
+  for (uint32 row = 0; row < image->GetHeight(); ++row) {
+    memcpy(pixels + (offset[1] + row) * width + offset[0],
+           sub_pixels + row * sub_width, sub_width);
+  }
+}
+
+static void SetSubImage(const TexturePtr& texture, const Point2ui& offset,
+                        const ImagePtr& image) {
+  SetSubImage(texture, math::Point3ui(offset[0], offset[1], 0U), image);
+}
+
 // If updates is NULL, then adds SubImages to the passed texture for all of the
 // passed grids using the Rectangles from bin_packer. If updates is non-NULL,
 // then adds DeferredUpdates to the passed vector for all of the passed grids
@@ -405,7 +457,7 @@ static void StoreSubImages(const SdfGridMap& grids, const BinPacker& bin_packer,
         updates->push_back(
             DeferredUpdate(texture, 0U, rect.bottom_left, image));
       else
-        texture->SetSubImage(0U, rect.bottom_left, image);
+        SetSubImage(texture, rect.bottom_left, image);
     }
   }
 }
@@ -428,7 +480,8 @@ static void SetDifference(const GlyphSet& lhs, const GlyphSet& rhs,
 FontImage::ImageData::ImageData(const base::AllocatorPtr& allocator)
     : texture(CreateTexture(allocator)),
       glyph_set(allocator),
-      texture_rectangle_map(allocator) {}
+      texture_rectangle_map(allocator),
+      generation(0) {}
 
 //-----------------------------------------------------------------------------
 //
@@ -537,7 +590,10 @@ const FontImage::ImageData StaticFontImage::InitImageData(
 
 class DynamicFontImage::Helper : public Allocatable {
  public:
-  Helper() : image_data_wrappers_(*this), deferred_updates_(*this) {}
+  Helper()
+      : image_data_wrappers_(*this),
+        deferred_updates_(*this),
+        glyph_masks_(*this) {}
 
   // Returns the vector of ImageDataWrappers.
   base::AllocVector<ImageDataWrapper>& GetImageDataWrappers() {
@@ -549,12 +605,89 @@ class DynamicFontImage::Helper : public Allocatable {
     return deferred_updates_;
   }
 
+  // Records that the glyphs in glyph_set have been added to the indexed
+  // ImageData.
+  void AddGlyphsToIndex(const GlyphSet& glyph_set, size_t index) {
+    const uint64 bit = index < kMaxIndexedImageData ? 1ULL << index : 0ULL;
+    for (auto it = glyph_set.cbegin(); it != glyph_set.cend(); ++it)
+      glyph_masks_[*it] |= bit;
+  }
+
+  // Records that the glyphs in unfiltered_glyph_set that are not in
+  // glyph_set were removed by Font::FilterGlyphs(). Such glyphs are never
+  // stored in an ImageData, so they are treated as present in all of them.
+  void AddFilteredGlyphsToIndex(const GlyphSet& unfiltered_glyph_set,
+                                const GlyphSet& glyph_set) {
+    for (auto it = unfiltered_glyph_set.cbegin();
+         it != unfiltered_glyph_set.cend(); ++it) {
+      if (!glyph_set.count(*it))
+        glyph_masks_[*it] = kAllImageData;
+    }
+  }
+
+  // Uses the index to return the index of the first ImageData that contains
+  // all of the glyphs in unfiltered_glyph_set other than those the Font
+  // filters out, or kInvalidIndex if there is none. Sets |is_known| to false
+  // if the answer cannot be determined from the index because some glyph has
+  // never been seen before.
+  size_t FindContainingImageDataIndex(const GlyphSet& unfiltered_glyph_set,
+                                      bool* is_known) const {
+    *is_known = true;
+    uint64 mask = kAllImageData;
+    for (auto it = unfiltered_glyph_set.cbegin();
+         it != unfiltered_glyph_set.cend(); ++it) {
+      const auto found = glyph_masks_.find(*it);
+      if (found == glyph_masks_.end()) {
+        *is_known = false;
+        return base::kInvalidIndex;
+      }
+      mask &= found->second;
+    }
+    // If every glyph was filtered out there is nothing to contain.
+    if (mask == kAllImageData)
+      return base::kInvalidIndex;
+    if (mask) {
+      size_t index = 0;
+      while (!(mask & 1ULL)) {
+        mask >>= 1;
+        ++index;
+      }
+      return index;
+    }
+    // ImageData instances past the bits in the mask have to be searched.
+    const size_t num_wrappers = image_data_wrappers_.size();
+    for (size_t i = kMaxIndexedImageData; i < num_wrappers; ++i) {
+      const GlyphSet& candidate = image_data_wrappers_[i].image_data.glyph_set;
+      bool contains_all = true;
+      for (auto it = unfiltered_glyph_set.cbegin();
+           contains_all && it != unfiltered_glyph_set.cend(); ++it) {
+        contains_all = glyph_masks_.find(*it)->second == kAllImageData ||
+                       candidate.count(*it);
+      }
+      if (contains_all)
+        return i;
+    }
+    return base::kInvalidIndex;
+  }
+
  private:
+  // Maps a glyph to a mask with a bit set for each ImageData (up to
+  // kMaxIndexedImageData) that contains it.
+  typedef base::AllocUnorderedMap<GlyphIndex, uint64> GlyphMaskMap;
+
+  // The number of ImageData instances that have bits in a glyph mask.
+  static const size_t kMaxIndexedImageData = 64U;
+  // The mask for a glyph that is treated as present in every ImageData.
+  static const uint64 kAllImageData = ~0ULL;
+
   // Vector of ImageDataWrapper instances.
   base::AllocVector<ImageDataWrapper> image_data_wrappers_;
 
   // Vector of DeferredUpdate instances.
   base::AllocVector<DeferredUpdate> deferred_updates_;
+
+  // Index from glyphs to the ImageData instances that contain them.
+  GlyphMaskMap glyph_masks_;
 };
 
 //-----------------------------------------------------------------------------
@@ -566,7 +699,10 @@ class DynamicFontImage::Helper : public Allocatable {
 DynamicFontImage::DynamicFontImage(const FontPtr& font, size_t image_size)
     : FontImage(kDynamic, font, image_size),
       helper_(new(GetAllocator()) Helper()),
-      updates_deferred_(false) {}
+      updates_deferred_(false),
+      packing_algorithm_(BinPacker::kSkylineBottomLeft),
+      repacking_enabled_(false),
+      image_retention_enabled_(false) {}
 
 DynamicFontImage::~DynamicFontImage() {}
 
@@ -587,6 +723,16 @@ float DynamicFontImage::GetImageDataUsedAreaFraction(size_t index) const {
   return index < wrappers.size() ? wrappers[index].used_area_fraction : 0.f;
 }
 
+void DynamicFontImage::EnableImageRetention(bool enable) {
+  image_retention_enabled_ = enable;
+  if (enable) {
+    const base::AllocVector<ImageDataWrapper>& wrappers =
+        helper_->GetImageDataWrappers();
+    for (size_t i = 0; i < wrappers.size(); ++i)
+      RetainImage(wrappers[i].image_data, GetAllocator());
+  }
+}
+
 void DynamicFontImage::ProcessDeferredUpdates() {
   if (updates_deferred_) {
     base::AllocVector<DeferredUpdate>& updates = helper_->GetDeferredUpdates();
@@ -595,7 +741,8 @@ void DynamicFontImage::ProcessDeferredUpdates() {
     const size_t count = updates.size();
     for (size_t i = 0; i < count; ++i) {
       const DeferredUpdate& di = updates[i];
-      di.texture->SetSubImage(di.level, di.offset, di.image);
+      DCHECK_EQ(0U, di.level);
+      SetSubImage(di.texture, di.offset, di.image);
     }
     updates.clear();
   }
@@ -615,24 +762,32 @@ size_t DynamicFontImage::FindImageDataIndex(
     return index;
   }
 
+  // If all of the glyphs have been seen before, the index can tell whether an
+  // ImageData already contains them without filtering the glyphs.
+  bool is_known;
+  index = helper_->FindContainingImageDataIndex(unfiltered_glyph_set,
+                                                &is_known);
+  if (index != base::kInvalidIndex)
+    return index;
+
   GlyphSet glyph_set(GetAllocator()->GetAllocatorForLifetime(base::kShortTerm),
                      unfiltered_glyph_set);
   GetFont()->FilterGlyphs(&glyph_set);
+  helper_->AddFilteredGlyphsToIndex(unfiltered_glyph_set, glyph_set);
 
   if (glyph_set.empty() || (glyph_set.size() == 1 && !(*glyph_set.begin())))
     return index;
 
-  // Make sure that all required glyphs have SDF grids cached.
-  GetFont()->CacheSdfGrids(glyph_set);
-
-  // TODO(user) Possibly make this more efficient by combining work done in
-  // the first 2 passes. Or do best-fit instead of first-fit.
+  // TODO(user) Do best-fit instead of first-fit.
 
   // See if there is an ImageData that already contains all of the glyphs.
-  index = FindContainingImageDataIndexPrefiltered(glyph_set);
+  if (!is_known)
+    index = FindContainingImageDataIndexPrefiltered(glyph_set);
 
-  // If that didn't work, find one that can have the glyphs added to it.
+  // If that didn't work, find one that can have the glyphs added to it. The
+  // SDF grids are only needed for glyphs that have to be packed.
   if (index == base::kInvalidIndex) {
+    GetFont()->CacheSdfGrids(glyph_set);
     index = FindImageDataThatFits(glyph_set);
   }
 
@@ -650,27 +805,26 @@ size_t DynamicFontImage::FindContainingImageDataIndex(
   if (!GetFont().Get()) {
     return base::kInvalidIndex;
   }
+  bool is_known;
+  const size_t index = helper_->FindContainingImageDataIndex(
+      unfiltered_glyph_set, &is_known);
+  if (is_known)
+    return index;
+
+  // Filter the glyphs so that the index learns which ones the Font removes.
   GlyphSet glyph_set(GetAllocator()->GetAllocatorForLifetime(base::kShortTerm),
                      unfiltered_glyph_set);
   GetFont()->FilterGlyphs(&glyph_set);
+  helper_->AddFilteredGlyphsToIndex(unfiltered_glyph_set, glyph_set);
   return glyph_set.size() ? FindContainingImageDataIndexPrefiltered(glyph_set)
                           : base::kInvalidIndex;
 }
 
 size_t DynamicFontImage::FindContainingImageDataIndexPrefiltered(
     const GlyphSet& glyph_set) {
-  const base::AllocVector<ImageDataWrapper>& wrappers =
-      helper_->GetImageDataWrappers();
-  const size_t num_wrappers = wrappers.size();
-  for (size_t i = 0; i < num_wrappers; ++i) {
-    if (HasAllGlyphs(wrappers[i].image_data, glyph_set)) return i;
-    const auto& candidate = wrappers[i].image_data.glyph_set;
-    if (std::includes(candidate.cbegin(), candidate.cend(), glyph_set.cbegin(),
-                      glyph_set.cend())) {
-      return i;
-    }
-  }
-  return base::kInvalidIndex;
+  // Every glyph in a filtered set is either in the index or in no ImageData.
+  bool is_known;
+  return helper_->FindContainingImageDataIndex(glyph_set, &is_known);
 }
 
 size_t DynamicFontImage::FindImageDataThatFits(const GlyphSet& glyph_set) {
@@ -682,6 +836,9 @@ size_t DynamicFontImage::FindImageDataThatFits(const GlyphSet& glyph_set) {
   base::AllocVector<ImageDataWrapper>& wrappers =
       helper_->GetImageDataWrappers();
   const size_t num_wrappers = wrappers.size();
+  // ImageData instances that have enough free area for the glyphs but whose
+  // free space is too fragmented to fit them, or that were restored.
+  std::vector<size_t> repack_candidates;
   for (size_t i = 0; i < num_wrappers; ++i) {
     ImageDataWrapper& wrapper = wrappers[i];
     ImageData& image_data = wrapper.image_data;
@@ -702,6 +859,12 @@ size_t DynamicFontImage::FindImageDataThatFits(const GlyphSet& glyph_set) {
     if (wrapper.packed_area + added_area > max_area)
       continue;
 
+    // Glyphs can only be added to a restored ImageData by re-packing it.
+    if (wrapper.restored) {
+      repack_candidates.push_back(i);
+      continue;
+    }
+
     // Create a copy of the current BinPacker for testing nondestructively and
     // add the grids to it.
     BinPacker test_bin_packer(wrapper.bin_packer);
@@ -712,6 +875,7 @@ size_t DynamicFontImage::FindImageDataThatFits(const GlyphSet& glyph_set) {
       // Update the GlyphSet.
       image_data.glyph_set.insert(missing_glyph_set.begin(),
                                   missing_glyph_set.end());
+      helper_->AddGlyphsToIndex(missing_glyph_set, i);
 
       // Save the BinPacker.
       wrapper.bin_packer = test_bin_packer;
@@ -739,12 +903,133 @@ size_t DynamicFontImage::FindImageDataThatFits(const GlyphSet& glyph_set) {
           static_cast<float>(added_area) / static_cast<float>(max_area);
       return i;
     }
+    if (repacking_enabled_)
+      repack_candidates.push_back(i);
+  }
+
+  // Could not fit the glyphs into the free space of any existing ImageData.
+  return !repack_candidates.empty()
+             ? RepackImageDataToFit(glyph_set, repack_candidates)
+             : base::kInvalidIndex;
+}
+
+size_t DynamicFontImage::RepackImageDataToFit(
+    const GlyphSet& glyph_set, const std::vector<size_t>& candidates) {
+  DCHECK(GetFont().Get());
+  const Font& font = *GetFont();
+  const uint32 image_size = static_cast<uint32>(GetMaxImageSize());
+  const Vector2ui bin_size(image_size, image_size);
+  const base::AllocatorPtr& sta =
+      GetAllocator()->GetAllocatorForLifetime(base::kShortTerm);
+  base::AllocVector<ImageDataWrapper>& wrappers =
+      helper_->GetImageDataWrappers();
+
+  // Set up a BinPacker for each candidate that holds its glyphs as well as
+  // the missing ones.
+  const size_t count = candidates.size();
+  std::vector<BinPacker> bin_packers;
+  bin_packers.reserve(count);
+  size_t total_rectangles = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const ImageDataWrapper& wrapper = wrappers[candidates[i]];
+    GlyphSet missing_glyph_set(sta);
+    SetDifference(glyph_set, wrapper.image_data.glyph_set, &missing_glyph_set);
+    if (wrapper.restored) {
+      // The BinPacker of a restored ImageData is empty, so add all of its
+      // glyphs as well. Their grids may not have been converted to SDF yet,
+      // since the restored image was not built from them.
+      GetFont()->CacheSdfGrids(wrapper.image_data.glyph_set);
+      bin_packers.push_back(BinPacker(packing_algorithm_));
+      AddGridsToBinPacker(
+          BuildSdfGridMap(font, wrapper.image_data.glyph_set, sta),
+          &bin_packers.back());
+    } else {
+      bin_packers.push_back(BinPacker(wrapper.bin_packer));
+    }
+    GetFont()->CacheSdfGrids(missing_glyph_set);
+    AddGridsToBinPacker(BuildSdfGridMap(font, missing_glyph_set, sta),
+                        &bin_packers.back());
+    total_rectangles += bin_packers.back().GetRectangles().size();
   }
 
-  // Could not fit the glyphs in any existing ImageData.
+  // Re-pack the candidates in parallel, since each one is independent.
+  std::vector<uint8> fits(count, 0);
+  image::ParallelForRows(
+      count, total_rectangles / count,
+      [&bin_packers, &fits, &bin_size](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      fits[i] = bin_packers[i].Repack(bin_size) ? 1 : 0;
+  });
+
+  for (size_t i = 0; i < count; ++i) {
+    if (!fits[i])
+      continue;
+    const size_t index = candidates[i];
+    ImageDataWrapper& wrapper = wrappers[index];
+    ImageData& image_data = wrapper.image_data;
+    image_data.glyph_set.insert(glyph_set.begin(), glyph_set.end());
+    helper_->AddGlyphsToIndex(glyph_set, index);
+    wrapper.bin_packer = bin_packers[i];
+    wrapper.restored = false;
+
+    // All of the glyphs may have moved, so rebuild the entire image and
+    // replace it with a single sub-image.
+    const SdfGridMap grid_map =
+        BuildSdfGridMap(font, image_data.glyph_set, sta);
+    const SdfGrid packed_grid =
+        CreatePackedGrid(grid_map, wrapper.bin_packer, image_size, image_size,
+                         font.GetSdfPadding());
+    ImagePtr image = CreateImage(image_size, image_size, sta);
+    StoreGridInImage(packed_grid, image);
+    if (updates_deferred_) {
+      base::WriteLock lock(&update_lock_);
+      base::WriteGuard guard(&lock);
+      helper_->GetDeferredUpdates().push_back(
+          DeferredUpdate(image_data.texture, 0U, Point2ui::Zero(), image));
+    } else {
+      SetSubImage(image_data.texture, Point2ui::Zero(), image);
+    }
+    image_data.texture_rectangle_map = ComputeTextureRectangleMap(
+        *image_data.texture->GetImage(0U), wrapper.bin_packer);
+    ++image_data.generation;
+
+    // Update the area values.
+    wrapper.packed_area = ComputeTotalGridArea(grid_map);
+    wrapper.used_area_fraction =
+        static_cast<float>(wrapper.packed_area) /
+        static_cast<float>(math::Square(image_size));
+    return index;
+  }
   return base::kInvalidIndex;
 }
 
+void DynamicFontImage::AddRestoredImageData(const ImageData& image_data) {
+  DCHECK(image_data.texture->HasImage(0U));
+  DCHECK_EQ(GetMaxImageSize(), image_data.texture->GetImage(0U)->GetWidth());
+  base::AllocVector<ImageDataWrapper>& wrappers =
+      helper_->GetImageDataWrappers();
+  wrappers.push_back(ImageDataWrapper(GetAllocator()));
+  ImageDataWrapper& wrapper = wrappers.back();
+  wrapper.image_data = image_data;
+  helper_->AddGlyphsToIndex(image_data.glyph_set, wrappers.size() - 1U);
+
+  wrapper.restored = true;
+
+  // The texture rectangles are the only record of the area the glyphs cover.
+  const float image_size = static_cast<float>(GetMaxImageSize());
+  const TexRectMap& rects = image_data.texture_rectangle_map;
+  for (auto it = rects.cbegin(); it != rects.cend(); ++it) {
+    const Vector2f size = it->second.GetSize() * image_size;
+    wrapper.packed_area += static_cast<size_t>(std::round(size[0])) *
+                           static_cast<size_t>(std::round(size[1]));
+  }
+  wrapper.used_area_fraction =
+      static_cast<float>(wrapper.packed_area) / math::Square(image_size);
+
+  if (image_retention_enabled_)
+    RetainImage(wrapper.image_data, GetAllocator());
+}
+
 size_t DynamicFontImage::AddImageData(const GlyphSet& glyph_set) {
   const base::AllocatorPtr& allocator = GetAllocator();
   const base::AllocatorPtr& sta =
@@ -758,6 +1043,7 @@ size_t DynamicFontImage::AddImageData(const GlyphSet& glyph_set) {
   const size_t index = wrappers.size();
   wrappers.push_back(ImageDataWrapper(allocator));
   ImageDataWrapper& wrapper = wrappers[index];
+  wrapper.bin_packer = BinPacker(packing_algorithm_);
   ImageData& image_data = wrapper.image_data;
   const std::string texture_name = font.GetName() + "_" +
                                    base::ValueToString(font.GetSizeInPixels()) +
@@ -770,15 +1056,21 @@ size_t DynamicFontImage::AddImageData(const GlyphSet& glyph_set) {
   // Add the grids to the BinPacker.
   AddGridsToBinPacker(grid_map, &wrapper.bin_packer);
 
-  // Try to pack them into an SdfGrid of the proper size.
+  // Try to pack them into an SdfGrid of the proper size. If they do not fit
+  // in the order of their glyph indices, try again tallest first.
   const uint32 image_size = static_cast<uint32>(GetMaxImageSize());
-  if (wrapper.bin_packer.Pack(Vector2ui(image_size, image_size))) {
+  const Vector2ui bin_size(image_size, image_size);
+  if (wrapper.bin_packer.Pack(bin_size) ||
+      wrapper.bin_packer.Repack(bin_size)) {
     DCHECK(!wrapper.image_data.texture->HasImage(0U));
     UpdateImageData(grid_map, wrapper.bin_packer, image_size,
                     font.GetSdfPadding(), &wrapper.image_data, sta);
+    if (image_retention_enabled_)
+      RetainImage(wrapper.image_data, allocator);
 
     // Fill in the GlyphSet.
     image_data.glyph_set = glyph_set;
+    helper_->AddGlyphsToIndex(glyph_set, index);
 
     // Update the area values.
     wrapper.packed_area = ComputeTotalGridArea(grid_map);
@@ -32,13 +32,12 @@ limitations under the License.
 #include "ion/gfx/image.h"
 #include "ion/gfx/texture.h"
 #include "ion/math/range.h"
+#include "ion/text/binpacker.h"
 #include "ion/text/font.h"
 
 namespace ion {
 namespace text {
 
-class BinPacker;
-
 //-----------------------------------------------------------------------------
 //
 // A FontImage contains image and texture coordinate information used to render
@@ -77,6 +76,9 @@ class FontImage : public base::Referent {
     TexRectMap texture_rectangle_map;
     // Vector of SubImages to set on textures.
     typedef base::AllocVector<gfx::Texture::SubImage> SubImageVec;
+    // Incremented whenever existing glyphs move to new texture rectangles,
+    // which invalidates texture coordinates computed from earlier rectangles.
+    uint64 generation;
   };
 
   // Returns the type of an instance.
@@ -223,6 +225,37 @@ class DynamicFontImage : public FontImage {
   // Returns whether updates are deferred.
   bool AreUpdatesDeferred() const { return updates_deferred_; }
 
+  // Sets/returns the algorithm used to pack glyphs into ImageData instances
+  // created after the call. The default is BinPacker::kSkylineBottomLeft.
+  void SetPackingAlgorithm(BinPacker::Algorithm algorithm) {
+    packing_algorithm_ = algorithm;
+  }
+  BinPacker::Algorithm GetPackingAlgorithm() const {
+    return packing_algorithm_;
+  }
+
+  // Sets whether glyphs that no longer fit into the free space of any existing
+  // ImageData may be placed by re-packing all of the glyphs of an ImageData
+  // from scratch before a new ImageData is created. Candidate ImageData
+  // instances are re-packed in parallel. This uses fewer textures, but
+  // replaces the entire image of the re-packed ImageData (respecting deferred
+  // updates) and changes its texture rectangles. The default is false.
+  void EnableRepacking(bool enable) { repacking_enabled_ = enable; }
+
+  // Returns whether repacking is enabled.
+  bool IsRepackingEnabled() const { return repacking_enabled_; }
+
+  // Sets whether the image of each ImageData keeps its data after it has been
+  // uploaded, with glyphs added later written into it as well, so that the
+  // DynamicFontImage can be saved with FontManager::SaveFontImage() at any
+  // time. This must be enabled before any of the textures are rendered. It
+  // costs the memory of the images and replaces the whole image when glyphs
+  // are added. The default is false.
+  void EnableImageRetention(bool enable);
+
+  // Returns whether image retention is enabled.
+  bool IsImageRetentionEnabled() const { return image_retention_enabled_; }
+
   // Updates internal texture data with any deferred updates. The caller must
   // ensure that the DynamicFontImage's Textures are not being rendered when
   // this is called.
@@ -242,12 +275,20 @@ class DynamicFontImage : public FontImage {
 
   // Returns the index of an ImageData instance that contains all of the
   // glyphs (present in the Font) in glyph_set, or kInvalidIndex if there
-  // are none.
+  // are none. This is answered from an index that maps each glyph to the
+  // ImageData instances containing it, so once all of the glyphs have been
+  // seen it neither copies glyph_set nor searches the ImageData instances.
   size_t FindContainingImageDataIndex(const GlyphSet& glyph_set);
 
  protected:
   ~DynamicFontImage() override;
 
+  // Appends an ImageData that was built previously, such as one restored from
+  // a file by FontManager::LoadFontImage(). Its image must be image_size x
+  // image_size. Since the packing state is not available, glyphs are added to
+  // the ImageData later by re-packing all of its glyphs.
+  void AddRestoredImageData(const ImageData& image_data);
+
  private:
   // Helper class that encapsulates some internal data of the DynamicFontImage.
   class Helper;
@@ -262,6 +303,13 @@ class DynamicFontImage : public FontImage {
   // glyph_set added to it, or kInvalidIndex if there is none.
   size_t FindImageDataThatFits(const GlyphSet& glyph_set);
 
+  // Returns the index of an ImageData instance that can hold the glyphs in
+  // glyph_set in addition to its own when all of them are re-packed, or
+  // kInvalidIndex if there is none. Only the indexed candidates are tried. The
+  // image of the returned ImageData is rebuilt.
+  size_t RepackImageDataToFit(const GlyphSet& glyph_set,
+                              const std::vector<size_t>& candidates);
+
   // Creates a new ImageData and adds the glyphs in glyph_set to it.
   // Returns kInvalidIndex if there is no way to fit them in a single image.
   size_t AddImageData(const GlyphSet& glyph_set);
@@ -271,6 +319,15 @@ class DynamicFontImage : public FontImage {
   // Whether updates are deferred or immediate.
   bool updates_deferred_;
 
+  // The algorithm used to pack glyphs into new ImageData instances.
+  BinPacker::Algorithm packing_algorithm_;
+
+  // Whether full ImageData instances may be re-packed.
+  bool repacking_enabled_;
+
+  // Whether image data is kept after it has been uploaded.
+  bool image_retention_enabled_;
+
   // Protects access to deferred updates.
   base::ReadWriteLock update_lock_;
 };
@@ -17,9 +17,23 @@ limitations under the License.
 
 #include "ion/text/fontmanager.h"
 
+#include <stdio.h>
+
+#include <cstring>
+#include <iomanip>
+#include <memory>
 #include <sstream>
+#include <string>
+#include <vector>
 
+#include "ion/base/datacontainer.h"
+#include "ion/base/logging.h"
+#include "ion/base/serialize.h"
 #include "ion/base/zipassetmanager.h"
+#include "ion/gfx/image.h"
+#include "ion/gfx/texture.h"
+#include "ion/port/fileutils.h"
+#include "ion/port/memorymappedfile.h"
 #if defined(ION_PLATFORM_MAC) || defined(ION_PLATFORM_IOS)
 #include "ion/text/coretextfont.h"
 #else
@@ -29,6 +43,244 @@ limitations under the License.
 namespace ion {
 namespace text {
 
+namespace {
+
+using gfx::Image;
+using gfx::ImagePtr;
+using gfx::Texture;
+
+//-----------------------------------------------------------------------------
+//
+// FontImage cache file format. A file starts with a FileHeader and contains
+// one entry for each ImageData in the FontImage: an ImageHeader, a
+// GlyphRecord for each glyph in the ImageData's GlyphSet, and the 8-bit
+// luminance pixels of the image, padded to a multiple of 8 bytes.
+//
+//-----------------------------------------------------------------------------
+
+struct FileHeader {
+  char magic[8];
+  uint32 version;
+  uint32 type;
+  uint64 font_data_hash;
+  uint32 size_in_pixels;
+  uint32 sdf_padding;
+  uint32 max_image_size;
+  uint32 image_count;
+  uint32 sdf_algorithm;
+  uint32 reserved;
+};
+
+struct ImageHeader {
+  uint32 width;
+  uint32 height;
+  uint32 glyph_count;
+  uint32 reserved;
+};
+
+struct GlyphRecord {
+  uint64 glyph_index;
+  float min_point[2];
+  float max_point[2];
+  uint32 has_rectangle;
+  uint32 reserved;
+};
+
+static const char kMagic[8] = { 'I', 'O', 'N', 'F', 'O', 'N', 'T', 'C' };
+// This must be incremented whenever the file format or the way FontImages are
+// generated changes.
+static const uint32 kFileVersion = 2U;
+static const char kFileExtension[] = ".ionfont";
+
+// Returns the 64-bit FNV-1a hash of |size| bytes of |data|, starting from
+// |hash|.
+static uint64 ComputeHash(const void* data, size_t size,
+                          uint64 hash = 14695981039346656037ULL) {
+  const uint8* bytes = static_cast<const uint8*>(data);
+  for (size_t i = 0; i < size; ++i)
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+  return hash;
+}
+
+// Appends |size| bytes of |data| to |contents|.
+static void AppendBytes(const void* data, size_t size,
+                        std::vector<uint8>* contents) {
+  const uint8* bytes = static_cast<const uint8*>(data);
+  contents->insert(contents->end(), bytes, bytes + size);
+}
+
+// Returns |size| rounded up to a multiple of 8, so that each image's pixels
+// start at an aligned offset in the file.
+static size_t AlignSize(size_t size) { return (size + 7U) & ~size_t(7U); }
+
+// Appends the cache file entry for |image_data| to |contents|. Returns false
+// if the image's pixels are not available.
+static bool AppendImageData(const FontImage::ImageData& image_data,
+                            std::vector<uint8>* contents) {
+  const Texture& texture = *image_data.texture;
+  if (!texture.HasImage(0U))
+    return false;
+  const Image& image = *texture.GetImage(0U);
+  if (image.GetFormat() != Image::kLuminance || !image.GetData().Get() ||
+      !image.GetData()->GetData())
+    return false;
+  const uint32 width = image.GetWidth();
+  const uint32 height = image.GetHeight();
+  const uint8* data = image.GetData()->GetData<uint8>();
+  std::vector<uint8> pixels(data, data + width * height);
+
+  // Apply sub-images that have not been sent to OpenGL yet, since they are
+  // not part of the image.
+  const base::AllocVector<Texture::SubImage>& sub_images =
+      texture.GetSubImages();
+  for (size_t i = 0; i < sub_images.size(); ++i) {
+    const Texture::SubImage& sub_image = sub_images[i];
+    const Image* sub = sub_image.image.Get();
+    if (sub_image.level || !sub || sub->GetFormat() != Image::kLuminance ||
+        !sub->GetData().Get() || !sub->GetData()->GetData())
+      return false;
+    const uint8* sub_data = sub->GetData()->GetData<uint8>();
+    const uint32 x = sub_image.offset[0];
+    const uint32 y = sub_image.offset[1];
+    if (x + sub->GetWidth() > width || y + sub->GetHeight() > height)
+      return false;
+    for (uint32 row = 0; row < sub->GetHeight(); ++row) {
+      memcpy(&pixels[(y + row) * width + x], sub_data + row * sub->GetWidth(),
+             sub->GetWidth());
+    }
+  }
+
+  ImageHeader header;
+  header.width = width;
+  header.height = height;
+  header.glyph_count = static_cast<uint32>(image_data.glyph_set.size());
+  header.reserved = 0U;
+  AppendBytes(&header, sizeof(header), contents);
+  for (auto it = image_data.glyph_set.cbegin();
+       it != image_data.glyph_set.cend(); ++it) {
+    GlyphRecord record;
+    memset(&record, 0, sizeof(record));
+    record.glyph_index = *it;
+    const auto rect_it = image_data.texture_rectangle_map.find(*it);
+    if (rect_it != image_data.texture_rectangle_map.end()) {
+      record.has_rectangle = 1U;
+      for (int i = 0; i < 2; ++i) {
+        record.min_point[i] = rect_it->second.GetMinPoint()[i];
+        record.max_point[i] = rect_it->second.GetMaxPoint()[i];
+      }
+    }
+    AppendBytes(&record, sizeof(record), contents);
+  }
+  AppendBytes(&pixels[0], pixels.size(), contents);
+  contents->resize(AlignSize(contents->size()), 0U);
+  return true;
+}
+
+// Reads the cache file entry at |*offset| in the mapped |file| into
+// |image_data|, advancing |*offset| past it. Returns false if the entry is
+// truncated or malformed.
+static bool ReadImageData(const std::shared_ptr<port::MemoryMappedFile>& file,
+                          size_t* offset, FontImage::ImageData* image_data,
+                          const base::AllocatorPtr& allocator) {
+  const uint8* data = static_cast<const uint8*>(file->GetData());
+  const size_t length = file->GetLength();
+  ImageHeader header;
+  if (length - *offset < sizeof(header))
+    return false;
+  memcpy(&header, data + *offset, sizeof(header));
+  *offset += sizeof(header);
+  const size_t records_size =
+      static_cast<size_t>(header.glyph_count) * sizeof(GlyphRecord);
+  const size_t pixels_size =
+      static_cast<size_t>(header.width) * static_cast<size_t>(header.height);
+  if (!pixels_size || length - *offset < records_size ||
+      length - *offset - records_size < AlignSize(pixels_size))
+    return false;
+
+  for (uint32 i = 0; i < header.glyph_count; ++i) {
+    GlyphRecord record;
+    memcpy(&record, data + *offset, sizeof(record));
+    *offset += sizeof(record);
+    image_data->glyph_set.insert(static_cast<GlyphIndex>(record.glyph_index));
+    if (record.has_rectangle) {
+      image_data->texture_rectangle_map[record.glyph_index] = math::Range2f(
+          math::Point2f(record.min_point[0], record.min_point[1]),
+          math::Point2f(record.max_point[0], record.max_point[1]));
+    }
+  }
+
+  // The data container keeps the file mapped until its data is wiped or
+  // deleted.
+  std::shared_ptr<port::MemoryMappedFile> mapping(file);
+  ImagePtr image(new(allocator) Image);
+  image->Set(Image::kLuminance, header.width, header.height,
+             base::DataContainer::Create<uint8>(
+                 const_cast<uint8*>(data + *offset),
+                 [mapping](void*) mutable { mapping.reset(); }, true,
+                 allocator));
+  image_data->texture->SetImage(0U, image);
+  *offset += AlignSize(pixels_size);
+  return true;
+}
+
+// A StaticFontImage that is constructed from restored ImageData.
+class RestoredStaticFontImage : public StaticFontImage {
+ public:
+  RestoredStaticFontImage(const FontPtr& font, size_t max_image_size,
+                          const ImageData& image_data)
+      : StaticFontImage(font, max_image_size, image_data) {}
+
+ protected:
+  ~RestoredStaticFontImage() override {}
+};
+
+// A DynamicFontImage that starts with restored ImageData instances.
+class RestoredDynamicFontImage : public DynamicFontImage {
+ public:
+  RestoredDynamicFontImage(const FontPtr& font, size_t image_size,
+                           const std::vector<ImageData>& image_data)
+      : DynamicFontImage(font, image_size) {
+    for (size_t i = 0; i < image_data.size(); ++i)
+      AddRestoredImageData(image_data[i]);
+  }
+
+ protected:
+  ~RestoredDynamicFontImage() override {}
+};
+
+#if defined(ION_PLATFORM_MAC) || defined(ION_PLATFORM_IOS)
+typedef CoreTextFont PlatformFont;
+#else
+typedef FreeTypeFont PlatformFont;
+#endif
+
+// Holds the data of a font read from a zipasset. This is a separate base class
+// of ZipassetFont so that the data is set before the font is constructed.
+class ZipassetFontData {
+ protected:
+  explicit ZipassetFontData(const std::shared_ptr<const std::string>& data)
+      : data_(data) {}
+
+  const std::shared_ptr<const std::string> data_;
+};
+
+// A Font built from zipasset data, which it keeps alive for as long as the
+// Font references it.
+class ZipassetFont : private ZipassetFontData, public PlatformFont {
+ public:
+  ZipassetFont(const std::string& name, size_t size_in_pixels,
+               size_t sdf_padding,
+               const std::shared_ptr<const std::string>& data)
+      : ZipassetFontData(data),
+        PlatformFont(name, size_in_pixels, sdf_padding, data_->data(),
+                     data_->size()) {}
+
+ protected:
+  ~ZipassetFont() override {}
+};
+
+}  // anonymous namespace
+
 //-----------------------------------------------------------------------------
 //
 // FontManager functions.
@@ -37,7 +289,8 @@ namespace text {
 
 FontManager::FontManager()
     : font_map_(*this),
-      font_image_map_(*this) {}
+      font_image_map_(*this),
+      font_data_hash_map_(*this) {}
 
 FontManager::~FontManager() {}
 
@@ -61,6 +314,10 @@ const FontPtr FontManager::AddFont(
       name, size_in_pixels, sdf_padding, data, data_size));
 #endif
   AddFont(font);
+  if (data && data_size) {
+    font_data_hash_map_[BuildFontKey(name, size_in_pixels, sdf_padding)] =
+        ComputeHash(data, data_size);
+  }
   return font;
 }
 
@@ -72,15 +329,20 @@ const FontPtr FontManager::AddFontFromZipasset(const std::string& font_name,
   if (font.Get())
     return font;
 
-  // Read the font data.
-  const std::string& data =
-  ion::base::ZipAssetManager::GetFileData(zipasset_name + ".ttf");
-  if (ion::base::IsInvalidReference(data) || data.empty()) {
+  // Read the font data. The Font references the data rather than copying it,
+  // so it holds on to it.
+  const std::shared_ptr<const std::string> data =
+      ion::base::ZipAssetManager::GetFileDataPtr(zipasset_name + ".ttf");
+  if (!data || data->empty()) {
     LOG(ERROR) << "Unable to read data for font \"" << font_name << "\".";
     return font;
   }
 
-  return AddFont(font_name, size_in_pixels, sdf_padding, &data[0], data.size());
+  font.Reset(new ZipassetFont(font_name, size_in_pixels, sdf_padding, data));
+  AddFont(font);
+  font_data_hash_map_[BuildFontKey(font_name, size_in_pixels, sdf_padding)] =
+      ComputeHash(data->data(), data->size());
+  return font;
 }
 
 const FontPtr FontManager::FindFont(
@@ -90,6 +352,142 @@ const FontPtr FontManager::FindFont(
   return it == font_map_.end() ? FontPtr() : it->second;
 }
 
+bool FontManager::SaveFontImage(const std::string& key,
+                                const FontImagePtr& font_image) {
+  if (font_image_cache_directory_.empty() || !font_image.Get() ||
+      !font_image->GetFont().Get())
+    return false;
+  const Font& font = *font_image->GetFont();
+
+  std::vector<const FontImage::ImageData*> image_data;
+  if (font_image->GetType() == FontImage::kStatic) {
+    image_data.push_back(
+        &static_cast<StaticFontImage*>(font_image.Get())->GetImageData());
+  } else {
+    const DynamicFontImage& dfi =
+        *static_cast<DynamicFontImage*>(font_image.Get());
+    for (size_t i = 0; i < dfi.GetImageDataCount(); ++i)
+      image_data.push_back(&dfi.GetImageData(i));
+  }
+
+  FileHeader header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kFileVersion;
+  header.type = static_cast<uint32>(font_image->GetType());
+  header.font_data_hash = GetFontDataHash(font);
+  header.size_in_pixels = static_cast<uint32>(font.GetSizeInPixels());
+  header.sdf_padding = static_cast<uint32>(font.GetSdfPadding());
+  header.max_image_size = static_cast<uint32>(font_image->GetMaxImageSize());
+  header.image_count = static_cast<uint32>(image_data.size());
+  header.sdf_algorithm = static_cast<uint32>(font.GetSdfAlgorithm());
+  header.reserved = 0U;
+  std::vector<uint8> contents;
+  AppendBytes(&header, sizeof(header), &contents);
+  for (size_t i = 0; i < image_data.size(); ++i) {
+    if (!AppendImageData(*image_data[i], &contents)) {
+      LOG(WARNING) << "Unable to save FontImage \"" << key
+                   << "\" since its image data is not available";
+      return false;
+    }
+  }
+
+  // Write to a temporary file and rename it so that a concurrent reader, such
+  // as another process, never maps a partially written file.
+  const std::string path = GetFontImageCachePath(key, font);
+  const std::string temp_path = path + ".tmp";
+  FILE* file = port::OpenFile(temp_path, "wb");
+  if (!file) {
+    LOG(WARNING) << "Unable to write FontImage cache file " << path;
+    return false;
+  }
+  const bool written =
+      fwrite(&contents[0], 1U, contents.size(), file) == contents.size();
+  const bool closed = fclose(file) == 0;
+  // On some platforms rename() fails if the destination exists.
+  if (written && closed) port::RemoveFile(path);
+  if (!written || !closed || rename(temp_path.c_str(), path.c_str()) != 0) {
+    port::RemoveFile(temp_path);
+    LOG(WARNING) << "Unable to write FontImage cache file " << path;
+    return false;
+  }
+  return true;
+}
+
+const FontImagePtr FontManager::LoadFontImage(const std::string& key,
+                                              const FontPtr& font) {
+  FontImagePtr font_image;
+  if (font_image_cache_directory_.empty() || !font.Get())
+    return font_image;
+
+  const std::string path = GetFontImageCachePath(key, *font);
+  std::shared_ptr<port::MemoryMappedFile> file(
+      new port::MemoryMappedFile(path));
+  const uint8* data = static_cast<const uint8*>(file->GetData());
+  FileHeader header;
+  if (!data || file->GetLength() < sizeof(header))
+    return font_image;
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) ||
+      header.version != kFileVersion ||
+      header.type > static_cast<uint32>(FontImage::kDynamic) ||
+      header.font_data_hash != GetFontDataHash(*font) ||
+      header.size_in_pixels != font->GetSizeInPixels() ||
+      header.sdf_padding != font->GetSdfPadding() ||
+      header.sdf_algorithm != static_cast<uint32>(font->GetSdfAlgorithm()) ||
+      (header.type == FontImage::kStatic && header.image_count != 1U))
+    return font_image;
+
+  const base::AllocatorPtr& allocator = GetAllocator();
+  std::vector<FontImage::ImageData> image_data;
+  size_t offset = sizeof(header);
+  for (uint32 i = 0; i < header.image_count; ++i) {
+    image_data.push_back(FontImage::ImageData(allocator));
+    if (!ReadImageData(file, &offset, &image_data.back(), allocator) ||
+        (header.type == FontImage::kDynamic &&
+         (image_data.back().texture->GetImage(0U)->GetWidth() !=
+              header.max_image_size ||
+          image_data.back().texture->GetImage(0U)->GetHeight() !=
+              header.max_image_size))) {
+      LOG(WARNING) << "Ignoring invalid FontImage cache file " << path;
+      return font_image;
+    }
+    std::string label =
+        font->GetName() + "_" + base::ValueToString(font->GetSizeInPixels());
+    if (header.type == FontImage::kDynamic)
+      label += "_" + base::ValueToString(i);
+    image_data.back().texture->SetLabel(label);
+  }
+
+  if (header.type == FontImage::kStatic) {
+    font_image.Reset(new(allocator) RestoredStaticFontImage(
+        font, header.max_image_size, image_data[0]));
+  } else {
+    font_image.Reset(new(allocator) RestoredDynamicFontImage(
+        font, header.max_image_size, image_data));
+  }
+  CacheFontImage(key, font_image);
+  return font_image;
+}
+
+const std::string FontManager::GetFontImageCachePath(const std::string& key,
+                                                     const Font& font) const {
+  // The font key's terminating NUL separates it from |key|.
+  const std::string font_key = BuildFontKeyFromFont(font);
+  const uint64 hash = ComputeHash(key.data(), key.size(),
+                                  ComputeHash(font_key.data(),
+                                              font_key.size() + 1U));
+  std::ostringstream path;
+  path << font_image_cache_directory_ << '/' << std::hex << std::setw(16)
+       << std::setfill('0') << hash << kFileExtension;
+  return path.str();
+}
+
+uint64 FontManager::GetFontDataHash(const Font& font) const {
+  const FontDataHashMap::const_iterator it =
+      font_data_hash_map_.find(BuildFontKeyFromFont(font));
+  return it == font_data_hash_map_.end() ? 0U : it->second;
+}
+
 const std::string FontManager::BuildFontKey(
     const std::string& name, size_t size_in_pixels, size_t sdf_padding) {
   std::ostringstream s;
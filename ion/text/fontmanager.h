@@ -21,6 +21,7 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "base/integral_types.h"
 #include "ion/base/referent.h"
 #include "ion/base/stlalloc/allocmap.h"
 #include "ion/external/gtest/gunit_prod.h"  // For FRIEND_TEST().
@@ -92,6 +93,37 @@ class ION_API FontManager : public base::Referent {
     return GetCachedFontImage(BuildFontKeyFromFont(*font));
   }
 
+  // Sets/returns the directory in which SaveFontImage() writes FontImage
+  // atlases and from which LoadFontImage() restores them, so that they can be
+  // reused across runs. The default is an empty string, which disables
+  // persistence.
+  void SetFontImageCacheDirectory(const std::string& directory) {
+    font_image_cache_directory_ = directory;
+  }
+  const std::string& GetFontImageCacheDirectory() const {
+    return font_image_cache_directory_;
+  }
+
+  // Writes the images, glyph sets and texture coordinate rectangles of a
+  // StaticFontImage or DynamicFontImage to a versioned file in the cache
+  // directory. The file is identified by |key| and the name, size and SDF
+  // padding of the FontImage's Font, and records a hash of the font data
+  // passed to AddFont() so that a changed font invalidates it. This must be
+  // called before the images are wiped by rendering; pending sub-images are
+  // included, but for a DynamicFontImage with deferred updates,
+  // ProcessDeferredUpdates() must be called first. Returns false if the
+  // FontImage could not be written.
+  bool SaveFontImage(const std::string& key, const FontImagePtr& font_image);
+
+  // Returns a FontImage for |font| restored from the file written by
+  // SaveFontImage() for |key|, or a NULL pointer if there is no such file or
+  // it does not match the font. The image data is memory-mapped from the file
+  // and released once it has been uploaded. A restored FontImage has the same
+  // type as the saved one and is also cached as if CacheFontImage() were
+  // called with |key|.
+  const FontImagePtr LoadFontImage(const std::string& key,
+                                   const FontPtr& font);
+
  protected:
   // The destructor is protected because all base::Referent classes must have
   // protected or private destructors.
@@ -100,6 +132,7 @@ class ION_API FontManager : public base::Referent {
  private:
   typedef base::AllocMap<std::string, FontPtr> FontMap;
   typedef base::AllocMap<std::string, FontImagePtr> FontImageMap;
+  typedef base::AllocMap<std::string, uint64> FontDataHashMap;
 
   // Constructs a string key from a Font for use in the Font map.
   static const std::string BuildFontKeyFromFont(const Font& font) {
@@ -112,13 +145,28 @@ class ION_API FontManager : public base::Referent {
   static const std::string BuildFontKey(
       const std::string& name, size_t size_in_pixels, size_t sdf_padding);
 
+  // Returns the path of the file used to persist the FontImage for |font| and
+  // |key|.
+  const std::string GetFontImageCachePath(const std::string& key,
+                                          const Font& font) const;
+
+  // Returns the hash of the data used to create |font|, or 0 if the font was
+  // not created from data by this manager.
+  uint64 GetFontDataHash(const Font& font) const;
+
   // Maps a Font key to a Font instance.
   FontMap font_map_;
   // Maps a user-supplied string key to a FontImage instance.
   FontImageMap font_image_map_;
+  // Maps a Font key to the hash of the data used to create the Font.
+  FontDataHashMap font_data_hash_map_;
+  // Directory used to persist FontImage instances.
+  std::string font_image_cache_directory_;
 
   // Allow tests to access private functions.
   FRIEND_TEST(FontManagerTest, BuildFontKey);
+  FRIEND_TEST(FontManagerTest, SaveAndLoadFontImage);
+  FRIEND_TEST(FontManagerTest, SaveFontImageWithImageRetention);
 };
 
 // Convenience typedef for shared pointer to a FontManager.
@@ -41,6 +41,7 @@ limitations under the License.
 #include "ion/port/mutex.h"
 #include "ion/text/freetypefontutils.h"
 #include "ion/text/layout.h"
+#include "ion/text/shapingcache.h"
 #if defined(ION_USE_ICU)
 #include "third_party/icu/icu4c/source/common/unicode/udata.h"
 #include "third_party/iculehb/src/src/LEFontInstance.h"
@@ -362,6 +363,9 @@ class FreeTypeFont::Helper
   // fallbacks, not just glyph loading.
   void AddFallbackFace(const std::weak_ptr<Helper>& fallback);
 
+  // Returns the cache of shaped text.
+  ShapingCache& GetShapingCache() { return shaping_cache_; }
+
 #if defined(ION_USE_ICU)
   // icu::LEFontInstance implementation.
   const void* getFontTable(LETag tableTag, size_t& length) const override;
@@ -432,6 +436,8 @@ class FreeTypeFont::Helper
   FT_Face ft_face_;
   std::vector<std::weak_ptr<Helper>> fallback_helpers_;
   FreeTypeManager* manager_;
+  // Lines of text shaped with this font and its fallbacks.
+  ShapingCache shaping_cache_;
   mutable port::Mutex mutex_;
 };
 
@@ -634,6 +640,8 @@ void FreeTypeFont::Helper::AddFallbackFace(
   }
   base::LockGuard guard(&mutex_);
   fallback_helpers_.push_back(fallback);
+  // Text may be shaped differently with the new fallback.
+  shaping_cache_.Clear();
 }
 
 #if defined(ION_USE_ICU)
@@ -803,6 +811,10 @@ const math::Vector2f FreeTypeFont::GetKerning(CharIndex char_index0,
   return helper_->GetKerning(char_index0, char_index1);
 }
 
+ShapingCache& FreeTypeFont::GetShapingCache() const {
+  return helper_->GetShapingCache();
+}
+
 #if defined(ION_USE_ICU)
 void FreeTypeFont::GetFontRunsForText(icu::UnicodeString chars,
                                       iculx::FontRuns* runs) const {
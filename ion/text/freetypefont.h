@@ -31,6 +31,8 @@ limitations under the License.
 namespace ion {
 namespace text {
 
+class ShapingCache;
+
 // This derived Font class represents a FreeType2 font.
 class ION_API FreeTypeFont : public Font {
  public:
@@ -73,6 +75,11 @@ class ION_API FreeTypeFont : public Font {
   const math::Vector2f GetKerning(CharIndex char_index0,
                                   CharIndex char_index1) const;
 
+  // Returns the cache of lines of text shaped by the complex-script layout
+  // engine. Its budget can be changed to trade memory for layout speed. The
+  // cache is cleared when a fallback font is added.
+  ShapingCache& GetShapingCache() const;
+
 #if defined(ION_USE_ICU)
   // Compute the FontRuns which will cover the string |chars| taking fallbacks
   // into account.
@@ -33,6 +33,7 @@ limitations under the License.
 #include "ion/port/fileutils.h"
 #include "ion/port/memorymappedfile.h"
 #include "ion/text/freetypefont.h"
+#include "ion/text/shapingcache.h"
 
 #if defined(ION_USE_ICU)
 #include "third_party/icu/icu4c/source/common/unicode/udata.h"
@@ -392,23 +393,20 @@ static void GetGlyphFromRun(const iculx::ParagraphLayout::VisualRun& run,
   *glyph_y = -run.getPositions()[which_glyph_in_run * 2 + 1];
 }
 
-// Helper for laying out |text| into |layout| using ICU and |font|.  Returns
-// the total X advance used or 0 in case of error.
-static float IcuLayoutEngineLayoutLine(
-    const FreeTypeFont& font,
-    const std::string& text,
-    size_t line_index,
-    const FreeTypeFontTransformData& transform_data,
-    Layout* layout) {
+// Shapes |text| using ICU and |font|, storing the glyphs and the total X
+// advance in |shaped|. Returns false in case of error.
+static bool ShapeLineWithIcu(const FreeTypeFont& font,
+                             const std::string& text,
+                             ShapedText* shaped) {
   if (!InitializeIcu()) {
-    return 0.0f;
+    return false;
   }
 
   // Convert the string to UTF-16.
   icu::UnicodeString chars = icu::UnicodeString::fromUTF8(text);
   if (chars.isEmpty()) {
     DLOG(ERROR) << "Empty text for layout, or corrupt utf8? [" << text << "]";
-    return 0.0f;
+    return false;
   }
 
   // Generate a ParagraphLayout from the text.
@@ -420,7 +418,7 @@ static float IcuLayoutEngineLayoutLine(
       UBIDI_DEFAULT_LTR, false /* is_vertical */, status));
   if (status != LE_NO_ERROR) {
     DLOG(ERROR) << "new ParagraphLayout error: " << status;
-    return 0.0f;
+    return false;
   }
 
   // Retrieve the glyphs from the layout, passing 0 to nextLine because we want
@@ -428,61 +426,95 @@ static float IcuLayoutEngineLayoutLine(
   icu_layout->reflow();
   std::unique_ptr<iculx::ParagraphLayout::Line> line(icu_layout->nextLine(0));
   if (!line.get()) {
-    return 0.0f;
+    return false;
   }
 
   enum { kImpossibleGlyphIndex = -1 };
   int32 glyph_id = kImpossibleGlyphIndex;
   float glyph_x = -1;
   float glyph_y = -1;
-
-  if (layout != NULL) {  // Caller wants all the glyph descriptors
-    layout->Reserve(chars.length());
-    for (int i = 0; i < line->countRuns(); ++i) {
-      const iculx::ParagraphLayout::VisualRun *run = line->getVisualRun(i);
-      const icu::LEFontInstance* run_font = run->getFont();
-      for (int j = 0; j < run->getGlyphCount(); ++j) {
-        GetGlyphFromRun(*run, j, &glyph_id, &glyph_x, &glyph_y);
-        if (glyph_id == 0 || glyph_id >= 0xffff)
-          continue;
-        GlyphIndex glyph_index = font.GlyphIndexForICUFont(run_font, glyph_id);
-        const FreeTypeFont::GlyphMetrics& metrics =
-            font.GetGlyphMetrics(glyph_index);
-        if (base::IsInvalidReference(metrics))
-          continue;
-        glyph_x += metrics.bitmap_offset[0];
-        glyph_y += transform_data.line_y_offset_in_pixels *
-            static_cast<float>(line_index) +
-            (metrics.bitmap_offset[1] - metrics.size[1]);
-        AddGlyphToLayout(glyph_index, line_index, Point2f(glyph_x, glyph_y),
-                         metrics, transform_data,
-                         font.GetSdfPadding(), layout);
-      }
-    }
-  } else {
-    // Just find the final glyph to determine total advance
-    for (int i = line->countRuns() - 1;
-         i >= 0 && glyph_id == kImpossibleGlyphIndex; --i) {
-      const iculx::ParagraphLayout::VisualRun *run = line->getVisualRun(i);
-      for (int j = run->getGlyphCount() - 1; j >= 0; --j) {
-        if (run->getGlyphs()[j] < 0xffff) {
-          GetGlyphFromRun(*run, j, &glyph_id, &glyph_x, &glyph_y);
-          break;
-        }
-      }
+  int32 last_glyph_id = kImpossibleGlyphIndex;
+  float last_glyph_x = 0.f;
+  const icu::LEFontInstance* last_run_font = NULL;
+
+  shaped->glyphs.reserve(chars.length());
+  for (int i = 0; i < line->countRuns(); ++i) {
+    const iculx::ParagraphLayout::VisualRun *run = line->getVisualRun(i);
+    const icu::LEFontInstance* run_font = run->getFont();
+    for (int j = 0; j < run->getGlyphCount(); ++j) {
+      GetGlyphFromRun(*run, j, &glyph_id, &glyph_x, &glyph_y);
+      if (glyph_id >= 0xffff)
+        continue;
+      // Track the final glyph to determine the total advance.
+      last_glyph_id = glyph_id;
+      last_glyph_x = glyph_x;
+      last_run_font = run_font;
+      if (glyph_id == 0)
+        continue;
+      shaped->glyphs.push_back(ShapedText::Glyph(
+          font.GlyphIndexForICUFont(run_font, glyph_id),
+          Point2f(glyph_x, glyph_y)));
     }
   }
 
-  if (glyph_id == kImpossibleGlyphIndex) {
-    return 0.0f;
+  if (last_glyph_id == kImpossibleGlyphIndex) {
+    return false;
   }
 
   // Compute the total advance ourselves since ICU is known to lie.
   LEPoint advance_p;
-  runs.getFont(runs.getCount() - 1)->getGlyphAdvance(glyph_id, advance_p);
-  float final_advance = advance_p.fX;
-  float final_position = glyph_x;
-  return final_advance + final_position;
+  last_run_font->getGlyphAdvance(last_glyph_id, advance_p);
+  shaped->advance = advance_p.fX + last_glyph_x;
+  return true;
+}
+
+// Returns the ShapedText for |text| from the ShapingCache of |font|, shaping
+// and caching it first if necessary. Text that cannot be shaped results in an
+// empty ShapedText, which is cached as well.
+static const ShapedTextPtr GetShapedLine(const FreeTypeFont& font,
+                                         const std::string& text) {
+  ShapingCache& cache = font.GetShapingCache();
+  ShapedTextPtr shaped = cache.Find(text);
+  if (!shaped) {
+    std::shared_ptr<ShapedText> new_shaped(new ShapedText);
+    if (!ShapeLineWithIcu(font, text, new_shaped.get()))
+      new_shaped.reset(new ShapedText);
+    shaped = new_shaped;
+    cache.Insert(text, shaped);
+  }
+  return shaped;
+}
+
+// Helper for laying out |text| into |layout| using ICU and |font|.  Returns
+// the total X advance used or 0 in case of error.
+static float IcuLayoutEngineLayoutLine(
+    const FreeTypeFont& font,
+    const std::string& text,
+    size_t line_index,
+    const FreeTypeFontTransformData& transform_data,
+    Layout* layout) {
+  const ShapedTextPtr shaped = GetShapedLine(font, text);
+
+  if (layout != NULL) {  // Caller wants all the glyph descriptors
+    const size_t num_glyphs = shaped->glyphs.size();
+    layout->Reserve(layout->GetGlyphCount() + num_glyphs);
+    for (size_t i = 0; i < num_glyphs; ++i) {
+      const ShapedText::Glyph& glyph = shaped->glyphs[i];
+      const FreeTypeFont::GlyphMetrics& metrics =
+          font.GetGlyphMetrics(glyph.glyph_index);
+      if (base::IsInvalidReference(metrics))
+        continue;
+      const float glyph_x = glyph.position[0] + metrics.bitmap_offset[0];
+      const float glyph_y = glyph.position[1] +
+          transform_data.line_y_offset_in_pixels *
+          static_cast<float>(line_index) +
+          (metrics.bitmap_offset[1] - metrics.size[1]);
+      AddGlyphToLayout(glyph.glyph_index, line_index,
+                       Point2f(glyph_x, glyph_y), metrics, transform_data,
+                       font.GetSdfPadding(), layout);
+    }
+  }
+  return shaped->advance;
 }
 
 // Return true if no character in |text| is in a script that requires complex
@@ -20,6 +20,21 @@ limitations under the License.
 namespace ion {
 namespace text {
 
+namespace {
+
+static bool AreGlyphsEqual(const Layout::Glyph& g0, const Layout::Glyph& g1) {
+  if (g0.glyph_index != g1.glyph_index || g0.bounds != g1.bounds ||
+      g0.offset != g1.offset)
+    return false;
+  for (int i = 0; i < 4; ++i) {
+    if (g0.quad.points[i] != g1.quad.points[i])
+      return false;
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
 bool Layout::AddGlyph(const Glyph& glyph) {
   if (glyph.glyph_index) {
     glyphs_.push_back(glyph);
@@ -57,6 +72,17 @@ void Layout::SetLineAdvanceHeight(float line_advance) {
   line_advance_height_ = line_advance;
 }
 
+bool Layout::operator==(const Layout& other) const {
+  if (line_advance_height_ != other.line_advance_height_ ||
+      glyphs_.size() != other.glyphs_.size())
+    return false;
+  for (size_t i = 0; i < glyphs_.size(); ++i) {
+    if (!AreGlyphsEqual(glyphs_[i], other.glyphs_[i]))
+      return false;
+  }
+  return true;
+}
+
 // Helpers for logging Layouts/Glyphs/Quads.
 std::ostream& operator<<(std::ostream& out, const Layout::Quad& q) {
   return out << "QUAD { "
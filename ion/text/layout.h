@@ -208,6 +208,12 @@ class ION_API Layout {
   // Sets the vertical distance between successive baselines.
   void SetLineAdvanceHeight(float line_advance);
 
+  // Returns true if |other| contains exactly the same glyphs, with the same
+  // quads, bounds and offsets, and the same line advance height. Builders use
+  // this to detect that a rebuild would produce identical geometry.
+  bool operator==(const Layout& other) const;
+  bool operator!=(const Layout& other) const { return !(*this == other); }
+
  private:
   std::vector<Glyph> glyphs_;
   float line_advance_height_;
@@ -0,0 +1,133 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/text/layoutcache.h"
+
+#include <functional>
+
+#include "ion/base/lockguards.h"
+
+namespace ion {
+namespace text {
+
+namespace {
+
+// Mixes |value| into |seed|.
+static void CombineHash(size_t value, size_t* seed) {
+  *seed ^= value + 0x9e3779b9 + (*seed << 6) + (*seed >> 2);
+}
+
+}  // anonymous namespace
+
+bool LayoutCache::Key::operator==(const Key& other) const {
+  return font == other.font && text == other.text &&
+      options.target_point == other.options.target_point &&
+      options.target_size == other.options.target_size &&
+      options.horizontal_alignment == other.options.horizontal_alignment &&
+      options.vertical_alignment == other.options.vertical_alignment &&
+      options.line_spacing == other.options.line_spacing;
+}
+
+size_t LayoutCache::KeyHash::operator()(const Key& key) const {
+  std::hash<float> float_hash;
+  size_t seed = std::hash<const Font*>()(key.font);
+  CombineHash(std::hash<std::string>()(key.text), &seed);
+  for (int i = 0; i < 2; ++i) {
+    CombineHash(float_hash(key.options.target_point[i]), &seed);
+    CombineHash(float_hash(key.options.target_size[i]), &seed);
+  }
+  CombineHash(static_cast<size_t>(key.options.horizontal_alignment), &seed);
+  CombineHash(static_cast<size_t>(key.options.vertical_alignment), &seed);
+  CombineHash(float_hash(key.options.line_spacing), &seed);
+  return seed;
+}
+
+const size_t LayoutCache::kDefaultCapacity;
+
+LayoutCache::LayoutCache()
+    : entries_(kDefaultCapacity), hit_count_(0), miss_count_(0) {}
+
+LayoutCache::LayoutCache(size_t capacity)
+    : entries_(capacity), hit_count_(0), miss_count_(0) {}
+
+LayoutCache::~LayoutCache() {}
+
+const SharedLayoutPtr LayoutCache::GetLayout(const FontPtr& font,
+                                             const std::string& text,
+                                             const LayoutOptions& options) {
+  if (!font.Get())
+    return SharedLayoutPtr();
+
+  Key key;
+  key.font = font.Get();
+  key.text = text;
+  key.options = options;
+  {
+    base::LockGuard guard(&mutex_);
+    if (const Entry* entry = entries_.Find(key)) {
+      ++hit_count_;
+      return entry->layout;
+    }
+    ++miss_count_;
+  }
+
+  // Build the Layout without holding the lock, since this may be slow.
+  SharedLayoutPtr layout(new Layout(font->BuildLayout(text, options)));
+
+  base::LockGuard guard(&mutex_);
+  // Another thread may have cached the same Layout in the meantime.
+  if (!entries_.Contains(key)) {
+    Entry entry;
+    entry.font = font;
+    entry.layout = layout;
+    entries_.Insert(key, entry);
+  }
+  return layout;
+}
+
+void LayoutCache::SetCapacity(size_t capacity) {
+  base::LockGuard guard(&mutex_);
+  entries_.SetBudget(capacity);
+}
+
+size_t LayoutCache::GetCapacity() const {
+  base::LockGuard guard(&mutex_);
+  return entries_.GetBudget();
+}
+
+size_t LayoutCache::GetSize() const {
+  base::LockGuard guard(&mutex_);
+  return entries_.GetEntryCount();
+}
+
+void LayoutCache::Clear() {
+  base::LockGuard guard(&mutex_);
+  entries_.Clear();
+}
+
+size_t LayoutCache::GetHitCount() const {
+  base::LockGuard guard(&mutex_);
+  return hit_count_;
+}
+
+size_t LayoutCache::GetMissCount() const {
+  base::LockGuard guard(&mutex_);
+  return miss_count_;
+}
+
+}  // namespace text
+}  // namespace ion
@@ -0,0 +1,116 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef ION_TEXT_LAYOUTCACHE_H_
+#define ION_TEXT_LAYOUTCACHE_H_
+
+#include <memory>
+#include <string>
+
+#include "base/macros.h"
+#include "ion/base/lrucache.h"
+#include "ion/base/referent.h"
+#include "ion/port/mutex.h"
+#include "ion/text/font.h"
+#include "ion/text/layout.h"
+
+namespace ion {
+namespace text {
+
+// Convenience typedef for a shared, immutable Layout returned by a
+// LayoutCache.
+typedef std::shared_ptr<const Layout> SharedLayoutPtr;
+
+// A LayoutCache remembers the Layouts built by Font::BuildLayout() so that
+// text that is laid out repeatedly with the same options, such as HUD labels
+// and counters that are rebuilt every frame, does not pay for the layout more
+// than once. Entries are keyed by the Font, the text string and every field of
+// the LayoutOptions, and the least recently used entries are evicted once the
+// cache holds more than its capacity. Returned Layouts are shared and remain
+// valid after eviction. Each entry holds a reference to its Font. All
+// functions are thread-safe.
+class ION_API LayoutCache : public base::Referent {
+ public:
+  // The default maximum number of cached Layouts.
+  static const size_t kDefaultCapacity = 256;
+
+  LayoutCache();
+  explicit LayoutCache(size_t capacity);
+
+  // Returns the Layout of |text| as built by |font| with |options|, building
+  // and caching it if it is not already cached. Returns a NULL pointer if
+  // |font| is NULL.
+  const SharedLayoutPtr GetLayout(const FontPtr& font, const std::string& text,
+                                  const LayoutOptions& options);
+
+  // Sets/returns the maximum number of cached Layouts. Reducing the capacity
+  // evicts the least recently used entries immediately. A capacity of zero
+  // disables caching.
+  void SetCapacity(size_t capacity);
+  size_t GetCapacity() const;
+
+  // Returns the number of cached Layouts.
+  size_t GetSize() const;
+
+  // Removes all cached Layouts. The hit and miss counts are not reset.
+  void Clear();
+
+  // Returns the number of calls to GetLayout() that found a cached Layout or
+  // had to build one, respectively.
+  size_t GetHitCount() const;
+  size_t GetMissCount() const;
+
+ protected:
+  // The destructor is protected because all base::Referent classes must have
+  // protected or private destructors.
+  ~LayoutCache() override;
+
+ private:
+  // Identifies a cached Layout.
+  struct Key {
+    const Font* font;
+    std::string text;
+    LayoutOptions options;
+    bool operator==(const Key& other) const;
+  };
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+  struct Entry {
+    // Keeps the Font alive so that its address cannot be reused by another
+    // Font while the entry exists.
+    FontPtr font;
+    SharedLayoutPtr layout;
+  };
+
+  // Cached entries. Each costs 1, so the budget is the capacity.
+  base::LruCache<Key, Entry, KeyHash> entries_;
+  size_t hit_count_;
+  size_t miss_count_;
+  // Protects all of the above.
+  mutable port::Mutex mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(LayoutCache);
+};
+
+// Convenience typedef for shared pointer to a LayoutCache.
+typedef base::ReferentPtr<LayoutCache>::Type LayoutCachePtr;
+
+}  // namespace text
+}  // namespace ion
+
+#endif  // ION_TEXT_LAYOUTCACHE_H_
@@ -0,0 +1,132 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/text/layoutworkqueue.h"
+
+#include <utility>
+
+#include "ion/base/lockguards.h"
+#include "ion/base/logging.h"
+
+namespace ion {
+namespace text {
+
+LayoutWorkQueue::LayoutWorkQueue(size_t thread_count) : pool_(this) {
+  DCHECK_GT(thread_count, 0U);
+  pool_.ResizeThreadPool(thread_count);
+  pool_.Resume();
+}
+
+LayoutWorkQueue::~LayoutWorkQueue() {
+  pool_.Suspend();
+  pool_.ResizeThreadPool(0U);
+  // Nobody else can queue requests now, so finish the remaining ones here.
+  Request request;
+  while (PopRequest(&request))
+    ProcessRequest(&request);
+}
+
+void LayoutWorkQueue::SetLayoutCache(const LayoutCachePtr& cache) {
+  base::LockGuard guard(&mutex_);
+  layout_cache_ = cache;
+}
+
+const LayoutCachePtr LayoutWorkQueue::GetLayoutCache() const {
+  base::LockGuard guard(&mutex_);
+  return layout_cache_;
+}
+
+std::future<SharedLayoutPtr> LayoutWorkQueue::BuildLayoutAsync(
+    const FontPtr& font, const std::string& text,
+    const LayoutOptions& options) {
+  std::future<SharedLayoutPtr> future;
+  {
+    base::LockGuard guard(&mutex_);
+    requests_.push_back(Request());
+    Request& request = requests_.back();
+    request.font = font;
+    request.text = text;
+    request.options = options;
+    future = request.promise.get_future();
+  }
+  pool_.GetWorkSemaphore()->Post();
+  return future;
+}
+
+std::vector<std::future<SharedLayoutPtr>> LayoutWorkQueue::BuildLayoutsAsync(
+    const FontPtr& font, const std::vector<std::string>& texts,
+    const LayoutOptions& options) {
+  std::vector<std::future<SharedLayoutPtr>> futures;
+  futures.reserve(texts.size());
+  {
+    base::LockGuard guard(&mutex_);
+    for (size_t i = 0; i < texts.size(); ++i) {
+      requests_.push_back(Request());
+      Request& request = requests_.back();
+      request.font = font;
+      request.text = texts[i];
+      request.options = options;
+      futures.push_back(request.promise.get_future());
+    }
+  }
+  for (size_t i = 0; i < texts.size(); ++i)
+    pool_.GetWorkSemaphore()->Post();
+  return futures;
+}
+
+size_t LayoutWorkQueue::GetPendingCount() const {
+  base::LockGuard guard(&mutex_);
+  return requests_.size();
+}
+
+void LayoutWorkQueue::DoWork() {
+  Request request;
+  if (PopRequest(&request))
+    ProcessRequest(&request);
+}
+
+const std::string& LayoutWorkQueue::GetName() const {
+  static const std::string kName("LayoutWorkQueue");
+  return kName;
+}
+
+bool LayoutWorkQueue::PopRequest(Request* request) {
+  base::LockGuard guard(&mutex_);
+  if (requests_.empty())
+    return false;
+  *request = std::move(requests_.front());
+  requests_.pop_front();
+  return true;
+}
+
+void LayoutWorkQueue::ProcessRequest(Request* request) {
+  SharedLayoutPtr layout;
+  if (request->font.Get()) {
+    const LayoutCachePtr cache = GetLayoutCache();
+    if (cache.Get()) {
+      layout = cache->GetLayout(request->font, request->text,
+                                request->options);
+    } else {
+      layout.reset(new Layout(
+          request->font->BuildLayout(request->text, request->options)));
+    }
+  }
+  request->promise.set_value(layout);
+}
+
+}  // namespace text
+}  // namespace ion
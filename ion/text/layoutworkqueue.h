@@ -0,0 +1,114 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef ION_TEXT_LAYOUTWORKQUEUE_H_
+#define ION_TEXT_LAYOUTWORKQUEUE_H_
+
+#include <deque>
+#include <future>  // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "ion/base/referent.h"
+#include "ion/base/workerpool.h"
+#include "ion/port/mutex.h"
+#include "ion/text/font.h"
+#include "ion/text/layout.h"
+#include "ion/text/layoutcache.h"
+
+namespace ion {
+namespace text {
+
+// A LayoutWorkQueue lays out text on a pool of worker threads, so that large
+// sets of labels, such as multilingual text that needs complex-script shaping,
+// can be prepared without blocking the rendering thread. Each request returns
+// a std::future that becomes ready when its Layout has been built. Requests
+// are processed in the order they are queued.
+//
+// Font::BuildLayout() is called concurrently from the worker threads, which
+// FreeTypeFont supports; its shaped lines are cached in its ShapingCache. If
+// a LayoutCache is set, it is consulted and filled by the workers as well.
+class ION_API LayoutWorkQueue : public base::Referent,
+                                private base::WorkerPool::Worker {
+ public:
+  // Creates a queue with |thread_count| worker threads, which must be at least
+  // one.
+  explicit LayoutWorkQueue(size_t thread_count);
+
+  // Sets/returns the LayoutCache used to look up and store the Layouts. It is
+  // NULL by default.
+  void SetLayoutCache(const LayoutCachePtr& cache);
+  const LayoutCachePtr GetLayoutCache() const;
+
+  // Queues |text| to be laid out by |font| with |options|. The future yields
+  // a NULL pointer if |font| is NULL.
+  std::future<SharedLayoutPtr> BuildLayoutAsync(const FontPtr& font,
+                                                const std::string& text,
+                                                const LayoutOptions& options);
+
+  // Queues a batch of strings to be laid out by |font| with the same
+  // |options|, returning a future for each in the same order.
+  std::vector<std::future<SharedLayoutPtr>> BuildLayoutsAsync(
+      const FontPtr& font, const std::vector<std::string>& texts,
+      const LayoutOptions& options);
+
+  // Returns the number of requests that have not been started yet.
+  size_t GetPendingCount() const;
+
+ protected:
+  // The destructor is protected because all base::Referent classes must have
+  // protected or private destructors. Requests that have not been started by
+  // a worker are completed on the calling thread.
+  ~LayoutWorkQueue() override;
+
+ private:
+  // A single queued request.
+  struct Request {
+    FontPtr font;
+    std::string text;
+    LayoutOptions options;
+    std::promise<SharedLayoutPtr> promise;
+  };
+
+  // WorkerPool::Worker implementation, which processes one request.
+  void DoWork() override;
+  const std::string& GetName() const override;
+
+  // Removes the oldest request from the queue and stores it in |request|.
+  // Returns false if the queue is empty.
+  bool PopRequest(Request* request);
+
+  // Builds the Layout for |request| and fulfills its promise.
+  void ProcessRequest(Request* request);
+
+  std::deque<Request> requests_;
+  LayoutCachePtr layout_cache_;
+  // Protects |requests_| and |layout_cache_|.
+  mutable port::Mutex mutex_;
+
+  // Runs the requests. This is declared last so that its threads are stopped
+  // before any other members are destroyed.
+  base::WorkerPool pool_;
+};
+
+// Convenience typedef for shared pointer to a LayoutWorkQueue.
+typedef base::ReferentPtr<LayoutWorkQueue>::Type LayoutWorkQueuePtr;
+
+}  // namespace text
+}  // namespace ion
+
+#endif  // ION_TEXT_LAYOUTWORKQUEUE_H_
@@ -17,6 +17,9 @@ limitations under the License.
 
 #include "ion/text/sdfutils.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "ion/base/logging.h"
 #include "ion/math/utils.h"
 #include "ion/math/vector.h"
@@ -358,6 +361,104 @@ double DistanceComputer::ComputeDistanceToEdge(
   return length + dist;
 }
 
+//-----------------------------------------------------------------------------
+//
+// The EuclideanDistanceTransform class computes exact squared Euclidean
+// distances using the linear-time algorithm described in "Distance Transforms
+// of Sampled Functions" by Felzenszwalb and Huttenlocher. The 2D transform is
+// separable: a 1D transform is applied to every row and then to every column.
+// The column pass operates on a transposed copy of the grid so that both
+// passes stream through contiguous float rows.
+//
+//-----------------------------------------------------------------------------
+
+class EuclideanDistanceTransform {
+ public:
+  // Represents an infinite squared distance. This is finite so that
+  // arithmetic on it cannot produce NaNs.
+  static const float kInfinity;
+
+  // Creates a transform for grids whose width and height are at most
+  // |max_length|.
+  explicit EuclideanDistanceTransform(size_t max_length)
+      : envelope_(max_length),
+        boundaries_(max_length + 1),
+        row_(max_length) {}
+
+  // Replaces the row-major |width| x |height| grid of squared distances in
+  // |grid| with the squared distance to the nearest element, where each
+  // element contributes its own value in addition to its squared distance.
+  // |scratch| must have room for |width| * |height| values.
+  void Transform(size_t width, size_t height, float* grid, float* scratch);
+
+ private:
+  // Applies the 1D transform in place to |length| values in |values|.
+  void Transform1d(float* values, size_t length);
+
+  // Positions of the parabolas forming the lower envelope.
+  std::vector<int> envelope_;
+  // Boundaries between the parabolas in |envelope_|.
+  std::vector<float> boundaries_;
+  // Copy of the input values of the row being transformed.
+  std::vector<float> row_;
+};
+
+const float EuclideanDistanceTransform::kInfinity = 1e20f;
+
+void EuclideanDistanceTransform::Transform(size_t width, size_t height,
+                                           float* grid, float* scratch) {
+  for (size_t y = 0; y < height; ++y)
+    Transform1d(grid + y * width, width);
+  for (size_t y = 0; y < height; ++y) {
+    for (size_t x = 0; x < width; ++x)
+      scratch[x * height + y] = grid[y * width + x];
+  }
+  for (size_t x = 0; x < width; ++x)
+    Transform1d(scratch + x * height, height);
+  for (size_t x = 0; x < width; ++x) {
+    for (size_t y = 0; y < height; ++y)
+      grid[y * width + x] = scratch[x * height + y];
+  }
+}
+
+void EuclideanDistanceTransform::Transform1d(float* values, size_t length) {
+  const int n = static_cast<int>(length);
+  DCHECK_LE(length, row_.size());
+  std::copy(values, values + length, row_.begin());
+  const float* f = &row_[0];
+  int* v = &envelope_[0];
+  float* z = &boundaries_[0];
+
+  // Build the lower envelope of the parabolas rooted at each element.
+  int k = 0;
+  v[0] = 0;
+  z[1] = kInfinity;
+  for (int q = 1; q < n; ++q) {
+    const float fq = f[q] + static_cast<float>(q * q);
+    int r = v[k];
+    float s = (fq - (f[r] + static_cast<float>(r * r))) /
+              static_cast<float>(2 * (q - r));
+    while (k > 0 && s <= z[k]) {
+      r = v[--k];
+      s = (fq - (f[r] + static_cast<float>(r * r))) /
+          static_cast<float>(2 * (q - r));
+    }
+    ++k;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = kInfinity;
+  }
+
+  // Sample the lower envelope.
+  k = 0;
+  for (int q = 0; q < n; ++q) {
+    while (z[k + 1] < static_cast<float>(q))
+      ++k;
+    const int r = v[k];
+    values[q] = static_cast<float>((q - r) * (q - r)) + f[r];
+  }
+}
+
 //-----------------------------------------------------------------------------
 //
 // Helper functions.
@@ -411,6 +512,59 @@ static const Grid BuildSdfGrid(const Grid& grid) {
   return sdf;
 }
 
+// Builds and returns a signed distance field grid for an input grid containing
+// antialiased pixel values using an exact Euclidean distance transform.
+static const Grid BuildExactSdfGrid(const Grid& grid) {
+  typedef EuclideanDistanceTransform Edt;
+  const size_t height = grid.GetHeight();
+  const size_t width = grid.GetWidth();
+  Grid sdf(width, height);
+  if (height > 0 && width > 0) {
+    // |outer| holds the squared distances to the foreground and |inner| the
+    // squared distances to the background. Partially covered pixels are
+    // treated as lying on the edge, offset by their difference from half
+    // coverage.
+    const size_t count = width * height;
+    std::vector<float> outer(count);
+    std::vector<float> inner(count);
+    std::vector<float> scratch(count);
+    for (size_t y = 0; y < height; ++y) {
+      for (size_t x = 0; x < width; ++x) {
+        const float value = static_cast<float>(grid.Get(x, y));
+        const size_t i = y * width + x;
+        if (value >= 1.f) {
+          outer[i] = 0.f;
+          inner[i] = Edt::kInfinity;
+        } else if (value <= 0.f) {
+          outer[i] = Edt::kInfinity;
+          inner[i] = 0.f;
+        } else {
+          const float offset = 0.5f - value;
+          outer[i] = offset > 0.f ? offset * offset : 0.f;
+          inner[i] = offset < 0.f ? offset * offset : 0.f;
+        }
+      }
+    }
+
+    Edt edt(std::max(width, height));
+    edt.Transform(width, height, &outer[0], &scratch[0]);
+    edt.Transform(width, height, &inner[0], &scratch[0]);
+
+    // Clamp the distances for grids that are entirely foreground or
+    // background.
+    const float max_distance = static_cast<float>(
+        sqrt(static_cast<double>(width * width + height * height)));
+    for (size_t y = 0; y < height; ++y) {
+      for (size_t x = 0; x < width; ++x) {
+        const size_t i = y * width + x;
+        const float dist = std::sqrt(outer[i]) - std::sqrt(inner[i]);
+        sdf.Set(x, y, math::Clamp(dist, -max_distance, max_distance));
+      }
+    }
+  }
+  return sdf;
+}
+
 }  // anonymous namespace
 
 //-----------------------------------------------------------------------------
@@ -420,7 +574,14 @@ static const Grid BuildSdfGrid(const Grid& grid) {
 //-----------------------------------------------------------------------------
 
 const Grid ComputeSdfGrid(const Grid& image_grid, size_t padding) {
-  return BuildSdfGrid(PadGrid(image_grid, padding));
+  return ComputeSdfGrid(image_grid, padding, kSweepSdf);
+}
+
+const Grid ComputeSdfGrid(const Grid& image_grid, size_t padding,
+                          SdfAlgorithm algorithm) {
+  const Grid padded_grid = PadGrid(image_grid, padding);
+  return algorithm == kExactEdtSdf ? BuildExactSdfGrid(padded_grid)
+                                   : BuildSdfGrid(padded_grid);
 }
 
 }  // namespace text
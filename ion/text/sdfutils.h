@@ -28,6 +28,21 @@ limitations under the License.
 namespace ion {
 namespace text {
 
+// Algorithms that ComputeSdfGrid() can use to compute signed distances.
+enum SdfAlgorithm {
+  // Iterative forward and backward sweeps that estimate the distance to the
+  // edge inferred from the antialiased pixel values and local gradients
+  // (see <http://contourtextures.wikidot.com>). The number of sweeps depends
+  // on the image contents.
+  kSweepSdf,
+  // An exact Euclidean distance transform (Felzenszwalb and Huttenlocher,
+  // "Distance Transforms of Sampled Functions") computed in two separable
+  // linear-time passes. Partially covered pixels contribute a sub-pixel
+  // offset to the edge based on their coverage. This is much faster than
+  // kSweepSdf for larger glyphs.
+  kExactEdtSdf,
+};
+
 // Creates a signed distance field (SDF) grid from a grid representing an
 // antialiased image (such as a font glyph). The values in the input grid are
 // assumed to be in the range [0,1]. This returns a grid in which each element
@@ -38,9 +53,13 @@ namespace text {
 // the distance field can taper off correctly.  Output elements are positive
 // outside the foreground of the input image and negative inside it.  Output
 // elements have grid-distance as their units, so are bounded in absolute value
-// by sqrt(height^2+width^2) (after padding).
+// by sqrt(height^2+width^2) (after padding). The two-argument version uses
+// kSweepSdf.
 const base::Array2<double> ComputeSdfGrid(
     const base::Array2<double>& image_grid, size_t padding);
+const base::Array2<double> ComputeSdfGrid(
+    const base::Array2<double>& image_grid, size_t padding,
+    SdfAlgorithm algorithm);
 
 }  // namespace text
 }  // namespace ion
@@ -0,0 +1,96 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/text/shapingcache.h"
+
+#include "ion/base/lockguards.h"
+
+namespace ion {
+namespace text {
+
+const size_t ShapingCache::kDefaultBudget;
+
+ShapingCache::ShapingCache()
+    : entries_(kDefaultBudget), hit_count_(0), miss_count_(0) {}
+
+ShapingCache::~ShapingCache() {}
+
+const ShapedTextPtr ShapingCache::Find(const std::string& text) {
+  base::LockGuard guard(&mutex_);
+  if (const ShapedTextPtr* shaped = entries_.Find(text)) {
+    ++hit_count_;
+    return *shaped;
+  }
+  ++miss_count_;
+  return ShapedTextPtr();
+}
+
+void ShapingCache::Insert(const std::string& text,
+                          const ShapedTextPtr& shaped) {
+  if (!shaped)
+    return;
+  const size_t size = GetEntrySize(text, *shaped);
+  base::LockGuard guard(&mutex_);
+  entries_.Insert(text, shaped, size);
+}
+
+void ShapingCache::SetBudget(size_t budget) {
+  base::LockGuard guard(&mutex_);
+  entries_.SetBudget(budget);
+}
+
+size_t ShapingCache::GetBudget() const {
+  base::LockGuard guard(&mutex_);
+  return entries_.GetBudget();
+}
+
+size_t ShapingCache::GetSize() const {
+  base::LockGuard guard(&mutex_);
+  return entries_.GetSize();
+}
+
+size_t ShapingCache::GetEntryCount() const {
+  base::LockGuard guard(&mutex_);
+  return entries_.GetEntryCount();
+}
+
+void ShapingCache::Clear() {
+  base::LockGuard guard(&mutex_);
+  entries_.Clear();
+}
+
+size_t ShapingCache::GetHitCount() const {
+  base::LockGuard guard(&mutex_);
+  return hit_count_;
+}
+
+size_t ShapingCache::GetMissCount() const {
+  base::LockGuard guard(&mutex_);
+  return miss_count_;
+}
+
+size_t ShapingCache::GetEntrySize(const std::string& text,
+                                  const ShapedText& shaped) {
+  // Count the text twice, since it is stored as the key of both the list entry
+  // and the map entry.
+  return 2 * sizeof(text) + sizeof(ShapedTextPtr) + sizeof(size_t) +
+      sizeof(ShapedText) + 2 * text.size() +
+      shaped.glyphs.size() * sizeof(ShapedText::Glyph);
+}
+
+}  // namespace text
+}  // namespace ion
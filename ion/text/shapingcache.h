@@ -0,0 +1,115 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef ION_TEXT_SHAPINGCACHE_H_
+#define ION_TEXT_SHAPINGCACHE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "ion/base/lrucache.h"
+#include "ion/math/vector.h"
+#include "ion/port/mutex.h"
+#include "ion/text/layout.h"
+
+namespace ion {
+namespace text {
+
+// ShapedText is the output of the complex-script layout engine for a single
+// line of text: the glyphs in visual order and the pen position of each, in
+// pixels relative to the start of the baseline. The position does not include
+// the glyph's bitmap offset, so it is independent of where the line is placed.
+struct ShapedText {
+  struct Glyph {
+    Glyph() : glyph_index(0) {}
+    Glyph(GlyphIndex glyph_index_in, const math::Point2f& position_in)
+        : glyph_index(glyph_index_in), position(position_in) {}
+
+    GlyphIndex glyph_index;
+    math::Point2f position;
+  };
+
+  ShapedText() : advance(0.f) {}
+
+  std::vector<Glyph> glyphs;
+  // The total horizontal advance of the line in pixels.
+  float advance;
+};
+
+// Convenience typedef for a shared, immutable ShapedText.
+typedef std::shared_ptr<const ShapedText> ShapedTextPtr;
+
+// A ShapingCache stores the ShapedText of lines of text so that text that is
+// laid out repeatedly with a complex-script layout engine is only shaped once.
+// Each FreeTypeFont owns one, so entries are keyed by the text alone; the
+// script runs and bidirectional levels are derived from the text by the layout
+// engine. The cache holds at most a budget of bytes of ShapedText, evicting
+// the least recently used entries to make room. All functions are
+// thread-safe.
+class ION_API ShapingCache {
+ public:
+  // The default budget, in bytes.
+  static const size_t kDefaultBudget = 256 * 1024;
+
+  ShapingCache();
+  ~ShapingCache();
+
+  // Returns the ShapedText for |text|, or a NULL pointer if it is not cached.
+  const ShapedTextPtr Find(const std::string& text);
+
+  // Adds |shaped| to the cache as the ShapedText for |text|, replacing any
+  // existing entry. Does nothing if |shaped| is NULL or larger than the budget.
+  void Insert(const std::string& text, const ShapedTextPtr& shaped);
+
+  // Sets/returns the maximum number of bytes of cached entries. Reducing the
+  // budget evicts entries immediately. A budget of zero disables caching.
+  void SetBudget(size_t budget);
+  size_t GetBudget() const;
+
+  // Returns the number of bytes used by cached entries.
+  size_t GetSize() const;
+  // Returns the number of cached entries.
+  size_t GetEntryCount() const;
+
+  // Removes all entries.
+  void Clear();
+
+  // Returns the number of calls to Find() that did or did not find an entry.
+  size_t GetHitCount() const;
+  size_t GetMissCount() const;
+
+  // Returns the number of bytes charged against the budget for an entry.
+  static size_t GetEntrySize(const std::string& text,
+                             const ShapedText& shaped);
+
+ private:
+  // Cached entries, which cost their size in bytes.
+  base::LruCache<std::string, ShapedTextPtr> entries_;
+  size_t hit_count_;
+  size_t miss_count_;
+  // Protects all of the above.
+  mutable port::Mutex mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(ShapingCache);
+};
+
+}  // namespace text
+}  // namespace ion
+
+#endif  // ION_TEXT_SHAPINGCACHE_H_
@@ -17,8 +17,10 @@ limitations under the License.
 
 #include "ion/text/basicbuilder.h"
 
+#include <cstring>
 #include <string>
 
+#include "ion/base/datacontainer.h"
 #include "ion/base/tests/multilinestringsequal.h"
 #include "ion/base/zipassetmanager.h"
 #include "ion/base/zipassetmanagermacros.h"
@@ -28,9 +30,11 @@ limitations under the License.
 #include "ion/math/rangeutils.h"
 #include "ion/math/vector.h"
 #include "ion/text/font.h"
+#include "ion/text/fontimage.h"
 #include "ion/text/fontmanager.h"
 #include "ion/text/layout.h"
 #include "ion/text/tests/buildertestbase.h"
+#include "ion/text/tests/mockfont.h"
 #include "third_party/googletest/googletest/include/gtest/gtest.h"
 
 namespace ion {
@@ -312,6 +316,121 @@ TEST_F(BasicBuilderTest, RebuildAfterChanges) {
       expected, BuildNodeString(node)));
 }
 
+TEST_F(BasicBuilderTest, SkipUnchangedLayouts) {
+  BasicBuilder* bb = GetBuilder();
+  EXPECT_FALSE(bb->IsSkippingUnchangedLayouts());
+  bb->SetSkipUnchangedLayouts(true);
+  EXPECT_TRUE(bb->IsSkippingUnchangedLayouts());
+
+  // Build and save the results.
+  const Layout layout = BuildLayout("bg");
+  ASSERT_TRUE(bb->Build(layout, ion::gfx::BufferObject::kStreamDraw));
+  gfx::NodePtr node = bb->GetNode();
+  const std::string expected = BuildNodeString(node);
+
+  // Clears the vertex data in the Shape so that regenerating it is visible.
+  const auto clear_vertex_data = [&node]() {
+    const gfx::AttributeArrayPtr& attr_array =
+        node->GetShapes()[0]->GetAttributeArray();
+    const gfx::BufferObjectPtr& bo =
+        attr_array->GetBufferAttribute(0).GetValue<gfx::BufferObjectElement>()
+            .buffer_object;
+    memset(bo->GetData()->GetMutableData<char>(), 0,
+           bo->GetStructSize() * bo->GetCount());
+  };
+
+  // Rebuilding with an identical Layout should not touch the vertex data.
+  clear_vertex_data();
+  const std::string cleared = BuildNodeString(node);
+  EXPECT_NE(expected, cleared);
+  EXPECT_TRUE(bb->Build(BuildLayout("bg"),
+                        ion::gfx::BufferObject::kStreamDraw));
+  EXPECT_EQ(cleared, BuildNodeString(node));
+
+  // A different usage mode or Layout causes the data to be regenerated.
+  EXPECT_TRUE(bb->Build(layout, ion::gfx::BufferObject::kDynamicDraw));
+  EXPECT_EQ(expected, BuildNodeString(node));
+  clear_vertex_data();
+  EXPECT_TRUE(bb->Build(BuildLayout("gb"),
+                        ion::gfx::BufferObject::kDynamicDraw));
+  EXPECT_TRUE(bb->Build(layout, ion::gfx::BufferObject::kDynamicDraw));
+  EXPECT_EQ(expected, BuildNodeString(node));
+
+  // So does a new FontImage.
+  clear_vertex_data();
+  bb->SetFontImage(BuildMockFontImage());
+  EXPECT_TRUE(bb->Build(layout, ion::gfx::BufferObject::kDynamicDraw));
+  EXPECT_EQ(expected, BuildNodeString(node));
+
+  // Without skipping, the data is always regenerated.
+  bb->SetSkipUnchangedLayouts(false);
+  EXPECT_FALSE(bb->IsSkippingUnchangedLayouts());
+  clear_vertex_data();
+  EXPECT_TRUE(bb->Build(layout, ion::gfx::BufferObject::kDynamicDraw));
+  EXPECT_EQ(expected, BuildNodeString(node));
+}
+
+// Returns the texture coordinates of the first vertex of a Node built by a
+// BasicBuilder. Each vertex holds a 3D position followed by the coordinates.
+static const math::Point2f GetFirstTextureCoords(const gfx::NodePtr& node) {
+  const gfx::AttributeArrayPtr& attr_array =
+      node->GetShapes()[0]->GetAttributeArray();
+  const gfx::BufferObjectPtr& bo =
+      attr_array->GetBufferAttribute(0).GetValue<gfx::BufferObjectElement>()
+          .buffer_object;
+  const float* data = bo->GetData()->GetData<float>();
+  return math::Point2f(data[3], data[4]);
+}
+
+TEST(BasicBuilderRepackingTest, SkipUnchangedLayoutsAfterRepacking) {
+  // Use the same glyphs as FontImageTest.DynamicFontImageRepacking, where '#'
+  // only fits into the image if it is re-packed.
+  FontPtr font(new testing::MockFont(32U, 2U));
+  const GlyphIndex glyph_g = font->GetDefaultGlyphForChar('g');
+  const GlyphIndex glyph_div = font->GetDefaultGlyphForChar(0x00f7);
+  const GlyphIndex glyph_hash = font->GetDefaultGlyphForChar('#');
+  DynamicFontImagePtr dfi(new DynamicFontImage(font, 128U));
+  dfi->EnableRepacking(true);
+  BasicBuilderPtr bb(new BasicBuilder(dfi, gfxutils::ShaderManagerPtr(),
+                                      base::AllocatorPtr()));
+  bb->SetSkipUnchangedLayouts(true);
+
+  Layout layout;
+  EXPECT_TRUE(layout.AddGlyph(
+      Layout::Glyph(glyph_g, Layout::Quad(math::Point3f(0.0f, 0.0f, 0.0f),
+                                          math::Point3f(1.0f, 0.0f, 0.0f),
+                                          math::Point3f(1.0f, 1.0f, 0.0f),
+                                          math::Point3f(0.0f, 1.0f, 0.0f)),
+                    math::Range2f(), math::Vector2f::Zero())));
+  ASSERT_TRUE(bb->Build(layout, ion::gfx::BufferObject::kStreamDraw));
+  const FontImage::ImageData& data = dfi->GetImageData(0U);
+  math::Range2f rect;
+  ASSERT_TRUE(FontImage::GetTextureCoords(data, glyph_g, &rect));
+  const math::Point2f old_coords = GetFirstTextureCoords(bb->GetNode());
+  EXPECT_EQ(rect.GetMinPoint()[0], old_coords[0]);
+  EXPECT_EQ(rect.GetMaxPoint()[1], old_coords[1]);
+
+  // Re-pack the ImageData, which moves 'g'.
+  const uint64 generation = data.generation;
+  GlyphSet glyph_set(base::AllocatorPtr(NULL));
+  glyph_set.insert(glyph_div);
+  EXPECT_EQ(0U, dfi->FindImageDataIndex(glyph_set));
+  EXPECT_EQ(generation, data.generation);
+  glyph_set.clear();
+  glyph_set.insert(glyph_hash);
+  EXPECT_EQ(0U, dfi->FindImageDataIndex(glyph_set));
+  EXPECT_EQ(generation + 1U, data.generation);
+  ASSERT_TRUE(FontImage::GetTextureCoords(data, glyph_g, &rect));
+  EXPECT_NE(old_coords, math::Point2f(rect.GetMinPoint()[0],
+                                      rect.GetMaxPoint()[1]));
+
+  // Rebuilding the unchanged Layout must pick up the new texture coordinates.
+  ASSERT_TRUE(bb->Build(layout, ion::gfx::BufferObject::kStreamDraw));
+  const math::Point2f new_coords = GetFirstTextureCoords(bb->GetNode());
+  EXPECT_EQ(rect.GetMinPoint()[0], new_coords[0]);
+  EXPECT_EQ(rect.GetMaxPoint()[1], new_coords[1]);
+}
+
 TEST_F(BasicBuilderTest, BuildWithShaderManager) {
   // Build with no ShaderManager.
   Layout layout = BuildLayout("bg");
@@ -0,0 +1,173 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+// Benchmarks each BinPacker::Algorithm on glyph-sized rectangles arriving in
+// small batches, the way DynamicFontImage packs the glyphs of each new string.
+// For each algorithm it reports the packing rate and the fraction of the bin
+// that is occupied when the first batch no longer fits, both for incremental
+// packing and when the bin is then re-packed from scratch with as many more
+// glyphs as will fit. This is built as a separate target so that it does not
+// slow down the regular tests.
+
+#include <iostream>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "base/integral_types.h"
+#include "ion/analytics/benchmark.h"
+#include "ion/analytics/benchmarkutils.h"
+#include "ion/math/vector.h"
+#include "ion/port/timer.h"
+#include "ion/text/binpacker.h"
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace text {
+
+namespace {
+
+using analytics::Benchmark;
+using math::Vector2ui;
+
+static const uint32 kBinSize = 512U;
+static const size_t kBatchSize = 8U;
+static const size_t kMaxGlyphs = 4096U;
+static const uint32 kSdfPadding = 4U;
+static const int kIterations = 5;
+
+// Returns the sizes of kMaxGlyphs glyphs from a 32px font with SDF padding,
+// using a fixed pseudo-random sequence. Like Latin text, most glyphs are
+// x-height lowercase letters, with some ascenders, descenders and narrow
+// punctuation.
+static const std::vector<Vector2ui> BuildGlyphSizes() {
+  std::vector<Vector2ui> sizes;
+  sizes.reserve(kMaxGlyphs);
+  uint32 seed = 1U;
+  for (size_t i = 0; i < kMaxGlyphs; ++i) {
+    seed = seed * 1103515245U + 12345U;
+    const uint32 kind = (seed >> 16) % 10U;
+    seed = seed * 1103515245U + 12345U;
+    const uint32 jitter = (seed >> 16) % 8U;
+    uint32 width = 12U + jitter * 2U;
+    uint32 height = 16U;
+    if (kind < 5U) {
+      height = 16U + jitter / 2U;  // x-height.
+    } else if (kind < 8U) {
+      height = 23U + jitter / 2U;  // Ascender, descender or capital.
+    } else {
+      width = 3U + jitter;         // Punctuation.
+      height = 4U + jitter * 3U;
+    }
+    sizes.push_back(Vector2ui(width + 2U * kSdfPadding,
+                              height + 2U * kSdfPadding));
+  }
+  return sizes;
+}
+
+// Packs batches of glyphs into |packer| until a batch does not fit, and
+// returns the number of glyphs in the batches that fit.
+static size_t PackIncrementally(const std::vector<Vector2ui>& sizes,
+                                BinPacker* packer) {
+  const Vector2ui bin_size(kBinSize, kBinSize);
+  size_t count = 0;
+  while (count + kBatchSize <= sizes.size()) {
+    BinPacker test_packer(*packer);
+    for (size_t i = count; i < count + kBatchSize; ++i)
+      test_packer.AddRectangle(i, sizes[i]);
+    if (!test_packer.Pack(bin_size))
+      break;
+    *packer = test_packer;
+    count += kBatchSize;
+  }
+  return count;
+}
+
+// Adds glyphs to |packer| one batch at a time after it is full, re-packing the
+// bin from scratch each time, and returns the total number of glyphs that fit.
+static size_t PackWithRepacking(const std::vector<Vector2ui>& sizes,
+                                size_t count, BinPacker* packer) {
+  const Vector2ui bin_size(kBinSize, kBinSize);
+  while (count + kBatchSize <= sizes.size()) {
+    BinPacker test_packer(*packer);
+    for (size_t i = count; i < count + kBatchSize; ++i)
+      test_packer.AddRectangle(i, sizes[i]);
+    if (!test_packer.Repack(bin_size))
+      break;
+    *packer = test_packer;
+    count += kBatchSize;
+  }
+  return count;
+}
+
+// Adds the packing rate and final occupancy of one way of packing to
+// |benchmark|. |pack| fills a BinPacker and returns the number of glyphs that
+// were packed.
+template <typename PackFunc>
+static void Measure(const std::string& name, BinPacker::Algorithm algorithm,
+                    const PackFunc& pack, Benchmark* benchmark) {
+  Benchmark::VariableAccumulator accumulator(Benchmark::Descriptor(
+      name + " rate", name, "Packing rate of " + name, "Glyphs/s"));
+  double occupancy = 0.0;
+  for (int i = 0; i < kIterations; ++i) {
+    BinPacker packer(algorithm);
+    port::Timer timer;
+    const size_t count = pack(&packer);
+    const double seconds = timer.GetInS();
+    if (seconds > 0.0)
+      accumulator.AddSample(static_cast<double>(count) / seconds);
+    occupancy = static_cast<double>(packer.GetPackedArea()) /
+                static_cast<double>(kBinSize * kBinSize);
+  }
+  benchmark->AddAccumulatedVariable(accumulator.Get());
+  benchmark->AddConstant(Benchmark::Constant(
+      Benchmark::Descriptor(name + " occupancy", name,
+                            "Fraction of the bin used by " + name, "%"),
+      occupancy * 100.0));
+}
+
+}  // anonymous namespace
+
+TEST(BinPackerBenchmark, PackingRateAndOccupancy) {
+  struct {
+    const char* name;
+    BinPacker::Algorithm algorithm;
+  } algorithms[] = {
+    { "Skyline", BinPacker::kSkylineBottomLeft },
+    { "MaxRects", BinPacker::kMaxRectsBestShortSideFit },
+    { "Guillotine", BinPacker::kGuillotineBestAreaFit },
+  };
+
+  const std::vector<Vector2ui> sizes = BuildGlyphSizes();
+  Benchmark benchmark;
+  for (size_t a = 0; a < sizeof(algorithms) / sizeof(algorithms[0]); ++a) {
+    const std::string name = algorithms[a].name;
+    Measure(name, algorithms[a].algorithm, [&sizes](BinPacker* packer) {
+      return PackIncrementally(sizes, packer);
+    }, &benchmark);
+    Measure(name + "Repack", algorithms[a].algorithm,
+            [&sizes](BinPacker* packer) {
+      return PackWithRepacking(sizes, PackIncrementally(sizes, packer),
+                               packer);
+    }, &benchmark);
+  }
+
+  analytics::OutputBenchmarkPretty("BinPacker", false, benchmark, std::cout);
+  EXPECT_FALSE(benchmark.GetAccumulatedVariables().empty());
+}
+
+}  // namespace text
+}  // namespace ion
@@ -17,12 +17,53 @@ limitations under the License.
 
 #include "ion/text/binpacker.h"
 
+#include <vector>
+
 #include "ion/math/vector.h"
 #include "third_party/googletest/googletest/include/gtest/gtest.h"
 
 namespace ion {
 namespace text {
 
+namespace {
+
+// Adds |count| rectangles with sizes typical of glyphs to |bp|, using a fixed
+// pseudo-random sequence so that results are repeatable.
+static void AddGlyphRectangles(size_t count, BinPacker* bp) {
+  uint32 seed = 12345U;
+  for (size_t i = 0; i < count; ++i) {
+    seed = seed * 1103515245U + 12345U;
+    const uint32 width = 6U + (seed >> 16) % 20U;
+    seed = seed * 1103515245U + 12345U;
+    const uint32 height = 12U + (seed >> 16) % 16U;
+    bp->AddRectangle(i, math::Vector2ui(width, height));
+  }
+}
+
+// Returns true if the first |count| rectangles of |bp| lie within a bin of the
+// given size and do not overlap each other.
+static bool IsValidPacking(const BinPacker& bp, size_t count,
+                           const math::Vector2ui& bin_size) {
+  const std::vector<BinPacker::Rectangle>& rects = bp.GetRectangles();
+  for (size_t i = 0; i < count; ++i) {
+    const BinPacker::Rectangle& a = rects[i];
+    if (a.bottom_left[0] + a.size[0] > bin_size[0] ||
+        a.bottom_left[1] + a.size[1] > bin_size[1])
+      return false;
+    for (size_t j = i + 1; j < count; ++j) {
+      const BinPacker::Rectangle& b = rects[j];
+      if (a.bottom_left[0] < b.bottom_left[0] + b.size[0] &&
+          b.bottom_left[0] < a.bottom_left[0] + a.size[0] &&
+          a.bottom_left[1] < b.bottom_left[1] + b.size[1] &&
+          b.bottom_left[1] < a.bottom_left[1] + a.size[1])
+        return false;
+    }
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
 TEST(BinPackerTest, OneBin) {
   BinPacker bp;
   bp.AddRectangle(0, math::Vector2ui(10, 10));
@@ -257,5 +298,84 @@ TEST(BinPackerTest, CopyAndAssign) {
   }
 }
 
+TEST(BinPackerTest, Algorithms) {
+  const BinPacker::Algorithm algorithms[] = {
+    BinPacker::kSkylineBottomLeft,
+    BinPacker::kMaxRectsBestShortSideFit,
+    BinPacker::kGuillotineBestAreaFit,
+  };
+  const math::Vector2ui bin_size(256, 256);
+  for (size_t a = 0; a < sizeof(algorithms) / sizeof(algorithms[0]); ++a) {
+    SCOPED_TRACE(a);
+    BinPacker bp(algorithms[a]);
+    EXPECT_EQ(algorithms[a], bp.GetAlgorithm());
+    EXPECT_EQ(0U, bp.GetPackedCount());
+    EXPECT_EQ(0U, bp.GetPackedArea());
+
+    // A few rectangles fit easily.
+    AddGlyphRectangles(20U, &bp);
+    EXPECT_TRUE(bp.Pack(bin_size));
+    EXPECT_EQ(20U, bp.GetPackedCount());
+    EXPECT_TRUE(IsValidPacking(bp, 20U, bin_size));
+    uint64 area = 0;
+    for (size_t i = 0; i < 20U; ++i)
+      area += bp.GetRectangles()[i].size[0] * bp.GetRectangles()[i].size[1];
+    EXPECT_EQ(area, bp.GetPackedArea());
+
+    // Far too many rectangles do not, but the ones that were placed must
+    // still be valid and should cover most of the bin.
+    BinPacker full(algorithms[a]);
+    AddGlyphRectangles(400U, &full);
+    EXPECT_FALSE(full.Pack(bin_size));
+    EXPECT_LT(full.GetPackedCount(), 400U);
+    EXPECT_TRUE(IsValidPacking(full, full.GetPackedCount(), bin_size));
+    EXPECT_GT(full.GetPackedArea(), 256U * 256U * 3U / 4U);
+
+    // Copies keep the algorithm and the placement.
+    BinPacker copy(full);
+    EXPECT_EQ(algorithms[a], copy.GetAlgorithm());
+    EXPECT_EQ(full.GetPackedCount(), copy.GetPackedCount());
+    EXPECT_EQ(full.GetPackedArea(), copy.GetPackedArea());
+  }
+}
+
+TEST(BinPackerTest, Repack) {
+  // Incrementally packing the 10x6 rectangle above the 4x4 one leaves no room
+  // for the 6x4 one, but all three fit exactly when packed from scratch.
+  BinPacker bp;
+  const math::Vector2ui bin_size(10, 10);
+  bp.AddRectangle(0, math::Vector2ui(4, 4));
+  EXPECT_TRUE(bp.Pack(bin_size));
+  bp.AddRectangle(1, math::Vector2ui(10, 6));
+  EXPECT_TRUE(bp.Pack(bin_size));
+  bp.AddRectangle(2, math::Vector2ui(6, 4));
+  EXPECT_FALSE(bp.Pack(bin_size));
+  EXPECT_EQ(2U, bp.GetPackedCount());
+
+  // A failed Repack() leaves the BinPacker unchanged.
+  EXPECT_FALSE(bp.Repack(math::Vector2ui(10, 9)));
+  EXPECT_EQ(2U, bp.GetPackedCount());
+  EXPECT_EQ(76U, bp.GetPackedArea());
+  EXPECT_EQ(0U, bp.GetRectangles()[0].id);
+
+  EXPECT_TRUE(bp.Repack(bin_size));
+  EXPECT_EQ(3U, bp.GetPackedCount());
+  EXPECT_EQ(100U, bp.GetPackedArea());
+  EXPECT_TRUE(IsValidPacking(bp, 3U, bin_size));
+  const std::vector<BinPacker::Rectangle>& rects = bp.GetRectangles();
+  ASSERT_EQ(3U, rects.size());
+  EXPECT_EQ(1U, rects[0].id);
+  EXPECT_EQ(math::Point2ui(0, 0), rects[0].bottom_left);
+  EXPECT_EQ(2U, rects[1].id);
+  EXPECT_EQ(math::Point2ui(0, 6), rects[1].bottom_left);
+  EXPECT_EQ(0U, rects[2].id);
+  EXPECT_EQ(math::Point2ui(6, 6), rects[2].bottom_left);
+
+  // Packing continues incrementally after a Repack().
+  bp.AddRectangle(3, math::Vector2ui(1, 1));
+  EXPECT_FALSE(bp.Pack(bin_size));
+  EXPECT_TRUE(bp.Pack(math::Vector2ui(11, 10)));
+}
+
 }  // namespace text
 }  // namespace ion
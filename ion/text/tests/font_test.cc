@@ -21,6 +21,7 @@ limitations under the License.
 
 #include "ion/base/invalid.h"
 #include "ion/base/logchecker.h"
+#include "ion/text/sdfutils.h"
 #include "ion/text/tests/mockfont.h"
 #include "third_party/googletest/googletest/include/gtest/gtest.h"
 
@@ -126,6 +127,72 @@ TEST(FontTest, Font) {
   EXPECT_TRUE(log_checker.HasMessage("ERROR", "Grid is already an SDF grid"));
 }
 
+TEST(FontTest, CacheSdfGrids) {
+  // Use enough glyphs that the SDF grids are computed on multiple threads.
+  static const size_t kGlyphCount = 48U;
+  static const size_t kGlyphSize = 64U;
+  static const size_t kPadding = 4U;
+  TestFontPtr font(new TestFont("myFontName", kGlyphSize, kPadding));
+  EXPECT_EQ(kSweepSdf, font->GetSdfAlgorithm());
+  font->SetSdfAlgorithm(kExactEdtSdf);
+  EXPECT_EQ(kExactEdtSdf, font->GetSdfAlgorithm());
+  GlyphSet glyphs(ion::base::AllocatorPtr(NULL));
+  for (size_t i = 0; i < kGlyphCount; ++i) {
+    // Each glyph is a square of a different size.
+    base::Array2<double> pixels(kGlyphSize, kGlyphSize, 0.0);
+    for (size_t y = 0; y <= i; ++y) {
+      for (size_t x = 0; x <= i; ++x)
+        pixels.Set(x + 4U, y + 8U, 1.0);
+    }
+    const CharIndex char_index = static_cast<CharIndex>(i + 32U);
+    font->AddGlyphGrid(char_index, pixels);
+    glyphs.insert(font->GetDefaultGlyphForChar(char_index));
+  }
+
+  font->CacheSdfGrids(glyphs);
+  for (size_t i = 0; i < kGlyphCount; ++i) {
+    SCOPED_TRACE(::testing::Message() << "glyph " << i);
+    base::Array2<double> pixels(kGlyphSize, kGlyphSize, 0.0);
+    for (size_t y = 0; y <= i; ++y) {
+      for (size_t x = 0; x <= i; ++x)
+        pixels.Set(x + 4U, y + 8U, 1.0);
+    }
+    const base::Array2<double> expected =
+        ComputeSdfGrid(pixels, kPadding, kExactEdtSdf);
+    const Font::GlyphGrid& grid =
+        font->GetGlyphGridForChar(static_cast<CharIndex>(i + 32U));
+    EXPECT_TRUE(grid.is_sdf);
+    ASSERT_EQ(expected.GetWidth(), grid.pixels.GetWidth());
+    ASSERT_EQ(expected.GetHeight(), grid.pixels.GetHeight());
+    EXPECT_EQ(expected.Get(0U, 0U), grid.pixels.Get(0U, 0U));
+    EXPECT_EQ(expected.Get(i + 8U, i + 12U), grid.pixels.Get(i + 8U, i + 12U));
+  }
+
+  // Grids that already store SDF values are left alone.
+  font->CacheSdfGrids(glyphs);
+  EXPECT_TRUE(font->GetGlyphGridForChar(32U).is_sdf);
+
+  // The default algorithm is kSweepSdf.
+  TestFontPtr sweep_font(new TestFont("myFontName", kGlyphSize, kPadding));
+  base::Array2<double> pixels(kGlyphSize, kGlyphSize, 0.0);
+  for (size_t y = 0; y < 16U; ++y) {
+    for (size_t x = 0; x < 16U; ++x)
+      pixels.Set(x + 4U, y + 8U, 1.0);
+  }
+  sweep_font->AddGlyphGrid(32U, pixels);
+  GlyphSet sweep_glyphs(ion::base::AllocatorPtr(NULL));
+  sweep_glyphs.insert(sweep_font->GetDefaultGlyphForChar(32U));
+  sweep_font->CacheSdfGrids(sweep_glyphs);
+  const base::Array2<double> expected = ComputeSdfGrid(pixels, kPadding);
+  const Font::GlyphGrid& grid = sweep_font->GetGlyphGridForChar(32U);
+  EXPECT_TRUE(grid.is_sdf);
+  ASSERT_EQ(expected.GetWidth(), grid.pixels.GetWidth());
+  for (size_t y = 0; y < expected.GetHeight(); ++y) {
+    for (size_t x = 0; x < expected.GetWidth(); ++x)
+      EXPECT_EQ(expected.Get(x, y), grid.pixels.Get(x, y));
+  }
+}
+
 TEST(FontTest, AddGlyphsForAsciiCharacterRange) {
   FontPtr font(new testing::MockFont(32U, 0U));
   GlyphSet glyphs(ion::base::AllocatorPtr(NULL));
@@ -35,6 +35,45 @@ static void AddCharacterRange(CharIndex start, CharIndex finish,
     glyph_set->insert(font->GetDefaultGlyphForChar(i));
 }
 
+namespace {
+
+// A Font that has a 20x20 glyph for each glyph index from 2 to 99, so that
+// each glyph fills a 32x32 DynamicFontImage image. Glyph 1 has zero size.
+class GridFont : public Font {
+ public:
+  GridFont() : Font("GridFont", 16U, 2U) {}
+
+  GlyphIndex GetDefaultGlyphForChar(CharIndex char_index) const override {
+    return static_cast<GlyphIndex>(char_index);
+  }
+
+  const Layout BuildLayout(const std::string& text,
+                           const LayoutOptions& options) const override {
+    return Layout();
+  }
+
+  void AddFallbackFont(const FontPtr& fallback) override {}
+
+ protected:
+  bool LoadGlyphGrid(GlyphIndex glyph_index,
+                     GlyphGrid* glyph_grid) const override {
+    if (glyph_index >= 100U)
+      return false;
+    const size_t size = glyph_index == 1U ? 0U : 20U;
+    glyph_grid->pixels = base::Array2<double>(size, size, 0.5);
+    return true;
+  }
+};
+
+}  // anonymous namespace
+
+// Returns true if two texture rectangles share more than an edge.
+static bool RangesOverlap(const math::Range2f& r0, const math::Range2f& r1) {
+  const math::Range2f intersection = math::RangeIntersection(r0, r1);
+  return !intersection.IsEmpty() && intersection.GetSize()[0] > 0.f &&
+         intersection.GetSize()[1] > 0.f;
+}
+
 static bool FontImageHasGlyphForChar(const FontImage::ImageData& data,
                                      const FontPtr& font, CharIndex c) {
   return FontImage::HasGlyph(data, font->GetDefaultGlyphForChar(c));
@@ -260,6 +299,84 @@ TEST(FontImageTest, DynamicFontImageNoChars) {
   EXPECT_EQ(0U, dfi->GetImageDataCount());
 }
 
+TEST(FontImageTest, DynamicFontImageRepacking) {
+  static const size_t kFontSize = 32U;
+  static const size_t kSdfPadding = 2U;
+  FontPtr font(new testing::MockFont(kFontSize, kSdfPadding));
+  const GlyphIndex glyph_g = font->GetDefaultGlyphForChar('g');
+  const GlyphIndex glyph_div = font->GetDefaultGlyphForChar(0x00f7);
+  const GlyphIndex glyph_hash = font->GetDefaultGlyphForChar('#');
+
+  for (int deferred = 0; deferred < 2; ++deferred) {
+    SCOPED_TRACE(deferred);
+    for (int repacking = 0; repacking < 2; ++repacking) {
+      SCOPED_TRACE(repacking);
+      DynamicFontImagePtr dfi(new DynamicFontImage(font, 128U));
+      EXPECT_EQ(BinPacker::kSkylineBottomLeft, dfi->GetPackingAlgorithm());
+      EXPECT_FALSE(dfi->IsRepackingEnabled());
+      dfi->EnableDeferredUpdates(deferred != 0);
+      dfi->EnableRepacking(repacking != 0);
+      EXPECT_EQ(repacking != 0, dfi->IsRepackingEnabled());
+
+      // Add 'g' and the division sign one at a time, which leaves no room to
+      // the side of or above them for '#'.
+      GlyphSet glyph_set(base::AllocatorPtr(NULL));
+      glyph_set.insert(glyph_g);
+      EXPECT_EQ(0U, dfi->FindImageDataIndex(glyph_set));
+      glyph_set.clear();
+      glyph_set.insert(glyph_div);
+      EXPECT_EQ(0U, dfi->FindImageDataIndex(glyph_set));
+      dfi->ProcessDeferredUpdates();
+      const FontImage::ImageData& data = dfi->GetImageData(0U);
+      EXPECT_EQ(1U, data.texture->GetSubImages().size());
+
+      // '#' fits into the first ImageData only if all three are re-packed, in
+      // which case the entire image is replaced.
+      glyph_set.clear();
+      glyph_set.insert(glyph_hash);
+      if (repacking) {
+        EXPECT_EQ(0U, dfi->FindImageDataIndex(glyph_set));
+        EXPECT_EQ(1U, dfi->GetImageDataCount());
+        EXPECT_EQ(3U, data.glyph_set.size());
+        EXPECT_EQ(3U, data.texture_rectangle_map.size());
+        EXPECT_EQ(deferred ? 1U : 2U, data.texture->GetSubImages().size());
+        dfi->ProcessDeferredUpdates();
+        EXPECT_EQ(2U, data.texture->GetSubImages().size());
+        EXPECT_EQ(math::Point3ui::Zero(),
+                  data.texture->GetSubImages()[1].offset);
+        EXPECT_EQ(128U, data.texture->GetSubImages()[1].image->GetWidth());
+        // The glyphs must not overlap.
+        const FontImage::ImageData::TexRectMap& rects =
+            data.texture_rectangle_map;
+        const math::Range2f& rect_g = rects.find(glyph_g)->second;
+        const math::Range2f& rect_div = rects.find(glyph_div)->second;
+        const math::Range2f& rect_hash = rects.find(glyph_hash)->second;
+        EXPECT_FALSE(RangesOverlap(rect_g, rect_div));
+        EXPECT_FALSE(RangesOverlap(rect_g, rect_hash));
+        EXPECT_FALSE(RangesOverlap(rect_div, rect_hash));
+        // 'g', the division sign and '#' cover 10808 of 16384 pixels.
+        EXPECT_NEAR(0.660f, dfi->GetImageDataUsedAreaFraction(0U), 1e-3f);
+      } else {
+        EXPECT_EQ(1U, dfi->FindImageDataIndex(glyph_set));
+        EXPECT_EQ(2U, dfi->GetImageDataCount());
+        // Adding an ImageData invalidates |data|.
+        EXPECT_EQ(2U, dfi->GetImageData(0U).glyph_set.size());
+      }
+    }
+  }
+
+  // The packing algorithm can be changed for new ImageData instances.
+  DynamicFontImagePtr dfi(new DynamicFontImage(font, 128U));
+  dfi->SetPackingAlgorithm(BinPacker::kMaxRectsBestShortSideFit);
+  EXPECT_EQ(BinPacker::kMaxRectsBestShortSideFit, dfi->GetPackingAlgorithm());
+  GlyphSet glyph_set(base::AllocatorPtr(NULL));
+  glyph_set.insert(glyph_g);
+  glyph_set.insert(glyph_div);
+  glyph_set.insert(glyph_hash);
+  EXPECT_EQ(0U, dfi->FindImageDataIndex(glyph_set));
+  EXPECT_NEAR(0.660f, dfi->GetImageDataUsedAreaFraction(0U), 1e-3f);
+}
+
 TEST(FontImageTest, DynamicFontImageAdding) {
   // Note: This test uses a real Font (not the MockFont) so that there are
   // sufficient characters to test several features.
@@ -456,6 +573,64 @@ TEST(FontImageTest, DynamicFontImageAdding) {
   }
 }
 
+TEST(FontImageTest, DynamicFontImageGlyphIndex) {
+  // Each glyph needs its own image, so this creates more images than fit in
+  // the glyph index masks.
+  static const GlyphIndex kGlyphCount = 70U;
+  FontPtr font(new GridFont);
+  DynamicFontImagePtr dfi(new DynamicFontImage(font, 32U));
+  for (GlyphIndex g = 2U; g < 2U + kGlyphCount; ++g) {
+    GlyphSet glyph_set(base::AllocatorPtr(NULL));
+    glyph_set.insert(g);
+    EXPECT_EQ(g - 2U, dfi->FindImageDataIndex(glyph_set));
+  }
+  EXPECT_EQ(kGlyphCount, dfi->GetImageDataCount());
+
+  for (GlyphIndex g = 2U; g < 2U + kGlyphCount; ++g) {
+    SCOPED_TRACE(::testing::Message() << "glyph " << g);
+    GlyphSet glyph_set(base::AllocatorPtr(NULL));
+    glyph_set.insert(g);
+    EXPECT_EQ(g - 2U, dfi->FindContainingImageDataIndex(glyph_set));
+    EXPECT_EQ(g - 2U, dfi->FindImageDataIndex(glyph_set));
+    // Glyphs that the Font filters out do not matter.
+    glyph_set.insert(0U);
+    glyph_set.insert(1U);
+    glyph_set.insert(500U);
+    EXPECT_EQ(g - 2U, dfi->FindContainingImageDataIndex(glyph_set));
+    EXPECT_EQ(g - 2U, dfi->FindImageDataIndex(glyph_set));
+  }
+  EXPECT_EQ(kGlyphCount, dfi->GetImageDataCount());
+
+  // No image contains glyphs from two images or glyphs never added.
+  GlyphSet glyph_set(base::AllocatorPtr(NULL));
+  glyph_set.insert(3U);
+  glyph_set.insert(5U);
+  EXPECT_EQ(base::kInvalidIndex, dfi->FindContainingImageDataIndex(glyph_set));
+  glyph_set.clear();
+  glyph_set.insert(68U);
+  glyph_set.insert(69U);
+  EXPECT_EQ(base::kInvalidIndex, dfi->FindContainingImageDataIndex(glyph_set));
+  glyph_set.clear();
+  glyph_set.insert(90U);
+  EXPECT_EQ(base::kInvalidIndex, dfi->FindContainingImageDataIndex(glyph_set));
+  glyph_set.insert(1U);
+  EXPECT_EQ(base::kInvalidIndex, dfi->FindContainingImageDataIndex(glyph_set));
+
+  // Only filtered glyphs.
+  glyph_set.clear();
+  glyph_set.insert(1U);
+  glyph_set.insert(500U);
+  EXPECT_EQ(base::kInvalidIndex, dfi->FindContainingImageDataIndex(glyph_set));
+  EXPECT_EQ(base::kInvalidIndex, dfi->FindImageDataIndex(glyph_set));
+  EXPECT_EQ(kGlyphCount, dfi->GetImageDataCount());
+
+  // The index is updated when a glyph is added.
+  glyph_set.clear();
+  glyph_set.insert(90U);
+  EXPECT_EQ(kGlyphCount, dfi->FindImageDataIndex(glyph_set));
+  EXPECT_EQ(kGlyphCount, dfi->FindContainingImageDataIndex(glyph_set));
+}
+
 TEST(FontImageTest, DynamicFontImageDeferredUpdates) {
   // Note: This test uses a real Font (not the MockFont) so that there are
   // sufficient characters to test several features.
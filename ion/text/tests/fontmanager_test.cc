@@ -17,10 +17,16 @@ limitations under the License.
 
 #include "ion/text/fontmanager.h"
 
+#include <stdio.h>
+
+#include <cstring>
+#include <string>
+
 #include "ion/base/logchecker.h"
 #include "ion/math/range.h"
 #include "ion/math/rangeutils.h"
 #include "ion/math/vectorutils.h"
+#include "ion/port/fileutils.h"
 #include "ion/text/fonts/roboto_regular.h"
 #include "ion/text/tests/mockfont.h"
 #include "ion/text/tests/mockfontimage.h"
@@ -151,5 +157,207 @@ TEST(FontManagerTest, CacheFontImage) {
   EXPECT_EQ(font_image, f);
 }
 
+TEST(FontManagerTest, SaveAndLoadFontImage) {
+  base::LogChecker logchecker;
+  static const size_t kFontSize = 32U;
+  static const size_t kSdfPadding = 4U;
+  FontManagerPtr fm(new FontManager);
+  FontPtr font(new testing::MockFont(kFontSize, kSdfPadding));
+  GlyphSet glyph_set(base::AllocatorPtr(NULL));
+  glyph_set.insert(font->GetDefaultGlyphForChar('A'));
+  glyph_set.insert(font->GetDefaultGlyphForChar('b'));
+  glyph_set.insert(font->GetDefaultGlyphForChar('.'));
+  StaticFontImagePtr sfi(new StaticFontImage(font, 256U, glyph_set));
+  const FontImage::ImageData& data = sfi->GetImageData();
+  ASSERT_TRUE(data.texture->HasImage(0U));
+
+  // Persistence is disabled by default.
+  EXPECT_TRUE(fm->GetFontImageCacheDirectory().empty());
+  EXPECT_FALSE(fm->SaveFontImage("Static", sfi));
+  EXPECT_TRUE(fm->LoadFontImage("Static", font).Get() == NULL);
+
+  fm->SetFontImageCacheDirectory(port::GetTemporaryDirectory());
+  EXPECT_EQ(port::GetTemporaryDirectory(), fm->GetFontImageCacheDirectory());
+  const std::string static_path = fm->GetFontImageCachePath("Static", *font);
+  const std::string dynamic_path =
+      fm->GetFontImageCachePath("Dynamic", *font);
+  EXPECT_NE(static_path, dynamic_path);
+  port::RemoveFile(static_path);
+  port::RemoveFile(dynamic_path);
+  EXPECT_TRUE(fm->LoadFontImage("Static", font).Get() == NULL);
+
+  // Round-trip a StaticFontImage.
+  EXPECT_TRUE(fm->SaveFontImage("Static", sfi));
+  FontManagerPtr fm2(new FontManager);
+  fm2->SetFontImageCacheDirectory(port::GetTemporaryDirectory());
+  FontImagePtr loaded = fm2->LoadFontImage("Static", font);
+  ASSERT_FALSE(loaded.Get() == NULL);
+  EXPECT_EQ(loaded, fm2->GetCachedFontImage("Static"));
+  EXPECT_EQ(FontImage::kStatic, loaded->GetType());
+  EXPECT_EQ(256U, loaded->GetMaxImageSize());
+  EXPECT_EQ(font, loaded->GetFont());
+  const FontImage::ImageData& loaded_data =
+      static_cast<StaticFontImage*>(loaded.Get())->GetImageData();
+  EXPECT_EQ("MockFont_32", loaded_data.texture->GetLabel());
+  EXPECT_TRUE(data.glyph_set == loaded_data.glyph_set);
+  EXPECT_TRUE(data.texture_rectangle_map == loaded_data.texture_rectangle_map);
+  const gfx::Image& image = *data.texture->GetImage(0U);
+  const gfx::Image& loaded_image = *loaded_data.texture->GetImage(0U);
+  EXPECT_EQ(gfx::Image::kLuminance, loaded_image.GetFormat());
+  EXPECT_EQ(image.GetWidth(), loaded_image.GetWidth());
+  EXPECT_EQ(image.GetHeight(), loaded_image.GetHeight());
+  EXPECT_EQ(0, memcmp(image.GetData()->GetData(),
+                      loaded_image.GetData()->GetData(),
+                      image.GetDataSize()));
+
+  // A font with different metrics or data does not use the file.
+  FontPtr other_font(new testing::MockFont(kFontSize, kSdfPadding + 1U));
+  EXPECT_TRUE(fm2->LoadFontImage("Static", other_font).Get() == NULL);
+  font->SetSdfAlgorithm(kExactEdtSdf);
+  EXPECT_TRUE(fm2->LoadFontImage("Static", font).Get() == NULL);
+  font->SetSdfAlgorithm(kSweepSdf);
+  fm2->font_data_hash_map_[FontManager::BuildFontKeyFromFont(*font)] = 1U;
+  EXPECT_TRUE(fm2->LoadFontImage("Static", font).Get() == NULL);
+  fm2->font_data_hash_map_.clear();
+
+  // Round-trip a DynamicFontImage, including a glyph added as a sub-image.
+  DynamicFontImagePtr dfi(new DynamicFontImage(font, 128U));
+  GlyphSet glyph_set2(base::AllocatorPtr(NULL));
+  glyph_set2.insert(font->GetDefaultGlyphForChar('A'));
+  EXPECT_EQ(0U, dfi->FindImageDataIndex(glyph_set2));
+  glyph_set2.insert(font->GetDefaultGlyphForChar('.'));
+  EXPECT_EQ(0U, dfi->FindImageDataIndex(glyph_set2));
+  EXPECT_FALSE(dfi->GetImageData(0U).texture->GetSubImages().empty());
+  EXPECT_TRUE(fm->SaveFontImage("Dynamic", dfi));
+  // Load with a fresh Font so that none of its glyph grids have been
+  // converted to SDF values yet, as when restoring in a new process.
+  FontPtr fresh_font(new testing::MockFont(kFontSize, kSdfPadding));
+  loaded = fm2->LoadFontImage("Dynamic", fresh_font);
+  ASSERT_FALSE(loaded.Get() == NULL);
+  EXPECT_EQ(FontImage::kDynamic, loaded->GetType());
+  DynamicFontImage* loaded_dfi = static_cast<DynamicFontImage*>(loaded.Get());
+  ASSERT_EQ(1U, loaded_dfi->GetImageDataCount());
+  EXPECT_EQ("MockFont_32_0", loaded_dfi->GetImageData(0U).texture->GetLabel());
+  EXPECT_TRUE(dfi->GetImageData(0U).texture_rectangle_map ==
+              loaded_dfi->GetImageData(0U).texture_rectangle_map);
+  EXPECT_NEAR(dfi->GetImageDataUsedAreaFraction(0U),
+              loaded_dfi->GetImageDataUsedAreaFraction(0U), 1e-4f);
+  // The sub-image was composited into the saved image.
+  const gfx::Image& dynamic_image =
+      *loaded_dfi->GetImageData(0U).texture->GetImage(0U);
+  math::Range2f rect;
+  EXPECT_TRUE(FontImage::GetTextureCoords(
+      loaded_dfi->GetImageData(0U), font->GetDefaultGlyphForChar('.'), &rect));
+  const size_t x = static_cast<size_t>(rect.GetMinPoint()[0] * 128.f + 0.5f);
+  const size_t y = static_cast<size_t>(rect.GetMinPoint()[1] * 128.f + 0.5f);
+  EXPECT_EQ(static_cast<uint8>(0.5 * 255.0),
+            dynamic_image.GetData()->GetData<uint8>()[(y + 6U) * 128U + x + 6U]);
+  // Glyphs already in the restored image are found, and new glyphs are added
+  // to it by re-packing it.
+  EXPECT_EQ(0U, loaded_dfi->FindImageDataIndex(glyph_set2));
+  const float used_area_fraction =
+      loaded_dfi->GetImageDataUsedAreaFraction(0U);
+  GlyphSet glyph_set3(base::AllocatorPtr(NULL));
+  glyph_set3.insert(font->GetDefaultGlyphForChar('g'));
+  EXPECT_EQ(0U, loaded_dfi->FindImageDataIndex(glyph_set3));
+  EXPECT_EQ(1U, loaded_dfi->GetImageDataCount());
+  EXPECT_EQ(3U, loaded_dfi->GetImageData(0U).glyph_set.size());
+  EXPECT_GT(loaded_dfi->GetImageDataUsedAreaFraction(0U), used_area_fraction);
+  EXPECT_EQ(0U, loaded_dfi->FindImageDataIndex(glyph_set2));
+  // The re-packed glyphs keep their padded SDF sizes.
+  const GlyphIndex glyph_a = font->GetDefaultGlyphForChar('A');
+  EXPECT_TRUE(fresh_font->GetGlyphGrid(glyph_a).is_sdf);
+  math::Range2f original_rect;
+  EXPECT_TRUE(FontImage::GetTextureCoords(dfi->GetImageData(0U), glyph_a,
+                                          &original_rect));
+  EXPECT_TRUE(FontImage::GetTextureCoords(loaded_dfi->GetImageData(0U),
+                                          glyph_a, &rect));
+  EXPECT_EQ(original_rect.GetSize(), rect.GetSize());
+
+  // Images whose data has been wiped cannot be saved.
+  loaded_dfi->GetImageData(0U).texture->GetImage(0U)->GetData()->WipeData();
+  EXPECT_FALSE(fm2->SaveFontImage("Dynamic", loaded));
+  EXPECT_TRUE(logchecker.HasMessage("WARNING", "Unable to save FontImage"));
+
+  // Corrupt files are ignored.
+  FILE* file = port::OpenFile(static_path, "r+b");
+  ASSERT_TRUE(file != NULL);
+  fseek(file, 56, SEEK_SET);
+  const uint32 bad_count = 0xffffffU;
+  fwrite(&bad_count, sizeof(bad_count), 1U, file);
+  fclose(file);
+  EXPECT_TRUE(fm2->LoadFontImage("Static", font).Get() == NULL);
+  EXPECT_TRUE(logchecker.HasMessage("WARNING", "Ignoring invalid FontImage"));
+
+  port::RemoveFile(static_path);
+  port::RemoveFile(dynamic_path);
+}
+
+TEST(FontManagerTest, SaveFontImageWithImageRetention) {
+  static const size_t kFontSize = 32U;
+  static const size_t kSdfPadding = 4U;
+  FontManagerPtr fm(new FontManager);
+  fm->SetFontImageCacheDirectory(port::GetTemporaryDirectory());
+  FontPtr font(new testing::MockFont(kFontSize, kSdfPadding));
+  const std::string path = fm->GetFontImageCachePath("Retained", *font);
+  port::RemoveFile(path);
+
+  DynamicFontImagePtr dfi(new DynamicFontImage(font, 128U));
+  EXPECT_FALSE(dfi->IsImageRetentionEnabled());
+  dfi->EnableImageRetention(true);
+  EXPECT_TRUE(dfi->IsImageRetentionEnabled());
+  GlyphSet glyph_set(base::AllocatorPtr(NULL));
+  glyph_set.insert(font->GetDefaultGlyphForChar('A'));
+  EXPECT_EQ(0U, dfi->FindImageDataIndex(glyph_set));
+
+  // The image data survives being sent to OpenGL, and glyphs added later are
+  // written into it.
+  const gfx::ImagePtr& image = dfi->GetImageData(0U).texture->GetImage(0U);
+  image->GetData()->WipeData();
+  ASSERT_TRUE(image->GetData()->GetData() != NULL);
+  glyph_set.insert(font->GetDefaultGlyphForChar('.'));
+  EXPECT_EQ(0U, dfi->FindImageDataIndex(glyph_set));
+  EXPECT_TRUE(dfi->GetImageData(0U).texture->GetSubImages().empty());
+  math::Range2f rect;
+  EXPECT_TRUE(FontImage::GetTextureCoords(
+      dfi->GetImageData(0U), font->GetDefaultGlyphForChar('.'), &rect));
+  const size_t x = static_cast<size_t>(rect.GetMinPoint()[0] * 128.f + 0.5f);
+  const size_t y = static_cast<size_t>(rect.GetMinPoint()[1] * 128.f + 0.5f);
+  EXPECT_EQ(static_cast<uint8>(0.5 * 255.0),
+            image->GetData()->GetData<uint8>()[(y + 6U) * 128U + x + 6U]);
+  EXPECT_TRUE(fm->SaveFontImage("Retained", dfi));
+
+  // A restored image can be extended and saved again.
+  FontManagerPtr fm2(new FontManager);
+  fm2->SetFontImageCacheDirectory(port::GetTemporaryDirectory());
+  FontPtr fresh_font(new testing::MockFont(kFontSize, kSdfPadding));
+  FontImagePtr loaded = fm2->LoadFontImage("Retained", fresh_font);
+  ASSERT_FALSE(loaded.Get() == NULL);
+  DynamicFontImage* loaded_dfi = static_cast<DynamicFontImage*>(loaded.Get());
+  loaded_dfi->EnableImageRetention(true);
+  glyph_set.insert(font->GetDefaultGlyphForChar('g'));
+  EXPECT_EQ(0U, loaded_dfi->FindImageDataIndex(glyph_set));
+  math::Range2f loaded_rect;
+  EXPECT_TRUE(FontImage::GetTextureCoords(
+      dfi->GetImageData(0U), font->GetDefaultGlyphForChar('A'), &rect));
+  EXPECT_TRUE(FontImage::GetTextureCoords(loaded_dfi->GetImageData(0U),
+                                          font->GetDefaultGlyphForChar('A'),
+                                          &loaded_rect));
+  EXPECT_EQ(rect.GetSize(), loaded_rect.GetSize());
+  EXPECT_TRUE(
+      fresh_font->GetGlyphGrid(font->GetDefaultGlyphForChar('A')).is_sdf);
+  loaded_dfi->GetImageData(0U).texture->GetImage(0U)->GetData()->WipeData();
+  EXPECT_TRUE(fm2->SaveFontImage("Retained", loaded));
+  FontManagerPtr fm3(new FontManager);
+  fm3->SetFontImageCacheDirectory(port::GetTemporaryDirectory());
+  loaded = fm3->LoadFontImage("Retained", font);
+  ASSERT_FALSE(loaded.Get() == NULL);
+  loaded_dfi = static_cast<DynamicFontImage*>(loaded.Get());
+  ASSERT_EQ(1U, loaded_dfi->GetImageDataCount());
+  EXPECT_TRUE(glyph_set == loaded_dfi->GetImageData(0U).glyph_set);
+
+  port::RemoveFile(path);
+}
+
 }  // namespace text
 }  // namespace ion
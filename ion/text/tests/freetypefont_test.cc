@@ -22,6 +22,8 @@ limitations under the License.
 #include "ion/base/logchecker.h"
 #include "ion/base/tests/testallocator.h"
 #include "ion/math/vector.h"
+#include "ion/text/layout.h"
+#include "ion/text/shapingcache.h"
 #include "ion/text/tests/testfont.h"
 #include "third_party/googletest/googletest/include/gtest/gtest.h"
 
@@ -156,6 +158,38 @@ TEST(FreeTypeFontTest, FallbackFont) {
             font->GetKerning(katakana_ka, katakana_ka));
 }
 
+TEST(FreeTypeFontTest, ShapingCache) {
+  FreeTypeFontPtr font = BuildFont("Test", 32U, 4U);
+  ShapingCache& cache = font->GetShapingCache();
+  EXPECT_EQ(0U, cache.GetEntryCount());
+  LayoutOptions options;
+  options.target_size.Set(0.f, 32.f);
+
+  // Text that does not need complex layout is not shaped.
+  font->BuildLayout("Abc", options);
+  EXPECT_EQ(0U, cache.GetEntryCount());
+
+#if defined(ION_USE_ICU)
+  // An 'e' with a combining acute accent needs shaping. Each line is shaped
+  // once, regardless of the layout options.
+  const std::string text("e\xcc\x81\nAe\xcc\x81");
+  const Layout layout = font->BuildLayout(text, options);
+  EXPECT_EQ(2U, cache.GetEntryCount());
+  EXPECT_EQ(2U, cache.GetMissCount());
+  EXPECT_EQ(layout, font->BuildLayout(text, options));
+  options.target_point.Set(10.f, 20.f);
+  font->BuildLayout(text, options);
+  EXPECT_EQ(2U, cache.GetEntryCount());
+  EXPECT_EQ(4U, cache.GetHitCount());
+
+  // Adding a fallback font clears the cache.
+  const std::string& data = testing::GetCJKFontData();
+  font->AddFallbackFont(FreeTypeFontPtr(
+      new FreeTypeFont("CJK", 32U, 4U, &data[0], data.size())));
+  EXPECT_EQ(0U, cache.GetEntryCount());
+#endif  // ION_USE_ICU
+}
+
 TEST(FreeTypeFontTest, LibraryInitFailure) {
   // Simulate library initialization failure, which is otherwise very hard to
   // test.
@@ -172,6 +172,42 @@ TEST(LayoutTest, ReplaceGlyph) {
                         bounds, offset)));
 }
 
+TEST(LayoutTest, Equality) {
+  const Range2f bounds(math::Point2f(0.0f, 0.0f), math::Point2f(1.0f, 2.0f));
+  const math::Vector2f offset(1.0f, -1.0f);
+  Layout layout0;
+  Layout layout1;
+  EXPECT_TRUE(layout0 == layout1);
+  layout0.AddGlyph(Layout::Glyph(
+      14U, BuildQuad(0.0f, 0.0f, 1.0f, 2.0f), bounds, offset));
+  EXPECT_TRUE(layout0 != layout1);
+  layout1.AddGlyph(Layout::Glyph(
+      14U, BuildQuad(0.0f, 0.0f, 1.0f, 2.0f), bounds, offset));
+  EXPECT_TRUE(layout0 == layout1);
+
+  // Any difference in a glyph or the line advance height matters.
+  Layout layout2 = layout1;
+  layout2.ReplaceGlyph(0U, Layout::Glyph(
+      15U, BuildQuad(0.0f, 0.0f, 1.0f, 2.0f), bounds, offset));
+  EXPECT_FALSE(layout0 == layout2);
+  layout2 = layout1;
+  layout2.ReplaceGlyph(0U, Layout::Glyph(
+      14U, BuildQuad(0.0f, 0.5f, 1.0f, 2.0f), bounds, offset));
+  EXPECT_FALSE(layout0 == layout2);
+  layout2 = layout1;
+  layout2.ReplaceGlyph(0U, Layout::Glyph(
+      14U, BuildQuad(0.0f, 0.0f, 1.0f, 2.0f), Range2f(), offset));
+  EXPECT_FALSE(layout0 == layout2);
+  layout2 = layout1;
+  layout2.ReplaceGlyph(0U, Layout::Glyph(
+      14U, BuildQuad(0.0f, 0.0f, 1.0f, 2.0f), bounds,
+      math::Vector2f::Zero()));
+  EXPECT_FALSE(layout0 == layout2);
+  layout2 = layout1;
+  layout2.SetLineAdvanceHeight(3.0f);
+  EXPECT_FALSE(layout0 == layout2);
+}
+
 TEST(LayoutTest, StringOperators) {
   Layout::Quad quad(ion::math::Point3f(2, 3, 4),
                     ion::math::Point3f(5, 6, 7),
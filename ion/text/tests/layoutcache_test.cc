@@ -0,0 +1,160 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/text/layoutcache.h"
+
+#include <string>
+
+#include "ion/text/tests/mockfont.h"
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace text {
+
+namespace {
+
+// CountingFont lays out one unit-sized glyph per character and counts how many
+// Layouts it built.
+class CountingFont : public testing::MockFont {
+ public:
+  CountingFont() : MockFont(16U, 2U), build_count_(0) {}
+
+  const Layout BuildLayout(const std::string& text,
+                           const LayoutOptions& options) const override {
+    ++build_count_;
+    Layout layout;
+    for (size_t i = 0; i < text.size(); ++i) {
+      const math::Point3f p(options.target_point[0] + static_cast<float>(i),
+                            options.target_point[1], 0.f);
+      const Layout::Quad quad(p, p + math::Vector3f(1.f, 0.f, 0.f),
+                              p + math::Vector3f(1.f, 1.f, 0.f),
+                              p + math::Vector3f(0.f, 1.f, 0.f));
+      layout.AddGlyph(Layout::Glyph(
+          GetDefaultGlyphForChar(text[i]), quad,
+          math::Range2f(math::Point2f::Zero(), math::Point2f(1.f, 1.f)),
+          math::Vector2f::Zero()));
+    }
+    return layout;
+  }
+
+  size_t GetBuildCount() const { return build_count_; }
+
+ private:
+  mutable size_t build_count_;
+};
+
+typedef base::ReferentPtr<CountingFont>::Type CountingFontPtr;
+
+}  // anonymous namespace
+
+TEST(LayoutCacheTest, GetLayout) {
+  LayoutCachePtr cache(new LayoutCache);
+  EXPECT_EQ(LayoutCache::kDefaultCapacity, cache->GetCapacity());
+  EXPECT_EQ(0U, cache->GetSize());
+
+  // A NULL font produces no Layout.
+  EXPECT_FALSE(cache->GetLayout(FontPtr(), "Ab", LayoutOptions()));
+  EXPECT_EQ(0U, cache->GetMissCount());
+
+  CountingFontPtr font(new CountingFont);
+  LayoutOptions options;
+  SharedLayoutPtr layout = cache->GetLayout(font, "Ab", options);
+  ASSERT_TRUE(layout);
+  EXPECT_EQ(2U, layout->GetGlyphCount());
+  EXPECT_EQ(font->BuildLayout("Ab", options), *layout);
+  EXPECT_EQ(2U, font->GetBuildCount());
+  EXPECT_EQ(0U, cache->GetHitCount());
+  EXPECT_EQ(1U, cache->GetMissCount());
+
+  // The same request returns the same shared Layout without building.
+  EXPECT_EQ(layout, cache->GetLayout(font, "Ab", options));
+  EXPECT_EQ(2U, font->GetBuildCount());
+  EXPECT_EQ(1U, cache->GetHitCount());
+
+  // Changing the text, any of the options or the font builds a new Layout.
+  EXPECT_NE(layout, cache->GetLayout(font, "bA", options));
+  LayoutOptions options2 = options;
+  options2.target_point.Set(1.f, 0.f);
+  EXPECT_NE(layout, cache->GetLayout(font, "Ab", options2));
+  options2 = options;
+  options2.target_size.Set(2.f, 0.f);
+  EXPECT_NE(layout, cache->GetLayout(font, "Ab", options2));
+  options2 = options;
+  options2.horizontal_alignment = kAlignRight;
+  EXPECT_NE(layout, cache->GetLayout(font, "Ab", options2));
+  options2 = options;
+  options2.vertical_alignment = kAlignTop;
+  EXPECT_NE(layout, cache->GetLayout(font, "Ab", options2));
+  options2 = options;
+  options2.line_spacing = 2.f;
+  EXPECT_NE(layout, cache->GetLayout(font, "Ab", options2));
+  CountingFontPtr font2(new CountingFont);
+  EXPECT_NE(layout, cache->GetLayout(font2, "Ab", options));
+  EXPECT_EQ(8U, font->GetBuildCount());
+  EXPECT_EQ(1U, font2->GetBuildCount());
+  EXPECT_EQ(8U, cache->GetSize());
+  EXPECT_EQ(1U, cache->GetHitCount());
+  EXPECT_EQ(8U, cache->GetMissCount());
+
+  // The original Layout is still cached.
+  EXPECT_EQ(layout, cache->GetLayout(font, "Ab", options));
+
+  // Clearing forces a rebuild, but the old Layout remains valid.
+  cache->Clear();
+  EXPECT_EQ(0U, cache->GetSize());
+  SharedLayoutPtr layout2 = cache->GetLayout(font, "Ab", options);
+  EXPECT_NE(layout, layout2);
+  EXPECT_EQ(*layout, *layout2);
+  EXPECT_EQ(9U, font->GetBuildCount());
+}
+
+TEST(LayoutCacheTest, Eviction) {
+  LayoutCachePtr cache(new LayoutCache(2U));
+  EXPECT_EQ(2U, cache->GetCapacity());
+  CountingFontPtr font(new CountingFont);
+  const LayoutOptions options;
+
+  SharedLayoutPtr a = cache->GetLayout(font, "A", options);
+  SharedLayoutPtr b = cache->GetLayout(font, "b", options);
+  EXPECT_EQ(2U, cache->GetSize());
+
+  // Using "A" makes "b" the least recently used entry, so adding "g" evicts
+  // it.
+  EXPECT_EQ(a, cache->GetLayout(font, "A", options));
+  cache->GetLayout(font, "g", options);
+  EXPECT_EQ(2U, cache->GetSize());
+  EXPECT_EQ(3U, font->GetBuildCount());
+  EXPECT_EQ(a, cache->GetLayout(font, "A", options));
+  EXPECT_EQ(3U, font->GetBuildCount());
+  SharedLayoutPtr b2 = cache->GetLayout(font, "b", options);
+  EXPECT_NE(b, b2);
+  EXPECT_EQ(*b, *b2);
+  EXPECT_EQ(4U, font->GetBuildCount());
+
+  // Reducing the capacity evicts immediately, and zero disables caching.
+  cache->SetCapacity(1U);
+  EXPECT_EQ(1U, cache->GetSize());
+  EXPECT_EQ(b2, cache->GetLayout(font, "b", options));
+  cache->SetCapacity(0U);
+  EXPECT_EQ(0U, cache->GetSize());
+  EXPECT_TRUE(cache->GetLayout(font, "b", options));
+  EXPECT_EQ(0U, cache->GetSize());
+  EXPECT_EQ(5U, font->GetBuildCount());
+}
+
+}  // namespace text
+}  // namespace ion
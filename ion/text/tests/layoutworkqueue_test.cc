@@ -0,0 +1,140 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/text/layoutworkqueue.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "ion/text/tests/mockfont.h"
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace text {
+
+namespace {
+
+// CountingFont lays out one unit-sized glyph per character and counts how many
+// Layouts it built. BuildLayout() may be called from several threads.
+class CountingFont : public testing::MockFont {
+ public:
+  CountingFont() : MockFont(16U, 2U), build_count_(0) {}
+
+  const Layout BuildLayout(const std::string& text,
+                           const LayoutOptions& options) const override {
+    ++build_count_;
+    Layout layout;
+    for (size_t i = 0; i < text.size(); ++i) {
+      const math::Point3f p(options.target_point[0] + static_cast<float>(i),
+                            options.target_point[1], 0.f);
+      const Layout::Quad quad(p, p + math::Vector3f(1.f, 0.f, 0.f),
+                              p + math::Vector3f(1.f, 1.f, 0.f),
+                              p + math::Vector3f(0.f, 1.f, 0.f));
+      layout.AddGlyph(Layout::Glyph(
+          GetDefaultGlyphForChar(text[i]), quad,
+          math::Range2f(math::Point2f::Zero(), math::Point2f(1.f, 1.f)),
+          math::Vector2f::Zero()));
+    }
+    return layout;
+  }
+
+  size_t GetBuildCount() const { return build_count_; }
+
+ private:
+  mutable std::atomic<size_t> build_count_;
+};
+
+typedef base::ReferentPtr<CountingFont>::Type CountingFontPtr;
+
+}  // anonymous namespace
+
+TEST(LayoutWorkQueueTest, BuildLayoutAsync) {
+  LayoutWorkQueuePtr queue(new LayoutWorkQueue(2U));
+  EXPECT_FALSE(queue->GetLayoutCache().Get());
+  CountingFontPtr font(new CountingFont);
+  LayoutOptions options;
+  options.target_point.Set(2.f, 3.f);
+
+  std::future<SharedLayoutPtr> future =
+      queue->BuildLayoutAsync(font, "Abg", options);
+  const SharedLayoutPtr layout = future.get();
+  ASSERT_TRUE(layout);
+  EXPECT_EQ(3U, layout->GetGlyphCount());
+  EXPECT_EQ(font->BuildLayout("Abg", options), *layout);
+
+  // A NULL font yields a NULL Layout.
+  EXPECT_FALSE(queue->BuildLayoutAsync(FontPtr(), "Abg", options).get());
+}
+
+TEST(LayoutWorkQueueTest, BuildLayoutsAsync) {
+  LayoutWorkQueuePtr queue(new LayoutWorkQueue(3U));
+  CountingFontPtr font(new CountingFont);
+  const LayoutOptions options;
+
+  // Lay out a batch of strings of different lengths, each of them twice.
+  std::vector<std::string> texts;
+  for (size_t i = 1; i <= 50U; ++i)
+    texts.push_back(std::string(i, "Abg."[i % 4]));
+  const std::vector<std::string> first_texts(texts);
+  texts.insert(texts.end(), first_texts.begin(), first_texts.end());
+  std::vector<std::future<SharedLayoutPtr>> futures =
+      queue->BuildLayoutsAsync(font, texts, options);
+  ASSERT_EQ(texts.size(), futures.size());
+  for (size_t i = 0; i < futures.size(); ++i) {
+    const SharedLayoutPtr layout = futures[i].get();
+    ASSERT_TRUE(layout);
+    EXPECT_EQ(texts[i].size(), layout->GetGlyphCount());
+  }
+  EXPECT_EQ(0U, queue->GetPendingCount());
+  EXPECT_EQ(100U, font->GetBuildCount());
+
+  // With a LayoutCache, repeated strings are only laid out once.
+  LayoutCachePtr cache(new LayoutCache);
+  queue->SetLayoutCache(cache);
+  EXPECT_EQ(cache, queue->GetLayoutCache());
+  futures = queue->BuildLayoutsAsync(font, texts, options);
+  std::vector<SharedLayoutPtr> layouts;
+  for (size_t i = 0; i < futures.size(); ++i)
+    layouts.push_back(futures[i].get());
+  EXPECT_EQ(50U, cache->GetSize());
+  EXPECT_EQ(100U, cache->GetHitCount() + cache->GetMissCount());
+  for (size_t i = 0; i < 50U; ++i) {
+    ASSERT_TRUE(layouts[i]);
+    EXPECT_EQ(*layouts[i], *layouts[i + 50U]);
+  }
+  EXPECT_EQ(100U + cache->GetMissCount(), font->GetBuildCount());
+}
+
+TEST(LayoutWorkQueueTest, PendingRequestsCompleteOnDestruction) {
+  CountingFontPtr font(new CountingFont);
+  std::vector<std::future<SharedLayoutPtr>> futures;
+  {
+    LayoutWorkQueuePtr queue(new LayoutWorkQueue(1U));
+    futures = queue->BuildLayoutsAsync(
+        font, std::vector<std::string>(20U, "Abg"), LayoutOptions());
+  }
+  for (size_t i = 0; i < futures.size(); ++i) {
+    const SharedLayoutPtr layout = futures[i].get();
+    ASSERT_TRUE(layout);
+    EXPECT_EQ(3U, layout->GetGlyphCount());
+  }
+  EXPECT_EQ(20U, font->GetBuildCount());
+}
+
+}  // namespace text
+}  // namespace ion
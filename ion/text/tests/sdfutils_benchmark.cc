@@ -0,0 +1,132 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+// Benchmarks SDF generation for each SdfAlgorithm at a range of glyph sizes,
+// both one glyph at a time and for a batch of glyphs computed in parallel the
+// way Font::CacheSdfGrids() does. This is built as a separate target so that
+// it does not slow down the regular tests; the results are printed to stdout
+// in glyphs per second.
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>  // NOLINT
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ion/analytics/benchmark.h"
+#include "ion/analytics/benchmarkutils.h"
+#include "ion/base/array2.h"
+#include "ion/image/imagekernels.h"
+#include "ion/port/timer.h"
+#include "ion/text/sdfutils.h"
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace text {
+
+namespace {
+
+using analytics::Benchmark;
+
+static const size_t kGlyphSizes[] = { 16U, 32U, 64U, 128U };
+static const size_t kBatchSize = 16U;
+static const int kIterations = 5;
+
+// Returns an antialiased ring, which has both inside and outside edges like
+// most glyphs.
+static const base::Array2<double> BuildGlyph(size_t size) {
+  base::Array2<double> glyph(size, size);
+  const double center = 0.5 * static_cast<double>(size);
+  const double outer_radius = 0.45 * static_cast<double>(size);
+  const double inner_radius = 0.25 * static_cast<double>(size);
+  for (size_t y = 0; y < size; ++y) {
+    for (size_t x = 0; x < size; ++x) {
+      const double dx = static_cast<double>(x) + 0.5 - center;
+      const double dy = static_cast<double>(y) + 0.5 - center;
+      const double r = std::sqrt(dx * dx + dy * dy);
+      const double coverage = std::min(outer_radius - r, r - inner_radius);
+      glyph.Set(x, y, std::max(0.0, std::min(1.0, coverage + 0.5)));
+    }
+  }
+  return glyph;
+}
+
+// Runs |func| kIterations times and adds the number of glyphs processed per
+// second to |benchmark|.
+static void Measure(const std::string& name, size_t glyph_size,
+                    size_t glyph_count, const std::function<void()>& func,
+                    Benchmark* benchmark) {
+  std::ostringstream id;
+  id << name << " " << glyph_size << "px";
+  Benchmark::VariableAccumulator accumulator(Benchmark::Descriptor(
+      id.str(), name, "Throughput of " + id.str(), "Glyphs/s"));
+  // Warm up caches.
+  func();
+  for (int i = 0; i < kIterations; ++i) {
+    port::Timer timer;
+    func();
+    const double seconds = timer.GetInS();
+    if (seconds > 0.0)
+      accumulator.AddSample(static_cast<double>(glyph_count) / seconds);
+  }
+  benchmark->AddAccumulatedVariable(accumulator.Get());
+}
+
+}  // anonymous namespace
+
+TEST(SdfutilsBenchmark, GlyphsPerSecond) {
+  struct {
+    const char* name;
+    SdfAlgorithm algorithm;
+  } algorithms[] = {
+    { "Sweep", kSweepSdf },
+    { "ExactEdt", kExactEdtSdf },
+  };
+
+  Benchmark benchmark;
+  for (size_t s = 0; s < sizeof(kGlyphSizes) / sizeof(kGlyphSizes[0]); ++s) {
+    const size_t size = kGlyphSizes[s];
+    const size_t padding = size / 8U;
+    const base::Array2<double> glyph = BuildGlyph(size);
+    for (size_t a = 0; a < sizeof(algorithms) / sizeof(algorithms[0]); ++a) {
+      const SdfAlgorithm algorithm = algorithms[a].algorithm;
+      Measure(algorithms[a].name, size, 1U, [&]() {
+        ComputeSdfGrid(glyph, padding, algorithm);
+      }, &benchmark);
+
+      std::vector<base::Array2<double>> sdfs(kBatchSize);
+      const size_t padded_size = size + 2U * padding;
+      Measure(std::string(algorithms[a].name) + "Parallel", size, kBatchSize,
+              [&]() {
+        image::ParallelForRows(kBatchSize, padded_size * padded_size,
+                               [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i)
+            sdfs[i] = ComputeSdfGrid(glyph, padding, algorithm);
+        });
+      }, &benchmark);
+    }
+  }
+
+  analytics::OutputBenchmarkPretty("SDF generation", false, benchmark,
+                                   std::cout);
+  EXPECT_FALSE(benchmark.GetAccumulatedVariables().empty());
+}
+
+}  // namespace text
+}  // namespace ion
@@ -17,6 +17,10 @@ limitations under the License.
 
 #include "ion/text/sdfutils.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "ion/base/array2.h"
 #include "third_party/googletest/googletest/include/gtest/gtest.h"
 
@@ -71,5 +75,68 @@ TEST(SdfutilsTest, ComputeSdfGrid) {
   }
 }
 
+TEST(SdfutilsTest, ComputeExactSdfGrid) {
+  // For a binary image, each background pixel's distance is the distance to
+  // the nearest foreground pixel center and vice versa, which is easy to
+  // compute by brute force.
+  static const size_t kWidth = 13U;
+  static const size_t kHeight = 9U;
+  static const size_t kPadding = 3U;
+  static const size_t kSdfWidth = kWidth + 2U * kPadding;
+  static const size_t kSdfHeight = kHeight + 2U * kPadding;
+  base::Array2<double> image(kWidth, kHeight, 0.0);
+  base::Array2<double> padded(kSdfWidth, kSdfHeight, 0.0);
+  for (size_t y = 0; y < kHeight; ++y) {
+    for (size_t x = 0; x < kWidth; ++x) {
+      // An irregular shape with a hole.
+      const bool on = ((x * 7U + y * 3U) % 5U < 2U || (x > 3U && y == 4U)) &&
+                      !(x == 6U && y == 4U);
+      image.Set(x, y, on ? 1.0 : 0.0);
+      padded.Set(x + kPadding, y + kPadding, on ? 1.0 : 0.0);
+    }
+  }
+
+  const base::Array2<double> sdf =
+      ComputeSdfGrid(image, kPadding, kExactEdtSdf);
+  EXPECT_EQ(kSdfWidth, sdf.GetWidth());
+  EXPECT_EQ(kSdfHeight, sdf.GetHeight());
+  for (size_t y = 0; y < kSdfHeight; ++y) {
+    for (size_t x = 0; x < kSdfWidth; ++x) {
+      SCOPED_TRACE(::testing::Message() << "x = " << x << ", y = " << y);
+      const double value = padded.Get(x, y);
+      double min_dist_squared = std::numeric_limits<double>::max();
+      for (size_t j = 0; j < kSdfHeight; ++j) {
+        for (size_t i = 0; i < kSdfWidth; ++i) {
+          if (padded.Get(i, j) != value) {
+            const double dx = static_cast<double>(i) - static_cast<double>(x);
+            const double dy = static_cast<double>(j) - static_cast<double>(y);
+            min_dist_squared = std::min(min_dist_squared, dx * dx + dy * dy);
+          }
+        }
+      }
+      const double expected = std::sqrt(min_dist_squared);
+      EXPECT_NEAR(value > 0.5 ? -expected : expected, sdf.Get(x, y), 1e-4);
+    }
+  }
+
+  // Partially covered pixels are offset by their difference from half
+  // coverage.
+  base::Array2<double> edge(3U, 1U, 0.5);
+  edge.Set(1U, 0U, 0.25);
+  edge.Set(2U, 0U, 0.75);
+  const base::Array2<double> edge_sdf = ComputeSdfGrid(edge, 1U, kExactEdtSdf);
+  EXPECT_NEAR(1.0, edge_sdf.Get(0U, 1U), 1e-4);
+  EXPECT_NEAR(0.0, edge_sdf.Get(1U, 1U), 1e-4);
+  EXPECT_NEAR(0.25, edge_sdf.Get(2U, 1U), 1e-4);
+  EXPECT_NEAR(-0.25, edge_sdf.Get(3U, 1U), 1e-4);
+
+  // Grids without any foreground are clamped to the grid diagonal.
+  const base::Array2<double> empty_sdf =
+      ComputeSdfGrid(base::Array2<double>(2U, 2U, 0.0), 1U, kExactEdtSdf);
+  EXPECT_NEAR(std::sqrt(32.0), empty_sdf.Get(0U, 0U), 1e-4);
+  EXPECT_EQ(0U, ComputeSdfGrid(base::Array2<double>(), 0U,
+                               kExactEdtSdf).GetWidth());
+}
+
 }  // namespace text
 }  // namespace ion
@@ -0,0 +1,121 @@
+/**
+Copyright 2016 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "ion/text/shapingcache.h"
+
+#include <string>
+
+#include "third_party/googletest/googletest/include/gtest/gtest.h"
+
+namespace ion {
+namespace text {
+
+namespace {
+
+// Returns a ShapedText with |glyph_count| glyphs spaced one pixel apart.
+static const ShapedTextPtr BuildShapedText(size_t glyph_count) {
+  std::shared_ptr<ShapedText> shaped(new ShapedText);
+  for (size_t i = 0; i < glyph_count; ++i) {
+    shaped->glyphs.push_back(ShapedText::Glyph(
+        static_cast<GlyphIndex>(i + 1),
+        math::Point2f(static_cast<float>(i), 0.f)));
+  }
+  shaped->advance = static_cast<float>(glyph_count);
+  return shaped;
+}
+
+}  // anonymous namespace
+
+TEST(ShapingCacheTest, FindAndInsert) {
+  ShapingCache cache;
+  EXPECT_EQ(ShapingCache::kDefaultBudget, cache.GetBudget());
+  EXPECT_EQ(0U, cache.GetSize());
+  EXPECT_EQ(0U, cache.GetEntryCount());
+
+  EXPECT_FALSE(cache.Find("abc"));
+  EXPECT_EQ(0U, cache.GetHitCount());
+  EXPECT_EQ(1U, cache.GetMissCount());
+
+  // NULL entries are ignored.
+  cache.Insert("abc", ShapedTextPtr());
+  EXPECT_EQ(0U, cache.GetEntryCount());
+
+  const ShapedTextPtr abc = BuildShapedText(3U);
+  cache.Insert("abc", abc);
+  EXPECT_EQ(abc, cache.Find("abc"));
+  EXPECT_EQ(1U, cache.GetHitCount());
+  EXPECT_EQ(1U, cache.GetEntryCount());
+  EXPECT_EQ(ShapingCache::GetEntrySize("abc", *abc), cache.GetSize());
+
+  // Inserting the same text replaces the entry.
+  const ShapedTextPtr abc2 = BuildShapedText(2U);
+  cache.Insert("abc", abc2);
+  EXPECT_EQ(abc2, cache.Find("abc"));
+  EXPECT_EQ(1U, cache.GetEntryCount());
+  EXPECT_EQ(ShapingCache::GetEntrySize("abc", *abc2), cache.GetSize());
+
+  cache.Insert("de", BuildShapedText(2U));
+  EXPECT_EQ(2U, cache.GetEntryCount());
+  cache.Clear();
+  EXPECT_EQ(0U, cache.GetEntryCount());
+  EXPECT_EQ(0U, cache.GetSize());
+  EXPECT_FALSE(cache.Find("abc"));
+  // Returned entries remain valid.
+  EXPECT_EQ(2U, abc2->glyphs.size());
+}
+
+TEST(ShapingCacheTest, Budget) {
+  ShapingCache cache;
+  const ShapedTextPtr a = BuildShapedText(4U);
+  const ShapedTextPtr b = BuildShapedText(4U);
+  const ShapedTextPtr c = BuildShapedText(4U);
+  const size_t entry_size = ShapingCache::GetEntrySize("a", *a);
+  EXPECT_EQ(entry_size, ShapingCache::GetEntrySize("b", *b));
+
+  // Only two entries fit.
+  cache.SetBudget(2U * entry_size + entry_size / 2U);
+  cache.Insert("a", a);
+  cache.Insert("b", b);
+  EXPECT_EQ(2U, cache.GetEntryCount());
+
+  // Using "a" makes "b" the least recently used entry, so inserting "c"
+  // evicts it.
+  EXPECT_EQ(a, cache.Find("a"));
+  cache.Insert("c", c);
+  EXPECT_EQ(2U, cache.GetEntryCount());
+  EXPECT_EQ(2U * entry_size, cache.GetSize());
+  EXPECT_EQ(a, cache.Find("a"));
+  EXPECT_EQ(c, cache.Find("c"));
+  EXPECT_FALSE(cache.Find("b"));
+
+  // An entry larger than the budget is not cached.
+  cache.Insert("big", BuildShapedText(1000U));
+  EXPECT_FALSE(cache.Find("big"));
+  EXPECT_EQ(2U, cache.GetEntryCount());
+
+  // Reducing the budget evicts immediately.
+  cache.SetBudget(entry_size);
+  EXPECT_EQ(1U, cache.GetEntryCount());
+  EXPECT_EQ(c, cache.Find("c"));
+  cache.SetBudget(0U);
+  EXPECT_EQ(0U, cache.GetEntryCount());
+  cache.Insert("a", a);
+  EXPECT_FALSE(cache.Find("a"));
+}
+
+}  // namespace text
+}  // namespace ion
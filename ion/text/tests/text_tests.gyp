@@ -34,9 +34,12 @@
         'fontmanager_test.cc',
         'freetypefont_test.cc',
         'layout_test.cc',
+        'layoutcache_test.cc',
+        'layoutworkqueue_test.cc',
         'outlinebuilder_test.cc',
         'platformfont_test.cc',
         'sdfutils_test.cc',
+        'shapingcache_test.cc',
       ],
       'conditions': [
         ['OS in ["ios", "mac"]', {
@@ -55,5 +58,25 @@
         '<(ion_dir)/port/port.gyp:ionport',
       ],
     },
+
+    {
+      # Reports the SDF generation throughput of each algorithm by glyph size
+      # and the packing rate and atlas occupancy of each BinPacker algorithm.
+      # This is not part of iontext_test since it takes a while.
+      'target_name': 'iontext_benchmark',
+      'includes': [ '../../dev/test_target.gypi' ],
+      'sources' : [
+        'binpacker_benchmark.cc',
+        'sdfutils_benchmark.cc',
+      ],
+      'dependencies' : [
+        '<(ion_dir)/analytics/analytics.gyp:ionanalytics',
+        '<(ion_dir)/base/base.gyp:ionbase_for_tests',
+        '<(ion_dir)/external/gtest.gyp:iongtest_safeallocs',
+        '<(ion_dir)/image/image.gyp:ionimage_for_tests',
+        '<(ion_dir)/port/port.gyp:ionport',
+        '<(ion_dir)/text/text.gyp:iontext_for_tests',
+      ],
+    },
   ],
 }
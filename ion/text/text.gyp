@@ -45,10 +45,16 @@
         'fontmanager.h',
         'layout.cc',
         'layout.h',
+        'layoutcache.cc',
+        'layoutcache.h',
+        'layoutworkqueue.cc',
+        'layoutworkqueue.h',
         'outlinebuilder.cc',
         'outlinebuilder.h',
         'sdfutils.cc',
         'sdfutils.h',
+        'shapingcache.cc',
+        'shapingcache.h',
       ],
       'dependencies': [
         '../gfx/gfx.gyp:iongfx',